@@ -0,0 +1,353 @@
+#include "ClusteredLightBinner.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Utils/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+// spot factors below one 8-bit step are treated as unlit
+constexpr float SPOT_CUTOFF = 1.0f / 256.0f;
+constexpr size_t LIGHT_TRANSFORM_CHUNK = 256;
+
+size_t RoundUpToFour(size_t value)
+{
+	return (value + 3) & ~size_t(3);
+}
+
+vector<float> BuildBoundaries(uint32_t tileCount, float tanHalfAngle)
+{
+	vector<float> boundaries(RoundUpToFour(tileCount + 1), FLT_MAX);
+	for (uint32_t i = 0; i <= tileCount; ++i)
+	{
+		boundaries[i] = (-1.0f + 2.0f * i / tileCount) * tanHalfAngle;
+	}
+	return boundaries;
+}
+
+float HorizontalSum(FXMVECTOR v)
+{
+	XMFLOAT4 lanes;
+	XMStoreFloat4(&lanes, v);
+	return lanes.x + lanes.y + lanes.z + lanes.w;
+}
+}
+
+void ClusteredLightBinner::Initialize(const ClusterGridDesc& desc)
+{
+	m_desc = desc;
+	m_paddedTilesX = static_cast<uint32_t>(RoundUpToFour(desc.tilesX));
+
+	float tanHalfFovY = tanf(desc.fovAngleY * 0.5f);
+	m_boundariesX = BuildBoundaries(desc.tilesX, tanHalfFovY * desc.aspectRatio);
+	m_boundariesY = BuildBoundaries(desc.tilesY, tanHalfFovY);
+
+	m_sliceDepths.resize(desc.slices + 1);
+	for (uint32_t i = 0; i <= desc.slices; ++i)
+	{
+		m_sliceDepths[i] = desc.nearZ * powf(desc.farZ / desc.nearZ, static_cast<float>(i) / desc.slices);
+	}
+
+	m_sliceBins.resize(desc.slices);
+	m_clusters.assign(GetClusterCount(), { 0, 0 });
+	m_lightIndices.clear();
+}
+
+XMFLOAT2 ClusteredLightBinner::GetSliceScaleBias() const
+{
+	float logDepthRange = logf(m_desc.farZ / m_desc.nearZ);
+	float scale = m_desc.slices / logDepthRange;
+	return { scale, -logf(m_desc.nearZ) * scale };
+}
+
+uint32_t ClusteredLightBinner::GetSlice(float viewZ) const
+{
+	if (viewZ <= m_desc.nearZ) return 0;
+	XMFLOAT2 scaleBias = GetSliceScaleBias();
+	float slice = floorf(logf(viewZ) * scaleBias.x + scaleBias.y);
+	return min(static_cast<uint32_t>(max(slice, 0.0f)), m_desc.slices - 1);
+}
+
+float ClusteredLightBinner::ComputeSpotCosHalfAngle(float spotPower)
+{
+	if (spotPower <= 0.0f) return -1.0f;
+	return powf(SPOT_CUTOFF, 1.0f / spotPower);
+}
+
+void ClusteredLightBinner::Bin(const vector<ClusterLight>& lights, const XMFLOAT4X4& view)
+{
+	ThreadPool& threadPool = ThreadPool::GetInstance();
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&view);
+
+	m_viewLights.resize(lights.size());
+	threadPool.ParallelFor(lights.size(), LIGHT_TRANSFORM_CHUNK, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const ClusterLight& light = lights[i];
+			ViewLight& viewLight = m_viewLights[i];
+
+			XMVECTOR apex = XMVector3TransformCoord(XMLoadFloat3(&light.position), viewMatrix);
+			XMVECTOR direction = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&light.direction), viewMatrix));
+			XMStoreFloat3(&viewLight.apex, apex);
+			XMStoreFloat3(&viewLight.direction, direction);
+			viewLight.range = light.range;
+			viewLight.cosHalfAngle = light.cosHalfAngle;
+			viewLight.sinHalfAngle = sqrtf(max(1.0f - light.cosHalfAngle * light.cosHalfAngle, 0.0f));
+
+			// tightest sphere around the lit sector: narrow cones are bounded through the apex and the rim,
+			// wide ones around the rim circle, and anything past 90 degrees by the full range
+			XMVECTOR center = apex;
+			float radius = light.range;
+			if (light.cosHalfAngle > 0.70710678f)
+			{
+				radius = light.range / (2.0f * light.cosHalfAngle);
+				center = XMVectorMultiplyAdd(direction, XMVectorReplicate(radius), apex);
+			}
+			else if (light.cosHalfAngle > 0.0f)
+			{
+				radius = light.range * viewLight.sinHalfAngle;
+				center = XMVectorMultiplyAdd(direction, XMVectorReplicate(light.range * light.cosHalfAngle), apex);
+			}
+			XMStoreFloat4(&viewLight.boundingSphere, XMVectorSetW(center, radius));
+
+			float zMin = viewLight.boundingSphere.z - radius;
+			float zMax = viewLight.boundingSphere.z + radius;
+			if (light.range <= 0.0f || zMax < m_desc.nearZ || zMin > m_desc.farZ)
+			{
+				viewLight.firstSlice = 1;
+				viewLight.lastSlice = 0;
+				continue;
+			}
+			viewLight.firstSlice = GetSlice(max(zMin, m_desc.nearZ));
+			viewLight.lastSlice = GetSlice(min(zMax, m_desc.farZ));
+		}
+	});
+
+	threadPool.ParallelFor(m_desc.slices, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t slice = begin; slice < end; ++slice)
+		{
+			BinSlice(static_cast<uint32_t>(slice));
+		}
+	});
+
+	// slices were compacted independently; rebase them into one list
+	vector<uint32_t> sliceOffsets(m_desc.slices);
+	uint32_t totalCount = 0;
+	for (uint32_t slice = 0; slice < m_desc.slices; ++slice)
+	{
+		sliceOffsets[slice] = totalCount;
+		totalCount += static_cast<uint32_t>(m_sliceBins[slice].lightIndices.size());
+	}
+	m_lightIndices.resize(totalCount);
+
+	uint32_t clustersPerSlice = m_desc.tilesX * m_desc.tilesY;
+	threadPool.ParallelFor(m_desc.slices, 1, [&](size_t begin, size_t end)
+	{
+		for (size_t slice = begin; slice < end; ++slice)
+		{
+			const vector<uint32_t>& sliceIndices = m_sliceBins[slice].lightIndices;
+			copy(sliceIndices.begin(), sliceIndices.end(), m_lightIndices.begin() + sliceOffsets[slice]);
+
+			ClusterRange* clusters = &m_clusters[slice * clustersPerSlice];
+			for (uint32_t i = 0; i < clustersPerSlice; ++i)
+			{
+				clusters[i].offset += sliceOffsets[slice];
+			}
+		}
+	});
+}
+
+void ClusteredLightBinner::BinSlice(uint32_t slice)
+{
+	SliceBin& bin = m_sliceBins[slice];
+	bin.hits.clear();
+
+	float sliceNear = m_sliceDepths[slice];
+	float sliceFar = m_sliceDepths[slice + 1];
+	bool froxelSpheresBuilt = false;
+	size_t spherePlane = static_cast<size_t>(m_desc.tilesY) * m_paddedTilesX;
+
+	for (uint32_t lightIndex = 0; lightIndex < m_viewLights.size(); ++lightIndex)
+	{
+		const ViewLight& light = m_viewLights[lightIndex];
+		if (slice < light.firstSlice || slice > light.lastSlice) continue;
+
+		// the part of the sphere inside the slice fits in its widest cross section swept over the overlap
+		const XMFLOAT4& sphere = light.boundingSphere;
+		float zMin = max(sliceNear, sphere.z - sphere.w);
+		float zMax = min(sliceFar, sphere.z + sphere.w);
+		if (zMin > zMax) continue;
+		float dz = sphere.z < sliceNear ? sliceNear - sphere.z : max(sphere.z - sliceFar, 0.0f);
+		float diskRadius = sqrtf(max(sphere.w * sphere.w - dz * dz, 0.0f));
+
+		uint32_t firstX, lastX, firstY, lastY;
+		if (!ComputeTileRange(m_boundariesX, sphere.x, diskRadius, zMin, zMax, m_desc.tilesX, firstX, lastX)) continue;
+		if (!ComputeTileRange(m_boundariesY, sphere.y, diskRadius, zMin, zMax, m_desc.tilesY, firstY, lastY)) continue;
+
+		bool isSpot = light.cosHalfAngle > 0.0f;
+		if (isSpot && !froxelSpheresBuilt)
+		{
+			BuildFroxelSpheres(slice, bin.froxelSpheres);
+			froxelSpheresBuilt = true;
+		}
+
+		for (uint32_t tileY = firstY; tileY <= lastY; ++tileY)
+		{
+			// boundaries run bottom to top while cluster rows start at the top of the screen
+			uint64_t rowBase = static_cast<uint64_t>(m_desc.tilesY - 1 - tileY) * m_desc.tilesX;
+			if (!isSpot)
+			{
+				for (uint32_t tileX = firstX; tileX <= lastX; ++tileX)
+				{
+					bin.hits.push_back(((rowBase + tileX) << 32) | lightIndex);
+				}
+				continue;
+			}
+
+			// cone against the bounding spheres of four froxels at a time
+			XMVECTOR apexX = XMVectorReplicate(light.apex.x);
+			XMVECTOR apexY = XMVectorReplicate(light.apex.y);
+			XMVECTOR apexZ = XMVectorReplicate(light.apex.z);
+			XMVECTOR dirX = XMVectorReplicate(light.direction.x);
+			XMVECTOR dirY = XMVectorReplicate(light.direction.y);
+			XMVECTOR dirZ = XMVectorReplicate(light.direction.z);
+			XMVECTOR cosAngle = XMVectorReplicate(light.cosHalfAngle);
+			XMVECTOR sinAngle = XMVectorReplicate(light.sinHalfAngle);
+			XMVECTOR range = XMVectorReplicate(light.range);
+
+			for (uint32_t tileX = firstX & ~3u; tileX <= lastX; tileX += 4)
+			{
+				const float* spheres = &bin.froxelSpheres[static_cast<size_t>(tileY) * m_paddedTilesX + tileX];
+				XMVECTOR toCenterX = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(spheres)), apexX);
+				XMVECTOR toCenterY = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(spheres + spherePlane)), apexY);
+				XMVECTOR toCenterZ = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(spheres + 2 * spherePlane)), apexZ);
+				XMVECTOR radius = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(spheres + 3 * spherePlane));
+
+				XMVECTOR lengthSq = XMVectorMultiply(toCenterX, toCenterX);
+				lengthSq = XMVectorMultiplyAdd(toCenterY, toCenterY, lengthSq);
+				lengthSq = XMVectorMultiplyAdd(toCenterZ, toCenterZ, lengthSq);
+				XMVECTOR alongAxis = XMVectorMultiply(toCenterX, dirX);
+				alongAxis = XMVectorMultiplyAdd(toCenterY, dirY, alongAxis);
+				alongAxis = XMVectorMultiplyAdd(toCenterZ, dirZ, alongAxis);
+
+				// distance from the sphere center to the cone surface
+				XMVECTOR perpendicular = XMVectorSqrt(XMVectorMax(XMVectorNegativeMultiplySubtract(alongAxis, alongAxis, lengthSq), XMVectorZero()));
+				XMVECTOR coneDistance = XMVectorNegativeMultiplySubtract(alongAxis, sinAngle, XMVectorMultiply(perpendicular, cosAngle));
+
+				XMVECTOR culled = XMVectorGreater(coneDistance, radius);
+				culled = XMVectorOrInt(culled, XMVectorGreater(alongAxis, XMVectorAdd(radius, range)));
+				culled = XMVectorOrInt(culled, XMVectorLess(alongAxis, XMVectorNegate(radius)));
+
+				uint32_t culledMask[4];
+				XMStoreInt4(culledMask, culled);
+				for (uint32_t lane = 0; lane < 4; ++lane)
+				{
+					uint32_t x = tileX + lane;
+					if (x < firstX || x > lastX || culledMask[lane]) continue;
+					bin.hits.push_back(((rowBase + x) << 32) | lightIndex);
+				}
+			}
+		}
+	}
+
+	// counting sort by cluster keeps the lights of each cluster in ascending order
+	uint32_t clustersPerSlice = m_desc.tilesX * m_desc.tilesY;
+	ClusterRange* clusters = &m_clusters[static_cast<size_t>(slice) * clustersPerSlice];
+	for (uint32_t i = 0; i < clustersPerSlice; ++i)
+	{
+		clusters[i] = { 0, 0 };
+	}
+	for (uint64_t hit : bin.hits)
+	{
+		++clusters[hit >> 32].count;
+	}
+	uint32_t offset = 0;
+	for (uint32_t i = 0; i < clustersPerSlice; ++i)
+	{
+		clusters[i].offset = offset;
+		offset += clusters[i].count;
+	}
+
+	bin.lightIndices.resize(bin.hits.size());
+	for (uint64_t hit : bin.hits)
+	{
+		bin.lightIndices[clusters[hit >> 32].offset++] = static_cast<uint32_t>(hit);
+	}
+	for (uint32_t i = 0; i < clustersPerSlice; ++i)
+	{
+		clusters[i].offset -= clusters[i].count;
+	}
+}
+
+void ClusteredLightBinner::BuildFroxelSpheres(uint32_t slice, vector<float>& spheres) const
+{
+	size_t spherePlane = static_cast<size_t>(m_desc.tilesY) * m_paddedTilesX;
+	spheres.assign(4 * spherePlane, 0.0f);
+
+	float sliceNear = m_sliceDepths[slice];
+	float sliceFar = m_sliceDepths[slice + 1];
+	for (uint32_t tileY = 0; tileY < m_desc.tilesY; ++tileY)
+	{
+		float bottom = min(m_boundariesY[tileY] * sliceNear, m_boundariesY[tileY] * sliceFar);
+		float top = max(m_boundariesY[tileY + 1] * sliceNear, m_boundariesY[tileY + 1] * sliceFar);
+		for (uint32_t tileX = 0; tileX < m_desc.tilesX; ++tileX)
+		{
+			float left = min(m_boundariesX[tileX] * sliceNear, m_boundariesX[tileX] * sliceFar);
+			float right = max(m_boundariesX[tileX + 1] * sliceNear, m_boundariesX[tileX + 1] * sliceFar);
+
+			// sphere around the froxel's bounding box
+			XMFLOAT3 halfExtents = { (right - left) * 0.5f, (top - bottom) * 0.5f, (sliceFar - sliceNear) * 0.5f };
+			size_t index = static_cast<size_t>(tileY) * m_paddedTilesX + tileX;
+			spheres[index] = left + halfExtents.x;
+			spheres[index + spherePlane] = bottom + halfExtents.y;
+			spheres[index + 2 * spherePlane] = sliceNear + halfExtents.z;
+			spheres[index + 3 * spherePlane] = XMVectorGetX(XMVector3Length(XMLoadFloat3(&halfExtents)));
+		}
+	}
+}
+
+bool ClusteredLightBinner::ComputeTileRange(
+	const vector<float>& boundaries,
+	float center, float radius, float zMin, float zMax,
+	uint32_t tileCount, uint32_t& first, uint32_t& last) const
+{
+	// For a boundary plane with tangent t, f = p - t * z is positive on its far side. Over the swept disk
+	// both max f and min f shrink as t grows, so counting the boundaries the disk reaches past (max f >= 0)
+	// and the ones it lies entirely beyond (min f > 0) yields the covered tile range directly.
+	XMVECTOR one = XMVectorSplatOne();
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR nearDepth = XMVectorReplicate(zMin);
+	XMVECTOR farDepth = XMVectorReplicate(zMax);
+	XMVECTOR upper = XMVectorReplicate(center + radius);
+	XMVECTOR lower = XMVectorReplicate(center - radius);
+	XMVECTOR reachedCount = zero;
+	XMVECTOR beyondCount = zero;
+	for (size_t i = 0; i < boundaries.size(); i += 4)
+	{
+		XMVECTOR tangent = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&boundaries[i]));
+		XMVECTOR nonNegative = XMVectorGreaterOrEqual(tangent, zero);
+		XMVECTOR depthForMax = XMVectorSelect(farDepth, nearDepth, nonNegative);
+		XMVECTOR depthForMin = XMVectorSelect(nearDepth, farDepth, nonNegative);
+		XMVECTOR maxF = XMVectorNegativeMultiplySubtract(tangent, depthForMax, upper);
+		XMVECTOR minF = XMVectorNegativeMultiplySubtract(tangent, depthForMin, lower);
+		reachedCount = XMVectorAdd(reachedCount, XMVectorAndInt(XMVectorGreaterOrEqual(maxF, zero), one));
+		beyondCount = XMVectorAdd(beyondCount, XMVectorAndInt(XMVectorGreater(minF, zero), one));
+	}
+
+	uint32_t reached = static_cast<uint32_t>(HorizontalSum(reachedCount));
+	uint32_t beyond = static_cast<uint32_t>(HorizontalSum(beyondCount));
+	if (reached == 0) return false;
+	first = beyond > 0 ? beyond - 1 : 0;
+	last = min(reached - 1, tileCount - 1);
+	return first <= last;
+}
+} // namespace Lunar
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace Lunar
+{
+// Point or spot light as seen by the binner; directional lights are not binned
+struct ClusterLight
+{
+	DirectX::XMFLOAT3 position;
+	float             range;			// FalloffEnd; lights without range are skipped, keeping the indices of the rest
+	DirectX::XMFLOAT3 direction;
+	float             cosHalfAngle;		// -1 for point lights
+};
+
+// Matches uint2 { offset, count } in the shader-side cluster grid
+struct ClusterRange
+{
+	uint32_t offset;
+	uint32_t count;
+};
+
+struct ClusterGridDesc
+{
+	uint32_t tilesX = 16;
+	uint32_t tilesY = 9;
+	uint32_t slices = 24;
+	float    fovAngleY;			// radians
+	float    aspectRatio;
+	float    nearZ;
+	float    farZ;
+};
+
+// Assigns lights to view-frustum clusters (froxels) for clustered forward shading.
+// Tiles split the screen evenly, slices split view depth exponentially, and the result is a
+// flat light index list with one (offset, count) range per cluster.
+class ClusteredLightBinner
+{
+public:
+	void Initialize(const ClusterGridDesc& desc);
+
+	// view is row-major, not transposed; binning runs in parallel over depth slices
+	void Bin(const std::vector<ClusterLight>& lights, const DirectX::XMFLOAT4X4& view);
+
+	// Clusters are laid out x-fastest, then y (top row first), then slice
+	uint32_t GetClusterIndex(uint32_t x, uint32_t y, uint32_t slice) const { return (slice * m_desc.tilesY + y) * m_desc.tilesX + x; }
+	uint32_t GetClusterCount() const { return m_desc.tilesX * m_desc.tilesY * m_desc.slices; }
+	// slice = floor(log(viewZ) * scale + bias), the same mapping the shader uses
+	DirectX::XMFLOAT2 GetSliceScaleBias() const;
+	uint32_t GetSlice(float viewZ) const;
+
+	const ClusterGridDesc& GetDesc() const { return m_desc; }
+	const std::vector<ClusterRange>& GetClusters() const { return m_clusters; }
+	const std::vector<uint32_t>& GetLightIndices() const { return m_lightIndices; }
+
+	// Half angle at which pow(cos, spotPower) drops below the visible threshold
+	static float ComputeSpotCosHalfAngle(float spotPower);
+
+private:
+	// Light in view space with a bounding sphere and the slices it touches
+	struct ViewLight
+	{
+		DirectX::XMFLOAT4 boundingSphere;	// center, radius
+		DirectX::XMFLOAT3 apex;
+		float             range;
+		DirectX::XMFLOAT3 direction;
+		float             cosHalfAngle;
+		float             sinHalfAngle;
+		uint32_t          firstSlice;
+		uint32_t          lastSlice;		// firstSlice > lastSlice when outside the depth range
+	};
+
+	struct SliceBin
+	{
+		std::vector<uint64_t> hits;			// (cluster in slice << 32) | light index
+		std::vector<uint32_t> lightIndices;	// hits sorted by cluster
+		std::vector<float>    froxelSpheres;	// SoA x, y, z, radius; each row padded to a multiple of 4
+	};
+
+	void BinSlice(uint32_t slice);
+	void BuildFroxelSpheres(uint32_t slice, std::vector<float>& spheres) const;
+	// Inclusive tile range along one axis covered by a disk of the given radius swept over [zMin, zMax]
+	bool ComputeTileRange(
+		const std::vector<float>& boundaries,
+		float center, float radius, float zMin, float zMax,
+		uint32_t tileCount, uint32_t& first, uint32_t& last) const;
+
+	ClusterGridDesc m_desc = {};
+	uint32_t        m_paddedTilesX = 0;
+	// tangents of the tile boundary planes, padded to a multiple of 4 with FLT_MAX
+	std::vector<float> m_boundariesX;		// left to right
+	std::vector<float> m_boundariesY;		// bottom to top
+	std::vector<float> m_sliceDepths;		// slices + 1 view depths
+
+	std::vector<ViewLight>    m_viewLights;
+	std::vector<SliceBin>     m_sliceBins;
+	std::vector<ClusterRange> m_clusters;
+	std::vector<uint32_t>     m_lightIndices;
+};
+} // namespace Lunar
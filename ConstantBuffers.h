@@ -17,9 +17,19 @@ struct BasicConstants
 	DirectX::XMFLOAT3   eyePos;
     uint32_t debugFlags;  // Debug mode flags
     DirectX::XMFLOAT4   ambientLight;
-	LightData lights[Lunar::LunarConstants::LIGHT_COUNT];
-	DirectX::XMFLOAT4X4 shadowTransform;
-
+	uint32_t lightCount;	// lights live in a structured buffer
+	uint32_t lightPadding[3];
+	DirectX::XMFLOAT4X4 shadowTransforms[LunarConstants::MAX_SHADOW_CASCADES];	// world to shadow atlas texture space
+	DirectX::XMFLOAT4   cascadeSplits;	// view depth at which each cascade ends
+	uint32_t cascadeCount;
+	uint32_t cascadePadding[3];
+	DirectX::XMFLOAT4   irradianceSH[9];	// diffuse IBL as cosine-convolved L2 SH, rgb
+	float    environmentBlend;	// weight of skybox_next during an environment switch
+	uint32_t environmentPadding[3];
+	uint32_t clusterDimensions[3];	// tiles across, tiles down and depth slices, see ClusteredLightBinner
+	uint32_t directionalLightCount;	// lights at the head of the cluster light index list, lighting every cluster
+	DirectX::XMFLOAT2   clusterSliceScaleBias;	// slice = floor(log(viewZ) * scale + bias)
+	float    clusterPadding[2];
 };
 
 // Root Parameter CBV 2
@@ -44,6 +54,27 @@ struct MaterialConstants
     float ao;                           // Ambient occlusion
 };
 
+// Root constants b3, ParticleConstants in ParticleCommon.hlsl
+struct ParticleConstants
+{
+	DirectX::XMFLOAT3 emitterPosition;
+	uint32_t spawnCount;
+	uint32_t seed;
+	uint32_t aliveListIndex;	// alive list the update reads, and the one drawn after the flip
+	uint32_t capacity;
+	float    deltaTime;
+	uint32_t substepCount;
+	uint32_t integrator;		// ParticleIntegrator
+	uint32_t sortBlockSize;		// bitonic sort step, set per dispatch
+	uint32_t sortStepSize;
+	DirectX::XMFLOAT4 viewDepth;	// third column of the view matrix
+	uint32_t planeColliderCount;	// ParticleColliders
+	uint32_t sphereColliderCount;
+	float    restitution;
+	float    friction;
+	float    particleRadius;
+};
+
 class ConstantBuffer
 {
 public:
@@ -51,6 +82,7 @@ public:
 	~ConstantBuffer();
 	void CopyData(void* data, UINT size);
 	ID3D12Resource* GetResource() const { return m_constantBuffer.Get(); }
+	void* GetMappedData() const { return m_mappedData; }
 private:
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_constantBuffer;
 	BYTE* m_mappedData = nullptr;
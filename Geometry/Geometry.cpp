@@ -1,9 +1,13 @@
 #include "Geometry.h"
+#include "LODSelector.h"
+#include "MeshSimplifier.h"
+#include "TangentGenerator.h"
 #include "../Utils/Utils.h" 
 #include "../Utils/Logger.h"
 
 using namespace DirectX;
 using namespace std;
+using namespace Microsoft::WRL;
 
 namespace Lunar
 {
@@ -17,11 +21,114 @@ void Geometry::Initialize(ID3D12Device* device)
 {
 	LOG_FUNCTION_ENTRY();
     CreateGeometry();  
+	if (!m_vertices.empty())
+	{
+		BoundingBox::CreateFromPoints(m_localBoundingBox, m_vertices.size(), &m_vertices[0].pos, sizeof(Vertex));
+	}
+	if (m_meshletCulling) BuildMeshlets();
+	BuildLODChain();
     CreateBuffers(device); 
     m_objectCB = std::make_unique<ConstantBuffer>(device, sizeof(ObjectConstants));
 }
 
 void Geometry::Draw(ID3D12GraphicsCommandList* commandList)
+{
+	// nothing was created, e.g. a mesh whose file failed to load
+	if (m_lods.empty()) return;
+
+    BindForDraw(commandList);
+	if (m_meshletCulling && m_currentLOD == 0)
+	{
+		for (const auto& [startIndex, indexCount] : m_drawRanges)
+		{
+			commandList->DrawIndexedInstanced(indexCount, 1, startIndex, 0, 0);
+		}
+		return;
+	}
+	const GeometryLOD& lod = m_lods[m_currentLOD];
+    commandList->DrawIndexedInstanced(lod.indexCount, 1, lod.startIndex, lod.baseVertex, 0);
+}
+
+void Geometry::DrawShadow(ID3D12GraphicsCommandList* commandList)
+{
+	if (m_lods.empty()) return;
+
+	// meshlets culled for the camera may still cast shadows
+	if (!m_meshletCulling || m_currentLOD != 0)
+	{
+		Draw(commandList);
+		return;
+	}
+	BindForDraw(commandList);
+	commandList->DrawIndexedInstanced(m_lods[0].indexCount, 1, 0, 0, 0);
+}
+
+void Geometry::DrawInstance(ID3D12GraphicsCommandList* commandList, D3D12_GPU_VIRTUAL_ADDRESS objectConstants)
+{
+	// the instance is placed by the caller's constants, so the camera-driven meshlet ranges do not apply
+	m_objectConstantsOverride = objectConstants;
+	DrawShadow(commandList);
+	m_objectConstantsOverride = 0;
+}
+
+BoundingBox Geometry::GetWorldBounds() const
+{
+	// m_objectConstants.World is stored transposed
+	BoundingBox worldBounds;
+	m_localBoundingBox.Transform(worldBounds, XMMatrixTranspose(XMLoadFloat4x4(&m_objectConstants.World)));
+	return worldBounds;
+}
+
+void Geometry::UpdateLOD(const ViewInfo& viewInfo)
+{
+	if (m_lods.empty()) return;
+
+	// m_objectConstants.World is stored transposed
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&m_objectConstants.World));
+	if (m_lods.size() > 1)
+	{
+		BoundingSphere worldBounds;
+		m_localBounds.Transform(worldBounds, world);
+		float coverage = LODSelector::ComputeScreenCoverage(worldBounds, viewInfo.eyePos, viewInfo.projection);
+		m_currentLOD = LODSelector::SelectLevel(coverage, m_lodThresholds, m_currentLOD, LOD_HYSTERESIS);
+	}
+
+	m_submittedIndexCount = m_lods[m_currentLOD].indexCount;
+	if (!m_meshletCulling || m_currentLOD != 0) return;
+
+	// meshlets cover LOD0 only and are culled in local space
+	XMMATRIX invWorld = XMMatrixInverse(nullptr, world);
+	XMMATRIX invView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&viewInfo.view));
+
+	XMFLOAT3 eyePos;
+	XMStoreFloat3(&eyePos, XMVector3TransformCoord(XMLoadFloat3(&viewInfo.eyePos), invWorld));
+	BoundingFrustum frustum(XMLoadFloat4x4(&viewInfo.projection));
+	frustum.Transform(frustum, invView * invWorld);
+
+	vector<uint32_t> visibleMeshlets;
+	MeshletBuilder::Cull(m_meshletData, &frustum, eyePos, visibleMeshlets);
+
+	// adjacent meshlets are adjacent in the index buffer, so consecutive survivors share one draw
+	m_drawRanges.clear();
+	m_submittedIndexCount = 0;
+	for (uint32_t meshletIndex : visibleMeshlets)
+	{
+		const Meshlet& meshlet = m_meshletData.meshlets[meshletIndex];
+		UINT startIndex = meshlet.triangleOffset * 3;
+		UINT indexCount = meshlet.triangleCount * 3;
+		if (!m_drawRanges.empty() && m_drawRanges.back().first + m_drawRanges.back().second == startIndex)
+		{
+			m_drawRanges.back().second += indexCount;
+		}
+		else
+		{
+			m_drawRanges.emplace_back(startIndex, indexCount);
+		}
+		m_submittedIndexCount += indexCount;
+	}
+}
+
+void Geometry::BindForDraw(ID3D12GraphicsCommandList* commandList)
 {
     if (m_needsConstantBufferUpdate)
     {
@@ -32,7 +139,83 @@ void Geometry::Draw(ID3D12GraphicsCommandList* commandList)
     commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
     commandList->IASetIndexBuffer(&m_indexBufferView);
     commandList->IASetPrimitiveTopology(m_topologyType);
-    commandList->DrawIndexedInstanced(static_cast<UINT>(m_indices.size()), 1, 0, 0, 0);
+}
+
+void Geometry::BuildMeshlets()
+{
+	m_meshletData = MeshletBuilder::Build(m_vertices, m_indices);
+
+	// reorder the index buffer so every meshlet is one contiguous range
+	vector<uint32_t> meshletIndices = MeshletBuilder::BuildIndexBuffer(m_meshletData);
+	for (size_t i = 0; i < meshletIndices.size(); ++i)
+	{
+		m_indices[i] = static_cast<uint16_t>(meshletIndices[i]);
+	}
+
+	m_drawRanges = { { 0u, static_cast<UINT>(m_indices.size()) } };
+	m_submittedIndexCount = static_cast<UINT>(m_indices.size());
+	LOG_DEBUG("Meshlets: ", m_meshletData.meshlets.size(), " clusters for ", m_indices.size() / 3, " triangles");
+}
+
+void Geometry::SetLODChain(uint32_t levelCount, float lod0Coverage)
+{
+	m_lodLevelCount = max(levelCount, 1u);
+	m_lod0Coverage = lod0Coverage;
+}
+
+void Geometry::BuildLODChain()
+{
+	m_lods = { { 0u, static_cast<UINT>(m_vertices.size()), 0u, static_cast<UINT>(m_indices.size()) } };
+	m_lodThresholds.clear();
+	m_currentLOD = 0;
+	m_submittedIndexCount = static_cast<UINT>(m_indices.size());
+	if (m_lodLevelCount <= 1 || m_vertices.empty() || m_indices.empty()) return;
+
+	BoundingSphere::CreateFromPoints(m_localBounds, m_vertices.size(), &m_vertices[0].pos, sizeof(Vertex));
+
+	// later levels are appended to the same arrays, so work from a copy of LOD0
+	const vector<Vertex> baseVertices = m_vertices;
+	const vector<uint16_t> baseIndices = m_indices;
+	LOG_DEBUG("LOD 0: ", baseIndices.size() / 3, " triangles, ", baseVertices.size(), " vertices");
+
+	float threshold = m_lod0Coverage;
+	for (uint32_t lodIndex = 1; lodIndex < m_lodLevelCount; ++lodIndex)
+	{
+		vector<Vertex> lodVertices;
+		vector<uint16_t> lodIndices;
+		if (!CreateLODGeometry(lodIndex, baseVertices, baseIndices, lodVertices, lodIndices) ||
+			lodIndices.empty() || lodIndices.size() >= m_lods.back().indexCount)
+		{
+			LOG_DEBUG("LOD chain stops at ", m_lods.size(), " levels");
+			break;
+		}
+
+		GeometryLOD lod;
+		lod.baseVertex = static_cast<UINT>(m_vertices.size());
+		lod.vertexCount = static_cast<UINT>(lodVertices.size());
+		lod.startIndex = static_cast<UINT>(m_indices.size());
+		lod.indexCount = static_cast<UINT>(lodIndices.size());
+		m_vertices.insert(m_vertices.end(), lodVertices.begin(), lodVertices.end());
+		m_indices.insert(m_indices.end(), lodIndices.begin(), lodIndices.end());
+		m_lods.push_back(lod);
+
+		m_lodThresholds.push_back(threshold);
+		threshold *= 0.5f;
+		LOG_DEBUG("LOD ", lodIndex, ": ", lod.indexCount / 3, " triangles, ", lod.vertexCount, " vertices");
+	}
+}
+
+bool Geometry::CreateLODGeometry(
+	uint32_t                lodIndex,
+	const vector<Vertex>&   baseVertices,
+	const vector<uint16_t>& baseIndices,
+	vector<Vertex>&         outVertices,
+	vector<uint16_t>&       outIndices)
+{
+	// halving the screen size quarters the covered pixels, so each level keeps a quarter of the triangles
+	size_t targetTriangleCount = (baseIndices.size() / 3) >> (2 * lodIndex);
+	if (targetTriangleCount == 0) return false;
+	return MeshSimplifier::Simplify(baseVertices, baseIndices, targetTriangleCount, outVertices, outIndices);
 }
 
 void Geometry::DrawNormals(ID3D12GraphicsCommandList* commandList)
@@ -45,13 +228,15 @@ void Geometry::DrawNormals(ID3D12GraphicsCommandList* commandList)
 	BindObjectConstants(commandList);
 	commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
 	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
-	commandList->DrawInstanced(static_cast<UINT>(m_vertices.size()), 1, 0, 0);
+	UINT vertexCount = m_lods.empty() ? static_cast<UINT>(m_vertices.size()) : m_lods[0].vertexCount;
+	commandList->DrawInstanced(vertexCount, 1, 0, 0);
 }
 
 void Geometry::SetWorldMatrix(DirectX::XMFLOAT4X4 worldMatrix)
 {
 	m_objectConstants.World = worldMatrix;
 	m_needsConstantBufferUpdate = true;
+	++m_objectConstantsVersion;
 }
 
 void Geometry::SetTransform(const Transform& transform)
@@ -59,6 +244,7 @@ void Geometry::SetTransform(const Transform& transform)
     m_transform = transform;
     UpdateWorldMatrix();
     m_needsConstantBufferUpdate = true;
+    ++m_objectConstantsVersion;
 }
 
 void Geometry::SetLocation(const XMFLOAT3& location)
@@ -66,6 +252,7 @@ void Geometry::SetLocation(const XMFLOAT3& location)
     m_transform.Location = location;
     UpdateWorldMatrix();
     m_needsConstantBufferUpdate = true;
+    ++m_objectConstantsVersion;
 }
 
 void Geometry::SetRotation(const XMFLOAT3& rotation)
@@ -73,6 +260,7 @@ void Geometry::SetRotation(const XMFLOAT3& rotation)
     m_transform.Rotation = rotation;
     UpdateWorldMatrix();
     m_needsConstantBufferUpdate = true;
+    ++m_objectConstantsVersion;
 }
 
 void Geometry::SetScale(const XMFLOAT3& scale)
@@ -80,6 +268,7 @@ void Geometry::SetScale(const XMFLOAT3& scale)
     m_transform.Scale = scale;
     UpdateWorldMatrix();
     m_needsConstantBufferUpdate = true;
+    ++m_objectConstantsVersion;
 }
 
 void Geometry::SetColor(const XMFLOAT4& color)
@@ -94,6 +283,7 @@ void Geometry::SetTextureIndex(int index)
 {
 	m_objectConstants.textureIndex = index;
 	m_needsConstantBufferUpdate = true;
+	++m_objectConstantsVersion;
 }
 
 void Geometry::SetMaterialName(const std::string& materialName)
@@ -111,19 +301,33 @@ void Geometry::UpdateWorldMatrix()
     XMStoreFloat4x4(&m_objectConstants.World, XMMatrixTranspose(world));
 }
 
-void Geometry::UpdateObjectConstants()
+XMFLOAT4X4 Geometry::ComputeWorldInvTranspose(const XMFLOAT4X4& world)
 {
-    XMMATRIX worldMatrix = XMLoadFloat4x4(&m_objectConstants.World);
+    XMMATRIX worldMatrix = XMLoadFloat4x4(&world);
 	worldMatrix.r[3] = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
 	XMMATRIX worldInv = XMMatrixInverse(nullptr, worldMatrix);
 	XMMATRIX worldInvTranspose = XMMatrixTranspose(worldInv);
-	XMStoreFloat4x4(&m_objectConstants.WorldInvTranspose, XMMatrixTranspose(worldInvTranspose));
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, XMMatrixTranspose(worldInvTranspose));
+	return result;
+}
+
+void Geometry::UpdateObjectConstants()
+{
+	m_objectConstants.WorldInvTranspose = ComputeWorldInvTranspose(m_objectConstants.World);
     m_objectCB->CopyData(&m_objectConstants, sizeof(ObjectConstants));
     m_needsConstantBufferUpdate = false;
 }
 
 void Geometry::BindObjectConstants(ID3D12GraphicsCommandList* commandList)
 {
+	if (m_objectConstantsOverride != 0)
+	{
+		commandList->SetGraphicsRootConstantBufferView(
+			Lunar::LunarConstants::OBJECT_CONSTANTS_ROOT_PARAMETER_INDEX,
+			m_objectConstantsOverride);
+		return;
+	}
     if (m_objectCB)
     {
         commandList->SetGraphicsRootConstantBufferView(
@@ -134,59 +338,12 @@ void Geometry::BindObjectConstants(ID3D12GraphicsCommandList* commandList)
 
 void Geometry::ComputeTangents()
 {
-	auto outVerts = m_vertices;
-	vector<XMFLOAT3> tanAccum(outVerts.size(), {0.0f, 0.0f, 0.0f});
-	for (size_t i = 0; i < m_indices.size(); i += 3)
-	{
-		uint16_t index0 = m_indices[i];
-		uint16_t index1 = m_indices[i + 1];
-		uint16_t index2 = m_indices[i + 2];
-
-		XMVECTOR pos0 = XMLoadFloat3(&outVerts[index0].pos);
-		XMVECTOR pos1 = XMLoadFloat3(&outVerts[index1].pos);
-		XMVECTOR pos2 = XMLoadFloat3(&outVerts[index2].pos);
-
-		XMVECTOR uv0 = XMLoadFloat2(&outVerts[index0].texCoord);
-		XMVECTOR uv1 = XMLoadFloat2(&outVerts[index1].texCoord);
-		XMVECTOR uv2 = XMLoadFloat2(&outVerts[index2].texCoord);
-
-		XMVECTOR deltaPos1 = pos1 - pos0;
-		XMVECTOR deltaPos2 = pos2 - pos0;
-
-		float deltaU1 = XMVectorGetX(uv1) - XMVectorGetX(uv0);
-		float deltaU2 = XMVectorGetX(uv2) - XMVectorGetX(uv0);
-		float deltaV1 = XMVectorGetY(uv1) - XMVectorGetY(uv0);
-		float deltaV2 = XMVectorGetY(uv2) - XMVectorGetY(uv0);
-
-		float det = deltaU1 * deltaV2 - deltaU2 * deltaV1;
-		if (abs(det) < 1e-6) continue;
-		float r = 1.0f / det;
-		
-		XMVECTOR tangent = (deltaPos1 * deltaV2 - deltaPos2 * deltaV1) * r;
-
-		for (uint16_t idx : {index0, index1, index2})
-		{
-			XMVECTOR accum = XMLoadFloat3(&tanAccum[idx]) + tangent;
-			XMStoreFloat3(&tanAccum[idx], accum);
-		}
-	}
-
-	for (size_t i = 0; i < outVerts.size(); ++i)
-	{
-		XMVECTOR n = XMLoadFloat3(&outVerts[i].normal);
-		XMVECTOR t = XMLoadFloat3(&tanAccum[i]);
-
-		t = XMVector3Normalize(t - n * XMVector3Dot(n, t));
-		XMStoreFloat3(&outVerts[i].tangentU, t);
-	}
-
-	m_vertices = move(outVerts);
+	bool parallel = m_indices.size() / 3 >= TangentGenerator::PARALLEL_TRIANGLE_THRESHOLD;
+	TangentGenerator::Generate(m_vertices, m_indices, parallel);
 }
 
-void Geometry::CreateBuffers(ID3D12Device* device)
+ComPtr<ID3D12Resource> Geometry::CreateUploadBuffer(ID3D12Device* device, const void* data, UINT byteSize)
 {
-	const UINT vbByteSize = static_cast<UINT>(m_vertices.size() * sizeof(Vertex));
-
 	/*
 	typedef struct D3D12_HEAP_PROPERTIES
 	{
@@ -219,33 +376,43 @@ void Geometry::CreateBuffers(ID3D12Device* device)
 		D3D12_RESOURCE_FLAGS Flags;
 	} 	D3D12_RESOURCE_DESC;
 	*/
-	D3D12_RESOURCE_DESC vbDesc = {};
-	vbDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	vbDesc.Alignment = 0;
-	vbDesc.Width = vbByteSize;
-	vbDesc.Height = 1;
-	vbDesc.DepthOrArraySize = 1;
-	vbDesc.MipLevels = 1;
-	vbDesc.Format = DXGI_FORMAT_UNKNOWN;
-	vbDesc.SampleDesc.Count = 1;
-	vbDesc.SampleDesc.Quality = 0;
-	vbDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-	vbDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-
+	D3D12_RESOURCE_DESC bufferDesc = {};
+	bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	bufferDesc.Alignment = 0;
+	bufferDesc.Width = byteSize;
+	bufferDesc.Height = 1;
+	bufferDesc.DepthOrArraySize = 1;
+	bufferDesc.MipLevels = 1;
+	bufferDesc.Format = DXGI_FORMAT_UNKNOWN;
+	bufferDesc.SampleDesc.Count = 1;
+	bufferDesc.SampleDesc.Quality = 0;
+	bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	bufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	ComPtr<ID3D12Resource> buffer;
 	THROW_IF_FAILED(device->CreateCommittedResource(
 		&heapProperties,
 		D3D12_HEAP_FLAG_NONE,
-		&vbDesc,
+		&bufferDesc,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		nullptr,
-		IID_PPV_ARGS(m_vertexBuffer.GetAddressOf())
+		IID_PPV_ARGS(buffer.GetAddressOf())
 		))
 
-	// copy vertex data
-	UINT8* pVertexDataBegin = nullptr;
-	m_vertexBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pVertexDataBegin));
-	memcpy(pVertexDataBegin, m_vertices.data(), vbByteSize);
-	m_vertexBuffer->Unmap(0, nullptr);
+	UINT8* pDataBegin = nullptr;
+	buffer->Map(0, nullptr, reinterpret_cast<void**>(&pDataBegin));
+	memcpy(pDataBegin, data, byteSize);
+	buffer->Unmap(0, nullptr);
+
+	return buffer;
+}
+
+void Geometry::CreateBuffers(ID3D12Device* device)
+{
+	const UINT vertexStride = VertexFormatUtils::GetStride(m_vertexFormat);
+	const UINT vbByteSize = static_cast<UINT>(m_vertices.size() * vertexStride);
+	vector<uint8_t> vertexData = VertexFormatUtils::PackVertices(m_vertices, m_vertexFormat);
+	m_vertexBuffer = CreateUploadBuffer(device, vertexData.data(), vbByteSize);
 	
 	/*
 	typedef struct D3D12_VERTEX_BUFFER_VIEW
@@ -256,36 +423,16 @@ void Geometry::CreateBuffers(ID3D12Device* device)
 	} 	D3D12_VERTEX_BUFFER_VIEW;
 	*/
 	m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
-	m_vertexBufferView.StrideInBytes = sizeof(Vertex);
+	m_vertexBufferView.StrideInBytes = vertexStride;
 	m_vertexBufferView.SizeInBytes = vbByteSize;
 
+	LOG_DEBUG("Vertex buffer: ", m_vertices.size(), " vertices x ", vertexStride, " bytes = ", vbByteSize,
+		" bytes (", VertexFormatUtils::GetInputLayoutName(m_vertexFormat), ", default layout would be ", m_vertices.size() * sizeof(Vertex), " bytes)");
+
 	if (m_indices.empty()) return;
 	
 	const UINT ibByteSize = static_cast<UINT>(m_indices.size() * sizeof(uint16_t));
-	D3D12_RESOURCE_DESC ibDesc = {};
-	ibDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-	ibDesc.Width = ibByteSize;
-	ibDesc.Height = 1;
-	ibDesc.DepthOrArraySize = 1;
-	ibDesc.MipLevels = 1;
-	ibDesc.Format = DXGI_FORMAT_UNKNOWN;
-	ibDesc.SampleDesc.Count = 1;
-	ibDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-
-	THROW_IF_FAILED(device->CreateCommittedResource(
-		&heapProperties,
-		D3D12_HEAP_FLAG_NONE,
-		&ibDesc,
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(m_indexBuffer.GetAddressOf())
-		))
-
-	// copy index data
-	BYTE* pIndexDataBegin = nullptr;
-	m_indexBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pIndexDataBegin));
-	memcpy(pIndexDataBegin, m_indices.data(), ibByteSize);
-	m_indexBuffer->Unmap(0, nullptr);
+	m_indexBuffer = CreateUploadBuffer(device, m_indices.data(), ibByteSize);
 
 	/*
 	typedef struct D3D12_INDEX_BUFFER_VIEW
@@ -300,4 +447,4 @@ void Geometry::CreateBuffers(ID3D12Device* device)
 	m_indexBufferView.SizeInBytes = ibByteSize;
 }
 
-} // namespace Lunar
+} // namespace Lunar
\ No newline at end of file
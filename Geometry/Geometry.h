@@ -6,14 +6,33 @@
 #include <string>
 #include <wrl/client.h>
 
+#include "MeshletBuilder.h"
 #include "Transform.h"
 #include "Vertex.h"
+#include "VertexFormat.h"
 #include "../ConstantBuffers.h"
 
 struct ObjectConstants;
 
 namespace Lunar
 {
+// Per-frame camera data for geometries that choose their own level of detail
+struct ViewInfo
+{
+	DirectX::XMFLOAT3   eyePos;
+	DirectX::XMFLOAT4X4 view;			// row-major, not transposed
+	DirectX::XMFLOAT4X4 projection;		// row-major, not transposed
+};
+
+// One level of a discrete LOD chain; every level lives in the shared vertex and index buffers
+struct GeometryLOD
+{
+	UINT baseVertex;
+	UINT vertexCount;
+	UINT startIndex;
+	UINT indexCount;
+};
+
 class Geometry
 {
 public:
@@ -25,6 +44,10 @@ public:
     virtual void Initialize(ID3D12Device* device);
     virtual void Draw(ID3D12GraphicsCommandList* commandList);
 	virtual void DrawNormals(ID3D12GraphicsCommandList* commandList);
+	virtual void DrawShadow(ID3D12GraphicsCommandList* commandList);
+	virtual void UpdateLOD(const ViewInfo& viewInfo);
+	// Draws the full geometry with another object constant buffer, sharing this geometry's vertex and index buffers
+	void DrawInstance(ID3D12GraphicsCommandList* commandList, D3D12_GPU_VIRTUAL_ADDRESS objectConstants);
 
 	void SetWorldMatrix(DirectX::XMFLOAT4X4 worldMatrix);
     void SetTransform(const Transform& transform);
@@ -35,16 +58,34 @@ public:
 	void SetTextureIndex(int index);
     void SetMaterialName(const std::string& materialName);
 	void SetTopologyType(D3D_PRIMITIVE_TOPOLOGY topologyType) { m_topologyType = topologyType; }
+	void SetVertexFormat(VertexFormat vertexFormat) { m_vertexFormat = vertexFormat; } // must be called before Initialize
+	void SetMeshletCulling(bool enabled) { m_meshletCulling = enabled; } // must be called before Initialize
+	void SetLODChain(uint32_t levelCount, float lod0Coverage = 0.5f); // must be called before Initialize
     
     DirectX::XMFLOAT4X4 GetWorldMatrix() { return m_objectConstants.World; }
+	const ObjectConstants& GetObjectConstants() const { return m_objectConstants; }
+	uint32_t GetObjectConstantsVersion() const { return m_objectConstantsVersion; } // bumped on every transform or texture change
     const Transform& GetTransform() const { return m_transform; }
     const DirectX::XMFLOAT3& GetLocation() const { return m_transform.Location; }
     const DirectX::XMFLOAT3& GetRotation() const { return m_transform.Rotation; }
     const DirectX::XMFLOAT3& GetScale() const { return m_transform.Scale; }
     const std::string& GetMaterialName() const { return m_materialName; }
+	VertexFormat GetVertexFormat() const { return m_vertexFormat; }
+	D3D_PRIMITIVE_TOPOLOGY GetTopologyType() const { return m_topologyType; }
+	UINT GetVertexBufferByteSize() const { return m_vertexBufferView.SizeInBytes; }
+	D3D12_GPU_VIRTUAL_ADDRESS GetVertexBufferAddress() const { return m_vertexBufferView.BufferLocation; }
+	UINT GetIndexBufferByteSize() const { return m_indexBufferView.SizeInBytes; }
+	const MeshletData& GetMeshletData() const { return m_meshletData; }
+	UINT GetSubmittedTriangleCount() const { return m_submittedIndexCount / 3; }
+	const std::vector<GeometryLOD>& GetLODs() const { return m_lods; }
+	uint32_t GetCurrentLOD() const { return m_currentLOD; }
+	const DirectX::BoundingBox& GetLocalBoundingBox() const { return m_localBoundingBox; }
+	DirectX::BoundingBox GetWorldBounds() const;
     
     void UpdateObjectConstants();
     void BindObjectConstants(ID3D12GraphicsCommandList* commandList);
+	// Both matrices are stored transposed, as in ObjectConstants
+	static DirectX::XMFLOAT4X4 ComputeWorldInvTranspose(const DirectX::XMFLOAT4X4& world);
 	void ComputeTangents();
     
 protected:
@@ -62,11 +103,40 @@ protected:
     D3D12_INDEX_BUFFER_VIEW m_indexBufferView = {};
     
     bool m_needsConstantBufferUpdate = true;
+	uint32_t m_objectConstantsVersion = 0;
+	D3D12_GPU_VIRTUAL_ADDRESS m_objectConstantsOverride = 0;
 
     std::string m_materialName = "default";
 	D3D_PRIMITIVE_TOPOLOGY m_topologyType = D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+	VertexFormat m_vertexFormat = VertexFormat::Default;
+
+	bool m_meshletCulling = false;
+	MeshletData m_meshletData;
+	std::vector<std::pair<UINT, UINT>> m_drawRanges;	// (start index, index count) of visible meshlet runs
+	UINT m_submittedIndexCount = 0;
+
+	// each level hands over to the next once the screen coverage halves
+	static constexpr float LOD_HYSTERESIS = 0.1f;
+	uint32_t m_lodLevelCount = 1;
+	float m_lod0Coverage = 0.5f;
+	std::vector<GeometryLOD> m_lods;
+	std::vector<float> m_lodThresholds;
+	uint32_t m_currentLOD = 0;
+	DirectX::BoundingSphere m_localBounds;
+	DirectX::BoundingBox m_localBoundingBox;
     
     void UpdateWorldMatrix();
+	void BuildMeshlets();
+	void BuildLODChain();
+	// Fills a reduced copy of LOD0 for the given level; returns false when no coarser level exists
+	virtual bool CreateLODGeometry(
+		uint32_t lodIndex,
+		const std::vector<Vertex>& baseVertices,
+		const std::vector<uint16_t>& baseIndices,
+		std::vector<Vertex>& outVertices,
+		std::vector<uint16_t>& outIndices);
+	void BindForDraw(ID3D12GraphicsCommandList* commandList);
     void CreateBuffers(ID3D12Device* device);
+	static Microsoft::WRL::ComPtr<ID3D12Resource> CreateUploadBuffer(ID3D12Device* device, const void* data, UINT byteSize);
 };
 }
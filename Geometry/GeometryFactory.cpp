@@ -5,6 +5,8 @@
 #include <algorithm>
 #include <cctype>
 
+#include "Mesh.h"
+#include "Terrain.h"
 #include "Tree.h"
 
 namespace Lunar
@@ -29,6 +31,18 @@ std::unique_ptr<Geometry> GeometryFactory::CreateTree()
 	return std::make_unique<Tree>();
 }
 
+std::unique_ptr<Geometry> GeometryFactory::CreateTerrain()
+{
+	return std::make_unique<Terrain>();
+}
+
+std::unique_ptr<Geometry> GeometryFactory::CreateMesh(const std::string& filePath)
+{
+	auto mesh = std::make_unique<Mesh>();
+	mesh->SetFilePath(filePath);
+	return mesh;
+}
+
 std::unique_ptr<Geometry> GeometryFactory::CreateGeometry(GeometryType type)
 {
     switch (type)
@@ -39,6 +53,10 @@ std::unique_ptr<Geometry> GeometryFactory::CreateGeometry(GeometryType type)
             return CreateSphere();
         case GeometryType::Plane:
             return CreatePlane();
+        case GeometryType::Terrain:
+            return CreateTerrain();
+        case GeometryType::Mesh:
+            return CreateMesh();
         default:
             return CreateCube(); 
     }
@@ -64,6 +82,17 @@ std::unique_ptr<Geometry> GeometryFactory::CloneGeometry(const Geometry* origina
 	{
 		return CreatePlane();
 	}
+	else if (auto terrain = dynamic_cast<const Terrain*>(original))
+	{
+		auto clone = std::make_unique<Terrain>();
+		clone->SetHeightfield(terrain->GetHeightfield());
+		clone->SetSettings(terrain->GetQuadTree().GetSettings());
+		return clone;
+	}
+	else if (auto mesh = dynamic_cast<const Mesh*>(original))
+	{
+		return CreateMesh(mesh->GetFilePath());
+	}
 	return nullptr;
 }
 
@@ -77,6 +106,10 @@ std::string GeometryFactory::GeometryTypeToString(GeometryType type)
             return "Sphere";
         case GeometryType::Plane:
             return "Plane";
+        case GeometryType::Terrain:
+            return "Terrain";
+        case GeometryType::Mesh:
+            return "Mesh";
         default:
             return "Unknown";
     }
@@ -96,6 +129,10 @@ GeometryType GeometryFactory::StringToGeometryType(const std::string& typeName)
         return GeometryType::Plane;
     else if (lowerTypeName == "tree")
         return GeometryType::Tree;
+    else if (lowerTypeName == "terrain")
+        return GeometryType::Terrain;
+    else if (lowerTypeName == "mesh")
+        return GeometryType::Mesh;
     else
         return GeometryType::Cube; 
 }
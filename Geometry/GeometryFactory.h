@@ -10,7 +10,9 @@ enum class GeometryType : int8_t
     Cube,
     Sphere,
 	Plane,
-	Tree
+	Tree,
+	Terrain,
+	Mesh
 };
 
 class GeometryFactory
@@ -20,6 +22,8 @@ public:
     static std::unique_ptr<Geometry> CreatePlane(int widthSegments = 1, int heightSegments = 1);
     static std::unique_ptr<Geometry> CreateSphere();
 	static std::unique_ptr<Geometry> CreateTree();
+	static std::unique_ptr<Geometry> CreateTerrain();
+	static std::unique_ptr<Geometry> CreateMesh(const std::string& filePath = "");
     
     static std::unique_ptr<Geometry> CreateGeometry(GeometryType type);
     
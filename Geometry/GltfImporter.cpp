@@ -0,0 +1,702 @@
+#include "GltfImporter.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "TangentGenerator.h"
+#include "../Utils/JsonValue.h"
+#include "../Utils/Logger.h"
+#include "../Utils/MappedFile.h"
+#include "../Utils/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+constexpr uint32_t GLB_MAGIC = 0x46546C67;			// "glTF"
+constexpr uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+constexpr uint32_t GLB_CHUNK_BIN = 0x004E4942;
+constexpr int      MODE_TRIANGLES = 4;
+constexpr size_t   PARALLEL_VERTEX_CHUNK = 16384;
+constexpr int      MAX_NODE_DEPTH = 64;
+
+enum ComponentType
+{
+	BYTE = 5120,
+	UNSIGNED_BYTE = 5121,
+	SHORT = 5122,
+	UNSIGNED_SHORT = 5123,
+	UNSIGNED_INT = 5125,
+	FLOAT = 5126
+};
+
+struct BufferData
+{
+	const uint8_t*         data = nullptr;
+	size_t                 size = 0;
+	vector<uint8_t>        decoded;	// only for data: URIs
+	unique_ptr<MappedFile> file;	// only for external .bin files
+};
+
+// Strided view into a buffer; nothing is copied until the elements are converted
+struct AccessorView
+{
+	const uint8_t* data = nullptr;
+	size_t         count = 0;
+	size_t         stride = 0;
+	int            componentType = FLOAT;
+	int            componentCount = 0;
+	bool           normalized = false;
+};
+
+struct PrimitiveJob
+{
+	int        meshIndex;
+	int        primitiveIndex;
+	XMFLOAT4X4 world;
+};
+
+struct PrimitiveResult
+{
+	vector<Vertex>   vertices;
+	vector<uint32_t> indices;
+	uint32_t         materialIndex = 0;
+};
+
+size_t GetComponentSize(int componentType)
+{
+	switch (componentType)
+	{
+		case BYTE:
+		case UNSIGNED_BYTE:
+			return 1;
+		case SHORT:
+		case UNSIGNED_SHORT:
+			return 2;
+		case UNSIGNED_INT:
+		case FLOAT:
+			return 4;
+		default:
+			return 0;
+	}
+}
+
+int GetComponentCount(const string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	if (type == "MAT4") return 16;
+	return 0;
+}
+
+float ReadComponent(const uint8_t* source, int componentType, bool normalized)
+{
+	switch (componentType)
+	{
+		case FLOAT:
+		{
+			float value;
+			memcpy(&value, source, sizeof(value));
+			return value;
+		}
+		case UNSIGNED_BYTE:
+			return normalized ? source[0] / 255.0f : source[0];
+		case BYTE:
+		{
+			float value = static_cast<int8_t>(source[0]);
+			return normalized ? max(value / 127.0f, -1.0f) : value;
+		}
+		case UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, source, sizeof(value));
+			return normalized ? value / 65535.0f : value;
+		}
+		case SHORT:
+		{
+			int16_t value;
+			memcpy(&value, source, sizeof(value));
+			return normalized ? max(value / 32767.0f, -1.0f) : value;
+		}
+		case UNSIGNED_INT:
+		{
+			uint32_t value;
+			memcpy(&value, source, sizeof(value));
+			return static_cast<float>(value);
+		}
+		default:
+			return 0.0f;
+	}
+}
+
+// Indices stay integers; a float only holds them exactly up to 2^24
+uint32_t ReadIndex(const uint8_t* source, int componentType)
+{
+	switch (componentType)
+	{
+		case UNSIGNED_BYTE:
+			return source[0];
+		case UNSIGNED_SHORT:
+		{
+			uint16_t value;
+			memcpy(&value, source, sizeof(value));
+			return value;
+		}
+		case UNSIGNED_INT:
+		{
+			uint32_t value;
+			memcpy(&value, source, sizeof(value));
+			return value;
+		}
+		default:
+			return UINT32_MAX;
+	}
+}
+
+// Components the accessor does not have keep the values already in out
+template <size_t N>
+void ReadElement(const AccessorView& view, size_t index, float (&out)[N])
+{
+	const uint8_t* element = view.data + index * view.stride;
+	const size_t componentSize = GetComponentSize(view.componentType);
+	const size_t componentCount = min(N, static_cast<size_t>(view.componentCount));
+	for (size_t i = 0; i < componentCount; ++i)
+	{
+		out[i] = ReadComponent(element + i * componentSize, view.componentType, view.normalized);
+	}
+}
+
+// Sizes and offsets must be whole non-negative numbers a double holds exactly; a missing value reads as 0
+bool ReadSize(const JsonValue& value, size_t& out)
+{
+	const double number = value.AsNumber();
+	if (!(number >= 0.0 && number < 9007199254740992.0) || floor(number) != number) return false;
+	out = static_cast<size_t>(number);
+	return true;
+}
+
+bool GetAccessorView(const JsonValue& document, const vector<BufferData>& buffers, int accessorIndex, AccessorView& view)
+{
+	const JsonValue& accessor = document["accessors"][accessorIndex];
+	if (!accessor.IsObject()) return false;
+	if (accessor.Has("sparse")) LOG_WARNING("Sparse accessor ", accessorIndex, " is read without its sparse substitutions");
+
+	view.componentType = accessor["componentType"].AsInt();
+	view.componentCount = GetComponentCount(accessor["type"].AsString());
+	view.normalized = accessor["normalized"].AsBool();
+	const size_t elementSize = GetComponentSize(view.componentType) * view.componentCount;
+	if (elementSize == 0 || !accessor.Has("bufferView")) return false;
+
+	const JsonValue& bufferView = document["bufferViews"][accessor["bufferView"].AsInt(-1)];
+	const int bufferIndex = bufferView["buffer"].AsInt(-1);
+	if (bufferIndex < 0 || bufferIndex >= static_cast<int>(buffers.size())) return false;
+
+	const BufferData& buffer = buffers[bufferIndex];
+	size_t viewOffset, viewLength, accessorOffset;
+	if (!ReadSize(accessor["count"], view.count) || !ReadSize(bufferView["byteOffset"], viewOffset) || !ReadSize(bufferView["byteLength"], viewLength) ||
+		!ReadSize(accessor["byteOffset"], accessorOffset) || !ReadSize(bufferView["byteStride"], view.stride))
+	{
+		LOG_ERROR("Accessor ", accessorIndex, " has a size or offset that is not a whole non-negative number");
+		return false;
+	}
+	if (view.stride == 0) view.stride = elementSize;
+
+	// each term is checked against what is left of the view, so nothing here can overflow
+	bool inside = viewOffset <= buffer.size && viewLength <= buffer.size - viewOffset && accessorOffset <= viewLength;
+	if (inside && view.count > 0)
+	{
+		const size_t available = viewLength - accessorOffset;
+		inside = elementSize <= available && view.count - 1 <= (available - elementSize) / view.stride;
+	}
+	if (!inside)
+	{
+		LOG_ERROR("Accessor ", accessorIndex, " reads outside its buffer view");
+		return false;
+	}
+	view.data = buffer.data + viewOffset + accessorOffset;
+	return true;
+}
+
+bool DecodeBase64(string_view text, vector<uint8_t>& out)
+{
+	static const auto decodeTable = []
+	{
+		array<int8_t, 256> table;
+		table.fill(-1);
+		const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+		for (int i = 0; i < 64; ++i) table[static_cast<uint8_t>(alphabet[i])] = static_cast<int8_t>(i);
+		return table;
+	}();
+
+	out.clear();
+	out.reserve(text.size() * 3 / 4);
+	uint32_t accumulator = 0;
+	int bits = 0;
+	for (char c : text)
+	{
+		if (c == '=') break;
+		int8_t value = decodeTable[static_cast<uint8_t>(c)];
+		if (value < 0) return false;
+		accumulator = (accumulator << 6) | static_cast<uint32_t>(value);
+		bits += 6;
+		if (bits >= 8)
+		{
+			bits -= 8;
+			out.push_back(static_cast<uint8_t>(accumulator >> bits));
+		}
+	}
+	return true;
+}
+
+bool LoadBuffers(const JsonValue& document, const string& directory, const uint8_t* binChunk, size_t binChunkSize, vector<BufferData>& buffers)
+{
+	const JsonValue& bufferArray = document["buffers"];
+	buffers.resize(bufferArray.Size());
+
+	// external files are mapped and data: URIs decoded, one buffer per job
+	vector<uint8_t> loaded(buffers.size(), 0);
+	ThreadPool::GetInstance().ParallelFor(buffers.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			const string& uri = bufferArray[i]["uri"].AsString();
+			BufferData& buffer = buffers[i];
+			if (uri.empty())
+			{
+				if (i != 0 || !binChunk) continue;
+				buffer.data = binChunk;
+				buffer.size = binChunkSize;
+			}
+			else if (uri.compare(0, 5, "data:") == 0)
+			{
+				size_t comma = uri.find(',');
+				if (comma == string::npos || !DecodeBase64(string_view(uri).substr(comma + 1), buffer.decoded)) continue;
+				buffer.data = buffer.decoded.data();
+				buffer.size = buffer.decoded.size();
+			}
+			else
+			{
+				buffer.file = make_unique<MappedFile>();
+				if (!buffer.file->Open(directory + uri)) continue;
+				buffer.data = buffer.file->GetData();
+				buffer.size = buffer.file->GetSize();
+			}
+			loaded[i] = buffer.size >= static_cast<size_t>(bufferArray[i]["byteLength"].AsNumber());
+		}
+	});
+
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		if (!loaded[i])
+		{
+			LOG_ERROR("glTF buffer ", i, " is missing or shorter than its byteLength");
+			return false;
+		}
+	}
+	return true;
+}
+
+XMMATRIX GetNodeLocalMatrix(const JsonValue& node)
+{
+	const JsonValue& matrix = node["matrix"];
+	if (matrix.Size() == 16)
+	{
+		// column-major column-vector storage reads directly as a row-vector DirectXMath matrix
+		XMFLOAT4X4 local;
+		for (int i = 0; i < 16; ++i) local.m[i / 4][i % 4] = matrix[i].AsFloat();
+		return XMLoadFloat4x4(&local);
+	}
+
+	const JsonValue& scale = node["scale"];
+	const JsonValue& rotation = node["rotation"];
+	const JsonValue& translation = node["translation"];
+	XMMATRIX S = XMMatrixScaling(scale[0].AsFloat(1.0f), scale[1].AsFloat(1.0f), scale[2].AsFloat(1.0f));
+	XMMATRIX R = XMMatrixRotationQuaternion(XMVectorSet(rotation[0].AsFloat(), rotation[1].AsFloat(), rotation[2].AsFloat(), rotation[3].AsFloat(1.0f)));
+	XMMATRIX T = XMMatrixTranslation(translation[0].AsFloat(), translation[1].AsFloat(), translation[2].AsFloat());
+	return S * R * T;
+}
+
+void CollectPrimitives(const JsonValue& document, int nodeIndex, FXMMATRIX parentWorld, int depth, vector<PrimitiveJob>& jobs)
+{
+	const JsonValue& node = document["nodes"][nodeIndex];
+	if (!node.IsObject() || depth > MAX_NODE_DEPTH) return;
+
+	XMMATRIX world = GetNodeLocalMatrix(node) * parentWorld;
+	if (node.Has("mesh"))
+	{
+		int meshIndex = node["mesh"].AsInt();
+		size_t primitiveCount = document["meshes"][meshIndex]["primitives"].Size();
+		for (size_t i = 0; i < primitiveCount; ++i)
+		{
+			PrimitiveJob job = { meshIndex, static_cast<int>(i), {} };
+			XMStoreFloat4x4(&job.world, world);
+			jobs.push_back(job);
+		}
+	}
+	for (const JsonValue& child : node["children"].GetElements())
+	{
+		CollectPrimitives(document, child.AsInt(-1), world, depth + 1, jobs);
+	}
+}
+
+uint64_t HashVertex(const Vertex& vertex)
+{
+	// Vertex is all floats, so there is no padding to hash
+	uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+	memcpy(words, &vertex, sizeof(Vertex));
+	uint64_t hash = 0;
+	for (uint32_t word : words)
+	{
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 29;
+	}
+	return hash;
+}
+
+// Open addressing over the vertex indices themselves, compacting in place; no allocation per vertex
+void DeduplicateVertices(vector<Vertex>& vertices, vector<uint32_t>& indices)
+{
+	size_t tableSize = 1;
+	while (tableSize < vertices.size() * 2) tableSize <<= 1;
+	const size_t mask = tableSize - 1;
+	vector<uint32_t> table(tableSize, UINT32_MAX);
+	vector<uint32_t> remap(vertices.size());
+
+	uint32_t uniqueCount = 0;
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		size_t slot = static_cast<size_t>(HashVertex(vertices[i])) & mask;
+		while (true)
+		{
+			uint32_t entry = table[slot];
+			if (entry == UINT32_MAX)
+			{
+				table[slot] = uniqueCount;
+				vertices[uniqueCount] = vertices[i];
+				remap[i] = uniqueCount++;
+				break;
+			}
+			if (memcmp(&vertices[entry], &vertices[i], sizeof(Vertex)) == 0)
+			{
+				remap[i] = entry;
+				break;
+			}
+			slot = (slot + 1) & mask;
+		}
+	}
+	vertices.resize(uniqueCount);
+	for (uint32_t& index : indices) index = remap[index];
+}
+
+void ComputeSmoothNormals(vector<Vertex>& vertices, const vector<uint32_t>& indices)
+{
+	vector<XMFLOAT3> accumulated(vertices.size(), { 0.0f, 0.0f, 0.0f });
+	for (size_t i = 0; i + 2 < indices.size(); i += 3)
+	{
+		XMVECTOR p0 = XMLoadFloat3(&vertices[indices[i]].pos);
+		XMVECTOR faceNormal = XMVector3Cross(
+			XMVectorSubtract(XMLoadFloat3(&vertices[indices[i + 1]].pos), p0),
+			XMVectorSubtract(XMLoadFloat3(&vertices[indices[i + 2]].pos), p0));
+		for (size_t k = 0; k < 3; ++k)
+		{
+			XMFLOAT3& normal = accumulated[indices[i + k]];
+			XMStoreFloat3(&normal, XMVectorAdd(XMLoadFloat3(&normal), faceNormal));
+		}
+	}
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		XMStoreFloat3(&vertices[i].normal, XMVector3Normalize(XMLoadFloat3(&accumulated[i])));
+	}
+}
+
+bool DecodePrimitive(const JsonValue& document, const vector<BufferData>& buffers, const PrimitiveJob& job, PrimitiveResult& result)
+{
+	const JsonValue& primitive = document["meshes"][job.meshIndex]["primitives"][job.primitiveIndex];
+	if (primitive["mode"].AsInt(MODE_TRIANGLES) != MODE_TRIANGLES)
+	{
+		LOG_WARNING("Skipping non-triangle primitive ", job.primitiveIndex, " of mesh ", job.meshIndex);
+		return false;
+	}
+
+	const JsonValue& attributes = primitive["attributes"];
+	AccessorView positions, normals, texCoords, tangents, colors;
+	if (!GetAccessorView(document, buffers, attributes["POSITION"].AsInt(-1), positions) || positions.componentCount != 3)
+	{
+		LOG_ERROR("Primitive ", job.primitiveIndex, " of mesh ", job.meshIndex, " has no usable POSITION");
+		return false;
+	}
+	const size_t vertexCount = positions.count;
+	auto getOptional = [&](const char* name, AccessorView& view)
+	{
+		return attributes.Has(name) && GetAccessorView(document, buffers, attributes[name].AsInt(-1), view) && view.count == vertexCount;
+	};
+	const bool hasNormals = getOptional("NORMAL", normals);
+	const bool hasTexCoords = getOptional("TEXCOORD_0", texCoords);
+	const bool hasTangents = getOptional("TANGENT", tangents) && tangents.componentCount == 4;
+	const bool hasColors = getOptional("COLOR_0", colors);
+
+	// glTF is right-handed; mirroring z moves it into the engine's left-handed space
+	XMMATRIX world = XMLoadFloat4x4(&job.world) * XMMatrixScaling(1.0f, 1.0f, -1.0f);
+	XMMATRIX normalMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+	const bool mirrored = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+	const float handedness = mirrored ? -1.0f : 1.0f;
+
+	result.vertices.resize(vertexCount);
+	ThreadPool::GetInstance().ParallelFor(vertexCount, PARALLEL_VERTEX_CHUNK, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			Vertex& vertex = result.vertices[i];
+			float position[3] = {};
+			ReadElement(positions, i, position);
+			XMStoreFloat3(&vertex.pos, XMVector3TransformCoord(XMVectorSet(position[0], position[1], position[2], 1.0f), world));
+
+			float normal[3] = { 0.0f, 1.0f, 0.0f };
+			if (hasNormals) ReadElement(normals, i, normal);
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(normal[0], normal[1], normal[2], 0.0f), normalMatrix)));
+
+			float texCoord[2] = {};
+			if (hasTexCoords) ReadElement(texCoords, i, texCoord);
+			vertex.texCoord = { texCoord[0], texCoord[1] };
+
+			float tangent[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+			if (hasTangents) ReadElement(tangents, i, tangent);
+			XMStoreFloat4(&vertex.tangentU, XMVector3Normalize(XMVector3TransformNormal(XMVectorSet(tangent[0], tangent[1], tangent[2], 0.0f), world)));
+			vertex.tangentU.w = tangent[3] < 0.0f ? -handedness : handedness;
+
+			float color[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+			if (hasColors) ReadElement(colors, i, color);
+			vertex.color = { color[0], color[1], color[2], color[3] };
+		}
+	});
+
+	if (primitive.Has("indices"))
+	{
+		AccessorView indexView;
+		if (!GetAccessorView(document, buffers, primitive["indices"].AsInt(-1), indexView) || indexView.componentCount != 1 ||
+			indexView.componentType == FLOAT || indexView.componentType == BYTE || indexView.componentType == SHORT)
+		{
+			LOG_ERROR("Primitive ", job.primitiveIndex, " of mesh ", job.meshIndex, " has invalid indices");
+			return false;
+		}
+		result.indices.resize(indexView.count);
+		for (size_t i = 0; i < indexView.count; ++i)
+		{
+			result.indices[i] = ReadIndex(indexView.data + i * indexView.stride, indexView.componentType);
+		}
+	}
+	else
+	{
+		result.indices.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i) result.indices[i] = static_cast<uint32_t>(i);
+	}
+	result.indices.resize(result.indices.size() / 3 * 3);
+	for (uint32_t index : result.indices)
+	{
+		if (index >= vertexCount)
+		{
+			LOG_ERROR("Primitive ", job.primitiveIndex, " of mesh ", job.meshIndex, " indexes past its vertices");
+			return false;
+		}
+	}
+
+	// a transform with negative determinant (including the plain z flip) turns front faces around
+	if (mirrored)
+	{
+		for (size_t i = 0; i < result.indices.size(); i += 3) swap(result.indices[i + 1], result.indices[i + 2]);
+	}
+
+	if (!hasNormals) ComputeSmoothNormals(result.vertices, result.indices);
+	if (!hasTangents) TangentGenerator::Generate(result.vertices, result.indices, false);
+	DeduplicateVertices(result.vertices, result.indices);
+	return true;
+}
+
+template <size_t N>
+void CopyName(char (&destination)[N], const string& source)
+{
+	size_t length = min(source.size(), N - 1);
+	memcpy(destination, source.data(), length);
+	destination[length] = '\0';
+}
+
+void ReadMaterials(const JsonValue& document, vector<MeshFileMaterial>& materials)
+{
+	const JsonValue& materialArray = document["materials"];
+	for (size_t i = 0; i < materialArray.Size(); ++i)
+	{
+		const JsonValue& material = materialArray[i];
+		const JsonValue& pbr = material["pbrMetallicRoughness"];
+		const JsonValue& baseColor = pbr["baseColorFactor"];
+
+		MeshFileMaterial fileMaterial = {};
+		CopyName(fileMaterial.name, material.Has("name") ? material["name"].AsString() : "material" + to_string(i));
+		fileMaterial.baseColor = { baseColor[0].AsFloat(1.0f), baseColor[1].AsFloat(1.0f), baseColor[2].AsFloat(1.0f), baseColor[3].AsFloat(1.0f) };
+		fileMaterial.metallic = pbr["metallicFactor"].AsFloat(1.0f);
+		fileMaterial.roughness = pbr["roughnessFactor"].AsFloat(1.0f);
+		materials.push_back(fileMaterial);
+	}
+}
+}
+
+bool GltfImporter::Import(const string& filePath, MeshFileData& outData)
+{
+	LOG_FUNCTION_ENTRY();
+	auto importStart = chrono::steady_clock::now();
+
+	MappedFile file;
+	if (!file.Open(filePath)) return false;
+
+	// a .glb holds the JSON and BIN chunks back to back; a .gltf is the JSON alone
+	string_view jsonText(reinterpret_cast<const char*>(file.GetData()), file.GetSize());
+	const uint8_t* binChunk = nullptr;
+	size_t binChunkSize = 0;
+	uint32_t magic = 0;
+	if (file.GetSize() >= 12) memcpy(&magic, file.GetData(), sizeof(magic));
+	if (magic == GLB_MAGIC)
+	{
+		const uint8_t* cursor = file.GetData() + 12;
+		const uint8_t* fileEnd = file.GetData() + file.GetSize();
+		jsonText = {};
+		while (fileEnd - cursor >= 8)
+		{
+			uint32_t chunkLength, chunkType;
+			memcpy(&chunkLength, cursor, sizeof(chunkLength));
+			memcpy(&chunkType, cursor + 4, sizeof(chunkType));
+			cursor += 8;
+			if (chunkLength > static_cast<size_t>(fileEnd - cursor)) break;
+
+			if (chunkType == GLB_CHUNK_JSON) jsonText = string_view(reinterpret_cast<const char*>(cursor), chunkLength);
+			else if (chunkType == GLB_CHUNK_BIN && !binChunk)
+			{
+				binChunk = cursor;
+				binChunkSize = chunkLength;
+			}
+			cursor += chunkLength;
+		}
+	}
+
+	JsonValue document;
+	string parseError;
+	if (!JsonValue::Parse(jsonText, document, &parseError))
+	{
+		LOG_ERROR("Failed to parse glTF JSON in ", filePath, ": ", parseError);
+		return false;
+	}
+	if (document["asset"]["version"].AsString().compare(0, 2, "2.") != 0)
+	{
+		LOG_ERROR("Unsupported glTF version in ", filePath);
+		return false;
+	}
+
+	const size_t separator = filePath.find_last_of("/\\");
+	const string directory = separator == string::npos ? string() : filePath.substr(0, separator + 1);
+	vector<BufferData> buffers;
+	if (!LoadBuffers(document, directory, binChunk, binChunkSize, buffers)) return false;
+
+	vector<PrimitiveJob> jobs;
+	const JsonValue& scene = document["scenes"][document["scene"].AsInt(0)];
+	if (scene.IsObject())
+	{
+		for (const JsonValue& root : scene["nodes"].GetElements())
+		{
+			CollectPrimitives(document, root.AsInt(-1), XMMatrixIdentity(), 0, jobs);
+		}
+	}
+	else
+	{
+		// no scene: import every mesh untransformed
+		for (size_t meshIndex = 0; meshIndex < document["meshes"].Size(); ++meshIndex)
+		{
+			for (size_t i = 0; i < document["meshes"][meshIndex]["primitives"].Size(); ++i)
+			{
+				PrimitiveJob job = { static_cast<int>(meshIndex), static_cast<int>(i), {} };
+				XMStoreFloat4x4(&job.world, XMMatrixIdentity());
+				jobs.push_back(job);
+			}
+		}
+	}
+
+	vector<PrimitiveResult> results(jobs.size());
+	vector<uint8_t> decoded(jobs.size(), 0);
+	ThreadPool::GetInstance().ParallelFor(jobs.size(), 1, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			decoded[i] = DecodePrimitive(document, buffers, jobs[i], results[i]);
+		}
+	});
+
+	outData.vertices.clear();
+	outData.indices.clear();
+	outData.submeshes.clear();
+	outData.materials.clear();
+	ReadMaterials(document, outData.materials);
+
+	int defaultMaterialIndex = -1;
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		if (!decoded[i] || results[i].indices.empty()) continue;
+
+		int materialIndex = document["meshes"][jobs[i].meshIndex]["primitives"][jobs[i].primitiveIndex]["material"].AsInt(-1);
+		if (materialIndex < 0 || materialIndex >= static_cast<int>(outData.materials.size()))
+		{
+			if (defaultMaterialIndex < 0)
+			{
+				MeshFileMaterial material = {};
+				CopyName(material.name, "default");
+				material.baseColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+				material.roughness = 1.0f;
+				defaultMaterialIndex = static_cast<int>(outData.materials.size());
+				outData.materials.push_back(material);
+			}
+			materialIndex = defaultMaterialIndex;
+		}
+
+		MeshFileSubmesh submesh = {};
+		submesh.startIndex = static_cast<uint32_t>(outData.indices.size());
+		submesh.indexCount = static_cast<uint32_t>(results[i].indices.size());
+		submesh.materialIndex = static_cast<uint32_t>(materialIndex);
+		outData.submeshes.push_back(submesh);
+
+		const uint32_t baseVertex = static_cast<uint32_t>(outData.vertices.size());
+		outData.vertices.insert(outData.vertices.end(), results[i].vertices.begin(), results[i].vertices.end());
+		for (uint32_t index : results[i].indices) outData.indices.push_back(baseVertex + index);
+	}
+
+	if (outData.indices.empty())
+	{
+		LOG_ERROR("No triangle primitives found in ", filePath);
+		return false;
+	}
+
+	size_t totalBytes = file.GetSize();
+	for (const BufferData& buffer : buffers)
+	{
+		if (buffer.file) totalBytes += buffer.size;
+	}
+	float importMs = chrono::duration<float, milli>(chrono::steady_clock::now() - importStart).count();
+	float megabytes = totalBytes / (1024.0f * 1024.0f);
+	LOG_DEBUG("glTF imported: ", filePath, " (", outData.vertices.size(), " vertices, ", outData.indices.size() / 3, " triangles, ",
+		outData.submeshes.size(), " submeshes) ", megabytes, " MB in ", importMs, " ms = ", megabytes * 1000.0f / max(importMs, 0.001f), " MB/s");
+	return true;
+}
+
+bool GltfImporter::ConvertToMeshFile(const string& gltfPath, const string& meshPath, VertexFormat vertexFormat)
+{
+	MeshFileData data;
+	if (!Import(gltfPath, data)) return false;
+	data.vertexFormat = vertexFormat;
+	return MeshFile::Write(meshPath, data);
+}
+} // namespace Lunar
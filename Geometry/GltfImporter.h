@@ -0,0 +1,18 @@
+#pragma once
+#include <string>
+
+#include "MeshFile.h"
+
+namespace Lunar
+{
+// glTF 2.0 (.gltf and .glb) reader producing the same MeshFileData as ObjImporter. The node hierarchy of the
+// default scene is flattened with transforms baked in, and every triangle primitive becomes a submesh.
+// Binary data is read in place from the mapped .glb chunk or mapped .bin files; only data: URIs are decoded
+// into memory. Primitives are decoded in parallel, and z is mirrored into the engine's left-handed space.
+class GltfImporter
+{
+public:
+	static bool Import(const std::string& filePath, MeshFileData& outData);
+	static bool ConvertToMeshFile(const std::string& gltfPath, const std::string& meshPath, VertexFormat vertexFormat = VertexFormat::Default);
+};
+} // namespace Lunar
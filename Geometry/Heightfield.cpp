@@ -0,0 +1,170 @@
+#include "Heightfield.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stb_image.h>
+
+#include "../Utils/Logger.h"
+
+using namespace std;
+
+namespace Lunar
+{
+namespace
+{
+// integer hash to [0, 1), stable across platforms
+float HashLattice(int x, int z, uint32_t seed)
+{
+	uint32_t h = static_cast<uint32_t>(x) * 0x8da6b343u ^ static_cast<uint32_t>(z) * 0xd8163841u ^ seed * 0xcb1ab31fu;
+	h ^= h >> 13;
+	h *= 0x5bd1e995u;
+	h ^= h >> 15;
+	return (h & 0x00ffffffu) / 16777216.0f;
+}
+
+float ValueNoise(float x, float z, uint32_t seed)
+{
+	int x0 = static_cast<int>(floorf(x));
+	int z0 = static_cast<int>(floorf(z));
+	float fx = x - x0;
+	float fz = z - z0;
+	// smoothstep fade keeps the gradient continuous across lattice cells
+	fx = fx * fx * (3.0f - 2.0f * fx);
+	fz = fz * fz * (3.0f - 2.0f * fz);
+
+	float h00 = HashLattice(x0, z0, seed);
+	float h10 = HashLattice(x0 + 1, z0, seed);
+	float h01 = HashLattice(x0, z0 + 1, seed);
+	float h11 = HashLattice(x0 + 1, z0 + 1, seed);
+	float top = h00 + (h10 - h00) * fx;
+	float bottom = h01 + (h11 - h01) * fx;
+	return top + (bottom - top) * fz;
+}
+}
+
+Heightfield::Heightfield(uint32_t resolution, vector<float> heights)
+	: m_resolution(resolution), m_heights(move(heights))
+{
+	if (m_heights.size() != static_cast<size_t>(resolution) * resolution)
+	{
+		LOG_ERROR("Heightfield expects ", resolution * resolution, " samples, got ", m_heights.size());
+		m_heights.resize(static_cast<size_t>(resolution) * resolution, 0.0f);
+	}
+}
+
+bool Heightfield::LoadFromFile(const string& filePath)
+{
+	int width, height, channels;
+	stbi_us* pixels = stbi_load_16(filePath.c_str(), &width, &height, &channels, 1);
+	if (!pixels)
+	{
+		LOG_ERROR("Failed to load heightmap: ", filePath);
+		return false;
+	}
+
+	m_resolution = static_cast<uint32_t>(max(width, height));
+	m_heights.resize(static_cast<size_t>(m_resolution) * m_resolution);
+	for (uint32_t z = 0; z < m_resolution; ++z)
+	{
+		int srcZ = static_cast<int>(static_cast<uint64_t>(z) * height / m_resolution);
+		for (uint32_t x = 0; x < m_resolution; ++x)
+		{
+			int srcX = static_cast<int>(static_cast<uint64_t>(x) * width / m_resolution);
+			m_heights[z * m_resolution + x] = pixels[srcZ * width + srcX] / 65535.0f;
+		}
+	}
+	stbi_image_free(pixels);
+
+	LOG_DEBUG("Heightmap loaded: ", filePath, " (", width, "x", height, ")");
+	return true;
+}
+
+void Heightfield::GenerateFractalNoise(uint32_t resolution, uint32_t seed, int octaves, float persistence)
+{
+	// u and v span the grid from the first sample to the last, which takes two of them
+	if (resolution < 2)
+	{
+		LOG_WARNING("Fractal noise needs a resolution of at least 2, got ", resolution);
+		resolution = 2;
+	}
+	m_resolution = resolution;
+	m_heights.resize(static_cast<size_t>(resolution) * resolution);
+
+	float amplitudeSum = 0.0f;
+	for (int octave = 0; octave < octaves; ++octave)
+	{
+		amplitudeSum += powf(persistence, static_cast<float>(octave));
+	}
+
+	for (uint32_t z = 0; z < resolution; ++z)
+	{
+		for (uint32_t x = 0; x < resolution; ++x)
+		{
+			float u = static_cast<float>(x) / (resolution - 1);
+			float v = static_cast<float>(z) / (resolution - 1);
+			float frequency = 4.0f;
+			float amplitude = 1.0f;
+			float height = 0.0f;
+			for (int octave = 0; octave < octaves; ++octave)
+			{
+				height += ValueNoise(u * frequency, v * frequency, seed + octave) * amplitude;
+				frequency *= 2.0f;
+				amplitude *= persistence;
+			}
+			m_heights[z * resolution + x] = height / amplitudeSum;
+		}
+	}
+}
+
+float Heightfield::GetSample(int x, int z) const
+{
+	if (m_resolution == 0) return 0.0f;
+	int last = static_cast<int>(m_resolution) - 1;
+	return m_heights[clamp(z, 0, last) * m_resolution + clamp(x, 0, last)];
+}
+
+float Heightfield::SampleBilinear(float u, float v) const
+{
+	if (m_resolution == 0) return 0.0f;
+
+	float x = clamp(u, 0.0f, 1.0f) * (m_resolution - 1);
+	float z = clamp(v, 0.0f, 1.0f) * (m_resolution - 1);
+	int x0 = static_cast<int>(x);
+	int z0 = static_cast<int>(z);
+	float fx = x - x0;
+	float fz = z - z0;
+
+	float h00 = GetSample(x0, z0);
+	float h10 = GetSample(x0 + 1, z0);
+	float h01 = GetSample(x0, z0 + 1);
+	float h11 = GetSample(x0 + 1, z0 + 1);
+	float top = h00 + (h10 - h00) * fx;
+	float bottom = h01 + (h11 - h01) * fx;
+	return top + (bottom - top) * fz;
+}
+
+void Heightfield::GetHeightRange(float u0, float v0, float u1, float v1, float& minHeight, float& maxHeight) const
+{
+	minHeight = 0.0f;
+	maxHeight = 0.0f;
+	if (m_resolution == 0) return;
+
+	const float last = static_cast<float>(m_resolution - 1);
+	int x0 = static_cast<int>(floorf(clamp(u0, 0.0f, 1.0f) * last));
+	int x1 = static_cast<int>(ceilf(clamp(u1, 0.0f, 1.0f) * last));
+	int z0 = static_cast<int>(floorf(clamp(v0, 0.0f, 1.0f) * last));
+	int z1 = static_cast<int>(ceilf(clamp(v1, 0.0f, 1.0f) * last));
+
+	minHeight = GetSample(x0, z0);
+	maxHeight = minHeight;
+	for (int z = z0; z <= z1; ++z)
+	{
+		for (int x = x0; x <= x1; ++x)
+		{
+			float height = GetSample(x, z);
+			minHeight = min(minHeight, height);
+			maxHeight = max(maxHeight, height);
+		}
+	}
+}
+} // namespace Lunar
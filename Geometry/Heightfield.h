@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Lunar
+{
+// Square grid of normalized [0, 1] height samples, addressed with u, v in [0, 1]
+class Heightfield
+{
+public:
+	Heightfield() = default;
+	Heightfield(uint32_t resolution, std::vector<float> heights);
+
+	// 8 or 16 bit grayscale image through stb_image; non-square images are resampled to a square grid
+	bool LoadFromFile(const std::string& filePath);
+	// Deterministic fractal value noise; resolutions below 2 are raised to 2
+	void GenerateFractalNoise(uint32_t resolution, uint32_t seed, int octaves = 6, float persistence = 0.5f);
+
+	uint32_t GetResolution() const { return m_resolution; }
+	float    GetSample(int x, int z) const;
+	float    SampleBilinear(float u, float v) const;
+	// Height range of the samples covering [u0, u1] x [v0, v1]
+	void     GetHeightRange(float u0, float v0, float u1, float v1, float& minHeight, float& maxHeight) const;
+
+private:
+	uint32_t           m_resolution = 0;
+	std::vector<float> m_heights;
+};
+} // namespace Lunar
@@ -1,5 +1,10 @@
 #include "IcoSphere.h"
 
+#include <algorithm>
+
+#include "IcoSphereSubdivider.h"
+#include "../Utils/Logger.h"
+
 using namespace std;
 using namespace DirectX;
 
@@ -12,22 +17,22 @@ void IcoSphere::CreateGeometry()
 
     goldenRatio *= inverseNormal;
 
-    m_vertices = {
-        {{-inverseNormal, goldenRatio, 0}, {1,1,1,1}, {0,0}, {0,0,0}},   // 0
-        {{ inverseNormal, goldenRatio, 0}, {1,1,1,1}, {0,0}, {0,0,0}},   // 1
-        {{-inverseNormal,-goldenRatio, 0}, {1,1,1,1}, {0,0}, {0,0,0}},   // 2
-        {{ inverseNormal,-goldenRatio, 0}, {1,1,1,1}, {0,0}, {0,0,0}},   // 3
-        {{ 0,-inverseNormal, goldenRatio}, {1,1,1,1}, {0,0}, {0,0,0}},   // 4
-        {{ 0, inverseNormal, goldenRatio}, {1,1,1,1}, {0,0}, {0,0,0}},   // 5
-        {{ 0,-inverseNormal,-goldenRatio}, {1,1,1,1}, {0,0}, {0,0,0}},   // 6
-        {{ 0, inverseNormal,-goldenRatio}, {1,1,1,1}, {0,0}, {0,0,0}},   // 7
-        {{ goldenRatio, 0,-inverseNormal}, {1,1,1,1}, {0,0}, {0,0,0}},   // 8
-        {{ goldenRatio, 0, inverseNormal}, {1,1,1,1}, {0,0}, {0,0,0}},   // 9
-        {{-goldenRatio, 0,-inverseNormal}, {1,1,1,1}, {0,0}, {0,0,0}},   // 10
-        {{-goldenRatio, 0, inverseNormal}, {1,1,1,1}, {0,0}, {0,0,0}}    // 11
+    vector<XMFLOAT3> basePositions = {
+        {-inverseNormal, goldenRatio, 0},   // 0
+        { inverseNormal, goldenRatio, 0},   // 1
+        {-inverseNormal,-goldenRatio, 0},   // 2
+        { inverseNormal,-goldenRatio, 0},   // 3
+        { 0,-inverseNormal, goldenRatio},   // 4
+        { 0, inverseNormal, goldenRatio},   // 5
+        { 0,-inverseNormal,-goldenRatio},   // 6
+        { 0, inverseNormal,-goldenRatio},   // 7
+        { goldenRatio, 0,-inverseNormal},   // 8
+        { goldenRatio, 0, inverseNormal},   // 9
+        {-goldenRatio, 0,-inverseNormal},   // 10
+        {-goldenRatio, 0, inverseNormal}    // 11
     };
 
-    m_indices = {
+    vector<uint32_t> baseIndices = {
         // top 5 
         0, 11, 5,    0, 5, 1,     0, 1, 7,     0, 7, 10,    0, 10, 11,
         // middle-top 5
@@ -38,9 +43,28 @@ void IcoSphere::CreateGeometry()
         4, 9, 5,     2, 4, 11,    6, 2, 10,    8, 6, 7,     9, 8, 1
     };
 
-    for (int i = 0; i < m_subdivisionLevel; ++i)
+    int subdivisionLevel = m_subdivisionLevel;
+    if (subdivisionLevel > MAX_SUBDIVISION_LEVEL)
+    {
+        LOG_WARNING("IcoSphere subdivision level ", subdivisionLevel, " exceeds 16-bit index range, using ", MAX_SUBDIVISION_LEVEL);
+        subdivisionLevel = MAX_SUBDIVISION_LEVEL;
+    }
+
+    vector<XMFLOAT3> positions;
+    vector<uint32_t> indices;
+    IcoSphereSubdivider::Subdivide(basePositions, baseIndices, subdivisionLevel, m_parallelSubdivision, positions, indices);
+
+    // remaining attributes are filled in by the Calculate* passes below
+    m_vertices.resize(positions.size());
+    for (size_t i = 0; i < positions.size(); ++i)
     {
-        Subdivide();
+        m_vertices[i].pos = positions[i];
+    }
+
+    m_indices.resize(indices.size());
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        m_indices[i] = static_cast<uint16_t>(indices[i]);
     }
 
     CalculateNormals();
@@ -50,54 +74,22 @@ void IcoSphere::CreateGeometry()
 	ComputeTangents();
 }
 
-uint16_t IcoSphere::GetMiddlePoint(UINT p1, UINT p2)
+bool IcoSphere::CreateLODGeometry(
+    uint32_t                lodIndex,
+    const vector<Vertex>&   baseVertices,
+    const vector<uint16_t>& baseIndices,
+    vector<Vertex>&         outVertices,
+    vector<uint16_t>&       outIndices)
 {
-    if (p1 > p2) std::swap(p1, p2);
-    auto key = std::make_pair(p1, p2);
-    auto it = m_middlePointCache.find(key);
-    if (it != m_middlePointCache.end()) return it->second;
-
-    XMVECTOR pos1 = XMLoadFloat3(&m_vertices[p1].pos); 
-    XMVECTOR pos2 = XMLoadFloat3(&m_vertices[p2].pos); 
-    XMVECTOR middle = XMVectorScale(XMVectorAdd(pos1, pos2), 0.5f);
-
-    // normalize for unit sphere
-    middle = XMVector3Normalize(middle);
-
-    Vertex middleVertex;
-    XMStoreFloat3(&middleVertex.pos, middle);
-    middleVertex.color = {1, 1, 1, 1};
-    middleVertex.normal = {0, 0, 0};
-    middleVertex.texCoord = {0, 0};
-
-    uint16_t newIndex = static_cast<uint16_t>(m_vertices.size());
-    m_vertices.push_back(middleVertex);
-    m_middlePointCache[key] = newIndex;
-
-    return newIndex;
-}
-
-void IcoSphere::Subdivide()
-{
-    std::vector<uint16_t> newIndices;
-
-    for (size_t i = 0; i < m_indices.size(); i += 3) 
-    {
-        uint16_t index1 = m_indices[i];
-        uint16_t index2 = m_indices[i + 1];
-        uint16_t index3 = m_indices[i + 2];
-        uint16_t index4 = GetMiddlePoint(index1, index2);
-        uint16_t index5 = GetMiddlePoint(index2, index3);
-        uint16_t index6 = GetMiddlePoint(index3, index1);
-        
-        newIndices.insert(newIndices.end(), {index1, index4, index6});
-        newIndices.insert(newIndices.end(), {index4, index2, index5});
-        newIndices.insert(newIndices.end(), {index6, index5, index3});
-        newIndices.insert(newIndices.end(), {index4, index5, index6});
-    }
-
-    m_indices = move(newIndices);
-    m_middlePointCache.clear();
+    int subdivisionLevel = min(m_subdivisionLevel, MAX_SUBDIVISION_LEVEL) - static_cast<int>(lodIndex);
+    if (subdivisionLevel < 0) return false;
+
+    IcoSphere coarseSphere;
+    coarseSphere.SetSubDivisionLevel(subdivisionLevel);
+    coarseSphere.CreateGeometry();
+    outVertices = move(coarseSphere.m_vertices);
+    outIndices = move(coarseSphere.m_indices);
+    return true;
 }
 
 void IcoSphere::CalculateNormals()
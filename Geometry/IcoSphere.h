@@ -1,6 +1,4 @@
 #pragma once
-#include <unordered_map>
-
 #include "Geometry.h"
 
 namespace Lunar
@@ -12,23 +10,28 @@ public:
     ~IcoSphere() = default;
     
     void     CreateGeometry() override;
-    uint16_t GetMiddlePoint(UINT p1, UINT p2);
-    void     Subdivide();
     void     CalculateNormals();
     void     CalculateTexCoords();
     void     CalculateColors();
     void     SetSubDivisionLevel(int subdivisionLevel) { m_subdivisionLevel = subdivisionLevel; }
+    void     SetParallelSubdivision(bool parallel) { m_parallelSubdivision = parallel; }
 	void	 FixSeamVertices();
     
+    // 10 * 4^6 + 2 = 40962 vertices plus seam copies still fit 16-bit indices
+    static constexpr int MAX_SUBDIVISION_LEVEL = 6;
+
+protected:
+    // coarser levels come from fewer subdivisions instead of simplification
+    bool CreateLODGeometry(
+        uint32_t lodIndex,
+        const std::vector<Vertex>& baseVertices,
+        const std::vector<uint16_t>& baseIndices,
+        std::vector<Vertex>& outVertices,
+        std::vector<uint16_t>& outIndices) override;
+
 private:
-	// struct for pair hashing
-	struct PairHash {
-		size_t operator()(const std::pair<uint16_t,uint16_t>& p) const noexcept {
-			return (size_t(p.first) << 16) | p.second;
-		}
-	};
-    std::unordered_map<std::pair<UINT, UINT>, UINT, PairHash> m_middlePointCache;
-    int                                                       m_subdivisionLevel = 4;
+    int  m_subdivisionLevel = 4;
+    bool m_parallelSubdivision = false;
 	
 };
 } // namespace Luanr
@@ -0,0 +1,207 @@
+#include "IcoSphereSubdivider.h"
+
+#include <algorithm>
+
+#include "../Utils/Logger.h"
+#include "../Utils/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+struct EdgeRecord
+{
+	uint32_t lo;
+	uint32_t hi;
+	uint32_t face;
+	uint32_t localEdge;
+};
+
+struct FaceEdge
+{
+	uint32_t edgeIndex;
+	bool     reversed;	// local direction runs from the higher to the lower vertex index
+	bool     owner;		// this face writes the edge's vertex positions
+};
+
+// Local grid point (u, v) is c0 + u * (c1 - c0) / N + v * (c2 - c0) / N, stored row by row in v
+inline uint32_t GridIndex(uint32_t u, uint32_t v, uint32_t n)
+{
+	return v * (n + 1) - v * (v - 1) / 2 + u;
+}
+
+inline XMFLOAT3 Midpoint(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	XMVECTOR middle = XMVectorScale(XMVectorAdd(XMLoadFloat3(&a), XMLoadFloat3(&b)), 0.5f);
+	XMFLOAT3 result;
+	XMStoreFloat3(&result, XMVector3Normalize(middle));
+	return result;
+}
+}
+
+void IcoSphereSubdivider::Subdivide(
+	const vector<XMFLOAT3>& basePositions,
+	const vector<uint32_t>& baseIndices,
+	int                     level,
+	bool                    parallel,
+	vector<XMFLOAT3>&       outPositions,
+	vector<uint32_t>&       outIndices)
+{
+	if (level < 0 || level > MAX_SUBDIVISION_LEVEL)
+	{
+		LOG_WARNING("Subdivision level ", level, " clamped to [0, ", MAX_SUBDIVISION_LEVEL, "]");
+		level = clamp(level, 0, MAX_SUBDIVISION_LEVEL);
+	}
+
+	const uint32_t n = 1u << level;
+	const uint32_t baseVertexCount = static_cast<uint32_t>(basePositions.size());
+	const uint32_t baseFaceCount = static_cast<uint32_t>(baseIndices.size() / 3);
+
+	// edge table: sort the 3F half-edges by their vertex pair instead of hashing
+	vector<EdgeRecord> records;
+	records.reserve(baseFaceCount * 3);
+	for (uint32_t face = 0; face < baseFaceCount; ++face)
+	{
+		const uint32_t* corners = &baseIndices[face * 3];
+		// local edges: 0 = c0->c1, 1 = c1->c2, 2 = c0->c2
+		const uint32_t starts[3] = { corners[0], corners[1], corners[0] };
+		const uint32_t ends[3] = { corners[1], corners[2], corners[2] };
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			records.push_back({ min(starts[k], ends[k]), max(starts[k], ends[k]), face, k });
+		}
+	}
+	sort(records.begin(), records.end(), [](const EdgeRecord& a, const EdgeRecord& b)
+	{
+		if (a.lo != b.lo) return a.lo < b.lo;
+		if (a.hi != b.hi) return a.hi < b.hi;
+		return a.face < b.face;
+	});
+
+	vector<FaceEdge> faceEdges(baseFaceCount * 3);
+	uint32_t edgeCount = 0;
+	for (size_t i = 0; i < records.size(); ++i)
+	{
+		const EdgeRecord& record = records[i];
+		bool first = i == 0 || records[i - 1].lo != record.lo || records[i - 1].hi != record.hi;
+		if (first) ++edgeCount;
+
+		uint32_t start = record.localEdge == 1 ? baseIndices[record.face * 3 + 1] : baseIndices[record.face * 3];
+		faceEdges[record.face * 3 + record.localEdge] = { edgeCount - 1, start != record.lo, first };
+	}
+
+	const uint32_t verticesPerEdge = n - 1;
+	const uint32_t verticesPerFace = (n - 1) * (n > 1 ? n - 2 : 0) / 2;
+	const uint32_t edgeVertexBase = baseVertexCount;
+	const uint32_t faceVertexBase = edgeVertexBase + edgeCount * verticesPerEdge;
+	const uint32_t trianglesPerFace = n * n;
+
+	outPositions.resize(faceVertexBase + baseFaceCount * verticesPerFace);
+	outIndices.resize(static_cast<size_t>(baseFaceCount) * trianglesPerFace * 3);
+	copy(basePositions.begin(), basePositions.end(), outPositions.begin());
+
+	auto subdivideFaces = [&](size_t faceBegin, size_t faceEnd)
+	{
+		const uint32_t gridSize = (n + 1) * (n + 2) / 2;
+		vector<XMFLOAT3> grid(gridSize);
+		vector<uint32_t> gridToVertex(gridSize);
+
+		for (size_t face = faceBegin; face < faceEnd; ++face)
+		{
+			const uint32_t* corners = &baseIndices[face * 3];
+			const FaceEdge* edges = &faceEdges[face * 3];
+
+			grid[GridIndex(0, 0, n)] = basePositions[corners[0]];
+			grid[GridIndex(n, 0, n)] = basePositions[corners[1]];
+			grid[GridIndex(0, n, n)] = basePositions[corners[2]];
+
+			// same midpoints as recursive 1-to-4 splitting, one level at a time
+			for (uint32_t step = n; step > 1; step /= 2)
+			{
+				const uint32_t half = step / 2;
+				for (uint32_t v = 0; v <= n; v += half)
+				{
+					for (uint32_t u = 0; u + v <= n; u += half)
+					{
+						bool oddU = u % step != 0;
+						bool oddV = v % step != 0;
+						if (!oddU && !oddV) continue;
+
+						XMFLOAT3& point = grid[GridIndex(u, v, n)];
+						if (oddU && oddV)
+							point = Midpoint(grid[GridIndex(u - half, v + half, n)], grid[GridIndex(u + half, v - half, n)]);
+						else if (oddU)
+							point = Midpoint(grid[GridIndex(u - half, v, n)], grid[GridIndex(u + half, v, n)]);
+						else
+							point = Midpoint(grid[GridIndex(u, v - half, n)], grid[GridIndex(u, v + half, n)]);
+					}
+				}
+			}
+
+			const uint32_t faceBase = faceVertexBase + static_cast<uint32_t>(face) * verticesPerFace;
+			for (uint32_t v = 0; v <= n; ++v)
+			{
+				for (uint32_t u = 0; u + v <= n; ++u)
+				{
+					uint32_t gridIndex = GridIndex(u, v, n);
+					uint32_t vertexIndex;
+					int localEdge = -1;
+					uint32_t t = 0;
+
+					if (u == 0 && v == 0)      vertexIndex = corners[0];
+					else if (u == n)           vertexIndex = corners[1];
+					else if (v == n)           vertexIndex = corners[2];
+					else if (v == 0)           { localEdge = 0; t = u; }
+					else if (u + v == n)       { localEdge = 1; t = v; }
+					else if (u == 0)           { localEdge = 2; t = v; }
+					else
+					{
+						uint32_t row = v - 1;
+						vertexIndex = faceBase + row * (n - 1) - row * (row + 1) / 2 + (u - 1);
+						outPositions[vertexIndex] = grid[gridIndex];
+					}
+
+					if (localEdge >= 0)
+					{
+						const FaceEdge& edge = edges[localEdge];
+						uint32_t offset = edge.reversed ? n - t : t;
+						vertexIndex = edgeVertexBase + edge.edgeIndex * verticesPerEdge + (offset - 1);
+						if (edge.owner) outPositions[vertexIndex] = grid[gridIndex];
+					}
+					gridToVertex[gridIndex] = vertexIndex;
+				}
+			}
+
+			uint32_t* triangle = &outIndices[face * trianglesPerFace * 3];
+			for (uint32_t v = 0; v < n; ++v)
+			{
+				for (uint32_t u = 0; u + v < n; ++u)
+				{
+					uint32_t i0 = gridToVertex[GridIndex(u, v, n)];
+					uint32_t i1 = gridToVertex[GridIndex(u + 1, v, n)];
+					uint32_t i2 = gridToVertex[GridIndex(u, v + 1, n)];
+					*triangle++ = i0; *triangle++ = i1; *triangle++ = i2;
+
+					if (u + v + 2 <= n)
+					{
+						uint32_t i3 = gridToVertex[GridIndex(u + 1, v + 1, n)];
+						*triangle++ = i1; *triangle++ = i3; *triangle++ = i2;
+					}
+				}
+			}
+		}
+	};
+
+	if (parallel)
+	{
+		ThreadPool::GetInstance().ParallelFor(baseFaceCount, 1, subdivideFaces);
+	}
+	else
+	{
+		subdivideFaces(0, baseFaceCount);
+	}
+}
+} // namespace Lunar
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace Lunar
+{
+// Midpoint subdivision of a closed triangle mesh whose vertices lie on the unit sphere.
+// Each base face is refined on its own (2^level + 1)-wide triangular grid and vertex indices are
+// assigned in closed form: base vertices, then (2^level - 1) per base edge, then face interiors.
+// Shared edge vertices therefore need no midpoint cache, and base faces can be processed in parallel.
+class IcoSphereSubdivider
+{
+public:
+	static constexpr int MAX_SUBDIVISION_LEVEL = 12;
+
+	// Closed-form counts for an icosahedron base mesh
+	static uint32_t GetVertexCount(int level) { return 10u * (1u << (2 * level)) + 2u; }
+	static uint32_t GetFaceCount(int level) { return 20u * (1u << (2 * level)); }
+
+	static void Subdivide(
+		const std::vector<DirectX::XMFLOAT3>& basePositions,
+		const std::vector<uint32_t>&          baseIndices,
+		int                                   level,
+		bool                                  parallel,
+		std::vector<DirectX::XMFLOAT3>&       outPositions,
+		std::vector<uint32_t>&                outIndices);
+};
+} // namespace Lunar
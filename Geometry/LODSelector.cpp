@@ -0,0 +1,35 @@
+#include "LODSelector.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+float LODSelector::ComputeScreenCoverage(const BoundingSphere& worldBounds, const XMFLOAT3& eyePos, const XMFLOAT4X4& projection)
+{
+	float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&worldBounds.Center), XMLoadFloat3(&eyePos))));
+	if (distance <= worldBounds.Radius) return FLT_MAX;
+
+	// _22 is cot(fovY / 2), which maps a view-space height at distance 1 to NDC
+	return worldBounds.Radius * projection._22 / distance;
+}
+
+uint32_t LODSelector::SelectLevel(float coverage, const vector<float>& thresholds, uint32_t currentLevel, float hysteresis)
+{
+	const uint32_t lastLevel = static_cast<uint32_t>(thresholds.size());
+	uint32_t level = min(currentLevel, lastLevel);
+
+	while (level < lastLevel && coverage < thresholds[level] * (1.0f - hysteresis))
+	{
+		++level;
+	}
+	while (level > 0 && coverage >= thresholds[level - 1] * (1.0f + hysteresis))
+	{
+		--level;
+	}
+	return level;
+}
+} // namespace Lunar
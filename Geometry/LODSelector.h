@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+namespace Lunar
+{
+// Picks a discrete level of detail from the projected size of a bounding sphere
+class LODSelector
+{
+public:
+	// Projected radius as a fraction of half the viewport height; projection is row-major, not transposed
+	static float ComputeScreenCoverage(
+		const DirectX::BoundingSphere& worldBounds,
+		const DirectX::XMFLOAT3&       eyePos,
+		const DirectX::XMFLOAT4X4&     projection);
+
+	// thresholds[i] is the coverage below which level i hands over to level i + 1, so a chain of
+	// n levels has n - 1 thresholds. A level is only left once the coverage is past its threshold
+	// by the hysteresis fraction, which keeps objects near a boundary from popping every frame.
+	static uint32_t SelectLevel(
+		float                     coverage,
+		const std::vector<float>& thresholds,
+		uint32_t                  currentLevel,
+		float                     hysteresis);
+};
+} // namespace Lunar
@@ -0,0 +1,105 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+
+#include "GltfImporter.h"
+#include "ObjImporter.h"
+#include "../Utils/Logger.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+void Mesh::Initialize(ID3D12Device* device)
+{
+	LOG_FUNCTION_ENTRY();
+	m_objectCB = std::make_unique<ConstantBuffer>(device, sizeof(ObjectConstants));
+
+	string meshFilePath = ResolveMeshFilePath();
+	auto loadStart = chrono::steady_clock::now();
+
+	MeshFile meshFile;
+	if (!meshFile.Open(meshFilePath)) return;
+	const MeshFileHeader& header = meshFile.GetHeader();
+	if (header.vertexCount == 0 || header.indexCount == 0)
+	{
+		LOG_ERROR("Mesh file has no triangles: ", meshFilePath);
+		return;
+	}
+
+	// the pipelines were picked for m_vertexFormat, so a file in another format cannot be drawn with them
+	if (header.vertexFormat != static_cast<uint32_t>(m_vertexFormat))
+	{
+		LOG_ERROR("Mesh file vertex format ", header.vertexFormat, " does not match the requested ", static_cast<uint32_t>(m_vertexFormat),
+			": ", meshFilePath);
+		return;
+	}
+	const UINT vbByteSize = static_cast<UINT>(meshFile.GetVertexDataSize());
+	m_vertexBuffer = CreateUploadBuffer(device, meshFile.GetVertexData(), vbByteSize);
+	m_vertexBufferView.BufferLocation = m_vertexBuffer->GetGPUVirtualAddress();
+	m_vertexBufferView.StrideInBytes = header.vertexStride;
+	m_vertexBufferView.SizeInBytes = vbByteSize;
+
+	const UINT ibByteSize = static_cast<UINT>(meshFile.GetIndexDataSize());
+	m_indexBuffer = CreateUploadBuffer(device, meshFile.GetIndexData(), ibByteSize);
+	m_indexBufferView.BufferLocation = m_indexBuffer->GetGPUVirtualAddress();
+	m_indexBufferView.Format = header.indexSize == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+	m_indexBufferView.SizeInBytes = ibByteSize;
+
+	m_submeshes.assign(meshFile.GetSubmeshes(), meshFile.GetSubmeshes() + header.submeshCount);
+	m_materials.assign(meshFile.GetMaterials(), meshFile.GetMaterials() + header.materialCount);
+	m_localBoundingBox = BoundingBox(header.boundsCenter, header.boundsExtents);
+
+	// a single level so the base Draw, DrawShadow and DrawNormals cover the whole file
+	m_lods = { { 0u, header.vertexCount, 0u, header.indexCount } };
+	m_submittedIndexCount = header.indexCount;
+
+	float loadMs = chrono::duration<float, milli>(chrono::steady_clock::now() - loadStart).count();
+	LOG_DEBUG("Mesh loaded: ", meshFilePath, " (", header.vertexCount, " vertices, ", header.indexCount / 3, " triangles, ",
+		header.submeshCount, " submeshes) in ", loadMs, " ms");
+}
+
+void Mesh::DrawSubmesh(ID3D12GraphicsCommandList* commandList, size_t submeshIndex, D3D12_GPU_VIRTUAL_ADDRESS objectConstants)
+{
+	if (m_lods.empty() || submeshIndex >= m_submeshes.size()) return;
+
+	m_objectConstantsOverride = objectConstants;
+	BindForDraw(commandList);
+	m_objectConstantsOverride = 0;
+	const MeshFileSubmesh& submesh = m_submeshes[submeshIndex];
+	commandList->DrawIndexedInstanced(submesh.indexCount, 1, submesh.startIndex, 0, 0);
+}
+
+string Mesh::ResolveMeshFilePath() const
+{
+	filesystem::path sourcePath(m_filePath);
+	string extension = sourcePath.extension().string();
+	transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	const bool isObj = extension == ".obj";
+	const bool isGltf = extension == ".gltf" || extension == ".glb";
+	if (!isObj && !isGltf) return m_filePath;
+
+	filesystem::path meshPath = sourcePath;
+	meshPath.replace_extension(".lmesh");
+
+	// a file written by another version or in another vertex format is converted again as well
+	error_code error;
+	bool upToDate = filesystem::exists(meshPath, error) &&
+		filesystem::last_write_time(meshPath, error) >= filesystem::last_write_time(sourcePath, error) &&
+		MeshFile::IsCurrent(meshPath.string(), m_vertexFormat);
+	if (!upToDate)
+	{
+		auto convertStart = chrono::steady_clock::now();
+		bool converted = isObj ?
+			ObjImporter::ConvertToMeshFile(m_filePath, meshPath.string(), m_vertexFormat) :
+			GltfImporter::ConvertToMeshFile(m_filePath, meshPath.string(), m_vertexFormat);
+		if (!converted) return m_filePath;
+		LOG_DEBUG("Converted ", m_filePath, " in ", chrono::duration<float, milli>(chrono::steady_clock::now() - convertStart).count(), " ms");
+	}
+	return meshPath.string();
+}
+} // namespace Lunar
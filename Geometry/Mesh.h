@@ -0,0 +1,45 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "Geometry.h"
+#include "MeshFile.h"
+
+namespace Lunar
+{
+// Geometry loaded from an .lmesh file. The mapped vertex and index sections are copied straight into
+// upload buffers without going through m_vertices. The file must hold the vertex format set on the mesh.
+// An .obj, .gltf or .glb path is converted to a sibling .lmesh the first time, and again whenever the
+// source is newer or the .lmesh has another version or vertex format.
+class Mesh : public Geometry
+{
+public:
+	Mesh() = default;
+	~Mesh() override = default;
+
+	void Initialize(ID3D12Device* device) override;
+	void CreateGeometry() override {}
+
+	void SetFilePath(const std::string& filePath) { m_filePath = filePath; } // must be called before Initialize
+
+	const std::string&                   GetFilePath() const { return m_filePath; }
+	const std::vector<MeshFileSubmesh>&  GetSubmeshes() const { return m_submeshes; }
+	const std::vector<MeshFileMaterial>& GetMaterials() const { return m_materials; }
+	const DirectX::BoundingBox&          GetBounds() const { return m_localBoundingBox; }
+
+	// Material registered for each submesh; empty until the renderer registers the file's materials
+	void SetSubmeshMaterialNames(std::vector<std::string> names) { m_submeshMaterialNames = std::move(names); }
+	const std::vector<std::string>& GetSubmeshMaterialNames() const { return m_submeshMaterialNames; }
+	// Draws one submesh, with another object constant buffer when objectConstants is not zero
+	void DrawSubmesh(ID3D12GraphicsCommandList* commandList, size_t submeshIndex, D3D12_GPU_VIRTUAL_ADDRESS objectConstants = 0);
+
+private:
+	std::string ResolveMeshFilePath() const;
+
+	std::string                   m_filePath;
+	std::vector<MeshFileSubmesh>  m_submeshes;
+	std::vector<MeshFileMaterial> m_materials;
+	std::vector<std::string>      m_submeshMaterialNames;
+};
+} // namespace Lunar
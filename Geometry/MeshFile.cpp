@@ -0,0 +1,172 @@
+#include "MeshFile.h"
+
+#include <cfloat>
+#include <cstring>
+#include <DirectXCollision.h>
+#include <fstream>
+
+#include "../Utils/Logger.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + MeshFile::SECTION_ALIGNMENT - 1) & ~(MeshFile::SECTION_ALIGNMENT - 1);
+}
+
+bool IsSectionInFile(uint64_t offset, uint64_t byteSize, uint64_t fileSize)
+{
+	return offset <= fileSize && byteSize <= fileSize - offset;
+}
+
+// Write puts the materials last, so a file whose material section does not end it has another material layout
+bool HasCurrentLayout(const MeshFileHeader& header)
+{
+	return header.magic == MeshFile::MAGIC && header.version == MeshFile::VERSION &&
+		header.materialOffset <= header.fileSize &&
+		header.fileSize - header.materialOffset == static_cast<uint64_t>(header.materialCount) * sizeof(MeshFileMaterial);
+}
+}
+
+bool MeshFile::Write(const string& filePath, const MeshFileData& data)
+{
+	const bool narrowIndices = data.vertices.size() <= 0xFFFF;
+
+	MeshFileHeader header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.vertexFormat = static_cast<uint32_t>(data.vertexFormat);
+	header.vertexStride = VertexFormatUtils::GetStride(data.vertexFormat);
+	header.vertexCount = static_cast<uint32_t>(data.vertices.size());
+	header.indexCount = static_cast<uint32_t>(data.indices.size());
+	header.indexSize = narrowIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+	header.submeshCount = static_cast<uint32_t>(data.submeshes.size());
+	header.materialCount = static_cast<uint32_t>(data.materials.size());
+
+	BoundingBox bounds;
+	if (!data.vertices.empty())
+	{
+		BoundingBox::CreateFromPoints(bounds, data.vertices.size(), &data.vertices[0].pos, sizeof(Vertex));
+	}
+	header.boundsCenter = bounds.Center;
+	header.boundsExtents = bounds.Extents;
+
+	header.vertexOffset = AlignOffset(sizeof(MeshFileHeader));
+	header.indexOffset = AlignOffset(header.vertexOffset + static_cast<uint64_t>(header.vertexCount) * header.vertexStride);
+	header.submeshOffset = AlignOffset(header.indexOffset + static_cast<uint64_t>(header.indexCount) * header.indexSize);
+	header.materialOffset = AlignOffset(header.submeshOffset + header.submeshCount * sizeof(MeshFileSubmesh));
+	header.fileSize = header.materialOffset + header.materialCount * sizeof(MeshFileMaterial);
+
+	vector<uint8_t> bytes(header.fileSize, 0);
+	memcpy(bytes.data(), &header, sizeof(header));
+
+	vector<uint8_t> vertexData = VertexFormatUtils::PackVertices(data.vertices, data.vertexFormat);
+	if (!vertexData.empty()) memcpy(bytes.data() + header.vertexOffset, vertexData.data(), vertexData.size());
+
+	if (narrowIndices)
+	{
+		uint16_t* indices = reinterpret_cast<uint16_t*>(bytes.data() + header.indexOffset);
+		for (size_t i = 0; i < data.indices.size(); ++i) indices[i] = static_cast<uint16_t>(data.indices[i]);
+	}
+	else if (!data.indices.empty())
+	{
+		memcpy(bytes.data() + header.indexOffset, data.indices.data(), data.indices.size() * sizeof(uint32_t));
+	}
+
+	MeshFileSubmesh* submeshes = reinterpret_cast<MeshFileSubmesh*>(bytes.data() + header.submeshOffset);
+	for (size_t i = 0; i < data.submeshes.size(); ++i)
+	{
+		MeshFileSubmesh submesh = data.submeshes[i];
+		if (submesh.indexCount > 0)
+		{
+			XMVECTOR minPoint = XMVectorReplicate(FLT_MAX);
+			XMVECTOR maxPoint = XMVectorReplicate(-FLT_MAX);
+			for (uint32_t k = submesh.startIndex; k < submesh.startIndex + submesh.indexCount; ++k)
+			{
+				XMVECTOR position = XMLoadFloat3(&data.vertices[data.indices[k]].pos);
+				minPoint = XMVectorMin(minPoint, position);
+				maxPoint = XMVectorMax(maxPoint, position);
+			}
+			XMStoreFloat3(&submesh.boundsCenter, XMVectorScale(XMVectorAdd(minPoint, maxPoint), 0.5f));
+			XMStoreFloat3(&submesh.boundsExtents, XMVectorScale(XMVectorSubtract(maxPoint, minPoint), 0.5f));
+		}
+		submeshes[i] = submesh;
+	}
+	if (!data.materials.empty())
+	{
+		memcpy(bytes.data() + header.materialOffset, data.materials.data(), data.materials.size() * sizeof(MeshFileMaterial));
+	}
+
+	ofstream file(filePath, ios::binary | ios::trunc);
+	if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+	{
+		LOG_ERROR("Failed to write mesh file: ", filePath);
+		return false;
+	}
+	LOG_DEBUG("Mesh file written: ", filePath, " (", header.vertexCount, " vertices, ", header.indexCount / 3, " triangles, ", header.fileSize, " bytes)");
+	return true;
+}
+
+bool MeshFile::IsCurrent(const string& filePath, VertexFormat vertexFormat)
+{
+	ifstream file(filePath, ios::binary);
+	MeshFileHeader header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+	return HasCurrentLayout(header) && header.vertexFormat == static_cast<uint32_t>(vertexFormat);
+}
+
+bool MeshFile::Open(const string& filePath)
+{
+	Close();
+	if (!m_file.Open(filePath)) return false;
+
+	const uint64_t fileSize = m_file.GetSize();
+	const MeshFileHeader* header = reinterpret_cast<const MeshFileHeader*>(m_file.GetData());
+	bool valid = fileSize >= sizeof(MeshFileHeader) &&
+		HasCurrentLayout(*header) &&
+		header->fileSize == fileSize &&
+		header->vertexFormat <= static_cast<uint32_t>(VertexFormat::Compact) &&
+		header->vertexStride == VertexFormatUtils::GetStride(static_cast<VertexFormat>(header->vertexFormat)) &&
+		(header->indexSize == sizeof(uint16_t) || header->indexSize == sizeof(uint32_t)) &&
+		IsSectionInFile(header->vertexOffset, static_cast<uint64_t>(header->vertexCount) * header->vertexStride, fileSize) &&
+		IsSectionInFile(header->indexOffset, static_cast<uint64_t>(header->indexCount) * header->indexSize, fileSize) &&
+		IsSectionInFile(header->submeshOffset, static_cast<uint64_t>(header->submeshCount) * sizeof(MeshFileSubmesh), fileSize) &&
+		IsSectionInFile(header->materialOffset, static_cast<uint64_t>(header->materialCount) * sizeof(MeshFileMaterial), fileSize);
+	if (valid)
+	{
+		// submeshes are drawn straight from the index buffer with one of the file's materials, so each range
+		// must lie inside it and each material must exist
+		const MeshFileSubmesh* submeshes = reinterpret_cast<const MeshFileSubmesh*>(m_file.GetData() + header->submeshOffset);
+		for (uint32_t i = 0; i < header->submeshCount && valid; ++i)
+		{
+			valid = static_cast<uint64_t>(submeshes[i].startIndex) + submeshes[i].indexCount <= header->indexCount &&
+				submeshes[i].materialIndex < header->materialCount;
+		}
+		const MeshFileMaterial* materials = reinterpret_cast<const MeshFileMaterial*>(m_file.GetData() + header->materialOffset);
+		for (uint32_t i = 0; i < header->materialCount && valid; ++i)
+		{
+			valid = materials[i].name[sizeof(materials[i].name) - 1] == '\0';
+		}
+	}
+	if (!valid)
+	{
+		LOG_ERROR("Invalid or outdated mesh file: ", filePath);
+		Close();
+		return false;
+	}
+
+	m_header = header;
+	return true;
+}
+
+void MeshFile::Close()
+{
+	m_file.Close();
+	m_header = nullptr;
+}
+} // namespace Lunar
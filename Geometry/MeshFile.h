@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+#include "VertexFormat.h"
+#include "../Utils/MappedFile.h"
+
+namespace Lunar
+{
+// .lmesh layout: header, then vertex, index, submesh and material sections at 64-byte aligned offsets.
+// Vertex and index sections are stored exactly as the GPU consumes them, so loading is a mapping plus
+// one copy into upload memory.
+struct MeshFileHeader
+{
+	uint32_t          magic;
+	uint32_t          version;
+	uint32_t          vertexFormat;		// VertexFormat
+	uint32_t          vertexStride;
+	uint32_t          vertexCount;
+	uint32_t          indexCount;
+	uint32_t          indexSize;		// 2 or 4 bytes
+	uint32_t          submeshCount;
+	uint32_t          materialCount;
+	uint32_t          reserved;
+	DirectX::XMFLOAT3 boundsCenter;
+	DirectX::XMFLOAT3 boundsExtents;
+	uint64_t          vertexOffset;
+	uint64_t          indexOffset;
+	uint64_t          submeshOffset;
+	uint64_t          materialOffset;
+	uint64_t          fileSize;
+};
+
+struct MeshFileSubmesh
+{
+	uint32_t          startIndex;
+	uint32_t          indexCount;
+	uint32_t          materialIndex;
+	uint32_t          reserved;
+	DirectX::XMFLOAT3 boundsCenter;
+	DirectX::XMFLOAT3 boundsExtents;
+};
+
+struct MeshFileMaterial
+{
+	char              name[64];
+	DirectX::XMFLOAT4 baseColor;
+	float             metallic;
+	float             roughness;
+};
+
+// CPU-side mesh handed to MeshFile::Write by the importers
+struct MeshFileData
+{
+	VertexFormat                  vertexFormat = VertexFormat::Default;
+	std::vector<Vertex>           vertices;
+	std::vector<uint32_t>         indices;
+	std::vector<MeshFileSubmesh>  submeshes;	// bounds are filled in by Write
+	std::vector<MeshFileMaterial> materials;
+};
+
+class MeshFile
+{
+public:
+	static constexpr uint32_t MAGIC = 0x48534D4C;	// "LMSH"
+	static constexpr uint32_t VERSION = 1;
+	static constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+	// Indices are narrowed to 16 bits when every vertex fits
+	static bool Write(const std::string& filePath, const MeshFileData& data);
+
+	// Reads only the header: true when the file has this version and layout and holds vertexFormat vertices,
+	// so it can be used without converting its source again
+	static bool IsCurrent(const std::string& filePath, VertexFormat vertexFormat);
+
+	// Maps the file and validates the header, the section ranges and the submesh index ranges
+	bool Open(const std::string& filePath);
+	void Close();
+
+	const MeshFileHeader&   GetHeader() const { return *m_header; }
+	const void*             GetVertexData() const { return m_file.GetData() + m_header->vertexOffset; }
+	size_t                  GetVertexDataSize() const { return static_cast<size_t>(m_header->vertexCount) * m_header->vertexStride; }
+	const void*             GetIndexData() const { return m_file.GetData() + m_header->indexOffset; }
+	size_t                  GetIndexDataSize() const { return static_cast<size_t>(m_header->indexCount) * m_header->indexSize; }
+	const MeshFileSubmesh*  GetSubmeshes() const { return reinterpret_cast<const MeshFileSubmesh*>(m_file.GetData() + m_header->submeshOffset); }
+	const MeshFileMaterial* GetMaterials() const { return reinterpret_cast<const MeshFileMaterial*>(m_file.GetData() + m_header->materialOffset); }
+
+private:
+	MappedFile            m_file;
+	const MeshFileHeader* m_header = nullptr;
+};
+} // namespace Lunar
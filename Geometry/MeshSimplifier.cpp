@@ -0,0 +1,306 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <queue>
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+// symmetric 4x4 matrix stored as its upper triangle
+struct Quadric
+{
+	double m[10] = {};
+
+	static Quadric FromPlane(double a, double b, double c, double d, double weight)
+	{
+		Quadric q;
+		q.m[0] = a * a * weight; q.m[1] = a * b * weight; q.m[2] = a * c * weight; q.m[3] = a * d * weight;
+		q.m[4] = b * b * weight; q.m[5] = b * c * weight; q.m[6] = b * d * weight;
+		q.m[7] = c * c * weight; q.m[8] = c * d * weight;
+		q.m[9] = d * d * weight;
+		return q;
+	}
+
+	Quadric& operator+=(const Quadric& other)
+	{
+		for (int i = 0; i < 10; ++i) m[i] += other.m[i];
+		return *this;
+	}
+
+	double Evaluate(const XMFLOAT3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x
+			+ m[4] * y * y + 2.0 * m[5] * y * z + 2.0 * m[6] * y
+			+ m[7] * z * z + 2.0 * m[8] * z
+			+ m[9];
+	}
+};
+
+struct Collapse
+{
+	double   cost;
+	uint32_t from;
+	uint32_t to;
+	uint32_t fromVersion;
+	uint32_t toVersion;
+
+	bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+// boundary edges keep their shape through a plane perpendicular to the face
+constexpr double BOUNDARY_WEIGHT = 1000.0;
+// reject collapses that turn a neighbouring face by more than roughly 80 degrees
+constexpr float FLIP_THRESHOLD = 0.2f;
+
+XMVECTOR FaceNormal(const XMFLOAT3& p0, const XMFLOAT3& p1, const XMFLOAT3& p2)
+{
+	XMVECTOR a = XMLoadFloat3(&p0);
+	return XMVector3Cross(XMVectorSubtract(XMLoadFloat3(&p1), a), XMVectorSubtract(XMLoadFloat3(&p2), a));
+}
+}
+
+bool MeshSimplifier::Simplify(
+	const vector<Vertex>&   vertices,
+	const vector<uint16_t>& indices,
+	size_t                  targetTriangleCount,
+	vector<Vertex>&         outVertices,
+	vector<uint16_t>&       outIndices)
+{
+	const uint32_t wedgeCount = static_cast<uint32_t>(vertices.size());
+	const uint32_t faceCount = static_cast<uint32_t>(indices.size() / 3);
+	outVertices.clear();
+	outIndices.clear();
+	if (faceCount == 0 || targetTriangleCount >= faceCount) return false;
+
+	// weld wedges that share a position so seams collapse as one
+	vector<uint32_t> sortedWedges(wedgeCount);
+	for (uint32_t i = 0; i < wedgeCount; ++i) sortedWedges[i] = i;
+	auto positionLess = [&vertices](uint32_t a, uint32_t b)
+	{
+		const XMFLOAT3& pa = vertices[a].pos;
+		const XMFLOAT3& pb = vertices[b].pos;
+		if (pa.x != pb.x) return pa.x < pb.x;
+		if (pa.y != pb.y) return pa.y < pb.y;
+		return pa.z < pb.z;
+	};
+	sort(sortedWedges.begin(), sortedWedges.end(), positionLess);
+
+	vector<uint32_t> wedgeToVertex(wedgeCount);
+	vector<XMFLOAT3> positions;
+	vector<vector<uint32_t>> vertexWedges;
+	for (uint32_t i = 0; i < wedgeCount; ++i)
+	{
+		uint32_t wedge = sortedWedges[i];
+		if (i == 0 || positionLess(sortedWedges[i - 1], wedge))
+		{
+			positions.push_back(vertices[wedge].pos);
+			vertexWedges.emplace_back();
+		}
+		wedgeToVertex[wedge] = static_cast<uint32_t>(positions.size() - 1);
+		vertexWedges.back().push_back(wedge);
+	}
+	const uint32_t vertexCount = static_cast<uint32_t>(positions.size());
+
+	vector<array<uint32_t, 3>> faces(faceCount);
+	vector<bool> faceRemoved(faceCount, false);
+	vector<vector<uint32_t>> vertexFaces(vertexCount);
+	vector<Quadric> quadrics(vertexCount);
+	for (uint32_t face = 0; face < faceCount; ++face)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			faces[face][k] = indices[face * 3 + k];
+			vertexFaces[wedgeToVertex[faces[face][k]]].push_back(face);
+		}
+
+		const XMFLOAT3& p0 = vertices[faces[face][0]].pos;
+		XMVECTOR normal = FaceNormal(p0, vertices[faces[face][1]].pos, vertices[faces[face][2]].pos);
+		float doubleArea = XMVectorGetX(XMVector3Length(normal));
+		if (doubleArea < 1e-12f) continue;
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, XMVectorScale(normal, 1.0f / doubleArea));
+		double d = -(n.x * p0.x + n.y * p0.y + n.z * p0.z);
+		Quadric q = Quadric::FromPlane(n.x, n.y, n.z, d, doubleArea * 0.5);
+		for (uint32_t k = 0; k < 3; ++k) quadrics[wedgeToVertex[faces[face][k]]] += q;
+	}
+
+	// edges used by a single face lie on an open boundary
+	struct EdgeRecord { uint32_t lo, hi, face, start; };
+	vector<EdgeRecord> edges;
+	edges.reserve(faceCount * 3);
+	for (uint32_t face = 0; face < faceCount; ++face)
+	{
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t a = wedgeToVertex[faces[face][k]];
+			uint32_t b = wedgeToVertex[faces[face][(k + 1) % 3]];
+			edges.push_back({ min(a, b), max(a, b), face, a });
+		}
+	}
+	sort(edges.begin(), edges.end(), [](const EdgeRecord& x, const EdgeRecord& y)
+	{
+		return x.lo != y.lo ? x.lo < y.lo : x.hi < y.hi;
+	});
+	for (size_t i = 0; i < edges.size(); ++i)
+	{
+		bool sharedWithPrevious = i > 0 && edges[i - 1].lo == edges[i].lo && edges[i - 1].hi == edges[i].hi;
+		bool sharedWithNext = i + 1 < edges.size() && edges[i + 1].lo == edges[i].lo && edges[i + 1].hi == edges[i].hi;
+		if (sharedWithPrevious || sharedWithNext) continue;
+
+		const EdgeRecord& edge = edges[i];
+		const array<uint32_t, 3>& face = faces[edge.face];
+		XMVECTOR faceNormal = XMVector3Normalize(FaceNormal(vertices[face[0]].pos, vertices[face[1]].pos, vertices[face[2]].pos));
+		XMVECTOR p0 = XMLoadFloat3(&positions[edge.lo]);
+		XMVECTOR direction = XMVectorSubtract(XMLoadFloat3(&positions[edge.hi]), p0);
+		float lengthSq = XMVectorGetX(XMVector3LengthSq(direction));
+		XMVECTOR planeNormal = XMVector3Normalize(XMVector3Cross(direction, faceNormal));
+
+		XMFLOAT3 n;
+		XMStoreFloat3(&n, planeNormal);
+		double d = -XMVectorGetX(XMVector3Dot(planeNormal, p0));
+		Quadric q = Quadric::FromPlane(n.x, n.y, n.z, d, BOUNDARY_WEIGHT * lengthSq);
+		quadrics[edge.lo] += q;
+		quadrics[edge.hi] += q;
+	}
+
+	vector<uint32_t> versions(vertexCount, 0);
+	vector<bool> vertexRemoved(vertexCount, false);
+	priority_queue<Collapse, vector<Collapse>, greater<Collapse>> heap;
+
+	auto pushEdge = [&](uint32_t a, uint32_t b)
+	{
+		Quadric q = quadrics[a];
+		q += quadrics[b];
+		double costToB = q.Evaluate(positions[b]);
+		double costToA = q.Evaluate(positions[a]);
+		if (costToB <= costToA) heap.push({ costToB, a, b, versions[a], versions[b] });
+		else heap.push({ costToA, b, a, versions[b], versions[a] });
+	};
+	for (size_t i = 0; i < edges.size(); ++i)
+	{
+		if (i > 0 && edges[i - 1].lo == edges[i].lo && edges[i - 1].hi == edges[i].hi) continue;
+		pushEdge(edges[i].lo, edges[i].hi);
+	}
+
+	auto faceHasVertex = [&](uint32_t face, uint32_t vertex)
+	{
+		for (uint32_t wedge : faces[face])
+		{
+			if (wedgeToVertex[wedge] == vertex) return true;
+		}
+		return false;
+	};
+
+	size_t liveFaceCount = faceCount;
+	while (liveFaceCount > targetTriangleCount && !heap.empty())
+	{
+		Collapse collapse = heap.top();
+		heap.pop();
+		const uint32_t from = collapse.from;
+		const uint32_t to = collapse.to;
+		if (vertexRemoved[from] || vertexRemoved[to]) continue;
+		if (versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion) continue;
+
+		// moving from onto to must not fold any face that survives the collapse
+		bool valid = true;
+		for (uint32_t face : vertexFaces[from])
+		{
+			if (faceRemoved[face] || faceHasVertex(face, to)) continue;
+
+			XMFLOAT3 before[3];
+			XMFLOAT3 after[3];
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				uint32_t vertex = wedgeToVertex[faces[face][k]];
+				before[k] = positions[vertex];
+				after[k] = vertex == from ? positions[to] : positions[vertex];
+			}
+			XMVECTOR normalBefore = XMVector3Normalize(FaceNormal(before[0], before[1], before[2]));
+			XMVECTOR normalAfter = FaceNormal(after[0], after[1], after[2]);
+			if (XMVectorGetX(XMVector3LengthSq(normalAfter)) < 1e-20f ||
+				XMVectorGetX(XMVector3Dot(normalBefore, XMVector3Normalize(normalAfter))) < FLIP_THRESHOLD)
+			{
+				valid = false;
+				break;
+			}
+		}
+		if (!valid) continue;
+
+		for (uint32_t face : vertexFaces[from])
+		{
+			if (faceRemoved[face]) continue;
+			if (faceHasVertex(face, to))
+			{
+				faceRemoved[face] = true;
+				--liveFaceCount;
+				continue;
+			}
+
+			// hand each corner to the wedge of the kept vertex with the closest texture coordinate
+			for (uint32_t& wedge : faces[face])
+			{
+				if (wedgeToVertex[wedge] != from) continue;
+
+				const XMFLOAT2& uv = vertices[wedge].texCoord;
+				uint32_t bestWedge = vertexWedges[to].front();
+				float bestDistance = FLT_MAX;
+				for (uint32_t candidate : vertexWedges[to])
+				{
+					float du = vertices[candidate].texCoord.x - uv.x;
+					float dv = vertices[candidate].texCoord.y - uv.y;
+					if (du * du + dv * dv < bestDistance)
+					{
+						bestDistance = du * du + dv * dv;
+						bestWedge = candidate;
+					}
+				}
+				wedge = bestWedge;
+			}
+			vertexFaces[to].push_back(face);
+		}
+
+		quadrics[to] += quadrics[from];
+		vertexRemoved[from] = true;
+		vertexFaces[from].clear();
+		++versions[to];
+
+		vector<uint32_t>& toFaces = vertexFaces[to];
+		toFaces.erase(remove_if(toFaces.begin(), toFaces.end(), [&faceRemoved](uint32_t face) { return faceRemoved[face]; }), toFaces.end());
+		for (uint32_t face : toFaces)
+		{
+			for (uint32_t wedge : faces[face])
+			{
+				uint32_t neighbour = wedgeToVertex[wedge];
+				if (neighbour != to) pushEdge(to, neighbour);
+			}
+		}
+	}
+
+	// compact the surviving wedges
+	vector<int32_t> remap(wedgeCount, -1);
+	for (uint32_t face = 0; face < faceCount; ++face)
+	{
+		if (faceRemoved[face]) continue;
+		for (uint32_t wedge : faces[face])
+		{
+			if (remap[wedge] < 0)
+			{
+				remap[wedge] = static_cast<int32_t>(outVertices.size());
+				outVertices.push_back(vertices[wedge]);
+			}
+			outIndices.push_back(static_cast<uint16_t>(remap[wedge]));
+		}
+	}
+
+	return outIndices.size() < indices.size();
+}
+} // namespace Lunar
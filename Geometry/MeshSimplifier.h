@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+namespace Lunar
+{
+// Garland-Heckbert quadric error simplification with half-edge collapses, so every surviving vertex keeps
+// its original attributes. Vertices sharing a position (UV seams) are collapsed together, and open
+// boundaries are held in place by penalty planes.
+class MeshSimplifier
+{
+public:
+	// Returns false when the mesh could not be reduced at all
+	static bool Simplify(
+		const std::vector<Vertex>&   vertices,
+		const std::vector<uint16_t>& indices,
+		size_t                       targetTriangleCount,
+		std::vector<Vertex>&         outVertices,
+		std::vector<uint16_t>&       outIndices);
+};
+} // namespace Lunar
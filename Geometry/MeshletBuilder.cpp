@@ -0,0 +1,234 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+constexpr uint8_t NOT_IN_MESHLET = 0xff;
+
+MeshletBounds ComputeBounds(const vector<Vertex>& vertices, const MeshletData& data, const Meshlet& meshlet)
+{
+	MeshletBounds bounds = {};
+
+	vector<XMFLOAT3> positions(meshlet.vertexCount);
+	for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+	{
+		positions[i] = vertices[data.vertexIndices[meshlet.vertexOffset + i]].pos;
+	}
+	BoundingSphere sphere;
+	BoundingSphere::CreateFromPoints(sphere, positions.size(), positions.data(), sizeof(XMFLOAT3));
+	bounds.center = sphere.Center;
+	bounds.radius = sphere.Radius;
+
+	vector<XMVECTOR> normals;
+	normals.reserve(meshlet.triangleCount);
+	XMVECTOR normalSum = XMVectorZero();
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const uint8_t* local = &data.primitiveIndices[(meshlet.triangleOffset + triangle) * 3];
+		XMVECTOR p0 = XMLoadFloat3(&positions[local[0]]);
+		XMVECTOR p1 = XMLoadFloat3(&positions[local[1]]);
+		XMVECTOR p2 = XMLoadFloat3(&positions[local[2]]);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0));
+		if (XMVectorGetX(XMVector3LengthSq(normal)) < 1e-20f) continue;
+
+		normal = XMVector3Normalize(normal);
+		normals.push_back(normal);
+		normalSum = XMVectorAdd(normalSum, normal);
+	}
+
+	// disabled cone: a zero axis never passes the backface test
+	bounds.coneApex = bounds.center;
+	bounds.coneAxis = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	bounds.coneCutoff = 1.0f;
+	if (normals.empty() || XMVectorGetX(XMVector3LengthSq(normalSum)) < 1e-12f) return bounds;
+
+	XMVECTOR axis = XMVector3Normalize(normalSum);
+	float minDot = 1.0f;
+	for (XMVECTOR normal : normals)
+	{
+		minDot = min(minDot, XMVectorGetX(XMVector3Dot(axis, normal)));
+	}
+	// past roughly 84 degrees of spread the cone rejects almost nothing
+	if (minDot <= 0.1f) return bounds;
+
+	// push the apex back until every triangle plane lies in front of it
+	XMVECTOR center = XMLoadFloat3(&bounds.center);
+	float maxT = 0.0f;
+	size_t normalIndex = 0;
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const uint8_t* local = &data.primitiveIndices[(meshlet.triangleOffset + triangle) * 3];
+		XMVECTOR p0 = XMLoadFloat3(&positions[local[0]]);
+		XMVECTOR p1 = XMLoadFloat3(&positions[local[1]]);
+		XMVECTOR p2 = XMLoadFloat3(&positions[local[2]]);
+		if (XMVectorGetX(XMVector3LengthSq(XMVector3Cross(XMVectorSubtract(p1, p0), XMVectorSubtract(p2, p0)))) < 1e-20f) continue;
+
+		XMVECTOR normal = normals[normalIndex++];
+		float t = XMVectorGetX(XMVector3Dot(XMVectorSubtract(center, p0), normal)) / XMVectorGetX(XMVector3Dot(axis, normal));
+		maxT = max(maxT, t);
+	}
+
+	XMStoreFloat3(&bounds.coneApex, XMVectorSubtract(center, XMVectorScale(axis, maxT)));
+	XMStoreFloat3(&bounds.coneAxis, axis);
+	bounds.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	return bounds;
+}
+
+template <typename IndexType>
+MeshletData BuildMeshlets(const vector<Vertex>& vertices, const vector<IndexType>& indices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	maxVertices = clamp(maxVertices, 3u, 255u);
+	maxTriangles = max(maxTriangles, 1u);
+
+	const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+	const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+	// vertex to triangle adjacency, compressed rows
+	vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+	for (IndexType index : indices) ++adjacencyOffsets[index + 1];
+	for (uint32_t v = 0; v < vertexCount; ++v) adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+	vector<uint32_t> adjacency(indices.size());
+	{
+		vector<uint32_t> cursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (uint32_t triangle = 0; triangle < triangleCount; ++triangle)
+		{
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				adjacency[cursor[indices[triangle * 3 + k]]++] = triangle;
+			}
+		}
+	}
+
+	MeshletData data;
+	data.meshlets.reserve(triangleCount / maxTriangles + 1);
+	data.vertexIndices.reserve(indices.size());
+	data.primitiveIndices.reserve(indices.size());
+
+	vector<bool> emitted(triangleCount, false);
+	vector<uint8_t> localIndex(vertexCount, NOT_IN_MESHLET);
+	vector<uint32_t> candidates;
+	uint32_t nextSeed = 0;
+
+	Meshlet meshlet = { 0, 0, 0, 0 };
+	auto flush = [&]()
+	{
+		if (meshlet.triangleCount == 0) return;
+		for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+		{
+			localIndex[data.vertexIndices[meshlet.vertexOffset + i]] = NOT_IN_MESHLET;
+		}
+		data.meshlets.push_back(meshlet);
+		data.bounds.push_back(ComputeBounds(vertices, data, meshlet));
+		meshlet = { static_cast<uint32_t>(data.vertexIndices.size()), 0, static_cast<uint32_t>(data.primitiveIndices.size() / 3), 0 };
+		candidates.clear();
+	};
+
+	auto addTriangle = [&](uint32_t triangle)
+	{
+		emitted[triangle] = true;
+		for (uint32_t k = 0; k < 3; ++k)
+		{
+			uint32_t vertex = indices[triangle * 3 + k];
+			if (localIndex[vertex] == NOT_IN_MESHLET)
+			{
+				localIndex[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+				data.vertexIndices.push_back(vertex);
+				candidates.insert(candidates.end(), adjacency.begin() + adjacencyOffsets[vertex], adjacency.begin() + adjacencyOffsets[vertex + 1]);
+			}
+			data.primitiveIndices.push_back(localIndex[vertex]);
+		}
+		++meshlet.triangleCount;
+	};
+
+	while (true)
+	{
+		// best neighbour of the open meshlet that still fits
+		int32_t best = -1;
+		uint32_t bestShared = 0;
+		size_t liveCount = 0;
+		for (uint32_t triangle : candidates)
+		{
+			if (emitted[triangle]) continue;
+			candidates[liveCount++] = triangle;
+
+			uint32_t shared = 0;
+			for (uint32_t k = 0; k < 3; ++k)
+			{
+				if (localIndex[indices[triangle * 3 + k]] != NOT_IN_MESHLET) ++shared;
+			}
+			if (meshlet.vertexCount + (3 - shared) > maxVertices) continue;
+			if (best < 0 || shared > bestShared || (shared == bestShared && triangle < static_cast<uint32_t>(best)))
+			{
+				best = static_cast<int32_t>(triangle);
+				bestShared = shared;
+			}
+		}
+		candidates.resize(liveCount);
+
+		if (best < 0)
+		{
+			flush();
+			while (nextSeed < triangleCount && emitted[nextSeed]) ++nextSeed;
+			if (nextSeed == triangleCount) break;
+			best = static_cast<int32_t>(nextSeed);
+		}
+
+		addTriangle(static_cast<uint32_t>(best));
+		if (meshlet.triangleCount == maxTriangles || meshlet.vertexCount == maxVertices) flush();
+	}
+
+	return data;
+}
+}
+
+MeshletData MeshletBuilder::Build(const vector<Vertex>& vertices, const vector<uint16_t>& indices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	return BuildMeshlets(vertices, indices, maxVertices, maxTriangles);
+}
+
+MeshletData MeshletBuilder::Build(const vector<Vertex>& vertices, const vector<uint32_t>& indices, uint32_t maxVertices, uint32_t maxTriangles)
+{
+	return BuildMeshlets(vertices, indices, maxVertices, maxTriangles);
+}
+
+vector<uint32_t> MeshletBuilder::BuildIndexBuffer(const MeshletData& meshletData)
+{
+	vector<uint32_t> indices;
+	indices.reserve(meshletData.primitiveIndices.size());
+	for (const Meshlet& meshlet : meshletData.meshlets)
+	{
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+		{
+			uint8_t local = meshletData.primitiveIndices[meshlet.triangleOffset * 3 + i];
+			indices.push_back(meshletData.vertexIndices[meshlet.vertexOffset + local]);
+		}
+	}
+	return indices;
+}
+
+bool MeshletBuilder::IsBackfacing(const MeshletBounds& bounds, const XMFLOAT3& eyePos)
+{
+	// every normal in the cone points away from the eye when the view ray is close enough to the axis
+	XMVECTOR view = XMVector3Normalize(XMVectorSubtract(XMLoadFloat3(&bounds.coneApex), XMLoadFloat3(&eyePos)));
+	return XMVectorGetX(XMVector3Dot(view, XMLoadFloat3(&bounds.coneAxis))) >= bounds.coneCutoff;
+}
+
+void MeshletBuilder::Cull(const MeshletData& meshletData, const BoundingFrustum* frustum, const XMFLOAT3& eyePos, vector<uint32_t>& visibleMeshlets)
+{
+	visibleMeshlets.clear();
+	for (uint32_t i = 0; i < meshletData.meshlets.size(); ++i)
+	{
+		const MeshletBounds& bounds = meshletData.bounds[i];
+		if (frustum && !frustum->Intersects(BoundingSphere(bounds.center, bounds.radius))) continue;
+		if (IsBackfacing(bounds, eyePos)) continue;
+		visibleMeshlets.push_back(i);
+	}
+}
+} // namespace Lunar
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "Vertex.h"
+
+namespace Lunar
+{
+struct Meshlet
+{
+	uint32_t vertexOffset;		// into MeshletData::vertexIndices
+	uint32_t vertexCount;
+	uint32_t triangleOffset;	// in triangles, into MeshletData::primitiveIndices
+	uint32_t triangleCount;
+};
+
+struct MeshletBounds
+{
+	DirectX::XMFLOAT3 center;
+	float             radius;
+	DirectX::XMFLOAT3 coneApex;
+	DirectX::XMFLOAT3 coneAxis;
+	float             coneCutoff;	// sin of the normal cone spread, 1 when the cone is too wide to cull
+};
+
+struct MeshletData
+{
+	std::vector<Meshlet>       meshlets;
+	std::vector<MeshletBounds> bounds;
+	std::vector<uint32_t>      vertexIndices;		// meshlet-local vertex to mesh vertex
+	std::vector<uint8_t>       primitiveIndices;	// three meshlet-local vertices per triangle
+
+	size_t GetTriangleCount() const { return primitiveIndices.size() / 3; }
+};
+
+// Splits an indexed triangle list into clusters sized for mesh shaders. Until those are used the clusters
+// are culled on the CPU and the surviving runs drawn from a meshlet-ordered index buffer.
+class MeshletBuilder
+{
+public:
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+
+	// Greedy growth: the next triangle is the one sharing the most vertices with the open meshlet
+	static MeshletData Build(const std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices,
+		uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+	static MeshletData Build(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+	// Mesh index list with each meshlet's triangles stored contiguously, in meshlet order
+	static std::vector<uint32_t> BuildIndexBuffer(const MeshletData& meshletData);
+
+	// Frustum test against the bounding sphere plus normal cone backface test, all in mesh local space.
+	// frustum may be null to skip the frustum test.
+	static void Cull(const MeshletData& meshletData, const DirectX::BoundingFrustum* frustum,
+		const DirectX::XMFLOAT3& eyePos, std::vector<uint32_t>& visibleMeshlets);
+	static bool IsBackfacing(const MeshletBounds& bounds, const DirectX::XMFLOAT3& eyePos);
+};
+} // namespace Lunar
@@ -0,0 +1,376 @@
+#include "ObjImporter.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+#include "TangentGenerator.h"
+#include "../Utils/Logger.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+// Cursor over one line of the mapped file; numbers are parsed in place with from_chars
+struct LineReader
+{
+	const char* current;
+	const char* end;
+
+	void SkipSpaces()
+	{
+		while (current < end && (*current == ' ' || *current == '\t')) ++current;
+	}
+
+	bool AtEnd()
+	{
+		SkipSpaces();
+		return current >= end;
+	}
+
+	string_view ReadToken()
+	{
+		SkipSpaces();
+		const char* start = current;
+		while (current < end && *current != ' ' && *current != '\t') ++current;
+		return string_view(start, current - start);
+	}
+
+	void SkipToSpace()
+	{
+		while (current < end && *current != ' ' && *current != '\t') ++current;
+	}
+
+	string_view ReadRest()
+	{
+		SkipSpaces();
+		const char* last = end;
+		while (last > current && (last[-1] == ' ' || last[-1] == '\t')) --last;
+		return string_view(current, last - current);
+	}
+
+	float ReadFloat()
+	{
+		SkipSpaces();
+		float value = 0.0f;
+		if (current < end && *current == '+') ++current;
+		current = from_chars(current, end, value).ptr;
+		return value;
+	}
+
+	bool ReadInt(int& value)
+	{
+		auto result = from_chars(current, end, value);
+		if (result.ec != errc()) return false;
+		current = result.ptr;
+		return true;
+	}
+};
+
+struct CornerKey
+{
+	int position;
+	int texCoord;
+	int normal;
+
+	bool operator==(const CornerKey& other) const
+	{
+		return position == other.position && texCoord == other.texCoord && normal == other.normal;
+	}
+};
+
+struct CornerKeyHash
+{
+	size_t operator()(const CornerKey& key) const
+	{
+		uint64_t hash = static_cast<uint32_t>(key.position) * 0x9E3779B97F4A7C15ull;
+		hash ^= static_cast<uint32_t>(key.texCoord) * 0xC2B2AE3D27D4EB4Full + (hash << 6) + (hash >> 2);
+		hash ^= static_cast<uint32_t>(key.normal) * 0x165667B19E3779F9ull + (hash << 6) + (hash >> 2);
+		return static_cast<size_t>(hash);
+	}
+};
+
+// OBJ indices are 1-based, negative values count back from the current end
+int ResolveIndex(int index, size_t count)
+{
+	if (index > 0) return index - 1;
+	if (index < 0) return static_cast<int>(count) + index;
+	return -1;
+}
+
+template <size_t N>
+void CopyName(char (&destination)[N], string_view source)
+{
+	size_t length = min(source.size(), N - 1);
+	memcpy(destination, source.data(), length);
+	destination[length] = '\0';
+}
+
+void LoadMaterialLibrary(const string& filePath, vector<MeshFileMaterial>& materials, unordered_map<string, uint32_t>& materialIndices)
+{
+	MappedFile file;
+	if (!file.Open(filePath))
+	{
+		LOG_WARNING("Material library not found: ", filePath);
+		return;
+	}
+
+	const char* cursor = reinterpret_cast<const char*>(file.GetData());
+	const char* fileEnd = cursor + file.GetSize();
+	MeshFileMaterial* material = nullptr;
+	while (cursor < fileEnd)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', fileEnd - cursor));
+		if (!lineEnd) lineEnd = fileEnd;
+		LineReader line = { cursor, lineEnd > cursor && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd };
+		cursor = lineEnd + 1;
+
+		string_view keyword = line.ReadToken();
+		if (keyword == "newmtl")
+		{
+			string name(line.ReadRest());
+			materialIndices[name] = static_cast<uint32_t>(materials.size());
+			MeshFileMaterial newMaterial = {};
+			CopyName(newMaterial.name, name);
+			newMaterial.baseColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+			newMaterial.roughness = 1.0f;
+			materials.push_back(newMaterial);
+			material = &materials.back();
+		}
+		else if (!material)
+		{
+			continue;
+		}
+		else if (keyword == "Kd")
+		{
+			material->baseColor.x = line.ReadFloat();
+			material->baseColor.y = line.ReadFloat();
+			material->baseColor.z = line.ReadFloat();
+		}
+		else if (keyword == "d")
+		{
+			material->baseColor.w = line.ReadFloat();
+		}
+		else if (keyword == "Pm")
+		{
+			material->metallic = line.ReadFloat();
+		}
+		else if (keyword == "Pr")
+		{
+			material->roughness = line.ReadFloat();
+		}
+	}
+}
+}
+
+bool ObjImporter::Import(const string& filePath, MeshFileData& outData)
+{
+	LOG_FUNCTION_ENTRY();
+
+	MappedFile file;
+	if (!file.Open(filePath)) return false;
+
+	const size_t separator = filePath.find_last_of("/\\");
+	const string directory = separator == string::npos ? string() : filePath.substr(0, separator + 1);
+
+	vector<XMFLOAT3> positions;
+	vector<XMFLOAT2> texCoords;
+	vector<XMFLOAT3> normals;
+	unordered_map<CornerKey, uint32_t, CornerKeyHash> cornerVertices;
+	unordered_map<string, uint32_t> materialIndices;
+	vector<bool> missingNormals;
+	vector<uint32_t> polygon;
+
+	outData.vertices.clear();
+	outData.indices.clear();
+	outData.submeshes.clear();
+	outData.materials.clear();
+
+	auto beginSubmesh = [&outData](uint32_t materialIndex)
+	{
+		MeshFileSubmesh& last = outData.submeshes.back();
+		if (last.indexCount == 0)
+		{
+			last.materialIndex = materialIndex;
+			return;
+		}
+		MeshFileSubmesh submesh = {};
+		submesh.startIndex = static_cast<uint32_t>(outData.indices.size());
+		submesh.materialIndex = materialIndex;
+		outData.submeshes.push_back(submesh);
+	};
+	// faces before the first usemtl have no material until the end
+	constexpr uint32_t noMaterial = UINT32_MAX;
+	outData.submeshes.push_back({});
+	outData.submeshes.back().materialIndex = noMaterial;
+
+	const char* cursor = reinterpret_cast<const char*>(file.GetData());
+	const char* fileEnd = cursor + file.GetSize();
+	while (cursor < fileEnd)
+	{
+		const char* lineEnd = static_cast<const char*>(memchr(cursor, '\n', fileEnd - cursor));
+		if (!lineEnd) lineEnd = fileEnd;
+		LineReader line = { cursor, lineEnd > cursor && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd };
+		cursor = lineEnd + 1;
+
+		string_view keyword = line.ReadToken();
+		if (keyword == "v")
+		{
+			float x = line.ReadFloat();
+			float y = line.ReadFloat();
+			float z = line.ReadFloat();
+			positions.push_back({ x, y, -z });
+		}
+		else if (keyword == "vt")
+		{
+			float u = line.ReadFloat();
+			float v = line.ReadFloat();
+			texCoords.push_back({ u, 1.0f - v });
+		}
+		else if (keyword == "vn")
+		{
+			float x = line.ReadFloat();
+			float y = line.ReadFloat();
+			float z = line.ReadFloat();
+			normals.push_back({ x, y, -z });
+		}
+		else if (keyword == "f")
+		{
+			polygon.clear();
+			while (!line.AtEnd())
+			{
+				CornerKey key = { 0, 0, 0 };
+				line.ReadInt(key.position);
+				if (line.current < line.end && *line.current == '/')
+				{
+					++line.current;
+					line.ReadInt(key.texCoord);
+					if (line.current < line.end && *line.current == '/')
+					{
+						++line.current;
+						line.ReadInt(key.normal);
+					}
+				}
+				line.SkipToSpace();	// skip anything malformed up to the next corner
+
+				key.position = ResolveIndex(key.position, positions.size());
+				key.texCoord = ResolveIndex(key.texCoord, texCoords.size());
+				key.normal = ResolveIndex(key.normal, normals.size());
+				if (key.position < 0 || key.position >= static_cast<int>(positions.size()))
+				{
+					LOG_ERROR("Face references a missing position in ", filePath);
+					return false;
+				}
+				if (key.texCoord >= static_cast<int>(texCoords.size())) key.texCoord = -1;
+				if (key.normal >= static_cast<int>(normals.size())) key.normal = -1;
+
+				auto [it, inserted] = cornerVertices.try_emplace(key, static_cast<uint32_t>(outData.vertices.size()));
+				if (inserted)
+				{
+					Vertex vertex = {};
+					vertex.pos = positions[key.position];
+					vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+					if (key.texCoord >= 0) vertex.texCoord = texCoords[key.texCoord];
+					if (key.normal >= 0) vertex.normal = normals[key.normal];
+					outData.vertices.push_back(vertex);
+					missingNormals.push_back(key.normal < 0);
+				}
+				polygon.push_back(it->second);
+			}
+
+			// mirroring z flips the handedness, so the fan is emitted with reversed winding
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				outData.indices.push_back(polygon[0]);
+				outData.indices.push_back(polygon[i]);
+				outData.indices.push_back(polygon[i - 1]);
+			}
+			outData.submeshes.back().indexCount = static_cast<uint32_t>(outData.indices.size()) - outData.submeshes.back().startIndex;
+		}
+		else if (keyword == "usemtl")
+		{
+			string name(line.ReadRest());
+			auto it = materialIndices.find(name);
+			if (it == materialIndices.end())
+			{
+				it = materialIndices.emplace(name, static_cast<uint32_t>(outData.materials.size())).first;
+				MeshFileMaterial material = {};
+				CopyName(material.name, name);
+				material.baseColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+				material.roughness = 1.0f;
+				outData.materials.push_back(material);
+			}
+			beginSubmesh(it->second);
+		}
+		else if (keyword == "mtllib")
+		{
+			LoadMaterialLibrary(directory + string(line.ReadRest()), outData.materials, materialIndices);
+		}
+	}
+
+	if (outData.indices.empty())
+	{
+		LOG_ERROR("No faces found in ", filePath);
+		return false;
+	}
+	if (outData.submeshes.back().indexCount == 0) outData.submeshes.pop_back();
+	if (outData.submeshes[0].materialIndex == noMaterial)
+	{
+		MeshFileMaterial material = {};
+		CopyName(material.name, "default");
+		material.baseColor = { 1.0f, 1.0f, 1.0f, 1.0f };
+		material.roughness = 1.0f;
+		outData.submeshes[0].materialIndex = static_cast<uint32_t>(outData.materials.size());
+		outData.materials.push_back(material);
+	}
+
+	// smooth normals for corners without one: accumulate area-weighted face normals per position
+	bool anyMissing = false;
+	for (bool missing : missingNormals) anyMissing |= missing;
+	if (anyMissing)
+	{
+		vector<XMFLOAT3> positionNormals(positions.size(), { 0.0f, 0.0f, 0.0f });
+		vector<int> vertexPositions(outData.vertices.size());
+		for (const auto& [key, vertexIndex] : cornerVertices) vertexPositions[vertexIndex] = key.position;
+
+		for (size_t i = 0; i < outData.indices.size(); i += 3)
+		{
+			uint32_t i0 = outData.indices[i], i1 = outData.indices[i + 1], i2 = outData.indices[i + 2];
+			XMVECTOR p0 = XMLoadFloat3(&outData.vertices[i0].pos);
+			XMVECTOR faceNormal = XMVector3Cross(
+				XMVectorSubtract(XMLoadFloat3(&outData.vertices[i1].pos), p0),
+				XMVectorSubtract(XMLoadFloat3(&outData.vertices[i2].pos), p0));
+			for (uint32_t corner : { i0, i1, i2 })
+			{
+				XMFLOAT3& accumulated = positionNormals[vertexPositions[corner]];
+				XMStoreFloat3(&accumulated, XMVectorAdd(XMLoadFloat3(&accumulated), faceNormal));
+			}
+		}
+		for (size_t i = 0; i < outData.vertices.size(); ++i)
+		{
+			if (!missingNormals[i]) continue;
+			XMStoreFloat3(&outData.vertices[i].normal, XMVector3Normalize(XMLoadFloat3(&positionNormals[vertexPositions[i]])));
+		}
+	}
+
+	bool parallel = outData.indices.size() / 3 >= TangentGenerator::PARALLEL_TRIANGLE_THRESHOLD;
+	TangentGenerator::Generate(outData.vertices, outData.indices, parallel);
+
+	LOG_DEBUG("OBJ imported: ", filePath, " (", outData.vertices.size(), " vertices, ", outData.indices.size() / 3,
+		" triangles, ", outData.submeshes.size(), " submeshes)");
+	return true;
+}
+
+bool ObjImporter::ConvertToMeshFile(const string& objPath, const string& meshPath, VertexFormat vertexFormat)
+{
+	MeshFileData data;
+	if (!Import(objPath, data)) return false;
+	data.vertexFormat = vertexFormat;
+	return MeshFile::Write(meshPath, data);
+}
+} // namespace Lunar
@@ -0,0 +1,17 @@
+#pragma once
+#include <string>
+
+#include "MeshFile.h"
+
+namespace Lunar
+{
+// Wavefront OBJ + MTL reader. Polygons are fanned into triangles, every usemtl run becomes a submesh,
+// and the right-handed OBJ space is mirrored on z (with the winding reversed) into the engine's
+// left-handed space. Missing normals are smoothed per position; tangents are always regenerated.
+class ObjImporter
+{
+public:
+	static bool Import(const std::string& filePath, MeshFileData& outData);
+	static bool ConvertToMeshFile(const std::string& objPath, const std::string& meshPath, VertexFormat vertexFormat = VertexFormat::Default);
+};
+} // namespace Lunar
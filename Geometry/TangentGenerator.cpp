@@ -0,0 +1,293 @@
+#include "TangentGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../Utils/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+constexpr size_t BATCH_TRIANGLES = 4;				// one triangle per lane
+constexpr size_t PARALLEL_CHUNK_BATCHES = 1024;		// batches per pool task, whatever the thread count
+constexpr size_t PARALLEL_CHUNK_VERTICES = 4096;	// vertices per pool task, a multiple of four
+constexpr size_t PARALLEL_BLOCK_BATCHES = 16384;	// batches computed before their sums are added up
+constexpr float  MIN_TANGENT_LENGTH_SQ = 1e-12f;
+
+// Unit face tangents of four triangles, w = handedness of the face, with the angle of each corner in one lane
+// per triangle. Summed up per vertex with the angles as weights, xyz is the tangent and the sign of w the
+// handedness.
+struct TriangleBatch
+{
+	XMFLOAT4 tangents[BATCH_TRIANGLES];
+	XMFLOAT4 cornerAngles[3];
+};
+
+XMVECTOR Dot3(FXMVECTOR ax, FXMVECTOR ay, FXMVECTOR az, FXMVECTOR bx, FXMVECTOR by, FXMVECTOR bz)
+{
+	return XMVectorMultiplyAdd(az, bz, XMVectorMultiplyAdd(ay, by, XMVectorMultiply(ax, bx)));
+}
+
+// Transposes four float4s, one per lane, into x, y, z and w vectors
+void TransposeLanes(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c, GXMVECTOR d, XMVECTOR& outX, XMVECTOR& outY, XMVECTOR& outZ, XMVECTOR& outW)
+{
+	XMVECTOR abXY = XMVectorMergeXY(a, b);
+	XMVECTOR cdXY = XMVectorMergeXY(c, d);
+	XMVECTOR abZW = XMVectorMergeZW(a, b);
+	XMVECTOR cdZW = XMVectorMergeZW(c, d);
+	outX = XMVectorPermute<0, 1, 4, 5>(abXY, cdXY);
+	outY = XMVectorPermute<2, 3, 6, 7>(abXY, cdXY);
+	outZ = XMVectorPermute<0, 1, 4, 5>(abZW, cdZW);
+	outW = XMVectorPermute<2, 3, 6, 7>(abZW, cdZW);
+}
+
+void TransposeLanes(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c, GXMVECTOR d, XMVECTOR& outX, XMVECTOR& outY, XMVECTOR& outZ)
+{
+	XMVECTOR unusedW;
+	TransposeLanes(a, b, c, d, outX, outY, outZ, unusedW);
+}
+
+// Inverse of TransposeLanes, with w as the fourth component of each float4
+void UntransposeLanes(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR w, XMVECTOR out[4])
+{
+	XMVECTOR xy01 = XMVectorMergeXY(x, y);
+	XMVECTOR zw01 = XMVectorMergeXY(z, w);
+	XMVECTOR xy23 = XMVectorMergeZW(x, y);
+	XMVECTOR zw23 = XMVectorMergeZW(z, w);
+	out[0] = XMVectorPermute<0, 1, 4, 5>(xy01, zw01);
+	out[1] = XMVectorPermute<2, 3, 6, 7>(xy01, zw01);
+	out[2] = XMVectorPermute<0, 1, 4, 5>(xy23, zw23);
+	out[3] = XMVectorPermute<2, 3, 6, 7>(xy23, zw23);
+}
+
+void StoreLanes(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, GXMVECTOR w, XMFLOAT4 out[4])
+{
+	XMVECTOR lanes[4];
+	UntransposeLanes(x, y, z, w, lanes);
+	for (int lane = 0; lane < 4; ++lane)
+	{
+		XMStoreFloat4(&out[lane], lanes[lane]);
+	}
+}
+
+// Four triangles go through the face frames and corner angles together, one per lane, so every position and
+// UV is read once and two arccosines cover twelve corners. batchIndices holds the twelve corner indices;
+// degenerate triangles come out zero.
+template <typename IndexType>
+void ComputeTriangleBatch(const vector<Vertex>& vertices, const IndexType* batchIndices, TriangleBatch& batch)
+{
+	// edges and UV deltas from corner 0 per triangle, then one triangle per lane
+	XMVECTOR edges01[BATCH_TRIANGLES], edges02[BATCH_TRIANGLES], texCoordDeltas[BATCH_TRIANGLES];
+	for (size_t lane = 0; lane < BATCH_TRIANGLES; ++lane)
+	{
+		const Vertex& corner0 = vertices[batchIndices[lane * 3]];
+		const Vertex& corner1 = vertices[batchIndices[lane * 3 + 1]];
+		const Vertex& corner2 = vertices[batchIndices[lane * 3 + 2]];
+		XMVECTOR pos0 = XMLoadFloat3(&corner0.pos);
+		edges01[lane] = XMVectorSubtract(XMLoadFloat3(&corner1.pos), pos0);
+		edges02[lane] = XMVectorSubtract(XMLoadFloat3(&corner2.pos), pos0);
+		XMVECTOR texCoord0 = XMLoadFloat2(&corner0.texCoord);
+		texCoordDeltas[lane] = XMVectorPermute<0, 1, 4, 5>(XMVectorSubtract(XMLoadFloat2(&corner1.texCoord), texCoord0),
+			XMVectorSubtract(XMLoadFloat2(&corner2.texCoord), texCoord0));
+	}
+	XMVECTOR e01x, e01y, e01z, e02x, e02y, e02z, deltaU1, deltaV1, deltaU2, deltaV2;
+	TransposeLanes(edges01[0], edges01[1], edges01[2], edges01[3], e01x, e01y, e01z);
+	TransposeLanes(edges02[0], edges02[1], edges02[2], edges02[3], e02x, e02y, e02z);
+	TransposeLanes(texCoordDeltas[0], texCoordDeltas[1], texCoordDeltas[2], texCoordDeltas[3], deltaU1, deltaV1, deltaU2, deltaV2);
+
+	XMVECTOR length01Sq = Dot3(e01x, e01y, e01z, e01x, e01y, e01z);
+	XMVECTOR length02Sq = Dot3(e02x, e02y, e02z, e02x, e02y, e02z);
+	XMVECTOR dot0102 = Dot3(e01x, e01y, e01z, e02x, e02y, e02z);
+	// |e01 x e02|^2 = |e01|^2 |e02|^2 - (e01 . e02)^2; slivers whose angle at corner 0 is below about 0.06 degrees
+	// count as degenerate, below that the difference is rounding noise
+	XMVECTOR lengthProduct = XMVectorMultiply(length01Sq, length02Sq);
+	XMVECTOR areaSq = XMVectorNegativeMultiplySubtract(dot0102, dot0102, lengthProduct);
+	XMVECTOR minAreaSq = XMVectorMax(XMVectorMultiply(lengthProduct, XMVectorReplicate(1e-6f)), XMVectorReplicate(1e-20f));
+
+	XMVECTOR det = XMVectorNegativeMultiplySubtract(deltaV1, deltaU2, XMVectorMultiply(deltaU1, deltaV2));
+	XMVECTOR valid = XMVectorAndInt(XMVectorGreater(areaSq, minAreaSq), XMVectorGreaterOrEqual(XMVectorAbs(det), XMVectorReplicate(1e-12f)));
+	// the face tangent is normalized, so of 1 / det only the sign matters
+	XMVECTOR detSign = XMVectorAndInt(det, XMVectorSplatSignMask());
+	XMVECTOR tangentX = XMVectorXorInt(XMVectorNegativeMultiplySubtract(e02x, deltaV1, XMVectorMultiply(e01x, deltaV2)), detSign);
+	XMVECTOR tangentY = XMVectorXorInt(XMVectorNegativeMultiplySubtract(e02y, deltaV1, XMVectorMultiply(e01y, deltaV2)), detSign);
+	XMVECTOR tangentZ = XMVectorXorInt(XMVectorNegativeMultiplySubtract(e02z, deltaV1, XMVectorMultiply(e01z, deltaV2)), detSign);
+	XMVECTOR tangentScale = XMVectorAndInt(XMVectorReciprocalSqrtEst(Dot3(tangentX, tangentY, tangentZ, tangentX, tangentY, tangentZ)), valid);
+
+	// as in MikkTSpace the face is mirrored when its UVs wind the other way round than its corners
+	XMVECTOR handedness = XMVectorOrInt(XMVectorSplatOne(), detSign);
+	StoreLanes(XMVectorMultiply(tangentX, tangentScale), XMVectorMultiply(tangentY, tangentScale), XMVectorMultiply(tangentZ, tangentScale),
+		handedness, batch.tangents);
+
+	// corner 0's angle lies between edges 01 and 02 and corner 1's between 10 and 12, corner 2 gets the rest of
+	// pi; as weights they only need to be roughly right, hence the estimates
+	XMVECTOR length12Sq = XMVectorSubtract(XMVectorAdd(length01Sq, length02Sq), XMVectorAdd(dot0102, dot0102));
+	XMVECTOR cosine0 = XMVectorMultiply(dot0102, XMVectorReciprocalSqrtEst(lengthProduct));
+	XMVECTOR cosine1 = XMVectorMultiply(XMVectorSubtract(length01Sq, dot0102), XMVectorReciprocalSqrtEst(XMVectorMultiply(length01Sq, length12Sq)));
+	// XMVectorACosEst clamps estimates just past +-1 itself
+	XMVECTOR angle0 = XMVectorACosEst(cosine0);
+	XMVECTOR angle1 = XMVectorACosEst(cosine1);
+	XMVECTOR angle2 = XMVectorMax(XMVectorSubtract(XMVectorSubtract(XMVectorReplicate(XM_PI), angle0), angle1), XMVectorZero());
+	XMStoreFloat4(&batch.cornerAngles[0], XMVectorAndInt(angle0, valid));
+	XMStoreFloat4(&batch.cornerAngles[1], XMVectorAndInt(angle1, valid));
+	XMStoreFloat4(&batch.cornerAngles[2], XMVectorAndInt(angle2, valid));
+}
+
+// Adds the weighted face tangents of the batch to the tangentU sums of its corners
+template <typename IndexType>
+void AddTriangleBatch(const IndexType* batchIndices, size_t triangleCount, const TriangleBatch& batch, vector<Vertex>& vertices)
+{
+	for (size_t lane = 0; lane < triangleCount; ++lane)
+	{
+		XMVECTOR tangent = XMLoadFloat4(&batch.tangents[lane]);
+		for (int k = 0; k < 3; ++k)
+		{
+			XMFLOAT4& sum = vertices[batchIndices[lane * 3 + k]].tangentU;
+			XMStoreFloat4(&sum, XMVectorMultiplyAdd(XMVectorReplicate((&batch.cornerAngles[k].x)[lane]), tangent, XMLoadFloat4(&sum)));
+		}
+	}
+}
+
+// Turns the tangentU sum into the tangent and handedness
+void ResolveVertex(Vertex& vertex)
+{
+	// the sum is projected onto the normal plane once here instead of every face tangent on its own
+	XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&vertex.normal));
+	XMVECTOR tangent = XMLoadFloat4(&vertex.tangentU);
+	tangent = XMVectorSubtract(tangent, XMVectorMultiply(normal, XMVector3Dot(normal, tangent)));
+	if (XMVector3Less(XMVector3LengthSq(tangent), XMVectorReplicate(MIN_TANGENT_LENGTH_SQ)))
+	{
+		// no usable UV gradient, any direction in the normal plane will do
+		XMVECTOR axis = fabsf(vertex.normal.x) < 0.9f ? XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+		tangent = XMVector3Cross(XMVector3Cross(normal, axis), normal);
+	}
+	tangent = XMVector3Normalize(tangent);
+	XMStoreFloat4(&vertex.tangentU, XMVectorSetW(tangent, vertex.tangentU.w < 0.0f ? -1.0f : 1.0f));
+}
+
+// Same as ResolveVertex, four vertices at a time; groups with a degenerate normal or tangent go through
+// ResolveVertex instead
+void ResolveVertices(vector<Vertex>& vertices, size_t vertexBegin, size_t vertexEnd)
+{
+	size_t i = vertexBegin;
+	for (; i + 4 <= vertexEnd; i += 4)
+	{
+		XMVECTOR normalX, normalY, normalZ;
+		TransposeLanes(XMLoadFloat3(&vertices[i].normal), XMLoadFloat3(&vertices[i + 1].normal), XMLoadFloat3(&vertices[i + 2].normal),
+			XMLoadFloat3(&vertices[i + 3].normal), normalX, normalY, normalZ);
+		XMVECTOR tangentX, tangentY, tangentZ, handednessSum;
+		TransposeLanes(XMLoadFloat4(&vertices[i].tangentU), XMLoadFloat4(&vertices[i + 1].tangentU), XMLoadFloat4(&vertices[i + 2].tangentU),
+			XMLoadFloat4(&vertices[i + 3].tangentU), tangentX, tangentY, tangentZ, handednessSum);
+
+		// t - n (n . t) / (n . n) saves normalizing n
+		XMVECTOR normalLengthSq = Dot3(normalX, normalY, normalZ, normalX, normalY, normalZ);
+		XMVECTOR projection = XMVectorDivide(Dot3(normalX, normalY, normalZ, tangentX, tangentY, tangentZ), normalLengthSq);
+		tangentX = XMVectorNegativeMultiplySubtract(normalX, projection, tangentX);
+		tangentY = XMVectorNegativeMultiplySubtract(normalY, projection, tangentY);
+		tangentZ = XMVectorNegativeMultiplySubtract(normalZ, projection, tangentZ);
+		XMVECTOR tangentLengthSq = Dot3(tangentX, tangentY, tangentZ, tangentX, tangentY, tangentZ);
+
+		const XMVECTOR minLengthSq = XMVectorReplicate(MIN_TANGENT_LENGTH_SQ);
+		if (!XMVector4EqualInt(XMVectorAndInt(XMVectorGreaterOrEqual(normalLengthSq, minLengthSq), XMVectorGreaterOrEqual(tangentLengthSq, minLengthSq)),
+			XMVectorTrueInt()))
+		{
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				ResolveVertex(vertices[i + lane]);
+			}
+			continue;
+		}
+
+		XMVECTOR tangentScale = XMVectorReciprocalSqrt(tangentLengthSq);
+		XMVECTOR mirrored = XMVectorLess(handednessSum, XMVectorZero());
+		XMVECTOR tangents[4];
+		UntransposeLanes(XMVectorMultiply(tangentX, tangentScale), XMVectorMultiply(tangentY, tangentScale), XMVectorMultiply(tangentZ, tangentScale),
+			XMVectorSelect(XMVectorSplatOne(), XMVectorReplicate(-1.0f), mirrored), tangents);
+		for (size_t lane = 0; lane < 4; ++lane)
+		{
+			XMStoreFloat4(&vertices[i + lane].tangentU, tangents[lane]);
+		}
+	}
+	for (; i < vertexEnd; ++i)
+	{
+		ResolveVertex(vertices[i]);
+	}
+}
+
+template <typename IndexType>
+void GenerateTangents(vector<Vertex>& vertices, const vector<IndexType>& indices, bool parallel)
+{
+	const size_t vertexCount = vertices.size();
+	const size_t triangleCount = indices.size() / 3;
+	const size_t batchCount = (triangleCount + BATCH_TRIANGLES - 1) / BATCH_TRIANGLES;
+	// tangentU holds the sums until ResolveVertices
+	for (Vertex& vertex : vertices)
+	{
+		vertex.tangentU = { 0.0f, 0.0f, 0.0f, 0.0f };
+	}
+
+	// a short last batch repeats its first triangle in the spare lanes, AddTriangleBatch leaves them out
+	IndexType lastBatchIndices[BATCH_TRIANGLES * 3] = {};
+	const size_t lastBatchFirst = batchCount > 0 ? (batchCount - 1) * BATCH_TRIANGLES * 3 : 0;
+	for (size_t i = 0; batchCount > 0 && i < BATCH_TRIANGLES * 3; ++i)
+	{
+		size_t index = lastBatchFirst + i;
+		lastBatchIndices[i] = index < triangleCount * 3 ? indices[index] : indices[lastBatchFirst + i % 3];
+	}
+	auto getBatchIndices = [&](size_t batch) { return batch + 1 < batchCount ? &indices[batch * BATCH_TRIANGLES * 3] : lastBatchIndices; };
+	auto getBatchTriangles = [triangleCount](size_t batch) { return min(BATCH_TRIANGLES, triangleCount - batch * BATCH_TRIANGLES); };
+
+	if (!parallel)
+	{
+		TriangleBatch batch;
+		for (size_t b = 0; b < batchCount; ++b)
+		{
+			ComputeTriangleBatch(vertices, getBatchIndices(b), batch);
+			AddTriangleBatch(getBatchIndices(b), getBatchTriangles(b), batch, vertices);
+		}
+		ResolveVertices(vertices, 0, vertexCount);
+		return;
+	}
+
+	// Fixed-size chunks compute the face frames on the pool and the sums are then added in triangle order, so
+	// the result is the serial one bit for bit whatever the thread count
+	ThreadPool& threadPool = ThreadPool::GetInstance();
+	vector<TriangleBatch> batches(min(batchCount, PARALLEL_BLOCK_BATCHES));
+	for (size_t blockBegin = 0; blockBegin < batchCount; blockBegin += PARALLEL_BLOCK_BATCHES)
+	{
+		const size_t blockSize = min(PARALLEL_BLOCK_BATCHES, batchCount - blockBegin);
+		const size_t chunkCount = (blockSize + PARALLEL_CHUNK_BATCHES - 1) / PARALLEL_CHUNK_BATCHES;
+		threadPool.ParallelFor(chunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd)
+		{
+			for (size_t i = chunkBegin * PARALLEL_CHUNK_BATCHES; i < min(chunkEnd * PARALLEL_CHUNK_BATCHES, blockSize); ++i)
+			{
+				ComputeTriangleBatch(vertices, getBatchIndices(blockBegin + i), batches[i]);
+			}
+		});
+		for (size_t i = 0; i < blockSize; ++i)
+		{
+			AddTriangleBatch(getBatchIndices(blockBegin + i), getBatchTriangles(blockBegin + i), batches[i], vertices);
+		}
+	}
+
+	const size_t vertexChunkCount = (vertexCount + PARALLEL_CHUNK_VERTICES - 1) / PARALLEL_CHUNK_VERTICES;
+	threadPool.ParallelFor(vertexChunkCount, 1, [&](size_t chunkBegin, size_t chunkEnd)
+	{
+		ResolveVertices(vertices, chunkBegin * PARALLEL_CHUNK_VERTICES, min(chunkEnd * PARALLEL_CHUNK_VERTICES, vertexCount));
+	});
+}
+}
+
+void TangentGenerator::Generate(vector<Vertex>& vertices, const vector<uint16_t>& indices, bool parallel)
+{
+	GenerateTangents(vertices, indices, parallel);
+}
+
+void TangentGenerator::Generate(vector<Vertex>& vertices, const vector<uint32_t>& indices, bool parallel)
+{
+	GenerateTangents(vertices, indices, parallel);
+}
+} // namespace Lunar
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+namespace Lunar
+{
+// Per-vertex tangent frames following the MikkTSpace conventions: unit face tangents are accumulated with
+// corner-angle weights and projected onto the vertex normal plane, tangentU.xyz is orthonormal to the normal
+// and tangentU.w holds the handedness, so B = tangentU.w * cross(N, T). A face is mirrored when its UVs wind
+// the other way round than its corners. Vertices are not split where adjacent faces disagree on handedness,
+// the larger corner angle sum wins.
+class TangentGenerator
+{
+public:
+	// Below this many triangles the parallel path costs more than it saves
+	static constexpr size_t PARALLEL_TRIANGLE_THRESHOLD = 4096;
+
+	// In parallel mode fixed-size triangle chunks are weighted on the pool and their sums added in triangle
+	// order, so both modes give the same result on any machine
+	static void Generate(std::vector<Vertex>& vertices, const std::vector<uint16_t>& indices, bool parallel);
+	static void Generate(std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, bool parallel);
+};
+} // namespace Lunar
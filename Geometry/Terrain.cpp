@@ -0,0 +1,121 @@
+#include "Terrain.h"
+
+#include <algorithm>
+
+#include "../Utils/Logger.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+void Terrain::Initialize(ID3D12Device* device)
+{
+	LOG_FUNCTION_ENTRY();
+	m_device = device;
+	CreateGeometry();
+	m_objectCB = make_unique<ConstantBuffer>(device, sizeof(ObjectConstants));
+
+	// the root is always resident so there is something to draw while the rest streams in
+	UploadChunk(m_quadTree->BuildChunkMesh(m_quadTree->GetRootIndex()));
+	m_selectedNodes = { m_quadTree->GetRootIndex() };
+}
+
+void Terrain::CreateGeometry()
+{
+	if (!m_heightfield)
+	{
+		auto heightfield = make_shared<Heightfield>();
+		heightfield->GenerateFractalNoise(257, 1337);
+		m_heightfield = heightfield;
+	}
+
+	m_quadTree->Build(m_heightfield, m_settings);
+	m_localBoundingBox = m_quadTree->GetNode(m_quadTree->GetRootIndex()).bounds;
+	m_chunks.assign(m_quadTree->GetNodeCount(), ChunkBuffers());
+	m_streamer.Reset(m_quadTree);
+}
+
+void Terrain::Draw(ID3D12GraphicsCommandList* commandList)
+{
+	if (m_needsConstantBufferUpdate)
+	{
+		UpdateObjectConstants();
+	}
+
+	BindObjectConstants(commandList);
+	commandList->IASetPrimitiveTopology(m_topologyType);
+	for (uint32_t nodeIndex : m_selectedNodes)
+	{
+		const ChunkBuffers& chunk = m_chunks[nodeIndex];
+		commandList->IASetVertexBuffers(0, 1, &chunk.vertexBufferView);
+		commandList->IASetIndexBuffer(&chunk.indexBufferView);
+		commandList->DrawIndexedInstanced(chunk.indexCount, 1, 0, 0, 0);
+	}
+}
+
+void Terrain::UpdateLOD(const ViewInfo& viewInfo)
+{
+	m_streamer.BeginFrame(m_readyChunks);
+	for (const TerrainChunkMesh& mesh : m_readyChunks)
+	{
+		UploadChunk(mesh);
+	}
+
+	// selection runs in terrain local space; m_objectConstants.World is stored transposed
+	XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&m_objectConstants.World));
+	XMMATRIX invWorld = XMMatrixInverse(nullptr, world);
+	XMMATRIX invView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&viewInfo.view));
+
+	XMFLOAT3 eyePos;
+	XMStoreFloat3(&eyePos, XMVector3TransformCoord(XMLoadFloat3(&viewInfo.eyePos), invWorld));
+	BoundingFrustum frustum(XMLoadFloat4x4(&viewInfo.projection));
+	frustum.Transform(frustum, invView * invWorld);
+
+	m_quadTree->Select(eyePos, &frustum,
+		[this](uint32_t nodeIndex) { return m_streamer.IsResident(nodeIndex); },
+		m_selectedNodes, m_missingNodes);
+	m_streamer.Touch(m_selectedNodes);
+
+	m_streamer.Request(m_missingNodes, m_readyChunks);
+	for (const TerrainChunkMesh& mesh : m_readyChunks)
+	{
+		UploadChunk(mesh);
+	}
+
+	m_streamer.Evict(m_evictedNodes);
+	for (uint32_t nodeIndex : m_evictedNodes)
+	{
+		m_retiredChunks.emplace_back(m_streamer.GetFrame(), move(m_chunks[nodeIndex]));
+		m_chunks[nodeIndex] = ChunkBuffers();
+	}
+
+	// a few frames may still be in flight when a chunk is evicted
+	const uint64_t frame = m_streamer.GetFrame();
+	m_retiredChunks.erase(remove_if(m_retiredChunks.begin(), m_retiredChunks.end(),
+		[frame](const pair<uint64_t, ChunkBuffers>& retired) { return retired.first + 3 <= frame; }),
+		m_retiredChunks.end());
+}
+
+void Terrain::UploadChunk(const TerrainChunkMesh& mesh)
+{
+	ChunkBuffers& chunk = m_chunks[mesh.nodeIndex];
+
+	const UINT vertexStride = VertexFormatUtils::GetStride(m_vertexFormat);
+	const UINT vbByteSize = static_cast<UINT>(mesh.vertices.size() * vertexStride);
+	vector<uint8_t> vertexData = VertexFormatUtils::PackVertices(mesh.vertices, m_vertexFormat);
+	chunk.vertexBuffer = CreateUploadBuffer(m_device, vertexData.data(), vbByteSize);
+	chunk.vertexBufferView.BufferLocation = chunk.vertexBuffer->GetGPUVirtualAddress();
+	chunk.vertexBufferView.StrideInBytes = vertexStride;
+	chunk.vertexBufferView.SizeInBytes = vbByteSize;
+
+	const UINT ibByteSize = static_cast<UINT>(mesh.indices.size() * sizeof(uint16_t));
+	chunk.indexBuffer = CreateUploadBuffer(m_device, mesh.indices.data(), ibByteSize);
+	chunk.indexBufferView.BufferLocation = chunk.indexBuffer->GetGPUVirtualAddress();
+	chunk.indexBufferView.Format = DXGI_FORMAT_R16_UINT;
+	chunk.indexBufferView.SizeInBytes = ibByteSize;
+
+	chunk.indexCount = static_cast<UINT>(mesh.indices.size());
+	m_streamer.MarkResident(mesh.nodeIndex);
+}
+} // namespace Lunar
@@ -0,0 +1,63 @@
+#pragma once
+#include <memory>
+#include <vector>
+
+#include "Geometry.h"
+#include "Heightfield.h"
+#include "TerrainQuadTree.h"
+#include "TerrainStreamer.h"
+
+namespace Lunar
+{
+// Heightfield terrain drawn as a set of quadtree chunks picked every frame in UpdateLOD.
+// TerrainStreamer builds chunk meshes on ThreadPool workers and hands them back a few per frame for upload;
+// until all four children of a node are resident the node itself keeps being drawn.
+class Terrain : public Geometry
+{
+public:
+	Terrain() = default;
+	~Terrain() override = default;
+
+	void Initialize(ID3D12Device* device) override;
+	void CreateGeometry() override;
+	void Draw(ID3D12GraphicsCommandList* commandList) override;
+	void DrawNormals(ID3D12GraphicsCommandList* commandList) override {}
+	void UpdateLOD(const ViewInfo& viewInfo) override;
+
+	// must be called before Initialize; a fractal noise heightfield is generated when none is set
+	void SetHeightfield(std::shared_ptr<const Heightfield> heightfield) { m_heightfield = std::move(heightfield); }
+	void SetSettings(const TerrainSettings& settings) { m_settings = settings; }
+	void SetStreaming(bool streaming) { m_streamer.SetStreaming(streaming); }
+	void SetMaxResidentChunks(uint32_t maxResidentChunks) { m_streamer.SetMaxResidentChunks(maxResidentChunks); }
+
+	const std::shared_ptr<const Heightfield>& GetHeightfield() const { return m_heightfield; }
+	const TerrainQuadTree& GetQuadTree() const { return *m_quadTree; }
+	size_t                 GetSelectedChunkCount() const { return m_selectedNodes.size(); }
+	uint32_t               GetResidentChunkCount() const { return m_streamer.GetResidentChunkCount(); }
+
+private:
+	struct ChunkBuffers
+	{
+		Microsoft::WRL::ComPtr<ID3D12Resource> vertexBuffer;
+		Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer;
+		D3D12_VERTEX_BUFFER_VIEW               vertexBufferView = {};
+		D3D12_INDEX_BUFFER_VIEW                indexBufferView = {};
+		UINT                                   indexCount = 0;
+	};
+
+	void UploadChunk(const TerrainChunkMesh& mesh);
+
+	ID3D12Device*                           m_device = nullptr;
+	std::shared_ptr<const Heightfield>      m_heightfield;
+	std::shared_ptr<TerrainQuadTree>        m_quadTree = std::make_shared<TerrainQuadTree>();
+	TerrainStreamer                         m_streamer;
+	TerrainSettings                         m_settings;
+
+	std::vector<ChunkBuffers>               m_chunks;
+	std::vector<uint32_t>                   m_selectedNodes;
+	std::vector<uint32_t>                   m_missingNodes;
+	std::vector<TerrainChunkMesh>           m_readyChunks;
+	std::vector<uint32_t>                   m_evictedNodes;
+	std::vector<std::pair<uint64_t, ChunkBuffers>> m_retiredChunks;	// kept until the GPU is done with them
+};
+} // namespace Lunar
@@ -0,0 +1,255 @@
+#include "TerrainQuadTree.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "TangentGenerator.h"
+#include "../Utils/Logger.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+float DistanceToBox(const XMFLOAT3& point, const BoundingBox& box)
+{
+	float dx = max(fabsf(point.x - box.Center.x) - box.Extents.x, 0.0f);
+	float dy = max(fabsf(point.y - box.Center.y) - box.Extents.y, 0.0f);
+	float dz = max(fabsf(point.z - box.Center.z) - box.Extents.z, 0.0f);
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+}
+
+void TerrainQuadTree::Build(shared_ptr<const Heightfield> heightfield, const TerrainSettings& settings)
+{
+	m_heightfield = move(heightfield);
+	m_settings = settings;
+	m_settings.lodLevelCount = clamp(m_settings.lodLevelCount, 1u, 12u);
+	// (R + 1)^2 grid vertices plus 4 (R + 1) skirt vertices must fit 16-bit indices
+	m_settings.chunkResolution = clamp(m_settings.chunkResolution, 2u, 128u);
+
+	const uint32_t levelCount = m_settings.lodLevelCount;
+	m_levelOffsets.assign(levelCount, 0);
+	uint32_t nodeCount = 0;
+	for (int level = static_cast<int>(levelCount) - 1; level >= 0; --level)
+	{
+		m_levelOffsets[level] = nodeCount;
+		nodeCount += GetNodesPerEdge(level) * GetNodesPerEdge(level);
+	}
+	m_nodes.resize(nodeCount);
+
+	// leaves read the heightfield, parents merge their children
+	vector<float> minHeights(nodeCount);
+	vector<float> maxHeights(nodeCount);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		const uint32_t nodesPerEdge = GetNodesPerEdge(level);
+		for (uint32_t z = 0; z < nodesPerEdge; ++z)
+		{
+			for (uint32_t x = 0; x < nodesPerEdge; ++x)
+			{
+				uint32_t index = GetNodeIndex(level, x, z);
+				if (level == 0)
+				{
+					float step = 1.0f / nodesPerEdge;
+					m_heightfield->GetHeightRange(x * step, z * step, (x + 1) * step, (z + 1) * step, minHeights[index], maxHeights[index]);
+				}
+				else
+				{
+					minHeights[index] = FLT_MAX;
+					maxHeights[index] = -FLT_MAX;
+					for (uint32_t child = 0; child < 4; ++child)
+					{
+						uint32_t childIndex = GetNodeIndex(level - 1, x * 2 + (child & 1), z * 2 + (child >> 1));
+						minHeights[index] = min(minHeights[index], minHeights[childIndex]);
+						maxHeights[index] = max(maxHeights[index], maxHeights[childIndex]);
+					}
+				}
+
+				const float nodeSize = m_settings.worldSize / nodesPerEdge;
+				const float halfSize = m_settings.worldSize * 0.5f;
+				float minY = minHeights[index] * m_settings.heightScale - GetSkirtDepth(level);
+				float maxY = maxHeights[index] * m_settings.heightScale;
+
+				TerrainNode& node = m_nodes[index];
+				node.level = level;
+				node.x = x;
+				node.z = z;
+				// heightfield v runs from +z (north) to -z
+				node.bounds.Center = XMFLOAT3(-halfSize + (x + 0.5f) * nodeSize, (minY + maxY) * 0.5f, halfSize - (z + 0.5f) * nodeSize);
+				node.bounds.Extents = XMFLOAT3(nodeSize * 0.5f, (maxY - minY) * 0.5f, nodeSize * 0.5f);
+			}
+		}
+	}
+
+	LOG_DEBUG("Terrain quadtree: ", levelCount, " levels, ", nodeCount, " nodes, ", m_settings.chunkResolution, " quads per chunk edge");
+}
+
+uint32_t TerrainQuadTree::GetNodeIndex(uint32_t level, uint32_t x, uint32_t z) const
+{
+	return m_levelOffsets[level] + z * GetNodesPerEdge(level) + x;
+}
+
+uint32_t TerrainQuadTree::GetParentIndex(uint32_t nodeIndex) const
+{
+	const TerrainNode& node = m_nodes[nodeIndex];
+	if (node.level + 1 >= m_settings.lodLevelCount) return GetRootIndex();
+	return GetNodeIndex(node.level + 1, node.x / 2, node.z / 2);
+}
+
+float TerrainQuadTree::GetLODRange(uint32_t level) const
+{
+	return m_settings.lodDistance * static_cast<float>(1u << level);
+}
+
+float TerrainQuadTree::GetSkirtDepth(uint32_t level) const
+{
+	float cellSize = m_settings.worldSize / GetNodesPerEdge(level) / m_settings.chunkResolution;
+	return cellSize * m_settings.skirtDepthScale;
+}
+
+void TerrainQuadTree::Select(
+	const XMFLOAT3&                 eyePos,
+	const BoundingFrustum*          frustum,
+	const function<bool(uint32_t)>& isResident,
+	vector<uint32_t>&               selectedNodes,
+	vector<uint32_t>&               missingNodes) const
+{
+	selectedNodes.clear();
+	missingNodes.clear();
+	if (m_nodes.empty()) return;
+	SelectNode(GetRootIndex(), eyePos, frustum, isResident, selectedNodes, missingNodes);
+}
+
+void TerrainQuadTree::SelectNode(
+	uint32_t nodeIndex, const XMFLOAT3& eyePos, const BoundingFrustum* frustum,
+	const function<bool(uint32_t)>& isResident, vector<uint32_t>& selectedNodes, vector<uint32_t>& missingNodes) const
+{
+	const TerrainNode& node = m_nodes[nodeIndex];
+	if (frustum && !frustum->Intersects(node.bounds)) return;
+
+	if (node.level > 0 && DistanceToBox(eyePos, node.bounds) < GetLODRange(node.level - 1))
+	{
+		uint32_t children[4];
+		bool allResident = true;
+		for (uint32_t child = 0; child < 4; ++child)
+		{
+			children[child] = GetNodeIndex(node.level - 1, node.x * 2 + (child & 1), node.z * 2 + (child >> 1));
+			if (!isResident(children[child]))
+			{
+				allResident = false;
+				missingNodes.push_back(children[child]);
+			}
+		}
+
+		if (allResident)
+		{
+			for (uint32_t childIndex : children)
+			{
+				SelectNode(childIndex, eyePos, frustum, isResident, selectedNodes, missingNodes);
+			}
+			return;
+		}
+	}
+
+	selectedNodes.push_back(nodeIndex);
+}
+
+TerrainChunkMesh TerrainQuadTree::BuildChunkMesh(uint32_t nodeIndex) const
+{
+	const TerrainNode& node = m_nodes[nodeIndex];
+	const uint32_t resolution = m_settings.chunkResolution;
+	const uint32_t verticesPerRow = resolution + 1;
+	const float worldSize = m_settings.worldSize;
+	const float halfSize = worldSize * 0.5f;
+	const float nodeExtent = 1.0f / GetNodesPerEdge(node.level);
+	const float u0 = node.x * nodeExtent;
+	const float v0 = node.z * nodeExtent;
+	const float step = nodeExtent / resolution;
+
+	// normals come from the source texels so neighbouring levels shade alike
+	const float texel = 1.0f / max<uint32_t>(m_heightfield->GetResolution() - 1, 1);
+	const float slopeScale = m_settings.heightScale / (2.0f * texel * worldSize);
+
+	TerrainChunkMesh mesh;
+	mesh.nodeIndex = nodeIndex;
+	mesh.vertices.resize(verticesPerRow * verticesPerRow + verticesPerRow * 4);
+	mesh.indices.reserve(resolution * resolution * 6 + resolution * 4 * 6);
+
+	for (uint32_t row = 0; row <= resolution; ++row)
+	{
+		for (uint32_t col = 0; col <= resolution; ++col)
+		{
+			float u = u0 + col * step;
+			float v = v0 + row * step;
+
+			Vertex& vertex = mesh.vertices[row * verticesPerRow + col];
+			vertex.pos = XMFLOAT3(-halfSize + u * worldSize, m_heightfield->SampleBilinear(u, v) * m_settings.heightScale, halfSize - v * worldSize);
+			vertex.color = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			vertex.texCoord = XMFLOAT2(u * m_settings.textureRepeat, v * m_settings.textureRepeat);
+
+			// z grows against v, hence the sign flip on the second slope
+			float slopeX = (m_heightfield->SampleBilinear(u + texel, v) - m_heightfield->SampleBilinear(u - texel, v)) * slopeScale;
+			float slopeZ = -(m_heightfield->SampleBilinear(u, v + texel) - m_heightfield->SampleBilinear(u, v - texel)) * slopeScale;
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVectorSet(-slopeX, 1.0f, -slopeZ, 0.0f)));
+		}
+	}
+
+	// same winding as Plane
+	for (uint32_t row = 0; row < resolution; ++row)
+	{
+		for (uint32_t col = 0; col < resolution; ++col)
+		{
+			uint16_t topLeft = static_cast<uint16_t>(row * verticesPerRow + col);
+			uint16_t topRight = topLeft + 1;
+			uint16_t bottomLeft = static_cast<uint16_t>((row + 1) * verticesPerRow + col);
+			uint16_t bottomRight = bottomLeft + 1;
+
+			mesh.indices.insert(mesh.indices.end(), { bottomLeft, topLeft, topRight });
+			mesh.indices.insert(mesh.indices.end(), { topRight, bottomRight, bottomLeft });
+		}
+	}
+
+	// skirts hang below each border, walked clockwise from above so they face outwards
+	const float skirtDepth = GetSkirtDepth(node.level);
+	uint16_t skirtBase = static_cast<uint16_t>(verticesPerRow * verticesPerRow);
+	auto borderIndex = [&](uint32_t edge, uint32_t i) -> uint32_t
+	{
+		switch (edge)
+		{
+			case 0:  return i;													// north, west to east
+			case 1:  return i * verticesPerRow + resolution;					// east, north to south
+			case 2:  return resolution * verticesPerRow + (resolution - i);		// south, east to west
+			default: return (resolution - i) * verticesPerRow;					// west, south to north
+		}
+	};
+
+	for (uint32_t edge = 0; edge < 4; ++edge)
+	{
+		for (uint32_t i = 0; i <= resolution; ++i)
+		{
+			Vertex& skirtVertex = mesh.vertices[skirtBase + i];
+			skirtVertex = mesh.vertices[borderIndex(edge, i)];
+			skirtVertex.pos.y -= skirtDepth;
+		}
+
+		for (uint32_t i = 0; i < resolution; ++i)
+		{
+			uint16_t top0 = static_cast<uint16_t>(borderIndex(edge, i));
+			uint16_t top1 = static_cast<uint16_t>(borderIndex(edge, i + 1));
+			uint16_t bottom0 = static_cast<uint16_t>(skirtBase + i);
+			uint16_t bottom1 = static_cast<uint16_t>(skirtBase + i + 1);
+
+			mesh.indices.insert(mesh.indices.end(), { top0, bottom1, top1 });
+			mesh.indices.insert(mesh.indices.end(), { top0, bottom0, bottom1 });
+		}
+		skirtBase += static_cast<uint16_t>(verticesPerRow);
+	}
+
+	TangentGenerator::Generate(mesh.vertices, mesh.indices, false);
+	return mesh;
+}
+} // namespace Lunar
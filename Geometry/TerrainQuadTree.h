@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "Heightfield.h"
+#include "Vertex.h"
+
+namespace Lunar
+{
+struct TerrainSettings
+{
+	float    worldSize = 64.0f;			// edge length of the terrain square, centered on the local origin
+	float    heightScale = 6.0f;		// local height of a heightfield sample of 1.0
+	uint32_t lodLevelCount = 5;			// quadtree depth, level 0 holds the finest chunks
+	uint32_t chunkResolution = 32;		// quads per chunk edge, the same at every level
+	float    lodDistance = 12.0f;		// level 0 is used within this distance, doubling per level
+	float    skirtDepthScale = 2.0f;	// skirt depth in chunk cells
+	float    textureRepeat = 1.0f;
+};
+
+struct TerrainNode
+{
+	uint32_t             level;
+	uint32_t             x;
+	uint32_t             z;
+	DirectX::BoundingBox bounds;	// local space, skirts included
+};
+
+struct TerrainChunkMesh
+{
+	uint32_t              nodeIndex = 0;
+	std::vector<Vertex>   vertices;
+	std::vector<uint16_t> indices;
+};
+
+// CDLOD-style quadtree over a heightfield. Every node owns a chunk mesh of the same resolution, so a node
+// covers four times the area of its children at a quarter of the density. Cracks between chunks of
+// neighbouring levels are hidden by skirts. Nothing here touches the GPU.
+class TerrainQuadTree
+{
+public:
+	void Build(std::shared_ptr<const Heightfield> heightfield, const TerrainSettings& settings);
+
+	// Descends from the root while a node is within the range of the next finer level and all four of its
+	// children pass isResident. Nodes drawn at a coarser level than wanted are reported through missingNodes.
+	void Select(
+		const DirectX::XMFLOAT3&              eyePos,
+		const DirectX::BoundingFrustum*       frustum,
+		const std::function<bool(uint32_t)>&  isResident,
+		std::vector<uint32_t>&                selectedNodes,
+		std::vector<uint32_t>&                missingNodes) const;
+
+	TerrainChunkMesh BuildChunkMesh(uint32_t nodeIndex) const;
+
+	uint32_t               GetRootIndex() const { return 0; }
+	uint32_t               GetNodeIndex(uint32_t level, uint32_t x, uint32_t z) const;
+	uint32_t               GetParentIndex(uint32_t nodeIndex) const;
+	const TerrainNode&     GetNode(uint32_t nodeIndex) const { return m_nodes[nodeIndex]; }
+	size_t                 GetNodeCount() const { return m_nodes.size(); }
+	const TerrainSettings& GetSettings() const { return m_settings; }
+	float                  GetLODRange(uint32_t level) const;
+
+private:
+	uint32_t GetNodesPerEdge(uint32_t level) const { return 1u << (m_settings.lodLevelCount - 1 - level); }
+	float    GetSkirtDepth(uint32_t level) const;
+	void     SelectNode(
+		uint32_t nodeIndex, const DirectX::XMFLOAT3& eyePos, const DirectX::BoundingFrustum* frustum,
+		const std::function<bool(uint32_t)>& isResident, std::vector<uint32_t>& selectedNodes, std::vector<uint32_t>& missingNodes) const;
+
+	std::shared_ptr<const Heightfield> m_heightfield;
+	TerrainSettings                    m_settings;
+	std::vector<TerrainNode>           m_nodes;			// coarsest level first
+	std::vector<uint32_t>              m_levelOffsets;
+};
+} // namespace Lunar
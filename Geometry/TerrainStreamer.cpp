@@ -0,0 +1,109 @@
+#include "TerrainStreamer.h"
+
+#include <algorithm>
+
+#include "../Utils/ThreadPool.h"
+
+using namespace std;
+
+namespace Lunar
+{
+void TerrainStreamer::Reset(shared_ptr<const TerrainQuadTree> quadTree)
+{
+	m_quadTree = move(quadTree);
+	// jobs of the previous tree keep the old queue alive and write into it unseen
+	m_streamingQueue = make_shared<StreamingQueue>();
+	m_chunkStates.assign(m_quadTree->GetNodeCount(), ChunkState::Unloaded);
+	m_lastUsedFrames.assign(m_quadTree->GetNodeCount(), 0);
+	m_pendingChunkCount = 0;
+	m_residentChunkCount = 0;
+}
+
+void TerrainStreamer::BeginFrame(vector<TerrainChunkMesh>& completedChunks)
+{
+	++m_frame;
+
+	lock_guard<mutex> lock(m_streamingQueue->mutex);
+	size_t count = min<size_t>(m_streamingQueue->completed.size(), m_maxUploadsPerFrame);
+	auto first = m_streamingQueue->completed.begin();
+	completedChunks.assign(make_move_iterator(first), make_move_iterator(first + count));
+	m_streamingQueue->completed.erase(first, first + count);
+}
+
+void TerrainStreamer::Touch(const vector<uint32_t>& selectedNodes)
+{
+	for (uint32_t nodeIndex : selectedNodes)
+	{
+		while (true)
+		{
+			m_lastUsedFrames[nodeIndex] = m_frame;
+			if (nodeIndex == m_quadTree->GetRootIndex()) break;
+			nodeIndex = m_quadTree->GetParentIndex(nodeIndex);
+		}
+	}
+}
+
+void TerrainStreamer::Request(const vector<uint32_t>& nodeIndices, vector<TerrainChunkMesh>& builtChunks)
+{
+	builtChunks.clear();
+	for (uint32_t nodeIndex : nodeIndices)
+	{
+		if (m_chunkStates[nodeIndex] != ChunkState::Unloaded) continue;
+
+		if (!m_streaming)
+		{
+			builtChunks.push_back(m_quadTree->BuildChunkMesh(nodeIndex));
+			continue;
+		}
+
+		if (m_pendingChunkCount >= m_maxPendingChunks) break;
+		m_chunkStates[nodeIndex] = ChunkState::Pending;
+		++m_pendingChunkCount;
+
+		shared_ptr<const TerrainQuadTree> quadTree = m_quadTree;
+		shared_ptr<StreamingQueue> streamingQueue = m_streamingQueue;
+		ThreadPool::GetInstance().Submit([quadTree, streamingQueue, nodeIndex]()
+		{
+			TerrainChunkMesh mesh = quadTree->BuildChunkMesh(nodeIndex);
+			lock_guard<mutex> lock(streamingQueue->mutex);
+			streamingQueue->completed.push_back(move(mesh));
+		});
+	}
+}
+
+void TerrainStreamer::Evict(vector<uint32_t>& evictedNodes)
+{
+	evictedNodes.clear();
+	if (m_residentChunkCount <= m_maxResidentChunks) return;
+
+	vector<uint32_t> candidates;
+	for (uint32_t nodeIndex = 0; nodeIndex < m_chunkStates.size(); ++nodeIndex)
+	{
+		if (m_chunkStates[nodeIndex] != ChunkState::Resident) continue;
+		if (nodeIndex == m_quadTree->GetRootIndex() || m_lastUsedFrames[nodeIndex] == m_frame) continue;
+		candidates.push_back(nodeIndex);
+	}
+	sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b)
+	{
+		return m_lastUsedFrames[a] < m_lastUsedFrames[b];
+	});
+
+	for (uint32_t nodeIndex : candidates)
+	{
+		if (m_residentChunkCount <= m_maxResidentChunks) break;
+		m_chunkStates[nodeIndex] = ChunkState::Unloaded;
+		--m_residentChunkCount;
+		evictedNodes.push_back(nodeIndex);
+	}
+}
+
+void TerrainStreamer::MarkResident(uint32_t nodeIndex)
+{
+	if (m_chunkStates[nodeIndex] == ChunkState::Resident) return;
+	if (m_chunkStates[nodeIndex] == ChunkState::Pending) --m_pendingChunkCount;
+
+	m_chunkStates[nodeIndex] = ChunkState::Resident;
+	m_lastUsedFrames[nodeIndex] = m_frame;
+	++m_residentChunkCount;
+}
+} // namespace Lunar
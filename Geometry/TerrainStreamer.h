@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "TerrainQuadTree.h"
+
+namespace Lunar
+{
+// Residency bookkeeping for Terrain: which chunks are resident or being built, when each was last drawn,
+// and which to evict once over budget. Chunk meshes are built on ThreadPool workers and handed back a few
+// per frame. Holds no GPU state, Terrain owns the chunk buffers.
+class TerrainStreamer
+{
+public:
+	void Reset(std::shared_ptr<const TerrainQuadTree> quadTree);
+
+	// Advances the frame and hands out up to the per frame upload budget of finished chunk meshes
+	void BeginFrame(std::vector<TerrainChunkMesh>& completedChunks);
+	// Marks the selected nodes and their ancestors as used this frame; selection has to pass through the ancestors
+	void Touch(const std::vector<uint32_t>& selectedNodes);
+	// Queues unloaded nodes for building; without streaming they are built inline and returned through builtChunks
+	void Request(const std::vector<uint32_t>& nodeIndices, std::vector<TerrainChunkMesh>& builtChunks);
+	// Unloads the least recently used chunks over the resident budget, never the root or a chunk used this frame
+	void Evict(std::vector<uint32_t>& evictedNodes);
+	// Called once the chunk buffers of a handed out mesh exist
+	void MarkResident(uint32_t nodeIndex);
+
+	void SetStreaming(bool streaming) { m_streaming = streaming; }
+	void SetMaxResidentChunks(uint32_t maxResidentChunks) { m_maxResidentChunks = maxResidentChunks; }
+	void SetMaxPendingChunks(uint32_t maxPendingChunks) { m_maxPendingChunks = maxPendingChunks; }
+	void SetMaxUploadsPerFrame(uint32_t maxUploadsPerFrame) { m_maxUploadsPerFrame = maxUploadsPerFrame; }
+
+	bool     IsResident(uint32_t nodeIndex) const { return m_chunkStates[nodeIndex] == ChunkState::Resident; }
+	bool     IsPending(uint32_t nodeIndex) const { return m_chunkStates[nodeIndex] == ChunkState::Pending; }
+	uint64_t GetFrame() const { return m_frame; }
+	uint32_t GetPendingChunkCount() const { return m_pendingChunkCount; }
+	uint32_t GetResidentChunkCount() const { return m_residentChunkCount; }
+
+private:
+	enum class ChunkState : uint8_t
+	{
+		Unloaded,
+		Pending,
+		Resident
+	};
+
+	// outlives the streamer so jobs still running at shutdown have somewhere to write
+	struct StreamingQueue
+	{
+		std::mutex                    mutex;
+		std::vector<TerrainChunkMesh> completed;
+	};
+
+	std::shared_ptr<const TerrainQuadTree> m_quadTree;
+	std::shared_ptr<StreamingQueue>        m_streamingQueue = std::make_shared<StreamingQueue>();
+
+	std::vector<ChunkState> m_chunkStates;
+	std::vector<uint64_t>   m_lastUsedFrames;
+
+	uint64_t m_frame = 0;
+	uint32_t m_pendingChunkCount = 0;
+	uint32_t m_residentChunkCount = 0;
+	uint32_t m_maxPendingChunks = 8;
+	uint32_t m_maxUploadsPerFrame = 4;
+	uint32_t m_maxResidentChunks = 256;
+	bool     m_streaming = true;
+};
+} // namespace Lunar
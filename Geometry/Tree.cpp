@@ -11,6 +11,8 @@ void Tree::CreateGeometry()
 		{{ 5.0f, 0.0f, 10.0f }},
 		{{ 10.0f, 0.0f, 10.0f }} 
 	};
+	// one point per billboard, expanded into a quad by the geometry shader
+	m_topologyType = D3D_PRIMITIVE_TOPOLOGY_POINTLIST;
 }
 
 void Tree::Draw(ID3D12GraphicsCommandList* commandList)
@@ -18,7 +20,7 @@ void Tree::Draw(ID3D12GraphicsCommandList* commandList)
 	if (m_needsConstantBufferUpdate) UpdateObjectConstants();
 	BindObjectConstants(commandList);
 	commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
-	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
+	commandList->IASetPrimitiveTopology(m_topologyType);
 	commandList->DrawInstanced(4, 1, 0, 0); 
 }
 } // namespace Lunar
\ No newline at end of file
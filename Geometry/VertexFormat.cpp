@@ -0,0 +1,184 @@
+#include "VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <DirectXPackedVector.h>
+
+using namespace std;
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace Lunar
+{
+namespace
+{
+// project onto the octahedron |x| + |y| + |z| = 1, then fold the lower hemisphere over the diagonals
+XMFLOAT2 OctEncode(const XMFLOAT3& direction)
+{
+	float l1Norm = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (l1Norm < 1e-8f) return { 0.0f, 0.0f };
+
+	float x = direction.x / l1Norm;
+	float y = direction.y / l1Norm;
+	if (direction.z < 0.0f)
+	{
+		float foldedX = (1.0f - fabsf(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		float foldedY = (1.0f - fabsf(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = foldedX;
+		y = foldedY;
+	}
+	return { x, y };
+}
+
+// same unfolding as OctDecode in Common.hlsl
+XMFLOAT3 OctDecode(const XMFLOAT2& encoded)
+{
+	XMFLOAT3 direction = { encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y) };
+	float t = max(-direction.z, 0.0f);
+	direction.x += direction.x >= 0.0f ? -t : t;
+	direction.y += direction.y >= 0.0f ? -t : t;
+
+	XMFLOAT3 normalized;
+	XMStoreFloat3(&normalized, XMVector3Normalize(XMLoadFloat3(&direction)));
+	return normalized;
+}
+
+uint32_t PackShortN2(const XMFLOAT2& value)
+{
+	XMSHORTN2 packed;
+	XMStoreShortN2(&packed, XMLoadFloat2(&value));
+	return packed.v;
+}
+
+XMFLOAT2 UnpackShortN2(uint32_t packed)
+{
+	XMSHORTN2 shortN2;
+	shortN2.v = packed;
+	XMFLOAT2 value;
+	XMStoreFloat2(&value, XMLoadShortN2(&shortN2));
+	return value;
+}
+}
+
+uint32_t VertexFormatUtils::GetStride(VertexFormat format)
+{
+	switch (format)
+	{
+		case VertexFormat::Compact:
+			return sizeof(CompactVertex);
+		case VertexFormat::Default:
+		default:
+			return sizeof(Vertex);
+	}
+}
+
+const char* VertexFormatUtils::GetInputLayoutName(VertexFormat format)
+{
+	return format == VertexFormat::Compact ? "compact" : "default";
+}
+
+const char* VertexFormatUtils::GetPSOSuffix(VertexFormat format)
+{
+	return format == VertexFormat::Compact ? "_compact" : "";
+}
+
+vector<uint8_t> VertexFormatUtils::PackVertices(const vector<Vertex>& vertices, VertexFormat format)
+{
+	vector<uint8_t> bytes(vertices.size() * GetStride(format));
+	if (format == VertexFormat::Default)
+	{
+		memcpy(bytes.data(), vertices.data(), bytes.size());
+		return bytes;
+	}
+
+	CompactVertex* dst = reinterpret_cast<CompactVertex*>(bytes.data());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		dst[i] = PackVertex(vertices[i]);
+	}
+	return bytes;
+}
+
+CompactVertex VertexFormatUtils::PackVertex(const Vertex& vertex)
+{
+	CompactVertex compactVertex;
+	compactVertex.pos = vertex.pos;
+	compactVertex.color = PackColor(vertex.color);
+	compactVertex.texCoord = PackHalf2(vertex.texCoord);
+	compactVertex.normal = EncodeOctahedral(vertex.normal);
+	compactVertex.tangentU = EncodeOctahedralTangent(vertex.tangentU);
+	return compactVertex;
+}
+
+Vertex VertexFormatUtils::UnpackVertex(const CompactVertex& compactVertex)
+{
+	Vertex vertex;
+	vertex.pos = compactVertex.pos;
+	vertex.color = UnpackColor(compactVertex.color);
+	vertex.texCoord = UnpackHalf2(compactVertex.texCoord);
+	vertex.normal = DecodeOctahedral(compactVertex.normal);
+	vertex.tangentU = DecodeOctahedralTangent(compactVertex.tangentU);
+	return vertex;
+}
+
+uint32_t VertexFormatUtils::EncodeOctahedral(const XMFLOAT3& direction)
+{
+	return PackShortN2(OctEncode(direction));
+}
+
+XMFLOAT3 VertexFormatUtils::DecodeOctahedral(uint32_t packed)
+{
+	return OctDecode(UnpackShortN2(packed));
+}
+
+uint32_t VertexFormatUtils::EncodeOctahedralTangent(const XMFLOAT4& tangent)
+{
+	XMFLOAT2 encoded = OctEncode({ tangent.x, tangent.y, tangent.z });
+	// keep y away from zero so the sign survives quantization
+	float y = max(encoded.y * 0.5f + 0.5f, 1.0f / 32767.0f);
+	encoded.y = tangent.w < 0.0f ? -y : y;
+	return PackShortN2(encoded);
+}
+
+XMFLOAT4 VertexFormatUtils::DecodeOctahedralTangent(uint32_t packed)
+{
+	XMFLOAT2 encoded = UnpackShortN2(packed);
+	float handedness = encoded.y < 0.0f ? -1.0f : 1.0f;
+	encoded.y = fabsf(encoded.y) * 2.0f - 1.0f;
+
+	XMFLOAT3 tangent = OctDecode(encoded);
+	return { tangent.x, tangent.y, tangent.z, handedness };
+}
+
+uint32_t VertexFormatUtils::PackColor(const XMFLOAT4& color)
+{
+	XMUBYTEN4 packed;
+	XMStoreUByteN4(&packed, XMLoadFloat4(&color));
+	return packed.v;
+}
+
+XMFLOAT4 VertexFormatUtils::UnpackColor(uint32_t packed)
+{
+	XMUBYTEN4 ubyteN4(packed);
+	XMFLOAT4 color;
+	XMStoreFloat4(&color, XMLoadUByteN4(&ubyteN4));
+	return color;
+}
+
+uint32_t VertexFormatUtils::PackHalf2(const XMFLOAT2& value)
+{
+	XMHALF2 packed;
+	XMStoreHalf2(&packed, XMLoadFloat2(&value));
+	return packed.v;
+}
+
+XMFLOAT2 VertexFormatUtils::UnpackHalf2(uint32_t packed)
+{
+	XMHALF2 half2;
+	half2.v = packed;
+	XMFLOAT2 value;
+	XMStoreFloat2(&value, XMLoadHalf2(&half2));
+	return value;
+}
+} // namespace Lunar
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "Vertex.h"
+
+namespace Lunar
+{
+enum class VertexFormat : uint8_t
+{
+	Default,	// Vertex, 64 bytes
+	Compact		// CompactVertex, 28 bytes
+};
+
+// Packed layout matching the "compact" input layout in PipelineStateManager
+struct CompactVertex
+{
+	DirectX::XMFLOAT3 pos;		// R32G32B32_FLOAT
+	uint32_t          color;	// R8G8B8A8_UNORM
+	uint32_t          texCoord;	// R16G16_FLOAT
+	uint32_t          normal;	// R16G16_SNORM, octahedral
+	uint32_t          tangentU;	// R16G16_SNORM, octahedral with the handedness folded into y
+};
+
+class VertexFormatUtils
+{
+public:
+	static uint32_t    GetStride(VertexFormat format);
+	static const char* GetInputLayoutName(VertexFormat format);
+	static const char* GetPSOSuffix(VertexFormat format);
+
+	// Returns the vertex buffer contents for the given format
+	static std::vector<uint8_t> PackVertices(const std::vector<Vertex>& vertices, VertexFormat format);
+	static CompactVertex        PackVertex(const Vertex& vertex);
+	static Vertex               UnpackVertex(const CompactVertex& compactVertex);
+
+	// Octahedral mapping of a unit vector to two snorm16 values
+	static uint32_t          EncodeOctahedral(const DirectX::XMFLOAT3& direction);
+	static DirectX::XMFLOAT3 DecodeOctahedral(uint32_t packed);
+
+	// Tangent with handedness in w: y is remapped to [0, 1] and carries the sign of w
+	static uint32_t          EncodeOctahedralTangent(const DirectX::XMFLOAT4& tangent);
+	static DirectX::XMFLOAT4 DecodeOctahedralTangent(uint32_t packed);
+
+	static uint32_t          PackColor(const DirectX::XMFLOAT4& color);
+	static DirectX::XMFLOAT4 UnpackColor(uint32_t packed);
+	static uint32_t          PackHalf2(const DirectX::XMFLOAT2& value);
+	static DirectX::XMFLOAT2 UnpackHalf2(uint32_t packed);
+};
+} // namespace Lunar
@@ -0,0 +1,254 @@
+#include "LightPool.h"
+
+#include <algorithm>
+
+#include "Utils/Logger.h"
+
+using namespace DirectX;
+using namespace std;
+
+namespace Lunar
+{
+void LightPool::Initialize(uint32_t maxLights)
+{
+    m_maxLights = maxLights;
+    m_pageDirty.assign((maxLights + DIRTY_PAGE_SIZE - 1) / DIRTY_PAGE_SIZE, 0);
+}
+
+LightHandle LightPool::AddLight(const string& name, const LightData& data)
+{
+    if (GetLightCount() >= m_maxLights)
+    {
+        LOG_WARNING("Light pool is full (", m_maxLights, "), skipping ", name);
+        return {};
+    }
+    if (!name.empty() && m_lightNameToHandle.count(name))
+    {
+        LOG_WARNING("Light with name ", name, " already exists");
+        return {};
+    }
+
+    LightHandle handle;
+    if (m_freeHandleIds.empty())
+    {
+        handle.id = static_cast<uint32_t>(m_handleToIndex.size());
+        m_handleToIndex.push_back(0);
+    }
+    else
+    {
+        handle.id = m_freeHandleIds.back();
+        m_freeHandleIds.pop_back();
+    }
+
+    uint32_t index = GetLightCount();
+    m_handleToIndex[handle.id] = index;
+    m_positions.push_back(data.Position);
+    m_directions.push_back(data.Direction);
+    m_strengths.push_back(data.Strength);
+    m_falloffStarts.push_back(data.FalloffStart);
+    m_falloffEnds.push_back(data.FalloffEnd);
+    m_spotPowers.push_back(data.SpotPower);
+    m_enabled.push_back(1);
+    m_handleIds.push_back(handle.id);
+    m_names.push_back(name);
+    if (!name.empty()) m_lightNameToHandle[name] = handle;
+
+    MarkDirty(index);
+    m_countChanged = true;
+    return handle;
+}
+
+bool LightPool::RemoveLight(LightHandle handle)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return false;
+
+    if (!m_names[index].empty()) m_lightNameToHandle.erase(m_names[index]);
+    m_handleToIndex[handle.id] = UINT32_MAX;
+    m_freeHandleIds.push_back(handle.id);
+
+    uint32_t last = GetLightCount() - 1;
+    if (index != last)
+    {
+        m_positions[index] = m_positions[last];
+        m_directions[index] = m_directions[last];
+        m_strengths[index] = m_strengths[last];
+        m_falloffStarts[index] = m_falloffStarts[last];
+        m_falloffEnds[index] = m_falloffEnds[last];
+        m_spotPowers[index] = m_spotPowers[last];
+        m_enabled[index] = m_enabled[last];
+        m_handleIds[index] = m_handleIds[last];
+        m_names[index] = move(m_names[last]);
+        m_handleToIndex[m_handleIds[index]] = index;
+        MarkDirty(index);
+    }
+
+    m_positions.pop_back();
+    m_directions.pop_back();
+    m_strengths.pop_back();
+    m_falloffStarts.pop_back();
+    m_falloffEnds.pop_back();
+    m_spotPowers.pop_back();
+    m_enabled.pop_back();
+    m_handleIds.pop_back();
+    m_names.pop_back();
+
+    // the light count lives in the basic constants
+    m_countChanged = true;
+    return true;
+}
+
+bool LightPool::RemoveLight(const string& name)
+{
+    return RemoveLight(FindLight(name));
+}
+
+LightHandle LightPool::FindLight(const string& name) const
+{
+    auto it = m_lightNameToHandle.find(name);
+    return it != m_lightNameToHandle.end() ? it->second : LightHandle();
+}
+
+void LightPool::SetLightPosition(LightHandle handle, const XMFLOAT3& position)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return;
+    m_positions[index] = position;
+    MarkDirty(index);
+}
+
+void LightPool::SetLightDirection(LightHandle handle, const XMFLOAT3& direction)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return;
+    m_directions[index] = direction;
+    MarkDirty(index);
+}
+
+void LightPool::SetLightColor(LightHandle handle, const XMFLOAT3& color)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return;
+    m_strengths[index] = color;
+    MarkDirty(index);
+}
+
+void LightPool::SetLightRange(LightHandle handle, float range)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return;
+    m_falloffStarts[index] = range * 0.1f;
+    m_falloffEnds[index] = range;
+    MarkDirty(index);
+}
+
+void LightPool::SetLightSpotPower(LightHandle handle, float spotPower)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return;
+    m_spotPowers[index] = spotPower;
+    MarkDirty(index);
+}
+
+void LightPool::SetLightEnabled(LightHandle handle, bool enabled)
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return;
+    m_enabled[index] = enabled ? 1 : 0;
+    MarkDirty(index);
+}
+
+void LightPool::SetLightPosition(const string& name, const XMFLOAT3& position)
+{
+    SetLightPosition(FindLight(name), position);
+}
+
+void LightPool::SetLightDirection(const string& name, const XMFLOAT3& direction)
+{
+    SetLightDirection(FindLight(name), direction);
+}
+
+void LightPool::SetLightColor(const string& name, const XMFLOAT3& color)
+{
+    SetLightColor(FindLight(name), color);
+}
+
+void LightPool::SetLightRange(const string& name, float range)
+{
+    SetLightRange(FindLight(name), range);
+}
+
+void LightPool::SetLightSpotPower(const string& name, float spotPower)
+{
+    SetLightSpotPower(FindLight(name), spotPower);
+}
+
+void LightPool::SetLightEnabled(const string& name, bool enabled)
+{
+    SetLightEnabled(FindLight(name), enabled);
+}
+
+optional<LightData> LightPool::GetLight(LightHandle handle) const
+{
+    uint32_t index = GetIndex(handle);
+    if (index == UINT32_MAX) return nullopt;
+
+    LightData light;
+    light.Strength = m_strengths[index];
+    light.FalloffStart = m_falloffStarts[index];
+    light.Direction = m_directions[index];
+    light.FalloffEnd = m_falloffEnds[index];
+    light.Position = m_positions[index];
+    light.SpotPower = m_spotPowers[index];
+    return light;
+}
+
+optional<LightData> LightPool::GetLight(const string& name) const
+{
+    return GetLight(FindLight(name));
+}
+
+bool LightPool::IsLightEnabled(LightHandle handle) const
+{
+    uint32_t index = GetIndex(handle);
+    return index != UINT32_MAX && m_enabled[index];
+}
+
+uint32_t LightPool::WriteDirtyLights(LightData* outLights)
+{
+    uint32_t lightCount = GetLightCount();
+    for (uint32_t page : m_dirtyPages)
+    {
+        m_pageDirty[page] = 0;
+        uint32_t end = min((page + 1) * DIRTY_PAGE_SIZE, lightCount);
+        for (uint32_t i = page * DIRTY_PAGE_SIZE; i < end; ++i)
+        {
+            // the mapping is write-combined, so each element is written once and in order
+            LightData light;
+            light.Strength = m_enabled[i] ? m_strengths[i] : XMFLOAT3(0.0f, 0.0f, 0.0f);
+            light.FalloffStart = m_falloffStarts[i];
+            light.Direction = m_directions[i];
+            light.FalloffEnd = m_falloffEnds[i];
+            light.Position = m_positions[i];
+            light.SpotPower = m_spotPowers[i];
+            outLights[i] = light;
+        }
+    }
+    m_dirtyPages.clear();
+    m_countChanged = false;
+    return lightCount;
+}
+
+uint32_t LightPool::GetIndex(LightHandle handle) const
+{
+    return handle.id < m_handleToIndex.size() ? m_handleToIndex[handle.id] : UINT32_MAX;
+}
+
+void LightPool::MarkDirty(uint32_t index)
+{
+    uint32_t page = index / DIRTY_PAGE_SIZE;
+    if (m_pageDirty[page]) return;
+    m_pageDirty[page] = 1;
+    m_dirtyPages.push_back(page);
+}
+} // namespace Lunar
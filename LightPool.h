@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <DirectXMath.h>
+
+namespace Lunar
+{
+// Element of the light structured buffer (Light in Common.hlsl)
+struct LightData
+{
+    DirectX::XMFLOAT3 Strength = {1.0f, 1.0f, 1.0f};
+    float FalloffStart = 1.0f;
+    DirectX::XMFLOAT3 Direction = {0.0f, -1.0f, 0.0f};
+    float FalloffEnd = 10.0f;
+    DirectX::XMFLOAT3 Position = {0.0f, 0.0f, 0.0f};
+    float SpotPower = 64.0f;
+};
+
+// Stable reference to a pooled light; survives other lights being removed
+struct LightHandle
+{
+    uint32_t id = UINT32_MAX;
+    bool IsValid() const { return id != UINT32_MAX; }
+};
+
+// Dense SoA light storage behind stable handles, tracking which pages of the structured buffer need uploading.
+// Holds no GPU state, LightingSystem owns the buffer.
+class LightPool
+{
+public:
+    void Initialize(uint32_t maxLights);
+
+    // Returns an invalid handle when the pool is full or the name is taken; an empty name is not registered
+    LightHandle AddLight(const std::string& name, const LightData& lightData);
+    bool RemoveLight(LightHandle handle);
+    bool RemoveLight(const std::string& name);
+    LightHandle FindLight(const std::string& name) const;
+
+    void SetLightPosition(LightHandle handle, const DirectX::XMFLOAT3& position);
+    void SetLightDirection(LightHandle handle, const DirectX::XMFLOAT3& direction);
+    void SetLightColor(LightHandle handle, const DirectX::XMFLOAT3& color);
+    void SetLightRange(LightHandle handle, float range);
+    void SetLightSpotPower(LightHandle handle, float spotPower);
+    void SetLightEnabled(LightHandle handle, bool enabled);
+
+    void SetLightPosition(const std::string& name, const DirectX::XMFLOAT3& position);
+    void SetLightDirection(const std::string& name, const DirectX::XMFLOAT3& direction);
+    void SetLightColor(const std::string& name, const DirectX::XMFLOAT3& color);
+    void SetLightRange(const std::string& name, float range);
+    void SetLightSpotPower(const std::string& name, float spotPower);
+    void SetLightEnabled(const std::string& name, bool enabled);
+
+    std::optional<LightData> GetLight(LightHandle handle) const;
+    std::optional<LightData> GetLight(const std::string& name) const;
+    bool ContainsLight(LightHandle handle) const { return GetIndex(handle) != UINT32_MAX; }
+    bool IsLightEnabled(LightHandle handle) const;
+    // Handle of the light at a structured buffer index, valid until lights are added or removed
+    LightHandle GetHandleAt(uint32_t index) const { return { m_handleIds[index] }; }
+    uint32_t GetLightCount() const { return static_cast<uint32_t>(m_positions.size()); }
+    uint32_t GetMaxLights() const { return m_maxLights; }
+
+    // True when lights changed or were added or removed since the last WriteDirtyLights
+    bool HasChanges() const { return m_countChanged || !m_dirtyPages.empty(); }
+    // Writes the dirty pages into a buffer of GetMaxLights() elements, disabled lights with zero strength, and
+    // returns how many lights were written
+    uint32_t WriteDirtyLights(LightData* outLights);
+
+private:
+    // lights are re-uploaded in pages; a page is marked once however many of its lights change
+    static constexpr uint32_t DIRTY_PAGE_SIZE = 64;
+
+    // dense SoA pool, removal moves the last light into the hole
+    std::vector<DirectX::XMFLOAT3> m_positions;
+    std::vector<DirectX::XMFLOAT3> m_directions;
+    std::vector<DirectX::XMFLOAT3> m_strengths;
+    std::vector<float>             m_falloffStarts;
+    std::vector<float>             m_falloffEnds;
+    std::vector<float>             m_spotPowers;
+    std::vector<uint8_t>           m_enabled;
+    std::vector<uint32_t>          m_handleIds;		// dense index -> handle id
+    std::vector<std::string>       m_names;
+
+    std::vector<uint32_t> m_handleToIndex;			// handle id -> dense index, UINT32_MAX when free
+    std::vector<uint32_t> m_freeHandleIds;
+    std::unordered_map<std::string, LightHandle> m_lightNameToHandle;
+
+    std::vector<uint8_t>  m_pageDirty;
+    std::vector<uint32_t> m_dirtyPages;
+    uint32_t m_maxLights = 0;
+    bool     m_countChanged = true;
+
+    uint32_t GetIndex(LightHandle handle) const;
+    void     MarkDirty(uint32_t index);
+};
+} // namespace Lunar
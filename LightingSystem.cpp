@@ -2,6 +2,7 @@
 
 #include "ConstantBuffers.h"
 #include "LunarConstants.h"
+#include "Utils/Logger.h"
 #include "Utils/Utils.h"
 
 using namespace DirectX;
@@ -10,9 +11,15 @@ using namespace Lunar::LunarConstants;
 
 namespace Lunar
 {
+LightingSystem::LightingSystem() = default;
+
+LightingSystem::~LightingSystem() = default;
+
 void LightingSystem::Initialize(ID3D12Device* device, UINT maxLights)
 {
-    m_maxLights = maxLights;
+    LightPool::Initialize(maxLights);
+    m_lightBuffer = make_unique<ConstantBuffer>(device, static_cast<UINT>(sizeof(LightData) * maxLights));
+
 	for (auto& lightInfo : LIGHT_INFO)
 	{
 		LightData lightData;
@@ -22,163 +29,43 @@ void LightingSystem::Initialize(ID3D12Device* device, UINT maxLights)
 		lightData.FalloffEnd = lightInfo.fallOffEnd;
 		lightData.FalloffStart = lightInfo.fallOffStart;
 		lightData.SpotPower = lightInfo.spotPower;
-		AddLight(lightInfo.name, lightData, lightInfo.lightType);	
+		AddLight(lightInfo.name, lightData, lightInfo.lightType);
 	}
 }
 
-void LightingSystem::SetLightPosition(const std::string& name, const XMFLOAT3& position)
-{
-    auto* light = GetLight(name);
-    if (light)
-    {
-        light->Position = position;
-        m_needsUpdate = true;
-    }
-}
-
-void LightingSystem::SetLightDirection(const std::string& name, const XMFLOAT3& direction)
-{
-    auto* light = GetLight(name);
-    if (light)
-    {
-        light->Direction = direction;
-        m_needsUpdate = true;
-    }
-}
-
-void LightingSystem::SetLightColor(const std::string& name, const XMFLOAT3& color)
-{
-    auto* light = GetLight(name);
-    if (light)
-    {
-        light->Strength = color;
-        m_needsUpdate = true;
-    }
-}
-
-void LightingSystem::SetLightRange(const std::string& name, float range)
-{
-    auto* light = GetLight(name);
-    if (light)
-    {
-        light->FalloffStart = range * 0.1f;
-        light->FalloffEnd = range;
-        m_needsUpdate = true;
-    }
-}
-
-void LightingSystem::SetLightSpotPower(const std::string& name, float spotPower)
-{
-    auto* light = GetLight(name);
-    if (light)
-    {
-        light->SpotPower = spotPower;
-        m_needsUpdate = true;
-    }
-}
-
-void LightingSystem::SetLightEnabled(const std::string& name, bool enabled)
+LightHandle LightingSystem::AddLight(const string& name, const LightData& data, LightType type)
 {
-    auto* light = GetLight(name);
-    if (light)
-    {
-        if (enabled)
-        {
-	        LightType lightType = GetLightType(name);
-            if (lightType == LightType::Point)
-            {
-                light->Strength = XMFLOAT3(1.0f, 0.9f, 0.7f);
-            }
-            else if (lightType == LightType::Spot)
-            {
-                light->Strength = XMFLOAT3(1.0f, 1.0f, 0.9f);
-            }
-            else if (lightType == LightType::Directional)
-            {
-                light->Strength = XMFLOAT3(1.2f, 1.0f, 0.8f);
-            }
-        }
-        else
-        {
-            light->Strength = XMFLOAT3(0.0f, 0.0f, 0.0f);
-        }
-        m_needsUpdate = true;
-    }
+    LightHandle handle = LightPool::AddLight(name, data);
+    if (!handle.IsValid()) return handle;
+    if (handle.id >= m_typesByHandle.size()) m_typesByHandle.resize(handle.id + 1);
+    m_typesByHandle[handle.id] = type;
+    return handle;
 }
 
-const LightData* LightingSystem::GetLight(const std::string& name) const
+LightType LightingSystem::GetLightType(LightHandle handle) const
 {
-    auto it = m_lightNameToIndex.find(name);
-    if (it != m_lightNameToIndex.end() && it->second < m_lights.size())
-    {
-        return &m_lights[it->second]->data;
-    }
-    return nullptr;
-}
-LightData* LightingSystem::GetLight(const std::string& name)
-{
-	auto it = m_lightNameToIndex.find(name);
-	if (it != m_lightNameToIndex.end() && it->second < m_lights.size())
-	{
-		return &m_lights[it->second]->data;
-	}
-	return nullptr;
-}
-
-uint32_t LightingSystem::GetLightIndex(const std::string& name) const
-{
-    auto it = m_lightNameToIndex.find(name);
-    return (it != m_lightNameToIndex.end()) ? it->second : 0;
+    return ContainsLight(handle) ? m_typesByHandle[handle.id] : LightType::Point;
 }
 
 bool LightingSystem::UpdateLightData(BasicConstants& basicConstants)
 {
-    if (!m_needsUpdate) return false;
-
-	// FIXME
-    for (size_t i = 0; i < m_lights.size(); ++i)
-    {
-        basicConstants.lights[i] = m_lights[i]->data;
-    }
+    if (!HasChanges() && !m_ambientChanged) return false;
 
     basicConstants.ambientLight = m_ambientLight;
+    basicConstants.lightCount = WriteDirtyLights(static_cast<LightData*>(m_lightBuffer->GetMappedData()));
 
-    m_needsUpdate = false;
+    m_ambientChanged = false;
     return true;
 }
 
-void LightingSystem::SetAmbientLight(const XMFLOAT4& ambientLight)
-{
-    m_ambientLight = ambientLight;
-    m_needsUpdate = true;
-}
-
-vector<int> LightingSystem::GetLightIndices() const
+D3D12_GPU_VIRTUAL_ADDRESS LightingSystem::GetLightBufferAddress() const
 {
-    vector<int> indices;
-    for (const auto& light : m_lights)
-    {
-        indices.push_back(light->index);
-    }
-    return indices;
+    return m_lightBuffer->GetResource()->GetGPUVirtualAddress();
 }
 
-LightType LightingSystem::GetLightType(const std::string& name) const
-{
-	uint32_t index = GetLightIndex(name);
-	return m_lights[index]->lightType;
-}
-
-void LightingSystem::AddLight(const string& name, const LightData& data, LightType type)
+void LightingSystem::SetAmbientLight(const XMFLOAT4& ambientLight)
 {
-    LightEntry lightEntry = {
-        type,
-        data,
-        name,
-        0,
-        true
-    };
-    m_lightNameToIndex[name] = m_lights.size();
-    m_lights.push_back(make_unique<LightEntry>(lightEntry));
+    m_ambientLight = ambientLight;
+    m_ambientChanged = true;
 }
 }
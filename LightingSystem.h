@@ -1,73 +1,45 @@
 #pragma once
 #include <vector>
 #include <string>
-#include <unordered_map>
 #include <memory>
 #include <d3d12.h>
 #include <DirectXMath.h>
 
+#include "LightPool.h"
 #include "LunarConstants.h"
 
 namespace Lunar
 {
 class LightViewModel;
+class ConstantBuffer;
 
 struct BasicConstants;
-struct LightData
-{
-    DirectX::XMFLOAT3 Strength = {1.0f, 1.0f, 1.0f};
-    float FalloffStart = 1.0f;
-    DirectX::XMFLOAT3 Direction = {0.0f, -1.0f, 0.0f};
-    float FalloffEnd = 10.0f;
-    DirectX::XMFLOAT3 Position = {0.0f, 0.0f, 0.0f};
-    float SpotPower = 64.0f;
-};
 
-class LightingSystem
+// Light pool with its GPU structured buffer, seeded with LIGHT_INFO
+class LightingSystem : public LightPool
 {
 public:
-    LightingSystem() = default;
-    ~LightingSystem() = default;
-
-    void Initialize(ID3D12Device* device, UINT maxLights = 16);
+    LightingSystem();
+    ~LightingSystem();
 
-    void SetLightPosition(const std::string& name, const DirectX::XMFLOAT3& position);
-    void SetLightDirection(const std::string& name, const DirectX::XMFLOAT3& direction);
-    void SetLightColor(const std::string& name, const DirectX::XMFLOAT3& color);
-    void SetLightRange(const std::string& name, float range);
-    void SetLightSpotPower(const std::string& name, float spotPower);
-    void SetLightEnabled(const std::string& name, bool enabled);
+    void Initialize(ID3D12Device* device, UINT maxLights = LunarConstants::MAX_LIGHT_COUNT);
 
-    const LightData* GetLight(const std::string& name) const;
-    LightData* GetLight(const std::string& name);
-    uint32_t GetLightIndex(const std::string& name) const;
+    // Returns an invalid handle when the pool is full or the name is taken; an empty name is not registered
+    LightHandle AddLight(const std::string& name, const LightData& lightData, LunarConstants::LightType type);
+    LunarConstants::LightType GetLightType(LightHandle handle) const;
 
+    // Copies the lights changed since the last call into the structured buffer
     bool UpdateLightData(BasicConstants& basicConstants);
+    D3D12_GPU_VIRTUAL_ADDRESS GetLightBufferAddress() const;
 
     void SetAmbientLight(const DirectX::XMFLOAT4& ambientLight);
     DirectX::XMFLOAT4 GetAmbientLight() const { return m_ambientLight; }
 
-    std::vector<int> GetLightIndices() const;
-
 private:
-    struct LightEntry
-    {
-	    LunarConstants::LightType lightType;
-        LightData data;
-        std::string name;
-        uint32_t index;
-        bool enabled = true;
-    };
-
-    std::vector<std::unique_ptr<LightEntry>> m_lights;
-    std::unordered_map<std::string, uint32_t> m_lightNameToIndex;
+    std::vector<LunarConstants::LightType> m_typesByHandle;	// handle ids are reused, so this never shrinks
+    std::unique_ptr<ConstantBuffer> m_lightBuffer;
 
-    // for now, set 1 directional, 1 point, 1 spot
-    UINT m_maxLights = 3;
-    bool m_needsUpdate = true;
+    bool m_ambientChanged = true;
     DirectX::XMFLOAT4 m_ambientLight = {0.6f, 0.6f, 0.6f, 1.0f};
-
-    LunarConstants::LightType GetLightType(const std::string& name) const;
-    void                      AddLight(const std::string& name, const LightData& lightData, LunarConstants::LightType type);
 };
 }
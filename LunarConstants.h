@@ -19,7 +19,15 @@ static constexpr float FAR_PLANE = 100.0f;
 static constexpr float MOUSE_SENSITIVITY = 0.005f;
 static constexpr float CAMERA_MOVE_SPEED = 1.0f;
 
-static constexpr UINT LIGHT_COUNT = 3;
+static constexpr UINT MAX_LIGHT_COUNT = 4096;
+static constexpr UINT MAX_SHADOW_CASCADES = 4;	// cascadeSplits in BasicConstants is a float4
+static constexpr UINT SHADOW_ATLAS_SIZE = 4096;
+static constexpr UINT SHADOW_ATLAS_MIN_TILE_SIZE = 128;
+static constexpr UINT SHADOW_ATLAS_MAX_TILE_SIZE = 1024;
+static constexpr UINT MAX_SHADOW_ATLAS_TILES = (SHADOW_ATLAS_SIZE / SHADOW_ATLAS_MIN_TILE_SIZE) * (SHADOW_ATLAS_SIZE / SHADOW_ATLAS_MIN_TILE_SIZE);
+static constexpr UINT PARTICLE_CAPACITY = 512;	// default, see ParticleSystem::SetCapacity
+static constexpr UINT MAX_PARTICLE_CAPACITY = 65535 * 64;	// most 64-thread groups a dispatch takes in one dimension
+static constexpr UINT MAX_PARTICLE_COLLIDERS = 64;	// planes and spheres together, see ParticleSystem::SetColliders
 
 static constexpr UINT BASIC_CONSTANTS_ROOT_PARAMETER_INDEX = 0;
 static constexpr UINT OBJECT_CONSTANTS_ROOT_PARAMETER_INDEX = 1;
@@ -29,6 +37,16 @@ static constexpr UINT PARTICLE_SRV_ROOT_PARAMETER_INDEX = 4;
 static constexpr UINT PARTICLE_UAV_ROOT_PARAMETER_INDEX = 5;
 static constexpr UINT POST_PROCESS_INPUT_ROOT_PARAMETER_INDEX = 6;
 static constexpr UINT POST_PROCESS_OUTPUT_ROOT_PARAMETER_INDEX = 7;
+static constexpr UINT LIGHT_SRV_ROOT_PARAMETER_INDEX = 8;
+static constexpr UINT SHADOW_TILE_SRV_ROOT_PARAMETER_INDEX = 9;
+static constexpr UINT LIGHT_SHADOW_SRV_ROOT_PARAMETER_INDEX = 10;
+static constexpr UINT PARTICLE_LIST_SRV_ROOT_PARAMETER_INDEX = 11;
+static constexpr UINT PARTICLE_LIST_UAV_ROOT_PARAMETER_INDEX = 12;
+static constexpr UINT PARTICLE_CONSTANTS_ROOT_PARAMETER_INDEX = 13;
+static constexpr UINT PARTICLE_SORT_UAV_ROOT_PARAMETER_INDEX = 14;
+static constexpr UINT PARTICLE_COLLIDER_SRV_ROOT_PARAMETER_INDEX = 15;
+static constexpr UINT CLUSTER_RANGE_SRV_ROOT_PARAMETER_INDEX = 16;
+static constexpr UINT CLUSTER_LIGHT_INDEX_SRV_ROOT_PARAMETER_INDEX = 17;
 
 // Compute Root Signature Parameters 
 static constexpr UINT COMPUTE_CONSTANTS_INDEX = 0;
@@ -75,11 +93,12 @@ struct ShaderInfo
 	const char* target;
     const char* entryPoint = "main"; // Default entry point
 };
-static constexpr std::array<ShaderInfo, 24> SHADER_INFO = {{
+static constexpr std::array<ShaderInfo, 29> SHADER_INFO = {{
 	{ "basicVS", "Shaders\\BasicVertexShader.hlsl", "vs_5_1" },
 	{ "basicPS", "Shaders\\BasicPixelShader.hlsl", "ps_5_1" },
 	{ "basicHS", "Shaders\\BasicHullShader.hlsl", "hs_5_1" },
 	{ "basicDS", "Shaders\\BasicDomainShader.hlsl", "ds_5_1" },
+	{ "compactVS", "Shaders\\CompactVertexShader.hlsl", "vs_5_1" },
 	{ "billboardVS", "Shaders\\BillboardVertexShader.hlsl", "vs_5_1" },
 	{ "billboardGS", "Shaders\\BillboardGeometryShader.hlsl", "gs_5_1" },
 	{ "billboardPS", "Shaders\\BillboardPixelShader.hlsl", "ps_5_1" },
@@ -91,15 +110,19 @@ static constexpr std::array<ShaderInfo, 24> SHADER_INFO = {{
 	{ "normalGS", "Shaders\\NormalGeometryShader.hlsl", "gs_5_1" },
 	{ "normalPS", "Shaders\\NormalPixelShader.hlsl", "ps_5_1" },
     { "particlesUpdateCS", "Shaders\\ParticlesComputeShader.hlsl", "cs_5_1" },
+    { "particlesEmitCS", "Shaders\\ParticlesComputeShader.hlsl", "cs_5_1", "Emit" },
+    { "particlesBuildArgumentsCS", "Shaders\\ParticlesComputeShader.hlsl", "cs_5_1", "BuildArguments" },
+    { "particlesBuildSortKeysCS", "Shaders\\ParticleSortShader.hlsl", "cs_5_1", "BuildSortKeys" },
+    { "particlesSortLocalCS", "Shaders\\ParticleSortShader.hlsl", "cs_5_1", "SortLocal" },
+    { "particlesSortStepCS", "Shaders\\ParticleSortShader.hlsl", "cs_5_1", "SortStep" },
+    { "particlesMergeLocalCS", "Shaders\\ParticleSortShader.hlsl", "cs_5_1", "MergeLocal" },
+    { "particlesWriteSortedListCS", "Shaders\\ParticleSortShader.hlsl", "cs_5_1", "WriteSortedList" },
     { "particlesVS", "Shaders\\ParticleVertexShader.hlsl", "vs_5_1" },
     { "particlesPS", "Shaders\\ParticlePixelShader.hlsl", "ps_5_1" },
     { "particlesGS", "Shaders\\ParticleGeometryShader.hlsl", "gs_5_1" },
     { "gaussianBlurXCS", "Shaders\\GaussianBlurCS.hlsl", "cs_5_1", "BlurX" },
     { "gaussianBlurYCS", "Shaders\\GaussianBlurCS.hlsl", "cs_5_1", "BlurY" },
-    { "irradianceCS", "Shaders\\IblCS.hlsl", "cs_5_1", "irradiance" },
-    { "prefilteredCS", "Shaders\\IblCS.hlsl", "cs_5_1", "prefiltered" },
     { "irradianceDebugCS", "Shaders\\IblCS.hlsl", "cs_5_1", "debug" },
-    { "brdfLutCS", "Shaders\\IblCS.hlsl", "cs_5_1", "brdfLut" },
 }};
 
 /////////////// Debug Flags ///////////////
@@ -22,6 +22,7 @@
 #include "Geometry/Cube.h"
 #include "Geometry/Transform.h"
 #include "Geometry/Plane.h"
+#include "Geometry/Terrain.h"
 #include "UI/PostProcessViewModel.h"
 
 using namespace std;
@@ -419,9 +420,11 @@ void MainApp::Render(double dt)
 		m_commandAllocator->Reset(); // Cautions!
 		m_commandList->Reset(m_commandAllocator.Get(), nullptr);
 		
+		// records this frame's environment uploads, now that the previous frame has finished
+		m_sceneRenderer->UpdateEnvironment(static_cast<float>(dt), m_device.Get(), m_commandList.Get(), m_descriptorAllocator.get());
+		
 		{ // Compute Shader
 			m_commandList->SetComputeRootSignature(m_pipelineStateManager->GetRootSignature());
-			m_commandList->SetPipelineState(m_pipelineStateManager->GetPSO("particlesUpdate"));
 			m_sceneRenderer->UpdateParticleSystem(dt, m_commandList.Get());
 		}
 		
@@ -554,8 +557,9 @@ void MainApp::Initialize()
 	CreateSceneRenderTarget();
 	CreateRTVDescriptorHeap();
 	CreateRenderTargetView();
-	InitializeGeometry();
+	// the scene checks geometry vertex formats against the built pipelines
 	m_pipelineStateManager->Initialize(m_device.Get());
+	InitializeGeometry();
 	InitializeTextures(); // for now, should come after InitializeGeometry method
 	m_postProcessManager->Initialize(m_device.Get(), m_descriptorAllocator.get());
 	m_postProcessViewModel->Initialize(m_gui.get(), m_postProcessManager.get());
@@ -674,6 +678,9 @@ void MainApp::InitializeGeometry()
     Transform transform = {};
     transform.Location = XMFLOAT3(0.0f, 1.5f, 0.0f);
     m_sceneRenderer->AddGeometry<IcoSphere>("Sphere0", transform, RenderLayer::World);
+    m_sceneRenderer->SetGeometryVertexFormat("Sphere0", VertexFormat::Compact);
+    m_sceneRenderer->SetGeometryMeshletCulling("Sphere0", true);
+    m_sceneRenderer->SetGeometryLODChain("Sphere0", 4);
     m_sceneRenderer->AddGeometry<Cube>("Cube0", transform, RenderLayer::Normal); // TODO : Delete
 	transform.Scale = XMFLOAT3(10.0f, 0.1f, 10.0f);
 	Transform mirrorTransform = transform;
@@ -685,6 +692,7 @@ void MainApp::InitializeGeometry()
 	m_sceneRenderer->AddCube("Cube2", {{2, 1, 2}, {0, 0, 0}, {1, 1, 1}}, RenderLayer::World);
 	m_sceneRenderer->AddCube("Cube3", {{-2, 1, -2}, {0, 0, 0}, {1, 1, 1}}, RenderLayer::World);*/
 	// m_sceneRenderer->AddGeometry<Plane>("ShadowMapPlane", {{0, -0.1f, 3.0f}, {0, 0, 0}, {3, 1, 3}}, RenderLayer::World);
+	m_sceneRenderer->AddGeometry<Terrain>("Terrain0", {{0, -4.0f, 0}, {0, 0, 0}, {1, 1, 1}}, RenderLayer::World);
 	m_sceneRenderer->AddGeometry<Plane>("TessellationPlane", {{0, -0.1f, 0}, {0, 0, 0}, {5.0f, 0.2f, 5.0f}}, RenderLayer::Tessellation);
 	transform.Location = XMFLOAT3(0.0f, 0.0f, 0.0f);
 	transform.Scale = XMFLOAT3(50.0f, 50.0f, 50.0f);
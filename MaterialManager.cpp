@@ -39,6 +39,21 @@ void MaterialManager::CreateMaterials(ID3D12Device* device)
 	}
 }
 
+bool MaterialManager::AddMaterial(ID3D12Device* device, const std::string& name, const MaterialConstants& material)
+{
+    if (m_materialMap.find(name) != m_materialMap.end())
+    {
+        LOG_WARNING("Material ", name, " already exists");
+        return false;
+    }
+    m_materialMap[name] = {
+        material,
+        std::make_unique<ConstantBuffer>(device, sizeof(MaterialConstants))
+    };
+    UpdateMaterial(name, material);
+    return true;
+}
+
 void MaterialManager::UpdateMaterial(const std::string& name, const MaterialConstants& material)
 {
     auto it = m_materialMap.find(name);
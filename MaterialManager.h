@@ -23,8 +23,11 @@ public:
     void Initialize(ID3D12Device* device);
 
     void CreateMaterials(ID3D12Device* device);
+    // Returns false when a material with this name already exists; the existing one is kept
+    bool AddMaterial(ID3D12Device* device, const std::string& name, const MaterialConstants& materialData);
     void UpdateMaterial(const std::string& name, const MaterialConstants& materialData); 
     void BindConstantBuffer(const std::string& name, ID3D12GraphicsCommandList* commandList);
+    bool HasMaterial(const std::string& name) const { return m_materialMap.find(name) != m_materialMap.end(); }
     const MaterialConstants& GetMaterial(const std::string& name) const;
     std::vector<std::string> GetMaterialNames() const;
 
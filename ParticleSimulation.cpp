@@ -0,0 +1,532 @@
+#include "ParticleSimulation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "Utils/ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+constexpr float GRAVITY = -9.81f;
+
+XMVECTOR Load(const vector<float>& stream, size_t index)
+{
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(stream.data() + index));
+}
+
+void Store(vector<float>& stream, size_t index, FXMVECTOR value)
+{
+	XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(stream.data() + index), value);
+}
+
+size_t HorizontalSum(FXMVECTOR v)
+{
+	XMFLOAT4 lanes;
+	XMStoreFloat4(&lanes, v);
+	return static_cast<size_t>(lanes.x + lanes.y + lanes.z + lanes.w);
+}
+
+// Four particle slots; lanes past count repeat the last slot and are not written back
+struct ParticleLanes
+{
+	uint32_t indices[4];
+	uint32_t count;
+	bool     contiguous;
+};
+
+// Entries begin to min(begin + 4, end) of the alive list
+inline ParticleLanes GetListLanes(const vector<uint32_t>& aliveList, size_t begin, size_t end)
+{
+	ParticleLanes lanes;
+	lanes.count = static_cast<uint32_t>(min<size_t>(end - begin, 4));
+	for (uint32_t lane = 0; lane < 4; ++lane)
+	{
+		lanes.indices[lane] = aliveList[min<size_t>(begin + lane, end - 1)];
+	}
+	// the list is sorted without repeats, so the ends being three apart makes all four consecutive
+	lanes.contiguous = lanes.count == 4 && lanes.indices[3] == lanes.indices[0] + 3;
+	return lanes;
+}
+
+// Slots slot to min(slot + 4, endSlot)
+inline ParticleLanes GetSlotLanes(size_t slot, size_t endSlot)
+{
+	ParticleLanes lanes;
+	lanes.count = static_cast<uint32_t>(min<size_t>(endSlot - slot, 4));
+	for (uint32_t lane = 0; lane < 4; ++lane)
+	{
+		lanes.indices[lane] = static_cast<uint32_t>(min<size_t>(slot + lane, endSlot - 1));
+	}
+	lanes.contiguous = lanes.count == 4;
+	return lanes;
+}
+
+inline XMVECTOR Gather(const vector<float>& stream, const ParticleLanes& lanes)
+{
+	if (lanes.contiguous) return Load(stream, lanes.indices[0]);
+	return XMVectorSet(stream[lanes.indices[0]], stream[lanes.indices[1]], stream[lanes.indices[2]], stream[lanes.indices[3]]);
+}
+
+inline void Scatter(vector<float>& stream, const ParticleLanes& lanes, FXMVECTOR value)
+{
+	if (lanes.contiguous)
+	{
+		Store(stream, lanes.indices[0], value);
+		return;
+	}
+	XMFLOAT4 values;
+	XMStoreFloat4(&values, value);
+	const float* laneValues = &values.x;
+	for (uint32_t lane = 0; lane < lanes.count; ++lane)
+	{
+		stream[lanes.indices[lane]] = laneValues[lane];
+	}
+}
+
+// One substep of one axis
+void Integrate(XMVECTOR& position, XMVECTOR& velocity, FXMVECTOR force, FXMVECTOR dt, FXMVECTOR halfDt2, ParticleIntegrator integrator)
+{
+	position = XMVectorAdd(position, XMVectorMultiply(velocity, dt));
+	if (integrator == ParticleIntegrator::Verlet)
+	{
+		position = XMVectorAdd(position, XMVectorMultiply(force, halfDt2));
+	}
+	velocity = XMVectorAdd(velocity, XMVectorMultiply(force, dt));
+}
+
+XMVECTOR Dot(const XMVECTOR position[3], const XMFLOAT4& plane)
+{
+	XMVECTOR dot = XMVectorMultiplyAdd(position[0], XMVectorReplicate(plane.x), XMVectorReplicate(plane.w));
+	dot = XMVectorMultiplyAdd(position[1], XMVectorReplicate(plane.y), dot);
+	return XMVectorMultiplyAdd(position[2], XMVectorReplicate(plane.z), dot);
+}
+
+// Moves the hit lanes depth along the collider's normal, and bounces those moving into it
+void Respond(const ParticleColliders& colliders, FXMVECTOR hit, const XMVECTOR normal[3], FXMVECTOR depth, XMVECTOR position[3], XMVECTOR velocity[3])
+{
+	XMVECTOR normalSpeed = XMVectorMultiply(velocity[0], normal[0]);
+	normalSpeed = XMVectorMultiplyAdd(velocity[1], normal[1], normalSpeed);
+	normalSpeed = XMVectorMultiplyAdd(velocity[2], normal[2], normalSpeed);
+	XMVECTOR bounce = XMVectorAndInt(hit, XMVectorLess(normalSpeed, XMVectorZero()));
+	const XMVECTOR tangentialScale = XMVectorReplicate(1.0f - colliders.friction);
+	const XMVECTOR normalScale = XMVectorNegate(XMVectorMultiply(normalSpeed, XMVectorReplicate(colliders.restitution)));
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		position[axis] = XMVectorSelect(position[axis], XMVectorMultiplyAdd(normal[axis], depth, position[axis]), hit);
+		XMVECTOR tangential = XMVectorNegativeMultiplySubtract(normal[axis], normalSpeed, velocity[axis]);
+		XMVECTOR bounced = XMVectorMultiplyAdd(normal[axis], normalScale, XMVectorMultiply(tangential, tangentialScale));
+		velocity[axis] = XMVectorSelect(velocity[axis], bounced, bounce);
+	}
+}
+
+// Collide in ParticlesComputeShader.hlsl does the same per particle
+void Collide(const ParticleColliders& colliders, const XMVECTOR previousPosition[3], XMVECTOR position[3], XMVECTOR velocity[3])
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR particleRadius = XMVectorReplicate(colliders.particleRadius);
+	for (const ParticlePlaneCollider& collider : colliders.planes)
+	{
+		XMVECTOR distance = Dot(position, collider.plane);
+		XMVECTOR hit = XMVectorAndInt(XMVectorLess(distance, particleRadius), XMVectorGreaterOrEqual(Dot(previousPosition, collider.plane), zero));
+		hit = XMVectorAndInt(hit, XMVectorLessOrEqual(XMVectorAbs(Dot(position, collider.tangentU)), one));
+		hit = XMVectorAndInt(hit, XMVectorLessOrEqual(XMVectorAbs(Dot(position, collider.tangentV)), one));
+		if (XMVector4EqualInt(hit, zero)) continue;
+		const XMVECTOR normal[3] = { XMVectorReplicate(collider.plane.x), XMVectorReplicate(collider.plane.y), XMVectorReplicate(collider.plane.z) };
+		Respond(colliders, hit, normal, XMVectorSubtract(particleRadius, distance), position, velocity);
+	}
+	for (const XMFLOAT4& sphere : colliders.spheres)
+	{
+		XMVECTOR offset[3] = {
+			XMVectorSubtract(position[0], XMVectorReplicate(sphere.x)),
+			XMVectorSubtract(position[1], XMVectorReplicate(sphere.y)),
+			XMVectorSubtract(position[2], XMVectorReplicate(sphere.z)) };
+		XMVECTOR distanceSquared = XMVectorMultiply(offset[0], offset[0]);
+		distanceSquared = XMVectorMultiplyAdd(offset[1], offset[1], distanceSquared);
+		distanceSquared = XMVectorMultiplyAdd(offset[2], offset[2], distanceSquared);
+		XMVECTOR reach = XMVectorAdd(XMVectorReplicate(sphere.w), particleRadius);
+		XMVECTOR hit = XMVectorLess(distanceSquared, XMVectorMultiply(reach, reach));
+		if (XMVector4EqualInt(hit, zero)) continue;
+		XMVECTOR distance = XMVectorSqrt(distanceSquared);
+		// a particle at the very center leaves upwards
+		XMVECTOR offCenter = XMVectorGreater(distance, zero);
+		XMVECTOR inverseDistance = XMVectorSelect(zero, XMVectorReciprocal(distance), offCenter);
+		XMVECTOR normal[3] = {
+			XMVectorMultiply(offset[0], inverseDistance),
+			XMVectorSelect(one, XMVectorMultiply(offset[1], inverseDistance), offCenter),
+			XMVectorMultiply(offset[2], inverseDistance) };
+		Respond(colliders, hit, normal, XMVectorSubtract(reach, distance), position, velocity);
+	}
+}
+} // namespace
+
+XorShiftRandom::XorShiftRandom(uint32_t seed)
+{
+	// murmur3 finalizer, so neighbouring seeds start far apart; xorshift never leaves a zero state
+	seed ^= seed >> 16;
+	seed *= 0x85EBCA6B;
+	seed ^= seed >> 13;
+	seed *= 0xC2B2AE35;
+	seed ^= seed >> 16;
+	m_state = seed != 0 ? seed : 0x6D2B79F5;
+}
+
+uint32_t ParticleEmitter::Update(float deltaTime)
+{
+	// the rate's backlog is capped at one budget, so a rate the budget cannot keep up with does not pile up
+	m_pending = min(m_pending + static_cast<double>(spawnRate) * deltaTime, static_cast<double>(spawnBudget));
+	// bursts go first
+	uint32_t burstCount = static_cast<uint32_t>(min<uint64_t>(m_pendingBurst, spawnBudget));
+	uint32_t rateCount = static_cast<uint32_t>(min(m_pending, static_cast<double>(spawnBudget - burstCount)));
+	m_pendingBurst -= burstCount;
+	m_pending -= rateCount;
+	return burstCount + rateCount;
+}
+
+uint32_t ParticleSimulation::GetSubstepCount(float deltaTime)
+{
+	float substepCount = ceilf(deltaTime / MAX_SUBSTEP_TIME);
+	if (!(substepCount > 1.0f)) return 1;
+	return substepCount < static_cast<float>(MAX_SUBSTEP_COUNT) ? static_cast<uint32_t>(substepCount) : MAX_SUBSTEP_COUNT;
+}
+
+void ParticleSimulation::Resize(size_t capacity)
+{
+	m_count = capacity;
+	m_aliveCount = 0;
+	m_depthSorted = false;
+	m_aliveList.clear();
+	m_deadList.resize(capacity);
+	for (size_t i = 0; i < capacity; ++i)
+	{
+		m_deadList[i] = static_cast<uint32_t>(i);
+	}
+
+	for (vector<float>* stream : {
+		&m_positionX, &m_positionY, &m_positionZ, &m_velocityX, &m_velocityY, &m_velocityZ, &m_forceX, &m_forceY, &m_forceZ,
+		&m_colorR, &m_colorG, &m_colorB, &m_colorA, &m_lifetime, &m_age })
+	{
+		stream->assign(capacity, 0.0f);
+	}
+}
+
+uint32_t ParticleSimulation::Spawn(uint32_t count, const XMFLOAT3& position, uint32_t seed)
+{
+	uint32_t spawnCount = static_cast<uint32_t>(min<size_t>(count, m_deadList.size()));
+	size_t firstDead = m_deadList.size() - spawnCount;
+	ThreadPool::GetInstance().ParallelFor(spawnCount, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		for (size_t spawn = begin; spawn < end; ++spawn)
+		{
+			// popped from the back like the compute shader does
+			uint32_t i = m_deadList[m_deadList.size() - 1 - spawn];
+			XorShiftRandom random(seed ^ static_cast<uint32_t>(spawn * 0x9E3779B9u));
+			m_positionX[i] = position.x;
+			m_positionY[i] = position.y;
+			m_positionZ[i] = position.z;
+
+			// upwards, fanning out towards +x and +z
+			m_velocityX[i] = random.NextFloat();
+			m_velocityY[i] = random.NextFloat(1.0f, 2.0f);
+			m_velocityZ[i] = random.NextFloat();
+
+			m_forceX[i] = 0.0f;
+			m_forceY[i] = GRAVITY;
+			m_forceZ[i] = 0.0f;
+
+			m_colorR[i] = random.NextFloat();
+			m_colorG[i] = random.NextFloat();
+			m_colorB[i] = random.NextFloat();
+			m_colorA[i] = 1.0f;
+
+			m_lifetime[i] = static_cast<float>(random.Next() % 10 + 1);	// whole seconds, 1 to 10
+			m_age[i] = 0.0f;
+		}
+	});
+
+	// merged in, so the alive list stays in slot order and Step walks the streams front to back
+	size_t aliveCount = m_aliveList.size();
+	m_aliveList.insert(m_aliveList.end(), m_deadList.begin() + firstDead, m_deadList.end());
+	sort(m_aliveList.begin() + aliveCount, m_aliveList.end());
+	inplace_merge(m_aliveList.begin(), m_aliveList.begin() + aliveCount, m_aliveList.end());
+	m_deadList.resize(firstDead);
+	m_aliveCount = m_aliveList.size();
+	m_depthSorted = false;
+	return spawnCount;
+}
+
+void ParticleSimulation::Step(float deltaTime, ParticleIntegrator integrator)
+{
+	ThreadPool& threadPool = ThreadPool::GetInstance();
+	const size_t aliveCount = m_aliveList.size();
+	const size_t chunkCount = (aliveCount + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	m_chunkAliveCounts.assign(chunkCount, 0);
+	m_depthSorted = false;
+	// the compute shader divides the same way, so both backends take identical substeps
+	uint32_t substepCount = GetSubstepCount(deltaTime);
+	float substepTime = deltaTime / static_cast<float>(substepCount);
+	bool collide = !m_colliders.planes.empty() || !m_colliders.spheres.empty();
+	threadPool.ParallelFor(chunkCount, 1, [&](size_t beginChunk, size_t endChunk)
+	{
+		const XMVECTOR dt = XMVectorReplicate(substepTime);
+		const XMVECTOR halfDt2 = XMVectorReplicate(0.5f * substepTime * substepTime);
+		const XMVECTOR one = XMVectorSplatOne();
+		const XMVECTOR laneOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+		vector<float>* positions[3] = { &m_positionX, &m_positionY, &m_positionZ };
+		vector<float>* velocities[3] = { &m_velocityX, &m_velocityY, &m_velocityZ };
+		const vector<float>* forces[3] = { &m_forceX, &m_forceY, &m_forceZ };
+
+		// Ages and integrates the alive lanes, leaving the others as they were; returns how many of them survive
+		auto simulate = [&](const ParticleLanes& lanes, FXMVECTOR alive)
+		{
+			XMVECTOR age = Gather(m_age, lanes);
+			XMVECTOR newAge = age;
+			for (uint32_t substep = 0; substep < substepCount; ++substep)
+			{
+				newAge = XMVectorAdd(newAge, dt);
+			}
+			Scatter(m_age, lanes, XMVectorSelect(age, newAge, alive));
+
+			XMVECTOR position[3], velocity[3], force[3];
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				position[axis] = Gather(*positions[axis], lanes);
+				velocity[axis] = Gather(*velocities[axis], lanes);
+				force[axis] = Gather(*forces[axis], lanes);
+			}
+			XMVECTOR newPosition[3] = { position[0], position[1], position[2] };
+			XMVECTOR newVelocity[3] = { velocity[0], velocity[1], velocity[2] };
+			for (uint32_t substep = 0; substep < substepCount; ++substep)
+			{
+				const XMVECTOR previousPosition[3] = { newPosition[0], newPosition[1], newPosition[2] };
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					Integrate(newPosition[axis], newVelocity[axis], force[axis], dt, halfDt2, integrator);
+				}
+				if (collide) Collide(m_colliders, previousPosition, newPosition, newVelocity);
+			}
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				Scatter(*positions[axis], lanes, XMVectorSelect(position[axis], newPosition[axis], alive));
+				Scatter(*velocities[axis], lanes, XMVectorSelect(velocity[axis], newVelocity[axis], alive));
+			}
+
+			XMVECTOR survives = XMVectorAndInt(alive, XMVectorLess(newAge, Gather(m_lifetime, lanes)));
+			survives = XMVectorAndInt(survives, XMVectorLess(laneOffsets, XMVectorReplicate(static_cast<float>(lanes.count))));
+			return HorizontalSum(XMVectorSelect(XMVectorZero(), one, survives));
+		};
+
+		for (size_t chunk = beginChunk; chunk < endChunk; ++chunk)
+		{
+			size_t begin = chunk * CHUNK_SIZE;
+			size_t end = min(begin + CHUNK_SIZE, aliveCount);
+			// the list is in slot order, so the chunk's particles span [firstSlot, endSlot) and no other chunk's do
+			size_t firstSlot = m_aliveList[begin];
+			size_t endSlot = m_aliveList[end - 1] + 1;
+			size_t survivorCount = 0;
+			if (endSlot - firstSlot > 2 * (end - begin))
+			{
+				const XMVECTOR alive = XMVectorTrueInt();
+				for (size_t i = begin; i < end; i += 4)
+				{
+					survivorCount += simulate(GetListLanes(m_aliveList, i, end), alive);
+				}
+				m_chunkAliveCounts[chunk] = survivorCount;
+				continue;
+			}
+
+			// mostly alive: sweeping the span four slots at a time beats gathering, with the dead slots, those past
+			// their lifetime, masked off. The ages move last, since they tell the dead apart.
+			const size_t sweepEnd = firstSlot + (endSlot - firstSlot) / 4 * 4;
+			const float* ages = m_age.data();
+			const float* lifetimes = m_lifetime.data();
+			auto isAlive = [&](size_t slot)
+			{
+				return XMVectorLess(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(ages + slot)), XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(lifetimes + slot)));
+			};
+			if (!collide)
+			{
+				// one axis at a time, so each pass streams three arrays
+				for (int axis = 0; axis < 3; ++axis)
+				{
+					float* position = positions[axis]->data();
+					float* velocity = velocities[axis]->data();
+					const float* force = forces[axis]->data();
+					for (size_t slot = firstSlot; slot < sweepEnd; slot += 4)
+					{
+						XMVECTOR p = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(position + slot));
+						XMVECTOR v = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(velocity + slot));
+						XMVECTOR f = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(force + slot));
+						XMVECTOR newP = p;
+						XMVECTOR newV = v;
+						for (uint32_t substep = 0; substep < substepCount; ++substep)
+						{
+							Integrate(newP, newV, f, dt, halfDt2, integrator);
+						}
+						XMVECTOR alive = isAlive(slot);
+						XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(position + slot), XMVectorSelect(p, newP, alive));
+						XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(velocity + slot), XMVectorSelect(v, newV, alive));
+					}
+				}
+			}
+			else
+			{
+				// all three axes at once, since a collision needs the whole position
+				for (size_t slot = firstSlot; slot < sweepEnd; slot += 4)
+				{
+					XMVECTOR position[3], velocity[3], force[3];
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						position[axis] = Load(*positions[axis], slot);
+						velocity[axis] = Load(*velocities[axis], slot);
+						force[axis] = Load(*forces[axis], slot);
+					}
+					XMVECTOR newPosition[3] = { position[0], position[1], position[2] };
+					XMVECTOR newVelocity[3] = { velocity[0], velocity[1], velocity[2] };
+					for (uint32_t substep = 0; substep < substepCount; ++substep)
+					{
+						const XMVECTOR previousPosition[3] = { newPosition[0], newPosition[1], newPosition[2] };
+						for (int axis = 0; axis < 3; ++axis)
+						{
+							Integrate(newPosition[axis], newVelocity[axis], force[axis], dt, halfDt2, integrator);
+						}
+						Collide(m_colliders, previousPosition, newPosition, newVelocity);
+					}
+					XMVECTOR alive = isAlive(slot);
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						Store(*positions[axis], slot, XMVectorSelect(position[axis], newPosition[axis], alive));
+						Store(*velocities[axis], slot, XMVectorSelect(velocity[axis], newVelocity[axis], alive));
+					}
+				}
+			}
+			XMVECTOR survivors = XMVectorZero();
+			for (size_t slot = firstSlot; slot < sweepEnd; slot += 4)
+			{
+				XMVECTOR age = Load(m_age, slot);
+				XMVECTOR lifetime = Load(m_lifetime, slot);
+				XMVECTOR newAge = age;
+				for (uint32_t substep = 0; substep < substepCount; ++substep)
+				{
+					newAge = XMVectorAdd(newAge, dt);
+				}
+				XMVECTOR alive = XMVectorLess(age, lifetime);
+				Store(m_age, slot, XMVectorSelect(age, newAge, alive));
+				survivors = XMVectorAdd(survivors, XMVectorSelect(XMVectorZero(), one, XMVectorAndInt(alive, XMVectorLess(newAge, lifetime))));
+			}
+			survivorCount = HorizontalSum(survivors);
+			if (sweepEnd < endSlot)
+			{
+				ParticleLanes lanes = GetSlotLanes(sweepEnd, endSlot);
+				survivorCount += simulate(lanes, XMVectorLess(Gather(m_age, lanes), Gather(m_lifetime, lanes)));
+			}
+			m_chunkAliveCounts[chunk] = survivorCount;
+		}
+	});
+
+	// stream compaction: each chunk writes its survivors after those of the chunks before it, which keeps them in
+	// slot order, and appends its dead to the dead list after the dead of the chunks before it
+	vector<size_t> survivorOffsets(chunkCount);
+	size_t survivorCount = 0;
+	for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+	{
+		survivorOffsets[chunk] = survivorCount;
+		survivorCount += m_chunkAliveCounts[chunk];
+	}
+	const size_t deadCount = m_deadList.size();
+	m_survivorList.resize(survivorCount);
+	m_deadList.resize(deadCount + aliveCount - survivorCount);
+
+	threadPool.ParallelFor(chunkCount, 1, [&](size_t beginChunk, size_t endChunk)
+	{
+		for (size_t chunk = beginChunk; chunk < endChunk; ++chunk)
+		{
+			size_t begin = chunk * CHUNK_SIZE;
+			size_t end = min(begin + CHUNK_SIZE, aliveCount);
+			size_t survivorIndex = survivorOffsets[chunk];
+			size_t deadIndex = deadCount + begin - survivorOffsets[chunk];
+			for (size_t i = begin; i < end; ++i)
+			{
+				uint32_t index = m_aliveList[i];
+				if (m_age[index] < m_lifetime[index]) m_survivorList[survivorIndex++] = index;
+				else m_deadList[deadIndex++] = index;
+			}
+		}
+	});
+	m_aliveList.swap(m_survivorList);
+	m_aliveCount = survivorCount;
+}
+
+void ParticleSimulation::SortAliveList(const XMFLOAT4& viewDepth)
+{
+	m_drawList = m_aliveList;
+	m_depthSorted = true;
+	m_sortKeys.resize(m_aliveList.size());
+	ThreadPool::GetInstance().ParallelFor(m_aliveList.size(), CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			uint32_t index = m_aliveList[i];
+			float depth = m_positionX[index] * viewDepth.x + m_positionY[index] * viewDepth.y + m_positionZ[index] * viewDepth.z + viewDepth.w;
+			// inverted, so the farthest particle comes first
+			m_sortKeys[i] = ~RadixSorter::FloatToKey(depth);
+		}
+	});
+	m_sorter.Sort(m_sortKeys, m_drawList);
+}
+
+const SpatialHashGrid& ParticleSimulation::BuildNeighborGrid(float cellSize)
+{
+	m_neighborGrid.Build(m_positionX.data(), m_positionY.data(), m_positionZ.data(), m_aliveList.data(), m_aliveList.size(), cellSize);
+	return m_neighborGrid;
+}
+
+void ParticleSimulation::WriteParticles(ParticleData* outParticles) const
+{
+	ThreadPool::GetInstance().ParallelFor(m_count, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			ParticleData& particle = outParticles[i];
+			particle.position[0] = m_positionX[i];
+			particle.position[1] = m_positionY[i];
+			particle.position[2] = m_positionZ[i];
+			particle.velocity[0] = m_velocityX[i];
+			particle.velocity[1] = m_velocityY[i];
+			particle.velocity[2] = m_velocityZ[i];
+			particle.force[0] = m_forceX[i];
+			particle.force[1] = m_forceY[i];
+			particle.force[2] = m_forceZ[i];
+			particle.color[0] = m_colorR[i];
+			particle.color[1] = m_colorG[i];
+			particle.color[2] = m_colorB[i];
+			particle.color[3] = m_colorA[i];
+			particle.lifetime = m_lifetime[i];
+			particle.age = m_age[i];
+		}
+	});
+}
+
+void ParticleSimulation::WriteLists(uint32_t* outLists) const
+{
+	ParticleListHeader header = {};
+	header.deadCount = static_cast<uint32_t>(m_deadList.size());
+	header.aliveCount[0] = static_cast<uint32_t>(m_aliveCount);
+	header.drawArguments[0] = 1;
+	header.drawArguments[1] = header.aliveCount[0];
+	header.dispatchArguments[0] = (header.aliveCount[0] + PARTICLE_THREAD_GROUP_SIZE - 1) / PARTICLE_THREAD_GROUP_SIZE;
+	header.dispatchArguments[1] = 1;
+	header.dispatchArguments[2] = 1;
+	memcpy(outLists, &header, sizeof(header));
+
+	uint32_t* deadList = outLists + sizeof(header) / sizeof(uint32_t);
+	memcpy(deadList, m_deadList.data(), m_deadList.size() * sizeof(uint32_t));
+	memcpy(deadList + m_count, GetDrawList().data(), m_aliveCount * sizeof(uint32_t));
+}
+} // namespace Lunar
@@ -0,0 +1,183 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "Utils/RadixSort.h"
+#include "Utils/SpatialHashGrid.h"
+
+namespace Lunar
+{
+// Matches Particle in ParticlesComputeShader.hlsl and ParticleVertexShader.hlsl
+struct ParticleData
+{
+	float position[3];
+	float velocity[3];
+	float force[3];
+	float color[4];
+	float lifetime;
+	float age;
+};
+
+// Marsaglia's 32-bit xorshift. Cheap enough to seed per particle, which keeps parallel emission deterministic.
+class XorShiftRandom
+{
+public:
+	explicit XorShiftRandom(uint32_t seed);
+
+	uint32_t Next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 17;
+		m_state ^= m_state << 5;
+		return m_state;
+	}
+	// [0, 1) with 24 bits of precision
+	float NextFloat() { return static_cast<float>(Next() >> 8) * (1.0f / 16777216.0f); }
+	float NextFloat(float min, float max) { return min + (max - min) * NextFloat(); }
+
+private:
+	uint32_t m_state;
+};
+
+static constexpr uint32_t PARTICLE_THREAD_GROUP_SIZE = 64;	// numthreads in ParticlesComputeShader.hlsl
+
+// Head of the particle list buffer, followed by the dead list and the two alive lists of capacity indices each.
+// Matches the offsets in ParticleCommon.hlsl.
+struct ParticleListHeader
+{
+	uint32_t deadCount;
+	uint32_t aliveCount[2];			// the compute shader appends survivors of list i to list 1 - i
+	uint32_t padding0;
+	uint32_t drawArguments[4];		// D3D12_DRAW_ARGUMENTS: one point per alive particle
+	uint32_t dispatchArguments[3];	// D3D12_DISPATCH_ARGUMENTS: one thread per alive particle, for the next update
+	uint32_t padding1;
+};
+
+// Turns a continuous spawn rate and bursts into a per-frame spawn count capped by a budget.
+// What the budget holds back carries over to the next frames: all of a burst, and up to one budget of the rate.
+class ParticleEmitter
+{
+public:
+	float    spawnRate = 0.0f;		// particles per second
+	uint32_t spawnBudget = 1024;	// most particles spawned in one frame
+
+	void     Burst(uint32_t count) { m_pendingBurst += count; }
+	uint32_t Update(float deltaTime);
+	void     Clear() { m_pending = 0.0; m_pendingBurst = 0; }
+
+private:
+	double   m_pending = 0.0;		// fractional spawns carry over too
+	uint64_t m_pendingBurst = 0;
+};
+
+enum class ParticleIntegrator
+{
+	Euler,	// explicit Euler
+	Verlet	// velocity Verlet, exact for the constant per-particle force and so independent of the frame rate
+};
+
+// Rectangle of a plane. Particles that cross it from the front collide where |dot((position, 1), tangentU)|
+// and |dot((position, 1), tangentV)| are at most one; from behind they pass through.
+struct ParticlePlaneCollider
+{
+	DirectX::XMFLOAT4 plane;	// unit normal and offset, so dot((position, 1), plane) is the signed distance
+	DirectX::XMFLOAT4 tangentU;	// scaled and offset so the rectangle's edges are at -1 and 1
+	DirectX::XMFLOAT4 tangentV;
+};
+
+// Scene geometry the particles bounce off, tested after every substep on both backends
+struct ParticleColliders
+{
+	std::vector<ParticlePlaneCollider> planes;
+	std::vector<DirectX::XMFLOAT4>     spheres;	// center and radius
+	float restitution = 0.3f;		// fraction of the normal speed a bounce keeps
+	float friction = 0.2f;			// fraction of the tangential speed a bounce loses
+	float particleRadius = 0.01f;	// half the quad ParticleVertexShader.hlsl draws
+};
+
+// CPU particle simulation over structure-of-arrays streams, the fallback and reference for the compute shader path.
+// Like the compute shader, spawns take slots from the dead list, and Step simulates only the slots the alive list
+// names, four lanes at a time with DirectXMath in chunks of the list on the thread pool. The alive list is kept in
+// slot order, so a chunk covers a span of slots no other chunk touches: a mostly alive span is swept with whole
+// loads and the dead lanes masked off, and a sparse one is gathered through the list.
+// The lists hold the same sets as on the GPU, but here they come out of a stream compaction rather than out of
+// atomic appends: the dead are appended in slot order, and spawns are merged into the alive list.
+class ParticleSimulation
+{
+public:
+	// Every slot starts out dead
+	void Resize(size_t capacity);
+	size_t GetCount() const { return m_count; }
+
+	// Ages and integrates the alive particles in GetSubstepCount(deltaTime) equal substeps, colliding after each,
+	// then moves those that died from the alive list to the dead list
+	void Step(float deltaTime, ParticleIntegrator integrator = ParticleIntegrator::Euler);
+	void SetColliders(const ParticleColliders& colliders) { m_colliders = colliders; }
+	const ParticleColliders& GetColliders() const { return m_colliders; }
+	// Brings up to count dead particles to life at position and returns how many there were room for.
+	// They are appended to the alive list and first move in the next Step, as in the compute shader, which emits
+	// after the update. Spawn i of a call depends only on seed and i. When the dead list runs short the first
+	// spawns win here, while on the GPU the winners depend on thread order.
+	uint32_t Spawn(uint32_t count, const DirectX::XMFLOAT3& position, uint32_t seed);
+
+	// Long frames are split into substeps of at most MAX_SUBSTEP_TIME, up to MAX_SUBSTEP_COUNT of them
+	static uint32_t GetSubstepCount(float deltaTime);
+
+	// Orders the draw list back to front for blending until the next Step or Spawn. viewDepth holds the view
+	// matrix's third column, so a particle's view-space depth is dot((position, 1), viewDepth). Sorts depth keys
+	// with particle indices rather than moving particles; ties keep slot order.
+	void SortAliveList(const DirectX::XMFLOAT4& viewDepth);
+
+	// Grids the alive particles for neighbour queries, which report particle slots. The cell size bounds the
+	// query radius, e.g. an SPH kernel's support.
+	const SpatialHashGrid& BuildNeighborGrid(float cellSize);
+
+	size_t GetAliveCount() const { return m_aliveCount; }
+	const std::vector<uint32_t>& GetAliveList() const { return m_aliveList; }	// in slot order
+	const std::vector<uint32_t>& GetDeadList() const { return m_deadList; }
+	// The alive particles in the order to draw them: back to front after SortAliveList, otherwise the alive list
+	const std::vector<uint32_t>& GetDrawList() const { return m_depthSorted ? m_drawList : m_aliveList; }
+
+	// Interleaves the first GetCount() particles into the GPU layout
+	void WriteParticles(ParticleData* outParticles) const;
+	// Header and lists in the particle list buffer layout, with the draw list as list 0 and the dispatch
+	// arguments sized for it
+	void WriteLists(uint32_t* outLists) const;
+	static size_t GetListBufferSize(size_t capacity) { return sizeof(ParticleListHeader) + 3 * capacity * sizeof(uint32_t); }
+
+private:
+	static constexpr size_t   CHUNK_SIZE = 4096;	// alive list entries or particles per thread pool chunk
+	static constexpr float    MAX_SUBSTEP_TIME = 1.0f / 60.0f;
+	static constexpr uint32_t MAX_SUBSTEP_COUNT = 8;	// past this a hitch takes longer substeps rather than more
+
+	size_t                m_count = 0;
+	size_t                m_aliveCount = 0;
+	std::vector<uint32_t> m_aliveList;
+	std::vector<uint32_t> m_survivorList;	// the next alive list while Step compacts the current one
+	std::vector<uint32_t> m_deadList;		// spawns pop from the back
+	std::vector<uint32_t> m_drawList;
+	bool                  m_depthSorted = false;
+	std::vector<size_t>   m_chunkAliveCounts;
+	std::vector<uint32_t> m_sortKeys;
+	RadixSorter           m_sorter;
+	ParticleColliders     m_colliders;
+	SpatialHashGrid       m_neighborGrid;
+	std::vector<float>    m_positionX;
+	std::vector<float>    m_positionY;
+	std::vector<float>    m_positionZ;
+	std::vector<float>    m_velocityX;
+	std::vector<float>    m_velocityY;
+	std::vector<float>    m_velocityZ;
+	std::vector<float>    m_forceX;
+	std::vector<float>    m_forceY;
+	std::vector<float>    m_forceZ;
+	std::vector<float>    m_colorR;
+	std::vector<float>    m_colorG;
+	std::vector<float>    m_colorB;
+	std::vector<float>    m_colorA;
+	std::vector<float>    m_lifetime;
+	std::vector<float>    m_age;
+};
+} // namespace Lunar
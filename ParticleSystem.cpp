@@ -1,7 +1,11 @@
 #include "ParticleSystem.h"
 
+#include <cstddef>
+#include <cstring>
 #include <d3d12.h>
 
+#include "ConstantBuffers.h"
+#include "PipelineStateManager.h"
 #include "Utils/Logger.h"
 #include "LunarConstants.h"
 #include "Utils/Utils.h"
@@ -10,24 +14,38 @@ using namespace DirectX;
 
 namespace Lunar
 {
-
 void ParticleSystem::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList)
 {
-    // Create 500 particles with random positions and velocities and colors 
-    // 1. initial velocities are towards the up direction of the screen
-    // 2. for now, initial positions are in the center of the world
-    // 3. colors are random
-    particles.resize(512);
-    ResetParticles();
-
-    // Create double buffers for the particles
-    // 1. Create a default heap for the particle buffer
-    // 2. Create a resource description for the particle buffer
-    // 3. Create the committed resource for the particle buffer
-    // 4. Create an upload buffer to copy the particle data to the GPU
-    // 5. Map the upload buffer to copy the particle data
-    // 6. With transition barrier, copy the data from the upload buffer to the default buffer
-    // 7. Transition the particle buffer to the generic read state
+	// Every particle starts dead; emission takes slots from the dead list
+	m_simulation.Resize(m_capacity);
+	CreateBuffers(device);
+
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+	argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+
+	D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+	signatureDesc.ByteStride = sizeof(D3D12_DRAW_ARGUMENTS);
+	signatureDesc.NumArgumentDescs = 1;
+	signatureDesc.pArgumentDescs = &argumentDesc;
+	THROW_IF_FAILED(device->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(&m_drawSignature)));
+
+	argumentDesc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH;
+	signatureDesc.ByteStride = sizeof(D3D12_DISPATCH_ARGUMENTS);
+	THROW_IF_FAILED(device->CreateCommandSignature(&signatureDesc, nullptr, IID_PPV_ARGS(&m_dispatchSignature)));
+
+	UploadParticlesToGPU(commandList);
+	m_resetFlag = false;
+}
+
+void ParticleSystem::CreateBuffers(ID3D12Device* device)
+{
+    // 1. Particle buffer, simulated in place
+    // 2. List buffer: counters and indirect arguments, then the dead list and two alive lists
+    // 3. Upload buffers for both, written on reset and by the CPU backend every frame
+    // 4. Readback buffer for the list header, so the alive count reaches the CPU
+    // 5. Sort buffer for the depth sort
+    // 6. Dispatch argument buffer for the update pass
+    // 7. Collider buffer, room for MAX_PARTICLE_COLLIDERS planes
 
     D3D12_HEAP_PROPERTIES defaultHeapProperties = {};
     defaultHeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
@@ -35,10 +53,10 @@ void ParticleSystem::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList*
     defaultHeapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
     defaultHeapProperties.CreationNodeMask = 1;
     defaultHeapProperties.VisibleNodeMask = 1;
-    
+
     D3D12_RESOURCE_DESC bufferDesc = {};
     bufferDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    bufferDesc.Width = sizeof(Particle) * particles.size();
+    bufferDesc.Width = sizeof(ParticleData) * m_simulation.GetCount();
     bufferDesc.Height = 1;
     bufferDesc.DepthOrArraySize = 1;
     bufferDesc.MipLevels = 1;
@@ -48,173 +66,426 @@ void ParticleSystem::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList*
     bufferDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
     bufferDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
 
+    D3D12_RESOURCE_DESC listBufferDesc = bufferDesc;
+    listBufferDesc.Width = ParticleSimulation::GetListBufferSize(m_simulation.GetCount());
+
     THROW_IF_FAILED(device->CreateCommittedResource(
         &defaultHeapProperties,
         D3D12_HEAP_FLAG_NONE,
         &bufferDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr, 
-        IID_PPV_ARGS(&m_particleBuffers[0])));
+        nullptr,
+        IID_PPV_ARGS(&m_particleBuffer)));
 
     THROW_IF_FAILED(device->CreateCommittedResource(
         &defaultHeapProperties,
         D3D12_HEAP_FLAG_NONE,
-        &bufferDesc,
+        &listBufferDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr, 
-        IID_PPV_ARGS(&m_particleBuffers[1])));
+        nullptr,
+        IID_PPV_ARGS(&m_listBuffer)));
 
     D3D12_HEAP_PROPERTIES uploadHeapProperties = defaultHeapProperties;
     uploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
-    
+
     D3D12_RESOURCE_DESC uploadBufferDesc = bufferDesc;
     uploadBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+    D3D12_RESOURCE_DESC listUploadBufferDesc = listBufferDesc;
+    listUploadBufferDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
 
     THROW_IF_FAILED(device->CreateCommittedResource(
         &uploadHeapProperties,
         D3D12_HEAP_FLAG_NONE,
         &uploadBufferDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr, 
-        IID_PPV_ARGS(&m_uploadBuffers[0])));
+        nullptr,
+        IID_PPV_ARGS(&m_particleUploadBuffer)));
 
     THROW_IF_FAILED(device->CreateCommittedResource(
         &uploadHeapProperties,
         D3D12_HEAP_FLAG_NONE,
-        &uploadBufferDesc,
+        &listUploadBufferDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr, 
-        IID_PPV_ARGS(&m_uploadBuffers[1])));
+        nullptr,
+        IID_PPV_ARGS(&m_listUploadBuffer)));
 
-	UploadParticlesToGPU(commandList);
-}
+    D3D12_HEAP_PROPERTIES readbackHeapProperties = defaultHeapProperties;
+    readbackHeapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+
+    D3D12_RESOURCE_DESC readbackBufferDesc = listUploadBufferDesc;
+    readbackBufferDesc.Width = sizeof(ParticleListHeader);
+
+    THROW_IF_FAILED(device->CreateCommittedResource(
+        &readbackHeapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &readbackBufferDesc,
+        D3D12_RESOURCE_STATE_COPY_DEST,
+        nullptr,
+        IID_PPV_ARGS(&m_listReadbackBuffer)));
+
+    D3D12_RESOURCE_DESC sortBufferDesc = bufferDesc;
+    sortBufferDesc.Width = sizeof(uint32_t) * 2 * GetSortSize();
+
+    THROW_IF_FAILED(device->CreateCommittedResource(
+        &defaultHeapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &sortBufferDesc,
+        D3D12_RESOURCE_STATE_UNORDERED_ACCESS,
+        nullptr,
+        IID_PPV_ARGS(&m_sortBuffer)));
+
+    D3D12_RESOURCE_DESC argumentBufferDesc = listUploadBufferDesc;
+    argumentBufferDesc.Width = sizeof(D3D12_DISPATCH_ARGUMENTS);
+
+    THROW_IF_FAILED(device->CreateCommittedResource(
+        &defaultHeapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &argumentBufferDesc,
+        D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT,
+        nullptr,
+        IID_PPV_ARGS(&m_dispatchArgumentBuffer)));
 
+    D3D12_RESOURCE_DESC colliderBufferDesc = listUploadBufferDesc;
+    colliderBufferDesc.Width = sizeof(ParticlePlaneCollider) * LunarConstants::MAX_PARTICLE_COLLIDERS;
+
+    THROW_IF_FAILED(device->CreateCommittedResource(
+        &uploadHeapProperties,
+        D3D12_HEAP_FLAG_NONE,
+        &colliderBufferDesc,
+        D3D12_RESOURCE_STATE_GENERIC_READ,
+        nullptr,
+        IID_PPV_ARGS(&m_colliderBuffer)));
+}
 
 void ParticleSystem::EmitParticles(const XMFLOAT3& position)
 {
-    ResetParticles(position);
+	m_emitPosition = position;
+	m_emitter.Burst(burstCount);
 }
 
-void ParticleSystem::ResetParticles(const XMFLOAT3& position)
+void ParticleSystem::SetBackend(ParticleBackend backend)
 {
+	m_backend = backend;
+	m_emitter.Clear();
 	m_resetFlag = true;
-    for (auto& particle : particles)
-    {
-        particle.position[0] = position.x; 
-        particle.position[1] = position.y; 
-        particle.position[2] = position.z; 
-
-        particle.velocity[0] = static_cast<float>(rand() % 100) / 100.0f; 
-        particle.velocity[1] = static_cast<float>(rand() % 100) / 100.0f + 1.0f;
-        particle.velocity[2] = static_cast<float>(rand() % 100) / 100.0f;
-
-        particle.force[0] = 0.0f;
-        particle.force[1] = -9.81f; // Gravity force in the negative Y direction
-        particle.force[2] = 0.0f; 
-
-        particle.color[0] = static_cast<float>(rand() % 256) / 255.0f;
-        particle.color[1] = static_cast<float>(rand() % 256) / 255.0f;
-        particle.color[2] = static_cast<float>(rand() % 256) / 255.0f;
-        particle.color[3] = 1.0f;
-
-        particle.lifetime = static_cast<float>(rand() % 10 + 1); 
-        particle.age = 0.0f; 
-    }
+}
+
+void ParticleSystem::SetCapacity(uint32_t capacity)
+{
+	if (capacity > LunarConstants::MAX_PARTICLE_CAPACITY)
+	{
+		LOG_WARNING("Particle capacity ", capacity, " clamped to ", LunarConstants::MAX_PARTICLE_CAPACITY);
+		capacity = LunarConstants::MAX_PARTICLE_CAPACITY;
+	}
+	m_capacity = capacity;
+}
+
+void ParticleSystem::SetViewMatrix(const XMFLOAT4X4& view)
+{
+	m_viewDepth = XMFLOAT4(view._13, view._23, view._33, view._43);
+}
+
+void ParticleSystem::SetColliders(const ParticleColliders& colliders)
+{
+	size_t colliderCount = colliders.planes.size() + colliders.spheres.size();
+	if (colliderCount <= LunarConstants::MAX_PARTICLE_COLLIDERS)
+	{
+		m_simulation.SetColliders(colliders);
+		return;
+	}
+
+	LOG_WARNING("Particle colliders ", colliderCount, " clamped to ", LunarConstants::MAX_PARTICLE_COLLIDERS);
+	ParticleColliders clamped = colliders;
+	if (clamped.planes.size() > LunarConstants::MAX_PARTICLE_COLLIDERS) clamped.planes.resize(LunarConstants::MAX_PARTICLE_COLLIDERS);
+	clamped.spheres.resize(LunarConstants::MAX_PARTICLE_COLLIDERS - clamped.planes.size());
+	m_simulation.SetColliders(clamped);
+}
+
+uint32_t ParticleSystem::GetSortSize() const
+{
+	// a power of two, and at least one run of the shader's shared-memory sort
+	uint32_t sortSize = 1024;
+	while (sortSize < m_capacity) sortSize <<= 1;
+	return sortSize;
+}
+
+void ParticleSystem::SetParticleConstants(ID3D12GraphicsCommandList* commandList, uint32_t spawnCount, float deltaTime, bool compute)
+{
+	ParticleConstants constants = {};
+	constants.emitterPosition = m_emitPosition;
+	constants.spawnCount = spawnCount;
+	constants.seed = m_spawnSeed;
+	constants.aliveListIndex = m_aliveListIndex;
+	constants.capacity = static_cast<uint32_t>(m_simulation.GetCount());
+	constants.deltaTime = deltaTime;
+	constants.substepCount = ParticleSimulation::GetSubstepCount(deltaTime);
+	constants.integrator = static_cast<uint32_t>(m_integrator);
+	constants.viewDepth = m_viewDepth;
+	const ParticleColliders& colliders = m_simulation.GetColliders();
+	constants.planeColliderCount = static_cast<uint32_t>(colliders.planes.size());
+	constants.sphereColliderCount = static_cast<uint32_t>(colliders.spheres.size());
+	constants.restitution = colliders.restitution;
+	constants.friction = colliders.friction;
+	constants.particleRadius = colliders.particleRadius;
+
+	UINT num32BitValues = sizeof(ParticleConstants) / sizeof(uint32_t);
+	if (compute)
+	{
+		commandList->SetComputeRoot32BitConstants(LunarConstants::PARTICLE_CONSTANTS_ROOT_PARAMETER_INDEX, num32BitValues, &constants, 0);
+	}
+	else
+	{
+		commandList->SetGraphicsRoot32BitConstants(LunarConstants::PARTICLE_CONSTANTS_ROOT_PARAMETER_INDEX, num32BitValues, &constants, 0);
+	}
 }
 
 void ParticleSystem::UploadParticlesToGPU(ID3D12GraphicsCommandList* commandList)
 {
-	for (int i = 0; i < 2; ++i) {
-		BYTE* pData = nullptr;
-		THROW_IF_FAILED(m_uploadBuffers[i]->Map(0, nullptr, reinterpret_cast<void**>(&pData)));
-		memcpy(pData, particles.data(), sizeof(Particle) * particles.size());
-		m_uploadBuffers[i]->Unmap(0, nullptr);
+	UINT64 bufferSize = sizeof(ParticleData) * m_simulation.GetCount();
+	UINT64 listBufferSize = ParticleSimulation::GetListBufferSize(m_simulation.GetCount());
+
+	BYTE* pData = nullptr;
+	THROW_IF_FAILED(m_particleUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pData)));
+	m_simulation.WriteParticles(reinterpret_cast<ParticleData*>(pData));
+	m_particleUploadBuffer->Unmap(0, nullptr);
+
+	THROW_IF_FAILED(m_listUploadBuffer->Map(0, nullptr, reinterpret_cast<void**>(&pData)));
+	m_simulation.WriteLists(reinterpret_cast<uint32_t*>(pData));
+	m_listUploadBuffer->Unmap(0, nullptr);
 
-		D3D12_RESOURCE_BARRIER barrier = {};
+	D3D12_RESOURCE_BARRIER barriers[2] = {};
+	for (D3D12_RESOURCE_BARRIER& barrier : barriers)
+	{
 		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
 		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-		barrier.Transition.pResource = m_particleBuffers[i].Get();
 		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_GENERIC_READ;
 		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
 		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-		commandList->ResourceBarrier(1, &barrier);
+	}
+	barriers[0].Transition.pResource = m_particleBuffer.Get();
+	barriers[1].Transition.pResource = m_listBuffer.Get();
+	commandList->ResourceBarrier(2, barriers);
 
-		commandList->CopyBufferRegion(
-			m_particleBuffers[i].Get(),
-			0,
-			m_uploadBuffers[i].Get(),
-			0,
-			sizeof(Particle) * particles.size()
-		);
+	commandList->CopyBufferRegion(m_particleBuffer.Get(), 0, m_particleUploadBuffer.Get(), 0, bufferSize);
+	commandList->CopyBufferRegion(m_listBuffer.Get(), 0, m_listUploadBuffer.Get(), 0, listBufferSize);
 
+	for (D3D12_RESOURCE_BARRIER& barrier : barriers)
+	{
 		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
 		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
-		commandList->ResourceBarrier(1, &barrier);
 	}
+	commandList->ResourceBarrier(2, barriers);
+
+	// the uploaded lists start at alive list 0
+	m_aliveListIndex = 0;
+}
+
+void ParticleSystem::UploadCollidersToGPU()
+{
+	// planes first, then spheres, as Collide in ParticlesComputeShader.hlsl reads them
+	const ParticleColliders& colliders = m_simulation.GetColliders();
+	size_t planeBytes = sizeof(ParticlePlaneCollider) * colliders.planes.size();
+	size_t sphereBytes = sizeof(XMFLOAT4) * colliders.spheres.size();
+	if (planeBytes + sphereBytes == 0) return;
+
+	BYTE* pData = nullptr;
+	D3D12_RANGE readRange = { 0, 0 };
+	THROW_IF_FAILED(m_colliderBuffer->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+	memcpy(pData, colliders.planes.data(), planeBytes);
+	memcpy(pData + planeBytes, colliders.spheres.data(), sphereBytes);
+	m_colliderBuffer->Unmap(0, nullptr);
+}
+
+void ParticleSystem::SortAliveList(ID3D12GraphicsCommandList* commandList, PipelineStateManager* pipelineStateManager)
+{
+	// Bitonic sort over GetSortSize() entries; runs of 1024 sort in shared memory, so only steps with partners
+	// further apart go through memory. Groups past the alive count return early.
+	commandList->SetComputeRootUnorderedAccessView(
+		LunarConstants::PARTICLE_SORT_UAV_ROOT_PARAMETER_INDEX,
+		m_sortBuffer->GetGPUVirtualAddress()
+	);
+	const uint32_t localSortSize = 1024;	// LOCAL_SORT_SIZE in ParticleSortShader.hlsl, sorted by groups of half as many threads
+	uint32_t sortSize = GetSortSize();
+	UINT blockSizeOffset = offsetof(ParticleConstants, sortBlockSize) / sizeof(uint32_t);
+	UINT stepSizeOffset = offsetof(ParticleConstants, sortStepSize) / sizeof(uint32_t);
+
+	D3D12_RESOURCE_BARRIER uavBarrier = {};
+	uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+	uavBarrier.UAV.pResource = nullptr;
+
+	commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesBuildSortKeys"));
+	commandList->Dispatch(sortSize / (localSortSize / 2), 1, 1);
+	commandList->ResourceBarrier(1, &uavBarrier);
+
+	commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesSortLocal"));
+	commandList->Dispatch(sortSize / localSortSize, 1, 1);
+	commandList->ResourceBarrier(1, &uavBarrier);
+
+	for (uint32_t blockSize = localSortSize * 2; blockSize <= sortSize; blockSize <<= 1)
+	{
+		commandList->SetComputeRoot32BitConstant(LunarConstants::PARTICLE_CONSTANTS_ROOT_PARAMETER_INDEX, blockSize, blockSizeOffset);
+		commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesSortStep"));
+		for (uint32_t stepSize = blockSize / 2; stepSize >= localSortSize; stepSize >>= 1)
+		{
+			commandList->SetComputeRoot32BitConstant(LunarConstants::PARTICLE_CONSTANTS_ROOT_PARAMETER_INDEX, stepSize, stepSizeOffset);
+			commandList->Dispatch(sortSize / 2 / PARTICLE_THREAD_GROUP_SIZE, 1, 1);
+			commandList->ResourceBarrier(1, &uavBarrier);
+		}
+		commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesMergeLocal"));
+		commandList->Dispatch(sortSize / localSortSize, 1, 1);
+		commandList->ResourceBarrier(1, &uavBarrier);
+	}
+
+	commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesWriteSortedList"));
+	commandList->Dispatch((m_capacity + PARTICLE_THREAD_GROUP_SIZE - 1) / PARTICLE_THREAD_GROUP_SIZE, 1, 1);
 }
 
 int ParticleSystem::GetActiveParticleCount() const
 {
-    int activeCount = 0;
-    for (const auto& particle : particles) {
-        if (particle.age < particle.lifetime) {
-            ++activeCount;
-        }
-    }
-    return activeCount;
+	if (m_backend == ParticleBackend::CPU) return static_cast<int>(m_simulation.GetAliveCount());
+	return static_cast<int>(m_gpuAliveCount);
 }
 
 void ParticleSystem::DrawParticles(ID3D12GraphicsCommandList* commandList)
 {
+	// the compute shader wrote the alive count into the draw arguments, so nothing waits on the CPU here
+	SetParticleConstants(commandList, 0, 0.0f, false);
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::PARTICLE_SRV_ROOT_PARAMETER_INDEX,
+		m_particleBuffer->GetGPUVirtualAddress()
+	);
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::PARTICLE_LIST_SRV_ROOT_PARAMETER_INDEX,
+		m_listBuffer->GetGPUVirtualAddress()
+	);
+	commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
+	commandList->ExecuteIndirect(m_drawSignature.Get(), 1, m_listBuffer.Get(), offsetof(ParticleListHeader, drawArguments), nullptr, 0);
+}
+
+void ParticleSystem::Update(float deltaTime, ID3D12GraphicsCommandList* commandList, PipelineStateManager* pipelineStateManager)
+{
+	// the previous frame has finished, so its readback is complete and the buffers are free to overwrite or release
+	if (m_simulation.GetCount() != m_capacity)
+	{
+		Microsoft::WRL::ComPtr<ID3D12Device> device;
+		THROW_IF_FAILED(commandList->GetDevice(IID_PPV_ARGS(&device)));
+		m_simulation.Resize(m_capacity);
+		CreateBuffers(device.Get());
+		m_resetFlag = true;
+	}
 	if (m_resetFlag)
 	{
+		m_simulation.Resize(m_capacity);
 		UploadParticlesToGPU(commandList);
+		m_gpuAliveCount = 0;
+		m_hasReadback = false;
 		m_resetFlag = false;
 	}
-    int activeParticles = GetActiveParticleCount();
-
-    if (activeParticles > 0) {
-        commandList->SetGraphicsRootShaderResourceView(
-            LunarConstants::PARTICLE_SRV_ROOT_PARAMETER_INDEX, 
-            m_particleBuffers[m_currentBuffer]->GetGPUVirtualAddress()
-        );
-        commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_POINTLIST);
-        commandList->DrawInstanced(1, particles.size(), 0, 0);
-    }
-}
+	else if (m_hasReadback)
+	{
+		ParticleListHeader* header = nullptr;
+		D3D12_RANGE readRange = { 0, sizeof(ParticleListHeader) };
+		THROW_IF_FAILED(m_listReadbackBuffer->Map(0, &readRange, reinterpret_cast<void**>(&header)));
+		m_gpuAliveCount = header->drawArguments[1];
+		D3D12_RANGE writeRange = { 0, 0 };
+		m_listReadbackBuffer->Unmap(0, &writeRange);
+	}
+
+	// spawns past the capacity could never find a dead slot
+	uint32_t spawnCount = m_emitter.Update(deltaTime);
+	if (spawnCount > m_capacity) spawnCount = m_capacity;
+
+	if (m_backend == ParticleBackend::CPU)
+	{
+		m_simulation.Step(deltaTime, m_integrator);
+		m_simulation.Spawn(spawnCount, m_emitPosition, m_spawnSeed++);
+		if (sortByDepth) m_simulation.SortAliveList(m_viewDepth);
+		UploadParticlesToGPU(commandList);
+		return;
+	}
+
+	// the update is sized by the alive count the last BuildArguments wrote, read as arguments outside the UAV state
+	D3D12_RESOURCE_BARRIER argumentBarrier = {};
+	argumentBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+	argumentBarrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+	argumentBarrier.Transition.pResource = m_dispatchArgumentBuffer.Get();
+	argumentBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+	argumentBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_COPY_DEST;
+	argumentBarrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	commandList->ResourceBarrier(1, &argumentBarrier);
+	commandList->CopyBufferRegion(m_dispatchArgumentBuffer.Get(), 0, m_listBuffer.Get(),
+		offsetof(ParticleListHeader, dispatchArguments), sizeof(D3D12_DISPATCH_ARGUMENTS));
+	argumentBarrier.Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+	argumentBarrier.Transition.StateAfter = D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
+	commandList->ResourceBarrier(1, &argumentBarrier);
+
+	D3D12_RESOURCE_BARRIER barriers[2] = {};
+	for (D3D12_RESOURCE_BARRIER& barrier : barriers)
+	{
+		barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_GENERIC_READ;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	}
+	barriers[0].Transition.pResource = m_particleBuffer.Get();
+	barriers[1].Transition.pResource = m_listBuffer.Get();
+	commandList->ResourceBarrier(2, barriers);
+
+	commandList->SetComputeRootUnorderedAccessView(
+		LunarConstants::PARTICLE_UAV_ROOT_PARAMETER_INDEX,
+		m_particleBuffer->GetGPUVirtualAddress()
+	);
+	commandList->SetComputeRootUnorderedAccessView(
+		LunarConstants::PARTICLE_LIST_UAV_ROOT_PARAMETER_INDEX,
+		m_listBuffer->GetGPUVirtualAddress()
+	);
+	UploadCollidersToGPU();
+	commandList->SetComputeRootShaderResourceView(
+		LunarConstants::PARTICLE_COLLIDER_SRV_ROOT_PARAMETER_INDEX,
+		m_colliderBuffer->GetGPUVirtualAddress()
+	);
+	SetParticleConstants(commandList, spawnCount, deltaTime, true);
+	++m_spawnSeed;
+
+	// each pass consumes the counters the previous one wrote
+	D3D12_RESOURCE_BARRIER uavBarrier = {};
+	uavBarrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+	uavBarrier.UAV.pResource = nullptr;
+
+	commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesUpdate"));
+	commandList->ExecuteIndirect(m_dispatchSignature.Get(), 1, m_dispatchArgumentBuffer.Get(), 0, nullptr, 0);
+	commandList->ResourceBarrier(1, &uavBarrier);
+
+	// newborns join the list the update just filled, so they first move next frame
+	if (spawnCount > 0)
+	{
+		commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesEmit"));
+		commandList->Dispatch((spawnCount + PARTICLE_THREAD_GROUP_SIZE - 1) / PARTICLE_THREAD_GROUP_SIZE, 1, 1);
+		commandList->ResourceBarrier(1, &uavBarrier);
+	}
+
+	commandList->SetPipelineState(pipelineStateManager->GetPSO("particlesBuildArguments"));
+	commandList->Dispatch(1, 1, 1);
+
+	if (sortByDepth)
+	{
+		commandList->ResourceBarrier(1, &uavBarrier);
+		SortAliveList(commandList, pipelineStateManager);
+	}
+
+	for (D3D12_RESOURCE_BARRIER& barrier : barriers)
+	{
+		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
+		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+	}
+	commandList->ResourceBarrier(2, barriers);
+
+	commandList->CopyBufferRegion(m_listReadbackBuffer.Get(), 0, m_listBuffer.Get(), 0, sizeof(ParticleListHeader));
+	m_hasReadback = true;
 
-void ParticleSystem::Update(float deltaTime, ID3D12GraphicsCommandList* commandList)
-{
-    int inputBufferIndex = m_currentBuffer;
-    int outputBufferIndex = 1 - m_currentBuffer;
-    
-    D3D12_RESOURCE_BARRIER barrier = {};
-    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barrier.Transition.pResource = m_particleBuffers[outputBufferIndex].Get();
-    barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_GENERIC_READ;
-    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-    commandList->ResourceBarrier(1, &barrier);
-    
-    commandList->SetComputeRootShaderResourceView(
-        LunarConstants::PARTICLE_SRV_ROOT_PARAMETER_INDEX, 
-        m_particleBuffers[inputBufferIndex]->GetGPUVirtualAddress()
-    );
-    
-    commandList->SetComputeRootUnorderedAccessView(
-        LunarConstants::PARTICLE_UAV_ROOT_PARAMETER_INDEX, 
-        m_particleBuffers[outputBufferIndex]->GetGPUVirtualAddress()
-    );
-    
-    int particlesToDraw = 64;
-    commandList->Dispatch(particlesToDraw, 1, 1);
-
-    barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-    barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
-    commandList->ResourceBarrier(1, &barrier);
-    
-    m_currentBuffer = outputBufferIndex;
+	// survivors and newborns went to the other list, which is the one to draw and the next update's input
+	m_aliveListIndex = 1 - m_aliveListIndex;
 }
 
-} // namespace Lunar
\ No newline at end of file
+} // namespace Lunar
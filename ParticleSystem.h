@@ -1,44 +1,84 @@
-#pragma once 
+#pragma once
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include <vector>
 #include <wrl/client.h>
 
+#include "LunarConstants.h"
+#include "ParticleSimulation.h"
+
 namespace Lunar
 {
+class PipelineStateManager;
+
+enum class ParticleBackend
+{
+	GPU,	// ParticlesComputeShader.hlsl
+	CPU		// ParticleSimulation, uploaded every frame
+};
 
 class ParticleSystem
 {
-	struct Particle
-	{
-		float position[3]; 
-		float velocity[3];
-		float force[3];
-		float color[4];
-		float lifetime; 
-		float age;      
-	};
 public:
     void Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList);
+    // Queues a burst at position; it spawns over the next frames as the emitter's budget allows
     void EmitParticles(const DirectX::XMFLOAT3& position);
     void DrawParticles(ID3D12GraphicsCommandList* commandList);
-    
-    void            Update(float deltaTime, ID3D12GraphicsCommandList* commandList);
-	ID3D12Resource* GetCurrentBufferResource() { return m_particleBuffers[m_currentBuffer].Get(); }
-    
+
+    void            Update(float deltaTime, ID3D12GraphicsCommandList* commandList, PipelineStateManager* pipelineStateManager);
+	ID3D12Resource* GetCurrentBufferResource() { return m_particleBuffer.Get(); }
+
+	// Switching kills every particle and drops the queued spawns
+	void            SetBackend(ParticleBackend backend);
+	ParticleBackend GetBackend() const { return m_backend; }
+	void SetIntegrator(ParticleIntegrator integrator) { m_integrator = integrator; }
+	// Clamped to MAX_PARTICLE_CAPACITY. The buffers are rebuilt at the next Update, which kills every particle.
+	void     SetCapacity(uint32_t capacity);
+	uint32_t GetCapacity() const { return m_capacity; }
+	// Continuous spawn rate and per-frame budget
+	ParticleEmitter& GetEmitter() { return m_emitter; }
+	// Camera the depth sort orders for, row-vector convention
+	void SetViewMatrix(const DirectX::XMFLOAT4X4& view);
+	// Past MAX_PARTICLE_COLLIDERS the extra spheres, then planes, are dropped
+	void SetColliders(const ParticleColliders& colliders);
+	const ParticleColliders& GetColliders() const { return m_simulation.GetColliders(); }
+
+	// One frame late on the GPU backend, read back from the list buffer header
     int GetActiveParticleCount() const;
+
+	uint32_t burstCount = 512;	// particles queued per EmitParticles
+	bool     sortByDepth = true;	// draw back to front; costs a sort of the alive list every frame
 private:
-    void ResetParticles(const DirectX::XMFLOAT3& position = {0.0f, 0.0f, 0.0f});
+	void CreateBuffers(ID3D12Device* device);
+	void SetParticleConstants(ID3D12GraphicsCommandList* commandList, uint32_t spawnCount, float deltaTime, bool compute);
 	void UploadParticlesToGPU(ID3D12GraphicsCommandList* commandList);
+	void UploadCollidersToGPU();
+	void SortAliveList(ID3D12GraphicsCommandList* commandList, PipelineStateManager* pipelineStateManager);
+	uint32_t GetSortSize() const;
 
-    std::vector<Particle> particles;
-    bool m_isFirstFrame = true;
-	bool m_resetFlag = false;
-
-    int m_currentBuffer = 0;
+    ParticleSimulation m_simulation;
+    ParticleEmitter    m_emitter;
+    ParticleBackend    m_backend = ParticleBackend::GPU;
+    ParticleIntegrator m_integrator = ParticleIntegrator::Verlet;
+    uint32_t           m_capacity = LunarConstants::PARTICLE_CAPACITY;
+    DirectX::XMFLOAT3  m_emitPosition = { 0.0f, 0.0f, 0.0f };
+    DirectX::XMFLOAT4  m_viewDepth = { 0.0f, 0.0f, 1.0f, 0.0f };
+    uint32_t           m_spawnSeed = 0;		// seeds each frame's spawns differently
+    uint32_t           m_aliveListIndex = 0;	// list the next update reads, and the one drawn
+    uint32_t           m_gpuAliveCount = 0;
+	bool               m_hasReadback = false;
+	bool               m_resetFlag = false;
 
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_particleBuffers[2];
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_uploadBuffers[2];
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_particleBuffer;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_particleUploadBuffer;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_listBuffer;		// ParticleListHeader, dead list, two alive lists
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_listUploadBuffer;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_listReadbackBuffer;	// the header, copied after every GPU update
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_sortBuffer;		// GetSortSize() key and index pairs, always a UAV
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_dispatchArgumentBuffer;	// copied from the header; the list buffer is a UAV while dispatching
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_colliderBuffer;		// ParticleColliders as float4s, written every GPU update
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_drawSignature;
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_dispatchSignature;
 };
 
 } // namespace Lunar
@@ -2,6 +2,8 @@
 
 #include <d3dcompiler.h>
 
+#include "ConstantBuffers.h"
+#include "Geometry/VertexFormat.h"
 #include "Utils/Logger.h"
 #include "Utils/Utils.h"
 
@@ -22,7 +24,15 @@ PipelineStateManager::PipelineStateManager()
 			{ "COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 			{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 28, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }, 
 			{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 36, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TANGENT", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 48, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			},
+		},
+		{
+			"compact", {{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 20, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
+			{ "TANGENT", 0, DXGI_FORMAT_R16G16_SNORM, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
 			},
 		},
 		{
@@ -80,14 +90,15 @@ void PipelineStateManager::CreateRootSignature(ID3D12Device* device)
 	*/
 	D3D12_DESCRIPTOR_RANGE textureSrvRange = {};
 	textureSrvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	textureSrvRange.NumDescriptors = LunarConstants::TEXTURE_INFO.size() + 13;
+	// skybox_prefiltered and the BRDF LUT, then skybox_next and skybox_prefiltered_next for environment switches
+	textureSrvRange.NumDescriptors = LunarConstants::TEXTURE_INFO.size() + 4;
 	textureSrvRange.BaseShaderRegister = 0;
 	textureSrvRange.RegisterSpace = 0;
 	textureSrvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
 
 	D3D12_DESCRIPTOR_RANGE shadowMapSrvRange = {};
 	shadowMapSrvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
-	shadowMapSrvRange.NumDescriptors = 1;
+	shadowMapSrvRange.NumDescriptors = 2;	// cascades, then the light atlas
 	shadowMapSrvRange.BaseShaderRegister = 0;
 	shadowMapSrvRange.RegisterSpace = 1;
 	shadowMapSrvRange.OffsetInDescriptorsFromTableStart = D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND;
@@ -118,7 +129,7 @@ void PipelineStateManager::CreateRootSignature(ID3D12Device* device)
 		D3D12_SHADER_VISIBILITY ShaderVisibility;
 	} 	D3D12_ROOT_PARAMETER;
 	*/
-	D3D12_ROOT_PARAMETER rootParameters[8];
+	D3D12_ROOT_PARAMETER rootParameters[18];
     D3D12_DESCRIPTOR_RANGE srvRanges[2] = { textureSrvRange, shadowMapSrvRange };
     size_t index = LunarConstants::TEXTURE_SR_ROOT_PARAMETER_INDEX;
 	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
@@ -167,6 +178,71 @@ void PipelineStateManager::CreateRootSignature(ID3D12Device* device)
 	rootParameters[index].DescriptorTable.NumDescriptorRanges = 1;
 	rootParameters[index].DescriptorTable.pDescriptorRanges = &postProcessUavRange;
 	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	index = LunarConstants::LIGHT_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 4;
+	rootParameters[index].Descriptor.ShaderRegister = 0;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	index = LunarConstants::SHADOW_TILE_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 4;
+	rootParameters[index].Descriptor.ShaderRegister = 1;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	index = LunarConstants::LIGHT_SHADOW_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 4;
+	rootParameters[index].Descriptor.ShaderRegister = 2;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	// dead and alive particle lists with their counters and the draw arguments, see ParticleListHeader
+	index = LunarConstants::PARTICLE_LIST_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 2;
+	rootParameters[index].Descriptor.ShaderRegister = 1;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	index = LunarConstants::PARTICLE_LIST_UAV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	rootParameters[index].Descriptor.RegisterSpace = 0;
+	rootParameters[index].Descriptor.ShaderRegister = 1;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	index = LunarConstants::PARTICLE_CONSTANTS_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+	rootParameters[index].Constants.RegisterSpace = 0;
+	rootParameters[index].Constants.ShaderRegister = 3;
+	rootParameters[index].Constants.Num32BitValues = sizeof(ParticleConstants) / sizeof(uint32_t);
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	// key and particle index pairs for the depth sort
+	index = LunarConstants::PARTICLE_SORT_UAV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+	rootParameters[index].Descriptor.RegisterSpace = 0;
+	rootParameters[index].Descriptor.ShaderRegister = 2;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	// planes then spheres the particle update collides with, see ParticleColliders
+	index = LunarConstants::PARTICLE_COLLIDER_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 2;
+	rootParameters[index].Descriptor.ShaderRegister = 2;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+
+	// (offset, count) into the cluster light index list per cluster, see ClusteredLightBinner
+	index = LunarConstants::CLUSTER_RANGE_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 4;
+	rootParameters[index].Descriptor.ShaderRegister = 3;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+	index = LunarConstants::CLUSTER_LIGHT_INDEX_SRV_ROOT_PARAMETER_INDEX;
+	rootParameters[index].ParameterType = D3D12_ROOT_PARAMETER_TYPE_SRV;
+	rootParameters[index].Descriptor.RegisterSpace = 4;
+	rootParameters[index].Descriptor.ShaderRegister = 4;
+	rootParameters[index].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
 	/*
 	typedef struct D3D12_STATIC_SAMPLER_DESC
 	{
@@ -245,7 +321,7 @@ void PipelineStateManager::CreateComputeRootSignature(ID3D12Device* device)
 	// Compute Root Signature 
 	// 0: 32-bit constants (roughness, mipLevel)
 	// 1: Input SRV table (environment cubemap)
-	// 2: Output UAV table (irradiance/prefiltered maps)
+	// 2: Output UAV table
 	
 	D3D12_DESCRIPTOR_RANGE computeInputSrvRange = {};
 	computeInputSrvRange.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
@@ -445,6 +521,21 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
 	THROW_IF_FAILED(device->CreateGraphicsPipelineState(&opaquePsoDesc,
 		IID_PPV_ARGS(m_psoMap["opaque"].GetAddressOf())))
 
+	// Compact vertex format variant: same state, packed input layout and a VS that unpacks it
+	// (shadowMapVS only reads POSITION, so it keeps its own VS)
+	const vector<D3D12_INPUT_ELEMENT_DESC>& compactInputLayout = m_inputLayoutMap["compact"];
+	auto createCompactVariant = [&](const string& psoName, D3D12_GRAPHICS_PIPELINE_STATE_DESC psoDesc, bool replaceVS) {
+		psoDesc.InputLayout = { compactInputLayout.data(), static_cast<UINT>(compactInputLayout.size()) };
+		if (replaceVS)
+		{
+			psoDesc.VS.pShaderBytecode = m_shaderMap["compactVS"]->GetBufferPointer();
+			psoDesc.VS.BytecodeLength = m_shaderMap["compactVS"]->GetBufferSize();
+		}
+		THROW_IF_FAILED(device->CreateGraphicsPipelineState(&psoDesc,
+			IID_PPV_ARGS(m_psoMap[psoName + VertexFormatUtils::GetPSOSuffix(VertexFormat::Compact)].GetAddressOf())))
+	};
+	createCompactVariant("opaque", opaquePsoDesc, true);
+
 	// PSO for shadow map
 	{
 		D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowMapPsoDesc = opaquePsoDesc;
@@ -459,6 +550,7 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
 		shadowMapPsoDesc.NumRenderTargets = 0;
 		THROW_IF_FAILED(device->CreateGraphicsPipelineState(&shadowMapPsoDesc,
 			IID_PPV_ARGS(m_psoMap["shadowMap"].GetAddressOf())))
+		createCompactVariant("shadowMap", shadowMapPsoDesc, false);
 	}
 
 	// PSO for marking stencil mirror
@@ -506,6 +598,7 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
 		reflectPsoDesc.DepthStencilState.BackFace = stencilOp;
 		THROW_IF_FAILED(device->CreateGraphicsPipelineState(&reflectPsoDesc,
 			IID_PPV_ARGS(m_psoMap["reflect"].GetAddressOf())))
+		createCompactVariant("reflect", reflectPsoDesc, true);
 	}
 
 	// PSO for skybox
@@ -577,6 +670,28 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
         THROW_IF_FAILED(device->CreateComputePipelineState(&particlesUpdatePsoDesc, 
             IID_PPV_ARGS(m_psoMap["particlesUpdate"].GetAddressOf())))
 
+		D3D12_COMPUTE_PIPELINE_STATE_DESC particlesEmitPsoDesc = particlesUpdatePsoDesc;
+        particlesEmitPsoDesc.CS.pShaderBytecode = m_shaderMap["particlesEmitCS"]->GetBufferPointer();
+        particlesEmitPsoDesc.CS.BytecodeLength = m_shaderMap["particlesEmitCS"]->GetBufferSize();
+        THROW_IF_FAILED(device->CreateComputePipelineState(&particlesEmitPsoDesc, 
+            IID_PPV_ARGS(m_psoMap["particlesEmit"].GetAddressOf())))
+
+		D3D12_COMPUTE_PIPELINE_STATE_DESC particlesBuildArgumentsPsoDesc = particlesUpdatePsoDesc;
+        particlesBuildArgumentsPsoDesc.CS.pShaderBytecode = m_shaderMap["particlesBuildArgumentsCS"]->GetBufferPointer();
+        particlesBuildArgumentsPsoDesc.CS.BytecodeLength = m_shaderMap["particlesBuildArgumentsCS"]->GetBufferSize();
+        THROW_IF_FAILED(device->CreateComputePipelineState(&particlesBuildArgumentsPsoDesc, 
+            IID_PPV_ARGS(m_psoMap["particlesBuildArguments"].GetAddressOf())))
+
+		// depth sort passes, see ParticleSortShader.hlsl
+		for (const char* pass : { "particlesBuildSortKeys", "particlesSortLocal", "particlesSortStep", "particlesMergeLocal", "particlesWriteSortedList" })
+		{
+			string shaderName = string(pass) + "CS";
+			D3D12_COMPUTE_PIPELINE_STATE_DESC sortPsoDesc = particlesUpdatePsoDesc;
+			sortPsoDesc.CS.pShaderBytecode = m_shaderMap[shaderName]->GetBufferPointer();
+			sortPsoDesc.CS.BytecodeLength = m_shaderMap[shaderName]->GetBufferSize();
+			THROW_IF_FAILED(device->CreateComputePipelineState(&sortPsoDesc, IID_PPV_ARGS(m_psoMap[pass].GetAddressOf())))
+		}
+
     	D3D12_GRAPHICS_PIPELINE_STATE_DESC particlesPsoDesc = opaquePsoDesc;
     	particlesPsoDesc.VS.pShaderBytecode = m_shaderMap["particlesVS"]->GetBufferPointer();
     	particlesPsoDesc.VS.BytecodeLength = m_shaderMap["particlesVS"]->GetBufferSize();
@@ -586,6 +701,11 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
     	particlesPsoDesc.PS.BytecodeLength = m_shaderMap["particlesPS"]->GetBufferSize();
     	particlesPsoDesc.InputLayout = {nullptr, 0};
     	particlesPsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
+		// translucent, drawn back to front after the depth sort; tested against the scene but not written
+		particlesPsoDesc.BlendState.RenderTarget[0].BlendEnable = TRUE;
+		particlesPsoDesc.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA;
+		particlesPsoDesc.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA;
+		particlesPsoDesc.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO;
     	THROW_IF_FAILED(device->CreateGraphicsPipelineState(&particlesPsoDesc,
 			IID_PPV_ARGS(m_psoMap["particles"].GetAddressOf())))
     }
@@ -596,6 +716,7 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
 		wirePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
 		THROW_IF_FAILED(device->CreateGraphicsPipelineState(&wirePsoDesc,
 			IID_PPV_ARGS(m_psoMap["opaque_wireframe"].GetAddressOf())))
+		createCompactVariant("opaque_wireframe", wirePsoDesc, true);
 	}
 
 	// PSO for Tessellation
@@ -608,10 +729,12 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
 		tessellationPsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_PATCH;
 		THROW_IF_FAILED(device->CreateGraphicsPipelineState(&tessellationPsoDesc,
 			IID_PPV_ARGS(m_psoMap["tessellation"].GetAddressOf())))
+		createCompactVariant("tessellation", tessellationPsoDesc, true);
 
 		tessellationPsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
 		THROW_IF_FAILED(device->CreateGraphicsPipelineState(&tessellationPsoDesc,
 			IID_PPV_ARGS(m_psoMap["tessellation_wireframe"].GetAddressOf())))
+		createCompactVariant("tessellation_wireframe", tessellationPsoDesc, true);
 	}
 
     // PSO for Blur
@@ -631,47 +754,27 @@ void PipelineStateManager::BuildPSOs(ID3D12Device* device)
 			IID_PPV_ARGS(m_psoMap["gaussianBlurY"].GetAddressOf())))
 	}
 
-	// PSO for IBL
+	// PSO for IBL debugging; irradiance, prefiltered maps and the BRDF LUT are baked on the CPU
 	{
 		D3D12_COMPUTE_PIPELINE_STATE_DESC irradiancePsoDesc = {};
 		irradiancePsoDesc.pRootSignature = m_computeRootSignature.Get();
 		irradiancePsoDesc.NodeMask = 0;
-		irradiancePsoDesc.CS.pShaderBytecode = m_shaderMap["irradianceCS"]->GetBufferPointer();
-		irradiancePsoDesc.CS.BytecodeLength = m_shaderMap["irradianceCS"]->GetBufferSize();
 		irradiancePsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-		THROW_IF_FAILED(device->CreateComputePipelineState(&irradiancePsoDesc, 
-			IID_PPV_ARGS(m_psoMap["irradiance"].GetAddressOf())))
-
-		// for Debugging
 		irradiancePsoDesc.CS.pShaderBytecode = m_shaderMap["irradianceDebugCS"]->GetBufferPointer();
 		irradiancePsoDesc.CS.BytecodeLength = m_shaderMap["irradianceDebugCS"]->GetBufferSize();
 		THROW_IF_FAILED(device->CreateComputePipelineState(&irradiancePsoDesc, 
 			IID_PPV_ARGS(m_psoMap["irradianceDebug"].GetAddressOf())))
 	}
-	
-	// PSO for Prefiltered Environment Map
-	{
-		D3D12_COMPUTE_PIPELINE_STATE_DESC prefilteredPsoDesc = {};
-		prefilteredPsoDesc.pRootSignature = m_computeRootSignature.Get();
-		prefilteredPsoDesc.NodeMask = 0;
-		prefilteredPsoDesc.CS.pShaderBytecode = m_shaderMap["prefilteredCS"]->GetBufferPointer();
-		prefilteredPsoDesc.CS.BytecodeLength = m_shaderMap["prefilteredCS"]->GetBufferSize();
-		prefilteredPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-		THROW_IF_FAILED(device->CreateComputePipelineState(&prefilteredPsoDesc, 
-			IID_PPV_ARGS(m_psoMap["prefiltered"].GetAddressOf())))
-	}
+}
 
-	// PSO for BRDF LUT
-	{
-		D3D12_COMPUTE_PIPELINE_STATE_DESC brdfLutPsoDesc = {};
-		brdfLutPsoDesc.pRootSignature = m_computeRootSignature.Get();
-		brdfLutPsoDesc.NodeMask = 0;
-		brdfLutPsoDesc.CS.pShaderBytecode = m_shaderMap["brdfLutCS"]->GetBufferPointer();
-		brdfLutPsoDesc.CS.BytecodeLength = m_shaderMap["brdfLutCS"]->GetBufferSize();
-		brdfLutPsoDesc.Flags = D3D12_PIPELINE_STATE_FLAG_NONE;
-		THROW_IF_FAILED(device->CreateComputePipelineState(&brdfLutPsoDesc, 
-			IID_PPV_ARGS(m_psoMap["brdfLut"].GetAddressOf())))
-	}
+ID3D12PipelineState* PipelineStateManager::GetPSO(const string& psoName, VertexFormat vertexFormat) const
+{
+	return GetPSO(psoName + VertexFormatUtils::GetPSOSuffix(vertexFormat));
+}
+
+bool PipelineStateManager::HasPSO(const string& psoName, VertexFormat vertexFormat) const
+{
+	return m_psoMap.find(psoName + VertexFormatUtils::GetPSOSuffix(vertexFormat)) != m_psoMap.end();
 }
 
 ID3D12PipelineState* PipelineStateManager::GetPSO(const string& psoName) const
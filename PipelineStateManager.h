@@ -5,6 +5,7 @@
 #include <wrl/client.h>
 
 #include "LunarConstants.h"
+#include "Geometry/VertexFormat.h"
 
 namespace Lunar
 {
@@ -22,6 +23,8 @@ public:
 	ID3D12RootSignature*             GetRootSignature() const { return m_rootSignature.Get(); }
 	ID3D12RootSignature*             GetComputeRootSignature() const { return m_computeRootSignature.Get(); }
 	ID3D12PipelineState*             GetPSO(const std::string& psoName) const;
+	ID3D12PipelineState*             GetPSO(const std::string& psoName, VertexFormat vertexFormat) const;
+	bool                             HasPSO(const std::string& psoName, VertexFormat vertexFormat) const; // no error logged when missing
 	
 private:
 	std::unordered_map<std::string, std::vector<D3D12_INPUT_ELEMENT_DESC>> m_inputLayoutMap;
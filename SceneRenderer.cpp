@@ -1,5 +1,4 @@
 #include "SceneRenderer.h"
-#include "Geometry/GeometryFactory.h"
 #include "MaterialManager.h"
 #include "LightingSystem.h"
 #include "ConstantBuffers.h"
@@ -17,12 +16,32 @@
 #include "UI/DebugViewModel.h"
 #include "Geometry/Cube.h"
 #include "Geometry/IcoSphere.h"
+#include "Geometry/Mesh.h"
+#include "Geometry/LODSelector.h"
 
 using namespace DirectX;
 using namespace std;
 
 namespace Lunar
 {
+namespace
+{
+// Every pipeline a geometry on the layer is drawn with by RenderLayers, RenderWireframeOnly, DrawShadowCasters and
+// DrawReflectionInstances; the normal visualization skips other vertex formats itself
+vector<string> GetLayerPSONames(RenderLayer layer)
+{
+	switch (layer)
+	{
+		case RenderLayer::Background : return { "background" };
+		case RenderLayer::World : return { "opaque", "opaque_wireframe", "shadowMap", "reflect" };
+		case RenderLayer::Tessellation : return { "tessellation", "tessellation_wireframe" };
+		case RenderLayer::Mirror : return { "mirror" };
+		case RenderLayer::Billboard : return { "billboard" };
+		case RenderLayer::Debug : return { "opaque" };
+		default : return {};
+	}
+}
+}
 
 SceneRenderer::SceneRenderer()
 {
@@ -67,7 +86,18 @@ void SceneRenderer::InitializeScene(ID3D12Device* device, LunarGui* gui, Pipelin
 	
 	m_pipelineStateManager = pipelineManager;
     m_basicCB = make_unique<ConstantBuffer>(device, sizeof(BasicConstants));
-    m_lightingSystem->Initialize(device, LunarConstants::LIGHT_COUNT);
+    m_lightingSystem->Initialize(device);
+
+	// fitted to the camera's projection once UpdateLightClusters sees it
+	ClusterGridDesc clusterDesc = {};
+	clusterDesc.fovAngleY = XMConvertToRadians(LunarConstants::FOV_ANGLE);
+	clusterDesc.aspectRatio = LunarConstants::ASPECT_RATIO;
+	clusterDesc.nearZ = LunarConstants::NEAR_PLANE;
+	clusterDesc.farZ = LunarConstants::FAR_PLANE;
+	m_lightBinner.Initialize(clusterDesc);
+	m_clusterRangeBuffer = make_unique<ConstantBuffer>(device, static_cast<UINT>(m_lightBinner.GetClusterCount() * sizeof(ClusterRange)));
+	m_clusterLightIndexCapacity = m_lightBinner.GetClusterCount() * 8;
+	m_clusterLightIndexBuffer = make_unique<ConstantBuffer>(device, static_cast<UINT>(m_clusterLightIndexCapacity * sizeof(uint32_t)));
     m_sceneViewModel->Initialize(gui, this);
     m_lightViewModel->Initialize(gui, m_lightingSystem.get(), this);
     
@@ -79,35 +109,41 @@ void SceneRenderer::InitializeScene(ID3D12Device* device, LunarGui* gui, Pipelin
     {
         for (auto& entry : geometryEntries)
         {
+            // the vertex buffers are built in the format set here, so it must have a variant of every pipeline the layer uses
+            VertexFormat vertexFormat = entry->GeometryData->GetVertexFormat();
+            for (const string& psoName : GetLayerPSONames(layer))
+            {
+                if (vertexFormat == VertexFormat::Default || m_pipelineStateManager->HasPSO(psoName, vertexFormat)) continue;
+                LOG_WARNING("Geometry ", entry->Name, " keeps the default vertex format: ", psoName, " has no ",
+                    VertexFormatUtils::GetInputLayoutName(vertexFormat), " pipeline variant");
+                vertexFormat = VertexFormat::Default;
+                entry->GeometryData->SetVertexFormat(vertexFormat);
+            }
             entry->GeometryData->Initialize(device);
+            if (auto mesh = dynamic_cast<Mesh*>(entry->GeometryData.get())) RegisterMeshMaterials(device, mesh);
         }
     }
 
-	if (m_layeredGeometries.find(RenderLayer::Mirror) != m_layeredGeometries.end())
+	auto mirror = m_geometriesByName.find("Mirror0");
+	if (m_layeredGeometries.find(RenderLayer::Mirror) != m_layeredGeometries.end() && mirror != m_geometriesByName.end())
 	{
-		auto mirror = m_geometriesByName.find("Mirror0");
-		Plane* plane = static_cast<Plane*>(mirror->second->GeometryData.get());
-		XMFLOAT4 mirrorPlane = plane->GetPlaneEquation();
-		XMMATRIX R = MathUtils::MakeReflectionMatrix(mirrorPlane.x, mirrorPlane.y, mirrorPlane.z, mirrorPlane.w);
+		// reflections reuse the World buffers and only own a reflected copy of the object constants
+		m_reflectionMirror = mirror->second;
 		for (auto& entry : m_layeredGeometries[RenderLayer::World])
 		{
-			LOG_DEBUG("Processing: " + entry->Name);
-			Geometry* geometry = entry->GeometryData.get();	
-			XMFLOAT4X4 geometryWorld = geometry->GetWorldMatrix();
-			XMMATRIX W = XMMatrixTranspose(XMLoadFloat4x4(&geometryWorld));
-			XMMATRIX reflectedWorld =  W * R;
-			XMFLOAT4X4 reflectedWorldMatrix;
-			XMStoreFloat4x4(&reflectedWorldMatrix, XMMatrixTranspose(reflectedWorld));
-			
-			auto reflectedGeometry = move(GeometryFactory::CloneGeometry(geometry));
-			reflectedGeometry->SetWorldMatrix(reflectedWorldMatrix);
-			
-			reflectedGeometry->Initialize(device);
-			string reflectedName = entry->Name + "_reflected";
-			auto reflectedEntry = make_shared<GeometryEntry>(GeometryEntry{move(reflectedGeometry), reflectedName, RenderLayer::Reflect});
-			m_layeredGeometries[RenderLayer::Reflect].push_back(reflectedEntry);
-			m_geometriesByName[reflectedName] = reflectedEntry;
+			// the reflect pipeline has no geometry shader and instances draw indexed, so e.g. billboard points are left out
+			Geometry* geometry = entry->GeometryData.get();
+			if (geometry->GetIndexBufferByteSize() == 0 || geometry->GetTopologyType() != D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST)
+			{
+				LOG_DEBUG("Not reflected: ", entry->Name);
+				continue;
+			}
+			ReflectionInstance instance;
+			instance.Source = entry;
+			instance.ObjectCB = make_unique<ConstantBuffer>(device, sizeof(ObjectConstants));
+			m_reflectionInstances.push_back(move(instance));
 		}
+		UpdateReflectionInstances();
 	}
 }
 
@@ -115,7 +151,7 @@ void SceneRenderer::CreateDSVDescriptorHeap(ID3D12Device* device)
 {
 	D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
 	dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-	dsvHeapDesc.NumDescriptors = 2; // TODO : refactoring
+	dsvHeapDesc.NumDescriptors = 3; // TODO : refactoring
 	dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
 	THROW_IF_FAILED(device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(m_dsvHeap.GetAddressOf())));
 }
@@ -155,13 +191,40 @@ void SceneRenderer::CreateDepthStencilView(ID3D12Device* device)
 
 void SceneRenderer::InitializeTextures(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator)
 {
-	m_textureManager->Initialize(device, commandList, descriptorAllocator, m_pipelineStateManager);
+	m_textureManager->Initialize(device, commandList, descriptorAllocator);
+	SHCoefficients irradianceSH = m_textureManager->GetIrradianceSH();
+	for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+	{
+		const XMFLOAT3& coefficient = irradianceSH.coefficients[i];
+		m_basicConstants.irradianceSH[i] = XMFLOAT4(coefficient.x, coefficient.y, coefficient.z, 0.0f);
+	}
+	m_basicConstants.environmentBlend = 0.0f;
 	m_shadowManager->CreateSRV(device, descriptorAllocator);
 
 	// REFACTORING: Rename or refactor this method
 	m_particleSystem->Initialize(device, commandList);
 }
 
+void SceneRenderer::SetEnvironment(const string& filePath)
+{
+	m_textureManager->RequestEnvironment(filePath);
+}
+
+void SceneRenderer::UpdateEnvironment(float deltaTime, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator)
+{
+	if (!m_textureManager->UpdateEnvironment(deltaTime, device, commandList, descriptorAllocator)) return;
+
+	SHCoefficients irradianceSH = m_textureManager->GetIrradianceSH();
+	for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+	{
+		const XMFLOAT3& coefficient = irradianceSH.coefficients[i];
+		m_basicConstants.irradianceSH[i] = XMFLOAT4(coefficient.x, coefficient.y, coefficient.z, 0.0f);
+	}
+	m_basicConstants.environmentBlend = m_textureManager->GetEnvironmentBlend();
+	// UpdateScene has already copied this frame's constants, and the GPU is idle
+	m_basicCB->CopyData(&m_basicConstants, sizeof(BasicConstants));
+}
+
 void SceneRenderer::RenderShadowMap(ID3D12GraphicsCommandList* commandList)
 {
 	// To write depth
@@ -173,25 +236,43 @@ void SceneRenderer::RenderShadowMap(ID3D12GraphicsCommandList* commandList)
 	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_DEPTH_WRITE;
 	commandList->ResourceBarrier(1, &barrier);
 
-	commandList->RSSetViewports(1, &m_shadowManager->GetViewport());
-	commandList->RSSetScissorRects(1, &m_shadowManager->GetScissorRect());
-
 	commandList->OMSetRenderTargets(0, nullptr, FALSE, &m_shadowManager->GetDSVHandle());
 	commandList->ClearDepthStencilView(m_shadowManager->GetDSVHandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-	commandList->SetPipelineState(m_pipelineStateManager->GetPSO("shadowMap"));
 
-	commandList->SetGraphicsRootConstantBufferView(
-		LunarConstants::BASIC_CONSTANTS_ROOT_PARAMETER_INDEX,
-		m_shadowManager->GetShadowCB()->GetResource()->GetGPUVirtualAddress());
+	// every cascade renders into its own tile of the atlas
+	for (uint32_t i = 0; i < m_shadowManager->GetCascadeCount(); ++i)
+	{
+		commandList->RSSetViewports(1, &m_shadowManager->GetViewport(i));
+		commandList->RSSetScissorRects(1, &m_shadowManager->GetScissorRect(i));
+		commandList->SetGraphicsRootConstantBufferView(
+			LunarConstants::BASIC_CONSTANTS_ROOT_PARAMETER_INDEX,
+			m_shadowManager->GetShadowCB(i)->GetResource()->GetGPUVirtualAddress());
 
-	for (auto& entry : m_layeredGeometries[RenderLayer::World])
+		DrawShadowCasters(commandList, m_shadowDrawLists[i]);
+	}
+
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_GENERIC_READ;
+	commandList->ResourceBarrier(1, &barrier);
+
+	// spot lights and point light faces, each in its own tile of the light atlas
+	barrier.Transition.pResource = m_shadowManager->GetAtlasTexture();
+	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_GENERIC_READ;
+	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	commandList->ResourceBarrier(1, &barrier);
+
+	commandList->OMSetRenderTargets(0, nullptr, FALSE, &m_shadowManager->GetAtlasDSVHandle());
+	commandList->ClearDepthStencilView(m_shadowManager->GetAtlasDSVHandle(), D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+	for (uint32_t i = 0; i < m_shadowManager->GetAtlasTileCount(); ++i)
 	{
-		if (entry->IsVisible)
-		{
-			string materialName = entry->GeometryData->GetMaterialName();
-			m_materialManager->BindConstantBuffer(materialName, commandList);
-			entry->GeometryData->Draw(commandList);
-		}
+		const ShadowAtlasTileInfo& tile = m_shadowManager->GetAtlasTile(i);
+		commandList->RSSetViewports(1, &tile.viewport);
+		commandList->RSSetScissorRects(1, &tile.scissorRect);
+		commandList->SetGraphicsRootConstantBufferView(
+			LunarConstants::BASIC_CONSTANTS_ROOT_PARAMETER_INDEX,
+			m_shadowManager->GetAtlasTileCBAddress(i));
+
+		DrawShadowCasters(commandList, m_atlasDrawLists[i]);
 	}
 
 	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_DEPTH_WRITE;
@@ -201,15 +282,314 @@ void SceneRenderer::RenderShadowMap(ID3D12GraphicsCommandList* commandList)
 
 void SceneRenderer::UpdateScene(float deltaTime)
 {
+	UpdateGeometryLODs();
+	UpdateReflectionInstances();
     m_lightingSystem->UpdateLightData(m_basicConstants);
-	m_shadowManager->UpdateShadowCB(m_basicConstants);
-	m_basicConstants.shadowTransform = m_shadowManager->GetShadowTransform();
+	UpdateLightClusters();
+	UpdateShadowCascades();
+	UpdateLightShadows();
     m_basicCB->CopyData(&m_basicConstants, sizeof(BasicConstants));
 }
 
+void SceneRenderer::UpdateGeometryLODs()
+{
+	// basic constants hold the camera matrices transposed for HLSL
+	ViewInfo viewInfo;
+	viewInfo.eyePos = m_basicConstants.eyePos;
+	XMStoreFloat4x4(&viewInfo.view, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.view)));
+	XMStoreFloat4x4(&viewInfo.projection, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.projection)));
+
+	for (auto& [layer, geometryEntries] : m_layeredGeometries)
+	{
+		for (auto& entry : geometryEntries)
+		{
+			entry->GeometryData->UpdateLOD(viewInfo);
+		}
+	}
+}
+
+void SceneRenderer::UpdateReflectionInstances()
+{
+	if (!m_reflectionMirror) return;
+
+	// moving the mirror invalidates every instance, otherwise only the ones whose source changed
+	Geometry* mirror = m_reflectionMirror->GeometryData.get();
+	bool mirrorChanged = mirror->GetObjectConstantsVersion() != m_reflectionMirrorVersion;
+	if (mirrorChanged)
+	{
+		XMFLOAT4 mirrorPlane = static_cast<Plane*>(mirror)->GetPlaneEquation();
+		XMStoreFloat4x4(&m_reflectionMatrix, MathUtils::MakeReflectionMatrix(mirrorPlane.x, mirrorPlane.y, mirrorPlane.z, mirrorPlane.w));
+		m_reflectionMirrorVersion = mirror->GetObjectConstantsVersion();
+	}
+
+	XMMATRIX R = XMLoadFloat4x4(&m_reflectionMatrix);
+	for (auto& instance : m_reflectionInstances)
+	{
+		Geometry* source = instance.Source->GeometryData.get();
+		if (!mirrorChanged && source->GetObjectConstantsVersion() == instance.SourceVersion) continue;
+
+		ObjectConstants objectConstants = source->GetObjectConstants();
+		XMMATRIX W = XMMatrixTranspose(XMLoadFloat4x4(&objectConstants.World));
+		XMStoreFloat4x4(&objectConstants.World, XMMatrixTranspose(W * R));
+		objectConstants.WorldInvTranspose = Geometry::ComputeWorldInvTranspose(objectConstants.World);
+		instance.ObjectCB->CopyData(&objectConstants, sizeof(ObjectConstants));
+		instance.SourceVersion = source->GetObjectConstantsVersion();
+	}
+}
+
+void SceneRenderer::UpdateShadowCascades()
+{
+	for (auto& drawList : m_shadowDrawLists) drawList.Clear();
+
+	// World geometry receives and, unless opted out, casts; tessellated surfaces only receive
+	m_shadowCasters.clear();
+	m_shadowCasterEntries.clear();
+	m_casterBounds.clear();
+	m_receiverBounds.clear();
+	for (auto& entry : m_layeredGeometries[RenderLayer::World])
+	{
+		if (!entry->IsVisible) continue;
+
+		Geometry* geometry = entry->GeometryData.get();
+		BoundingBox worldBounds = geometry->GetWorldBounds();
+		m_receiverBounds.push_back(worldBounds);
+		if (!entry->CastsShadows) continue;
+
+		ShadowCaster caster;
+		BoundingSphere::CreateFromBoundingBox(caster.worldBounds, worldBounds);
+		caster.sortKey = ShadowDrawList::MakeSortKey(static_cast<uint32_t>(geometry->GetVertexFormat()), geometry->GetVertexBufferAddress());
+		caster.index = static_cast<uint32_t>(m_shadowCasterEntries.size());
+		m_shadowCasters.push_back(caster);
+		m_shadowCasterEntries.push_back(entry.get());
+		m_casterBounds.push_back(worldBounds);
+	}
+	for (auto& entry : m_layeredGeometries[RenderLayer::Tessellation])
+	{
+		if (!entry->IsVisible) continue;
+		m_receiverBounds.push_back(entry->GeometryData->GetWorldBounds());
+	}
+
+	// the casters are gathered regardless, the light atlas draws them too
+	auto sunLight = m_lightingSystem->GetLight("SunLight");
+	if (!sunLight)
+	{
+		m_basicConstants.cascadeCount = 0;
+		return;
+	}
+	m_shadowManager->UpdateCascades(m_basicConstants, sunLight->Direction, m_casterBounds, m_receiverBounds);
+
+	for (uint32_t i = 0; i < m_shadowManager->GetCascadeCount(); ++i)
+	{
+		m_shadowDrawLists[i].Build(m_shadowManager->GetCascade(i), m_shadowCasters);
+	}
+}
+
+void SceneRenderer::UpdateLightShadows()
+{
+	// basic constants hold the camera matrices transposed for HLSL
+	XMFLOAT4X4 view;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.view)));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.projection)));
+
+	m_shadowLights.clear();
+	uint32_t lightCount = m_lightingSystem->GetLightCount();
+	bool hasCamera = projection._22 != 0.0f;
+
+	BoundingFrustum cameraFrustum;
+	if (hasCamera)
+	{
+		BoundingFrustum::CreateFromMatrix(cameraFrustum, XMLoadFloat4x4(&projection));
+		cameraFrustum.Transform(cameraFrustum, XMMatrixInverse(nullptr, XMLoadFloat4x4(&view)));
+	}
+
+	// lights whose range is off screen cannot shadow anything visible
+	for (uint32_t i = 0; hasCamera && i < lightCount; ++i)
+	{
+		LightHandle handle = m_lightingSystem->GetHandleAt(i);
+		LunarConstants::LightType type = m_lightingSystem->GetLightType(handle);
+		if (type == LunarConstants::LightType::Directional || !m_lightingSystem->IsLightEnabled(handle)) continue;
+
+		LightData light = *m_lightingSystem->GetLight(handle);
+		BoundingSphere lightBounds(light.Position, light.FalloffEnd);
+		if (light.FalloffEnd <= 0.0f || !cameraFrustum.Intersects(lightBounds)) continue;
+
+		ShadowLightDesc desc;
+		desc.lightIndex = i;
+		desc.lightId = handle.id;
+		desc.isPoint = type == LunarConstants::LightType::Point;
+		desc.position = light.Position;
+		desc.direction = light.Direction;
+		desc.range = light.FalloffEnd;
+		desc.cosHalfAngle = ClusteredLightBinner::ComputeSpotCosHalfAngle(light.SpotPower);
+		desc.importance = LODSelector::ComputeScreenCoverage(lightBounds, m_basicConstants.eyePos, projection);
+		m_shadowLights.push_back(desc);
+	}
+	m_shadowManager->UpdateAtlas(m_shadowLights, lightCount);
+
+	// casters come from UpdateShadowCascades
+	m_atlasDrawLists.resize(m_shadowManager->GetAtlasTileCount());
+	for (uint32_t i = 0; i < m_shadowManager->GetAtlasTileCount(); ++i)
+	{
+		m_atlasDrawLists[i].Build(m_shadowManager->GetAtlasTile(i).lightBounds, m_shadowCasters);
+	}
+}
+
+void SceneRenderer::UpdateLightClusters()
+{
+	// basic constants hold the camera matrices transposed for HLSL
+	XMFLOAT4X4 view, projection;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.view)));
+	XMStoreFloat4x4(&projection, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.projection)));
+
+	// recover the frustum from the left-handed perspective projection
+	bool projectionChanged = projection._11 != m_clusterProjection._11 || projection._22 != m_clusterProjection._22 ||
+		projection._33 != m_clusterProjection._33 || projection._43 != m_clusterProjection._43;
+	if (projection._22 != 0.0f && projectionChanged)
+	{
+		ClusterGridDesc desc = m_lightBinner.GetDesc();
+		desc.fovAngleY = 2.0f * atanf(1.0f / projection._22);
+		desc.aspectRatio = projection._22 / projection._11;
+		desc.nearZ = -projection._43 / projection._33;
+		desc.farZ = projection._43 / (1.0f - projection._33);
+		m_lightBinner.Initialize(desc);
+		m_clusterProjection = projection;
+	}
+
+	// as in the shader, a light without falloff is directional and lights every cluster
+	uint32_t lightCount = m_lightingSystem->GetLightCount();
+	m_clusterLights.resize(lightCount);
+	m_directionalLightIndices.clear();
+	for (uint32_t i = 0; i < lightCount; ++i)
+	{
+		LightHandle handle = m_lightingSystem->GetHandleAt(i);
+		LightData light = *m_lightingSystem->GetLight(handle);
+		ClusterLight& clusterLight = m_clusterLights[i];
+		clusterLight = { light.Position, 0.0f, light.Direction, -1.0f };
+		if (!m_lightingSystem->IsLightEnabled(handle)) continue;
+		if (light.FalloffEnd <= 0.0f)
+		{
+			m_directionalLightIndices.push_back(i);
+			continue;
+		}
+		clusterLight.range = light.FalloffEnd;
+		clusterLight.cosHalfAngle = ClusteredLightBinner::ComputeSpotCosHalfAngle(light.SpotPower);
+	}
+	m_lightBinner.Bin(m_clusterLights, view);
+
+	const vector<ClusterRange>& clusters = m_lightBinner.GetClusters();
+	const vector<uint32_t>& lightIndices = m_lightBinner.GetLightIndices();
+	const uint32_t directionalCount = static_cast<uint32_t>(m_directionalLightIndices.size());
+	const size_t indexCount = directionalCount + lightIndices.size();
+	if (indexCount > m_clusterLightIndexCapacity)
+	{
+		Microsoft::WRL::ComPtr<ID3D12Device> device;
+		THROW_IF_FAILED(m_clusterLightIndexBuffer->GetResource()->GetDevice(IID_PPV_ARGS(&device)));
+		m_retiredClusterLightIndexBuffer = move(m_clusterLightIndexBuffer);
+		m_clusterLightIndexCapacity = max(indexCount, m_clusterLightIndexCapacity * 2);
+		m_clusterLightIndexBuffer = make_unique<ConstantBuffer>(device.Get(), static_cast<UINT>(m_clusterLightIndexCapacity * sizeof(uint32_t)));
+	}
+
+	// the mappings are write-combined, so both are written once and in order
+	uint32_t* gpuLightIndices = static_cast<uint32_t*>(m_clusterLightIndexBuffer->GetMappedData());
+	copy(m_directionalLightIndices.begin(), m_directionalLightIndices.end(), gpuLightIndices);
+	copy(lightIndices.begin(), lightIndices.end(), gpuLightIndices + directionalCount);
+	ClusterRange* gpuClusters = static_cast<ClusterRange*>(m_clusterRangeBuffer->GetMappedData());
+	for (size_t i = 0; i < clusters.size(); ++i)
+	{
+		gpuClusters[i] = { clusters[i].offset + directionalCount, clusters[i].count };
+	}
+
+	const ClusterGridDesc& desc = m_lightBinner.GetDesc();
+	m_basicConstants.clusterDimensions[0] = desc.tilesX;
+	m_basicConstants.clusterDimensions[1] = desc.tilesY;
+	m_basicConstants.clusterDimensions[2] = desc.slices;
+	m_basicConstants.directionalLightCount = directionalCount;
+	m_basicConstants.clusterSliceScaleBias = m_lightBinner.GetSliceScaleBias();
+}
+
+void SceneRenderer::RegisterMeshMaterials(ID3D12Device* device, Mesh* mesh)
+{
+	// names are only unique within a file, so they are registered under the file path; loading the same file
+	// again shares its materials
+	vector<string> materialNames;
+	for (const MeshFileMaterial& fileMaterial : mesh->GetMaterials())
+	{
+		materialNames.push_back(mesh->GetFilePath() + "/" + fileMaterial.name);
+		if (m_materialManager->HasMaterial(materialNames.back())) continue;
+
+		const XMFLOAT3 albedo = { fileMaterial.baseColor.x, fileMaterial.baseColor.y, fileMaterial.baseColor.z };
+		const float metallic = fileMaterial.metallic;
+		MaterialConstants material = {};
+		material.albedo = albedo;
+		material.metallic = metallic;
+		material.roughness = fileMaterial.roughness;
+		material.F0 = {
+			0.04f + (albedo.x - 0.04f) * metallic,
+			0.04f + (albedo.y - 0.04f) * metallic,
+			0.04f + (albedo.z - 0.04f) * metallic };
+		material.ao = 1.0f;
+		m_materialManager->AddMaterial(device, materialNames.back(), material);
+	}
+
+	// a material set on the geometry overrides the file's for every submesh
+	if (mesh->GetMaterialName() != "default") return;
+	vector<string> submeshMaterialNames;
+	for (const MeshFileSubmesh& submesh : mesh->GetSubmeshes())
+	{
+		// MeshFile::Open checks the material indices
+		submeshMaterialNames.push_back(materialNames[submesh.materialIndex]);
+	}
+	mesh->SetSubmeshMaterialNames(move(submeshMaterialNames));
+}
+
 void SceneRenderer::UpdateParticleSystem(float deltaTime, ID3D12GraphicsCommandList* commandList)
 {
-	m_particleSystem->Update(deltaTime, commandList);
+	// m_basicConstants holds the transposed matrices the shaders read
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixTranspose(XMLoadFloat4x4(&m_basicConstants.view)));
+	m_particleSystem->SetViewMatrix(view);
+
+	// gathered every frame, so particles collide with geometry where it is drawn now
+	ParticleColliders colliders = m_particleSystem->GetColliders();
+	colliders.planes.clear();
+	colliders.spheres.clear();
+	for (RenderLayer layer : { RenderLayer::World, RenderLayer::Tessellation, RenderLayer::Mirror })
+	{
+		auto layerIt = m_layeredGeometries.find(layer);
+		if (layerIt == m_layeredGeometries.end()) continue;
+		for (const auto& entry : layerIt->second)
+		{
+			if (!entry->IsVisible) continue;
+			Geometry* geometry = entry->GeometryData.get();
+			if (dynamic_cast<Plane*>(geometry))
+			{
+				// the rectangle spans the local bounds along x and z, and its normal is local +y
+				XMMATRIX world = XMMatrixTranspose(XMLoadFloat4x4(&geometry->GetObjectConstants().World));
+				const BoundingBox& bounds = geometry->GetLocalBoundingBox();
+				XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&bounds.Center), world);
+				XMVECTOR axisU = XMVector3TransformNormal(XMVectorSet(bounds.Extents.x, 0.0f, 0.0f, 0.0f), world);
+				XMVECTOR axisV = XMVector3TransformNormal(XMVectorSet(0.0f, 0.0f, bounds.Extents.z, 0.0f), world);
+				XMVECTOR normal = XMVector3Normalize(XMVector3Cross(axisV, axisU));
+				axisU = XMVectorDivide(axisU, XMVector3LengthSq(axisU));
+				axisV = XMVectorDivide(axisV, XMVector3LengthSq(axisV));
+
+				ParticlePlaneCollider plane;
+				XMStoreFloat4(&plane.plane, XMVectorSetW(normal, -XMVectorGetX(XMVector3Dot(normal, center))));
+				XMStoreFloat4(&plane.tangentU, XMVectorSetW(axisU, -XMVectorGetX(XMVector3Dot(axisU, center))));
+				XMStoreFloat4(&plane.tangentV, XMVectorSetW(axisV, -XMVectorGetX(XMVector3Dot(axisV, center))));
+				colliders.planes.push_back(plane);
+			}
+			else if (dynamic_cast<IcoSphere*>(geometry))
+			{
+				BoundingBox bounds = geometry->GetWorldBounds();
+				float radius = max(bounds.Extents.x, max(bounds.Extents.y, bounds.Extents.z));
+				colliders.spheres.push_back(XMFLOAT4(bounds.Center.x, bounds.Center.y, bounds.Center.z, radius));
+			}
+		}
+	}
+	m_particleSystem->SetColliders(colliders);
+	m_particleSystem->Update(deltaTime, commandList, m_pipelineStateManager);
 }
 
 void SceneRenderer::RenderScene(ID3D12GraphicsCommandList* commandList)
@@ -217,6 +597,21 @@ void SceneRenderer::RenderScene(ID3D12GraphicsCommandList* commandList)
     commandList->SetGraphicsRootConstantBufferView(
         Lunar::LunarConstants::BASIC_CONSTANTS_ROOT_PARAMETER_INDEX, 
         m_basicCB->GetResource()->GetGPUVirtualAddress());
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::LIGHT_SRV_ROOT_PARAMETER_INDEX,
+		m_lightingSystem->GetLightBufferAddress());
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::SHADOW_TILE_SRV_ROOT_PARAMETER_INDEX,
+		m_shadowManager->GetAtlasTransformBufferAddress());
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::LIGHT_SHADOW_SRV_ROOT_PARAMETER_INDEX,
+		m_shadowManager->GetLightShadowTileBufferAddress());
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::CLUSTER_RANGE_SRV_ROOT_PARAMETER_INDEX,
+		m_clusterRangeBuffer->GetResource()->GetGPUVirtualAddress());
+	commandList->SetGraphicsRootShaderResourceView(
+		LunarConstants::CLUSTER_LIGHT_INDEX_SRV_ROOT_PARAMETER_INDEX,
+		m_clusterLightIndexBuffer->GetResource()->GetGPUVirtualAddress());
 
 	if (m_wireFrameRender) RenderWireframeOnly(commandList);
     else RenderLayers(commandList);
@@ -240,7 +635,7 @@ void SceneRenderer::CreateLightVisualizationCubes()
 	m_lightVisualization = true;
     
     // Directional Light - Yellow cube
-    const LightData* dirLight = m_lightingSystem->GetLight("SunLight");
+    auto dirLight = m_lightingSystem->GetLight("SunLight");
     if (dirLight) 
     {
         Transform dirTransform;
@@ -264,7 +659,7 @@ void SceneRenderer::CreateLightVisualizationCubes()
     }
     
     // Point Light - Red cube
-    auto* pointLight = m_lightingSystem->GetLight("RoomLight");
+    auto pointLight = m_lightingSystem->GetLight("RoomLight");
     if (pointLight) 
     {
         Transform pointTransform;
@@ -274,7 +669,7 @@ void SceneRenderer::CreateLightVisualizationCubes()
     }
     
     // Spot Light - Blue cube
-    auto* spotLight = m_lightingSystem->GetLight("FlashLight");
+    auto spotLight = m_lightingSystem->GetLight("FlashLight");
     if (spotLight) {
         Transform spotTransform;
         spotTransform.Location = spotLight->Position;
@@ -304,7 +699,7 @@ void SceneRenderer::UpdateLightVisualization()
 	if (!m_lightVisualization) return;
 	
     // Directional Light 
-    auto* dirLight = m_lightingSystem->GetLight("SunLight");
+    auto dirLight = m_lightingSystem->GetLight("SunLight");
     if (dirLight) 
     {
         SetGeometryLocation("LightViz_Directional", dirLight->Position);
@@ -322,14 +717,14 @@ void SceneRenderer::UpdateLightVisualization()
     }
     
     // Point Light 
-    auto* pointLight = m_lightingSystem->GetLight("RoomLight");
+    auto pointLight = m_lightingSystem->GetLight("RoomLight");
     if (pointLight)
     {
         SetGeometryLocation("LightViz_Point", pointLight->Position);
     }
     
     // Spot Light 
-    auto* spotLight = m_lightingSystem->GetLight("FlashLight");
+    auto spotLight = m_lightingSystem->GetLight("FlashLight");
     if (spotLight) 
     {
         SetGeometryLocation("LightViz_Spot", spotLight->Position);
@@ -406,6 +801,79 @@ bool SceneRenderer::SetGeometryVisibility(const string& name, bool visible)
     }
 }
 
+bool SceneRenderer::SetGeometryCastsShadows(const string& name, bool castsShadows)
+{
+    auto entry = GetGeometryEntry(name);
+    if (!entry)
+    {
+        LOG_ERROR("Geometry Entry with Geometry name " + name + " not found");
+        return false;
+    }
+    entry->CastsShadows = castsShadows;
+    return true;
+}
+
+bool SceneRenderer::SetGeometryMeshletCulling(const string& name, bool enabled)
+{
+    auto entry = GetGeometryEntry(name);
+    if (entry)
+    {
+        entry->GeometryData->SetMeshletCulling(enabled);
+        return true;
+    }
+    else 
+    {
+        LOG_ERROR("Geometry Entry with Geometry name " + name + " not found");
+        return false;
+    }
+}
+
+bool SceneRenderer::SetGeometryLODChain(const string& name, uint32_t levelCount, float lod0Coverage)
+{
+    auto entry = GetGeometryEntry(name);
+    if (entry)
+    {
+        entry->GeometryData->SetLODChain(levelCount, lod0Coverage);
+        return true;
+    }
+    else 
+    {
+        LOG_ERROR("Geometry Entry with Geometry name " + name + " not found");
+        return false;
+    }
+}
+
+bool SceneRenderer::SetGeometryMeshFile(const string& name, const string& filePath)
+{
+    auto entry = GetGeometryEntry(name);
+    Mesh* mesh = entry ? dynamic_cast<Mesh*>(entry->GeometryData.get()) : nullptr;
+    if (mesh)
+    {
+        mesh->SetFilePath(filePath);
+        return true;
+    }
+    else 
+    {
+        LOG_ERROR("Mesh Entry with Geometry name " + name + " not found");
+        return false;
+    }
+}
+
+bool SceneRenderer::SetGeometryVertexFormat(const string& name, VertexFormat vertexFormat)
+{
+    auto entry = GetGeometryEntry(name);
+    if (entry)
+    {
+        entry->GeometryData->SetVertexFormat(vertexFormat);
+        return true;
+    }
+    else 
+    {
+        LOG_ERROR("Geometry Entry with Geometry name " + name + " not found");
+        return false;
+    }
+}
+
 bool SceneRenderer::GetGeometryVisibility(const string& name) const
 {
     auto entry = GetGeometryEntry(name);
@@ -421,31 +889,30 @@ void SceneRenderer::RenderLayers(ID3D12GraphicsCommandList* commandList)
 {
     for (auto& it : m_layeredGeometries)
     {
+		string psoName;
 		switch (it.first)
 		{
 			case RenderLayer::Mirror :
 				commandList->OMSetStencilRef(1);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("mirror"));
-				break;
-			case RenderLayer::Reflect :
-				commandList->OMSetStencilRef(1);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("reflect"));
-				break;
+				DrawGeometries(commandList, it.second, "mirror", true);
+				// reflections are drawn right after the mirror marks the stencil
+				DrawReflectionInstances(commandList);
+				continue;
 			case RenderLayer::Background :
 				commandList->OMSetStencilRef(1);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("background"));
+				psoName = "background";
 				break;
 			case RenderLayer::World :
 				commandList->OMSetStencilRef(0);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("opaque"));	
+				psoName = "opaque";
 				break;
 			case RenderLayer::Tessellation :
 				commandList->OMSetStencilRef(0);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("tessellation"));
+				psoName = "tessellation";
 				break;
 			case RenderLayer::Billboard :
 				commandList->OMSetStencilRef(0);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("billboard"));
+				psoName = "billboard";
 				break;
 			case RenderLayer::Normal :
 				if (m_basicConstants.debugFlags & LunarConstants::DebugFlags::SHOW_NORMALS)
@@ -455,55 +922,117 @@ void SceneRenderer::RenderLayers(ID3D12GraphicsCommandList* commandList)
 					// Refactor
 					for (auto& entry : m_layeredGeometries[RenderLayer::World])
 					{
+						// normal visualization only understands the default layout
+						if (entry->GeometryData->GetVertexFormat() != VertexFormat::Default) continue;
 						entry->GeometryData->DrawNormals(commandList);
 					}
 				}
 				continue;
 			case RenderLayer::Debug :
 				commandList->OMSetStencilRef(0);
-				commandList->SetPipelineState(m_pipelineStateManager->GetPSO("opaque"));
+				psoName = "opaque";
 				break;
 			default:
 				LOG_ERROR("Not Handled RenderLayerType");
+				continue;
 		}
-    	
-        for (auto& entry : it.second)
-        {
-            if (entry->IsVisible)
-            {
-                string materialName = entry->GeometryData->GetMaterialName();
-                m_materialManager->BindConstantBuffer(materialName, commandList);
-                entry->GeometryData->Draw(commandList);
-            }
-        }
+		DrawGeometries(commandList, it.second, psoName, true);
     }
 }
 
 void SceneRenderer::RenderWireframeOnly(ID3D12GraphicsCommandList* commandList)
 {
-	commandList->SetPipelineState(m_pipelineStateManager->GetPSO("opaque_wireframe"));
-	for (auto& geoEntry : m_layeredGeometries[RenderLayer::World])
+	DrawGeometries(commandList, m_layeredGeometries[RenderLayer::World], "opaque_wireframe", true);
+	DrawGeometries(commandList, m_layeredGeometries[RenderLayer::Tessellation], "tessellation_wireframe", true);
+}
+
+void SceneRenderer::DrawGeometries(ID3D12GraphicsCommandList* commandList, const vector<shared_ptr<GeometryEntry>>& entries, const string& psoName, bool bindMaterials)
+{
+	// switch to the matching input layout variant only when the vertex format changes
+	commandList->SetPipelineState(m_pipelineStateManager->GetPSO(psoName));
+	VertexFormat currentFormat = VertexFormat::Default;
+	for (auto& entry : entries)
 	{
-		if (geoEntry->IsVisible)
+		if (!entry->IsVisible) continue;
+
+		VertexFormat vertexFormat = entry->GeometryData->GetVertexFormat();
+		if (vertexFormat != currentFormat)
+		{
+			commandList->SetPipelineState(m_pipelineStateManager->GetPSO(psoName, vertexFormat));
+			currentFormat = vertexFormat;
+		}
+		if (bindMaterials)
 		{
-			string materialName = geoEntry->GeometryData->GetMaterialName();
-			m_materialManager->BindConstantBuffer(materialName, commandList);
-			geoEntry->GeometryData->Draw(commandList);
+			DrawWithMaterials(commandList, entry->GeometryData.get(), 0);
+			continue;
 		}
+		entry->GeometryData->Draw(commandList);
 	}
+}
 
-	commandList->SetPipelineState(m_pipelineStateManager->GetPSO("tessellation_wireframe"));
-	for (auto& geoEntry : m_layeredGeometries[RenderLayer::Tessellation])
+void SceneRenderer::DrawWithMaterials(ID3D12GraphicsCommandList* commandList, Geometry* geometry, D3D12_GPU_VIRTUAL_ADDRESS objectConstants)
+{
+	// meshes with materials from their file draw one submesh per material
+	Mesh* mesh = dynamic_cast<Mesh*>(geometry);
+	if (mesh && !mesh->GetSubmeshMaterialNames().empty())
 	{
-		if (geoEntry->IsVisible)
+		const vector<string>& materialNames = mesh->GetSubmeshMaterialNames();
+		for (size_t i = 0; i < materialNames.size(); ++i)
 		{
-			string materialName = geoEntry->GeometryData->GetMaterialName();
-			m_materialManager->BindConstantBuffer(materialName, commandList);
-			geoEntry->GeometryData->Draw(commandList);
+			m_materialManager->BindConstantBuffer(materialNames[i], commandList);
+			mesh->DrawSubmesh(commandList, i, objectConstants);
 		}
+		return;
+	}
+
+	m_materialManager->BindConstantBuffer(geometry->GetMaterialName(), commandList);
+	if (objectConstants != 0)
+	{
+		geometry->DrawInstance(commandList, objectConstants);
+	}
+	else
+	{
+		geometry->Draw(commandList);
 	}
 }
 	
+void SceneRenderer::DrawShadowCasters(ID3D12GraphicsCommandList* commandList, const ShadowDrawList& drawList)
+{
+	// depth only, so no materials; the list is sorted by vertex format, which keeps pipeline switches to one per format
+	commandList->SetPipelineState(m_pipelineStateManager->GetPSO("shadowMap"));
+	VertexFormat currentFormat = VertexFormat::Default;
+	for (uint32_t casterIndex : drawList.GetDrawIndices())
+	{
+		Geometry* geometry = m_shadowCasterEntries[casterIndex]->GeometryData.get();
+		VertexFormat vertexFormat = geometry->GetVertexFormat();
+		if (vertexFormat != currentFormat)
+		{
+			commandList->SetPipelineState(m_pipelineStateManager->GetPSO("shadowMap", vertexFormat));
+			currentFormat = vertexFormat;
+		}
+		geometry->DrawShadow(commandList);
+	}
+}
+
+void SceneRenderer::DrawReflectionInstances(ID3D12GraphicsCommandList* commandList)
+{
+	commandList->SetPipelineState(m_pipelineStateManager->GetPSO("reflect"));
+	VertexFormat currentFormat = VertexFormat::Default;
+	for (auto& instance : m_reflectionInstances)
+	{
+		if (!instance.Source->IsVisible) continue;
+
+		Geometry* source = instance.Source->GeometryData.get();
+		VertexFormat vertexFormat = source->GetVertexFormat();
+		if (vertexFormat != currentFormat)
+		{
+			commandList->SetPipelineState(m_pipelineStateManager->GetPSO("reflect", vertexFormat));
+			currentFormat = vertexFormat;
+		}
+		DrawWithMaterials(commandList, source, instance.ObjectCB->GetResource()->GetGPUVirtualAddress());
+	}
+}
+
 GeometryEntry* SceneRenderer::GetGeometryEntry(const string& name)
 {
     auto it = m_geometriesByName.find(name);
@@ -1,4 +1,5 @@
 #pragma once
+#include <array>
 #include <d3d12.h>
 #include <vector>
 #include <memory>
@@ -12,6 +13,9 @@
 #include "UI/SceneViewModel.h"
 #include "Geometry/Transform.h"
 #include "Geometry/Geometry.h"
+#include "ClusteredLightBinner.h"
+#include "ShadowDrawList.h"
+#include "ShadowManager.h"
 
 namespace Lunar
 {
@@ -19,7 +23,6 @@ namespace Lunar
 class ShadowViewModel;
 class LightViewModel;
 class TextureManager;
-class ShadowManager;
 class PipelineStateManager;
 class LunarGui;
 class LightingSystem;
@@ -27,6 +30,7 @@ class ConstantBuffer;
 class ParticleSystem;
 class DebugViewModel;
 class DescriptorAllocator;
+class Mesh;
 struct BasicConstants;
 
 enum class RenderLayer
@@ -35,7 +39,6 @@ enum class RenderLayer
     World,
 	Tessellation,
 	Mirror,
-	Reflect,
 	Billboard,
     Translucent,
 	Normal,
@@ -49,6 +52,15 @@ struct GeometryEntry
     std::string Name;
     RenderLayer Layer;
     bool IsVisible = true;
+    bool CastsShadows = true;	// World entries only
+};
+
+// Mirrored copy of a World geometry; draws through the source's buffers with its own object constants
+struct ReflectionInstance
+{
+    std::shared_ptr<GeometryEntry>  Source;
+    std::unique_ptr<ConstantBuffer> ObjectCB;
+    uint32_t                        SourceVersion = UINT32_MAX;
 };
 
 class SceneRenderer
@@ -62,6 +74,10 @@ public:
 	void CreateDSVDescriptorHeap(ID3D12Device* device);
 	void CreateDepthStencilView(ID3D12Device* device);
 	void InitializeTextures(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator);
+	// Crossfades the image-based lighting to another HDR file over the next frames
+	void SetEnvironment(const std::string& filePath);
+	// Records this frame's share of an environment switch; call once the previous frame has finished on the GPU
+	void UpdateEnvironment(float deltaTime, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator);
 
 	void RenderShadowMap(ID3D12GraphicsCommandList* commandList);
 	void UpdateScene(float deltaTime);
@@ -74,6 +90,12 @@ public:
     bool SetGeometryTransform(const std::string& name, const Transform& newTransform);
     bool SetGeometryLocation(const std::string& name, const DirectX::XMFLOAT3& newLocation);
     bool SetGeometryVisibility(const std::string& name, bool visible);
+    bool SetGeometryCastsShadows(const std::string& name, bool castsShadows);
+    // InitializeScene falls back to the default format when one of the layer's pipelines has no variant for it
+    bool SetGeometryVertexFormat(const std::string& name, VertexFormat vertexFormat);
+    bool SetGeometryMeshletCulling(const std::string& name, bool enabled);
+    bool SetGeometryLODChain(const std::string& name, uint32_t levelCount, float lod0Coverage = 0.5f);
+    bool SetGeometryMeshFile(const std::string& name, const std::string& filePath);
     
     bool DoesGeometryExist(const std::string& name) const;
     const Transform GetGeometryTransform(const std::string& name) const;
@@ -87,10 +109,30 @@ public:
 	BasicConstants& GetBasicConstants() { return m_basicConstants; }
 	ID3D12DescriptorHeap* GetDSVHeap() { return m_dsvHeap.Get(); };
 	ParticleSystem* GetParticleSystem() { return m_particleSystem.get(); };
+	const ShadowDrawStats& GetShadowDrawStats(uint32_t cascadeIndex) const { return m_shadowDrawLists[cascadeIndex].GetStats(); }
     
 private:
     std::map<RenderLayer, std::vector<std::shared_ptr<GeometryEntry>>> m_layeredGeometries;
     std::unordered_map<std::string, std::shared_ptr<GeometryEntry>> m_geometriesByName;
+    std::vector<ReflectionInstance> m_reflectionInstances;
+    std::shared_ptr<GeometryEntry> m_reflectionMirror;
+    uint32_t m_reflectionMirrorVersion = UINT32_MAX;
+    DirectX::XMFLOAT4X4 m_reflectionMatrix;
+    std::array<ShadowDrawList, LunarConstants::MAX_SHADOW_CASCADES> m_shadowDrawLists;
+    std::vector<ShadowDrawList> m_atlasDrawLists;			// one per light atlas tile
+    std::vector<ShadowLightDesc> m_shadowLights;
+    std::vector<ShadowCaster> m_shadowCasters;				// gathered each frame, index into m_shadowCasterEntries
+    std::vector<GeometryEntry*> m_shadowCasterEntries;
+    std::vector<DirectX::BoundingBox> m_casterBounds;		// world bounds gathered for shadow fitting each frame
+    std::vector<DirectX::BoundingBox> m_receiverBounds;
+    ClusteredLightBinner m_lightBinner;
+    DirectX::XMFLOAT4X4 m_clusterProjection = {};			// projection the cluster grid was built for
+    std::vector<ClusterLight> m_clusterLights;				// per pooled light; directional and disabled ones have no range
+    std::vector<uint32_t> m_directionalLightIndices;
+    std::unique_ptr<ConstantBuffer> m_clusterRangeBuffer;
+    std::unique_ptr<ConstantBuffer> m_clusterLightIndexBuffer;
+    std::unique_ptr<ConstantBuffer> m_retiredClusterLightIndexBuffer;	// outgrown, but the frame in flight may still read it
+    size_t m_clusterLightIndexCapacity = 0;
     std::unique_ptr<MaterialManager> m_materialManager;
     std::unique_ptr<TextureManager> m_textureManager;
 	std::unique_ptr<ShadowManager> m_shadowManager;
@@ -105,7 +147,20 @@ private:
 
 	BasicConstants m_basicConstants;
     void RenderLayers(ID3D12GraphicsCommandList* commandList);
+	void UpdateGeometryLODs();
+	void UpdateReflectionInstances();
+	void UpdateShadowCascades();
+	void UpdateLightShadows();
+	// Bins the point and spot lights into the camera's clusters and uploads the ranges and the light index list
+	void UpdateLightClusters();
+	void DrawReflectionInstances(ID3D12GraphicsCommandList* commandList);
+	void DrawShadowCasters(ID3D12GraphicsCommandList* commandList, const ShadowDrawList& drawList);
+	void RegisterMeshMaterials(ID3D12Device* device, Mesh* mesh);
 	void RenderWireframeOnly(ID3D12GraphicsCommandList* commandList);
+	void DrawGeometries(ID3D12GraphicsCommandList* commandList, const std::vector<std::shared_ptr<GeometryEntry>>& entries, const std::string& psoName, bool bindMaterials);
+	// Binds the geometry's material, or each submesh's for a mesh, and draws it; with objectConstants as
+	// its object constants when not zero
+	void DrawWithMaterials(ID3D12GraphicsCommandList* commandList, Geometry* geometry, D3D12_GPU_VIRTUAL_ADDRESS objectConstants);
     bool GetGeometryVisibility(const std::string& name) const;
     GeometryEntry* GetGeometryEntry(const std::string& name);
 
@@ -11,7 +11,7 @@ struct HullOut
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
 	float3 posW : POSITION;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 struct DomainOut
@@ -21,7 +21,7 @@ struct DomainOut
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
 	float3 posW : POSITION;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 [domain("tri")]
@@ -39,7 +39,7 @@ DomainOut main(PatchConstOutput patchConst, float3 uv : SV_DomainLocation, const
 	domainOut.texCoord = tri[0].texCoord * w + tri[1].texCoord * u + tri[2].texCoord * v;
 	domainOut.normal = normalize(tri[0].normal * w + tri[1].normal * u + tri[2].normal * v);
 	domainOut.posW   = tri[0].posW   * w + tri[1].posW   * u + tri[2].posW   * v;
-	domainOut.tangent= normalize(tri[0].tangent * w + tri[1].tangent * u + tri[2].tangent * v);
+	domainOut.tangent= float4(normalize(tri[0].tangent.xyz * w + tri[1].tangent.xyz * u + tri[2].tangent.xyz * v), tri[0].tangent.w);
 
 	return domainOut;
 }
\ No newline at end of file
@@ -7,7 +7,7 @@ struct VertexOut
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
 	float3 posW : POSITION;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 struct HullOut
@@ -17,7 +17,7 @@ struct HullOut
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
 	float3 posW : POSITION;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 struct PatchConstOutput
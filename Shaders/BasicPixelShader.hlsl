@@ -4,6 +4,7 @@
 Texture2D wallTexture : register(t0);
 Texture2D normalTexture : register(t4);
 Texture2D shadowTexture : register(t0, space1);
+Texture2D shadowAtlas : register(t1, space1);
 
 struct PixelIn
 {
@@ -12,9 +13,32 @@ struct PixelIn
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
 	float3 posW : POSITION;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
+// Shadow of a spot or point light from the light atlas; point lights have six tiles in +X, -X, +Y, -Y, +Z, -Z order
+float ComputeLocalLightShadow(uint lightIndex, Light light, float3 posW)
+{
+	int tileIndex = lightShadowTiles[lightIndex];
+	if (tileIndex < 0) return 1.0;
+
+	if (light.spotPower <= 0.0f)
+	{
+		float3 fromLight = posW - light.position;
+		float3 absFromLight = abs(fromLight);
+		uint face = absFromLight.x >= absFromLight.y && absFromLight.x >= absFromLight.z ? (fromLight.x >= 0.0 ? 0 : 1) :
+			absFromLight.y >= absFromLight.z ? (fromLight.y >= 0.0 ? 2 : 3) : (fromLight.z >= 0.0 ? 4 : 5);
+		tileIndex += face;
+	}
+
+	float4 shadowCoord = mul(float4(posW, 1.0), shadowTiles[tileIndex]);
+	shadowCoord.xyz /= shadowCoord.w;
+	if (shadowCoord.w <= 0.0 || any(shadowCoord.xyz < 0.0) || any(shadowCoord.xyz > 1.0)) return 1.0;
+
+	float shadowDepth = shadowAtlas.Sample(g_sampler, shadowCoord.xy).r;
+	return shadowCoord.z > shadowDepth ? 0.3 : 1.0;
+}
+
 float CalculateAttenuation(float distanceFromLight, Light light)
 {
 	return saturate((light.fallOffEnd - distanceFromLight) / (light.fallOffEnd - light.fallOffStart));
@@ -93,8 +117,18 @@ float4 main(PixelIn pIn) : SV_TARGET
 
 	float shadowFactor = 1.0;
 	float4 posW = float4(pIn.posW, 1.0);
-	float4 shadowCoord = mul(posW, shadowTransform);
-	
+
+	// pick the first cascade whose split lies beyond the pixel; unused splits are FLT_MAX
+	float4 viewPos = mul(posW, view);
+	float viewDepth = viewPos.z;
+	uint cascadeIndex = 0;
+	[unroll]
+	for (uint c = 0; c < 4; ++c)
+	{
+		cascadeIndex += viewDepth > cascadeSplits[c] ? 1 : 0;
+	}
+
+	float4 shadowCoord = cascadeIndex < cascadeCount ? mul(posW, shadowTransforms[cascadeIndex]) : float4(-1.0, -1.0, -1.0, 1.0);
 	if (shadowCoord.x >= 0.0 && shadowCoord.x <= 1.0 && shadowCoord.y >= 0.0 && shadowCoord.y <= 1.0 && shadowCoord.z >= 0.0 && shadowCoord.z <= 1.0)
     {
 		float currentDepth = shadowCoord.z;
@@ -107,10 +141,19 @@ float4 main(PixelIn pIn) : SV_TARGET
 	float3 nToEye = normalize(toEye);
 	float3 finalColor = ambientLight.rgb * diffuseColor.rgb;
 	
-	// Direct lighting from light sources
-	finalColor += ComputeLight(lights[0], pIn.posW, normalWS, nToEye, material) * shadowFactor;
-	finalColor += ComputeLight(lights[1], pIn.posW, normalWS, nToEye, material);
-	finalColor += ComputeLight(lights[2], pIn.posW, normalWS, nToEye, material);
+	// Direct lighting: directional lights use the cascades, and the spot and point lights binned into the
+	// pixel's cluster the light atlas
+	for (uint d = 0; d < directionalLightCount; ++d)
+	{
+		finalColor += ComputeLight(lightPool[clusterLightIndices[d]], pIn.posW, normalWS, nToEye, material) * shadowFactor;
+	}
+	uint2 cluster = clusterRanges[GetClusterIndex(viewPos)];
+	for (uint i = 0; i < cluster.y; ++i)
+	{
+		uint lightIndex = clusterLightIndices[cluster.x + i];
+		Light light = lightPool[lightIndex];
+		finalColor += ComputeLight(light, pIn.posW, normalWS, nToEye, material) * ComputeLocalLightShadow(lightIndex, light, pIn.posW);
+	}
 
 	// IBL (Image-Based Lighting) contribution
 	static const uint iblMask = 0x80;
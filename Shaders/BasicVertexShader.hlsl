@@ -10,7 +10,7 @@ struct VertexIn
     float4 color : COLOR;
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 struct VertexOut
@@ -20,7 +20,7 @@ struct VertexOut
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
 	float3 posW : POSITION;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 VertexOut main(VertexIn vIn)
@@ -31,7 +31,7 @@ VertexOut main(VertexIn vIn)
 	float4 posW = mul(pos, world);
 	
     pIn.normal = normalize(mul(vIn.normal, (float3x3)worldInvTranspose));
-	pIn.tangent = mul(vIn.tangent, (float3x3)world);
+	pIn.tangent = float4(mul(vIn.tangent.xyz, (float3x3)world), vIn.tangent.w);
 	
     float heightScale = 0.2; // for now, hardcoded
     uint heightMapEnabledMask = 1 << 8;
@@ -15,9 +15,38 @@ cbuffer BasicConstants : register(b0)
 	float3 eyePos;
     uint debugFlags;  // Debug mode flags
 	float4 ambientLight;
-	Light lights[3];
-	float4x4 shadowTransform;
+	uint lightCount;
+	uint3 lightPadding;
+	float4x4 shadowTransforms[4];	// MAX_SHADOW_CASCADES
+	float4 cascadeSplits;
+	uint cascadeCount;
+	uint3 cascadePadding;
+	float4 irradianceSH[9];	// cosine-convolved L2 SH, rgb
+	float environmentBlend;	// weight of the incoming environment while switching
+	uint3 environmentPadding;
+	uint3 clusterDimensions;	// tiles across, tiles down and depth slices
+	uint directionalLightCount;	// lights at the head of clusterLightIndices
+	float2 clusterSliceScaleBias;
+	float2 clusterPadding;
+}
+
+StructuredBuffer<Light> lightPool : register(t0, space4);
+StructuredBuffer<float4x4> shadowTiles : register(t1, space4);	// world to light atlas texture space
+StructuredBuffer<int> lightShadowTiles : register(t2, space4);	// first tile per light, -1 without a shadow
+StructuredBuffer<uint2> clusterRanges : register(t3, space4);	// offset into clusterLightIndices and light count per cluster
+StructuredBuffer<uint> clusterLightIndices : register(t4, space4);	// lightPool indices: the directional lights, then each cluster's
 
+// Cluster of a view-space position, the same mapping ClusteredLightBinner bins with: tiles split the screen
+// evenly with the top row first, and slices split view depth exponentially
+uint GetClusterIndex(float4 viewPos)
+{
+	float4 clipPos = mul(viewPos, projection);
+	float2 ndc = clipPos.xy / clipPos.w;
+	uint tileX = min(uint(saturate(ndc.x * 0.5 + 0.5) * clusterDimensions.x), clusterDimensions.x - 1);
+	uint tileY = min(uint(saturate(0.5 - ndc.y * 0.5) * clusterDimensions.y), clusterDimensions.y - 1);
+	float slice = floor(log(max(viewPos.z, 1e-6)) * clusterSliceScaleBias.x + clusterSliceScaleBias.y);
+	uint sliceIndex = min(uint(max(slice, 0.0)), clusterDimensions.z - 1);
+	return (sliceIndex * clusterDimensions.y + tileY) * clusterDimensions.x + tileX;
 }
 
 cbuffer ObjectConstants : register(b1)
@@ -27,14 +56,15 @@ cbuffer ObjectConstants : register(b1)
 	int textureIndex;	
 }
 
-float3x3 GetTBN(float3 normal, float3 tangent)
+// tangent.w is the bitangent sign written by TangentGenerator
+float3x3 GetTBN(float3 normal, float4 tangent)
 {
 	float3 N = normalize(normal);
-	float3 T = normalize(tangent);
+	float3 T = normalize(tangent.xyz);
 	
 	T = normalize(T - dot(T, N) * N);
 	
-	float3 B = cross(N, T);
+	float3 B = cross(N, T) * tangent.w;
 
 	return float3x3(T, B, N);
 }
@@ -43,4 +73,22 @@ float3 NormalTSToWS(float3 normalSample, float3x3 TBN)
 {
 	float3 n = normalSample * 2.0f - 1.0f;
 	return normalize(mul(n, TBN));
-}
\ No newline at end of file
+}
+
+// Inverse of VertexFormatUtils::EncodeOctahedral (input already expanded from R16G16_SNORM)
+float3 OctDecode(float2 e)
+{
+	float3 n = float3(e.x, e.y, 1.0 - abs(e.x) - abs(e.y));
+	float t = saturate(-n.z);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// Inverse of VertexFormatUtils::EncodeOctahedralTangent, w = handedness
+float4 OctDecodeTangent(float2 e)
+{
+	float handedness = e.y < 0.0 ? -1.0 : 1.0;
+	e.y = abs(e.y) * 2.0 - 1.0;
+	return float4(OctDecode(e), handedness);
+}
@@ -0,0 +1,55 @@
+#include "Common.hlsl"
+
+SamplerState g_sampler : register(s0);
+
+Texture2D heightTexture : register(t6);
+
+// matches the "compact" input layout (CompactVertex)
+struct VertexIn
+{
+    float3 pos : POSITION;
+    float4 color : COLOR;		// R8G8B8A8_UNORM
+	float2 texCoord : TEXCOORD;	// R16G16_FLOAT
+	float2 normal : NORMAL;		// R16G16_SNORM, octahedral
+	float2 tangent : TANGENT;	// R16G16_SNORM, octahedral + handedness
+};
+
+struct VertexOut
+{
+    float4 pos : SV_POSITION;
+    float4 color : COLOR;
+	float2 texCoord : TEXCOORD;
+	float3 normal : NORMAL;
+	float3 posW : POSITION;
+	float4 tangent : TANGENT;
+};
+
+VertexOut main(VertexIn vIn)
+{
+    VertexOut pIn;
+	
+	float4 pos = float4(vIn.pos, 1.0f);
+	float4 posW = mul(pos, world);
+	
+    pIn.normal = normalize(mul(OctDecode(vIn.normal), (float3x3)worldInvTranspose));
+	float4 tangent = OctDecodeTangent(vIn.tangent);
+	pIn.tangent = float4(mul(tangent.xyz, (float3x3)world), tangent.w);
+	
+    float heightScale = 0.2; // for now, hardcoded
+    uint heightMapEnabledMask = 1 << 8;
+    if ((debugFlags & heightMapEnabledMask) != 0)
+    {
+        float height = heightTexture.SampleLevel(g_sampler, vIn.texCoord, 0).r;
+    	height = height * 2.0 - 1.0;
+        posW.xyz += pIn.normal * height * heightScale;
+    }
+	
+	pIn.posW = posW.xyz;
+    float4 posWV = mul(posW, view); 
+    pIn.pos = mul(posWV, projection);
+	
+    pIn.color = vIn.color;
+	pIn.texCoord = vIn.texCoord;
+	
+    return pIn;
+}
@@ -6,7 +6,7 @@ struct VertexIn
 	float4 color : COLOR;
 	float2 texCoord : TEXCOORD;
 	float3 normal : NORMAL;
-	float3 tangent : TANGENT;
+	float4 tangent : TANGENT;
 };
 
 struct GeometryIn
@@ -3,9 +3,9 @@ Texture2D aoTexture : register(t5);
 Texture2D metallicTexture : register(t7);
 Texture2D roughnessTexture : register(t8);
 
-TextureCube irradianceMap : register(t10);
-TextureCube prefilteredMap : register(t12);
-Texture2D brdfLutTexture : register(t21);
+TextureCube prefilteredMap : register(t10);
+Texture2D brdfLutTexture : register(t11);
+TextureCube prefilteredMapNext : register(t13);	// incoming environment, weighted by environmentBlend
 
 SamplerState g_sampler : register(s0);
 
@@ -113,9 +113,24 @@ float SmithG(float nDotL, float nDotV, float roughness)
 	return G1V * G1L;
 }
 
+// Irradiance from the L2 SH in the basic constants, basis order as in SphericalHarmonics::EvaluateBasis
+float3 EvaluateSHIrradiance(float3 n)
+{
+    float3 irradiance = irradianceSH[0].rgb * 0.282095;
+    irradiance += irradianceSH[1].rgb * (0.488603 * n.y);
+    irradiance += irradianceSH[2].rgb * (0.488603 * n.z);
+    irradiance += irradianceSH[3].rgb * (0.488603 * n.x);
+    irradiance += irradianceSH[4].rgb * (1.092548 * n.x * n.y);
+    irradiance += irradianceSH[5].rgb * (1.092548 * n.y * n.z);
+    irradiance += irradianceSH[6].rgb * (0.315392 * (3.0 * n.z * n.z - 1.0));
+    irradiance += irradianceSH[7].rgb * (1.092548 * n.x * n.z);
+    irradiance += irradianceSH[8].rgb * (0.546274 * (n.x * n.x - n.y * n.y));
+    return max(irradiance, 0.0);
+}
+
 float3 GetIBLDiffuse(float3 normal, float3 viewDir, Material material)
 {
-    float3 irradiance = irradianceMap.Sample(g_sampler, normal).rgb;
+    float3 irradiance = EvaluateSHIrradiance(normal);
     
     // Lambert BRDF: albedo / π
     float3 diffuse = material.albedo / 3.141592;
@@ -138,8 +153,16 @@ float3 GetIBLSpecular(float3 normal, float3 viewDir, Material material)
     
     float3 reflectionVector = reflect(-viewDir, normal);
     
-    float mipLevel = material.roughness * 6.0; // Assuming 7 mip levels (0-6)
-    float3 prefilteredColor = prefilteredMap.SampleLevel(g_sampler, reflectionVector, mipLevel).rgb;
+    // roughness goes from 0 to 1 over the whole mip chain, whose length depends on the environment size
+    float width, height, mipCount;
+    prefilteredMap.GetDimensions(0, width, height, mipCount);
+    float3 prefilteredColor = prefilteredMap.SampleLevel(g_sampler, reflectionVector, material.roughness * (mipCount - 1)).rgb;
+    if (environmentBlend > 0.0)
+    {
+        prefilteredMapNext.GetDimensions(0, width, height, mipCount);
+        float3 nextColor = prefilteredMapNext.SampleLevel(g_sampler, reflectionVector, material.roughness * (mipCount - 1)).rgb;
+        prefilteredColor = lerp(prefilteredColor, nextColor, environmentBlend);
+    }
     
     float2 brdf = brdfLutTexture.Sample(g_sampler, float2(NdotV, material.roughness)).rg;
     
@@ -0,0 +1,76 @@
+struct Particle
+{
+    float3 position;
+    float3 velocity;
+    float3 force;
+    float4 color;
+    float lifetime;
+    float age;
+};
+
+// Root constants, see ParticleSystem::SetParticleConstants
+cbuffer ParticleConstants : register(b3)
+{
+    float3 emitterPosition;
+    uint spawnCount;
+    uint seed;
+    uint aliveListIndex;    // list the update reads; the vertex shader draws it
+    uint capacity;
+    float deltaTime;
+    uint substepCount;      // ParticleSimulation::GetSubstepCount
+    uint integrator;        // ParticleIntegrator
+    uint sortBlockSize;     // ParticleSortShader.hlsl, set per dispatch
+    uint sortStepSize;
+    float4 viewDepth;       // third column of the view matrix: view-space depth is dot(float4(position, 1), viewDepth)
+    uint planeColliderCount;    // ParticleColliders: three float4 per plane, then one per sphere
+    uint sphereColliderCount;
+    float restitution;
+    float friction;
+    float particleRadius;
+};
+
+static const uint INTEGRATOR_EULER = 0;
+static const uint INTEGRATOR_VERLET = 1;
+
+static const uint THREAD_GROUP_SIZE = 64;   // PARTICLE_THREAD_GROUP_SIZE
+
+// Particle list buffer, ParticleListHeader in ParticleSimulation.h followed by the lists, in bytes
+static const uint DEAD_COUNT_OFFSET = 0;
+static const uint ALIVE_COUNT_OFFSET = 4;   // two counters
+static const uint DRAW_ARGUMENTS_OFFSET = 16;
+static const uint DISPATCH_ARGUMENTS_OFFSET = 32;
+static const uint LISTS_OFFSET = 48;        // dead list, alive list 0, alive list 1
+
+uint GetDeadListOffset()
+{
+    return LISTS_OFFSET;
+}
+
+uint GetAliveListOffset(uint list)
+{
+    return LISTS_OFFSET + (1 + list) * capacity * 4;
+}
+
+// XorShiftRandom in ParticleSimulation.h
+uint SeedRandom(uint value)
+{
+    value ^= value >> 16;
+    value *= 0x85EBCA6B;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35;
+    value ^= value >> 16;
+    return value != 0 ? value : 0x6D2B79F5;
+}
+
+uint NextRandom(inout uint state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+float NextRandomFloat(inout uint state)
+{
+    return (NextRandom(state) >> 8) * (1.0 / 16777216.0);
+}
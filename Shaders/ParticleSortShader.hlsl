@@ -0,0 +1,146 @@
+#include "ParticleCommon.hlsl"
+
+// Bitonic sort of the alive list back to front, run after BuildArguments and before the CPU flips
+// aliveListIndex, so the list to sort is the other one. Sorts (key, particle index) pairs rather than particles.
+// Every compare-exchange orders its pair ascending (the "flip" form of the network). Entries past the alive
+// count hold the largest key, and such a pair never swaps, so they stay put and whole groups past it return early.
+
+RWStructuredBuffer<Particle> particles : register(u0);
+RWByteAddressBuffer particleLists : register(u1);
+RWStructuredBuffer<uint2> sortEntries : register(u2);    // key, particle index; a power of two of at least LOCAL_SORT_SIZE
+
+static const uint LOCAL_SORT_SIZE = 1024;    // entries a group sorts in shared memory, two per thread
+static const uint SORT_GROUP_SIZE = LOCAL_SORT_SIZE / 2;
+static const uint PADDING_KEY = 0xFFFFFFFF;
+
+groupshared uint2 localEntries[LOCAL_SORT_SIZE];
+
+uint GetSortListIndex()
+{
+    return 1 - aliveListIndex;
+}
+
+uint GetSortCount()
+{
+    return particleLists.Load(ALIVE_COUNT_OFFSET + GetSortListIndex() * 4);
+}
+
+// RadixSorter::FloatToKey of the view depth, inverted so the farthest particle comes first
+uint GetDepthKey(float3 position)
+{
+    uint bits = asuint(dot(float4(position, 1.0), viewDepth));
+    uint orderedBits = bits ^ ((bits & 0x80000000) != 0 ? 0xFFFFFFFF : 0x80000000);
+    return ~orderedBits;
+}
+
+// Pair of the network step that merges blocks of blockSize with partners stepSize apart; the first step of
+// a block compares mirrored positions
+void GetPair(uint thread, uint blockSize, uint stepSize, out uint first, out uint second)
+{
+    first = ((thread & ~(stepSize - 1)) << 1) | (thread & (stepSize - 1));
+    second = (stepSize * 2 == blockSize) ? first ^ (blockSize - 1) : first + stepSize;
+}
+
+void LocalCompareExchange(uint thread, uint blockSize, uint stepSize)
+{
+    uint first, second;
+    GetPair(thread, blockSize, stepSize, first, second);
+    uint2 a = localEntries[first];
+    uint2 b = localEntries[second];
+    if (a.x > b.x)
+    {
+        localEntries[first] = b;
+        localEntries[second] = a;
+    }
+    GroupMemoryBarrierWithGroupSync();
+}
+
+// Fills every entry, padding included; larger groups keep the dispatch within limits at the largest capacity
+[numthreads(SORT_GROUP_SIZE, 1, 1)]
+void BuildSortKeys(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint i = dispatchThreadID.x;
+    if (i < GetSortCount())
+    {
+        uint index = particleLists.Load(GetAliveListOffset(GetSortListIndex()) + i * 4);
+        sortEntries[i] = uint2(GetDepthKey(particles[index].position), index);
+    }
+    else
+    {
+        sortEntries[i] = uint2(PADDING_KEY, 0);
+    }
+}
+
+// Sorts each run of LOCAL_SORT_SIZE entries
+[numthreads(SORT_GROUP_SIZE, 1, 1)]
+void SortLocal(uint3 groupID : SV_GroupID, uint3 groupThreadID : SV_GroupThreadID)
+{
+    uint base = groupID.x * LOCAL_SORT_SIZE;
+    if (base >= GetSortCount()) return;
+
+    uint thread = groupThreadID.x;
+    localEntries[thread] = sortEntries[base + thread];
+    localEntries[thread + SORT_GROUP_SIZE] = sortEntries[base + thread + SORT_GROUP_SIZE];
+    GroupMemoryBarrierWithGroupSync();
+
+    [loop]
+    for (uint blockSize = 2; blockSize <= LOCAL_SORT_SIZE; blockSize <<= 1)
+    {
+        [loop]
+        for (uint stepSize = blockSize >> 1; stepSize > 0; stepSize >>= 1)
+        {
+            LocalCompareExchange(thread, blockSize, stepSize);
+        }
+    }
+
+    sortEntries[base + thread] = localEntries[thread];
+    sortEntries[base + thread + SORT_GROUP_SIZE] = localEntries[thread + SORT_GROUP_SIZE];
+}
+
+// One step of block sortBlockSize with partners sortStepSize >= LOCAL_SORT_SIZE apart, one pair per thread
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void SortStep(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint first, second;
+    GetPair(dispatchThreadID.x, sortBlockSize, sortStepSize, first, second);
+    if (first >= GetSortCount()) return;
+
+    uint2 a = sortEntries[first];
+    uint2 b = sortEntries[second];
+    if (a.x > b.x)
+    {
+        sortEntries[first] = b;
+        sortEntries[second] = a;
+    }
+}
+
+// The remaining steps of block sortBlockSize, whose partners are within one run of LOCAL_SORT_SIZE
+[numthreads(SORT_GROUP_SIZE, 1, 1)]
+void MergeLocal(uint3 groupID : SV_GroupID, uint3 groupThreadID : SV_GroupThreadID)
+{
+    uint base = groupID.x * LOCAL_SORT_SIZE;
+    if (base >= GetSortCount()) return;
+
+    uint thread = groupThreadID.x;
+    localEntries[thread] = sortEntries[base + thread];
+    localEntries[thread + SORT_GROUP_SIZE] = sortEntries[base + thread + SORT_GROUP_SIZE];
+    GroupMemoryBarrierWithGroupSync();
+
+    [loop]
+    for (uint stepSize = SORT_GROUP_SIZE; stepSize > 0; stepSize >>= 1)
+    {
+        LocalCompareExchange(thread, sortBlockSize, stepSize);
+    }
+
+    sortEntries[base + thread] = localEntries[thread];
+    sortEntries[base + thread + SORT_GROUP_SIZE] = localEntries[thread + SORT_GROUP_SIZE];
+}
+
+// Writes the sorted indices back over the alive list the vertex shader draws
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void WriteSortedList(uint3 dispatchThreadID : SV_DispatchThreadID)
+{
+    uint i = dispatchThreadID.x;
+    if (i >= GetSortCount()) return;
+    particleLists.Store(GetAliveListOffset(GetSortListIndex()) + i * 4, sortEntries[i].y);
+}
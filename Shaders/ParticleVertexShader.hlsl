@@ -1,12 +1,4 @@
-struct Particle
-{
-    float3 position;
-    float3 velocity;
-    float3 force;
-    float4 color;
-    float lifetime;
-    float age;
-};
+#include "ParticleCommon.hlsl"
 
 struct VertexIn 
 {
@@ -33,10 +25,12 @@ cbuffer BasicConstants : register(b0)
 };
 
 StructuredBuffer<Particle> particles : register(t0, space2);
+ByteAddressBuffer particleLists : register(t1, space2);
 
+// one instance per entry of the alive list
 GeometryIn main(VertexIn vIn, uint instanceID : SV_InstanceID)
 {
-    Particle particle = particles[instanceID];
+    Particle particle = particles[particleLists.Load(GetAliveListOffset(aliveListIndex) + instanceID * 4)];
     GeometryIn gIn;
     
     bool isActive = particle.age < particle.lifetime;
@@ -47,7 +41,9 @@ GeometryIn main(VertexIn vIn, uint instanceID : SV_InstanceID)
     gIn.posH = mul(posV, projection);
     
     gIn.size = float2(0.02f, 0.02f);
+    // fades out over its life; the depth sort keeps the blending in order
     gIn.color = particle.color;
+    gIn.color.a *= saturate(1.0 - particle.age / particle.lifetime);
     
     return gIn;
 }
\ No newline at end of file
@@ -1,26 +1,143 @@
-struct Particle
+#include "ParticleCommon.hlsl"
+
+RWStructuredBuffer<Particle> particles : register(u0);
+RWByteAddressBuffer particleLists : register(u1);
+StructuredBuffer<float4> particleColliders : register(t2, space2);
+
+// Moves the particle depth along the collider's normal, and bounces it if it moves into the collider
+void RespondToCollision(float3 normal, float depth, inout Particle particle)
+{
+    particle.position += normal * depth;
+    float normalSpeed = dot(particle.velocity, normal);
+    if (normalSpeed < 0.0)
+    {
+        float3 tangential = particle.velocity - normal * normalSpeed;
+        particle.velocity = normal * (-normalSpeed * restitution) + tangential * (1.0 - friction);
+    }
+}
+
+// Same tests and response as Collide in ParticleSimulation.cpp
+void Collide(float3 previousPosition, inout Particle particle)
+{
+    for (uint plane = 0; plane < planeColliderCount; ++plane)
+    {
+        float4 equation = particleColliders[plane * 3];
+        float4 tangentU = particleColliders[plane * 3 + 1];
+        float4 tangentV = particleColliders[plane * 3 + 2];
+        float4 position = float4(particle.position, 1.0);
+        float distance = dot(position, equation);
+        // only crossings from the front, within the rectangle
+        if (distance < particleRadius && dot(float4(previousPosition, 1.0), equation) >= 0.0 &&
+            abs(dot(position, tangentU)) <= 1.0 && abs(dot(position, tangentV)) <= 1.0)
+        {
+            RespondToCollision(equation.xyz, particleRadius - distance, particle);
+        }
+    }
+
+    for (uint sphere = 0; sphere < sphereColliderCount; ++sphere)
+    {
+        float4 centerAndRadius = particleColliders[planeColliderCount * 3 + sphere];
+        float3 offset = particle.position - centerAndRadius.xyz;
+        float reach = centerAndRadius.w + particleRadius;
+        float distanceSquared = dot(offset, offset);
+        if (distanceSquared < reach * reach)
+        {
+            // a particle at the very center leaves upwards
+            float distance = sqrt(distanceSquared);
+            float3 normal = distance > 0.0 ? offset / distance : float3(0.0, 1.0, 0.0);
+            RespondToCollision(normal, reach - distance, particle);
+        }
+    }
+}
+
+// Integrates the current alive list, appending survivors to the other list and the dead to the dead list.
+// Dispatched indirectly with the group count BuildArguments derived from the alive count.
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void main(uint3 dispatchThreadID : SV_DispatchThreadID)
 {
-    float3 position;
-    float3 velocity;
-    float3 force;
-    float4 color;
-    float lifetime;
-    float age;    
-};
-
-StructuredBuffer<Particle> particlesInput : register(t0, space2);
-RWStructuredBuffer<Particle> particlesOutput : register(u0);
-
-[numthreads(64, 1, 1)]
-void main(int3 dispatchThreadID : SV_DispatchThreadID)
+    uint aliveCount = particleLists.Load(ALIVE_COUNT_OFFSET + aliveListIndex * 4);
+    if (dispatchThreadID.x >= aliveCount) return;
+
+    uint index = particleLists.Load(GetAliveListOffset(aliveListIndex) + dispatchThreadID.x * 4);
+    Particle particle = particles[index];
+
+    // same substeps and operation order as ParticleSimulation::Step
+    float substepTime = deltaTime / substepCount;
+    float halfSubstepTime2 = 0.5 * substepTime * substepTime;
+    for (uint substep = 0; substep < substepCount; ++substep)
+    {
+        float3 previousPosition = particle.position;
+        particle.age += substepTime;
+        particle.position += particle.velocity * substepTime;
+        if (integrator == INTEGRATOR_VERLET)
+        {
+            particle.position += particle.force * halfSubstepTime2;
+        }
+        particle.velocity += particle.force * substepTime;
+        Collide(previousPosition, particle);
+    }
+    particles[index] = particle;
+
+    uint slot;
+    if (particle.age < particle.lifetime)
+    {
+        uint nextList = 1 - aliveListIndex;
+        particleLists.InterlockedAdd(ALIVE_COUNT_OFFSET + nextList * 4, 1, slot);
+        particleLists.Store(GetAliveListOffset(nextList) + slot * 4, index);
+    }
+    else
+    {
+        particleLists.InterlockedAdd(DEAD_COUNT_OFFSET, 1, slot);
+        particleLists.Store(GetDeadListOffset() + slot * 4, index);
+    }
+}
+
+// Brings spawnCount dead particles to life at the emitter after the update, appending them to the next alive list
+[numthreads(THREAD_GROUP_SIZE, 1, 1)]
+void Emit(uint3 dispatchThreadID : SV_DispatchThreadID)
 {
-    Particle particle = particlesInput[dispatchThreadID.x];
+    uint spawn = dispatchThreadID.x;
+    if (spawn >= spawnCount) return;
 
-    // For simplicity, assume deltaTime is 0.016 seconds
-    float deltaTime = 0.016f;
-    particle.age += 0.016f;
-    particle.position += particle.velocity * deltaTime;
-    particle.velocity += particle.force * deltaTime;
+    // only pops happen during this pass, so a thread that finds the list empty just puts its decrement back
+    uint deadCount;
+    particleLists.InterlockedAdd(DEAD_COUNT_OFFSET, -1, deadCount);
+    if (deadCount == 0 || deadCount > capacity)
+    {
+        particleLists.InterlockedAdd(DEAD_COUNT_OFFSET, 1);
+        return;
+    }
+    uint index = particleLists.Load(GetDeadListOffset() + (deadCount - 1) * 4);
 
-    particlesOutput[dispatchThreadID.x] = particle;
-}
\ No newline at end of file
+    // same draws in the same order as ParticleSimulation::Spawn
+    uint random = SeedRandom(seed ^ (spawn * 0x9E3779B9));
+    Particle particle;
+    particle.position = emitterPosition;
+    particle.velocity.x = NextRandomFloat(random);
+    particle.velocity.y = 1.0 + NextRandomFloat(random);
+    particle.velocity.z = NextRandomFloat(random);
+    particle.force = float3(0.0, -9.81, 0.0);
+    particle.color.r = NextRandomFloat(random);
+    particle.color.g = NextRandomFloat(random);
+    particle.color.b = NextRandomFloat(random);
+    particle.color.a = 1.0;
+    particle.lifetime = NextRandom(random) % 10 + 1;
+    particle.age = 0.0;
+    particles[index] = particle;
+
+    uint nextList = 1 - aliveListIndex;
+    uint aliveSlot;
+    particleLists.InterlockedAdd(ALIVE_COUNT_OFFSET + nextList * 4, 1, aliveSlot);
+    particleLists.Store(GetAliveListOffset(nextList) + aliveSlot * 4, index);
+}
+
+// One thread: sizes the draw and the next update for the new alive list, and empties the one just consumed
+[numthreads(1, 1, 1)]
+void BuildArguments()
+{
+    uint nextList = 1 - aliveListIndex;
+    uint aliveCount = particleLists.Load(ALIVE_COUNT_OFFSET + nextList * 4);
+    particleLists.Store4(DRAW_ARGUMENTS_OFFSET, uint4(1, aliveCount, 0, 0));
+    particleLists.Store3(DISPATCH_ARGUMENTS_OFFSET, uint3((aliveCount + THREAD_GROUP_SIZE - 1) / THREAD_GROUP_SIZE, 1, 1));
+    particleLists.Store(ALIVE_COUNT_OFFSET + aliveListIndex * 4, 0);
+}
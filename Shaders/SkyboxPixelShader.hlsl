@@ -1,4 +1,7 @@
+#include "Common.hlsl"
+
 TextureCube<float4> skyCube : register(t9);
+TextureCube<float4> skyCubeNext : register(t12);	// incoming environment, weighted by environmentBlend
 SamplerState g_sampler : register(s0);
 
 struct PixelIn
@@ -9,5 +12,10 @@ struct PixelIn
 
 float4 main(PixelIn pIn) : SV_TARGET
 {
-	return skyCube.Sample(g_sampler, pIn.texCoord);
+	float4 color = skyCube.Sample(g_sampler, pIn.texCoord);
+	if (environmentBlend > 0.0)
+	{
+		color = lerp(color, skyCubeNext.Sample(g_sampler, pIn.texCoord), environmentBlend);
+	}
+	return color;
 }
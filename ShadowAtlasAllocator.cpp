@@ -0,0 +1,299 @@
+#include "ShadowAtlasAllocator.h"
+
+#include <algorithm>
+
+#include "Utils/Logger.h"
+
+using namespace std;
+
+namespace Lunar
+{
+void ShadowAtlasAllocator::Initialize(uint32_t atlasSize, uint32_t minTileSize, uint32_t maxTileSize)
+{
+	m_atlasSize = atlasSize;
+	m_minTileSize = minTileSize;
+	m_maxTileSize = min(maxTileSize, atlasSize);
+
+	m_levelCount = 1;
+	while ((atlasSize >> m_levelCount) >= minTileSize) ++m_levelCount;
+
+	m_levelOffsets.resize(m_levelCount);
+	uint32_t nodeCount = 0;
+	for (uint32_t level = 0; level < m_levelCount; ++level)
+	{
+		m_levelOffsets[level] = nodeCount;
+		nodeCount += 1u << (2 * level);
+	}
+	m_nodeLevels.resize(nodeCount);
+	for (uint32_t level = 0; level < m_levelCount; ++level)
+	{
+		fill(m_nodeLevels.begin() + m_levelOffsets[level], m_nodeLevels.begin() + m_levelOffsets[level] + (1u << (2 * level)), level);
+	}
+	m_freeListPositions.resize(nodeCount);
+	Clear();
+	LOG_DEBUG("Shadow atlas: ", atlasSize, "x", atlasSize, ", tiles ", minTileSize, " to ", m_maxTileSize);
+}
+
+void ShadowAtlasAllocator::Clear()
+{
+	m_nodeStates.assign(m_nodeLevels.size(), NodeState::Covered);
+	m_freeNodes.assign(m_levelCount, {});
+	m_allocations.clear();
+	m_stats = {};
+	m_nodeStates[0] = NodeState::Free;
+	PushFree(0);
+}
+
+const ShadowAtlasAllocation* ShadowAtlasAllocator::FindAllocation(uint32_t lightId) const
+{
+	auto it = m_allocations.find(lightId);
+	return it != m_allocations.end() ? &it->second : nullptr;
+}
+
+uint32_t ShadowAtlasAllocator::ComputeTileSize(float importance) const
+{
+	float requested = importance * static_cast<float>(m_maxTileSize);
+	uint32_t tileSize = m_minTileSize;
+	while (tileSize < m_maxTileSize && static_cast<float>(tileSize * 2) <= requested) tileSize *= 2;
+	return tileSize;
+}
+
+void ShadowAtlasAllocator::Update(const vector<ShadowAtlasRequest>& requests)
+{
+	m_stats = {};
+
+	// lights without importance are treated as not requested
+	m_order.clear();
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		if (requests[i].importance > 0.0f) m_order.push_back(i);
+	}
+	sort(m_order.begin(), m_order.end(), [&requests](uint32_t a, uint32_t b)
+	{
+		if (requests[a].importance != requests[b].importance) return requests[a].importance > requests[b].importance;
+		return requests[a].lightId < requests[b].lightId;
+	});
+
+	// give back the tiles of lights that are gone
+	unordered_set<uint32_t> requestedIds;
+	requestedIds.reserve(m_order.size());
+	for (uint32_t requestIndex : m_order)
+	{
+		requestedIds.insert(requests[requestIndex].lightId);
+	}
+	for (auto it = m_allocations.begin(); it != m_allocations.end();)
+	{
+		if (requestedIds.count(it->first))
+		{
+			++it;
+			continue;
+		}
+		for (uint32_t face = 0; face < it->second.faceCount; ++face) FreeNode(it->second.nodes[face]);
+		it = m_allocations.erase(it);
+		++m_stats.releasedCount;
+	}
+
+	// When the requests add up to more than the atlas, every tile shrinks by the same number of steps so the
+	// space is shared out before the least important lights have to go without
+	uint64_t atlasArea = static_cast<uint64_t>(m_atlasSize) * m_atlasSize;
+	uint32_t minLevel = m_levelCount - 1;
+	m_levelBias = 0;
+	for (; m_levelBias < minLevel; ++m_levelBias)
+	{
+		uint64_t demand = 0;
+		for (uint32_t requestIndex : m_order)
+		{
+			uint64_t tileSize = m_atlasSize >> min(GetLevel(ComputeTileSize(requests[requestIndex].importance)) + m_levelBias, minLevel);
+			demand += requests[requestIndex].faceCount * tileSize * tileSize;
+			if (demand > atlasArea) break;
+		}
+		if (demand <= atlasArea) break;
+	}
+
+	// keep tiles within one size step of the desired one, free the rest for reallocation
+	m_pending.clear();
+	for (uint32_t orderIndex = 0; orderIndex < m_order.size(); ++orderIndex)
+	{
+		const ShadowAtlasRequest& request = requests[m_order[orderIndex]];
+		auto it = m_allocations.find(request.lightId);
+		if (it != m_allocations.end())
+		{
+			uint32_t desiredLevel = GetDesiredLevel(request.importance);
+			uint32_t currentLevel = m_nodeLevels[it->second.nodes[0]];
+			uint32_t levelDistance = desiredLevel > currentLevel ? desiredLevel - currentLevel : currentLevel - desiredLevel;
+			if (it->second.faceCount == request.faceCount && levelDistance <= 1)
+			{
+				it->second.importance = request.importance;
+				++m_stats.keptCount;
+				continue;
+			}
+			Release(request.lightId);
+		}
+		m_pending.push_back(orderIndex);
+	}
+
+	// most important first; when nothing fits, take tiles from the least important holders
+	uint32_t evictCursor = static_cast<uint32_t>(m_order.size());
+	uint32_t failedFaceCount = UINT32_MAX;	// once nothing is left to evict, requests this large cannot fit either
+	for (uint32_t orderIndex : m_pending)
+	{
+		const ShadowAtlasRequest& request = requests[m_order[orderIndex]];
+		if (request.faceCount >= failedFaceCount)
+		{
+			++m_stats.failedCount;
+			continue;
+		}
+
+		uint32_t desiredLevel = GetDesiredLevel(request.importance);
+		bool allocated = false;
+		while (!allocated)
+		{
+			for (uint32_t level = desiredLevel; level < m_levelCount && !allocated; ++level)
+			{
+				allocated = TryAllocate(request.lightId, request.faceCount, level, request.importance);
+			}
+			if (allocated) break;
+
+			while (evictCursor > orderIndex + 1 && !m_allocations.count(requests[m_order[evictCursor - 1]].lightId)) --evictCursor;
+			if (evictCursor <= orderIndex + 1) break;
+			Release(requests[m_order[--evictCursor]].lightId);
+			++m_stats.evictedCount;
+		}
+
+		if (allocated)
+		{
+			++m_stats.allocatedCount;
+		}
+		else
+		{
+			++m_stats.failedCount;
+			failedFaceCount = min(failedFaceCount, request.faceCount);
+		}
+	}
+}
+
+uint32_t ShadowAtlasAllocator::GetDesiredLevel(float importance) const
+{
+	return min(GetLevel(ComputeTileSize(importance)) + m_levelBias, m_levelCount - 1);
+}
+
+uint32_t ShadowAtlasAllocator::GetLevel(uint32_t tileSize) const
+{
+	uint32_t level = 0;
+	while ((m_atlasSize >> level) > tileSize) ++level;
+	return min(level, m_levelCount - 1);
+}
+
+ShadowAtlasTile ShadowAtlasAllocator::GetTile(uint32_t node) const
+{
+	uint32_t level = m_nodeLevels[node];
+	uint32_t local = node - m_levelOffsets[level];
+	uint32_t size = m_atlasSize >> level;
+	return { (local & ((1u << level) - 1)) * size, (local >> level) * size, size };
+}
+
+uint32_t ShadowAtlasAllocator::AllocateNode(uint32_t level)
+{
+	if (!m_freeNodes[level].empty())
+	{
+		uint32_t node = m_freeNodes[level].back();
+		RemoveFree(node);
+		m_nodeStates[node] = NodeState::Used;
+		return node;
+	}
+	if (level == 0) return UINT32_MAX;
+
+	// split a free node of the next larger size, hand out its first child and free the other three
+	uint32_t parent = AllocateNode(level - 1);
+	if (parent == UINT32_MAX) return UINT32_MAX;
+	m_nodeStates[parent] = NodeState::Split;
+
+	uint32_t local = parent - m_levelOffsets[level - 1];
+	uint32_t x = (local & ((1u << (level - 1)) - 1)) * 2;
+	uint32_t y = (local >> (level - 1)) * 2;
+	uint32_t first = GetNodeIndex(level, x, y);
+	for (uint32_t child : { GetNodeIndex(level, x + 1, y), GetNodeIndex(level, x, y + 1), GetNodeIndex(level, x + 1, y + 1) })
+	{
+		m_nodeStates[child] = NodeState::Free;
+		PushFree(child);
+	}
+	m_nodeStates[first] = NodeState::Used;
+	return first;
+}
+
+void ShadowAtlasAllocator::FreeNode(uint32_t node)
+{
+	uint32_t level = m_nodeLevels[node];
+	if (level > 0)
+	{
+		uint32_t local = node - m_levelOffsets[level];
+		uint32_t x = (local & ((1u << level) - 1)) & ~1u;
+		uint32_t y = (local >> level) & ~1u;
+		uint32_t siblings[4] = { GetNodeIndex(level, x, y), GetNodeIndex(level, x + 1, y), GetNodeIndex(level, x, y + 1), GetNodeIndex(level, x + 1, y + 1) };
+
+		bool mergeable = true;
+		for (uint32_t sibling : siblings)
+		{
+			if (sibling != node && m_nodeStates[sibling] != NodeState::Free) mergeable = false;
+		}
+		if (mergeable)
+		{
+			// all four quarters are free again, so the parent takes their place
+			for (uint32_t sibling : siblings)
+			{
+				if (sibling != node) RemoveFree(sibling);
+				m_nodeStates[sibling] = NodeState::Covered;
+			}
+			FreeNode(GetNodeIndex(level - 1, x / 2, y / 2));
+			return;
+		}
+	}
+	m_nodeStates[node] = NodeState::Free;
+	PushFree(node);
+}
+
+void ShadowAtlasAllocator::PushFree(uint32_t node)
+{
+	vector<uint32_t>& freeNodes = m_freeNodes[m_nodeLevels[node]];
+	m_freeListPositions[node] = static_cast<uint32_t>(freeNodes.size());
+	freeNodes.push_back(node);
+}
+
+void ShadowAtlasAllocator::RemoveFree(uint32_t node)
+{
+	vector<uint32_t>& freeNodes = m_freeNodes[m_nodeLevels[node]];
+	uint32_t position = m_freeListPositions[node];
+	freeNodes[position] = freeNodes.back();
+	m_freeListPositions[freeNodes[position]] = position;
+	freeNodes.pop_back();
+}
+
+bool ShadowAtlasAllocator::TryAllocate(uint32_t lightId, uint32_t faceCount, uint32_t level, float importance)
+{
+	// point lights need every face at the same size, so a partial allocation is rolled back
+	ShadowAtlasAllocation allocation = {};
+	allocation.faceCount = faceCount;
+	allocation.importance = importance;
+	for (uint32_t face = 0; face < faceCount; ++face)
+	{
+		uint32_t node = AllocateNode(level);
+		if (node == UINT32_MAX)
+		{
+			for (uint32_t i = 0; i < face; ++i) FreeNode(allocation.nodes[i]);
+			return false;
+		}
+		allocation.nodes[face] = node;
+		allocation.tiles[face] = GetTile(node);
+	}
+	m_allocations[lightId] = allocation;
+	return true;
+}
+
+void ShadowAtlasAllocator::Release(uint32_t lightId)
+{
+	auto it = m_allocations.find(lightId);
+	if (it == m_allocations.end()) return;
+	for (uint32_t face = 0; face < it->second.faceCount; ++face) FreeNode(it->second.nodes[face]);
+	m_allocations.erase(it);
+}
+} // namespace Lunar
@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace Lunar
+{
+// A light asking for shadow map space this frame
+struct ShadowAtlasRequest
+{
+	uint32_t lightId;		// stable across frames, e.g. a LightHandle id
+	uint32_t faceCount;		// 1 for spot lights, 6 for point light cube faces
+	float    importance;	// screen-space size of the light, higher is allocated first
+};
+
+// Square tile in atlas texels
+struct ShadowAtlasTile
+{
+	uint32_t x;
+	uint32_t y;
+	uint32_t size;
+};
+
+struct ShadowAtlasAllocation
+{
+	uint32_t        faceCount;
+	uint32_t        nodes[6];		// quadtree node per face
+	ShadowAtlasTile tiles[6];
+	float           importance;
+};
+
+struct ShadowAtlasStats
+{
+	uint32_t keptCount = 0;			// allocations reused from the previous frame
+	uint32_t allocatedCount = 0;	// new or resized allocations
+	uint32_t evictedCount = 0;		// allocations taken away for a more important light
+	uint32_t releasedCount = 0;		// allocations of lights no longer requested
+	uint32_t failedCount = 0;		// requests left without space
+};
+
+// Packs power-of-two shadow tiles into one square atlas with a quadtree buddy allocator.
+// Tile sizes follow the importance of the light and all shrink together when the atlas is oversubscribed.
+// Allocations are kept across frames while their size stays within one step of the desired one, so tiles
+// only move when a light's importance changes a lot. When the atlas is full, the least important lights
+// give up their tiles first.
+class ShadowAtlasAllocator
+{
+public:
+	void Initialize(uint32_t atlasSize, uint32_t minTileSize, uint32_t maxTileSize);
+
+	void Update(const std::vector<ShadowAtlasRequest>& requests);
+	void Clear();
+
+	// nullptr when the light has no tiles this frame
+	const ShadowAtlasAllocation* FindAllocation(uint32_t lightId) const;
+	const std::unordered_map<uint32_t, ShadowAtlasAllocation>& GetAllocations() const { return m_allocations; }
+	const ShadowAtlasStats& GetStats() const { return m_stats; }
+	uint32_t GetAtlasSize() const { return m_atlasSize; }
+
+	// Power-of-two tile size for an importance, where an importance of 1 gets the largest tile
+	uint32_t ComputeTileSize(float importance) const;
+
+private:
+	enum class NodeState : uint8_t
+	{
+		Free,
+		Split,
+		Used,
+		Covered		// part of a larger free or used node
+	};
+
+	uint32_t GetLevel(uint32_t tileSize) const;
+	uint32_t GetDesiredLevel(float importance) const;
+	uint32_t GetNodeIndex(uint32_t level, uint32_t x, uint32_t y) const { return m_levelOffsets[level] + y * (1u << level) + x; }
+	ShadowAtlasTile GetTile(uint32_t node) const;
+
+	// returns UINT32_MAX when no node of that level can be made free
+	uint32_t AllocateNode(uint32_t level);
+	void     FreeNode(uint32_t node);
+	void     PushFree(uint32_t node);
+	void     RemoveFree(uint32_t node);
+
+	bool TryAllocate(uint32_t lightId, uint32_t faceCount, uint32_t level, float importance);
+	void Release(uint32_t lightId);
+
+	uint32_t m_atlasSize = 0;
+	uint32_t m_minTileSize = 0;
+	uint32_t m_maxTileSize = 0;
+	uint32_t m_levelCount = 0;		// level 0 is the whole atlas
+	uint32_t m_levelBias = 0;		// steps every tile is shrunk by when the atlas is oversubscribed
+
+	std::vector<uint32_t>              m_levelOffsets;
+	std::vector<uint32_t>              m_nodeLevels;
+	std::vector<NodeState>             m_nodeStates;
+	std::vector<std::vector<uint32_t>> m_freeNodes;			// per level
+	std::vector<uint32_t>              m_freeListPositions;	// node -> position in its free list
+
+	std::unordered_map<uint32_t, ShadowAtlasAllocation> m_allocations;
+	std::vector<uint32_t> m_order;		// request indices sorted by importance
+	std::vector<uint32_t> m_pending;	// positions in m_order still needing tiles
+	ShadowAtlasStats      m_stats;
+};
+} // namespace Lunar
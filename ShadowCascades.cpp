@@ -0,0 +1,154 @@
+#include "ShadowCascades.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include "Utils/MathUtils.h"
+
+using namespace DirectX;
+using namespace std;
+
+namespace Lunar
+{
+void ShadowCascades::ComputeSplitDistances(uint32_t cascadeCount, float nearZ, float farZ, float lambda, float* outSplits)
+{
+	outSplits[0] = nearZ;
+	for (uint32_t i = 1; i < cascadeCount; ++i)
+	{
+		float fraction = static_cast<float>(i) / static_cast<float>(cascadeCount);
+		float logSplit = nearZ * powf(farZ / nearZ, fraction);
+		float uniformSplit = nearZ + (farZ - nearZ) * fraction;
+		outSplits[i] = uniformSplit + (logSplit - uniformSplit) * lambda;
+	}
+	outSplits[cascadeCount] = farZ;
+}
+
+XMFLOAT4X4 ShadowCascades::CreateLightView(const XMFLOAT3& lightDirection)
+{
+	XMVECTOR forward = XMVector3Normalize(XMLoadFloat3(&lightDirection));
+	// fall back to +z as the up vector when the light points straight up or down
+	XMVECTOR up = fabsf(XMVectorGetY(forward)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	XMFLOAT4X4 lightView;
+	XMStoreFloat4x4(&lightView, XMMatrixLookToLH(XMVectorZero(), forward, up));
+	return lightView;
+}
+
+LightSpaceBounds ShadowCascades::ComputeLightSpaceBounds(const BoundingBox* worldBoxes, size_t count, const XMFLOAT4X4& lightView)
+{
+	// The light view is a pure rotation R, so a box maps to a light-space box around c * R with
+	// extents e * |R|. Two independent accumulator pairs keep the min/max chains from serializing.
+	XMMATRIX rotation = XMLoadFloat4x4(&lightView);
+	XMMATRIX absRotation(XMVectorAbs(rotation.r[0]), XMVectorAbs(rotation.r[1]), XMVectorAbs(rotation.r[2]), XMVectorZero());
+
+	XMVECTOR min0 = XMVectorReplicate(FLT_MAX);
+	XMVECTOR max0 = XMVectorReplicate(-FLT_MAX);
+	XMVECTOR min1 = min0;
+	XMVECTOR max1 = max0;
+	size_t i = 0;
+	for (; i + 1 < count; i += 2)
+	{
+		XMVECTOR center0 = XMVector3TransformNormal(XMLoadFloat3(&worldBoxes[i].Center), rotation);
+		XMVECTOR extents0 = XMVector3TransformNormal(XMLoadFloat3(&worldBoxes[i].Extents), absRotation);
+		XMVECTOR center1 = XMVector3TransformNormal(XMLoadFloat3(&worldBoxes[i + 1].Center), rotation);
+		XMVECTOR extents1 = XMVector3TransformNormal(XMLoadFloat3(&worldBoxes[i + 1].Extents), absRotation);
+		min0 = XMVectorMin(min0, XMVectorSubtract(center0, extents0));
+		max0 = XMVectorMax(max0, XMVectorAdd(center0, extents0));
+		min1 = XMVectorMin(min1, XMVectorSubtract(center1, extents1));
+		max1 = XMVectorMax(max1, XMVectorAdd(center1, extents1));
+	}
+	if (i < count)
+	{
+		XMVECTOR center = XMVector3TransformNormal(XMLoadFloat3(&worldBoxes[i].Center), rotation);
+		XMVECTOR extents = XMVector3TransformNormal(XMLoadFloat3(&worldBoxes[i].Extents), absRotation);
+		min0 = XMVectorMin(min0, XMVectorSubtract(center, extents));
+		max0 = XMVectorMax(max0, XMVectorAdd(center, extents));
+	}
+
+	LightSpaceBounds bounds;
+	XMStoreFloat3(&bounds.min, XMVectorMin(min0, min1));
+	XMStoreFloat3(&bounds.max, XMVectorMax(max0, max1));
+	return bounds;
+}
+
+ShadowCascade ShadowCascades::FitCascade(
+	const XMFLOAT4X4& cameraView,
+	float tanHalfFovY,
+	float aspectRatio,
+	float splitNear,
+	float splitFar,
+	const XMFLOAT4X4& lightView,
+	uint32_t resolution,
+	const LightSpaceBounds& casterBounds,
+	const LightSpaceBounds& receiverBounds)
+{
+	ShadowCascade cascade;
+	cascade.view = lightView;
+	cascade.splitNear = splitNear;
+	cascade.splitFar = splitFar;
+
+	// The slice corners sit at (+-z * tanX, +-z * tanY, z). The smallest enclosing sphere centered on the view
+	// axis is equidistant from the near and far corners, unless that center lies beyond the far plane.
+	// Only the split depths and the field of view enter the radius, so it is the same every frame.
+	float tanHalfFovX = tanHalfFovY * aspectRatio;
+	float diagonal2 = tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY;
+	float centerDepth = min(0.5f * (splitFar + splitNear) * (1.0f + diagonal2), splitFar);
+	float farOffset = splitFar - centerDepth;
+	float sphereRadius = sqrtf(farOffset * farOffset + splitFar * splitFar * diagonal2);
+
+	XMMATRIX invCameraView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&cameraView));
+	XMVECTOR centerWS = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, centerDepth, 1.0f), invCameraView);
+	XMVECTOR centerLS = XMVector3TransformCoord(centerWS, XMLoadFloat4x4(&lightView));
+	float sliceNearZ = XMVectorGetZ(centerLS) - sphereRadius;
+	float sliceFarZ = XMVectorGetZ(centerLS) + sphereRadius;
+
+	// A slice wider than the receivers only wastes texels on empty space, so cover the receivers instead.
+	// Their bounds do not move with the camera, which keeps this case as stable as the sphere fit.
+	if (!receiverBounds.IsEmpty())
+	{
+		float receiverRadius = 0.5f * max(receiverBounds.max.x - receiverBounds.min.x, receiverBounds.max.y - receiverBounds.min.y);
+		if (receiverRadius < sphereRadius)
+		{
+			sphereRadius = receiverRadius;
+			centerLS = XMVectorSet(
+				0.5f * (receiverBounds.min.x + receiverBounds.max.x),
+				0.5f * (receiverBounds.min.y + receiverBounds.max.y),
+				XMVectorGetZ(centerLS), 1.0f);
+		}
+	}
+
+	// snapping moves the center by less than a texel, so pad by one texel to keep the slice inside
+	cascade.radius = sphereRadius * static_cast<float>(resolution) / static_cast<float>(resolution - 2);
+
+	// the light view has no translation, so snapping in light space keeps the texel grid fixed in the world
+	float texelSize = 2.0f * cascade.radius / static_cast<float>(resolution);
+	XMVECTOR texel = XMVectorSet(texelSize, texelSize, 1.0f, 1.0f);
+	XMVECTOR snapped = XMVectorMultiply(XMVectorFloor(XMVectorDivide(centerLS, texel)), texel);
+	centerLS = XMVectorSelect(centerLS, snapped, XMVectorSelectControl(1, 1, 0, 0));
+	XMStoreFloat3(&cascade.center, centerLS);
+
+	// depth only has to reach back to the nearest caster and forward to the farthest receiver
+	cascade.nearZ = casterBounds.IsEmpty() ? sliceNearZ : casterBounds.min.z;
+	cascade.farZ = receiverBounds.IsEmpty() ? sliceFarZ : min(sliceFarZ, receiverBounds.max.z);
+	cascade.farZ = max(cascade.farZ, cascade.nearZ + 0.01f);
+
+	XMStoreFloat4x4(&cascade.projection, MathUtils::CreateOrthographicOffCenterLH(
+		cascade.center.x - cascade.radius, cascade.center.x + cascade.radius,
+		cascade.center.y - cascade.radius, cascade.center.y + cascade.radius,
+		cascade.nearZ, cascade.farZ));
+	return cascade;
+}
+
+bool ShadowCascades::IntersectsCascade(const ShadowCascade& cascade, const BoundingSphere& worldBounds)
+{
+	XMFLOAT3 centerLS;
+	XMStoreFloat3(&centerLS, XMVector3TransformCoord(XMLoadFloat3(&worldBounds.Center), XMLoadFloat4x4(&cascade.view)));
+
+	float reach = cascade.radius + worldBounds.Radius;
+	return fabsf(centerLS.x - cascade.center.x) <= reach &&
+		fabsf(centerLS.y - cascade.center.y) <= reach &&
+		centerLS.z + worldBounds.Radius >= cascade.nearZ &&
+		centerLS.z - worldBounds.Radius <= cascade.farZ;
+}
+} // namespace Lunar
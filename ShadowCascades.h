@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+namespace Lunar
+{
+// Axis-aligned box in light space; empty when min > max
+struct LightSpaceBounds
+{
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+	bool IsEmpty() const { return min.x > max.x; }
+};
+
+// One slice of the camera frustum fitted into its own orthographic light projection
+struct ShadowCascade
+{
+	DirectX::XMFLOAT4X4 view;			// row-major, rotation only
+	DirectX::XMFLOAT4X4 projection;		// row-major
+	DirectX::XMFLOAT3   center;			// light space, x and y snapped to whole texels
+	float               radius;			// half the projection width, from the frustum slice or the receivers
+	float               nearZ;			// light-space depth range, from the nearest caster to the farthest receiver
+	float               farZ;
+	float               splitNear;		// camera view depth covered by the cascade
+	float               splitFar;
+};
+
+// CPU-side cascade math for cascaded shadow maps.
+// Each cascade is fitted to the bounding sphere of its frustum slice, so its size does not change when the
+// camera rotates, and its center is snapped to the shadow map texel grid, so moving the camera only ever
+// shifts the projection by whole texels. Together these keep shadow edges from shimmering.
+class ShadowCascades
+{
+public:
+	// Writes cascadeCount + 1 view depths from nearZ to farZ. lambda blends uniform (0) and logarithmic (1) splits.
+	static void ComputeSplitDistances(uint32_t cascadeCount, float nearZ, float farZ, float lambda, float* outSplits);
+
+	// Light view looking along the light direction, centered on the world origin
+	static DirectX::XMFLOAT4X4 CreateLightView(const DirectX::XMFLOAT3& lightDirection);
+
+	// Min/max reduction of world boxes after rotation into the light view
+	static LightSpaceBounds ComputeLightSpaceBounds(const DirectX::BoundingBox* worldBoxes, size_t count, const DirectX::XMFLOAT4X4& lightView);
+
+	// cameraView is row-major, not transposed. The depth range runs from the nearest caster to the farthest
+	// receiver, and a cascade larger than the receivers falls back to covering just the receivers.
+	// Empty bounds leave the sphere fit as is.
+	static ShadowCascade FitCascade(
+		const DirectX::XMFLOAT4X4& cameraView,
+		float                      tanHalfFovY,
+		float                      aspectRatio,
+		float                      splitNear,
+		float                      splitFar,
+		const DirectX::XMFLOAT4X4& lightView,
+		uint32_t                   resolution,
+		const LightSpaceBounds&    casterBounds,
+		const LightSpaceBounds&    receiverBounds);
+
+	// Conservative test of a world-space bounding sphere against the cascade's light-space box
+	static bool IntersectsCascade(const ShadowCascade& cascade, const DirectX::BoundingSphere& worldBounds);
+};
+} // namespace Lunar
@@ -0,0 +1,57 @@
+#include "ShadowDrawList.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+using namespace std;
+
+namespace Lunar
+{
+void ShadowDrawList::Build(const ShadowCascade& cascade, const vector<ShadowCaster>& casters)
+{
+	BuildCulled(casters, [&cascade](const ShadowCaster& caster) { return ShadowCascades::IntersectsCascade(cascade, caster.worldBounds); });
+}
+
+void ShadowDrawList::Build(const BoundingSphere& lightBounds, const vector<ShadowCaster>& casters)
+{
+	BuildCulled(casters, [&lightBounds](const ShadowCaster& caster) { return lightBounds.Intersects(caster.worldBounds); });
+}
+
+template <typename CullTest>
+void ShadowDrawList::BuildCulled(const vector<ShadowCaster>& casters, CullTest isVisible)
+{
+	m_sortedCasters.clear();
+	for (const ShadowCaster& caster : casters)
+	{
+		if (isVisible(caster))
+		{
+			m_sortedCasters.emplace_back(caster.sortKey, caster.index);
+		}
+	}
+	// ties keep the caller's order so the list is the same every frame
+	sort(m_sortedCasters.begin(), m_sortedCasters.end());
+
+	m_drawIndices.resize(m_sortedCasters.size());
+	for (size_t i = 0; i < m_sortedCasters.size(); ++i)
+	{
+		m_drawIndices[i] = m_sortedCasters[i].second;
+	}
+
+	m_stats.candidateCount = static_cast<uint32_t>(casters.size());
+	m_stats.submittedCount = static_cast<uint32_t>(m_drawIndices.size());
+	m_stats.culledCount = m_stats.candidateCount - m_stats.submittedCount;
+}
+
+void ShadowDrawList::Clear()
+{
+	m_sortedCasters.clear();
+	m_drawIndices.clear();
+	m_stats = {};
+}
+
+uint64_t ShadowDrawList::MakeSortKey(uint32_t vertexFormat, uint64_t vertexBufferAddress)
+{
+	// the format picks the pipeline state, so it outranks the buffer; GPU addresses fit in 56 bits
+	return (static_cast<uint64_t>(vertexFormat) << 56) | (vertexBufferAddress & ((1ull << 56) - 1));
+}
+} // namespace Lunar
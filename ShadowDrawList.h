@@ -0,0 +1,50 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXCollision.h>
+
+#include "ShadowCascades.h"
+
+namespace Lunar
+{
+// Shadow caster as seen by the draw list; carries no draw state so lists can be built headless
+struct ShadowCaster
+{
+	DirectX::BoundingSphere worldBounds;
+	uint64_t                sortKey;	// casters with equal keys share pipeline state and vertex buffers
+	uint32_t                index;		// caller's index of the caster
+};
+
+struct ShadowDrawStats
+{
+	uint32_t candidateCount = 0;
+	uint32_t culledCount = 0;
+	uint32_t submittedCount = 0;
+};
+
+// Depth-only draw list of one shadow cascade or shadow atlas tile.
+// Casters outside the shadow volume are dropped and the rest are sorted by key,
+// so consecutive draws of the same mesh only rebind object constants.
+class ShadowDrawList
+{
+public:
+	void Build(const ShadowCascade& cascade, const std::vector<ShadowCaster>& casters);
+	// For local lights; keeps the casters touching the light's range
+	void Build(const DirectX::BoundingSphere& lightBounds, const std::vector<ShadowCaster>& casters);
+	void Clear();
+
+	// Caster indices in draw order
+	const std::vector<uint32_t>& GetDrawIndices() const { return m_drawIndices; }
+	const ShadowDrawStats& GetStats() const { return m_stats; }
+
+	static uint64_t MakeSortKey(uint32_t vertexFormat, uint64_t vertexBufferAddress);
+
+private:
+	template <typename CullTest>
+	void BuildCulled(const std::vector<ShadowCaster>& casters, CullTest isVisible);
+
+	std::vector<std::pair<uint64_t, uint32_t>> m_sortedCasters;	// (sort key, caster index)
+	std::vector<uint32_t>                      m_drawIndices;
+	ShadowDrawStats                            m_stats;
+};
+} // namespace Lunar
@@ -1,5 +1,9 @@
 #include "ShadowManager.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
 #include <d3d12.h>
 
 #include "DescriptorAllocator.h"
@@ -15,19 +19,38 @@ namespace Lunar
 
 void ShadowManager::Initialize(ID3D12Device* device)
 {
-	m_shadowCB = make_unique<ConstantBuffer>(device, sizeof(BasicConstants));
-	m_viewport = { 0.0f, 0.0f, static_cast<float>(m_shadowMapWidth), static_cast<float>(m_shadowMapHeight), 0.0f, 1.0f };
-	m_scissorRect = { 0, 0, static_cast<int>(m_shadowMapWidth), static_cast<int>(m_shadowMapHeight)};
+	for (UINT i = 0; i < LunarConstants::MAX_SHADOW_CASCADES; ++i)
+	{
+		m_shadowCBs[i] = make_unique<ConstantBuffer>(device, sizeof(BasicConstants));
+
+		UINT left = (i % CASCADE_ATLAS_COLUMNS) * m_cascadeResolution;
+		UINT top = (i / CASCADE_ATLAS_COLUMNS) * m_cascadeResolution;
+		m_viewports[i] = { static_cast<float>(left), static_cast<float>(top), static_cast<float>(m_cascadeResolution), static_cast<float>(m_cascadeResolution), 0.0f, 1.0f };
+		m_scissorRects[i] = { static_cast<LONG>(left), static_cast<LONG>(top), static_cast<LONG>(left + m_cascadeResolution), static_cast<LONG>(top + m_cascadeResolution) };
+	}
+
+	m_atlasAllocator.Initialize(LunarConstants::SHADOW_ATLAS_SIZE, LunarConstants::SHADOW_ATLAS_MIN_TILE_SIZE, LunarConstants::SHADOW_ATLAS_MAX_TILE_SIZE);
+	m_atlasTileCBStride = Utils::CalculateConstantBufferByteSize(sizeof(BasicConstants));
+	m_atlasTileCB = make_unique<ConstantBuffer>(device, m_atlasTileCBStride * LunarConstants::MAX_SHADOW_ATLAS_TILES);
+	m_atlasTransformBuffer = make_unique<ConstantBuffer>(device, static_cast<UINT>(sizeof(XMFLOAT4X4) * LunarConstants::MAX_SHADOW_ATLAS_TILES));
+	m_lightShadowTileBuffer = make_unique<ConstantBuffer>(device, static_cast<UINT>(sizeof(int32_t) * LunarConstants::MAX_LIGHT_COUNT));
+	memset(m_lightShadowTileBuffer->GetMappedData(), 0xff, sizeof(int32_t) * LunarConstants::MAX_LIGHT_COUNT);
 	CreateShadowMapTexture(device);
 }
 
 void ShadowManager::CreateShadowMapTexture(ID3D12Device* device)
+{
+	CreateDepthTexture(device, m_shadowMapWidth, m_shadowMapHeight, m_shadowTexture);
+	CreateDepthTexture(device, LunarConstants::SHADOW_ATLAS_SIZE, LunarConstants::SHADOW_ATLAS_SIZE, m_atlasTexture);
+}
+
+void ShadowManager::CreateDepthTexture(ID3D12Device* device, UINT width, UINT height, ComPtr<ID3D12Resource>& texture)
 {
 	D3D12_RESOURCE_DESC texDesc;
 	texDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	texDesc.Alignment = 0;
-	texDesc.Width = m_shadowMapWidth;
-	texDesc.Height = m_shadowMapHeight;
+	texDesc.Width = width;
+	texDesc.Height = height;
 	texDesc.DepthOrArraySize = 1;
 	texDesc.MipLevels = 1;
 	texDesc.Format = DXGI_FORMAT_R24G8_TYPELESS;
@@ -54,7 +77,7 @@ void ShadowManager::CreateShadowMapTexture(ID3D12Device* device)
 		&texDesc,
 		D3D12_RESOURCE_STATE_GENERIC_READ,
 		&clearValue,
-		IID_PPV_ARGS(m_shadowTexture.GetAddressOf())))
+		IID_PPV_ARGS(texture.GetAddressOf())))
 }
 
 void ShadowManager::CreateDSV(ID3D12Device* device, ID3D12DescriptorHeap* dsvHeap)
@@ -70,6 +93,14 @@ void ShadowManager::CreateDSV(ID3D12Device* device, ID3D12DescriptorHeap* dsvHea
 		m_shadowTexture.Get(),
 		&dsvDesc,
 		m_dsvHandle);
+
+	// the light atlas takes the slot after the cascades
+	m_atlasDsvHandle = m_dsvHandle;
+	m_atlasDsvHandle.ptr += device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+	device->CreateDepthStencilView(
+		m_atlasTexture.Get(),
+		&dsvDesc,
+		m_atlasDsvHandle);
 }
 
 void ShadowManager::CreateSRV(ID3D12Device* device, DescriptorAllocator* descriptorAllocator)
@@ -85,52 +116,149 @@ void ShadowManager::CreateSRV(ID3D12Device* device, DescriptorAllocator* descrip
 
 	descriptorAllocator->AllocateDescriptor("ShadowMap");
 	descriptorAllocator->CreateSRV(m_shadowTexture.Get(), &srvDesc, "ShadowMap");
+
+	// must directly follow the cascades, the shadow map range of the root signature holds both
+	descriptorAllocator->AllocateDescriptor("ShadowAtlas");
+	descriptorAllocator->CreateSRV(m_atlasTexture.Get(), &srvDesc, "ShadowAtlas");
 }
 
-void ShadowManager::UpdateShadowCB(const BasicConstants& basicConstants)
+void ShadowManager::UpdateCascades(
+	BasicConstants& basicConstants,
+	const XMFLOAT3& lightDirection,
+	const vector<BoundingBox>& casterBounds,
+	const vector<BoundingBox>& receiverBounds)
 {
-	m_basicConstants = {};
-	// const float* dir = LunarConstants::LIGHT_INFO[0].direction;
-	XMVECTOR lightDir = XMVectorSet(m_posX, m_posY, m_posZ, 0.0f);
-	XMVECTOR lightPos = -2.0f * m_sceneRadius * lightDir;
-
-	// TODO: Refactor
-	// Calculate view matrix
-	XMVECTOR forward = XMVector3Normalize(lightDir);
-	XMVECTOR worldUp = XMVectorSet(0, 1, 0, 0);
-	XMVECTOR right = XMVector3Cross(worldUp, forward);
-	XMVECTOR up = XMVector3Cross(forward, right);
-
-	// inversed rotation matrix (transposed)
-	XMMATRIX inversedRotation = XMMatrixSet(
-		XMVectorGetX(right), XMVectorGetY(right), XMVectorGetZ(right), 0,
-		XMVectorGetX(up), XMVectorGetY(up), XMVectorGetZ(up), 0,
-		XMVectorGetX(forward), XMVectorGetY(forward), XMVectorGetZ(forward), 0,
-		0, 0, 0, 1
-		);
-	
-	XMMATRIX inversedTranslation = XMMatrixTranslation(-XMVectorGetX(lightPos), -XMVectorGetY(lightPos), -XMVectorGetZ(lightPos));
-	
-	XMMATRIX viewMatrix = inversedRotation * inversedTranslation;
-
-	XMFLOAT3 sceneCenterLS; // scene center in light space
-	XMStoreFloat3(&sceneCenterLS, XMVector3TransformCoord(XMLoadFloat3(&m_sceneCenterPosition), viewMatrix));
-
-	// TODO: use calculated min/max values of objects
-	float l = sceneCenterLS.x - m_sceneRadius;
-	float b = sceneCenterLS.y - m_sceneRadius;
-	float n = sceneCenterLS.z - m_sceneRadius;
-	float r = sceneCenterLS.x + m_sceneRadius;
-	float t = sceneCenterLS.y + m_sceneRadius;
-	float f = sceneCenterLS.z + m_sceneRadius;	
-	
-	XMMATRIX projectionMatrix = MathUtils::CreateOrthographicOffCenterLH(l, r, b, t, n, f);
+	// camera matrices are stored transposed; the projection is a perspective LH one
+	XMFLOAT4X4 cameraView;
+	XMFLOAT4X4 cameraProjection;
+	XMStoreFloat4x4(&cameraView, XMMatrixTranspose(XMLoadFloat4x4(&basicConstants.view)));
+	XMStoreFloat4x4(&cameraProjection, XMMatrixTranspose(XMLoadFloat4x4(&basicConstants.projection)));
+	if (cameraProjection._22 == 0.0f) return;	// no camera yet
+
+	float tanHalfFovY = 1.0f / cameraProjection._22;
+	float aspectRatio = cameraProjection._22 / cameraProjection._11;
+	float nearZ = -cameraProjection._43 / cameraProjection._33;
+	float farZ = cameraProjection._43 / (1.0f - cameraProjection._33);
+
+	uint32_t cascadeCount = GetCascadeCount();
+	float splits[LunarConstants::MAX_SHADOW_CASCADES + 1];
+	ShadowCascades::ComputeSplitDistances(cascadeCount, nearZ, min(m_shadowDistance, farZ), m_splitLambda, splits);
+	XMFLOAT4X4 lightView = ShadowCascades::CreateLightView(lightDirection);
+	LightSpaceBounds casters = ShadowCascades::ComputeLightSpaceBounds(casterBounds.data(), casterBounds.size(), lightView);
+	LightSpaceBounds receivers = ShadowCascades::ComputeLightSpaceBounds(receiverBounds.data(), receiverBounds.size(), lightView);
+
 	XMMATRIX ndcToTexture = MathUtils::CreateNDCToTextureTransform();
-	
-	XMStoreFloat4x4(&m_basicConstants.view, XMMatrixTranspose(viewMatrix));
-	XMStoreFloat4x4(&m_basicConstants.projection, XMMatrixTranspose(projectionMatrix));
-	XMStoreFloat4x4(&m_shadowTransform, XMMatrixTranspose(viewMatrix * projectionMatrix * ndcToTexture));
+	float tileScale = static_cast<float>(m_cascadeResolution) / static_cast<float>(m_shadowMapWidth);
+	float cascadeSplits[LunarConstants::MAX_SHADOW_CASCADES];
+	for (uint32_t i = 0; i < LunarConstants::MAX_SHADOW_CASCADES; ++i)
+	{
+		if (i >= cascadeCount)
+		{
+			cascadeSplits[i] = FLT_MAX;
+			continue;
+		}
+
+		m_cascades[i] = ShadowCascades::FitCascade(
+			cameraView, tanHalfFovY, aspectRatio, splits[i], splits[i + 1], lightView, m_cascadeResolution, casters, receivers);
+		cascadeSplits[i] = splits[i + 1];
+
+		XMMATRIX viewMatrix = XMLoadFloat4x4(&m_cascades[i].view);
+		XMMATRIX projectionMatrix = XMLoadFloat4x4(&m_cascades[i].projection);
+		XMMATRIX toTile = XMMatrixScaling(tileScale, tileScale, 1.0f) * XMMatrixTranslation(
+			m_viewports[i].TopLeftX / static_cast<float>(m_shadowMapWidth),
+			m_viewports[i].TopLeftY / static_cast<float>(m_shadowMapHeight),
+			0.0f);
 
-	m_shadowCB->CopyData(&m_basicConstants, sizeof(BasicConstants));
+		BasicConstants cascadeConstants = {};
+		XMStoreFloat4x4(&cascadeConstants.view, XMMatrixTranspose(viewMatrix));
+		XMStoreFloat4x4(&cascadeConstants.projection, XMMatrixTranspose(projectionMatrix));
+		m_shadowCBs[i]->CopyData(&cascadeConstants, sizeof(BasicConstants));
+
+		XMStoreFloat4x4(&basicConstants.shadowTransforms[i], XMMatrixTranspose(viewMatrix * projectionMatrix * ndcToTexture * toTile));
+	}
+
+	basicConstants.cascadeSplits = XMFLOAT4(cascadeSplits);
+	basicConstants.cascadeCount = cascadeCount;
+}
+
+void ShadowManager::UpdateAtlas(const vector<ShadowLightDesc>& lights, uint32_t lightCount)
+{
+	m_atlasRequests.clear();
+	for (const ShadowLightDesc& light : lights)
+	{
+		m_atlasRequests.push_back({ light.lightId, light.isPoint ? 6u : 1u, light.importance });
+	}
+	m_atlasAllocator.Update(m_atlasRequests);
+
+	m_atlasTiles.clear();
+	m_atlasTransforms.clear();
+	m_lightShadowTiles.assign(lightCount, -1);
+	for (const ShadowLightDesc& light : lights)
+	{
+		const ShadowAtlasAllocation* allocation = m_atlasAllocator.FindAllocation(light.lightId);
+		if (!allocation || light.lightIndex >= lightCount) continue;
+
+		m_lightShadowTiles[light.lightIndex] = static_cast<int32_t>(m_atlasTiles.size());
+		BoundingSphere lightBounds(light.position, light.range);
+		XMVECTOR position = XMLoadFloat3(&light.position);
+		float nearZ = min(0.05f, light.range * 0.5f);
+		if (light.isPoint)
+		{
+			// faces in cube map order, the pixel shader picks one by the major axis of the light vector
+			static const XMFLOAT3 faceDirections[6] = { {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1} };
+			static const XMFLOAT3 faceUps[6] = { {0, 1, 0}, {0, 1, 0}, {0, 0, -1}, {0, 0, 1}, {0, 1, 0}, {0, 1, 0} };
+			XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, nearZ, light.range);
+			for (uint32_t face = 0; face < 6; ++face)
+			{
+				XMMATRIX view = XMMatrixLookToLH(position, XMLoadFloat3(&faceDirections[face]), XMLoadFloat3(&faceUps[face]));
+				AddAtlasTile(view, projection, allocation->tiles[face], lightBounds);
+			}
+		}
+		else
+		{
+			XMVECTOR forward = XMVector3Normalize(XMLoadFloat3(&light.direction));
+			XMVECTOR up = fabsf(XMVectorGetY(forward)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+			float fovY = clamp(2.0f * acosf(clamp(light.cosHalfAngle, -1.0f, 1.0f)), 0.1f, XM_PI * 0.9f);
+			AddAtlasTile(XMMatrixLookToLH(position, forward, up), XMMatrixPerspectiveFovLH(fovY, 1.0f, nearZ, light.range), allocation->tiles[0], lightBounds);
+		}
+	}
+
+	// both buffers are write-combined, so they are filled with one sequential copy each
+	if (!m_atlasTransforms.empty())
+	{
+		memcpy(m_atlasTransformBuffer->GetMappedData(), m_atlasTransforms.data(), sizeof(XMFLOAT4X4) * m_atlasTransforms.size());
+	}
+	if (!m_lightShadowTiles.empty())
+	{
+		memcpy(m_lightShadowTileBuffer->GetMappedData(), m_lightShadowTiles.data(), sizeof(int32_t) * m_lightShadowTiles.size());
+	}
+}
+
+void ShadowManager::AddAtlasTile(const XMMATRIX& view, const XMMATRIX& projection, const ShadowAtlasTile& tile, const BoundingSphere& lightBounds)
+{
+	uint32_t tileIndex = static_cast<uint32_t>(m_atlasTiles.size());
+
+	BasicConstants tileConstants = {};
+	XMStoreFloat4x4(&tileConstants.view, XMMatrixTranspose(view));
+	XMStoreFloat4x4(&tileConstants.projection, XMMatrixTranspose(projection));
+	memcpy(static_cast<BYTE*>(m_atlasTileCB->GetMappedData()) + tileIndex * m_atlasTileCBStride, &tileConstants, sizeof(BasicConstants));
+
+	float atlasSize = static_cast<float>(LunarConstants::SHADOW_ATLAS_SIZE);
+	float tileScale = static_cast<float>(tile.size) / atlasSize;
+	XMMATRIX toTile = XMMatrixScaling(tileScale, tileScale, 1.0f) * XMMatrixTranslation(tile.x / atlasSize, tile.y / atlasSize, 0.0f);
+	XMFLOAT4X4 transform;
+	XMStoreFloat4x4(&transform, XMMatrixTranspose(view * projection * MathUtils::CreateNDCToTextureTransform() * toTile));
+	m_atlasTransforms.push_back(transform);
+
+	ShadowAtlasTileInfo info;
+	info.viewport = { static_cast<float>(tile.x), static_cast<float>(tile.y), static_cast<float>(tile.size), static_cast<float>(tile.size), 0.0f, 1.0f };
+	info.scissorRect = { static_cast<LONG>(tile.x), static_cast<LONG>(tile.y), static_cast<LONG>(tile.x + tile.size), static_cast<LONG>(tile.y + tile.size) };
+	info.lightBounds = lightBounds;
+	m_atlasTiles.push_back(info);
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS ShadowManager::GetAtlasTileCBAddress(uint32_t tileIndex) const
+{
+	return m_atlasTileCB->GetResource()->GetGPUVirtualAddress() + static_cast<UINT64>(tileIndex) * m_atlasTileCBStride;
 }
-} // namespace Lunar
\ No newline at end of file
+} // namespace Lunar
@@ -1,14 +1,40 @@
 #pragma once
+#include <array>
 #include <d3d12.h>
 #include <DirectXMath.h>
 #include <memory>
+#include <vector>
 #include <wrl/client.h>
 
 #include "ConstantBuffers.h"
+#include "LunarConstants.h"
+#include "ShadowAtlasAllocator.h"
+#include "ShadowCascades.h"
 
 namespace Lunar
 {
 class DescriptorAllocator;
+
+// A spot or point light asking for a shadow this frame
+struct ShadowLightDesc
+{
+	uint32_t          lightIndex;		// index into the light structured buffer
+	uint32_t          lightId;			// LightHandle id, stable across frames
+	bool              isPoint;			// six cube faces instead of one spot frustum
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 direction;
+	float             range;
+	float             cosHalfAngle;		// spot cone
+	float             importance;		// screen coverage, picks the tile size
+};
+
+// One spot light or point light face rendered into the light atlas
+struct ShadowAtlasTileInfo
+{
+	D3D12_VIEWPORT          viewport;
+	D3D12_RECT              scissorRect;
+	DirectX::BoundingSphere lightBounds;	// casters outside cannot shadow anything the light reaches
+};
 	
 class ShadowManager
 {
@@ -18,33 +44,66 @@ public:
 	void CreateShadowMapTexture(ID3D12Device* device);
 	void CreateDSV(ID3D12Device* device, ID3D12DescriptorHeap* dsvHeap);
 	void CreateSRV(ID3D12Device* device, DescriptorAllocator* descriptorAllocator);
-	void UpdateShadowCB(const BasicConstants& basicConstants);
+	// Refits the cascades to the camera in basicConstants and the world bounds of the scene,
+	// then writes their transforms and splits back into basicConstants
+	void UpdateCascades(
+		BasicConstants& basicConstants,
+		const DirectX::XMFLOAT3& lightDirection,
+		const std::vector<DirectX::BoundingBox>& casterBounds,
+		const std::vector<DirectX::BoundingBox>& receiverBounds);
+	// Packs the lights into the light atlas and writes the per-tile transforms and the light to tile table.
+	// lightCount is the size of the light structured buffer; lights not in the list get no shadow.
+	void UpdateAtlas(const std::vector<ShadowLightDesc>& lights, uint32_t lightCount);
 	ID3D12Resource* GetShadowTexture() const { return m_shadowTexture.Get(); }
-	const D3D12_VIEWPORT& GetViewport() const { return m_viewport; };
-	const D3D12_RECT& GetScissorRect() const { return m_scissorRect; }
+	ID3D12Resource* GetAtlasTexture() const { return m_atlasTexture.Get(); }
+	uint32_t GetCascadeCount() const { return static_cast<uint32_t>(m_cascadeCount); }
+	const ShadowCascade& GetCascade(uint32_t cascadeIndex) const { return m_cascades[cascadeIndex]; }
+	const D3D12_VIEWPORT& GetViewport(uint32_t cascadeIndex) const { return m_viewports[cascadeIndex]; };
+	const D3D12_RECT& GetScissorRect(uint32_t cascadeIndex) const { return m_scissorRects[cascadeIndex]; }
 	const D3D12_CPU_DESCRIPTOR_HANDLE& GetDSVHandle() const { return m_dsvHandle; }
-	const ConstantBuffer* GetShadowCB() const { return m_shadowCB.get(); }
-	const DirectX::XMFLOAT4X4& GetShadowTransform() const { return m_shadowTransform; }
+	const ConstantBuffer* GetShadowCB(uint32_t cascadeIndex) const { return m_shadowCBs[cascadeIndex].get(); }
+	uint32_t GetAtlasTileCount() const { return static_cast<uint32_t>(m_atlasTiles.size()); }
+	const ShadowAtlasTileInfo& GetAtlasTile(uint32_t tileIndex) const { return m_atlasTiles[tileIndex]; }
+	const D3D12_CPU_DESCRIPTOR_HANDLE& GetAtlasDSVHandle() const { return m_atlasDsvHandle; }
+	D3D12_GPU_VIRTUAL_ADDRESS GetAtlasTileCBAddress(uint32_t tileIndex) const;
+	D3D12_GPU_VIRTUAL_ADDRESS GetAtlasTransformBufferAddress() const { return m_atlasTransformBuffer->GetResource()->GetGPUVirtualAddress(); }
+	D3D12_GPU_VIRTUAL_ADDRESS GetLightShadowTileBufferAddress() const { return m_lightShadowTileBuffer->GetResource()->GetGPUVirtualAddress(); }
+	const ShadowAtlasStats& GetAtlasStats() const { return m_atlasAllocator.GetStats(); }
 private:
+	void CreateDepthTexture(ID3D12Device* device, UINT width, UINT height, Microsoft::WRL::ComPtr<ID3D12Resource>& texture);
+	void AddAtlasTile(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection, const ShadowAtlasTile& tile, const DirectX::BoundingSphere& lightBounds);
+
+	// cascades are tiles of one atlas, two per row
+	static constexpr UINT CASCADE_ATLAS_COLUMNS = 2;
+
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_shadowTexture;
-	UINT m_shadowMapWidth = 1024;
-	UINT m_shadowMapHeight = 1024;
-	DirectX::XMFLOAT3 m_sceneCenterPosition = { 0.0f, 0.0f, 0.0f };
-	float m_sceneRadius = 10.0f;
-	DirectX::XMFLOAT4X4 m_shadowTransform;
+	UINT m_cascadeResolution = 1024;
+	UINT m_shadowMapWidth = 2048;
+	UINT m_shadowMapHeight = 2048;
 
-	D3D12_CPU_DESCRIPTOR_HANDLE m_dsvHandle;
+	int   m_cascadeCount = LunarConstants::MAX_SHADOW_CASCADES;
+	float m_shadowDistance = 60.0f;		// clamped to the camera far plane
+	float m_splitLambda = 0.75f;		// 0 uniform, 1 logarithmic
 
-	D3D12_VIEWPORT m_viewport;
-	D3D12_RECT m_scissorRect;
+	D3D12_CPU_DESCRIPTOR_HANDLE m_dsvHandle;
 
-	BasicConstants m_basicConstants;
-	std::unique_ptr<ConstantBuffer> m_shadowCB;
+	std::array<ShadowCascade, LunarConstants::MAX_SHADOW_CASCADES>                   m_cascades = {};
+	std::array<D3D12_VIEWPORT, LunarConstants::MAX_SHADOW_CASCADES>                  m_viewports = {};
+	std::array<D3D12_RECT, LunarConstants::MAX_SHADOW_CASCADES>                      m_scissorRects = {};
+	std::array<std::unique_ptr<ConstantBuffer>, LunarConstants::MAX_SHADOW_CASCADES> m_shadowCBs;
 
-	// debugging
-	float m_posX = 0.57f;
-	float m_posY = -0.58f;
-	float m_posZ = 0.58f;
+	// spot and point lights share one atlas, separate from the cascades
+	Microsoft::WRL::ComPtr<ID3D12Resource> m_atlasTexture;
+	D3D12_CPU_DESCRIPTOR_HANDLE            m_atlasDsvHandle;
+	ShadowAtlasAllocator                   m_atlasAllocator;
+	std::vector<ShadowAtlasRequest>        m_atlasRequests;
+	std::vector<ShadowAtlasTileInfo>       m_atlasTiles;
+	std::vector<DirectX::XMFLOAT4X4>       m_atlasTransforms;		// world to atlas texture space, transposed
+	std::vector<int32_t>                   m_lightShadowTiles;		// first tile per light, -1 without a shadow
+	std::unique_ptr<ConstantBuffer>        m_atlasTileCB;			// view and projection per tile at a CBV stride
+	std::unique_ptr<ConstantBuffer>        m_atlasTransformBuffer;
+	std::unique_ptr<ConstantBuffer>        m_lightShadowTileBuffer;
+	UINT                                   m_atlasTileCBStride = 0;
 };
 	
 } // namespace Lunar
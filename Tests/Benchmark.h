@@ -0,0 +1,24 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+// Timing helpers for the benchmark executables, which print their timings rather than check anything
+namespace Lunar::Tests
+{
+// Median wall time of repetitions calls to func, in milliseconds, after one warm-up call
+template<typename Func>
+double MeasureMilliseconds(int repetitions, Func&& func)
+{
+	func();
+	std::vector<double> times(repetitions);
+	for (double& time : times)
+	{
+		auto start = std::chrono::steady_clock::now();
+		func();
+		time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	std::nth_element(times.begin(), times.begin() + repetitions / 2, times.end());
+	return times[repetitions / 2];
+}
+} // namespace Lunar::Tests
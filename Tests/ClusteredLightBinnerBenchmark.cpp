@@ -0,0 +1,53 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ClusteredLightBinner.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Time to bin 1k to 16k point and spot lights scattered in front of the camera into the default 16x9x24 grid,
+// with the size of the index list the pixel shader walks
+int main()
+{
+	ClusterGridDesc desc = {};
+	desc.fovAngleY = XMConvertToRadians(45.0f);
+	desc.aspectRatio = 16.0f / 9.0f;
+	desc.nearZ = 0.1f;
+	desc.farZ = 100.0f;
+	ClusteredLightBinner binner;
+	binner.Initialize(desc);
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(-3.5f, 0.5f, -3.5f, 1.0f), XMVectorSet(0.3f, -0.1f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+
+	mt19937 random(7);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	printf("%6s %9s %12s %12s %12s\n", "lights", "bin ms", "indices", "avg/cluster", "max/cluster");
+	for (size_t lightCount : { 1000u, 2000u, 4000u, 8000u, 16000u })
+	{
+		vector<ClusterLight> lights(lightCount);
+		for (ClusterLight& light : lights)
+		{
+			light.position = { uniform(random) * 40.0f, uniform(random) * 10.0f, uniform(random) * 40.0f + 30.0f };
+			light.range = 1.5f + 2.5f * (uniform(random) + 1.0f);
+			XMStoreFloat3(&light.direction, XMVector3Normalize(XMVectorSet(uniform(random), uniform(random), uniform(random), 0.0f)));
+			light.cosHalfAngle = uniform(random) > 0.0f ? ClusteredLightBinner::ComputeSpotCosHalfAngle(4.0f + 30.0f * (uniform(random) + 1.0f)) : -1.0f;
+		}
+		double time = MeasureMilliseconds(20, [&]() { binner.Bin(lights, view); });
+
+		size_t occupiedCount = 0, maxCount = 0;
+		for (const ClusterRange& cluster : binner.GetClusters())
+		{
+			occupiedCount += cluster.count > 0;
+			maxCount = max<size_t>(maxCount, cluster.count);
+		}
+		printf("%6zu %9.3f %12zu %12.1f %12zu\n", lightCount, time, binner.GetLightIndices().size(),
+			static_cast<double>(binner.GetLightIndices().size()) / max<size_t>(occupiedCount, 1), maxCount);
+	}
+	return 0;
+}
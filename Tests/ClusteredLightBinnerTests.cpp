@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "ClusteredLightBinner.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+ClusterGridDesc CreateDesc()
+{
+	ClusterGridDesc desc = {};
+	desc.fovAngleY = XMConvertToRadians(45.0f);
+	desc.aspectRatio = 16.0f / 9.0f;
+	desc.nearZ = 0.1f;
+	desc.farZ = 100.0f;
+	return desc;
+}
+
+XMFLOAT4X4 CreateView()
+{
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(XMVectorSet(-3.5f, 0.5f, -3.5f, 1.0f), XMVectorSet(0.3f, -0.1f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+	return view;
+}
+
+// GetClusterIndex in Common.hlsl
+uint32_t GetShaderClusterIndex(const ClusteredLightBinner& binner, const XMMATRIX& projection, FXMVECTOR viewPos)
+{
+	const ClusterGridDesc& desc = binner.GetDesc();
+	XMVECTOR clipPos = XMVector4Transform(viewPos, projection);
+	float ndcX = XMVectorGetX(clipPos) / XMVectorGetW(clipPos);
+	float ndcY = XMVectorGetY(clipPos) / XMVectorGetW(clipPos);
+	uint32_t tileX = min(static_cast<uint32_t>(clamp(ndcX * 0.5f + 0.5f, 0.0f, 1.0f) * desc.tilesX), desc.tilesX - 1);
+	uint32_t tileY = min(static_cast<uint32_t>(clamp(0.5f - ndcY * 0.5f, 0.0f, 1.0f) * desc.tilesY), desc.tilesY - 1);
+	XMFLOAT2 scaleBias = binner.GetSliceScaleBias();
+	float slice = floorf(logf(max(XMVectorGetZ(viewPos), 1e-6f)) * scaleBias.x + scaleBias.y);
+	uint32_t sliceIndex = min(static_cast<uint32_t>(max(slice, 0.0f)), desc.slices - 1);
+	return binner.GetClusterIndex(tileX, tileY, sliceIndex);
+}
+
+vector<ClusterLight> CreateRandomLights(size_t count, uint32_t seed)
+{
+	mt19937 random(seed);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	vector<ClusterLight> lights(count);
+	for (ClusterLight& light : lights)
+	{
+		light.position = { uniform(random) * 20.0f, uniform(random) * 5.0f, uniform(random) * 20.0f + 15.0f };
+		light.range = 1.0f + 2.0f * (uniform(random) + 1.0f);
+		XMStoreFloat3(&light.direction, XMVector3Normalize(XMVectorSet(uniform(random), uniform(random), uniform(random), 0.0f)));
+		light.cosHalfAngle = uniform(random) > 0.0f ? ClusteredLightBinner::ComputeSpotCosHalfAngle(4.0f + 30.0f * (uniform(random) + 1.0f)) : -1.0f;
+	}
+	return lights;
+}
+
+bool IsLit(const ClusterLight& light, FXMVECTOR worldPos)
+{
+	XMVECTOR toPoint = XMVectorSubtract(worldPos, XMLoadFloat3(&light.position));
+	if (XMVectorGetX(XMVector3Length(toPoint)) > light.range) return false;
+	if (light.cosHalfAngle <= -1.0f) return true;
+	return XMVectorGetX(XMVector3Dot(XMVector3Normalize(toPoint), XMLoadFloat3(&light.direction))) >= light.cosHalfAngle;
+}
+}
+
+TEST_CASE(ClusterRangesPartitionTheIndexList)
+{
+	ClusteredLightBinner binner;
+	binner.Initialize(CreateDesc());
+	vector<ClusterLight> lights = CreateRandomLights(500, 3);
+	binner.Bin(lights, CreateView());
+
+	const vector<ClusterRange>& clusters = binner.GetClusters();
+	const vector<uint32_t>& lightIndices = binner.GetLightIndices();
+	CHECK(clusters.size() == binner.GetClusterCount());
+	CHECK(!lightIndices.empty());
+	uint32_t expectedOffset = 0;
+	bool contiguous = true, sorted = true, inRange = true;
+	for (const ClusterRange& cluster : clusters)
+	{
+		contiguous &= cluster.offset == expectedOffset;
+		expectedOffset = cluster.offset + cluster.count;
+		if (expectedOffset > lightIndices.size()) break;
+		const uint32_t* first = lightIndices.data() + cluster.offset;
+		sorted &= is_sorted(first, first + cluster.count) && adjacent_find(first, first + cluster.count) == first + cluster.count;
+		inRange &= all_of(first, first + cluster.count, [&](uint32_t index) { return index < lights.size(); });
+	}
+	CHECK(contiguous);
+	CHECK(expectedOffset == lightIndices.size());
+	CHECK(sorted);
+	CHECK(inRange);
+}
+
+// Every point a light reaches must find the light in the cluster the pixel shader looks it up in
+TEST_CASE(BinningIsConservativeForTheShaderClusterLookup)
+{
+	ClusteredLightBinner binner;
+	const ClusterGridDesc desc = CreateDesc();
+	binner.Initialize(desc);
+	vector<ClusterLight> lights = CreateRandomLights(300, 7);
+	const XMFLOAT4X4 view = CreateView();
+	binner.Bin(lights, view);
+
+	const XMMATRIX projection = XMMatrixPerspectiveFovLH(desc.fovAngleY, desc.aspectRatio, desc.nearZ, desc.farZ);
+	const XMMATRIX inverseView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&view));
+	const float tanHalfFov = tanf(desc.fovAngleY * 0.5f);
+	mt19937 random(11);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	size_t litCount = 0, missCount = 0;
+	for (int sample = 0; sample < 20000; ++sample)
+	{
+		float z = desc.nearZ * powf(desc.farZ / desc.nearZ, (uniform(random) + 1.0f) * 0.5f);
+		XMVECTOR viewPos = XMVectorSet(uniform(random) * tanHalfFov * desc.aspectRatio * z, uniform(random) * tanHalfFov * z, z, 1.0f);
+		XMVECTOR worldPos = XMVector3TransformCoord(viewPos, inverseView);
+		const ClusterRange& cluster = binner.GetClusters()[GetShaderClusterIndex(binner, projection, viewPos)];
+		const uint32_t* first = binner.GetLightIndices().data() + cluster.offset;
+		for (uint32_t i = 0; i < lights.size(); ++i)
+		{
+			if (!IsLit(lights[i], worldPos)) continue;
+			++litCount;
+			missCount += !binary_search(first, first + cluster.count, i);
+		}
+	}
+	CHECK(litCount > 1000);
+	CHECK(missCount == 0);
+}
+
+TEST_CASE(LightsWithoutRangeAreSkippedButKeepIndices)
+{
+	ClusteredLightBinner binner;
+	binner.Initialize(CreateDesc());
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	vector<ClusterLight> lights = {
+		{ { 0.0f, 0.0f, 10.0f }, 0.0f, { 0.0f, 0.0f, 1.0f }, -1.0f },		// directional or disabled
+		{ { 0.0f, 0.0f, 10.0f }, 2.0f, { 0.0f, 0.0f, 1.0f }, -1.0f },
+		{ { 0.0f, 0.0f, -10.0f }, 2.0f, { 0.0f, 0.0f, 1.0f }, -1.0f },	// behind the camera
+		{ { 0.0f, 0.0f, 150.0f }, 2.0f, { 0.0f, 0.0f, 1.0f }, -1.0f } };	// past the far plane
+	binner.Bin(lights, identity);
+
+	const vector<uint32_t>& lightIndices = binner.GetLightIndices();
+	CHECK(!lightIndices.empty());
+	CHECK(all_of(lightIndices.begin(), lightIndices.end(), [](uint32_t index) { return index == 1; }));
+	const ClusterRange& center = binner.GetClusters()[binner.GetClusterIndex(8, 4, binner.GetSlice(10.0f))];
+	CHECK(center.count == 1);
+}
+
+TEST_CASE(SliceScaleBiasMatchesGetSlice)
+{
+	ClusteredLightBinner binner;
+	const ClusterGridDesc desc = CreateDesc();
+	binner.Initialize(desc);
+	XMFLOAT2 scaleBias = binner.GetSliceScaleBias();
+	CHECK(binner.GetSlice(desc.nearZ) == 0);
+	CHECK(binner.GetSlice(desc.farZ * 2.0f) == desc.slices - 1);
+	for (float z = 0.15f; z < desc.farZ; z *= 1.37f)
+	{
+		float slice = floorf(logf(z) * scaleBias.x + scaleBias.y);
+		CHECK(binner.GetSlice(z) == min(static_cast<uint32_t>(max(slice, 0.0f)), desc.slices - 1));
+	}
+}
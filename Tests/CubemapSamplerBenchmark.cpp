@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Utils/CubemapSampler.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Trilinear taps per second into a mipped 64 cubemap, one direction at a time against batches of eight
+int main()
+{
+	CubemapImage image;
+	image.Allocate(64, 1);
+	for (size_t i = 0; i < image.texels.size(); ++i) image.texels[i] = static_cast<float>(i % 13) * 0.1f;
+	CubemapSampler::GenerateMips(image);
+
+	const int tapCount = 1 << 20;
+	mt19937 random(1);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	vector<float> x(tapCount), y(tapCount), z(tapCount), lod(tapCount, 2.5f);
+	for (int i = 0; i < tapCount; ++i)
+	{
+		x[i] = uniform(random);
+		y[i] = uniform(random);
+		z[i] = uniform(random);
+	}
+
+	XMVECTOR sum = XMVectorZero();
+	double scalarTime = MeasureMilliseconds(5, [&]()
+	{
+		for (int i = 0; i < tapCount; ++i)
+		{
+			sum = XMVectorAdd(sum, CubemapSampler::Sample(image, XMVectorSet(x[i], y[i], z[i], 0.0f), lod[i]));
+		}
+	});
+	double batchTime = MeasureMilliseconds(5, [&]()
+	{
+		XMVECTOR colors[CubemapSampler::BATCH_SIZE];
+		for (int i = 0; i < tapCount; i += CubemapSampler::BATCH_SIZE)
+		{
+			CubemapSampler::Sample(image, &x[i], &y[i], &z[i], &lod[i], colors);
+			for (const XMVECTOR& color : colors) sum = XMVectorAdd(sum, color);
+		}
+	});
+	printf("scalar  %.1f Mtaps/s\nbatched %.1f Mtaps/s\n(checksum %g)\n", tapCount / scalarTime / 1e3, tapCount / batchTime / 1e3, XMVectorGetX(sum));
+	return 0;
+}
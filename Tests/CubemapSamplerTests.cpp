@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "Utils/CubemapSampler.h"
+#include "Utils/IBLUtils.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// Smooth function of direction, which bilinear filtering reproduces closely everywhere if there are no seams
+float LinearFunction(const XMFLOAT3& direction)
+{
+	return 1.0f + 0.5f * direction.x + 0.25f * direction.y - 0.3f * direction.z;
+}
+
+XMFLOAT3 GetTexelDirection(int face, int x, int y, int size)
+{
+	XMFLOAT3 direction;
+	XMStoreFloat3(&direction, IBLUtils::GetCubemapDirection(face, (x + 0.5f) * 2.0f / size - 1.0f, (y + 0.5f) * 2.0f / size - 1.0f));
+	return direction;
+}
+
+CubemapImage CreateLinearCubemap(int size)
+{
+	CubemapImage image;
+	image.Allocate(size, 1);
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				float* texel = image.GetFace(0, face) + (y * size + x) * 4;
+				texel[0] = texel[1] = texel[2] = LinearFunction(GetTexelDirection(face, x, y, size));
+				texel[3] = 1.0f;
+			}
+		}
+	}
+	return image;
+}
+}
+
+TEST_CASE(BatchedMappingMatchesScalarMapping)
+{
+	mt19937 random(1);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	size_t mismatchCount = 0;
+	for (int batch = 0; batch < 4096; ++batch)
+	{
+		float x[CubemapSampler::BATCH_SIZE], y[CubemapSampler::BATCH_SIZE], z[CubemapSampler::BATCH_SIZE];
+		for (int i = 0; i < CubemapSampler::BATCH_SIZE; ++i)
+		{
+			x[i] = uniform(random);
+			y[i] = uniform(random);
+			z[i] = uniform(random);
+		}
+		if (batch == 0)
+		{
+			// ties between axes
+			x[0] = 1.0f; y[0] = 1.0f; z[0] = 0.5f;
+			x[1] = 0.0f; y[1] = -1.0f; z[1] = -1.0f;
+			x[2] = -1.0f; y[2] = -1.0f; z[2] = -1.0f;
+		}
+		CubemapSampler::Coordinates coordinates;
+		CubemapSampler::MapDirections(x, y, z, coordinates);
+		for (int i = 0; i < CubemapSampler::BATCH_SIZE; ++i)
+		{
+			int face;
+			float u, v;
+			CubemapSampler::MapDirection(XMFLOAT3(x[i], y[i], z[i]), face, u, v);
+			mismatchCount += face != coordinates.face[i] || fabsf(u - coordinates.u[i]) > 1e-6f || fabsf(v - coordinates.v[i]) > 1e-6f;
+		}
+	}
+	CHECK(mismatchCount == 0);
+}
+
+TEST_CASE(TexelCentersMapBackToThemselves)
+{
+	const int size = 16;
+	size_t mismatchCount = 0;
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				int mappedFace;
+				float u, v;
+				CubemapSampler::MapDirection(GetTexelDirection(face, x, y, size), mappedFace, u, v);
+				mismatchCount += mappedFace != face || fabsf(u * size - (x + 0.5f)) > 1e-3f || fabsf(v * size - (y + 0.5f)) > 1e-3f;
+			}
+		}
+	}
+	CHECK(mismatchCount == 0);
+}
+
+TEST_CASE(SamplingIsAccurateAndSeamless)
+{
+	const CubemapImage image = CreateLinearCubemap(64);
+	mt19937 random(2);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	float maxError = 0.0f;
+	for (int i = 0; i < 100000; ++i)
+	{
+		XMVECTOR direction = XMVector3Normalize(XMVectorSet(uniform(random), uniform(random), uniform(random), 0.0f));
+		XMFLOAT3 expected;
+		XMStoreFloat3(&expected, direction);
+		maxError = max(maxError, fabsf(XMVectorGetX(CubemapSampler::Sample(image, direction, 0.0f)) - LinearFunction(expected)));
+	}
+	CHECK(maxError < 5e-3f);
+
+	// a great circle crossing four face edges in small steps never jumps
+	float maxStep = 0.0f;
+	XMVECTOR previous = CubemapSampler::Sample(image, XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), 0.0f);
+	for (int i = 1; i <= 100000; ++i)
+	{
+		float angle = i * XM_2PI / 100000.0f;
+		XMVECTOR color = CubemapSampler::Sample(image, XMVectorSet(cosf(angle), 0.3f * sinf(angle), sinf(angle), 0.0f), 0.0f);
+		maxStep = max(maxStep, fabsf(XMVectorGetX(color) - XMVectorGetX(previous)));
+		previous = color;
+	}
+	CHECK(maxStep < 2e-4f);
+}
+
+TEST_CASE(MipsBoxFilterDownToOneTexel)
+{
+	CubemapImage image;
+	image.Allocate(32, 1);
+	fill(image.texels.begin(), image.texels.end(), 0.75f);
+	CubemapSampler::GenerateMips(image);
+	CHECK(image.mipCount == 6);
+	CHECK(image.GetMipSize(image.mipCount - 1) == 1);
+	for (int face = 0; face < 6; ++face)
+	{
+		CHECK_NEAR(image.GetFace(image.mipCount - 1, face)[0], 0.75f, 1e-6);
+	}
+	CHECK(CubemapSampler::ComputeLod(image, 4.0f * XM_PI) == static_cast<float>(image.mipCount - 1));
+	CHECK(CubemapSampler::ComputeLod(image, 1e-9f) == 0.0f);
+}
+
+TEST_CASE(EquirectangularConversionKeepsTheImage)
+{
+	const uint32_t width = 512, height = 256;
+	vector<float> equirect(width * height * 3);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			float phi = (x + 0.5f) / width * XM_2PI - XM_PI;
+			float elevation = (0.5f - (y + 0.5f) / height) * XM_PI;
+			float value = LinearFunction({ cosf(elevation) * cosf(phi), sinf(elevation), cosf(elevation) * sinf(phi) });
+			fill_n(equirect.begin() + (y * width + x) * 3, 3, value);
+		}
+	}
+	CubemapImage cubemap = IBLUtils::EquirectangularToCubemap(equirect.data(), width, height);
+	CHECK(cubemap.size == 128);
+	float maxError = 0.0f;
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < cubemap.size; ++y)
+		{
+			for (int x = 0; x < cubemap.size; ++x)
+			{
+				float value = cubemap.GetFace(0, face)[(y * cubemap.size + x) * 4];
+				maxError = max(maxError, fabsf(value - LinearFunction(GetTexelDirection(face, x, y, cubemap.size))));
+			}
+		}
+	}
+	CHECK(maxError < 1e-3f);
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "Utils/EnvironmentTransition.h"
+#include "Utils/IBLUtils.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+const int ENVIRONMENT_SIZE = 32;
+const int PREFILTERED_SAMPLE_COUNT = 64;
+
+// Sky gradient with a bright sun, its full mip chain and a recognizable SH
+IBLEnvironment CreateEnvironment(float brightness)
+{
+	IBLEnvironment environment;
+	const XMVECTOR sunDirection = XMVector3Normalize(XMVectorSet(-0.4f, 0.7f, 0.6f, 0.0f));
+	CubemapImage& image = environment.cubemap;
+	image.Allocate(ENVIRONMENT_SIZE, 1);
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < ENVIRONMENT_SIZE; ++y)
+		{
+			for (int x = 0; x < ENVIRONMENT_SIZE; ++x)
+			{
+				XMVECTOR direction = XMVector3Normalize(IBLUtils::GetCubemapDirection(face,
+					(x + 0.5f) * 2.0f / ENVIRONMENT_SIZE - 1.0f, (y + 0.5f) * 2.0f / ENVIRONMENT_SIZE - 1.0f));
+				float height = max(XMVectorGetY(direction), 0.0f);
+				float sun = XMVectorGetX(XMVector3Dot(direction, sunDirection)) > 0.98f ? 20.0f : 0.0f;
+				float* texel = image.GetFace(0, face) + (y * ENVIRONMENT_SIZE + x) * 4;
+				texel[0] = brightness * (0.2f + 0.3f * height + sun);
+				texel[1] = brightness * (0.3f + 0.4f * height + sun);
+				texel[2] = brightness * (0.5f + 0.5f * height + sun);
+				texel[3] = 1.0f;
+			}
+		}
+	}
+	CubemapSampler::GenerateMips(image);
+	for (XMFLOAT3& coefficient : environment.irradianceSH.coefficients)
+	{
+		coefficient = XMFLOAT3(brightness, 2.0f * brightness, 3.0f * brightness);
+	}
+	return environment;
+}
+
+struct TransitionLog
+{
+	bool            completed = false;
+	bool            withinBakeBudget = true;
+	bool            withinUploadBudget = true;
+	bool            progressMonotonic = true;
+	bool            weightMonotonic = true;
+	float           finalProgress = 0.0f;
+	float           finalWeight = 0.0f;
+	uint32_t        uploadedCount = 0;
+	IBLEnvironment  completedEnvironment;
+	SHCoefficients  finalIrradiance = {};
+};
+
+// Pumps frames until the transition completes, checking every frame against the budgets. A single tile row
+// or subresource larger than its budget may still go through alone.
+TransitionLog RunTransition(EnvironmentTransition& transition)
+{
+	const EnvironmentTransitionSettings& settings = transition.GetSettings();
+	const uint64_t maxRowSamples = static_cast<uint64_t>(IBLBaker::TILE_SIZE) * PREFILTERED_SAMPLE_COUNT;
+	TransitionLog log;
+	float previousProgress = 0.0f;
+	float previousWeight = 0.0f;
+	auto deadline = chrono::steady_clock::now() + chrono::seconds(30);
+	while (chrono::steady_clock::now() < deadline)
+	{
+		EnvironmentTransition::Frame frame = transition.Update(1.0f / 60.0f);
+		log.withinBakeBudget &= frame.bakeSampleCount <= max(settings.bakeSamplesPerFrame, maxRowSamples);
+
+		uint64_t uploadTexels = 0;
+		for (uint32_t i = frame.firstUpload; i < frame.firstUpload + frame.uploadCount; ++i)
+		{
+			int size;
+			transition.GetUploadTexels(i, size);
+			uploadTexels += static_cast<uint64_t>(size) * size;
+		}
+		log.withinUploadBudget &= frame.uploadCount <= 1 || uploadTexels <= settings.uploadTexelsPerFrame;
+		log.uploadedCount += frame.uploadCount;
+
+		float progress = transition.GetBakeProgress();
+		if (frame.state != EnvironmentTransition::State::Idle && frame.state != EnvironmentTransition::State::Loading)
+		{
+			log.progressMonotonic &= progress >= previousProgress;
+			previousProgress = progress;
+		}
+		// the incoming environment becomes the current one on the frame it completes, so its weight is then 1
+		float weight = frame.completed ? 1.0f : frame.blend;
+		log.weightMonotonic &= weight >= previousWeight;
+		previousWeight = weight;
+
+		if (frame.completed)
+		{
+			log.completed = true;
+			log.finalProgress = previousProgress;
+			log.finalWeight = weight;
+			log.finalIrradiance = transition.GetIrradianceSH();
+			log.completedEnvironment = transition.TakeCompleted();
+			break;
+		}
+		if (frame.state == EnvironmentTransition::State::Loading) this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	return log;
+}
+
+bool SameBytes(const CubemapImage& a, const CubemapImage& b)
+{
+	return a.size == b.size && a.mipCount == b.mipCount && a.texels.size() == b.texels.size()
+		&& memcmp(a.texels.data(), b.texels.data(), a.texels.size() * sizeof(float)) == 0;
+}
+}
+
+// The rebake is split over frames very differently for each budget, but must come out bit for bit the same
+TEST_CASE(BudgetedRebakeMatchesOneShotBake)
+{
+	IBLEnvironment reference = CreateEnvironment(1.0f);
+	const int prefilteredSize = ENVIRONMENT_SIZE / 2;
+	CubemapImage expected = IBLBaker::BakePrefiltered(reference.cubemap, prefilteredSize,
+		IBLBaker::GetPrefilteredMipCount(prefilteredSize), PREFILTERED_SAMPLE_COUNT);
+
+	for (uint64_t sampleBudget : { uint64_t(1), uint64_t(777), uint64_t(5000), UINT64_MAX })
+	{
+		EnvironmentTransition transition;
+		transition.GetSettings().bakeSamplesPerFrame = sampleBudget;
+		transition.GetSettings().uploadTexelsPerFrame = ENVIRONMENT_SIZE * ENVIRONMENT_SIZE + 300;
+		transition.GetSettings().prefilteredSampleCount = PREFILTERED_SAMPLE_COUNT;
+		transition.GetSettings().crossfadeDuration = 0.25f;
+		transition.Begin([]() { return CreateEnvironment(1.0f); });
+
+		TransitionLog log = RunTransition(transition);
+		CHECK(log.completed);
+		CHECK(log.withinBakeBudget);
+		CHECK(log.withinUploadBudget);
+		CHECK(log.progressMonotonic && log.finalProgress == 1.0f);
+		CHECK(log.weightMonotonic && log.finalWeight == 1.0f);
+		CHECK(log.uploadedCount == 6 + 6 * static_cast<uint32_t>(expected.mipCount));
+		CHECK(log.completedEnvironment.baked);
+		CHECK(SameBytes(log.completedEnvironment.prefiltered, expected));
+		CHECK(memcmp(&log.finalIrradiance, &reference.irradianceSH, sizeof(SHCoefficients)) == 0);
+		CHECK(transition.GetState() == EnvironmentTransition::State::Idle);
+	}
+}
+
+TEST_CASE(CrossfadeBlendsTheIrradiance)
+{
+	EnvironmentTransition transition;
+	transition.SetCurrentIrradiance(CreateEnvironment(1.0f).irradianceSH);
+	transition.GetSettings().crossfadeDuration = 1.0f;
+	transition.Begin([]() { return CreateEnvironment(3.0f); });
+
+	// the first coefficient goes from 1 to 3 along the blend
+	bool blendMatches = true;
+	for (int frame = 0; frame < 100000; ++frame)
+	{
+		EnvironmentTransition::Frame result = transition.Update(1.0f / 60.0f);
+		if (result.completed) break;
+		if (result.state == EnvironmentTransition::State::Loading) this_thread::sleep_for(chrono::milliseconds(1));
+		float expected = 1.0f + 2.0f * result.blend;
+		blendMatches &= fabsf(transition.GetIrradianceSH().coefficients[0].x - expected) < 1e-5f;
+	}
+	CHECK(blendMatches);
+	CHECK(transition.GetIrradianceSH().coefficients[0].x == 3.0f);
+}
+
+// Run by ctest with and without pool workers: either way the load must not run inside Begin
+TEST_CASE(LoadDoesNotBlockTheFrame)
+{
+	atomic<bool> beginReturned { false };
+	atomic<bool> loadSawReturn { false };
+	EnvironmentTransition transition;
+	transition.Begin([&]()
+	{
+		auto deadline = chrono::steady_clock::now() + chrono::seconds(5);
+		while (!beginReturned && chrono::steady_clock::now() < deadline) this_thread::sleep_for(chrono::milliseconds(1));
+		loadSawReturn = beginReturned.load();
+		return CreateEnvironment(1.0f);
+	});
+	beginReturned = true;
+	CHECK(transition.GetState() == EnvironmentTransition::State::Loading);
+
+	TransitionLog log = RunTransition(transition);
+	CHECK(log.completed);
+	CHECK(loadSawReturn);
+}
+
+TEST_CASE(FailedLoadFallsThroughToTheQueuedRequest)
+{
+	EnvironmentTransition transition;
+	transition.Begin([]() -> IBLEnvironment { throw runtime_error("missing file"); });
+	transition.Begin([]() { return CreateEnvironment(2.0f); });
+
+	TransitionLog log = RunTransition(transition);
+	CHECK(log.completed);
+	CHECK(log.finalIrradiance.coefficients[0].x == 2.0f);
+}
@@ -0,0 +1,167 @@
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Utils/IBLBaker.h"
+#include "Utils/IBLUtils.h"
+#include "Utils/ThreadPool.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// Sky gradient with a small bright sun, so the lobes see both smooth and sharp detail
+CubemapImage CreateSky(int size)
+{
+	const XMVECTOR sunDirection = XMVector3Normalize(XMVectorSet(0.3f, 0.8f, -0.5f, 0.0f));
+	CubemapImage image;
+	image.Allocate(size, 1);
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				XMVECTOR direction = XMVector3Normalize(IBLUtils::GetCubemapDirection(face, (x + 0.5f) * 2.0f / size - 1.0f, (y + 0.5f) * 2.0f / size - 1.0f));
+				float height = XMVectorGetY(direction);
+				float sun = XMVectorGetX(XMVector3Dot(direction, sunDirection)) > 0.99f ? 50.0f : 0.0f;
+				float* texel = image.GetFace(0, face) + (y * size + x) * 4;
+				texel[0] = 0.2f + 0.3f * max(height, 0.0f) + sun;
+				texel[1] = 0.3f + 0.4f * max(height, 0.0f) + sun;
+				texel[2] = 0.5f + 0.5f * max(height, 0.0f) + sun * 0.9f;
+				texel[3] = 1.0f;
+			}
+		}
+	}
+	CubemapSampler::GenerateMips(image);
+	return image;
+}
+
+CubemapImage CreateConstant(int size, const XMFLOAT3& color)
+{
+	CubemapImage image;
+	image.Allocate(size, 1);
+	for (size_t i = 0; i < image.texels.size(); i += 4)
+	{
+		image.texels[i] = color.x;
+		image.texels[i + 1] = color.y;
+		image.texels[i + 2] = color.z;
+		image.texels[i + 3] = 1.0f;
+	}
+	CubemapSampler::GenerateMips(image);
+	return image;
+}
+
+bool SameBytes(const CubemapImage& a, const CubemapImage& b)
+{
+	return a.size == b.size && a.mipCount == b.mipCount && a.texels.size() == b.texels.size()
+		&& memcmp(a.texels.data(), b.texels.data(), a.texels.size() * sizeof(float)) == 0;
+}
+
+float GetMaxRelativeError(const CubemapImage& image, const XMFLOAT3& expected)
+{
+	float maxError = 0.0f;
+	for (size_t i = 0; i < image.texels.size(); i += 4)
+	{
+		maxError = max(maxError, fabsf(image.texels[i] - expected.x) / expected.x);
+		maxError = max(maxError, fabsf(image.texels[i + 1] - expected.y) / expected.y);
+		maxError = max(maxError, fabsf(image.texels[i + 2] - expected.z) / expected.z);
+	}
+	return maxError;
+}
+
+// Split-sum scale and bias as the integral of D G (1 - Fc) / (4 NdotV) and D G Fc / (4 NdotV) over the
+// hemisphere of light directions, by the midpoint rule rather than importance sampling
+XMFLOAT2 IntegrateBRDF(double NdotV, double roughness)
+{
+	const int thetaSteps = 512;
+	const int phiSteps = 1024;
+	const double pi = 3.14159265358979323846;
+	const double alpha = roughness * roughness;
+	const double k = alpha * 0.5;
+	const double view[3] = { sqrt(1.0 - NdotV * NdotV), NdotV, 0.0 };
+	const double GV = NdotV / (NdotV * (1.0 - k) + k);
+	double scale = 0.0;
+	double bias = 0.0;
+	for (int i = 0; i < thetaSteps; ++i)
+	{
+		double theta = (i + 0.5) * 0.5 * pi / thetaSteps;
+		for (int j = 0; j < phiSteps; ++j)
+		{
+			double phi = (j + 0.5) * 2.0 * pi / phiSteps;
+			double light[3] = { sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi) };
+			double half[3] = { view[0] + light[0], view[1] + light[1], view[2] + light[2] };
+			double halfLength = sqrt(half[0] * half[0] + half[1] * half[1] + half[2] * half[2]);
+			double NdotH = half[1] / halfLength;
+			double VdotH = (view[0] * half[0] + view[1] * half[1] + view[2] * half[2]) / halfLength;
+			double NdotL = light[1];
+
+			double denominator = NdotH * NdotH * (alpha * alpha - 1.0) + 1.0;
+			double D = alpha * alpha / (pi * denominator * denominator);
+			double G = GV * NdotL / (NdotL * (1.0 - k) + k);
+			double Fc = pow(1.0 - VdotH, 5.0);
+			double weight = D * G / (4.0 * NdotV) * sin(theta);
+			scale += (1.0 - Fc) * weight;
+			bias += Fc * weight;
+		}
+	}
+	double solidAngleStep = (0.5 * pi / thetaSteps) * (2.0 * pi / phiSteps);
+	return XMFLOAT2(static_cast<float>(scale * solidAngleStep), static_cast<float>(bias * solidAngleStep));
+}
+}
+
+// Every texel depends only on its own inputs, so spreading the tiles over the pool must not change a bit
+TEST_CASE(ThreadPoolBakesMatchSerialBakes)
+{
+	// ctest sets LUNAR_WORKER_THREADS, so this compares against a real pool on any machine
+	CHECK(ThreadPool::GetInstance().GetThreadCount() > 1);
+	CubemapImage sky = CreateSky(32);
+	CubemapImage irradiance = IBLBaker::BakeIrradiance(sky, 16, 128);
+	CubemapImage prefiltered = IBLBaker::BakePrefiltered(sky, 16, IBLBaker::GetPrefilteredMipCount(16), 64);
+	vector<XMFLOAT2> lut = IBLBaker::BakeBRDFLut(32, 128);
+
+	ThreadPool::SerialScope serial;
+	CHECK(SameBytes(irradiance, IBLBaker::BakeIrradiance(sky, 16, 128)));
+	CHECK(SameBytes(prefiltered, IBLBaker::BakePrefiltered(sky, 16, IBLBaker::GetPrefilteredMipCount(16), 64)));
+	vector<XMFLOAT2> serialLut = IBLBaker::BakeBRDFLut(32, 128);
+	CHECK(serialLut.size() == lut.size() && memcmp(serialLut.data(), lut.data(), lut.size() * sizeof(XMFLOAT2)) == 0);
+}
+
+TEST_CASE(ConstantEnvironmentBakesBackUnchanged)
+{
+	const XMFLOAT3 color = { 0.25f, 0.5f, 1.0f };
+	CubemapImage environment = CreateConstant(32, color);
+
+	// irradiance is radiance integrated against the cosine, pi times a constant radiance
+	CubemapImage irradiance = IBLBaker::BakeIrradiance(environment, 8, 64);
+	CHECK(GetMaxRelativeError(irradiance, XMFLOAT3(color.x * XM_PI, color.y * XM_PI, color.z * XM_PI)) < 1e-5f);
+
+	CubemapImage prefiltered = IBLBaker::BakePrefiltered(environment, 16, IBLBaker::GetPrefilteredMipCount(16), 64);
+	CHECK(prefiltered.mipCount == 5);
+	CHECK(GetMaxRelativeError(prefiltered, color) < 1e-5f);
+}
+
+TEST_CASE(BRDFLutMatchesTheIntegral)
+{
+	const int size = 16;
+	vector<XMFLOAT2> lut = IBLBaker::BakeBRDFLut(size, 1024);
+	const int texels[][2] = { { 7, 7 }, { 15, 11 }, { 3, 15 }, { 11, 5 }, { 1, 8 } };
+	for (const int* texel : texels)
+	{
+		float NdotV = (texel[0] + 0.5f) / size;
+		float roughness = (texel[1] + 0.5f) / size;
+		XMFLOAT2 expected = IntegrateBRDF(NdotV, roughness);
+		const XMFLOAT2& baked = lut[texel[1] * size + texel[0]];
+		CHECK_NEAR(baked.x, expected.x, 0.01f);
+		CHECK_NEAR(baked.y, expected.y, 0.005f);
+	}
+
+	// a smooth surface seen head on reflects F0 alone
+	const XMFLOAT2& smooth = lut[size - 1];
+	CHECK_NEAR(smooth.x, 1.0f, 0.01f);
+	CHECK_NEAR(smooth.y, 0.0f, 0.01f);
+}
@@ -0,0 +1,166 @@
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Utils/IBLCache.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+string GetTempPath(const string& fileName)
+{
+	return (filesystem::temp_directory_path() / fileName).string();
+}
+
+vector<uint8_t> CreateSource()
+{
+	vector<uint8_t> source(1001);
+	for (size_t i = 0; i < source.size(); ++i) source[i] = static_cast<uint8_t>(i * 31);
+	return source;
+}
+
+IBLCacheData CreateData()
+{
+	IBLCacheData data;
+	data.cubemapSize = 8;
+	data.prefilteredSize = 4;
+	data.prefilteredMipCount = 3;
+	data.brdfLutSize = 16;
+	data.irradianceSH.coefficients[3] = { 1.0f, 2.0f, 3.0f };
+	data.cubemap.resize(IBLCache::GetCubemapByteSize(8, 1) / sizeof(uint16_t));
+	for (size_t i = 0; i < data.cubemap.size(); ++i) data.cubemap[i] = static_cast<uint16_t>(i * 7);
+	data.prefiltered.resize(IBLCache::GetCubemapByteSize(4, 3) / sizeof(uint16_t));
+	for (size_t i = 0; i < data.prefiltered.size(); ++i) data.prefiltered[i] = static_cast<uint16_t>(i * 3 + 1);
+	data.brdfLut.resize(16 * 16 * 2);
+	for (size_t i = 0; i < data.brdfLut.size(); ++i) data.brdfLut[i] = static_cast<uint16_t>(i ^ 0x55);
+	return data;
+}
+
+vector<char> ReadFile(const string& filePath)
+{
+	ifstream file(filePath, ios::binary);
+	return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+void WriteFile(const string& filePath, const vector<char>& bytes)
+{
+	ofstream file(filePath, ios::binary | ios::trunc);
+	file.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+}
+
+// Rewrites the cache with one header field changed and reports whether it still opens
+template<typename Edit>
+bool OpensWithEditedHeader(const string& filePath, const vector<char>& bytes, uint64_t key, Edit edit)
+{
+	vector<char> edited = bytes;
+	IBLCacheHeader header;
+	memcpy(&header, edited.data(), sizeof(header));
+	edit(header);
+	memcpy(edited.data(), &header, sizeof(header));
+	WriteFile(filePath, edited);
+	IBLCache cache;
+	return cache.Open(filePath, key);
+}
+}
+
+TEST_CASE(WrittenCacheReadsBackByteForByte)
+{
+	const string cachePath = GetTempPath("LunarIBLCacheRoundTrip.libl");
+	const vector<uint8_t> source = CreateSource();
+	const uint64_t key = IBLCache::ComputeKey(source.data(), source.size(), IBLBakeSettings());
+	filesystem::remove(cachePath);
+
+	IBLCache cache;
+	CHECK(!cache.Open(cachePath, key));
+	const IBLCacheData data = CreateData();
+	CHECK(IBLCache::Write(cachePath, key, data));
+	bool opened = cache.Open(cachePath, key);
+	CHECK(opened);
+	if (!opened) return;
+	CHECK(memcmp(cache.GetCubemapData(), data.cubemap.data(), data.cubemap.size() * sizeof(uint16_t)) == 0);
+	CHECK(memcmp(cache.GetPrefilteredData(), data.prefiltered.data(), data.prefiltered.size() * sizeof(uint16_t)) == 0);
+	CHECK(memcmp(cache.GetBRDFLutData(), data.brdfLut.data(), data.brdfLut.size() * sizeof(uint16_t)) == 0);
+	CHECK(cache.GetHeader().irradianceSH.coefficients[3].y == 2.0f);
+	CHECK(cache.GetHeader().cubemapOffset % IBLCache::SECTION_ALIGNMENT == 0);
+	CHECK(cache.GetHeader().prefilteredOffset % IBLCache::SECTION_ALIGNMENT == 0);
+	CHECK(cache.GetHeader().brdfLutOffset % IBLCache::SECTION_ALIGNMENT == 0);
+	cache.Close();
+
+	// sections that do not match the sizes are refused
+	IBLCacheData mismatched = CreateData();
+	mismatched.brdfLut.pop_back();
+	CHECK(!IBLCache::Write(GetTempPath("LunarIBLCacheMismatched.libl"), key, mismatched));
+	filesystem::remove(cachePath);
+}
+
+// Any change to the source bytes or the bake settings must miss the cache
+TEST_CASE(KeyChangesWithSourceAndSettings)
+{
+	const string cachePath = GetTempPath("LunarIBLCacheKey.libl");
+	const vector<uint8_t> source = CreateSource();
+	const IBLBakeSettings settings;
+	const uint64_t key = IBLCache::ComputeKey(source.data(), source.size(), settings);
+	CHECK(IBLCache::ComputeKey(source.data(), source.size(), settings) == key);
+	CHECK(IBLCache::Write(cachePath, key, CreateData()));
+
+	IBLCache cache;
+	for (size_t position : { size_t(0), size_t(500), size_t(1000) })
+	{
+		vector<uint8_t> edited = source;
+		edited[position] ^= 1;
+		uint64_t editedKey = IBLCache::ComputeKey(edited.data(), edited.size(), settings);
+		CHECK(editedKey != key);
+		CHECK(!cache.Open(cachePath, editedKey));
+	}
+	vector<uint8_t> extended = source;
+	extended.push_back(0);
+	CHECK(IBLCache::ComputeKey(extended.data(), extended.size(), settings) != key);
+
+	IBLBakeSettings changed = settings;
+	changed.prefilteredSampleCount++;
+	CHECK(IBLCache::ComputeKey(source.data(), source.size(), changed) != key);
+	changed = settings;
+	changed.brdfLutSize *= 2;
+	CHECK(IBLCache::ComputeKey(source.data(), source.size(), changed) != key);
+	changed = settings;
+	changed.brdfLutSampleCount /= 2;
+	CHECK(IBLCache::ComputeKey(source.data(), source.size(), changed) != key);
+
+	CHECK(cache.Open(cachePath, key));
+	cache.Close();
+	filesystem::remove(cachePath);
+}
+
+TEST_CASE(CorruptCachesAreRejected)
+{
+	const string cachePath = GetTempPath("LunarIBLCacheCorrupt.libl");
+	const vector<uint8_t> source = CreateSource();
+	const uint64_t key = IBLCache::ComputeKey(source.data(), source.size(), IBLBakeSettings());
+	CHECK(IBLCache::Write(cachePath, key, CreateData()));
+	const vector<char> bytes = ReadFile(cachePath);
+	IBLCache cache;
+
+	vector<char> truncated(bytes.begin(), bytes.end() - 1);
+	WriteFile(cachePath, truncated);
+	CHECK(!cache.Open(cachePath, key));
+	truncated.resize(100);
+	WriteFile(cachePath, truncated);
+	CHECK(!cache.Open(cachePath, key));
+
+	CHECK(!OpensWithEditedHeader(cachePath, bytes, key, [](IBLCacheHeader& header) { header.magic++; }));
+	CHECK(!OpensWithEditedHeader(cachePath, bytes, key, [](IBLCacheHeader& header) { header.version++; }));
+	CHECK(!OpensWithEditedHeader(cachePath, bytes, key, [](IBLCacheHeader& header) { header.prefilteredMipCount = 40; }));
+	CHECK(!OpensWithEditedHeader(cachePath, bytes, key, [](IBLCacheHeader& header) { header.brdfLutOffset += 64; }));
+
+	WriteFile(cachePath, bytes);
+	CHECK(cache.Open(cachePath, key));
+	cache.Close();
+	filesystem::remove(cachePath);
+}
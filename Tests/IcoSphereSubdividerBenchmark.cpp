@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include "Geometry/IcoSphereSubdivider.h"
+#include "Utils/ThreadPool.h"
+#include "Benchmark.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// The subdivision IcoSphere used before IcoSphereSubdivider: a midpoint hash map and a new index list per level
+void SubdivideWithMidpointCache(vector<XMFLOAT3>& positions, vector<uint32_t>& indices, int level)
+{
+	unordered_map<uint64_t, uint32_t> midpoints;
+	auto getMidpoint = [&](uint32_t a, uint32_t b)
+	{
+		uint64_t key = (uint64_t(min(a, b)) << 32) | max(a, b);
+		auto it = midpoints.find(key);
+		if (it != midpoints.end()) return it->second;
+		XMFLOAT3 midpoint;
+		XMStoreFloat3(&midpoint, XMVector3Normalize(XMVectorAdd(XMLoadFloat3(&positions[a]), XMLoadFloat3(&positions[b]))));
+		uint32_t index = static_cast<uint32_t>(positions.size());
+		positions.push_back(midpoint);
+		midpoints[key] = index;
+		return index;
+	};
+
+	for (int i = 0; i < level; ++i)
+	{
+		vector<uint32_t> newIndices;
+		for (size_t face = 0; face < indices.size(); face += 3)
+		{
+			uint32_t a = indices[face], b = indices[face + 1], c = indices[face + 2];
+			uint32_t ab = getMidpoint(a, b), bc = getMidpoint(b, c), ca = getMidpoint(c, a);
+			newIndices.insert(newIndices.end(), { a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca });
+		}
+		indices = move(newIndices);
+		midpoints.clear();
+	}
+}
+}
+
+// Subdivision time per level: the old midpoint cache against IcoSphereSubdivider, serial and per base face
+int main()
+{
+	vector<XMFLOAT3> basePositions;
+	vector<uint32_t> baseIndices;
+	GetIcosahedron(basePositions, baseIndices);
+
+	printf("threads: %zu\n", ThreadPool::GetInstance().GetThreadCount());
+	printf("%5s %10s %12s %14s %12s %14s\n", "level", "faces", "cache ms", "serial ms", "parallel ms", "speedup");
+	for (int level = 0; level <= 8; ++level)
+	{
+		int repetitions = level <= 5 ? 50 : (level <= 7 ? 10 : 3);
+		vector<XMFLOAT3> positions;
+		vector<uint32_t> indices;
+		double cacheTime = MeasureMilliseconds(repetitions, [&]()
+		{
+			positions = basePositions;
+			indices = baseIndices;
+			SubdivideWithMidpointCache(positions, indices, level);
+		});
+		double serialTime = MeasureMilliseconds(repetitions, [&]()
+		{
+			IcoSphereSubdivider::Subdivide(basePositions, baseIndices, level, false, positions, indices);
+		});
+		double parallelTime = MeasureMilliseconds(repetitions, [&]()
+		{
+			IcoSphereSubdivider::Subdivide(basePositions, baseIndices, level, true, positions, indices);
+		});
+		printf("%5d %10zu %12.3f %14.3f %12.3f %13.1fx\n", level, indices.size() / 3, cacheTime, serialTime, parallelTime,
+			cacheTime / min(serialTime, parallelTime));
+	}
+	return 0;
+}
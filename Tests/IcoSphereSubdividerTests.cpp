@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "Geometry/IcoSphereSubdivider.h"
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+void Subdivide(int level, bool parallel, vector<XMFLOAT3>& outPositions, vector<uint32_t>& outIndices)
+{
+	vector<XMFLOAT3> basePositions;
+	vector<uint32_t> baseIndices;
+	GetIcosahedron(basePositions, baseIndices);
+	IcoSphereSubdivider::Subdivide(basePositions, baseIndices, level, parallel, outPositions, outIndices);
+}
+}
+
+TEST_CASE(CountsMatchTheClosedForm)
+{
+	for (int level = 0; level <= 8; ++level)
+	{
+		vector<XMFLOAT3> positions;
+		vector<uint32_t> indices;
+		Subdivide(level, true, positions, indices);
+		CHECK(positions.size() == IcoSphereSubdivider::GetVertexCount(level));
+		CHECK(indices.size() == 3 * size_t(IcoSphereSubdivider::GetFaceCount(level)));
+	}
+}
+
+// Every directed edge appears once and its twin once, so shared edge vertices were not duplicated
+TEST_CASE(SubdivisionIsAClosedManifold)
+{
+	for (int level = 0; level <= 6; ++level)
+	{
+		vector<XMFLOAT3> positions;
+		vector<uint32_t> indices;
+		Subdivide(level, true, positions, indices);
+
+		vector<pair<uint32_t, uint32_t>> edges;
+		vector<bool> used(positions.size(), false);
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				CHECK(indices[i + corner] < positions.size());
+				edges.push_back({ indices[i + corner], indices[i + (corner + 1) % 3] });
+				used[indices[i + corner]] = true;
+			}
+		}
+		sort(edges.begin(), edges.end());
+		CHECK(adjacent_find(edges.begin(), edges.end()) == edges.end());
+		for (const pair<uint32_t, uint32_t>& edge : edges)
+		{
+			CHECK(binary_search(edges.begin(), edges.end(), make_pair(edge.second, edge.first)));
+		}
+		CHECK(count(used.begin(), used.end(), false) == 0);
+	}
+}
+
+TEST_CASE(VerticesAreOnTheUnitSphereAndFacesPointOut)
+{
+	vector<XMFLOAT3> positions;
+	vector<uint32_t> indices;
+	Subdivide(6, true, positions, indices);
+	for (const XMFLOAT3& position : positions)
+	{
+		CHECK_NEAR(XMVectorGetX(XMVector3Length(XMLoadFloat3(&position))), 1.0f, 1e-5f);
+	}
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		XMVECTOR a = XMLoadFloat3(&positions[indices[i]]);
+		XMVECTOR b = XMLoadFloat3(&positions[indices[i + 1]]);
+		XMVECTOR c = XMLoadFloat3(&positions[indices[i + 2]]);
+		XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+		CHECK(XMVectorGetX(XMVector3Dot(normal, XMVectorAdd(XMVectorAdd(a, b), c))) > 0.0f);
+	}
+}
+
+TEST_CASE(ParallelMatchesSerial)
+{
+	for (int level : { 0, 3, 7 })
+	{
+		vector<XMFLOAT3> serialPositions, parallelPositions;
+		vector<uint32_t> serialIndices, parallelIndices;
+		Subdivide(level, false, serialPositions, serialIndices);
+		Subdivide(level, true, parallelPositions, parallelIndices);
+		CHECK(serialIndices == parallelIndices);
+		CHECK(serialPositions.size() == parallelPositions.size());
+		bool samePositions = true;
+		for (size_t i = 0; i < serialPositions.size(); ++i)
+		{
+			samePositions &= serialPositions[i].x == parallelPositions[i].x &&
+				serialPositions[i].y == parallelPositions[i].y && serialPositions[i].z == parallelPositions[i].z;
+		}
+		CHECK(samePositions);
+	}
+}
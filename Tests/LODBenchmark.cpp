@@ -0,0 +1,45 @@
+#include <cstdio>
+#include <vector>
+
+#include "Geometry/MeshSimplifier.h"
+#include "Benchmark.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// The chain Geometry::CreateLODGeometry builds: level i keeps 4^-i of LOD0's triangles, simplified from LOD0
+void ReportChain(const char* name, const vector<Vertex>& vertices, const vector<uint32_t>& indices32)
+{
+	vector<uint16_t> indices(indices32.begin(), indices32.end());
+	printf("%s\n%5s %10s %10s %12s\n", name, "level", "triangles", "vertices", "simplify ms");
+	printf("%5d %10zu %10zu %12s\n", 0, indices.size() / 3, vertices.size(), "-");
+	size_t targetTriangleCount = indices.size() / 3;
+	for (int level = 1; level <= 3; ++level)
+	{
+		targetTriangleCount /= 4;
+		vector<Vertex> lodVertices;
+		vector<uint16_t> lodIndices;
+		double time = MeasureMilliseconds(5, [&]()
+		{
+			MeshSimplifier::Simplify(vertices, indices, targetTriangleCount, lodVertices, lodIndices);
+		});
+		printf("%5d %10zu %10zu %12.2f\n", level, lodIndices.size() / 3, lodVertices.size(), time);
+	}
+}
+}
+
+// Triangle and vertex counts per level of detail, with the time to simplify each from LOD0
+int main()
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(5, vertices, indices);
+	ReportChain("icosphere, level 5", vertices, indices);
+	CreateGrid(96, 96, 1.0f, vertices, indices);
+	ReportChain("grid, 96 x 96", vertices, indices);
+	return 0;
+}
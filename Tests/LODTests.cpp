@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "Geometry/LODSelector.h"
+#include "Geometry/MeshSimplifier.h"
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+struct SimplifiedMesh
+{
+	vector<Vertex>   vertices;
+	vector<uint16_t> indices;
+};
+
+SimplifiedMesh Simplify(const vector<Vertex>& vertices, const vector<uint32_t>& indices, size_t targetTriangleCount)
+{
+	SimplifiedMesh mesh;
+	CHECK(MeshSimplifier::Simplify(vertices, vector<uint16_t>(indices.begin(), indices.end()), targetTriangleCount, mesh.vertices, mesh.indices));
+	CHECK(mesh.indices.size() / 3 <= targetTriangleCount);
+	CHECK(mesh.indices.size() / 3 > targetTriangleCount / 2);
+	for (uint16_t index : mesh.indices)
+	{
+		CHECK(index < mesh.vertices.size());
+	}
+	return mesh;
+}
+
+XMVECTOR GetFaceNormal(const vector<Vertex>& vertices, const uint16_t* triangle)
+{
+	XMVECTOR a = XMLoadFloat3(&vertices[triangle[0]].pos);
+	XMVECTOR b = XMLoadFloat3(&vertices[triangle[1]].pos);
+	XMVECTOR c = XMLoadFloat3(&vertices[triangle[2]].pos);
+	return XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+}
+
+float GetArea(const SimplifiedMesh& mesh)
+{
+	float area = 0.0f;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		area += 0.5f * XMVectorGetX(XMVector3Length(GetFaceNormal(mesh.vertices, &mesh.indices[i])));
+	}
+	return area;
+}
+
+// Half-edge collapses only remove vertices, so every survivor is an input vertex with all its attributes
+bool KeepsInputVertices(const vector<Vertex>& input, const SimplifiedMesh& mesh)
+{
+	for (const Vertex& vertex : mesh.vertices)
+	{
+		bool found = any_of(input.begin(), input.end(), [&vertex](const Vertex& candidate)
+		{
+			return candidate.pos.x == vertex.pos.x && candidate.pos.y == vertex.pos.y && candidate.pos.z == vertex.pos.z &&
+				candidate.texCoord.x == vertex.texCoord.x && candidate.texCoord.y == vertex.texCoord.y;
+		});
+		if (!found) return false;
+	}
+	return true;
+}
+
+XMFLOAT4X4 GetProjection(float fovY)
+{
+	XMFLOAT4X4 projection = {};
+	projection._11 = projection._22 = 1.0f / tanf(fovY * 0.5f);
+	return projection;
+}
+}
+
+TEST_CASE(SimplifiedSphereKeepsItsShape)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(4, vertices, indices);
+	for (size_t targetTriangleCount : { 1280, 320, 80 })
+	{
+		SimplifiedMesh mesh = Simplify(vertices, indices, targetTriangleCount);
+		CHECK(KeepsInputVertices(vertices, mesh));
+		// a unit sphere's area is 4 pi; a coarse inscribed mesh has a little less
+		float area = GetArea(mesh);
+		CHECK(area < 4.0f * XM_PI && area > 0.85f * 4.0f * XM_PI);
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			XMVECTOR normal = GetFaceNormal(mesh.vertices, &mesh.indices[i]);
+			CHECK(XMVectorGetX(XMVector3Dot(normal, XMLoadFloat3(&mesh.vertices[mesh.indices[i]].pos))) > 0.0f);
+		}
+	}
+}
+
+// The boundary is pinned, so a flat grid keeps its outline and area however far it is reduced
+TEST_CASE(SimplifiedGridKeepsItsBoundary)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateGrid(32, 32, 1.0f, vertices, indices);
+	for (size_t targetTriangleCount : { 512, 64, 8 })
+	{
+		SimplifiedMesh mesh = Simplify(vertices, indices, targetTriangleCount);
+		CHECK_NEAR(GetArea(mesh), 1.0f, 1e-3f);
+		for (size_t i = 0; i < mesh.indices.size(); i += 3)
+		{
+			CHECK(XMVectorGetY(GetFaceNormal(mesh.vertices, &mesh.indices[i])) > 0.0f);
+		}
+		for (const XMFLOAT3& corner : { XMFLOAT3(-0.5f, 0.0f, -0.5f), XMFLOAT3(0.5f, 0.0f, -0.5f), XMFLOAT3(-0.5f, 0.0f, 0.5f), XMFLOAT3(0.5f, 0.0f, 0.5f) })
+		{
+			CHECK(any_of(mesh.vertices.begin(), mesh.vertices.end(), [&corner](const Vertex& vertex)
+			{
+				return vertex.pos.x == corner.x && vertex.pos.z == corner.z;
+			}));
+		}
+	}
+}
+
+// Vertices split along a UV seam collapse together, so the seam does not open: by position, every edge away
+// from the outline is shared by two triangles
+TEST_CASE(UVSeamsStayClosed)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateGrid(32, 32, 1.0f, vertices, indices);
+	const uint32_t seamColumn = 16;
+	for (uint32_t row = 0; row <= 32; ++row)
+	{
+		Vertex seamVertex = vertices[row * 33 + seamColumn];
+		seamVertex.texCoord.x += 1.0f;
+		vertices.push_back(seamVertex);
+	}
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		uint32_t column = min({ indices[i] % 33, indices[i + 1] % 33, indices[i + 2] % 33 });
+		if (column < seamColumn) continue;
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			if (indices[i + corner] < 33 * 33 && indices[i + corner] % 33 == seamColumn)
+			{
+				indices[i + corner] = 33 * 33 + indices[i + corner] / 33;
+			}
+		}
+	}
+
+	SimplifiedMesh mesh = Simplify(vertices, indices, 64);
+	map<pair<pair<float, float>, pair<float, float>>, int> edgeUses;
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		for (size_t corner = 0; corner < 3; ++corner)
+		{
+			const XMFLOAT3& a = mesh.vertices[mesh.indices[i + corner]].pos;
+			const XMFLOAT3& b = mesh.vertices[mesh.indices[i + (corner + 1) % 3]].pos;
+			pair<float, float> keyA(a.x, a.z), keyB(b.x, b.z);
+			++edgeUses[{ min(keyA, keyB), max(keyA, keyB) }];
+		}
+	}
+	for (const auto& [edge, uses] : edgeUses)
+	{
+		bool onOutline = (edge.first.first == edge.second.first && fabsf(edge.first.first) == 0.5f) ||
+			(edge.first.second == edge.second.second && fabsf(edge.first.second) == 0.5f);
+		CHECK(uses == (onOutline ? 1 : 2));
+	}
+}
+
+TEST_CASE(SimplifyRejectsTargetsItCannotReduceTo)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(1, vertices, indices);
+	vector<Vertex> outVertices;
+	vector<uint16_t> outIndices;
+	CHECK(!MeshSimplifier::Simplify(vertices, vector<uint16_t>(indices.begin(), indices.end()), indices.size() / 3, outVertices, outIndices));
+	CHECK(!MeshSimplifier::Simplify(vertices, {}, 10, outVertices, outIndices));
+}
+
+TEST_CASE(ScreenCoverageIsTheProjectedRadius)
+{
+	XMFLOAT4X4 projection = GetProjection(XM_PIDIV2);
+	BoundingSphere bounds({ 0.0f, 0.0f, 10.0f }, 1.0f);
+	CHECK_NEAR(LODSelector::ComputeScreenCoverage(bounds, { 0.0f, 0.0f, 0.0f }, projection), 0.1f, 1e-6f);
+	CHECK_NEAR(LODSelector::ComputeScreenCoverage(bounds, { 0.0f, 0.0f, -10.0f }, projection), 0.05f, 1e-6f);
+	// a narrower field of view magnifies
+	CHECK_NEAR(LODSelector::ComputeScreenCoverage(bounds, { 0.0f, 0.0f, 0.0f }, GetProjection(2.0f * atanf(0.5f))), 0.2f, 1e-6f);
+	CHECK(LODSelector::ComputeScreenCoverage(bounds, { 0.0f, 0.5f, 10.0f }, projection) == FLT_MAX);
+}
+
+TEST_CASE(SelectLevelAppliesHysteresis)
+{
+	const vector<float> thresholds = { 0.5f, 0.25f, 0.1f };
+	const float hysteresis = 0.1f;
+	CHECK(LODSelector::SelectLevel(1.0f, thresholds, 0, hysteresis) == 0);
+	CHECK(LODSelector::SelectLevel(0.3f, thresholds, 0, hysteresis) == 1);
+	CHECK(LODSelector::SelectLevel(0.01f, thresholds, 0, hysteresis) == 3);
+	CHECK(LODSelector::SelectLevel(1.0f, thresholds, 3, hysteresis) == 0);
+	CHECK(LODSelector::SelectLevel(1.0f, thresholds, 7, hysteresis) == 0);
+
+	// within the band around 0.5 the current level holds
+	CHECK(LODSelector::SelectLevel(0.46f, thresholds, 0, hysteresis) == 0);
+	CHECK(LODSelector::SelectLevel(0.44f, thresholds, 0, hysteresis) == 1);
+	CHECK(LODSelector::SelectLevel(0.54f, thresholds, 1, hysteresis) == 1);
+	CHECK(LODSelector::SelectLevel(0.56f, thresholds, 1, hysteresis) == 0);
+
+	// coverage wobbling 4% around a threshold never switches
+	uint32_t level = 1;
+	uint32_t switchCount = 0;
+	for (int frame = 0; frame < 100; ++frame)
+	{
+		uint32_t nextLevel = LODSelector::SelectLevel(0.25f * (frame % 2 ? 1.04f : 0.96f), thresholds, level, hysteresis);
+		switchCount += nextLevel != level;
+		level = nextLevel;
+	}
+	CHECK(switchCount == 0);
+}
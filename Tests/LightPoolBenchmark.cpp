@@ -0,0 +1,41 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "LightPool.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Per-frame cost of moving every light of a full 4096-light pool and uploading it, against changing one light in
+// 64, which touches one dirty page in 64
+int main()
+{
+	LightPool pool;
+	pool.Initialize(4096);
+	vector<LightData> gpuLights(pool.GetMaxLights());
+	vector<LightHandle> handles;
+	while (pool.GetLightCount() < pool.GetMaxLights()) handles.push_back(pool.AddLight("", LightData()));
+	pool.WriteDirtyLights(gpuLights.data());
+
+	float time = 0.0f;
+	double animateTime = MeasureMilliseconds(200, [&]()
+	{
+		time += 0.016f;
+		for (size_t i = 0; i < handles.size(); ++i)
+		{
+			pool.SetLightPosition(handles[i], { sinf(time + i) * 10.0f, 2.0f, cosf(time + i) * 10.0f });
+		}
+		pool.WriteDirtyLights(gpuLights.data());
+	});
+	double sparseTime = MeasureMilliseconds(200, [&]()
+	{
+		for (size_t i = 0; i < handles.size(); i += 64) pool.SetLightColor(handles[i], { 1.0f, 1.0f, 1.0f });
+		pool.WriteDirtyLights(gpuLights.data());
+	});
+	printf("%u lights\nall moved:    %.3f ms/frame\n1 in 64 set:  %.3f ms/frame\n", pool.GetLightCount(), animateTime, sparseTime);
+	return 0;
+}
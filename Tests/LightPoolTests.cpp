@@ -0,0 +1,126 @@
+#include <random>
+#include <vector>
+
+#include "LightPool.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+LightData CreateLight(float x)
+{
+	LightData light;
+	light.Position = { x, 0.0f, 0.0f };
+	return light;
+}
+
+// What the structured buffer holds after every upload so far
+struct UploadedLights
+{
+	vector<LightData> lights;
+	uint32_t          count = 0;
+
+	explicit UploadedLights(const LightPool& pool) : lights(pool.GetMaxLights()) {}
+	void Upload(LightPool& pool) { count = pool.WriteDirtyLights(lights.data()); }
+};
+
+bool MatchesPool(const LightPool& pool, const UploadedLights& uploaded)
+{
+	if (uploaded.count != pool.GetLightCount()) return false;
+	for (uint32_t i = 0; i < pool.GetLightCount(); ++i)
+	{
+		LightHandle handle = pool.GetHandleAt(i);
+		LightData light = *pool.GetLight(handle);
+		const LightData& gpuLight = uploaded.lights[i];
+		float strength = pool.IsLightEnabled(handle) ? light.Strength.x : 0.0f;
+		if (gpuLight.Position.x != light.Position.x || gpuLight.FalloffEnd != light.FalloffEnd || gpuLight.Strength.x != strength)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+}
+
+TEST_CASE(HandlesSurviveOtherLightsBeingRemoved)
+{
+	LightPool pool;
+	pool.Initialize(256);
+	vector<LightHandle> handles;
+	for (int i = 0; i < 200; ++i) handles.push_back(pool.AddLight("", CreateLight(static_cast<float>(i))));
+
+	for (size_t i = 0; i < handles.size(); i += 3) CHECK(pool.RemoveLight(handles[i]));
+	CHECK(pool.GetLightCount() == 133);
+	bool resolved = true;
+	for (size_t i = 0; i < handles.size(); ++i)
+	{
+		optional<LightData> light = pool.GetLight(handles[i]);
+		resolved &= i % 3 == 0 ? !light : light && light->Position.x == static_cast<float>(i);
+	}
+	CHECK(resolved);
+	CHECK(!pool.RemoveLight(handles[0]));
+
+	// freed handle ids are reused, and the stale handle now names the new light
+	LightHandle reused = pool.AddLight("", CreateLight(-1.0f));
+	CHECK(reused.id == handles[198].id);
+	CHECK(pool.GetLight(reused)->Position.x == -1.0f);
+	CHECK(pool.GetHandleAt(pool.GetLightCount() - 1).id == reused.id);
+}
+
+TEST_CASE(NamesAndCapacityAreEnforced)
+{
+	LightPool pool;
+	pool.Initialize(4);
+	LightHandle sun = pool.AddLight("Sun", CreateLight(1.0f));
+	CHECK(sun.IsValid());
+	CHECK(!pool.AddLight("Sun", CreateLight(2.0f)).IsValid());
+	CHECK(pool.FindLight("Sun").id == sun.id);
+	for (int i = 0; i < 3; ++i) CHECK(pool.AddLight("", CreateLight(0.0f)).IsValid());
+	CHECK(!pool.AddLight("", CreateLight(0.0f)).IsValid());
+
+	pool.SetLightRange("Sun", 20.0f);
+	CHECK(pool.GetLight("Sun")->FalloffEnd == 20.0f);
+	CHECK(pool.RemoveLight("Sun"));
+	CHECK(!pool.FindLight("Sun").IsValid());
+	CHECK(!pool.GetLight("Sun"));
+	CHECK(pool.AddLight("Sun", CreateLight(3.0f)).IsValid());
+}
+
+// Partial uploads leave the buffer matching the pool through random adds, removes, edits and toggles
+TEST_CASE(DirtyPageUploadsKeepTheBufferInSync)
+{
+	LightPool pool;
+	pool.Initialize(1024);
+	UploadedLights uploaded(pool);
+	vector<LightHandle> handles;
+	mt19937 random(5);
+	for (int i = 0; i < 700; ++i) handles.push_back(pool.AddLight("", CreateLight(static_cast<float>(i))));
+	CHECK(pool.HasChanges());
+	uploaded.Upload(pool);
+	CHECK(!pool.HasChanges());
+	CHECK(MatchesPool(pool, uploaded));
+
+	bool inSync = true;
+	for (int frame = 0; frame < 200; ++frame)
+	{
+		for (int edit = 0; edit < 8; ++edit)
+		{
+			LightHandle handle = handles[random() % handles.size()];
+			switch (random() % 5)
+			{
+			case 0: pool.RemoveLight(handle); break;
+			case 1: handles.push_back(pool.AddLight("", CreateLight(static_cast<float>(random() % 1000)))); break;
+			case 2: pool.SetLightPosition(handle, { static_cast<float>(random() % 1000), 0.0f, 0.0f }); break;
+			case 3: pool.SetLightRange(handle, static_cast<float>(random() % 50)); break;
+			default: pool.SetLightEnabled(handle, !pool.IsLightEnabled(handle)); break;
+			}
+		}
+		uploaded.Upload(pool);
+		inSync &= MatchesPool(pool, uploaded);
+	}
+	CHECK(inSync);
+}
@@ -0,0 +1,140 @@
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Geometry/GltfImporter.h"
+#include "Geometry/MeshFile.h"
+#include "Geometry/ObjImporter.h"
+#include "Benchmark.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+string GetTempPath(const string& fileName)
+{
+	return (filesystem::temp_directory_path() / fileName).string();
+}
+
+// Positions, normals and texture coordinates interleaved in one buffer view, with 32-bit indices after them
+void WriteGlb(const string& filePath, const vector<Vertex>& vertices, const vector<uint32_t>& indices)
+{
+	vector<float> vertexData;
+	vertexData.reserve(vertices.size() * 8);
+	for (const Vertex& vertex : vertices)
+	{
+		vertexData.insert(vertexData.end(), { vertex.pos.x, vertex.pos.y, vertex.pos.z,
+			vertex.normal.x, vertex.normal.y, vertex.normal.z, vertex.texCoord.x, vertex.texCoord.y });
+	}
+	const size_t vertexBytes = vertexData.size() * sizeof(float);
+	const size_t indexBytes = indices.size() * sizeof(uint32_t);
+	const string vertexCount = to_string(vertices.size());
+
+	string json = R"({"asset":{"version":"2.0"},"buffers":[{"byteLength":)" + to_string(vertexBytes + indexBytes) + R"(}],)"
+		R"("bufferViews":[{"buffer":0,"byteOffset":0,"byteLength":)" + to_string(vertexBytes) + R"(,"byteStride":32},)"
+		R"({"buffer":0,"byteOffset":)" + to_string(vertexBytes) + R"(,"byteLength":)" + to_string(indexBytes) + R"(}],)"
+		R"("accessors":[{"bufferView":0,"byteOffset":0,"componentType":5126,"count":)" + vertexCount + R"(,"type":"VEC3","min":[-1,-1,-1],"max":[1,1,1]},)"
+		R"({"bufferView":0,"byteOffset":12,"componentType":5126,"count":)" + vertexCount + R"(,"type":"VEC3"},)"
+		R"({"bufferView":0,"byteOffset":24,"componentType":5126,"count":)" + vertexCount + R"(,"type":"VEC2"},)"
+		R"({"bufferView":1,"componentType":5125,"count":)" + to_string(indices.size()) + R"(,"type":"SCALAR"}],)"
+		R"("materials":[{"name":"Grid"}],)"
+		R"("meshes":[{"primitives":[{"attributes":{"POSITION":0,"NORMAL":1,"TEXCOORD_0":2},"indices":3,"material":0}]}]})";
+	json.resize((json.size() + 3) & ~size_t(3), ' ');
+
+	const uint32_t jsonLength = static_cast<uint32_t>(json.size());
+	const uint32_t binLength = static_cast<uint32_t>(vertexBytes + indexBytes);
+	const uint32_t header[3] = { 0x46546C67, 2, 12 + 8 + jsonLength + 8 + binLength };
+	const uint32_t jsonChunk[2] = { jsonLength, 0x4E4F534A };
+	const uint32_t binChunk[2] = { binLength, 0x004E4942 };
+	ofstream file(filePath, ios::binary | ios::trunc);
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(jsonChunk), sizeof(jsonChunk));
+	file.write(json.data(), json.size());
+	file.write(reinterpret_cast<const char*>(binChunk), sizeof(binChunk));
+	file.write(reinterpret_cast<const char*>(vertexData.data()), vertexBytes);
+	file.write(reinterpret_cast<const char*>(indices.data()), indexBytes);
+}
+
+void WriteObj(const string& filePath, const vector<Vertex>& vertices, const vector<uint32_t>& indices)
+{
+	// the importer mirrors z and reverses the winding, so write the grid back in OBJ's handedness
+	ofstream file(filePath, ios::trunc);
+	char line[128];
+	for (const Vertex& vertex : vertices)
+	{
+		snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", vertex.pos.x, vertex.pos.y, -vertex.pos.z);
+		file << line;
+		snprintf(line, sizeof(line), "vt %.6f %.6f\n", vertex.texCoord.x, 1.0f - vertex.texCoord.y);
+		file << line;
+		snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", vertex.normal.x, vertex.normal.y, -vertex.normal.z);
+		file << line;
+	}
+	file << "usemtl Grid\n";
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		uint32_t a = indices[i] + 1, b = indices[i + 2] + 1, c = indices[i + 1] + 1;
+		snprintf(line, sizeof(line), "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+		file << line;
+	}
+}
+
+using ImportFunction = bool (*)(const string&, MeshFileData&);
+using ConvertFunction = bool (*)(const string&, const string&, VertexFormat);
+
+void Report(const char* name, const string& sourcePath, const string& meshPath, ImportFunction import, ConvertFunction convert)
+{
+	const double sourceMB = static_cast<double>(filesystem::file_size(sourcePath)) / (1024.0 * 1024.0);
+	MeshFileData data;
+	double importTime = MeasureMilliseconds(3, [&]() { import(sourcePath, data); });
+	double convertTime = MeasureMilliseconds(3, [&]() { convert(sourcePath, meshPath, VertexFormat::Default); });
+	printf("%-5s %9.1f %10.2f %10.1f %11.2f %11.1f\n", name, sourceMB, importTime, sourceMB * 1000.0 / importTime,
+		convertTime, sourceMB * 1000.0 / convertTime);
+}
+}
+
+// Import and .lmesh conversion throughput of a 1024x1024 grid (2M triangles) as .glb and as .obj, in MB of
+// source file per second, followed by the time to map, validate and read the converted file
+int main()
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateGrid(1024, 1024, 1.0f, vertices, indices);
+
+	const string glbPath = GetTempPath("LunarImportBenchmark.glb");
+	const string objPath = GetTempPath("LunarImportBenchmark.obj");
+	const string meshPath = GetTempPath("LunarImportBenchmark.lmesh");
+	WriteGlb(glbPath, vertices, indices);
+	WriteObj(objPath, vertices, indices);
+
+	printf("%zu vertices, %zu triangles\n", vertices.size(), indices.size() / 3);
+	printf("%-5s %9s %10s %10s %11s %11s\n", "file", "source MB", "import ms", "import MB/s", "convert ms", "convert MB/s");
+	Report("glb", glbPath, meshPath, GltfImporter::Import, GltfImporter::ConvertToMeshFile);
+	Report("obj", objPath, meshPath, ObjImporter::Import, ObjImporter::ConvertToMeshFile);
+
+	// the vertex and index sections are copied out as Mesh copies them into its upload buffers, so every
+	// mapped page is faulted in and the time is not just the mapping
+	MeshFile meshFile;
+	vector<char> uploadMemory;
+	double openTime = MeasureMilliseconds(5, [&]()
+	{
+		meshFile.Close();
+		if (!meshFile.Open(meshPath)) return;
+		uploadMemory.resize(meshFile.GetVertexDataSize() + meshFile.GetIndexDataSize());
+		memcpy(uploadMemory.data(), meshFile.GetVertexData(), meshFile.GetVertexDataSize());
+		memcpy(uploadMemory.data() + meshFile.GetVertexDataSize(), meshFile.GetIndexData(), meshFile.GetIndexDataSize());
+	});
+	const double meshMB = static_cast<double>(filesystem::file_size(meshPath)) / (1024.0 * 1024.0);
+	printf(".lmesh open and read %.3f ms for %.1f MB (%.0f MB/s)\n", openTime, meshMB, meshMB * 1000.0 / openTime);
+	meshFile.Close();
+
+	filesystem::remove(glbPath);
+	filesystem::remove(objPath);
+	filesystem::remove(meshPath);
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Geometry/GltfImporter.h"
+#include "Geometry/MeshFile.h"
+#include "Geometry/ObjImporter.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+string GetTempPath(const string& fileName)
+{
+	return (filesystem::temp_directory_path() / fileName).string();
+}
+
+void WriteFile(const string& filePath, const void* data, size_t size)
+{
+	ofstream file(filePath, ios::binary | ios::trunc);
+	file.write(static_cast<const char*>(data), static_cast<streamsize>(size));
+}
+
+vector<char> ReadFile(const string& filePath)
+{
+	ifstream file(filePath, ios::binary);
+	return vector<char>(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+}
+
+// One mesh of two quads, a primitive each: the first uses material 1, the second has no material
+void WriteTwoQuadGltf(const string& gltfPath, const string& binFileName,
+	const string& firstPositions = R"({ "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3", "min": [ 0, 0, 0 ], "max": [ 1, 1, 0 ] })")
+{
+	struct Buffer
+	{
+		float    positions[2][4][3];
+		uint16_t indices[2][6];
+	} buffer = {
+		{ { { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 } }, { { 2, 0, 0 }, { 3, 0, 0 }, { 3, 1, 0 }, { 2, 1, 0 } } },
+		{ { 0, 1, 2, 0, 2, 3 }, { 0, 1, 2, 0, 2, 3 } } };
+	WriteFile(GetTempPath(binFileName), &buffer, sizeof(buffer));
+
+	const string json = R"({
+		"asset": { "version": "2.0" },
+		"buffers": [ { "uri": ")" + binFileName + R"(", "byteLength": 120 } ],
+		"bufferViews": [
+			{ "buffer": 0, "byteOffset": 0, "byteLength": 48 },
+			{ "buffer": 0, "byteOffset": 48, "byteLength": 48 },
+			{ "buffer": 0, "byteOffset": 96, "byteLength": 12 },
+			{ "buffer": 0, "byteOffset": 108, "byteLength": 12 } ],
+		"accessors": [
+			)" + firstPositions + R"(,
+			{ "bufferView": 1, "componentType": 5126, "count": 4, "type": "VEC3", "min": [ 2, 0, 0 ], "max": [ 3, 1, 0 ] },
+			{ "bufferView": 2, "componentType": 5123, "count": 6, "type": "SCALAR" },
+			{ "bufferView": 3, "componentType": 5123, "count": 6, "type": "SCALAR" } ],
+		"materials": [
+			{ "name": "Red", "pbrMetallicRoughness": { "baseColorFactor": [ 1, 0, 0, 1 ] } },
+			{ "name": "Blue", "pbrMetallicRoughness": { "baseColorFactor": [ 0, 0, 1, 1 ], "metallicFactor": 0.25, "roughnessFactor": 0.5 } } ],
+		"meshes": [ { "primitives": [
+			{ "attributes": { "POSITION": 0 }, "indices": 2, "material": 1 },
+			{ "attributes": { "POSITION": 1 }, "indices": 3 } ] } ]
+	})";
+	WriteFile(gltfPath, json.data(), json.size());
+}
+
+const MeshFileMaterial& GetSubmeshMaterial(const MeshFile& meshFile, uint32_t submeshIndex)
+{
+	return meshFile.GetMaterials()[meshFile.GetSubmeshes()[submeshIndex].materialIndex];
+}
+}
+
+TEST_CASE(GltfPrimitivesKeepTheirMaterials)
+{
+	const string gltfPath = GetTempPath("LunarImportTwoQuads.gltf");
+	const string meshPath = GetTempPath("LunarImportTwoQuads.lmesh");
+	WriteTwoQuadGltf(gltfPath, "LunarImportTwoQuads.bin");
+	CHECK(GltfImporter::ConvertToMeshFile(gltfPath, meshPath));
+
+	MeshFile meshFile;
+	bool opened = meshFile.Open(meshPath);
+	CHECK(opened);
+	if (!opened) return;
+	const MeshFileHeader& header = meshFile.GetHeader();
+	CHECK(header.vertexCount == 8);
+	CHECK(header.indexCount == 12);
+	CHECK(header.submeshCount == 2);
+	// the unused material is kept, and the primitive without one gets a default appended
+	CHECK(header.materialCount == 3);
+	if (header.submeshCount != 2 || header.materialCount != 3) return;
+
+	CHECK(meshFile.GetSubmeshes()[0].startIndex == 0 && meshFile.GetSubmeshes()[0].indexCount == 6);
+	CHECK(meshFile.GetSubmeshes()[1].startIndex == 6 && meshFile.GetSubmeshes()[1].indexCount == 6);
+	const MeshFileMaterial& blue = GetSubmeshMaterial(meshFile, 0);
+	CHECK(strcmp(blue.name, "Blue") == 0);
+	CHECK_NEAR(blue.baseColor.z, 1.0f, 0.0f);
+	CHECK_NEAR(blue.baseColor.x, 0.0f, 0.0f);
+	CHECK_NEAR(blue.metallic, 0.25f, 0.0f);
+	CHECK_NEAR(blue.roughness, 0.5f, 0.0f);
+	CHECK(strcmp(GetSubmeshMaterial(meshFile, 1).name, "default") == 0);
+	CHECK(strcmp(meshFile.GetMaterials()[0].name, "Red") == 0);
+}
+
+// Counts and offsets that are negative, fractional or too large to address anything drop their primitive
+// instead of wrapping around when converted to size_t
+TEST_CASE(GltfAccessorsWithBadSizesAreRejected)
+{
+	const string gltfPath = GetTempPath("LunarImportBadAccessor.gltf");
+	for (const char* badAccessor : {
+		R"({ "bufferView": 0, "componentType": 5126, "count": -1, "type": "VEC3" })",
+		R"({ "bufferView": 0, "componentType": 5126, "count": 3.5, "type": "VEC3" })",
+		R"({ "bufferView": 0, "componentType": 5126, "count": 1e300, "type": "VEC3" })",
+		R"({ "bufferView": 0, "componentType": 5126, "count": 4503599627370496, "type": "VEC3" })",
+		R"({ "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3", "byteOffset": 18446744073709551615 })",
+		R"({ "bufferView": 0, "componentType": 5126, "count": 4, "type": "VEC3", "byteOffset": 4 })" })
+	{
+		WriteTwoQuadGltf(gltfPath, "LunarImportBadAccessor.bin", badAccessor);
+		MeshFileData data;
+		CHECK(GltfImporter::Import(gltfPath, data));
+		CHECK(data.submeshes.size() == 1);
+		CHECK(data.vertices.size() == 4 && data.indices.size() == 6);
+	}
+}
+
+TEST_CASE(ObjFacesBeforeUsemtlGetADefaultMaterial)
+{
+	const string objPath = GetTempPath("LunarImportQuad.obj");
+	const string meshPath = GetTempPath("LunarImportQuad.lmesh");
+	const string obj =
+		"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+		"f 1 2 3\n"
+		"usemtl Red\n"
+		"f 1 3 4\n";
+	WriteFile(objPath, obj.data(), obj.size());
+	CHECK(ObjImporter::ConvertToMeshFile(objPath, meshPath));
+
+	MeshFile meshFile;
+	bool opened = meshFile.Open(meshPath);
+	CHECK(opened);
+	if (!opened) return;
+	const MeshFileHeader& header = meshFile.GetHeader();
+	CHECK(header.submeshCount == 2);
+	CHECK(header.materialCount == 2);
+	if (header.submeshCount != 2 || header.materialCount != 2) return;
+	CHECK(strcmp(GetSubmeshMaterial(meshFile, 0).name, "default") == 0);
+	CHECK(strcmp(GetSubmeshMaterial(meshFile, 1).name, "Red") == 0);
+}
+
+TEST_CASE(MeshFileRejectsOutOfRangeMaterials)
+{
+	const string gltfPath = GetTempPath("LunarImportTwoQuads.gltf");
+	const string meshPath = GetTempPath("LunarImportTwoQuads.lmesh");
+	const string corruptPath = GetTempPath("LunarImportCorrupt.lmesh");
+	WriteTwoQuadGltf(gltfPath, "LunarImportTwoQuads.bin");
+	CHECK(GltfImporter::ConvertToMeshFile(gltfPath, meshPath));
+
+	vector<char> bytes = ReadFile(meshPath);
+	if (bytes.size() < sizeof(MeshFileHeader)) return;
+	MeshFileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	const size_t materialIndexOffset = header.submeshOffset + sizeof(MeshFileSubmesh) + offsetof(MeshFileSubmesh, materialIndex);
+	memcpy(bytes.data() + materialIndexOffset, &header.materialCount, sizeof(uint32_t));
+	WriteFile(corruptPath, bytes.data(), bytes.size());
+	MeshFile meshFile;
+	CHECK(!meshFile.Open(corruptPath));
+
+	// material names are read as C strings, so they must be terminated
+	bytes = ReadFile(meshPath);
+	memset(bytes.data() + header.materialOffset, 'x', sizeof(MeshFileMaterial::name));
+	WriteFile(corruptPath, bytes.data(), bytes.size());
+	CHECK(!meshFile.Open(corruptPath));
+}
+
+TEST_CASE(MeshFileIsStaleInAnotherFormatOrLayout)
+{
+	const string gltfPath = GetTempPath("LunarImportTwoQuads.gltf");
+	const string meshPath = GetTempPath("LunarImportTwoQuads.lmesh");
+	const string stalePath = GetTempPath("LunarImportStale.lmesh");
+	WriteTwoQuadGltf(gltfPath, "LunarImportTwoQuads.bin");
+	CHECK(GltfImporter::ConvertToMeshFile(gltfPath, meshPath, VertexFormat::Compact));
+	CHECK(MeshFile::IsCurrent(meshPath, VertexFormat::Compact));
+	CHECK(!MeshFile::IsCurrent(meshPath, VertexFormat::Default));
+
+	// materials written with the old 184 byte tail are not read with the current layout
+	vector<char> bytes = ReadFile(meshPath);
+	if (bytes.size() < sizeof(MeshFileHeader)) return;
+	MeshFileHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+	bytes.resize(bytes.size() + header.materialCount * 184, 0);
+	header.fileSize = bytes.size();
+	memcpy(bytes.data(), &header, sizeof(header));
+	WriteFile(stalePath, bytes.data(), bytes.size());
+	CHECK(!MeshFile::IsCurrent(stalePath, VertexFormat::Compact));
+	MeshFile meshFile;
+	CHECK(!meshFile.Open(stalePath));
+}
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "Geometry/MeshletBuilder.h"
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+vector<array<uint32_t, 3>> GetSortedTriangles(const vector<uint32_t>& indices)
+{
+	vector<array<uint32_t, 3>> triangles;
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		triangles.push_back({ indices[i], indices[i + 1], indices[i + 2] });
+	}
+	sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Meshlet-local triangles in mesh vertices, with the winding kept
+vector<array<uint32_t, 3>> GetMeshletTriangles(const MeshletData& meshletData, const Meshlet& meshlet)
+{
+	vector<array<uint32_t, 3>> triangles;
+	for (uint32_t triangle = 0; triangle < meshlet.triangleCount; ++triangle)
+	{
+		const uint8_t* local = &meshletData.primitiveIndices[(meshlet.triangleOffset + triangle) * 3];
+		triangles.push_back({ meshletData.vertexIndices[meshlet.vertexOffset + local[0]],
+			meshletData.vertexIndices[meshlet.vertexOffset + local[1]],
+			meshletData.vertexIndices[meshlet.vertexOffset + local[2]] });
+	}
+	return triangles;
+}
+
+void CheckPartition(const vector<Vertex>& vertices, const vector<uint32_t>& indices, const MeshletData& meshletData,
+	uint32_t maxVertices, uint32_t maxTriangles)
+{
+	CHECK(meshletData.bounds.size() == meshletData.meshlets.size());
+	CHECK(meshletData.GetTriangleCount() == indices.size() / 3);
+	CHECK(GetSortedTriangles(MeshletBuilder::BuildIndexBuffer(meshletData)) == GetSortedTriangles(indices));
+
+	for (size_t m = 0; m < meshletData.meshlets.size(); ++m)
+	{
+		const Meshlet& meshlet = meshletData.meshlets[m];
+		CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= maxVertices);
+		CHECK(meshlet.triangleCount > 0 && meshlet.triangleCount <= maxTriangles);
+		for (uint32_t i = 0; i < meshlet.triangleCount * 3; ++i)
+		{
+			CHECK(meshletData.primitiveIndices[meshlet.triangleOffset * 3 + i] < meshlet.vertexCount);
+		}
+
+		vector<uint32_t> meshletVertices(meshletData.vertexIndices.begin() + meshlet.vertexOffset,
+			meshletData.vertexIndices.begin() + meshlet.vertexOffset + meshlet.vertexCount);
+		sort(meshletVertices.begin(), meshletVertices.end());
+		CHECK(adjacent_find(meshletVertices.begin(), meshletVertices.end()) == meshletVertices.end());
+
+		const MeshletBounds& bounds = meshletData.bounds[m];
+		XMVECTOR center = XMLoadFloat3(&bounds.center);
+		for (uint32_t vertex : meshletVertices)
+		{
+			float distance = XMVectorGetX(XMVector3Length(XMVectorSubtract(XMLoadFloat3(&vertices[vertex].pos), center)));
+			CHECK(distance <= bounds.radius * 1.0001f + 1e-6f);
+		}
+	}
+}
+
+// A culled meshlet must not hold a triangle facing the eye
+void CheckBackfaceCullingIsConservative(const vector<Vertex>& vertices, const MeshletData& meshletData, const XMFLOAT3& eyePos)
+{
+	XMVECTOR eye = XMLoadFloat3(&eyePos);
+	for (size_t m = 0; m < meshletData.meshlets.size(); ++m)
+	{
+		if (!MeshletBuilder::IsBackfacing(meshletData.bounds[m], eyePos)) continue;
+		for (const array<uint32_t, 3>& triangle : GetMeshletTriangles(meshletData, meshletData.meshlets[m]))
+		{
+			XMVECTOR a = XMLoadFloat3(&vertices[triangle[0]].pos);
+			XMVECTOR b = XMLoadFloat3(&vertices[triangle[1]].pos);
+			XMVECTOR c = XMLoadFloat3(&vertices[triangle[2]].pos);
+			XMVECTOR normal = XMVector3Cross(XMVectorSubtract(b, a), XMVectorSubtract(c, a));
+			CHECK(XMVectorGetX(XMVector3Dot(normal, XMVectorSubtract(a, eye))) >= 0.0f);
+		}
+	}
+}
+}
+
+TEST_CASE(MeshletsPartitionTheMeshWithinLimits)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(4, vertices, indices);
+	CheckPartition(vertices, indices, MeshletBuilder::Build(vertices, indices), MeshletBuilder::MAX_VERTICES, MeshletBuilder::MAX_TRIANGLES);
+	CheckPartition(vertices, indices, MeshletBuilder::Build(vertices, indices, 32, 40), 32, 40);
+
+	vector<uint16_t> shortIndices(indices.begin(), indices.end());
+	MeshletData shortIndexData = MeshletBuilder::Build(vertices, shortIndices);
+	MeshletData longIndexData = MeshletBuilder::Build(vertices, indices);
+	CHECK(shortIndexData.vertexIndices == longIndexData.vertexIndices);
+	CHECK(shortIndexData.primitiveIndices == longIndexData.primitiveIndices);
+}
+
+// On a closed mesh the vertex limit binds first: greedy growth along shared vertices should nearly reach it and
+// reuse each vertex in more than one triangle
+TEST_CASE(MeshletsAreMostlyFull)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(5, vertices, indices);
+	MeshletData meshletData = MeshletBuilder::Build(vertices, indices);
+	size_t vertexCount = 0;
+	for (const Meshlet& meshlet : meshletData.meshlets)
+	{
+		vertexCount += meshlet.vertexCount;
+	}
+	CHECK(vertexCount > meshletData.meshlets.size() * MeshletBuilder::MAX_VERTICES * 9 / 10);
+	CHECK(meshletData.GetTriangleCount() > vertexCount);
+}
+
+TEST_CASE(NormalConesCullOnlyBackfacingClusters)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(4, vertices, indices);
+	MeshletData meshletData = MeshletBuilder::Build(vertices, indices);
+
+	for (const XMFLOAT3& eyePos : { XMFLOAT3(0.0f, 0.0f, 5.0f), XMFLOAT3(3.0f, -2.0f, 1.0f), XMFLOAT3(0.0f, 1.5f, 0.0f), XMFLOAT3(40.0f, 30.0f, -20.0f) })
+	{
+		CheckBackfaceCullingIsConservative(vertices, meshletData, eyePos);
+	}
+
+	// from far away about half the sphere faces away
+	vector<uint32_t> visibleMeshlets;
+	MeshletBuilder::Cull(meshletData, nullptr, { 0.0f, 0.0f, 100.0f }, visibleMeshlets);
+	CHECK(visibleMeshlets.size() < meshletData.meshlets.size() * 3 / 4);
+	CHECK(visibleMeshlets.size() > meshletData.meshlets.size() / 4);
+	for (uint32_t meshlet : visibleMeshlets)
+	{
+		CHECK(!MeshletBuilder::IsBackfacing(meshletData.bounds[meshlet], { 0.0f, 0.0f, 100.0f }));
+	}
+}
+
+TEST_CASE(FlatClustersCullFromBehind)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateGrid(32, 32, 10.0f, vertices, indices);
+	MeshletData meshletData = MeshletBuilder::Build(vertices, indices);
+
+	vector<uint32_t> visibleMeshlets;
+	MeshletBuilder::Cull(meshletData, nullptr, { 1.0f, 5.0f, 2.0f }, visibleMeshlets);
+	CHECK(visibleMeshlets.size() == meshletData.meshlets.size());
+	MeshletBuilder::Cull(meshletData, nullptr, { 1.0f, -5.0f, 2.0f }, visibleMeshlets);
+	CHECK(visibleMeshlets.empty());
+}
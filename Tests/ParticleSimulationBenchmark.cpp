@@ -0,0 +1,90 @@
+#include <cstdio>
+#include <vector>
+
+#include "ParticleSimulation.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// The loop the SoA streams replaced: one particle at a time on the GPU layout
+void StepInterleaved(vector<ParticleData>& particles, float deltaTime)
+{
+	for (ParticleData& particle : particles)
+	{
+		if (!(particle.age < particle.lifetime)) continue;
+		particle.age += deltaTime;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			particle.position[axis] += particle.velocity[axis] * deltaTime;
+			particle.velocity[axis] += particle.force[axis] * deltaTime;
+		}
+	}
+}
+}
+
+// One 60 Hz step of a full pool, SoA Euler and Verlet against the interleaved loop, and packing for upload
+int main()
+{
+	printf("%9s %9s %9s %12s %9s\n", "particles", "euler ms", "verlet ms", "interleaved", "write ms");
+	for (size_t capacity : { size_t(1) << 16, size_t(1) << 20, size_t(4) << 20 })
+	{
+		ParticleSimulation simulation;
+		simulation.Resize(capacity);
+		simulation.Spawn(static_cast<uint32_t>(capacity), { 0.0f, 0.0f, 0.0f }, 1);
+		vector<ParticleData> particles(capacity);
+		simulation.WriteParticles(particles.data());
+
+		// steps short enough that nothing dies while measuring
+		double eulerTime = MeasureMilliseconds(10, [&]() { simulation.Step(1e-4f); });
+		double verletTime = MeasureMilliseconds(10, [&]() { simulation.Step(1e-4f, ParticleIntegrator::Verlet); });
+		double interleavedTime = MeasureMilliseconds(10, [&]() { StepInterleaved(particles, 1e-4f); });
+		double writeTime = MeasureMilliseconds(5, [&]() { simulation.WriteParticles(particles.data()); });
+		printf("%9zu %9.2f %9.2f %12.2f %9.2f\n", capacity, eulerTime, verletTime, interleavedTime, writeTime);
+	}
+
+	// Steady state of an emitter keeping about half the pool alive: Step includes compacting the lists
+	printf("\n%9s %9s %9s %9s %9s\n", "capacity", "alive", "spawn ms", "step ms", "lists ms");
+	for (size_t capacity : { size_t(1) << 16, size_t(1) << 20, size_t(4) << 20 })
+	{
+		ParticleSimulation simulation;
+		simulation.Resize(capacity);
+		ParticleEmitter emitter;
+		emitter.spawnRate = capacity / 10.0f;
+		emitter.spawnBudget = static_cast<uint32_t>(capacity);
+		uint32_t frame = 0;
+		for (; frame < 300; ++frame)
+		{
+			simulation.Step(0.05f);
+			simulation.Spawn(emitter.Update(0.05f), { 0.0f, 0.0f, 0.0f }, frame);
+		}
+		double stepTime = MeasureMilliseconds(20, [&]() { simulation.Step(0.016f); });
+		double spawnTime = MeasureMilliseconds(20, [&]() { simulation.Spawn(emitter.Update(0.016f), { 0.0f, 0.0f, 0.0f }, frame++); });
+		vector<uint32_t> lists(ParticleSimulation::GetListBufferSize(capacity) / sizeof(uint32_t));
+		double listsTime = MeasureMilliseconds(5, [&]() { simulation.WriteLists(lists.data()); });
+		printf("%9zu %9zu %9.3f %9.2f %9.2f\n", capacity, simulation.GetAliveCount(), spawnTime, stepTime, listsTime);
+	}
+
+	// Cost of the colliders tested after every substep, for 1M particles
+	printf("\n%9s %9s %9s\n", "planes", "spheres", "step ms");
+	for (int colliderCount : { 0, 1, 8 })
+	{
+		ParticleColliders colliders;
+		for (int i = 0; i < colliderCount; ++i)
+		{
+			colliders.planes.push_back({ { 0.0f, 1.0f, 0.0f, -0.1f * i }, { 0.25f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.25f, 0.0f } });
+			colliders.spheres.push_back({ static_cast<float>(i), 0.0f, 0.0f, 0.5f });
+		}
+		ParticleSimulation simulation;
+		simulation.Resize(size_t(1) << 20);
+		simulation.SetColliders(colliders);
+		simulation.Spawn(1 << 20, { 0.0f, 1.0f, 0.0f }, 1);
+		double stepTime = MeasureMilliseconds(5, [&]() { simulation.Step(1.0f / 60.0f, ParticleIntegrator::Verlet); });
+		printf("%9d %9d %9.2f\n", colliderCount, colliderCount, stepTime);
+	}
+	return 0;
+}
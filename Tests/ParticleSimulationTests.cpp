@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "ParticleSimulation.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// Explicit Euler as ParticlesComputeShader.hlsl runs it, one particle at a time on the GPU layout
+void StepReference(vector<ParticleData>& particles, float deltaTime)
+{
+	uint32_t substepCount = ParticleSimulation::GetSubstepCount(deltaTime);
+	float substepTime = deltaTime / static_cast<float>(substepCount);
+	for (ParticleData& particle : particles)
+	{
+		if (!(particle.age < particle.lifetime)) continue;
+		for (uint32_t substep = 0; substep < substepCount; ++substep)
+		{
+			particle.age += substepTime;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				particle.position[axis] += particle.velocity[axis] * substepTime;
+				particle.velocity[axis] += particle.force[axis] * substepTime;
+			}
+		}
+	}
+}
+
+size_t CountAlive(const vector<ParticleData>& particles)
+{
+	return count_if(particles.begin(), particles.end(), [](const ParticleData& particle) { return particle.age < particle.lifetime; });
+}
+
+// Every slot is on exactly one list, each list holds only particles of its kind, and the alive list is in slot order
+bool ListsPartitionTheSlots(const ParticleSimulation& simulation, vector<ParticleData>& particles)
+{
+	const vector<uint32_t>& aliveList = simulation.GetAliveList();
+	const vector<uint32_t>& deadList = simulation.GetDeadList();
+	if (aliveList.size() + deadList.size() != simulation.GetCount() || aliveList.size() != simulation.GetAliveCount()) return false;
+	if (!is_sorted(aliveList.begin(), aliveList.end())) return false;
+
+	simulation.WriteParticles(particles.data());
+	vector<uint8_t> seen(simulation.GetCount(), 0);
+	for (uint32_t i : aliveList)
+	{
+		if (i >= seen.size() || seen[i]++ || !(particles[i].age < particles[i].lifetime)) return false;
+	}
+	for (uint32_t i : deadList)
+	{
+		if (i >= seen.size() || seen[i]++ || particles[i].age < particles[i].lifetime) return false;
+	}
+	return true;
+}
+
+// The y = 0 plane as a square of half size 4 around the origin
+ParticlePlaneCollider CreateGround()
+{
+	return { { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.25f, 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 0.25f, 0.0f } };
+}
+}
+
+TEST_CASE(SubstepCountSplitsLongFrames)
+{
+	CHECK(ParticleSimulation::GetSubstepCount(0.0f) == 1);
+	CHECK(ParticleSimulation::GetSubstepCount(1.0f / 60.0f) == 1);
+	CHECK(ParticleSimulation::GetSubstepCount(0.02f) == 2);
+	CHECK(ParticleSimulation::GetSubstepCount(0.05f) == 3);
+	CHECK(ParticleSimulation::GetSubstepCount(1.0f) == 8);
+	CHECK(ParticleSimulation::GetSubstepCount(NAN) == 1);
+}
+
+// Both the gathered and the swept paths must match the shader bit for bit, through every particle dying
+TEST_CASE(EulerStepMatchesTheComputeShader)
+{
+	for (size_t capacity : { size_t(1), size_t(3), size_t(4), size_t(5), size_t(4097), size_t(30011) })
+	{
+		ParticleSimulation simulation;
+		simulation.Resize(capacity);
+		CHECK(simulation.Spawn(static_cast<uint32_t>(capacity), { 1.0f, 2.0f, 3.0f }, 7) == capacity);
+		vector<ParticleData> reference(capacity), particles(capacity);
+		simulation.WriteParticles(reference.data());
+
+		bool countsMatch = true;
+		for (int step = 0; step < 700; ++step)
+		{
+			float deltaTime = 0.016f + 0.001f * (step % 5);
+			simulation.Step(deltaTime);
+			StepReference(reference, deltaTime);
+			countsMatch &= simulation.GetAliveCount() == CountAlive(reference);
+		}
+		CHECK(countsMatch);
+		CHECK(simulation.GetAliveCount() == 0);
+		simulation.WriteParticles(particles.data());
+		CHECK(memcmp(particles.data(), reference.data(), capacity * sizeof(ParticleData)) == 0);
+	}
+}
+
+// Verlet is exact for a constant force, so the step size must not change the path
+TEST_CASE(VerletIsIndependentOfTheFrameRate)
+{
+	ParticleSimulation fine, coarse;
+	fine.Resize(1000);
+	coarse.Resize(1000);
+	fine.Spawn(1000, { 0.0f, 0.0f, 0.0f }, 3);
+	coarse.Spawn(1000, { 0.0f, 0.0f, 0.0f }, 3);
+	for (int step = 0; step < 60; ++step) fine.Step(0.01f, ParticleIntegrator::Verlet);
+	for (int step = 0; step < 6; ++step) coarse.Step(0.1f, ParticleIntegrator::Verlet);
+
+	vector<ParticleData> fineParticles(1000), coarseParticles(1000);
+	fine.WriteParticles(fineParticles.data());
+	coarse.WriteParticles(coarseParticles.data());
+	float maxDifference = 0.0f;
+	for (size_t i = 0; i < fineParticles.size(); ++i)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			maxDifference = max(maxDifference, fabsf(fineParticles[i].position[axis] - coarseParticles[i].position[axis]));
+		}
+	}
+	CHECK(maxDifference < 1e-3f);
+	CHECK(fine.GetAliveCount() == coarse.GetAliveCount());
+}
+
+TEST_CASE(SpawnsDependOnlyOnTheSeed)
+{
+	const size_t capacity = 1 << 16;
+	ParticleSimulation first, second;
+	first.Resize(capacity);
+	second.Resize(capacity);
+	first.Spawn(static_cast<uint32_t>(capacity), { 0.0f, 0.0f, 0.0f }, 11);
+	second.Spawn(static_cast<uint32_t>(capacity), { 0.0f, 0.0f, 0.0f }, 11);
+	vector<ParticleData> firstParticles(capacity), secondParticles(capacity);
+	first.WriteParticles(firstParticles.data());
+	second.WriteParticles(secondParticles.data());
+	CHECK(memcmp(firstParticles.data(), secondParticles.data(), capacity * sizeof(ParticleData)) == 0);
+
+	bool inRange = true;
+	double meanVelocityX = 0.0;
+	for (const ParticleData& particle : firstParticles)
+	{
+		inRange &= particle.velocity[0] >= 0.0f && particle.velocity[0] < 1.0f;
+		inRange &= particle.velocity[1] >= 1.0f && particle.velocity[1] < 2.0f;
+		inRange &= particle.lifetime >= 1.0f && particle.lifetime <= 10.0f && particle.lifetime == floorf(particle.lifetime);
+		inRange &= particle.age == 0.0f && particle.force[1] < 0.0f;
+		meanVelocityX += particle.velocity[0];
+	}
+	CHECK(inRange);
+	CHECK_NEAR(meanVelocityX / capacity, 0.5, 0.01);
+
+	ParticleSimulation reseeded;
+	reseeded.Resize(capacity);
+	reseeded.Spawn(static_cast<uint32_t>(capacity), { 0.0f, 0.0f, 0.0f }, 12);
+	reseeded.WriteParticles(secondParticles.data());
+	CHECK(memcmp(firstParticles.data(), secondParticles.data(), capacity * sizeof(ParticleData)) != 0);
+}
+
+TEST_CASE(AliveAndDeadListsPartitionTheSlots)
+{
+	for (size_t capacity : { size_t(1), size_t(7), size_t(5000) })
+	{
+		ParticleSimulation simulation;
+		simulation.Resize(capacity);
+		vector<ParticleData> particles(capacity);
+		CHECK(ListsPartitionTheSlots(simulation, particles));
+
+		ParticleEmitter emitter;
+		emitter.spawnRate = capacity * 0.7f;
+		emitter.spawnBudget = max<uint32_t>(1, static_cast<uint32_t>(capacity / 8));
+		bool partitioned = true;
+		size_t peakAliveCount = 0;
+		for (int frame = 0; frame < 600; ++frame)
+		{
+			// hitches for the substeps, and bursts bigger than the pool
+			float deltaTime = frame % 61 == 60 ? 0.4f : 0.004f + 0.006f * (frame % 7);
+			if (frame % 97 == 0) emitter.Burst(static_cast<uint32_t>(capacity * 2));
+			simulation.Step(deltaTime, frame % 2 ? ParticleIntegrator::Verlet : ParticleIntegrator::Euler);
+			simulation.Spawn(emitter.Update(deltaTime), { 0.0f, 1.0f, 2.0f }, frame);
+			partitioned &= ListsPartitionTheSlots(simulation, particles);
+			peakAliveCount = max(peakAliveCount, simulation.GetAliveCount());
+		}
+		CHECK(partitioned);
+		CHECK(peakAliveCount == capacity);
+	}
+}
+
+TEST_CASE(SpawnsBeyondTheDeadListAreDropped)
+{
+	ParticleSimulation simulation;
+	simulation.Resize(100);
+	CHECK(simulation.Spawn(60, { 0.0f, 0.0f, 0.0f }, 1) == 60);
+	CHECK(simulation.Spawn(60, { 0.0f, 0.0f, 0.0f }, 2) == 40);
+	CHECK(simulation.Spawn(1, { 0.0f, 0.0f, 0.0f }, 3) == 0);
+	CHECK(simulation.GetAliveCount() == 100);
+	CHECK(simulation.GetDeadList().empty());
+}
+
+TEST_CASE(EmitterCarriesOverWhatTheBudgetHoldsBack)
+{
+	ParticleEmitter rate;
+	rate.spawnRate = 100.0f;
+	uint64_t rateTotal = 0;
+	for (int frame = 0; frame < 1000; ++frame) rateTotal += rate.Update(0.016f);
+	CHECK(rateTotal >= 1599 && rateTotal <= 1600);
+
+	// a burst drains over as many frames as the budget needs, and goes before the rate
+	ParticleEmitter burst;
+	burst.spawnBudget = 1024;
+	burst.spawnRate = 1000.0f;
+	burst.Burst(5000);
+	uint32_t counts[6];
+	for (uint32_t& count : counts) count = burst.Update(0.016f);
+	CHECK(counts[0] == 1024 && counts[1] == 1024 && counts[2] == 1024 && counts[3] == 1024);
+	// the last of the burst leaves room for the rate's backlog, after which the rate runs alone
+	CHECK(counts[4] > 5000 - 4 * 1024 && counts[4] < 1024);
+	CHECK(counts[5] >= 15 && counts[5] <= 17);
+
+	// a rate the budget cannot keep up with backs up by one budget at most
+	ParticleEmitter flood;
+	flood.spawnBudget = 100;
+	flood.spawnRate = 1e6f;
+	for (int frame = 0; frame < 100; ++frame) CHECK(flood.Update(0.016f) == 100);
+	flood.spawnRate = 0.0f;
+	CHECK(flood.Update(0.016f) == 0);
+}
+
+TEST_CASE(ListBufferMatchesTheShaderLayout)
+{
+	const size_t capacity = 300;
+	ParticleSimulation simulation;
+	simulation.Resize(capacity);
+	simulation.Spawn(200, { 0.0f, 0.0f, 0.0f }, 5);
+	simulation.Step(1.5f);
+	vector<uint32_t> lists(ParticleSimulation::GetListBufferSize(capacity) / sizeof(uint32_t));
+	simulation.WriteLists(lists.data());
+
+	const ParticleListHeader& header = *reinterpret_cast<const ParticleListHeader*>(lists.data());
+	const vector<uint32_t>& aliveList = simulation.GetAliveList();
+	const vector<uint32_t>& deadList = simulation.GetDeadList();
+	CHECK(aliveList.size() > 0 && aliveList.size() < 200);
+	CHECK(header.deadCount == deadList.size());
+	CHECK(header.aliveCount[0] == aliveList.size() && header.aliveCount[1] == 0);
+	CHECK(header.drawArguments[0] == 1 && header.drawArguments[1] == aliveList.size());
+	CHECK(header.drawArguments[2] == 0 && header.drawArguments[3] == 0);
+	CHECK(header.dispatchArguments[0] == (aliveList.size() + PARTICLE_THREAD_GROUP_SIZE - 1) / PARTICLE_THREAD_GROUP_SIZE);
+	CHECK(header.dispatchArguments[1] == 1 && header.dispatchArguments[2] == 1);
+
+	const uint32_t* deadLanes = lists.data() + sizeof(ParticleListHeader) / sizeof(uint32_t);
+	CHECK(memcmp(deadLanes, deadList.data(), deadList.size() * sizeof(uint32_t)) == 0);
+	CHECK(memcmp(deadLanes + capacity, aliveList.data(), aliveList.size() * sizeof(uint32_t)) == 0);
+}
+
+// Particles fall onto a ground plane and a sphere for four seconds, at frame rates whose steps cover several
+// particle radii, and must neither tunnel through the ground nor end up inside the sphere
+TEST_CASE(CollidersStopParticlesAtEveryFrameRate)
+{
+	const XMFLOAT4 sphere = { 0.9f, 0.6f, 0.4f, 0.5f };
+	for (ParticleIntegrator integrator : { ParticleIntegrator::Euler, ParticleIntegrator::Verlet })
+	{
+		for (float frameRate : { 30.0f, 60.0f, 144.0f })
+		{
+			ParticleSimulation simulation;
+			simulation.Resize(5000);
+			ParticleColliders colliders;
+			colliders.planes.push_back(CreateGround());
+			colliders.spheres.push_back(sphere);
+			simulation.SetColliders(colliders);
+			simulation.Spawn(5000, { 0.5f, 2.0f, 0.5f }, 7);
+
+			vector<ParticleData> particles(simulation.GetCount());
+			size_t tunnelledCount = 0;
+			float minSphereGap = INFINITY;
+			for (int frame = 0; frame < static_cast<int>(frameRate * 4.0f); ++frame)
+			{
+				simulation.Step(1.0f / frameRate, integrator);
+				simulation.WriteParticles(particles.data());
+				for (uint32_t i : simulation.GetAliveList())
+				{
+					const float* position = particles[i].position;
+					bool overGround = fabsf(position[0]) <= 4.0f && fabsf(position[2]) <= 4.0f;
+					if (overGround && position[1] < 0.0f) ++tunnelledCount;
+					float dx = position[0] - sphere.x, dy = position[1] - sphere.y, dz = position[2] - sphere.z;
+					minSphereGap = min(minSphereGap, sqrtf(dx * dx + dy * dy + dz * dz) - sphere.w);
+				}
+			}
+			CHECK(tunnelledCount == 0);
+			CHECK(minSphereGap > -1e-3f);
+			CHECK(simulation.GetAliveCount() > 0);
+		}
+	}
+}
+
+TEST_CASE(PlanesLetParticlesThroughFromBehind)
+{
+	ParticleSimulation simulation;
+	simulation.Resize(1);
+	ParticleColliders colliders;
+	colliders.planes.push_back(CreateGround());
+	simulation.SetColliders(colliders);
+	// launched upwards at 1 m/s or more from just under the ground, so it rises through and lands on top
+	simulation.Spawn(1, { 0.0f, -0.02f, 0.0f }, 3);
+	ParticleData particle;
+	float maxHeight = -INFINITY;
+	for (int frame = 0; frame < 30; ++frame)
+	{
+		simulation.Step(1.0f / 60.0f, ParticleIntegrator::Verlet);
+		simulation.WriteParticles(&particle);
+		maxHeight = max(maxHeight, particle.position[1]);
+	}
+	CHECK(maxHeight > colliders.particleRadius);
+	CHECK(particle.position[1] >= 0.0f);
+}
+
+TEST_CASE(SpheresPushOutParticlesThatStartInside)
+{
+	ParticleSimulation simulation;
+	simulation.Resize(1000);
+	ParticleColliders colliders;
+	colliders.spheres.push_back({ 0.0f, 0.0f, 0.0f, 1.0f });
+	simulation.SetColliders(colliders);
+	simulation.Spawn(1000, { 0.2f, 0.1f, 0.0f }, 5);
+	simulation.Step(1.0f / 60.0f);
+
+	vector<ParticleData> particles(simulation.GetCount());
+	simulation.WriteParticles(particles.data());
+	float minDistance = INFINITY;
+	for (const ParticleData& particle : particles)
+	{
+		const float* position = particle.position;
+		minDistance = min(minDistance, sqrtf(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]));
+	}
+	CHECK(minDistance > 1.0f - 1e-4f);
+}
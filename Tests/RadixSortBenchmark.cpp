@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "ParticleSimulation.h"
+#include "Utils/RadixSort.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Sorting back-to-front depth keys with particle indices: the radix sort against std::sort on packed key and
+// index pairs and std::stable_sort on the pairs, then SortAliveList with an emitter keeping half of 1M particles alive
+int main()
+{
+	mt19937 random(1);
+	uniform_real_distribution<float> depthDistribution(0.1f, 100.0f);
+	RadixSorter sorter;
+
+	printf("%9s %9s %12s %15s\n", "keys", "radix ms", "std::sort ms", "stable_sort ms");
+	for (size_t count : { size_t(1) << 16, size_t(1) << 18, size_t(1) << 20 })
+	{
+		vector<uint32_t> depthKeys(count), indices(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			depthKeys[i] = ~RadixSorter::FloatToKey(depthDistribution(random));
+			indices[i] = static_cast<uint32_t>(i);
+		}
+
+		vector<uint32_t> keys, values;
+		double radixTime = MeasureMilliseconds(10, [&]() { keys = depthKeys; values = indices; sorter.Sort(keys, values); });
+		vector<uint64_t> packed(count);
+		double sortTime = MeasureMilliseconds(10, [&]()
+		{
+			for (size_t i = 0; i < count; ++i) packed[i] = static_cast<uint64_t>(depthKeys[i]) << 32 | indices[i];
+			sort(packed.begin(), packed.end());
+		});
+		vector<pair<uint32_t, uint32_t>> pairs(count);
+		double stableSortTime = MeasureMilliseconds(10, [&]()
+		{
+			for (size_t i = 0; i < count; ++i) pairs[i] = { depthKeys[i], indices[i] };
+			stable_sort(pairs.begin(), pairs.end(), [](const pair<uint32_t, uint32_t>& a, const pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+		});
+		printf("%9zu %9.2f %12.2f %15.2f\n", count, radixTime, sortTime, stableSortTime);
+	}
+
+	const size_t capacity = size_t(1) << 20;
+	ParticleSimulation simulation;
+	simulation.Resize(capacity);
+	ParticleEmitter emitter;
+	emitter.spawnRate = capacity / 10.0f;
+	emitter.spawnBudget = static_cast<uint32_t>(capacity);
+	for (uint32_t frame = 0; frame < 300; ++frame)
+	{
+		simulation.Step(0.05f);
+		simulation.Spawn(emitter.Update(0.05f), { 0.0f, 0.0f, 0.0f }, frame);
+	}
+	double aliveSortTime = MeasureMilliseconds(10, [&]() { simulation.SortAliveList({ 0.3f, -0.2f, 0.93f, 4.0f }); });
+	printf("\nSortAliveList with %zu alive: %.2f ms\n", simulation.GetAliveCount(), aliveSortTime);
+	return 0;
+}
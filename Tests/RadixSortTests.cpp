@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "ParticleSimulation.h"
+#include "Utils/RadixSort.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+enum class KeyDistribution
+{
+	Uniform,
+	OneDigit,	// only the second byte varies, so three of the four passes are skipped
+	Constant,
+	Float
+};
+
+bool SortMatchesStableSort(RadixSorter& sorter, size_t count, KeyDistribution distribution, mt19937& random)
+{
+	uniform_real_distribution<float> floatDistribution(-50.0f, 50.0f);
+	vector<uint32_t> keys(count), values(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		values[i] = static_cast<uint32_t>(i);
+		switch (distribution)
+		{
+		case KeyDistribution::Uniform:  keys[i] = random(); break;
+		case KeyDistribution::OneDigit: keys[i] = random() & 0xFF00; break;
+		case KeyDistribution::Constant: keys[i] = 7; break;
+		case KeyDistribution::Float:    keys[i] = RadixSorter::FloatToKey(floatDistribution(random)); break;
+		}
+	}
+
+	vector<pair<uint32_t, uint32_t>> expected(count);
+	for (size_t i = 0; i < count; ++i) expected[i] = { keys[i], values[i] };
+	stable_sort(expected.begin(), expected.end(), [](const pair<uint32_t, uint32_t>& a, const pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+
+	sorter.Sort(keys, values);
+	for (size_t i = 0; i < count; ++i)
+	{
+		if (keys[i] != expected[i].first || values[i] != expected[i].second) return false;
+	}
+	return true;
+}
+
+float GetViewDepth(const ParticleData& particle, const XMFLOAT4& viewDepth)
+{
+	return particle.position[0] * viewDepth.x + particle.position[1] * viewDepth.y + particle.position[2] * viewDepth.z + viewDepth.w;
+}
+}
+
+TEST_CASE(FloatKeysKeepTheFloatOrder)
+{
+	const float values[] = { -INFINITY, -1e30f, -2.0f, -1.0f, -1e-30f, -0.0f, 0.0f, 1e-30f, 1.0f, 2.0f, 1e30f, INFINITY };
+	bool ordered = true;
+	for (size_t i = 0; i + 1 < size(values); ++i)
+	{
+		ordered &= RadixSorter::FloatToKey(values[i]) < RadixSorter::FloatToKey(values[i + 1]);
+	}
+	CHECK(ordered);
+}
+
+// Sizes around the chunk size, and keys that skip passes, all sorted by one sorter reusing its scratch
+TEST_CASE(SortMatchesStableSort)
+{
+	RadixSorter sorter;
+	mt19937 random(1);
+	for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(255), size_t(16384), size_t(16385), size_t(100003) })
+	{
+		CHECK(SortMatchesStableSort(sorter, count, KeyDistribution::Uniform, random));
+		CHECK(SortMatchesStableSort(sorter, count, KeyDistribution::OneDigit, random));
+		CHECK(SortMatchesStableSort(sorter, count, KeyDistribution::Constant, random));
+		CHECK(SortMatchesStableSort(sorter, count, KeyDistribution::Float, random));
+	}
+}
+
+TEST_CASE(AliveListSortsBackToFront)
+{
+	const size_t capacity = 100000;
+	ParticleSimulation simulation;
+	simulation.Resize(capacity);
+	for (int frame = 0; frame < 40; ++frame)
+	{
+		simulation.Step(0.05f);
+		simulation.Spawn(4000, { static_cast<float>(frame % 5), 0.0f, static_cast<float>(frame % 3) }, frame);
+	}
+	const XMFLOAT4 viewDepth = { 0.3f, -0.2f, 0.93f, 4.0f };
+	simulation.SortAliveList(viewDepth);
+
+	const vector<uint32_t>& drawList = simulation.GetDrawList();
+	vector<ParticleData> particles(capacity);
+	simulation.WriteParticles(particles.data());
+	bool backToFront = true;
+	float previousDepth = INFINITY;
+	for (uint32_t i : drawList)
+	{
+		float depth = GetViewDepth(particles[i], viewDepth);
+		backToFront &= depth <= previousDepth;
+		previousDepth = depth;
+	}
+	CHECK(backToFront);
+	vector<uint32_t> drawnSlots = drawList;
+	sort(drawnSlots.begin(), drawnSlots.end());
+	CHECK(drawnSlots == simulation.GetAliveList());
+
+	vector<uint32_t> lists(ParticleSimulation::GetListBufferSize(capacity) / sizeof(uint32_t));
+	simulation.WriteLists(lists.data());
+	CHECK(memcmp(lists.data() + sizeof(ParticleListHeader) / sizeof(uint32_t) + capacity, drawList.data(), drawList.size() * sizeof(uint32_t)) == 0);
+
+	// the next Step drops the order again
+	simulation.Step(0.01f);
+	CHECK(simulation.GetDrawList() == simulation.GetAliveList());
+}
+
+TEST_CASE(DepthTiesKeepSlotOrder)
+{
+	// fresh spawns all sit at the emitter, so every depth ties
+	ParticleSimulation simulation;
+	simulation.Resize(5000);
+	simulation.Spawn(3000, { 1.0f, 2.0f, 3.0f }, 9);
+	simulation.SortAliveList({ 0.0f, 0.0f, 1.0f, 0.0f });
+	CHECK(simulation.GetDrawList().size() == 3000);
+	CHECK(simulation.GetDrawList() == simulation.GetAliveList());
+}
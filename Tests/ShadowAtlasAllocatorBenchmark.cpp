@@ -0,0 +1,40 @@
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ShadowAtlasAllocator.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Update cost of an 8192 atlas for 1k to 16k spot and point lights whose importance drifts every frame,
+// with how many allocations are kept, evicted and failed per frame
+int main()
+{
+	mt19937 random(5);
+	uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	printf("%6s %10s %8s %8s %8s %8s\n", "lights", "update ms", "holders", "kept", "evicted", "failed");
+	for (uint32_t lightCount : { 1000u, 4096u, 16384u })
+	{
+		ShadowAtlasAllocator allocator;
+		allocator.Initialize(8192, 128, 2048);
+		vector<ShadowAtlasRequest> requests;
+		for (uint32_t i = 0; i < lightCount; ++i) requests.push_back({ i, i % 4 == 0 ? 6u : 1u, uniform(random) * uniform(random) * 0.6f });
+		allocator.Update(requests);
+
+		double time = MeasureMilliseconds(100, [&]()
+		{
+			for (ShadowAtlasRequest& request : requests)
+			{
+				request.importance *= 0.9f + uniform(random) * 0.2f;
+				if (uniform(random) < 0.01f) request.importance = uniform(random) * 0.6f;
+			}
+			allocator.Update(requests);
+		});
+		const ShadowAtlasStats& stats = allocator.GetStats();
+		printf("%6u %10.3f %8zu %8u %8u %8u\n", lightCount, time, allocator.GetAllocations().size(), stats.keptCount, stats.evictedCount, stats.failedCount);
+	}
+	return 0;
+}
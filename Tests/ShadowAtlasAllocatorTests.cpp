@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "ShadowAtlasAllocator.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+constexpr uint32_t ATLAS_SIZE = 8192;
+constexpr uint32_t MIN_TILE_SIZE = 128;
+constexpr uint32_t MAX_TILE_SIZE = 2048;
+
+// Every tile lies inside the atlas on its own size's grid, and no two tiles share a texel
+bool TilesArePackedWithoutOverlap(const ShadowAtlasAllocator& allocator)
+{
+	const uint32_t cellsPerRow = ATLAS_SIZE / MIN_TILE_SIZE;
+	vector<uint8_t> cells(cellsPerRow * cellsPerRow, 0);
+	for (const auto& [lightId, allocation] : allocator.GetAllocations())
+	{
+		for (uint32_t face = 0; face < allocation.faceCount; ++face)
+		{
+			const ShadowAtlasTile& tile = allocation.tiles[face];
+			if (tile.size < MIN_TILE_SIZE || tile.x % tile.size || tile.y % tile.size) return false;
+			if (tile.x + tile.size > ATLAS_SIZE || tile.y + tile.size > ATLAS_SIZE) return false;
+			for (uint32_t y = tile.y / MIN_TILE_SIZE; y < (tile.y + tile.size) / MIN_TILE_SIZE; ++y)
+			{
+				for (uint32_t x = tile.x / MIN_TILE_SIZE; x < (tile.x + tile.size) / MIN_TILE_SIZE; ++x)
+				{
+					if (cells[y * cellsPerRow + x]++) return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+}
+
+TEST_CASE(TileSizeFollowsImportance)
+{
+	ShadowAtlasAllocator allocator;
+	allocator.Initialize(ATLAS_SIZE, MIN_TILE_SIZE, MAX_TILE_SIZE);
+	CHECK(allocator.ComputeTileSize(1.0f) == MAX_TILE_SIZE);
+	CHECK(allocator.ComputeTileSize(4.0f) == MAX_TILE_SIZE);
+	CHECK(allocator.ComputeTileSize(0.5f) == MAX_TILE_SIZE / 2);
+	CHECK(allocator.ComputeTileSize(0.3f) == MAX_TILE_SIZE / 4);
+	CHECK(allocator.ComputeTileSize(0.001f) == MIN_TILE_SIZE);
+}
+
+TEST_CASE(SmallImportanceChangesKeepTiles)
+{
+	ShadowAtlasAllocator allocator;
+	allocator.Initialize(ATLAS_SIZE, MIN_TILE_SIZE, MAX_TILE_SIZE);
+	mt19937 random(5);
+	uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	vector<ShadowAtlasRequest> requests;
+	for (uint32_t i = 0; i < 20; ++i) requests.push_back({ i, i % 3 == 0 ? 6u : 1u, 0.05f + uniform(random) * 0.5f });
+	allocator.Update(requests);
+	CHECK(allocator.GetStats().allocatedCount == 20);
+	CHECK(allocator.GetStats().failedCount == 0);
+	CHECK(TilesArePackedWithoutOverlap(allocator));
+	const ShadowAtlasAllocation* cube = allocator.FindAllocation(0);
+	CHECK(cube && cube->faceCount == 6);
+
+	unordered_map<uint32_t, ShadowAtlasAllocation> previous = allocator.GetAllocations();
+	for (ShadowAtlasRequest& request : requests) request.importance *= 1.1f;
+	allocator.Update(requests);
+	CHECK(allocator.GetStats().keptCount == 20);
+	size_t movedCount = 0;
+	for (const auto& [lightId, allocation] : allocator.GetAllocations())
+	{
+		movedCount += allocation.tiles[0].x != previous.at(lightId).tiles[0].x || allocation.tiles[0].y != previous.at(lightId).tiles[0].y;
+	}
+	CHECK(movedCount == 0);
+
+	// lights no longer requested give their tiles back, and the atlas merges into one free root again
+	allocator.Update({});
+	CHECK(allocator.GetStats().releasedCount == 20);
+	CHECK(allocator.GetAllocations().empty());
+	ShadowAtlasAllocator whole;
+	whole.Initialize(ATLAS_SIZE, MIN_TILE_SIZE, ATLAS_SIZE);
+	whole.Update(requests);
+	whole.Update({});
+	whole.Update({ { 99, 1, 1.0f } });
+	CHECK(whole.FindAllocation(99) && whole.FindAllocation(99)->tiles[0].size == ATLAS_SIZE);
+}
+
+TEST_CASE(ImportantNewcomersEvictTheLeastImportantLights)
+{
+	ShadowAtlasAllocator allocator;
+	allocator.Initialize(ATLAS_SIZE, MIN_TILE_SIZE, MAX_TILE_SIZE);
+	vector<ShadowAtlasRequest> requests;
+	for (uint32_t i = 0; i < 4200; ++i) requests.push_back({ i, 1, 0.01f + i * 1e-6f });
+	allocator.Update(requests);
+	CHECK(allocator.GetStats().failedCount > 0);
+	CHECK(TilesArePackedWithoutOverlap(allocator));
+
+	for (uint32_t i = 0; i < 10; ++i) requests.push_back({ 90000 + i, 6, 0.9f });
+	allocator.Update(requests);
+	CHECK(allocator.GetStats().evictedCount > 0);
+	CHECK(TilesArePackedWithoutOverlap(allocator));
+	uint32_t newcomerCount = 0;
+	for (uint32_t i = 0; i < 10; ++i) newcomerCount += allocator.FindAllocation(90000 + i) != nullptr;
+	CHECK(newcomerCount == 10);
+
+	float leastImportantHolder = 1.0f, mostImportantLoser = 0.0f;
+	for (uint32_t i = 0; i < 4200; ++i)
+	{
+		if (allocator.FindAllocation(i)) leastImportantHolder = min(leastImportantHolder, requests[i].importance);
+		else mostImportantLoser = max(mostImportantLoser, requests[i].importance);
+	}
+	CHECK(leastImportantHolder > mostImportantLoser);
+}
+
+// Thousands of lights drifting in importance never overlap, whatever gets kept, moved or evicted
+TEST_CASE(ChurnNeverOverlapsTiles)
+{
+	ShadowAtlasAllocator allocator;
+	allocator.Initialize(ATLAS_SIZE, MIN_TILE_SIZE, MAX_TILE_SIZE);
+	mt19937 random(9);
+	uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	vector<ShadowAtlasRequest> requests;
+	for (uint32_t i = 0; i < 2000; ++i) requests.push_back({ i, i % 4 == 0 ? 6u : 1u, uniform(random) * uniform(random) * 0.6f });
+	bool packed = true;
+	for (int frame = 0; frame < 50; ++frame)
+	{
+		for (ShadowAtlasRequest& request : requests)
+		{
+			request.importance *= 0.9f + uniform(random) * 0.2f;
+			if (uniform(random) < 0.01f) request.importance = uniform(random) * 0.6f;
+		}
+		allocator.Update(requests);
+		packed &= TilesArePackedWithoutOverlap(allocator);
+	}
+	CHECK(packed);
+}
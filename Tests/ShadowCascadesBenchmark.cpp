@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "ShadowCascades.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Light-space reduction of 100k world boxes, against transforming all eight corners of each
+int main()
+{
+	const XMFLOAT4X4 lightView = ShadowCascades::CreateLightView({ 0.57735f, -0.57735f, 0.57735f });
+	const XMMATRIX lightViewMatrix = XMLoadFloat4x4(&lightView);
+	mt19937 random(7);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	vector<BoundingBox> boxes(100000);
+	for (BoundingBox& box : boxes)
+	{
+		box.Center = { uniform(random) * 500.0f, uniform(random) * 50.0f, uniform(random) * 500.0f };
+		box.Extents = { fabsf(uniform(random)) * 3.0f, fabsf(uniform(random)) * 3.0f, fabsf(uniform(random)) * 3.0f };
+	}
+
+	volatile float sink = 0.0f;
+	double reductionTime = MeasureMilliseconds(50, [&]()
+	{
+		sink = sink + ShadowCascades::ComputeLightSpaceBounds(boxes.data(), boxes.size(), lightView).min.x;
+	});
+	double cornerTime = MeasureMilliseconds(50, [&]()
+	{
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
+		for (const BoundingBox& box : boxes)
+		{
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				XMVECTOR worldPos = XMVectorSet(
+					box.Center.x + (corner & 1 ? box.Extents.x : -box.Extents.x),
+					box.Center.y + (corner & 2 ? box.Extents.y : -box.Extents.y),
+					box.Center.z + (corner & 4 ? box.Extents.z : -box.Extents.z), 1.0f);
+				XMVECTOR lightPos = XMVector3TransformCoord(worldPos, lightViewMatrix);
+				boundsMin = XMVectorMin(boundsMin, lightPos);
+				boundsMax = XMVectorMax(boundsMax, lightPos);
+			}
+		}
+		sink = sink + XMVectorGetX(boundsMin) + XMVectorGetX(boundsMax);
+	});
+	printf("%zu boxes\nreduction:          %.3f ms\n8-corner transform: %.3f ms\n", boxes.size(), reductionTime, cornerTime);
+	return 0;
+}
@@ -0,0 +1,210 @@
+#include <cfloat>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "ShadowCascades.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+constexpr uint32_t CASCADE_COUNT = 4;
+constexpr uint32_t RESOLUTION = 1024;
+constexpr float    ASPECT_RATIO = 1.78f;
+const LightSpaceBounds EMPTY_BOUNDS = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+XMFLOAT4X4 CreateTestLightView()
+{
+	return ShadowCascades::CreateLightView({ 0.57735f, -0.57735f, 0.57735f });
+}
+
+XMVECTOR GetCorner(const BoundingBox& box, int corner)
+{
+	return XMVectorSet(
+		box.Center.x + (corner & 1 ? box.Extents.x : -box.Extents.x),
+		box.Center.y + (corner & 2 ? box.Extents.y : -box.Extents.y),
+		box.Center.z + (corner & 4 ? box.Extents.z : -box.Extents.z), 1.0f);
+}
+
+vector<BoundingBox> CreateRandomBoxes(size_t count, mt19937& random, float spread, float height, float size)
+{
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	vector<BoundingBox> boxes(count);
+	for (BoundingBox& box : boxes)
+	{
+		box.Center = { uniform(random) * spread, fabsf(uniform(random)) * height, uniform(random) * spread };
+		box.Extents = { 0.1f + fabsf(uniform(random)) * size, 0.1f + fabsf(uniform(random)) * size, 0.1f + fabsf(uniform(random)) * size };
+	}
+	return boxes;
+}
+
+XMFLOAT4X4 CreateRandomCameraView(mt19937& random)
+{
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	XMVECTOR eye = XMVectorSet(uniform(random) * 15.0f, 2.0f + fabsf(uniform(random)) * 5.0f, uniform(random) * 15.0f, 1.0f);
+	XMVECTOR forward = XMVector3Normalize(XMVectorSet(uniform(random), -0.3f * fabsf(uniform(random)), uniform(random), 0.0f));
+	XMFLOAT4X4 view;
+	XMStoreFloat4x4(&view, XMMatrixLookToLH(eye, forward, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+	return view;
+}
+
+bool IsInsideNdc(FXMVECTOR ndc)
+{
+	const float tolerance = 1e-4f;
+	return fabsf(XMVectorGetX(ndc)) <= 1.0f + tolerance && fabsf(XMVectorGetY(ndc)) <= 1.0f + tolerance &&
+		XMVectorGetZ(ndc) >= -tolerance && XMVectorGetZ(ndc) <= 1.0f + tolerance;
+}
+}
+
+TEST_CASE(SplitDistancesBlendUniformAndLogarithmic)
+{
+	float uniformSplits[CASCADE_COUNT + 1];
+	float logSplits[CASCADE_COUNT + 1];
+	float blendedSplits[CASCADE_COUNT + 1];
+	ShadowCascades::ComputeSplitDistances(CASCADE_COUNT, 0.1f, 100.0f, 0.0f, uniformSplits);
+	ShadowCascades::ComputeSplitDistances(CASCADE_COUNT, 0.1f, 100.0f, 1.0f, logSplits);
+	ShadowCascades::ComputeSplitDistances(CASCADE_COUNT, 0.1f, 100.0f, 0.75f, blendedSplits);
+	for (uint32_t i = 0; i <= CASCADE_COUNT; ++i)
+	{
+		float fraction = static_cast<float>(i) / CASCADE_COUNT;
+		CHECK_NEAR(uniformSplits[i], 0.1f + 99.9f * fraction, 1e-3);
+		CHECK_NEAR(logSplits[i], 0.1f * powf(1000.0f, fraction), 1e-3);
+		CHECK_NEAR(blendedSplits[i], 0.25f * uniformSplits[i] + 0.75f * logSplits[i], 1e-3);
+		if (i > 0) CHECK(blendedSplits[i] > blendedSplits[i - 1]);
+	}
+}
+
+// The reduction rotates centers and extents rather than corners; it must give the same box
+TEST_CASE(LightSpaceBoundsMatchTransformedCorners)
+{
+	const XMFLOAT4X4 lightView = CreateTestLightView();
+	const XMMATRIX lightViewMatrix = XMLoadFloat4x4(&lightView);
+	mt19937 random(7);
+	CHECK(ShadowCascades::ComputeLightSpaceBounds(nullptr, 0, lightView).IsEmpty());
+	for (int trial = 0; trial < 200; ++trial)
+	{
+		vector<BoundingBox> boxes = CreateRandomBoxes(1 + random() % 50, random, 30.0f, 5.0f, 3.0f);
+		LightSpaceBounds bounds = ShadowCascades::ComputeLightSpaceBounds(boxes.data(), boxes.size(), lightView);
+
+		XMVECTOR expectedMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR expectedMax = XMVectorReplicate(-FLT_MAX);
+		for (const BoundingBox& box : boxes)
+		{
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				XMVECTOR lightPos = XMVector3TransformCoord(GetCorner(box, corner), lightViewMatrix);
+				expectedMin = XMVectorMin(expectedMin, lightPos);
+				expectedMax = XMVectorMax(expectedMax, lightPos);
+			}
+		}
+		CHECK_NEAR(bounds.min.x, XMVectorGetX(expectedMin), 1e-3);
+		CHECK_NEAR(bounds.min.y, XMVectorGetY(expectedMin), 1e-3);
+		CHECK_NEAR(bounds.min.z, XMVectorGetZ(expectedMin), 1e-3);
+		CHECK_NEAR(bounds.max.x, XMVectorGetX(expectedMax), 1e-3);
+		CHECK_NEAR(bounds.max.y, XMVectorGetY(expectedMax), 1e-3);
+		CHECK_NEAR(bounds.max.z, XMVectorGetZ(expectedMax), 1e-3);
+	}
+}
+
+// Without scene bounds a cascade's size depends only on its slice, and its center sits on the texel grid
+TEST_CASE(SphereFitIsRotationStableAndTexelSnapped)
+{
+	const XMFLOAT4X4 lightView = CreateTestLightView();
+	const XMMATRIX lightViewMatrix = XMLoadFloat4x4(&lightView);
+	const float tanHalfFovY = tanf(XMConvertToRadians(22.5f));
+	float splits[CASCADE_COUNT + 1];
+	ShadowCascades::ComputeSplitDistances(CASCADE_COUNT, 0.1f, 60.0f, 0.75f, splits);
+	float firstRadii[CASCADE_COUNT] = {};
+	mt19937 random(1);
+	size_t radiusChanges = 0, offGrid = 0, uncovered = 0;
+	for (int frame = 0; frame < 500; ++frame)
+	{
+		XMFLOAT4X4 cameraView = CreateRandomCameraView(random);
+		XMMATRIX inverseCameraView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&cameraView));
+		for (uint32_t c = 0; c < CASCADE_COUNT; ++c)
+		{
+			ShadowCascade cascade = ShadowCascades::FitCascade(cameraView, tanHalfFovY, ASPECT_RATIO, splits[c], splits[c + 1],
+				lightView, RESOLUTION, EMPTY_BOUNDS, EMPTY_BOUNDS);
+			if (frame == 0) firstRadii[c] = cascade.radius;
+			radiusChanges += cascade.radius != firstRadii[c];
+
+			double texelSize = 2.0 * cascade.radius / RESOLUTION;
+			double texelsX = cascade.center.x / texelSize, texelsY = cascade.center.y / texelSize;
+			offGrid += fabs(texelsX - round(texelsX)) > 1e-3 || fabs(texelsY - round(texelsY)) > 1e-3;
+
+			XMMATRIX lightViewProjection = lightViewMatrix * XMLoadFloat4x4(&cascade.projection);
+			for (int corner = 0; corner < 8; ++corner)
+			{
+				float z = corner & 4 ? splits[c + 1] : splits[c];
+				XMVECTOR viewPos = XMVectorSet((corner & 1 ? 1.0f : -1.0f) * z * tanHalfFovY * ASPECT_RATIO, (corner & 2 ? 1.0f : -1.0f) * z * tanHalfFovY, z, 1.0f);
+				XMVECTOR worldPos = XMVector3TransformCoord(viewPos, inverseCameraView);
+				uncovered += !IsInsideNdc(XMVector3TransformCoord(worldPos, lightViewProjection));
+			}
+		}
+	}
+	CHECK(radiusChanges == 0);
+	CHECK(offGrid == 0);
+	CHECK(uncovered == 0);
+}
+
+// Receiver corners seen in a slice land inside that cascade, and no caster is clipped by its near plane
+TEST_CASE(BoundsFitCoversReceiversAndCasters)
+{
+	const XMFLOAT4X4 lightView = CreateTestLightView();
+	const XMMATRIX lightViewMatrix = XMLoadFloat4x4(&lightView);
+	const float tanHalfFovY = tanf(XMConvertToRadians(22.5f));
+	float splits[CASCADE_COUNT + 1];
+	ShadowCascades::ComputeSplitDistances(CASCADE_COUNT, 0.1f, 60.0f, 0.75f, splits);
+	mt19937 random(7);
+	vector<BoundingBox> scene = CreateRandomBoxes(300, random, 20.0f, 4.0f, 1.5f);
+	LightSpaceBounds sceneBounds = ShadowCascades::ComputeLightSpaceBounds(scene.data(), scene.size(), lightView);
+
+	size_t receiverChecks = 0, uncoveredReceivers = 0, clippedCasters = 0;
+	for (int frame = 0; frame < 300; ++frame)
+	{
+		XMFLOAT4X4 cameraView = CreateRandomCameraView(random);
+		XMMATRIX cameraViewMatrix = XMLoadFloat4x4(&cameraView);
+		for (uint32_t c = 0; c < CASCADE_COUNT; ++c)
+		{
+			ShadowCascade cascade = ShadowCascades::FitCascade(cameraView, tanHalfFovY, ASPECT_RATIO, splits[c], splits[c + 1],
+				lightView, RESOLUTION, sceneBounds, sceneBounds);
+			XMMATRIX lightViewProjection = lightViewMatrix * XMLoadFloat4x4(&cascade.projection);
+			for (const BoundingBox& box : scene)
+			{
+				for (int corner = 0; corner < 8; ++corner)
+				{
+					XMVECTOR worldPos = GetCorner(box, corner);
+					XMVECTOR ndc = XMVector3TransformCoord(worldPos, lightViewProjection);
+					clippedCasters += XMVectorGetZ(ndc) < -1e-4f;
+
+					XMVECTOR viewPos = XMVector3TransformCoord(worldPos, cameraViewMatrix);
+					float z = XMVectorGetZ(viewPos);
+					if (z < splits[c] || z > splits[c + 1]) continue;
+					if (fabsf(XMVectorGetX(viewPos)) > z * tanHalfFovY * ASPECT_RATIO || fabsf(XMVectorGetY(viewPos)) > z * tanHalfFovY) continue;
+					++receiverChecks;
+					uncoveredReceivers += !IsInsideNdc(ndc);
+				}
+			}
+		}
+	}
+	CHECK(receiverChecks > 1000);
+	CHECK(uncoveredReceivers == 0);
+	CHECK(clippedCasters == 0);
+}
+
+TEST_CASE(IntersectsCascadeRejectsSpheresOutsideTheBox)
+{
+	const XMFLOAT4X4 lightView = CreateTestLightView();
+	XMFLOAT4X4 cameraView;
+	XMStoreFloat4x4(&cameraView, XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+	ShadowCascade cascade = ShadowCascades::FitCascade(cameraView, tanf(XMConvertToRadians(22.5f)), ASPECT_RATIO, 0.1f, 10.0f,
+		lightView, RESOLUTION, EMPTY_BOUNDS, EMPTY_BOUNDS);
+	CHECK(ShadowCascades::IntersectsCascade(cascade, BoundingSphere({ 0.0f, 2.0f, 5.0f }, 0.5f)));
+	CHECK(!ShadowCascades::IntersectsCascade(cascade, BoundingSphere({ 200.0f, 2.0f, 5.0f }, 0.5f)));
+	CHECK(!ShadowCascades::IntersectsCascade(cascade, BoundingSphere({ 0.0f, 2.0f, -200.0f }, 0.5f)));
+}
@@ -0,0 +1,97 @@
+#include <algorithm>
+#include <cfloat>
+#include <random>
+#include <vector>
+
+#include "ShadowDrawList.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+vector<ShadowCaster> CreateRandomCasters(uint32_t count, uint32_t seed)
+{
+	mt19937 random(seed);
+	uniform_real_distribution<float> uniform(-1.0f, 1.0f);
+	vector<ShadowCaster> casters(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		casters[i].worldBounds = BoundingSphere({ uniform(random) * 100.0f, uniform(random) * 5.0f, uniform(random) * 100.0f }, 1.0f);
+		casters[i].sortKey = ShadowDrawList::MakeSortKey(random() % 2, 0x10000ull * (random() % 8));
+		casters[i].index = i;
+	}
+	return casters;
+}
+
+bool IsInDrawOrder(const ShadowDrawList& list, const vector<ShadowCaster>& casters)
+{
+	const vector<uint32_t>& drawIndices = list.GetDrawIndices();
+	for (size_t i = 1; i < drawIndices.size(); ++i)
+	{
+		const ShadowCaster& previous = casters[drawIndices[i - 1]];
+		const ShadowCaster& current = casters[drawIndices[i]];
+		if (previous.sortKey > current.sortKey || (previous.sortKey == current.sortKey && previous.index >= current.index)) return false;
+	}
+	return true;
+}
+}
+
+TEST_CASE(SortKeysRankFormatAboveBuffer)
+{
+	CHECK(ShadowDrawList::MakeSortKey(0, 0xFFFFFFFFFFull) < ShadowDrawList::MakeSortKey(1, 0));
+	CHECK(ShadowDrawList::MakeSortKey(1, 0x1000) < ShadowDrawList::MakeSortKey(1, 0x2000));
+	CHECK(ShadowDrawList::MakeSortKey(2, 0x1000) == ShadowDrawList::MakeSortKey(2, 0x1000));
+}
+
+TEST_CASE(CascadeListKeepsExactlyTheIntersectingCastersInKeyOrder)
+{
+	const LightSpaceBounds emptyBounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+	XMFLOAT4X4 cameraView;
+	XMStoreFloat4x4(&cameraView, XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+	ShadowCascade cascade = ShadowCascades::FitCascade(cameraView, 0.414f, 1.78f, 0.1f, 20.0f,
+		ShadowCascades::CreateLightView({ 0.3f, -0.9f, 0.3f }), 1024, emptyBounds, emptyBounds);
+	vector<ShadowCaster> casters = CreateRandomCasters(1000, 3);
+
+	ShadowDrawList list;
+	list.Build(cascade, casters);
+	vector<uint32_t> expected;
+	for (const ShadowCaster& caster : casters)
+	{
+		if (ShadowCascades::IntersectsCascade(cascade, caster.worldBounds)) expected.push_back(caster.index);
+	}
+	const ShadowDrawStats& stats = list.GetStats();
+	CHECK(stats.candidateCount == 1000);
+	CHECK(stats.submittedCount == expected.size());
+	CHECK(stats.culledCount == 1000 - expected.size());
+	CHECK(!expected.empty() && expected.size() < 1000);
+	CHECK(IsInDrawOrder(list, casters));
+
+	vector<uint32_t> drawn = list.GetDrawIndices();
+	sort(drawn.begin(), drawn.end());
+	CHECK(drawn == expected);
+
+	list.Clear();
+	CHECK(list.GetDrawIndices().empty());
+	CHECK(list.GetStats().candidateCount == 0);
+}
+
+TEST_CASE(LocalLightListKeepsCastersInRange)
+{
+	vector<ShadowCaster> casters = CreateRandomCasters(1000, 9);
+	const BoundingSphere lightBounds({ 10.0f, 0.0f, -20.0f }, 25.0f);
+	ShadowDrawList list;
+	list.Build(lightBounds, casters);
+
+	uint32_t expectedCount = 0;
+	for (const ShadowCaster& caster : casters)
+	{
+		expectedCount += lightBounds.Intersects(caster.worldBounds);
+	}
+	CHECK(expectedCount > 0);
+	CHECK(list.GetStats().submittedCount == expectedCount);
+	CHECK(IsInDrawOrder(list, casters));
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "Utils/SpatialHashGrid.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// A block of fluid with about 30 neighbours per point: building the grid, counting neighbours and SPH
+// densities, against only sorting the cell hashes with std::sort
+int main()
+{
+	printf("%9s %9s %9s %9s %10s %13s\n", "points", "neighbors", "build ms", "count ms", "density ms", "std::sort ms");
+	for (size_t count : { size_t(100000), size_t(250000), size_t(1000000) })
+	{
+		const float side = cbrtf(count * 1e-3f);
+		const float radius = cbrtf(30.0f * side * side * side / count / (4.0f / 3.0f * 3.14159265f));
+		mt19937 random(2);
+		uniform_real_distribution<float> distribution(0.0f, side);
+		vector<float> x(count), y(count), z(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			x[i] = distribution(random);
+			y[i] = distribution(random);
+			z[i] = distribution(random);
+		}
+
+		SpatialHashGrid grid;
+		vector<uint32_t> counts(count);
+		vector<float> densities(count);
+		double buildTime = MeasureMilliseconds(3, [&]() { grid.Build(x.data(), y.data(), z.data(), nullptr, count, radius); });
+		double countTime = MeasureMilliseconds(3, [&]() { grid.CountNeighbors(radius, counts.data()); });
+		double densityTime = MeasureMilliseconds(3, [&]() { grid.ComputeDensities(radius, 1.0f, densities.data()); });
+		double meanNeighborCount = 0.0;
+		for (uint32_t neighborCount : counts) meanNeighborCount += neighborCount;
+		meanNeighborCount /= count;
+
+		vector<pair<uint32_t, uint32_t>> cellHashes(count);
+		double sortTime = MeasureMilliseconds(3, [&]()
+		{
+			for (size_t i = 0; i < count; ++i)
+			{
+				uint32_t cellX = static_cast<uint32_t>(static_cast<int32_t>(floorf(x[i] / radius)));
+				uint32_t cellY = static_cast<uint32_t>(static_cast<int32_t>(floorf(y[i] / radius)));
+				uint32_t cellZ = static_cast<uint32_t>(static_cast<int32_t>(floorf(z[i] / radius)));
+				cellHashes[i] = { ((cellX * 73856093u) ^ (cellY * 19349663u) ^ (cellZ * 83492791u)) & ((1u << 20) - 1), static_cast<uint32_t>(i) };
+			}
+			sort(cellHashes.begin(), cellHashes.end());
+		});
+		printf("%9zu %9.1f %9.2f %9.2f %10.2f %13.2f\n", count, meanNeighborCount, buildTime, countTime, densityTime, sortTime);
+	}
+	return 0;
+}
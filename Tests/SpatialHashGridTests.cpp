@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "ParticleSimulation.h"
+#include "Utils/SpatialHashGrid.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+struct PointSet
+{
+	vector<float> x;
+	vector<float> y;
+	vector<float> z;
+};
+
+PointSet CreateRandomPoints(size_t count, uint32_t seed)
+{
+	mt19937 random(seed);
+	uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+	PointSet points;
+	for (size_t i = 0; i < count; ++i)
+	{
+		points.x.push_back(distribution(random));
+		points.y.push_back(distribution(random) * 0.5f);
+		points.z.push_back(distribution(random));
+	}
+	return points;
+}
+
+vector<uint32_t> FindNeighborsBruteForce(const PointSet& points, const vector<uint32_t>& indices, const XMFLOAT3& position, float radius)
+{
+	vector<uint32_t> neighbors;
+	for (uint32_t i : indices)
+	{
+		float dx = points.x[i] - position.x;
+		float dy = points.y[i] - position.y;
+		float dz = points.z[i] - position.z;
+		if (dx * dx + dy * dy + dz * dz <= radius * radius) neighbors.push_back(i);
+	}
+	return neighbors;
+}
+
+vector<uint32_t> FindNeighbors(const SpatialHashGrid& grid, const XMFLOAT3& position, float radius)
+{
+	vector<uint32_t> neighbors;
+	grid.ForEachNeighbor(position, radius, [&](uint32_t pointIndex, float) { neighbors.push_back(pointIndex); });
+	sort(neighbors.begin(), neighbors.end());
+	return neighbors;
+}
+}
+
+// Every third point is left out through the index list, so queries must neither report nor write them
+TEST_CASE(QueriesMatchBruteForce)
+{
+	for (size_t count : { size_t(1000), size_t(20000) })
+	{
+		PointSet points = CreateRandomPoints(count, 1);
+		vector<uint32_t> indices;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			if (i % 3) indices.push_back(i);
+		}
+		const float radius = 0.15f;
+		SpatialHashGrid grid;
+		grid.Build(points.x.data(), points.y.data(), points.z.data(), indices.data(), indices.size(), radius);
+		CHECK(grid.GetCount() == indices.size());
+
+		const uint32_t untouched = 0xDEAD;
+		vector<uint32_t> counts(count, untouched);
+		grid.CountNeighbors(radius, counts.data());
+		bool queriesMatch = true, countsMatch = true;
+		for (uint32_t i : indices)
+		{
+			XMFLOAT3 position = { points.x[i], points.y[i], points.z[i] };
+			vector<uint32_t> expected = FindNeighborsBruteForce(points, indices, position, radius);
+			queriesMatch &= FindNeighbors(grid, position, radius) == expected;
+			countsMatch &= counts[i] == expected.size();
+		}
+		CHECK(queriesMatch);
+		CHECK(countsMatch);
+
+		bool skippedUntouched = true;
+		for (uint32_t i = 0; i < count; i += 3) skippedUntouched &= counts[i] == untouched;
+		CHECK(skippedUntouched);
+	}
+}
+
+TEST_CASE(QueriesAwayFromThePointsAndAcrossHashWraps)
+{
+	// points far out in every direction hash all over the table
+	PointSet points = CreateRandomPoints(5000, 2);
+	for (size_t i = 0; i < points.x.size(); i += 2)
+	{
+		points.x[i] *= 1000.0f;
+		points.z[i] *= -1000.0f;
+	}
+	vector<uint32_t> indices(points.x.size());
+	for (uint32_t i = 0; i < indices.size(); ++i) indices[i] = i;
+	SpatialHashGrid grid;
+	grid.Build(points.x.data(), points.y.data(), points.z.data(), nullptr, indices.size(), 0.5f);
+
+	mt19937 random(3);
+	uniform_real_distribution<float> distribution(-2000.0f, 2000.0f);
+	bool queriesMatch = true;
+	for (int query = 0; query < 500; ++query)
+	{
+		XMFLOAT3 position = query % 2 ? XMFLOAT3(distribution(random), 0.0f, distribution(random))
+			: XMFLOAT3(points.x[query], points.y[query], points.z[query]);
+		queriesMatch &= FindNeighbors(grid, position, 0.4f) == FindNeighborsBruteForce(points, indices, position, 0.4f);
+	}
+	CHECK(queriesMatch);
+}
+
+TEST_CASE(DensitiesMatchThePoly6Sum)
+{
+	PointSet points = CreateRandomPoints(8000, 4);
+	const float radius = 0.2f, mass = 0.02f;
+	SpatialHashGrid grid;
+	grid.Build(points.x.data(), points.y.data(), points.z.data(), nullptr, points.x.size(), radius);
+	vector<float> densities(points.x.size());
+	grid.ComputeDensities(radius, mass, densities.data());
+
+	const double poly6 = 315.0 / (64.0 * 3.14159265358979 * pow(static_cast<double>(radius), 9.0));
+	double maxRelativeError = 0.0;
+	for (size_t i = 0; i < points.x.size(); ++i)
+	{
+		double density = 0.0;
+		for (size_t j = 0; j < points.x.size(); ++j)
+		{
+			double dx = points.x[j] - points.x[i], dy = points.y[j] - points.y[i], dz = points.z[j] - points.z[i];
+			double distanceSquared = dx * dx + dy * dy + dz * dz;
+			if (distanceSquared <= radius * radius) density += pow(radius * radius - distanceSquared, 3.0);
+		}
+		density *= mass * poly6;
+		maxRelativeError = max(maxRelativeError, fabs(densities[i] - density) / density);
+	}
+	CHECK(maxRelativeError < 1e-4);
+}
+
+TEST_CASE(ParticleNeighborGridHoldsTheAliveParticles)
+{
+	ParticleSimulation simulation;
+	simulation.Resize(20000);
+	for (int frame = 0; frame < 30; ++frame)
+	{
+		simulation.Step(0.1f);
+		simulation.Spawn(1500, { 0.0f, 0.0f, 0.0f }, frame);
+	}
+	const SpatialHashGrid& grid = simulation.BuildNeighborGrid(0.3f);
+	CHECK(grid.GetCount() == simulation.GetAliveCount());
+
+	vector<ParticleData> particles(simulation.GetCount());
+	simulation.WriteParticles(particles.data());
+	PointSet points;
+	for (const ParticleData& particle : particles)
+	{
+		points.x.push_back(particle.position[0]);
+		points.y.push_back(particle.position[1]);
+		points.z.push_back(particle.position[2]);
+	}
+	const vector<uint32_t>& aliveList = simulation.GetAliveList();
+	bool queriesMatch = true;
+	for (size_t i = 0; i < aliveList.size(); i += 7)
+	{
+		uint32_t slot = aliveList[i];
+		XMFLOAT3 position = { points.x[slot], points.y[slot], points.z[slot] };
+		queriesMatch &= FindNeighbors(grid, position, 0.3f) == FindNeighborsBruteForce(points, aliveList, position, 0.3f);
+	}
+	CHECK(queriesMatch);
+}
@@ -0,0 +1,27 @@
+#include <cstdio>
+
+#include "Utils/SphericalHarmonics.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Time to project mip 0 of a cubemap onto L2 and convolve it, which replaces baking the irradiance cubemap
+int main()
+{
+	printf("%6s %12s\n", "face", "project ms");
+	for (int size : { 64, 128, 256, 512 })
+	{
+		CubemapImage cubemap;
+		cubemap.Allocate(size, 1);
+		for (size_t i = 0; i < cubemap.texels.size(); ++i) cubemap.texels[i] = static_cast<float>(i % 7) * 0.25f;
+		double time = MeasureMilliseconds(10, [&]()
+		{
+			SphericalHarmonics::ConvolveCosineLobe(SphericalHarmonics::ProjectCubemap(cubemap));
+		});
+		printf("%6d %12.3f\n", size, time);
+	}
+	return 0;
+}
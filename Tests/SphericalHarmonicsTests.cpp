@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <random>
+
+#include "Utils/IBLUtils.h"
+#include "Utils/SphericalHarmonics.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+using Environment = function<XMFLOAT3(const XMFLOAT3&)>;
+
+CubemapImage CreateCubemap(int size, const Environment& environment)
+{
+	CubemapImage cubemap;
+	cubemap.Allocate(size, 1);
+	for (int face = 0; face < 6; ++face)
+	{
+		float* texels = cubemap.GetFace(0, face);
+		for (int y = 0; y < size; ++y)
+		{
+			for (int x = 0; x < size; ++x)
+			{
+				XMFLOAT3 direction;
+				XMStoreFloat3(&direction, IBLUtils::GetCubemapDirection(face, (x + 0.5f) * 2.0f / size - 1.0f, (y + 0.5f) * 2.0f / size - 1.0f));
+				XMFLOAT3 color = environment(direction);
+				float* texel = texels + (y * size + x) * 4;
+				texel[0] = color.x;
+				texel[1] = color.y;
+				texel[2] = color.z;
+				texel[3] = 1.0f;
+			}
+		}
+	}
+	return cubemap;
+}
+
+// Cosine-weighted Monte Carlo estimate of the irradiance around a normal, straight from the environment function
+XMFLOAT3 EstimateIrradiance(const Environment& environment, const XMFLOAT3& normal, int sampleCount, mt19937& random)
+{
+	uniform_real_distribution<float> uniform(0.0f, 1.0f);
+	XMVECTOR n = XMLoadFloat3(&normal);
+	XMVECTOR up = fabsf(normal.y) < 0.999f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+	XMVECTOR tangent = XMVector3Normalize(XMVector3Cross(up, n));
+	XMVECTOR bitangent = XMVector3Cross(n, tangent);
+	double sum[3] = {};
+	for (int i = 0; i < sampleCount; ++i)
+	{
+		float cosTheta2 = uniform(random);
+		float phi = XM_2PI * uniform(random);
+		float sinTheta = sqrtf(1.0f - cosTheta2);
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVectorAdd(XMVectorAdd(
+			XMVectorScale(tangent, sinTheta * cosf(phi)), XMVectorScale(bitangent, sinTheta * sinf(phi))), XMVectorScale(n, sqrtf(cosTheta2))));
+		XMFLOAT3 color = environment(direction);
+		sum[0] += color.x;
+		sum[1] += color.y;
+		sum[2] += color.z;
+	}
+	// the cosine over the pdf cos / pi leaves pi
+	double scale = XM_PI / sampleCount;
+	return { static_cast<float>(sum[0] * scale), static_cast<float>(sum[1] * scale), static_cast<float>(sum[2] * scale) };
+}
+
+XMFLOAT3 RandomDirection(mt19937& random)
+{
+	normal_distribution<float> gaussian;
+	XMFLOAT3 direction;
+	XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(gaussian(random), gaussian(random), gaussian(random), 0.0f)));
+	return direction;
+}
+
+SHCoefficients ComputeIrradiance(const Environment& environment)
+{
+	return SphericalHarmonics::ConvolveCosineLobe(SphericalHarmonics::ProjectCubemap(CreateCubemap(64, environment)));
+}
+
+// Largest error of the SH irradiance against the Monte Carlo reference over random normals, relative to the
+// reference's mean so that dark directions do not dominate
+float MeasureRelativeError(const Environment& environment, int sampleCount)
+{
+	SHCoefficients irradiance = ComputeIrradiance(environment);
+	mt19937 random(1);
+	float maxError = 0.0f;
+	double referenceSum = 0.0;
+	const int normalCount = 64;
+	for (int i = 0; i < normalCount; ++i)
+	{
+		XMFLOAT3 normal = RandomDirection(random);
+		XMFLOAT3 expected = EstimateIrradiance(environment, normal, sampleCount, random);
+		XMFLOAT3 actual = SphericalHarmonics::Evaluate(irradiance, normal);
+		maxError = max({ maxError, fabsf(actual.x - expected.x), fabsf(actual.y - expected.y), fabsf(actual.z - expected.z) });
+		referenceSum += (expected.x + expected.y + expected.z) / 3.0;
+	}
+	return maxError / static_cast<float>(referenceSum / normalCount);
+}
+
+XMFLOAT3 ConstantEnvironment(const XMFLOAT3&)
+{
+	return { 0.25f, 0.5f, 1.0f };
+}
+
+// Only bands 0 to 2, so the L2 expansion is exact and only the Monte Carlo noise is left
+XMFLOAT3 BandLimitedEnvironment(const XMFLOAT3& d)
+{
+	return { 1.0f + 0.5f * d.y + 0.3f * d.x * d.z, 1.0f + 0.4f * d.x - 0.2f * (d.x * d.x - d.y * d.y), 1.2f + 0.6f * d.z * d.y + 0.1f * (3.0f * d.z * d.z - 1.0f) };
+}
+
+// Bright upper hemisphere over a dark ground, with a small sun: sharp features L2 can only approximate
+XMFLOAT3 SkyEnvironment(const XMFLOAT3& d)
+{
+	if (d.y < 0.0f) return { 0.2f, 0.15f, 0.1f };
+	float sky = 0.3f + 0.7f * d.y;
+	float sun = 5.0f * powf(max(0.0f, 0.5f * d.x + 0.7f * d.y + 0.5f * d.z), 8.0f);
+	return { 0.5f * sky + sun, 0.7f * sky + 0.9f * sun, sky + 0.6f * sun };
+}
+}
+
+TEST_CASE(ConstantEnvironmentGivesPiTimesRadiance)
+{
+	SHCoefficients irradiance = ComputeIrradiance(ConstantEnvironment);
+	mt19937 random(3);
+	for (int i = 0; i < 16; ++i)
+	{
+		XMFLOAT3 value = SphericalHarmonics::Evaluate(irradiance, RandomDirection(random));
+		CHECK_NEAR(value.x, 0.25f * XM_PI, 1e-3);
+		CHECK_NEAR(value.y, 0.5f * XM_PI, 1e-3);
+		CHECK_NEAR(value.z, 1.0f * XM_PI, 2e-3);
+	}
+	for (int i = 1; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+	{
+		CHECK_NEAR(irradiance.coefficients[i].z, 0.0f, 1e-4);
+	}
+}
+
+TEST_CASE(BandLimitedEnvironmentMatchesMonteCarlo)
+{
+	// 16k cosine samples leave about 1% noise in the reference
+	CHECK(MeasureRelativeError(BandLimitedEnvironment, 16384) < 0.02f);
+}
+
+TEST_CASE(SkyEnvironmentMatchesMonteCarloWithinL2Ringing)
+{
+	CHECK(MeasureRelativeError(SkyEnvironment, 16384) < 0.1f);
+}
+
+TEST_CASE(ProjectionIsDeterministic)
+{
+	CubemapImage cubemap = CreateCubemap(48, SkyEnvironment);
+	SHCoefficients first = SphericalHarmonics::ProjectCubemap(cubemap);
+	SHCoefficients second = SphericalHarmonics::ProjectCubemap(cubemap);
+	CHECK(memcmp(&first, &second, sizeof(first)) == 0);
+}
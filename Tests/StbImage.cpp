@@ -0,0 +1,3 @@
+// Utils.cpp holds the stb_image implementation in the application, but it needs D3D12
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
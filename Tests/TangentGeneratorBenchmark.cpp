@@ -0,0 +1,77 @@
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Geometry/TangentGenerator.h"
+#include "Utils/ThreadPool.h"
+#include "Benchmark.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// The loop Geometry::ComputeTangents ran before TangentGenerator: scalar UV deltas and no handedness
+void ComputeTangentsScalar(vector<Vertex>& vertices, const vector<uint32_t>& indices)
+{
+	vector<Vertex> outVertices = vertices;
+	vector<XMFLOAT3> tangentSums(outVertices.size(), { 0.0f, 0.0f, 0.0f });
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		uint32_t index0 = indices[i], index1 = indices[i + 1], index2 = indices[i + 2];
+		XMVECTOR pos0 = XMLoadFloat3(&outVertices[index0].pos);
+		XMVECTOR deltaPos1 = XMVectorSubtract(XMLoadFloat3(&outVertices[index1].pos), pos0);
+		XMVECTOR deltaPos2 = XMVectorSubtract(XMLoadFloat3(&outVertices[index2].pos), pos0);
+		XMVECTOR uv0 = XMLoadFloat2(&outVertices[index0].texCoord);
+		XMVECTOR uv1 = XMLoadFloat2(&outVertices[index1].texCoord);
+		XMVECTOR uv2 = XMLoadFloat2(&outVertices[index2].texCoord);
+		float deltaU1 = XMVectorGetX(uv1) - XMVectorGetX(uv0);
+		float deltaU2 = XMVectorGetX(uv2) - XMVectorGetX(uv0);
+		float deltaV1 = XMVectorGetY(uv1) - XMVectorGetY(uv0);
+		float deltaV2 = XMVectorGetY(uv2) - XMVectorGetY(uv0);
+		float det = deltaU1 * deltaV2 - deltaU2 * deltaV1;
+		if (fabsf(det) < 1e-6f) continue;
+		XMVECTOR tangent = XMVectorScale(XMVectorSubtract(XMVectorScale(deltaPos1, deltaV2), XMVectorScale(deltaPos2, deltaV1)), 1.0f / det);
+		for (uint32_t index : { index0, index1, index2 })
+		{
+			XMStoreFloat3(&tangentSums[index], XMVectorAdd(XMLoadFloat3(&tangentSums[index]), tangent));
+		}
+	}
+	for (size_t i = 0; i < outVertices.size(); ++i)
+	{
+		XMVECTOR normal = XMLoadFloat3(&outVertices[i].normal);
+		XMVECTOR tangent = XMLoadFloat3(&tangentSums[i]);
+		tangent = XMVector3Normalize(XMVectorSubtract(tangent, XMVectorScale(normal, XMVectorGetX(XMVector3Dot(normal, tangent)))));
+		XMStoreFloat4(&outVertices[i].tangentU, XMVectorSetW(tangent, 1.0f));
+	}
+	vertices = move(outVertices);
+}
+}
+
+// Tangent generation throughput on icospheres of 5k to 1.3M triangles against the scalar loop it replaced,
+// which had no angle weights, handedness or degenerate triangle handling. On one core the serial path ran at
+// 0.85-0.95x the old loop up to 20k triangles, on par at 80k and 1.3-2x above, where copying the vertices
+// dominates the old loop; the previous per-corner version ran at 0.2-0.3x throughout.
+int main()
+{
+	printf("threads: %zu\n", ThreadPool::GetInstance().GetThreadCount());
+	printf("%5s %10s %14s %14s %16s %14s\n", "level", "triangles", "scalar Mtri/s", "serial Mtri/s", "parallel Mtri/s", "serial/scalar");
+	for (int level = 4; level <= 8; ++level)
+	{
+		vector<Vertex> vertices;
+		vector<uint32_t> indices;
+		CreateIcoSphere(level, vertices, indices);
+		double triangleCount = indices.size() / 3.0;
+		int repetitions = level <= 6 ? 20 : 5;
+
+		double scalarTime = MeasureMilliseconds(repetitions, [&]() { ComputeTangentsScalar(vertices, indices); });
+		double serialTime = MeasureMilliseconds(repetitions, [&]() { TangentGenerator::Generate(vertices, indices, false); });
+		double parallelTime = MeasureMilliseconds(repetitions, [&]() { TangentGenerator::Generate(vertices, indices, true); });
+		printf("%5d %10.0f %14.1f %14.1f %16.1f %14.2f\n", level, triangleCount, triangleCount / scalarTime / 1000.0,
+			triangleCount / serialTime / 1000.0, triangleCount / parallelTime / 1000.0, scalarTime / serialTime);
+	}
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <cmath>
+#include <vector>
+
+#include "Geometry/TangentGenerator.h"
+#include "TestFramework.h"
+#include "TestMeshes.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+// Unit length, orthogonal to the normal and a handedness of exactly one
+void CheckTangentFrames(const vector<Vertex>& vertices)
+{
+	for (const Vertex& vertex : vertices)
+	{
+		XMVECTOR tangent = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&vertex.tangentU));
+		CHECK_NEAR(XMVectorGetX(XMVector3Length(tangent)), 1.0f, 1e-5f);
+		CHECK_NEAR(XMVectorGetX(XMVector3Dot(tangent, XMLoadFloat3(&vertex.normal))), 0.0f, 1e-5f);
+		CHECK(vertex.tangentU.w == 1.0f || vertex.tangentU.w == -1.0f);
+	}
+}
+
+void CheckNear(const XMFLOAT4& actual, const XMFLOAT4& expected, float tolerance)
+{
+	CHECK_NEAR(actual.x, expected.x, tolerance);
+	CHECK_NEAR(actual.y, expected.y, tolerance);
+	CHECK_NEAR(actual.z, expected.z, tolerance);
+	CHECK(actual.w == expected.w);
+}
+}
+
+// With u along +x and v along -z, T = +x and B = -z = cross(+y, +x), so the frame is right-handed
+TEST_CASE(GridTangentsFollowU)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateGrid(8, 8, 4.0f, vertices, indices);
+	TangentGenerator::Generate(vertices, indices, false);
+	CheckTangentFrames(vertices);
+	for (const Vertex& vertex : vertices)
+	{
+		CheckNear(vertex.tangentU, { 1.0f, 0.0f, 0.0f, 1.0f }, 1e-5f);
+	}
+}
+
+// Mirroring u turns the tangent around and flips the handedness, so B still points along -z
+TEST_CASE(MirroredUVsFlipHandedness)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateGrid(8, 8, 4.0f, vertices, indices);
+	for (Vertex& vertex : vertices)
+	{
+		vertex.texCoord.x = 1.0f - vertex.texCoord.x;
+	}
+	TangentGenerator::Generate(vertices, indices, false);
+	for (const Vertex& vertex : vertices)
+	{
+		CheckNear(vertex.tangentU, { -1.0f, 0.0f, 0.0f, -1.0f }, 1e-5f);
+		XMVECTOR bitangent = XMVectorScale(XMVector3Cross(XMLoadFloat3(&vertex.normal),
+			XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&vertex.tangentU))), vertex.tangentU.w);
+		CHECK_NEAR(XMVectorGetZ(bitangent), -1.0f, 1e-5f);
+	}
+}
+
+// On a sphere with u = longitude, the exact tangent is d(position)/d(longitude) = normalize(z, 0, -x)
+TEST_CASE(SphereTangentsMatchTheAnalyticFrame)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(5, vertices, indices);
+	TangentGenerator::Generate(vertices, indices, false);
+	CheckTangentFrames(vertices);
+
+	size_t checkedCount = 0;
+	for (const Vertex& vertex : vertices)
+	{
+		// the test sphere's texture coordinates wrap at the seam and pinch at the poles
+		float longitude = atan2f(vertex.pos.x, vertex.pos.z);
+		if (fabsf(vertex.pos.y) > 0.9f || fabsf(longitude) > XM_PI - 0.2f) continue;
+
+		float horizontalLength = sqrtf(vertex.pos.x * vertex.pos.x + vertex.pos.z * vertex.pos.z);
+		XMFLOAT4 expected(vertex.pos.z / horizontalLength, 0.0f, -vertex.pos.x / horizontalLength, 1.0f);
+		CheckNear(vertex.tangentU, expected, 0.01f);
+		++checkedCount;
+	}
+	CHECK(checkedCount > vertices.size() / 2);
+}
+
+// Without a UV gradient the tangent is still a unit vector in the normal plane
+TEST_CASE(DegenerateUVsFallBackToAnyTangent)
+{
+	vector<Vertex> vertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(2, vertices, indices);
+	for (Vertex& vertex : vertices)
+	{
+		vertex.texCoord = { 0.5f, 0.5f };
+	}
+	TangentGenerator::Generate(vertices, indices, false);
+	CheckTangentFrames(vertices);
+}
+
+// The parallel path computes the same triangle batches in fixed-size chunks and adds them in the same order
+TEST_CASE(ParallelAndSixteenBitIndicesMatchSerial)
+{
+	vector<Vertex> serialVertices;
+	vector<uint32_t> indices;
+	CreateIcoSphere(6, serialVertices, indices);
+	CHECK(indices.size() / 3 > TangentGenerator::PARALLEL_TRIANGLE_THRESHOLD);
+	vector<Vertex> parallelVertices = serialVertices;
+	vector<Vertex> shortIndexVertices = serialVertices;
+	TangentGenerator::Generate(serialVertices, indices, false);
+	TangentGenerator::Generate(parallelVertices, indices, true);
+	TangentGenerator::Generate(shortIndexVertices, vector<uint16_t>(indices.begin(), indices.end()), false);
+
+	for (size_t i = 0; i < serialVertices.size(); ++i)
+	{
+		CheckNear(parallelVertices[i].tangentU, serialVertices[i].tangentU, 0.0f);
+		CheckNear(shortIndexVertices[i].tangentU, serialVertices[i].tangentU, 0.0f);
+	}
+}
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "Geometry/Heightfield.h"
+#include "Geometry/TerrainQuadTree.h"
+#include "Benchmark.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+// Large terrains with every chunk resident: building the quadtree, one selection from near the ground (the
+// per frame cost, without frustum culling) and building one chunk mesh on a worker
+int main()
+{
+	auto heightfield = make_shared<Heightfield>();
+	heightfield->GenerateFractalNoise(2049, 1337);
+
+	printf("%9s %6s %10s %8s %9s %8s %9s %9s\n", "worldSize", "levels", "resolution", "nodes", "build ms", "selected", "select ms", "chunk ms");
+	for (uint32_t lodLevelCount : { 6u, 8u, 10u })
+	{
+		for (uint32_t chunkResolution : { 32u, 64u, 128u })
+		{
+			TerrainSettings settings;
+			// finest chunks stay 32 units wide and switch level at twice their size, as a ground level camera would
+			settings.worldSize = 32.0f * (1u << (lodLevelCount - 1));
+			settings.heightScale = 200.0f;
+			settings.lodDistance = 64.0f;
+			settings.lodLevelCount = lodLevelCount;
+			settings.chunkResolution = chunkResolution;
+
+			TerrainQuadTree quadTree;
+			double buildTime = MeasureMilliseconds(3, [&]() { quadTree.Build(heightfield, settings); });
+
+			const XMFLOAT3 eyePos(settings.worldSize * 0.1f, settings.heightScale + 10.0f, -settings.worldSize * 0.2f);
+			vector<uint32_t> selectedNodes, missingNodes;
+			double selectTime = MeasureMilliseconds(21, [&]()
+			{
+				quadTree.Select(eyePos, nullptr, [](uint32_t) { return true; }, selectedNodes, missingNodes);
+			});
+
+			uint32_t nodeIndex = selectedNodes.front();
+			double chunkTime = MeasureMilliseconds(5, [&]() { quadTree.BuildChunkMesh(nodeIndex); });
+			printf("%9.0f %6u %10u %8zu %9.2f %8zu %9.4f %9.3f\n", settings.worldSize, lodLevelCount, chunkResolution,
+				quadTree.GetNodeCount(), buildTime, selectedNodes.size(), selectTime, chunkTime);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,311 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Geometry/Heightfield.h"
+#include "Geometry/TerrainQuadTree.h"
+#include "Geometry/TerrainStreamer.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+using namespace Lunar::Tests;
+
+namespace
+{
+shared_ptr<TerrainQuadTree> CreateQuadTree(const TerrainSettings& settings)
+{
+	auto heightfield = make_shared<Heightfield>();
+	heightfield->GenerateFractalNoise(257, 1337);
+	auto quadTree = make_shared<TerrainQuadTree>();
+	quadTree->Build(heightfield, settings);
+	return quadTree;
+}
+
+TerrainSettings CreateSettings()
+{
+	TerrainSettings settings;
+	settings.chunkResolution = 8;
+	return settings;
+}
+
+// Finest-level cell span of a node, west to east in x and north to south in z
+struct CellRect
+{
+	uint32_t x0, z0, x1, z1;
+};
+
+CellRect GetCellRect(const TerrainNode& node)
+{
+	uint32_t span = 1u << node.level;
+	return { node.x * span, node.z * span, (node.x + 1) * span, (node.z + 1) * span };
+}
+
+// Eye positions from straight above the centre to beyond a corner, so selections span every level
+vector<XMFLOAT3> CreateEyePositions(const TerrainSettings& settings)
+{
+	const float half = settings.worldSize * 0.5f;
+	return { XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(-half, 4.0f, half), XMFLOAT3(half * 0.3f, 10.0f, -half * 0.7f),
+		XMFLOAT3(half * 3.0f, 1.0f, 0.0f) };
+}
+
+// Grid vertices of a chunk lying on the world-space line x = value (alongX false) or z = value (alongX true),
+// as (coordinate along the line, height) pairs sorted by the coordinate
+vector<pair<float, float>> GetEdgeProfile(const TerrainChunkMesh& mesh, uint32_t resolution, bool alongX, float value)
+{
+	const size_t gridVertexCount = static_cast<size_t>(resolution + 1) * (resolution + 1);
+	vector<pair<float, float>> profile;
+	for (size_t i = 0; i < gridVertexCount; ++i)
+	{
+		const XMFLOAT3& pos = mesh.vertices[i].pos;
+		float across = alongX ? pos.z : pos.x;
+		if (fabsf(across - value) < 1e-3f) profile.emplace_back(alongX ? pos.x : pos.z, pos.y);
+	}
+	sort(profile.begin(), profile.end());
+	return profile;
+}
+
+float InterpolateProfile(const vector<pair<float, float>>& profile, float coordinate)
+{
+	auto upper = lower_bound(profile.begin(), profile.end(), coordinate, [](const pair<float, float>& sample, float value) { return sample.first < value; });
+	if (upper == profile.begin()) return upper->second;
+	if (upper == profile.end()) return profile.back().second;
+	auto lower = upper - 1;
+	float t = (coordinate - lower->first) / (upper->first - lower->first);
+	return lower->second + (upper->second - lower->second) * t;
+}
+
+float GetSkirtDepth(const TerrainChunkMesh& mesh, uint32_t resolution)
+{
+	const size_t gridVertexCount = static_cast<size_t>(resolution + 1) * (resolution + 1);
+	return mesh.vertices[0].pos.y - mesh.vertices[gridVertexCount].pos.y;
+}
+
+bool WaitForPendingChunks(TerrainStreamer& streamer, const TerrainQuadTree& quadTree)
+{
+	vector<TerrainChunkMesh> completed;
+	auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+	while (streamer.GetPendingChunkCount() > 0)
+	{
+		if (chrono::steady_clock::now() > deadline) return false;
+		streamer.BeginFrame(completed);
+		for (const TerrainChunkMesh& mesh : completed)
+		{
+			streamer.MarkResident(mesh.nodeIndex);
+		}
+		if (completed.empty()) this_thread::sleep_for(chrono::milliseconds(1));
+	}
+	return true;
+}
+}
+
+// Selected nodes tile the root exactly once, whether everything is resident or only part of the tree is
+TEST_CASE(SelectionCoversTheRootWithoutOverlap)
+{
+	TerrainSettings settings = CreateSettings();
+	auto quadTree = CreateQuadTree(settings);
+	const uint32_t cellsPerEdge = 1u << (settings.lodLevelCount - 1);
+
+	auto allResident = [](uint32_t) { return true; };
+	auto partlyResident = [&](uint32_t nodeIndex) { return quadTree->GetNode(nodeIndex).x % 3 != 1; };
+	for (const XMFLOAT3& eyePos : CreateEyePositions(settings))
+	{
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			vector<uint32_t> selectedNodes, missingNodes;
+			if (pass == 0) quadTree->Select(eyePos, nullptr, allResident, selectedNodes, missingNodes);
+			else quadTree->Select(eyePos, nullptr, partlyResident, selectedNodes, missingNodes);
+
+			vector<uint32_t> coverage(cellsPerEdge * cellsPerEdge, 0);
+			for (uint32_t nodeIndex : selectedNodes)
+			{
+				CellRect rect = GetCellRect(quadTree->GetNode(nodeIndex));
+				for (uint32_t z = rect.z0; z < rect.z1; ++z)
+				{
+					for (uint32_t x = rect.x0; x < rect.x1; ++x)
+					{
+						++coverage[z * cellsPerEdge + x];
+					}
+				}
+			}
+			CHECK(all_of(coverage.begin(), coverage.end(), [](uint32_t count) { return count == 1; }));
+
+			if (pass == 0) CHECK(missingNodes.empty());
+			for (uint32_t nodeIndex : missingNodes)
+			{
+				CHECK(!partlyResident(nodeIndex));
+				CHECK(find(selectedNodes.begin(), selectedNodes.end(), nodeIndex) == selectedNodes.end());
+			}
+		}
+	}
+
+	// right above the centre the finest level has to be reached, from far away only the root is drawn
+	vector<uint32_t> selectedNodes, missingNodes;
+	quadTree->Select(XMFLOAT3(0.0f, 2.0f, 0.0f), nullptr, allResident, selectedNodes, missingNodes);
+	CHECK(any_of(selectedNodes.begin(), selectedNodes.end(), [&](uint32_t nodeIndex) { return quadTree->GetNode(nodeIndex).level == 0; }));
+	quadTree->Select(XMFLOAT3(settings.worldSize * 100.0f, 0.0f, 0.0f), nullptr, allResident, selectedNodes, missingNodes);
+	CHECK(selectedNodes.size() == 1 && selectedNodes[0] == quadTree->GetRootIndex());
+}
+
+// Where chunks of neighbouring levels meet, every vertex of the coarser edge is also a vertex of the finer
+// edge, and the finer vertices in between stay within the reach of the skirt hanging from the higher side
+TEST_CASE(NeighbouringLevelsShareEdgeVerticesAndSkirtsCloseTheGap)
+{
+	TerrainSettings settings = CreateSettings();
+	auto quadTree = CreateQuadTree(settings);
+	const uint32_t resolution = quadTree->GetSettings().chunkResolution;
+	const float cellSize = settings.worldSize / (1u << (settings.lodLevelCount - 1));
+	const float half = settings.worldSize * 0.5f;
+
+	vector<uint32_t> selectedNodes, missingNodes;
+	quadTree->Select(XMFLOAT3(-half, 2.0f, half), nullptr, [](uint32_t) { return true; }, selectedNodes, missingNodes);
+
+	vector<TerrainChunkMesh> meshes;
+	for (uint32_t nodeIndex : selectedNodes)
+	{
+		meshes.push_back(quadTree->BuildChunkMesh(nodeIndex));
+	}
+
+	size_t levelSeamCount = 0;
+	for (size_t a = 0; a < selectedNodes.size(); ++a)
+	{
+		for (size_t b = 0; b < selectedNodes.size(); ++b)
+		{
+			const TerrainNode& fine = quadTree->GetNode(selectedNodes[a]);
+			const TerrainNode& coarse = quadTree->GetNode(selectedNodes[b]);
+			if (fine.level >= coarse.level) continue;
+
+			CellRect f = GetCellRect(fine);
+			CellRect c = GetCellRect(coarse);
+			bool overlapX = f.x0 < c.x1 && c.x0 < f.x1;
+			bool overlapZ = f.z0 < c.z1 && c.z0 < f.z1;
+			bool alongX;
+			float value;
+			if (overlapZ && (f.x1 == c.x0 || c.x1 == f.x0))
+			{
+				alongX = false;
+				value = -half + (f.x1 == c.x0 ? f.x1 : f.x0) * cellSize;
+			}
+			else if (overlapX && (f.z1 == c.z0 || c.z1 == f.z0))
+			{
+				alongX = true;
+				value = half - (f.z1 == c.z0 ? f.z1 : f.z0) * cellSize;
+			}
+			else
+			{
+				continue;
+			}
+			++levelSeamCount;
+
+			vector<pair<float, float>> fineEdge = GetEdgeProfile(meshes[a], resolution, alongX, value);
+			vector<pair<float, float>> coarseEdge = GetEdgeProfile(meshes[b], resolution, alongX, value);
+			CHECK(fineEdge.size() == resolution + 1);
+			CHECK(coarseEdge.size() == resolution + 1);
+			const float fineSkirt = GetSkirtDepth(meshes[a], resolution);
+			const float coarseSkirt = GetSkirtDepth(meshes[b], resolution);
+			CHECK(fineSkirt > 0.0f && coarseSkirt > fineSkirt);
+
+			const float lo = fineEdge.front().first;
+			const float hi = fineEdge.back().first;
+			for (const pair<float, float>& sample : coarseEdge)
+			{
+				if (sample.first < lo - 1e-3f || sample.first > hi + 1e-3f) continue;
+				auto match = min_element(fineEdge.begin(), fineEdge.end(), [&](const pair<float, float>& l, const pair<float, float>& r)
+				{
+					return fabsf(l.first - sample.first) < fabsf(r.first - sample.first);
+				});
+				CHECK_NEAR(match->first, sample.first, 1e-3);
+				CHECK_NEAR(match->second, sample.second, 1e-4);
+			}
+			for (const pair<float, float>& sample : fineEdge)
+			{
+				float coarseHeight = InterpolateProfile(coarseEdge, sample.first);
+				if (sample.second > coarseHeight) CHECK(sample.second - fineSkirt <= coarseHeight + 1e-4f);
+				else CHECK(coarseHeight - coarseSkirt <= sample.second + 1e-4f);
+			}
+		}
+	}
+	CHECK(levelSeamCount > 0);
+
+	// each skirt vertex hangs straight below its border vertex, walked north, east, south, west
+	const TerrainChunkMesh& mesh = meshes[0];
+	const uint32_t verticesPerRow = resolution + 1;
+	const float skirtDepth = GetSkirtDepth(mesh, resolution);
+	for (uint32_t edge = 0; edge < 4; ++edge)
+	{
+		for (uint32_t i = 0; i <= resolution; ++i)
+		{
+			uint32_t border = edge == 0 ? i : edge == 1 ? i * verticesPerRow + resolution
+				: edge == 2 ? resolution * verticesPerRow + (resolution - i) : (resolution - i) * verticesPerRow;
+			const XMFLOAT3& top = mesh.vertices[border].pos;
+			const XMFLOAT3& bottom = mesh.vertices[verticesPerRow * verticesPerRow + edge * verticesPerRow + i].pos;
+			CHECK(top.x == bottom.x && top.z == bottom.z);
+			CHECK_NEAR(top.y - bottom.y, skirtDepth, 1e-4);
+		}
+	}
+}
+
+// Chunks come back through BeginFrame a few per frame, at most maxPendingChunks are in flight, and eviction
+// drops the least recently used chunks but never the root or a chunk drawn this frame
+TEST_CASE(StreamerKeepsItsBudgetsAndEvictsLeastRecentlyUsed)
+{
+	TerrainSettings settings = CreateSettings();
+	auto quadTree = CreateQuadTree(settings);
+	TerrainStreamer streamer;
+	streamer.Reset(quadTree);
+	streamer.SetMaxPendingChunks(3);
+	streamer.SetMaxUploadsPerFrame(2);
+
+	vector<TerrainChunkMesh> ready;
+	streamer.Request({ quadTree->GetRootIndex() }, ready);
+	CHECK(ready.empty());
+	CHECK(WaitForPendingChunks(streamer, *quadTree));
+	CHECK(streamer.IsResident(quadTree->GetRootIndex()));
+
+	const vector<uint32_t> level1 = { 1, 2, 3, 4 };
+	streamer.Request(level1, ready);
+	CHECK(streamer.GetPendingChunkCount() == 3);
+	CHECK(!streamer.IsPending(level1[3]));
+
+	this_thread::sleep_for(chrono::milliseconds(50));
+	streamer.BeginFrame(ready);
+	CHECK(ready.size() <= 2);
+	for (const TerrainChunkMesh& mesh : ready)
+	{
+		streamer.MarkResident(mesh.nodeIndex);
+	}
+	CHECK(WaitForPendingChunks(streamer, *quadTree));
+	streamer.Request(level1, ready);
+	CHECK(WaitForPendingChunks(streamer, *quadTree));
+	CHECK(streamer.GetResidentChunkCount() == 5);
+
+	// node 1 is drawn in a later frame than the others, so it survives while 2 and 3 go
+	vector<uint32_t> evicted;
+	streamer.SetMaxResidentChunks(3);
+	streamer.BeginFrame(ready);
+	streamer.Touch({ 4 });
+	streamer.BeginFrame(ready);
+	streamer.Touch({ 1 });
+	streamer.Evict(evicted);
+	CHECK(evicted.size() == 2);
+	CHECK(find(evicted.begin(), evicted.end(), 1u) == evicted.end());
+	CHECK(find(evicted.begin(), evicted.end(), 4u) == evicted.end());
+	CHECK(streamer.GetResidentChunkCount() == 3);
+	CHECK(streamer.IsResident(quadTree->GetRootIndex()) && streamer.IsResident(1) && streamer.IsResident(4));
+
+	// the budget cannot be met without dropping chunks in use, so those stay
+	streamer.SetMaxResidentChunks(0);
+	streamer.Evict(evicted);
+	CHECK(evicted.size() == 1 && evicted[0] == 4);
+	CHECK(streamer.IsResident(quadTree->GetRootIndex()) && streamer.IsResident(1));
+
+	// without streaming the requested chunks are built inline and nothing goes pending
+	streamer.SetStreaming(false);
+	streamer.Request({ 2, 3 }, ready);
+	CHECK(ready.size() == 2 && streamer.GetPendingChunkCount() == 0);
+	CHECK(ready[0].nodeIndex == 2 && ready[1].nodeIndex == 3);
+}
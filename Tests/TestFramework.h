@@ -0,0 +1,49 @@
+#pragma once
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Minimal test registry for the headless modules: TEST_CASE registers a function, CHECK and CHECK_NEAR record
+// failures without stopping the case, and TestMain.cpp runs every case and fails the process if any check did.
+namespace Lunar::Tests
+{
+struct TestCase
+{
+	const char* name;
+	void (*function)();
+};
+
+std::vector<TestCase>& GetTestCases();
+void ReportFailure(const char* file, int line, const std::string& message);
+
+struct TestRegistrar
+{
+	TestRegistrar(const char* name, void (*function)()) { GetTestCases().push_back({ name, function }); }
+};
+
+template<typename A, typename B>
+std::string DescribeNear(const char* expression, const A& actual, const B& expected, double tolerance)
+{
+	std::stringstream message;
+	message << expression << ": " << actual << " is not within " << tolerance << " of " << expected;
+	return message.str();
+}
+} // namespace Lunar::Tests
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static Lunar::Tests::TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) Lunar::Tests::ReportFailure(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+	do \
+	{ \
+		double checkActual = static_cast<double>(actual); \
+		double checkExpected = static_cast<double>(expected); \
+		if (!(std::fabs(checkActual - checkExpected) <= (tolerance))) \
+			Lunar::Tests::ReportFailure(__FILE__, __LINE__, Lunar::Tests::DescribeNear(#actual, checkActual, checkExpected, tolerance)); \
+	} while (0)
@@ -0,0 +1,47 @@
+#include <cstring>
+#include <iostream>
+
+#include "TestFramework.h"
+
+using namespace std;
+
+namespace Lunar::Tests
+{
+namespace
+{
+int g_failureCount = 0;
+}
+
+vector<TestCase>& GetTestCases()
+{
+	static vector<TestCase> testCases;
+	return testCases;
+}
+
+void ReportFailure(const char* file, int line, const string& message)
+{
+	++g_failureCount;
+	cerr << file << "(" << line << "): check failed: " << message << endl;
+}
+} // namespace Lunar::Tests
+
+// Runs every registered case, or only those whose name contains the first argument
+int main(int argc, char** argv)
+{
+	using namespace Lunar::Tests;
+	const char* filter = argc > 1 ? argv[1] : nullptr;
+	int failedCaseCount = 0;
+	int runCount = 0;
+	for (const TestCase& testCase : GetTestCases())
+	{
+		if (filter && !strstr(testCase.name, filter)) continue;
+		int failuresBefore = g_failureCount;
+		testCase.function();
+		++runCount;
+		bool passed = g_failureCount == failuresBefore;
+		if (!passed) ++failedCaseCount;
+		cout << (passed ? "[  OK  ] " : "[FAILED] ") << testCase.name << endl;
+	}
+	cout << runCount - failedCaseCount << "/" << runCount << " test cases passed" << endl;
+	return failedCaseCount == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "TestMeshes.h"
+
+#include <cmath>
+
+#include "Geometry/IcoSphereSubdivider.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar::Tests
+{
+void GetIcosahedron(vector<XMFLOAT3>& outPositions, vector<uint32_t>& outIndices)
+{
+	float goldenRatio = 1.618f;
+	float inverseNormal = 1.0f / sqrtf(goldenRatio * goldenRatio + 1.0f);
+	goldenRatio *= inverseNormal;
+
+	outPositions = {
+		{ -inverseNormal, goldenRatio, 0 }, { inverseNormal, goldenRatio, 0 },
+		{ -inverseNormal, -goldenRatio, 0 }, { inverseNormal, -goldenRatio, 0 },
+		{ 0, -inverseNormal, goldenRatio }, { 0, inverseNormal, goldenRatio },
+		{ 0, -inverseNormal, -goldenRatio }, { 0, inverseNormal, -goldenRatio },
+		{ goldenRatio, 0, -inverseNormal }, { goldenRatio, 0, inverseNormal },
+		{ -goldenRatio, 0, -inverseNormal }, { -goldenRatio, 0, inverseNormal } };
+	outIndices = {
+		0, 11, 5,    0, 5, 1,     0, 1, 7,     0, 7, 10,    0, 10, 11,
+		1, 5, 9,     5, 11, 4,    11, 10, 2,   10, 7, 6,    7, 1, 8,
+		3, 9, 4,     3, 4, 2,     3, 2, 6,     3, 6, 8,     3, 8, 9,
+		4, 9, 5,     2, 4, 11,    6, 2, 10,    8, 6, 7,     9, 8, 1 };
+}
+
+void CreateIcoSphere(int level, vector<Vertex>& outVertices, vector<uint32_t>& outIndices)
+{
+	vector<XMFLOAT3> basePositions;
+	vector<uint32_t> baseIndices;
+	GetIcosahedron(basePositions, baseIndices);
+	vector<XMFLOAT3> positions;
+	IcoSphereSubdivider::Subdivide(basePositions, baseIndices, level, false, positions, outIndices);
+
+	outVertices.resize(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		const XMFLOAT3& position = positions[i];
+		Vertex& vertex = outVertices[i];
+		vertex.pos = position;
+		vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+		vertex.texCoord = { atan2f(position.x, position.z) / XM_2PI + 0.5f, asinf(position.y) / XM_PI + 0.5f };
+		vertex.normal = position;
+		vertex.tangentU = { 0.0f, 0.0f, 0.0f, 1.0f };
+	}
+}
+
+void CreateGrid(uint32_t columns, uint32_t rows, float size, vector<Vertex>& outVertices, vector<uint32_t>& outIndices)
+{
+	outVertices.clear();
+	outIndices.clear();
+	for (uint32_t row = 0; row <= rows; ++row)
+	{
+		for (uint32_t column = 0; column <= columns; ++column)
+		{
+			float u = static_cast<float>(column) / columns;
+			float v = static_cast<float>(row) / rows;
+			Vertex vertex;
+			vertex.pos = { (u - 0.5f) * size, 0.0f, (0.5f - v) * size };
+			vertex.color = { 1.0f, 1.0f, 1.0f, 1.0f };
+			vertex.texCoord = { u, v };
+			vertex.normal = { 0.0f, 1.0f, 0.0f };
+			vertex.tangentU = { 1.0f, 0.0f, 0.0f, 1.0f };
+			outVertices.push_back(vertex);
+		}
+	}
+	for (uint32_t row = 0; row < rows; ++row)
+	{
+		for (uint32_t column = 0; column < columns; ++column)
+		{
+			uint32_t topLeft = row * (columns + 1) + column;
+			uint32_t bottomLeft = topLeft + columns + 1;
+			outIndices.insert(outIndices.end(), { topLeft, topLeft + 1, bottomLeft, bottomLeft, topLeft + 1, bottomLeft + 1 });
+		}
+	}
+}
+} // namespace Lunar::Tests
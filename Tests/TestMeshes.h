@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "Geometry/Vertex.h"
+
+// Meshes shared by the tests and benchmarks, built the way the Geometry classes build them
+namespace Lunar::Tests
+{
+// The 12 vertices and 20 outward-facing triangles of IcoSphere's base mesh
+void GetIcosahedron(std::vector<DirectX::XMFLOAT3>& outPositions, std::vector<uint32_t>& outIndices);
+
+// Unit icosphere subdivided level times, with normals along the positions and spherical texture coordinates
+void CreateIcoSphere(int level, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices);
+
+// Flat grid in the xz plane facing +y, size wide, with u along +x and v along -z
+void CreateGrid(uint32_t columns, uint32_t rows, float size, std::vector<Vertex>& outVertices, std::vector<uint32_t>& outIndices);
+} // namespace Lunar::Tests
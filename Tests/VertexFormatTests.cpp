@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Geometry/VertexFormat.h"
+#include "TestFramework.h"
+
+using namespace std;
+using namespace DirectX;
+using namespace Lunar;
+
+namespace
+{
+// Fibonacci lattice: count directions spread evenly over the sphere, plus the axes where the octahedron folds
+vector<XMFLOAT3> GetTestDirections(size_t count)
+{
+	vector<XMFLOAT3> directions = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f } };
+	const float goldenAngle = XM_PI * (3.0f - sqrtf(5.0f));
+	for (size_t i = 0; i < count; ++i)
+	{
+		float z = 1.0f - 2.0f * (i + 0.5f) / count;
+		float radius = sqrtf(1.0f - z * z);
+		float phi = goldenAngle * i;
+		directions.push_back({ radius * cosf(phi), radius * sinf(phi), z });
+	}
+	return directions;
+}
+
+// atan2 of the cross and dot products stays accurate for small angles, unlike acos of the dot product
+double GetAngleDegrees(const XMFLOAT3& a, const XMFLOAT3& b)
+{
+	double crossX = double(a.y) * b.z - double(a.z) * b.y;
+	double crossY = double(a.z) * b.x - double(a.x) * b.z;
+	double crossZ = double(a.x) * b.y - double(a.y) * b.x;
+	double dot = double(a.x) * b.x + double(a.y) * b.y + double(a.z) * b.z;
+	return atan2(sqrt(crossX * crossX + crossY * crossY + crossZ * crossZ), dot) * 180.0 / 3.14159265358979;
+}
+}
+
+TEST_CASE(StridesMatchTheInputLayouts)
+{
+	CHECK(VertexFormatUtils::GetStride(VertexFormat::Default) == 64);
+	CHECK(VertexFormatUtils::GetStride(VertexFormat::Compact) == 28);
+
+	vector<Vertex> vertices(100);
+	CHECK(VertexFormatUtils::PackVertices(vertices, VertexFormat::Default).size() == 100 * 64);
+	CHECK(VertexFormatUtils::PackVertices(vertices, VertexFormat::Compact).size() == 100 * 28);
+}
+
+// 16-bit octahedral normals stay within 0.005 degrees
+TEST_CASE(OctahedralNormalsRoundTrip)
+{
+	double maxError = 0.0;
+	for (const XMFLOAT3& direction : GetTestDirections(20000))
+	{
+		XMFLOAT3 decoded = VertexFormatUtils::DecodeOctahedral(VertexFormatUtils::EncodeOctahedral(direction));
+		CHECK_NEAR(XMVectorGetX(XMVector3Length(XMLoadFloat3(&decoded))), 1.0f, 1e-5f);
+		maxError = max(maxError, GetAngleDegrees(direction, decoded));
+	}
+	CHECK(maxError < 0.005);
+}
+
+// The tangent gives up one bit of y to the handedness, which must survive even where y encodes to zero
+TEST_CASE(OctahedralTangentsKeepHandedness)
+{
+	double maxError = 0.0;
+	for (const XMFLOAT3& direction : GetTestDirections(20000))
+	{
+		for (float handedness : { 1.0f, -1.0f })
+		{
+			XMFLOAT4 tangent(direction.x, direction.y, direction.z, handedness);
+			XMFLOAT4 decoded = VertexFormatUtils::DecodeOctahedralTangent(VertexFormatUtils::EncodeOctahedralTangent(tangent));
+			CHECK(decoded.w == handedness);
+			maxError = max(maxError, GetAngleDegrees(direction, { decoded.x, decoded.y, decoded.z }));
+		}
+	}
+	CHECK(maxError < 0.01);
+}
+
+TEST_CASE(ColorsRoundToTheNearestUnorm8)
+{
+	for (int i = 0; i <= 1000; ++i)
+	{
+		float value = i / 1000.0f;
+		XMFLOAT4 color(value, 1.0f - value, value * value, 1.0f);
+		XMFLOAT4 decoded = VertexFormatUtils::UnpackColor(VertexFormatUtils::PackColor(color));
+		CHECK_NEAR(decoded.x, color.x, 0.5f / 255.0f + 1e-6f);
+		CHECK_NEAR(decoded.y, color.y, 0.5f / 255.0f + 1e-6f);
+		CHECK_NEAR(decoded.z, color.z, 0.5f / 255.0f + 1e-6f);
+		CHECK(decoded.w == 1.0f);
+	}
+}
+
+// Half floats keep 11 significant bits, so tiled texture coordinates up to a few repeats stay sub-texel
+TEST_CASE(TexCoordsKeepHalfPrecision)
+{
+	for (int i = 0; i <= 4000; ++i)
+	{
+		XMFLOAT2 texCoord(i / 1000.0f, 4.0f - i / 1000.0f);
+		XMFLOAT2 decoded = VertexFormatUtils::UnpackHalf2(VertexFormatUtils::PackHalf2(texCoord));
+		CHECK_NEAR(decoded.x, texCoord.x, max(texCoord.x, 6.1e-5f) * 0.5f / 1024.0f);
+		CHECK_NEAR(decoded.y, texCoord.y, max(texCoord.y, 6.1e-5f) * 0.5f / 1024.0f);
+	}
+}
+
+TEST_CASE(PackVerticesMatchesPackVertex)
+{
+	vector<Vertex> vertices;
+	for (const XMFLOAT3& direction : GetTestDirections(64))
+	{
+		Vertex vertex;
+		vertex.pos = { direction.x * 3.0f, direction.y * 3.0f, direction.z * 3.0f };
+		vertex.color = { 0.25f, 0.5f, 0.75f, 1.0f };
+		vertex.texCoord = { direction.x * 0.5f + 0.5f, direction.y * 0.5f + 0.5f };
+		vertex.normal = direction;
+		vertex.tangentU = { -direction.y, direction.x, 0.0f, direction.z < 0.0f ? -1.0f : 1.0f };
+		vertices.push_back(vertex);
+	}
+
+	vector<uint8_t> bytes = VertexFormatUtils::PackVertices(vertices, VertexFormat::Compact);
+	const CompactVertex* packed = reinterpret_cast<const CompactVertex*>(bytes.data());
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		CompactVertex expected = VertexFormatUtils::PackVertex(vertices[i]);
+		CHECK(packed[i].pos.x == expected.pos.x && packed[i].pos.y == expected.pos.y && packed[i].pos.z == expected.pos.z);
+		CHECK(packed[i].color == expected.color);
+		CHECK(packed[i].texCoord == expected.texCoord);
+		CHECK(packed[i].normal == expected.normal);
+		CHECK(packed[i].tangentU == expected.tangentU);
+
+		Vertex unpacked = VertexFormatUtils::UnpackVertex(packed[i]);
+		CHECK(unpacked.pos.x == vertices[i].pos.x && unpacked.pos.y == vertices[i].pos.y && unpacked.pos.z == vertices[i].pos.z);
+		CHECK(unpacked.tangentU.w == vertices[i].tangentU.w);
+	}
+}
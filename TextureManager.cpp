@@ -1,5 +1,6 @@
 #include "TextureManager.h"
 
+#include <chrono>
 #include <DirectXTex.h>
 #include <DirectXMath.h>
 #include <DirectXPackedVector.h>
@@ -9,9 +10,11 @@
 #include <cmath>
 
 #include "DescriptorAllocator.h"
-#include "PipelineStateManager.h"
+#include "Utils/IBLBaker.h"
+#include "Utils/IBLCache.h"
 #include "Utils/IBLUtils.h"
 #include "Utils/Logger.h"
+#include "Utils/ThreadPool.h"
 #include "Utils/Utils.h"
 
 using namespace std;
@@ -20,8 +23,46 @@ using namespace DirectX;
 
 namespace Lunar
 {
+namespace
+{
+// Appends mips [0, mipCount) of a cubemap as RGBA16F in D3D12 subresource order (mip + face * mipCount)
+void PackCubemap(const CubemapImage& cubemap, int mipCount, vector<uint16_t>& outTexels)
+{
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int mip = 0; mip < mipCount; ++mip)
+		{
+			const float* texels = cubemap.GetFace(mip, face);
+			size_t floatCount = static_cast<size_t>(cubemap.GetMipSize(mip)) * cubemap.GetMipSize(mip) * 4;
+			for (size_t i = 0; i < floatCount; ++i)
+			{
+				outTexels.push_back(PackedVector::XMConvertFloatToHalf(texels[i]));
+			}
+		}
+	}
+}
+
+CubemapImage UnpackCubemap(const uint16_t* texels, int size, int mipCount)
+{
+	CubemapImage cubemap;
+	cubemap.Allocate(size, mipCount);
+	for (int face = 0; face < 6; ++face)
+	{
+		for (int mip = 0; mip < mipCount; ++mip)
+		{
+			float* faceTexels = cubemap.GetFace(mip, face);
+			size_t floatCount = static_cast<size_t>(cubemap.GetMipSize(mip)) * cubemap.GetMipSize(mip) * 4;
+			for (size_t i = 0; i < floatCount; ++i)
+			{
+				faceTexels[i] = PackedVector::XMConvertHalfToFloat(*texels++);
+			}
+		}
+	}
+	return cubemap;
+}
+} // namespace
 	
-void TextureManager::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator, PipelineStateManager* pipelineStateManager)
+void TextureManager::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator)
 {
 	LOG_FUNCTION_ENTRY();
 
@@ -29,7 +70,7 @@ void TextureManager::Initialize(ID3D12Device* device, ID3D12GraphicsCommandList*
     {
     	if (textureInfo.fileType == LunarConstants::FileType::HDR)
     	{
-    		LoadHDRImage(textureInfo, device, commandList, descriptorAllocator, pipelineStateManager);
+    		LoadHDRImage(textureInfo, device, commandList, descriptorAllocator);
     		continue;
     	}
         Texture texture = {};
@@ -92,6 +133,12 @@ void TextureManager::CreateShaderResourceView(const LunarConstants::TextureInfo&
 									 // Use 0.0f for no clamping (most common)
 	};
 	*/
+	descriptorAllocator->AllocateDescriptor(textureInfo.name);
+	WriteShaderResourceView(textureInfo, textureInfo.name, textureInfo.name, descriptorAllocator, mipLevels);
+}
+
+void TextureManager::WriteShaderResourceView(const LunarConstants::TextureInfo& textureInfo, const string& textureName, const string& descriptorName, DescriptorAllocator* descriptorAllocator, UINT mipLevels)
+{
 	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
 	srvDesc.ViewDimension = static_cast<D3D12_SRV_DIMENSION>(textureInfo.dimensionType);
 	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
@@ -107,14 +154,13 @@ void TextureManager::CreateShaderResourceView(const LunarConstants::TextureInfo&
 		srvDesc.Texture2D.ResourceMinLODClamp = 0.0f;
 	}
 
-	Texture* texture = m_textureMap[textureInfo.name].get();
+	Texture* texture = m_textureMap[textureName].get();
 	if (!texture || !texture->Resource) {
-		LOG_ERROR("Failed to create texture resource for: ", textureInfo.name);
+		LOG_ERROR("Failed to create texture resource for: ", textureName);
 		return;
 	}
 	srvDesc.Format = texture->Resource->GetDesc().Format;
-	descriptorAllocator->AllocateDescriptor(textureInfo.name);
-	descriptorAllocator->CreateSRV(texture->Resource.Get(), &srvDesc, textureInfo.name);
+	descriptorAllocator->CreateSRV(texture->Resource.Get(), &srvDesc, descriptorName);
 }
 
 ComPtr<ID3D12Resource> TextureManager::LoadTexture(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const std::string& filename, ComPtr<ID3D12Resource>& uploadBuffer)
@@ -167,9 +213,8 @@ ComPtr<ID3D12Resource> TextureManager::LoadTexture(const LunarConstants::Texture
     		LOG_DEBUG("Cubemap loaded: ", filename, " (", width, "x", height, ")");
     		textureDesc.Width = static_cast<UINT>(width);
     		textureDesc.Height = static_cast<UINT>(height);
-    		rowSizeInBytes = UINT64(width) * 4; // RGBA
         
-    		ComPtr<ID3D12Resource> texture = CreateCubemapResource(device, commandList, textureDesc, faceData, rowSizeInBytes, uploadBuffer);
+    		ComPtr<ID3D12Resource> texture = CreateCubemapResource(device, commandList, textureDesc, vector<const uint8_t*>(faceData.begin(), faceData.end()), uploadBuffer);
         
     		for (int i = 0; i < 6; ++i) {
     			stbi_image_free(faceData[i]);
@@ -365,16 +410,8 @@ ComPtr<ID3D12Resource> TextureManager::CreateTextureResource(ID3D12Device* devic
 	return texture;
 }
 
-ComPtr<ID3D12Resource> TextureManager::CreateCubemapResource(
-    ID3D12Device* device, 
-    ID3D12GraphicsCommandList* commandList, 
-    const D3D12_RESOURCE_DESC& textureDesc, 
-    const std::vector<uint8_t*>& faceData, 
-    UINT64 rowSizeInBytes, 
-    ComPtr<ID3D12Resource>& uploadBuffer)
+ComPtr<ID3D12Resource> TextureManager::CreateCopyDestTexture(ID3D12Device* device, const D3D12_RESOURCE_DESC& textureDesc, ComPtr<ID3D12Resource>& uploadBuffer)
 {
-    LOG_FUNCTION_ENTRY();
-    
     D3D12_HEAP_PROPERTIES defaultHeapProperties = {};
     defaultHeapProperties.Type = D3D12_HEAP_TYPE_DEFAULT;
     defaultHeapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
@@ -390,26 +427,9 @@ ComPtr<ID3D12Resource> TextureManager::CreateCubemapResource(
         D3D12_RESOURCE_STATE_COPY_DEST, 
         nullptr, IID_PPV_ARGS(&texture)));
 
-    // calculate the layout of the 6 subresources
-    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(6);
-    std::vector<UINT> numRows(6);
-    std::vector<UINT64> rowPitch(6);
+    UINT subresourceCount = textureDesc.DepthOrArraySize * textureDesc.MipLevels;
     UINT64 totalUploadBufferSize = 0;
-    
-    for (int face = 0; face < 6; ++face) {
-        UINT64 faceUploadSize;
-        device->GetCopyableFootprints(
-            &textureDesc,           
-            face,                   
-            1,                      
-            totalUploadBufferSize,  
-            &layouts[face],         
-            &numRows[face],         
-            &rowPitch[face],        
-            &faceUploadSize         
-        );
-        totalUploadBufferSize += faceUploadSize;
-    }
+    device->GetCopyableFootprints(&textureDesc, 0, subresourceCount, 0, nullptr, nullptr, nullptr, &totalUploadBufferSize);
 
     D3D12_HEAP_PROPERTIES uploadHeapProperties = defaultHeapProperties;
     uploadHeapProperties.Type = D3D12_HEAP_TYPE_UPLOAD;
@@ -432,32 +452,62 @@ ComPtr<ID3D12Resource> TextureManager::CreateCubemapResource(
         &uploadBufferDesc,
         D3D12_RESOURCE_STATE_GENERIC_READ,
         nullptr, IID_PPV_ARGS(&uploadBuffer)));
+    return texture;
+}
+
+ComPtr<ID3D12Resource> TextureManager::CreateCubemapResource(
+    ID3D12Device* device, 
+    ID3D12GraphicsCommandList* commandList, 
+    const D3D12_RESOURCE_DESC& textureDesc, 
+    const std::vector<const uint8_t*>& subresourceData, 
+    ComPtr<ID3D12Resource>& uploadBuffer)
+{
+    LOG_FUNCTION_ENTRY();
     
+    ComPtr<ID3D12Resource> texture = CreateCopyDestTexture(device, textureDesc, uploadBuffer);
+
+    // calculate the layout of every mip of the 6 faces
+    UINT subresourceCount = 6 * textureDesc.MipLevels;
+    std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresourceCount);
+    std::vector<UINT> numRows(subresourceCount);
+    std::vector<UINT64> rowSizesInBytes(subresourceCount);
+    device->GetCopyableFootprints(
+        &textureDesc,
+        0,
+        subresourceCount,
+        0,
+        layouts.data(),
+        numRows.data(),
+        rowSizesInBytes.data(),
+        nullptr
+    );
+
     void* mappedData;
     uploadBuffer->Map(0, nullptr, &mappedData);
     
-    for (int face = 0; face < 6; ++face) {
-        BYTE* destSliceStart = reinterpret_cast<BYTE*>(mappedData) + layouts[face].Offset;
-        for (UINT row = 0; row < numRows[face]; ++row) {
+    // source rows are tightly packed
+    for (UINT subresource = 0; subresource < subresourceCount; ++subresource) {
+        BYTE* destSliceStart = reinterpret_cast<BYTE*>(mappedData) + layouts[subresource].Offset;
+        for (UINT row = 0; row < numRows[subresource]; ++row) {
             memcpy(
-                destSliceStart + layouts[face].Footprint.RowPitch * row, 
-                faceData[face] + rowSizeInBytes * row, 
-                rowSizeInBytes
+                destSliceStart + layouts[subresource].Footprint.RowPitch * row, 
+                subresourceData[subresource] + rowSizesInBytes[subresource] * row, 
+                rowSizesInBytes[subresource]
             ); 
         }
     }
     uploadBuffer->Unmap(0, nullptr);
 
-    for (int face = 0; face < 6; ++face) {
+    for (UINT subresource = 0; subresource < subresourceCount; ++subresource) {
         D3D12_TEXTURE_COPY_LOCATION destLocation = {};
         destLocation.pResource = texture.Get();
         destLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
-        destLocation.SubresourceIndex = face;  
+        destLocation.SubresourceIndex = subresource;  
 
         D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
         srcLocation.pResource = uploadBuffer.Get();
         srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
-        srcLocation.PlacedFootprint = layouts[face];  
+        srcLocation.PlacedFootprint = layouts[subresource];  
 
         commandList->CopyTextureRegion(&destLocation, 0, 0, 0, &srcLocation, nullptr);
     }
@@ -475,94 +525,6 @@ ComPtr<ID3D12Resource> TextureManager::CreateCubemapResource(
     return texture;
 }
 
-vector<vector<float>> TextureManager::EquirectangularToCubemap(float* imageData, UINT width, UINT height)
-{
-    UINT cubemapSize = max(width / 4, height / 2);
-
-    vector<vector<float>> faceData(6);
-
-    for (int face = 0; face < 6; ++face) {
-        LOG_DEBUG("Processing cubemap face: ", face);
-        faceData[face].resize(cubemapSize * cubemapSize * 3); // 3 channels RGB
-
-        for (int y = 0; y < cubemapSize; ++y) {
-            for (int x = 0; x < cubemapSize; ++x) {
-                // Convert cubemap coordinates to direction 
-                float u = ((x + 0.5f) * 2.0f) / cubemapSize - 1.0f; // [-1, 1]
-                float v = ((y + 0.5f) * 2.0f) / cubemapSize - 1.0f; 
-
-                float direction[3];
-                switch (face) {
-                	case 0: // +X
-                		direction[0] = 1.0f;
-						direction[1] = -v;
-						direction[2] = -u;
-						break;
-                	case 1: // -X
-                		direction[0] = -1.0f;
-						direction[1] = -v;
-						direction[2] = u;
-						break;
-                	case 2: // +Y
-                		direction[0] = u;
-						direction[1] = 1.0f;
-						direction[2] = v;
-						break;
-                	case 3: // -Y
-                		direction[0] = u;
-						direction[1] = -1.0f;
-						direction[2] = -v;
-						break;
-                	case 4: // +Z
-                		direction[0] = u;
-						direction[1] = -v;
-						direction[2] = 1.0f;
-						break;
-                	case 5: // -Z
-                		direction[0] = -u;
-						direction[1] = -v;
-						direction[2] = -1.0f;
-						break;
-                    default:
-                        LOG_ERROR("Invalid cubemap face index: ", face);
-                        continue;
-                }
-                // Normalize direction vector
-                float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
-                if (length == 0.0f) {
-                    LOG_ERROR("Zero length direction vector for cubemap face: ", face);
-                    continue;
-                }
-                direction[0] /= length;
-                direction[1] /= length;
-                direction[2] /= length;
-
-                float M_PI = 3.14159;
-                float theta = atan2f(direction[2], direction[0]); // azimuth
-                float phi = asinf(direction[1]); // elevation
-                float equiU = (theta + M_PI) / (2.0f * M_PI); 
-                // float equiV = (phi + M_PI / 2.0f) / M_PI;
-            	float equiV = 0.5 - phi / M_PI; 
-
-                int equiX = static_cast<int>(equiU * width);
-                int equiY = static_cast<int>(equiV * height);
-                equiX = std::clamp(equiX, 0, static_cast<int>(width - 1));
-                equiY = std::clamp(equiY, 0, static_cast<int>(height - 1));
-
-                // data sampling
-                int srcIndex = (equiY * width + equiX) * 3; // 3 : channels RGB
-                int dstIndex = (y * cubemapSize + x) * 3; // 3 : channels RGB
-
-                faceData[face][dstIndex] = imageData[srcIndex];     // R
-                faceData[face][dstIndex + 1] = imageData[srcIndex + 1]; // G
-                faceData[face][dstIndex + 2] = imageData[srcIndex + 2]; // B
-            }
-        }
-    }
-    
-    return faceData;
-}
-
 ComPtr<ID3D12Resource> TextureManager::CreateEmptyMapResource(ID3D12Device* device, UINT mapSize, UINT depthOrArraySize, DXGI_FORMAT format, UINT mipLevels)
 {
     LOG_FUNCTION_ENTRY();
@@ -600,31 +562,146 @@ ComPtr<ID3D12Resource> TextureManager::CreateEmptyMapResource(ID3D12Device* devi
     return emptyMap;
 }
 
-void TextureManager::LoadHDRImage(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator, const PipelineStateManager* pipelineStateManager)
+void TextureManager::LoadHDRImage(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator)
 {
-	// 1. Load HDR Image and save as a cubemap
-	// 2. Create an empty cubemap resource for irradiance map
-	// 3. Calculate the irradiance map and copy to the resource
+	// 1. Hash the HDR file and bake settings; a cache file with the same key is uploaded as is
+	// 2. Otherwise bake the cubemap, SH irradiance, prefiltered mips and BRDF LUT, and write the cache
+	// 3. Upload the cubemap, the prefiltered map and the BRDF LUT
 	
 	string filename = textureInfo.path;
-	
-    if (stbi_is_hdr(filename.c_str()) == 0)
+	auto loadStart = chrono::steady_clock::now();
+
+	MappedFile source;
+	if (!source.Open(filename))
+	{
+		LOG_ERROR("Failed to load HDR texture: ", filename);
+		throw std::runtime_error("Failed to load HDR texture: " + filename);
+	}
+
+	m_environmentInfo = &textureInfo;
+	IBLBakeSettings bakeSettings;
+	uint64_t key = IBLCache::ComputeKey(source.GetData(), source.GetSize(), bakeSettings);
+	filesystem::path cachePath(filename);
+	cachePath.replace_extension(".libl");
+
+	IBLCache cache;
+	if (cache.Open(cachePath.string(), key))
+	{
+		CreateIBLTextures(textureInfo, device, commandList, descriptorAllocator, cache.GetHeader(),
+			cache.GetCubemapData(), cache.GetPrefilteredData(), cache.GetBRDFLutData());
+		LOG_DEBUG("IBL loaded from cache: ", cachePath.string(), " in ", chrono::duration<float, milli>(chrono::steady_clock::now() - loadStart).count(), " ms");
+		return;
+	}
+
+	IBLCacheData baked = BakeHDRImage(source, bakeSettings);
+	source.Close();
+	LOG_DEBUG("IBL baked: ", filename, " in ", chrono::duration<float, milli>(chrono::steady_clock::now() - loadStart).count(), " ms");
+
+	// a failed write only costs the next launch another bake
+	IBLCache::Write(cachePath.string(), key, baked);
+	CreateIBLTextures(textureInfo, device, commandList, descriptorAllocator, IBLCache::CreateHeader(key, baked),
+		baked.cubemap.data(), baked.prefiltered.data(), baked.brdfLut.data());
+}
+
+IBLCacheData TextureManager::BakeHDRImage(const MappedFile& source, const IBLBakeSettings& bakeSettings)
+{
+	LOG_FUNCTION_ENTRY();
+
+	IBLEnvironment environment = DecodeHDRImage(source);
+
+	// Prefiltered environment map, roughness going from 0 to 1 over the mips
+	int prefilteredSize = max(environment.cubemap.size / 2, 1);
+	environment.prefiltered = IBLBaker::BakePrefiltered(environment.cubemap, prefilteredSize,
+		IBLBaker::GetPrefilteredMipCount(prefilteredSize), bakeSettings.prefilteredSampleCount);
+	return PackEnvironment(environment, bakeSettings);
+}
+
+IBLEnvironment TextureManager::DecodeHDRImage(const MappedFile& source)
+{
+	int sourceSize = static_cast<int>(source.GetSize());
+    if (stbi_is_hdr_from_memory(source.GetData(), sourceSize) == 0)
     {
-        LOG_ERROR("File is not a valid HDR texture: ", filename);
-        throw std::runtime_error("File is not a valid HDR texture: " + filename);
+        LOG_ERROR("File is not a valid HDR texture");
+        throw std::runtime_error("File is not a valid HDR texture");
     }
 
     int width, height, channels;
-    float* data = stbi_loadf(filename.c_str(), &width, &height, &channels, 3); // loadf : float
+    float* data = stbi_loadf_from_memory(source.GetData(), sourceSize, &width, &height, &channels, 3); // loadf : float
     if (!data) 
     {
-        LOG_ERROR("Failed to load HDR texture: ", filename);
-        throw std::runtime_error("Failed to load HDR texture: " + filename);
+        LOG_ERROR("Failed to decode HDR texture: ", stbi_failure_reason());
+        throw std::runtime_error("Failed to decode HDR texture");
     }
 	
-    LOG_DEBUG("HDR texture loaded: ", filename, " (", width, "x", height, ", ", channels, " channels)");
-    UINT cubemapSize = max(width / 4, height / 2);
+    LOG_DEBUG("HDR texture decoded: ", width, "x", height, ", ", channels, " channels");
 	
+	IBLEnvironment environment;
+    environment.cubemap = IBLUtils::EquirectangularToCubemap(data, width, height);
+    stbi_image_free(data);
+
+	environment.irradianceSH = SphericalHarmonics::ConvolveCosineLobe(SphericalHarmonics::ProjectCubemap(environment.cubemap));
+	CubemapSampler::GenerateMips(environment.cubemap);
+	return environment;
+}
+
+IBLEnvironment TextureManager::LoadEnvironment(const string& filePath, const IBLBakeSettings& bakeSettings)
+{
+	MappedFile source;
+	if (!source.Open(filePath))
+	{
+		throw std::runtime_error("Failed to load HDR texture: " + filePath);
+	}
+
+	uint64_t key = IBLCache::ComputeKey(source.GetData(), source.GetSize(), bakeSettings);
+	filesystem::path cachePath(filePath);
+	cachePath.replace_extension(".libl");
+
+	IBLCache cache;
+	if (cache.Open(cachePath.string(), key))
+	{
+		const IBLCacheHeader& header = cache.GetHeader();
+		IBLEnvironment environment;
+		environment.cubemap = UnpackCubemap(cache.GetCubemapData(), static_cast<int>(header.cubemapSize), 1);
+		environment.prefiltered = UnpackCubemap(cache.GetPrefilteredData(), static_cast<int>(header.prefilteredSize), static_cast<int>(header.prefilteredMipCount));
+		environment.irradianceSH = header.irradianceSH;
+		return environment;
+	}
+
+	IBLEnvironment environment = DecodeHDRImage(source);
+	environment.cachePath = cachePath.string();
+	environment.cacheKey = key;
+	return environment;
+}
+
+IBLCacheData TextureManager::PackEnvironment(const IBLEnvironment& environment, const IBLBakeSettings& bakeSettings)
+{
+	IBLCacheData baked;
+	baked.cubemapSize = static_cast<uint32_t>(environment.cubemap.size);
+	baked.prefilteredSize = static_cast<uint32_t>(environment.prefiltered.size);
+	baked.prefilteredMipCount = static_cast<uint32_t>(environment.prefiltered.mipCount);
+	baked.irradianceSH = environment.irradianceSH;
+	PackCubemap(environment.cubemap, 1, baked.cubemap);
+	PackCubemap(environment.prefiltered, environment.prefiltered.mipCount, baked.prefiltered);
+
+	// BRDF LUT
+	baked.brdfLutSize = static_cast<uint32_t>(bakeSettings.brdfLutSize);
+	vector<XMFLOAT2> brdfLut = IBLBaker::BakeBRDFLut(bakeSettings.brdfLutSize, bakeSettings.brdfLutSampleCount);
+	baked.brdfLut.resize(brdfLut.size() * 2);
+	for (size_t i = 0; i < brdfLut.size(); ++i)
+	{
+		baked.brdfLut[i * 2 + 0] = PackedVector::XMConvertFloatToHalf(brdfLut[i].x);
+		baked.brdfLut[i * 2 + 1] = PackedVector::XMConvertFloatToHalf(brdfLut[i].y);
+	}
+	return baked;
+}
+
+void TextureManager::CreateIBLTextures(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator,
+	const IBLCacheHeader& layout, const uint16_t* cubemapData, const uint16_t* prefilteredData, const uint16_t* brdfLutData)
+{
+	LOG_FUNCTION_ENTRY();
+
+	m_environmentTransition.SetCurrentIrradiance(layout.irradianceSH);
+
 	D3D12_RESOURCE_DESC textureDesc = {};
 	textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
 	textureDesc.MipLevels = 1;
@@ -632,180 +709,216 @@ void TextureManager::LoadHDRImage(const LunarConstants::TextureInfo& textureInfo
 	textureDesc.SampleDesc.Quality = 0;
 	textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
 	textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
-    textureDesc.Width = cubemapSize;
-    textureDesc.Height = cubemapSize;
+    textureDesc.Width = layout.cubemapSize;
+    textureDesc.Height = layout.cubemapSize;
     textureDesc.DepthOrArraySize = 6;
     textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	
-    vector<vector<float>> faceData = EquirectangularToCubemap(data, width, height);
-    
-    vector<vector<uint16_t>> faceDataRGBA16(6);
-    for (int face = 0; face < 6; ++face) {
-        faceDataRGBA16[face].resize(cubemapSize * cubemapSize * 4); 
-        for (size_t i = 0; i < cubemapSize * cubemapSize; ++i) {
-            // Convert RGB float to RGBA16F
-            faceDataRGBA16[face][i * 4 + 0] = PackedVector::XMConvertFloatToHalf(faceData[face][i * 3 + 0]); // R
-            faceDataRGBA16[face][i * 4 + 1] = PackedVector::XMConvertFloatToHalf(faceData[face][i * 3 + 1]); // G
-            faceDataRGBA16[face][i * 4 + 2] = PackedVector::XMConvertFloatToHalf(faceData[face][i * 3 + 2]); // B
-            faceDataRGBA16[face][i * 4 + 3] = PackedVector::XMConvertFloatToHalf(1.0f); // A
-        }
-    }
-    
-    UINT64 rowSizeInBytes = static_cast<UINT64>(cubemapSize) * 4 /*RGBA*/ * sizeof(uint16_t) /*16-bit per channel*/;
-    
-    vector<uint8_t*> faceDataBytes(6);
-    for (int face = 0; face < 6; ++face) {
-        faceDataBytes[face] = reinterpret_cast<uint8_t*>(faceDataRGBA16[face].data());
-    }
+
+	// pointers to each tightly packed subresource of an RGBA16F cubemap, in subresource order
+	auto getSubresources = [](const uint16_t* data, UINT size, UINT mipLevels)
+	{
+		vector<const uint8_t*> subresources;
+		for (UINT face = 0; face < 6; ++face)
+		{
+			for (UINT mip = 0; mip < mipLevels; ++mip)
+			{
+				UINT mipSize = max(size >> mip, 1u);
+				subresources.push_back(reinterpret_cast<const uint8_t*>(data));
+				data += static_cast<size_t>(mipSize) * mipSize * 4;
+			}
+		}
+		return subresources;
+	};
 
 	Texture texture = {};
-	texture.Resource = CreateCubemapResource(device, commandList, textureDesc, faceDataBytes, rowSizeInBytes, texture.UploadBuffer);
-    
-    stbi_image_free(data);
-	
+	texture.Resource = CreateCubemapResource(device, commandList, textureDesc, getSubresources(cubemapData, layout.cubemapSize, 1), texture.UploadBuffer);
 	m_textureMap[textureInfo.name] = make_unique<Texture>(texture);
 	CreateShaderResourceView(textureInfo, descriptorAllocator);
 
-	UINT irradianceMapSize = cubemapSize / 2;
-	Texture irradianceTexture = {};
-	irradianceTexture.Resource = CreateEmptyMapResource(device, irradianceMapSize, 6, DXGI_FORMAT_R16G16B16A16_FLOAT);
-
-	LunarConstants::TextureInfo irradianceTextureInfo = textureInfo;
-	irradianceTextureInfo.name = "skybox_irradiance";
-	m_textureMap[irradianceTextureInfo.name] = make_unique<Texture>(irradianceTexture);
-	CreateShaderResourceView(irradianceTextureInfo, descriptorAllocator);
-
-	D3D12_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
-	uavDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
-	uavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2DARRAY;
-	uavDesc.Texture2DArray.MipSlice = 0;
-	uavDesc.Texture2DArray.FirstArraySlice = 0;
-	uavDesc.Texture2DArray.ArraySize = 6;
-	descriptorAllocator->AllocateDescriptor("skybox_irradiance_uav");
-	descriptorAllocator->CreateUAV(irradianceTexture.Resource.Get(), &uavDesc, "skybox_irradiance_uav");
-
-	D3D12_RESOURCE_BARRIER barrier = {};
-	barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
-	barrier.Transition.pResource = texture.Resource.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	commandList->ResourceBarrier(1, &barrier);
-
-	barrier.Transition.pResource = irradianceTexture.Resource.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	commandList->ResourceBarrier(1, &barrier);
-	
-	ID3D12DescriptorHeap* descriptorHeaps[] = { descriptorAllocator->GetHeap() };
-	commandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-
-	commandList->SetComputeRootSignature(pipelineStateManager->GetComputeRootSignature());
-	commandList->SetComputeRootDescriptorTable(LunarConstants::COMPUTE_INPUT_SRV_INDEX, descriptorAllocator->GetGPUHandle(textureInfo.name));
-	commandList->SetComputeRootDescriptorTable(LunarConstants::COMPUTE_OUTPUT_UAV_INDEX, descriptorAllocator->GetGPUHandle("skybox_irradiance_uav"));
-	commandList->SetPipelineState(pipelineStateManager->GetPSO("irradiance"));
-	commandList->Dispatch((irradianceMapSize + 7) / 8, (irradianceMapSize + 7) / 8, 6);
-
-	barrier.Transition.pResource = irradianceTexture.Resource.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-	commandList->ResourceBarrier(1, &barrier);
-	
-	// Generate Prefiltered Environment Map
-	UINT prefilteredMapSize = cubemapSize / 2; 
-	UINT maxMipLevels = static_cast<UINT>(std::floor(std::log2(prefilteredMapSize))) + 1;
-	
+	D3D12_RESOURCE_DESC prefilteredDesc = textureDesc;
+	prefilteredDesc.Width = layout.prefilteredSize;
+	prefilteredDesc.Height = layout.prefilteredSize;
+	prefilteredDesc.MipLevels = static_cast<UINT16>(layout.prefilteredMipCount);
+
 	Texture prefilteredTexture = {};
-	prefilteredTexture.Resource = CreateEmptyMapResource(device, prefilteredMapSize, 6, DXGI_FORMAT_R16G16B16A16_FLOAT, maxMipLevels);
+	prefilteredTexture.Resource = CreateCubemapResource(device, commandList, prefilteredDesc,
+		getSubresources(prefilteredData, layout.prefilteredSize, layout.prefilteredMipCount), prefilteredTexture.UploadBuffer);
 	
 	LunarConstants::TextureInfo prefilteredTextureInfo = textureInfo;
 	prefilteredTextureInfo.name = "skybox_prefiltered";
 	m_textureMap[prefilteredTextureInfo.name] = make_unique<Texture>(prefilteredTexture);
-	CreateShaderResourceView(prefilteredTextureInfo, descriptorAllocator, maxMipLevels);
-	
-	// commandList->SetComputeRootSignature(pipelineStateManager->GetComputeRootSignature());
-	for (UINT mip = 0; mip < maxMipLevels; ++mip)
-	{
-		barrier.Transition.Subresource = mip;
-		barrier.Transition.pResource = prefilteredTexture.Resource.Get();
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-		commandList->ResourceBarrier(1, &barrier);
-		
-		UINT mipSize = prefilteredMapSize >> mip;
-		if (mipSize == 0) mipSize = 1;
-		
-		float roughness = static_cast<float>(mip) / static_cast<float>(maxMipLevels - 1);
-		
-		UINT constants[4] = {
-			*reinterpret_cast<UINT*>(&roughness), // float as uint32
-			mip,                                   // mip level
-			0,                                     // padding
-			0                                      // padding
-		};
-		
-		uavDesc.Texture2DArray.MipSlice = mip;
-		
-		string uavName = "skybox_prefiltered_uav_mip" + to_string(mip);
-		descriptorAllocator->AllocateDescriptor(uavName);
-		descriptorAllocator->CreateUAV(prefilteredTexture.Resource.Get(), &uavDesc, uavName);
-		
-		commandList->SetComputeRoot32BitConstants(LunarConstants::COMPUTE_CONSTANTS_INDEX, 4, constants, 0);
-		// commandList->SetComputeRootDescriptorTable(LunarConstants::COMPUTE_INPUT_SRV_INDEX, descriptorAllocator->GetGPUHandle(textureInfo.name));
-		commandList->SetComputeRootDescriptorTable(LunarConstants::COMPUTE_OUTPUT_UAV_INDEX, descriptorAllocator->GetGPUHandle(uavName));
-		commandList->SetPipelineState(pipelineStateManager->GetPSO("prefiltered"));
-		
-		commandList->Dispatch((mipSize + 7) / 8, (mipSize + 7) / 8, 6);
-
-		barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-		barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-		commandList->ResourceBarrier(1, &barrier);
-	}
-
-	// restore cubemap state
-	barrier.Transition.pResource = texture.Resource.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	commandList->ResourceBarrier(1, &barrier);
+	CreateShaderResourceView(prefilteredTextureInfo, descriptorAllocator, layout.prefilteredMipCount);
 
-	// BRDF LUT
-	const UINT brdfLutSize = 512;
+	D3D12_RESOURCE_DESC brdfLutDesc = textureDesc;
+	brdfLutDesc.Width = layout.brdfLutSize;
+	brdfLutDesc.Height = layout.brdfLutSize;
+	brdfLutDesc.DepthOrArraySize = 1;
+	brdfLutDesc.Format = DXGI_FORMAT_R16G16_FLOAT;
 	
 	Texture brdfLutTexture = {};
 	LunarConstants::TextureInfo brdfLutTextureInfo = textureInfo;
 	string brdfLutName = string(textureInfo.name) + "_brdf_lut";
 	brdfLutTextureInfo.dimensionType = LunarConstants::TextureDimension::TEXTURE2D;
 	brdfLutTextureInfo.name = brdfLutName.c_str();
-	brdfLutTexture.Resource = CreateEmptyMapResource(device, brdfLutSize, 1, DXGI_FORMAT_R16G16_FLOAT);
+	brdfLutTexture.Resource = CreateTextureResource(device, commandList, brdfLutDesc, reinterpret_cast<const uint8_t*>(brdfLutData),
+		static_cast<UINT64>(layout.brdfLutSize) * 2 * sizeof(uint16_t), brdfLutTexture.UploadBuffer);
 	m_textureMap[brdfLutTextureInfo.name] = make_unique<Texture>(brdfLutTexture);
 	CreateShaderResourceView(brdfLutTextureInfo, descriptorAllocator);
-	
-	D3D12_UNORDERED_ACCESS_VIEW_DESC brdfLutUavDesc = {};
-	brdfLutUavDesc.Format = DXGI_FORMAT_R16G16_FLOAT;
-	brdfLutUavDesc.ViewDimension = D3D12_UAV_DIMENSION_TEXTURE2D;
-	brdfLutUavDesc.Texture2D.MipSlice = 0;
-	brdfLutUavDesc.Texture2D.PlaneSlice = 0;
-
-	descriptorAllocator->AllocateDescriptor("brdf_lut_uav");
-	descriptorAllocator->CreateUAV(brdfLutTexture.Resource.Get(), &brdfLutUavDesc, "brdf_lut_uav");
-
-	barrier.Transition.pResource = brdfLutTexture.Resource.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	commandList->ResourceBarrier(1, &barrier);
-
-	commandList->SetComputeRootSignature(pipelineStateManager->GetComputeRootSignature());
-	commandList->SetComputeRootDescriptorTable(LunarConstants::COMPUTE_OUTPUT_UAV_INDEX, descriptorAllocator->GetGPUHandle("brdf_lut_uav"));
-	commandList->SetPipelineState(pipelineStateManager->GetPSO("brdfLut"));
-	commandList->Dispatch((brdfLutSize + 7) / 8, (brdfLutSize + 7) / 8, 1);
-
-	barrier.Transition.pResource = brdfLutTexture.Resource.Get();
-	barrier.Transition.StateBefore = D3D12_RESOURCE_STATE_UNORDERED_ACCESS;
-	barrier.Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
-	barrier.Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
-	commandList->ResourceBarrier(1, &barrier);
+
+	// the slots an environment switch fades to follow the LUT; until the first switch they show the current maps
+	descriptorAllocator->AllocateDescriptor("skybox_next");
+	WriteShaderResourceView(textureInfo, textureInfo.name, "skybox_next", descriptorAllocator);
+	descriptorAllocator->AllocateDescriptor("skybox_prefiltered_next");
+	WriteShaderResourceView(prefilteredTextureInfo, prefilteredTextureInfo.name, "skybox_prefiltered_next", descriptorAllocator, layout.prefilteredMipCount);
+}
+
+void TextureManager::RequestEnvironment(const string& filePath)
+{
+	if (!m_environmentInfo)
+	{
+		LOG_WARNING("No HDR environment to switch from, ignoring: ", filePath);
+		return;
+	}
+
+	IBLBakeSettings bakeSettings;
+	bakeSettings.prefilteredSampleCount = m_environmentTransition.GetSettings().prefilteredSampleCount;
+	LOG_DEBUG("Environment requested: ", filePath);
+	m_environmentTransition.Begin([filePath, bakeSettings]() { return LoadEnvironment(filePath, bakeSettings); });
+}
+
+bool TextureManager::UpdateEnvironment(float deltaTime, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator)
+{
+	EnvironmentTransition::Frame frame = m_environmentTransition.Update(deltaTime);
+	if (frame.uploadCount > 0)
+	{
+		UploadIncomingEnvironment(frame, device, commandList, descriptorAllocator);
+	}
+
+	if (frame.completed)
+	{
+		// the previous frame has finished, so the replaced textures and the upload buffers can go
+		string name = m_environmentInfo->name;
+		m_textureMap[name] = move(m_textureMap["skybox_next"]);
+		m_textureMap["skybox_prefiltered"] = move(m_textureMap["skybox_prefiltered_next"]);
+		m_textureMap.erase("skybox_next");
+		m_textureMap.erase("skybox_prefiltered_next");
+		m_textureMap[name]->UploadBuffer.Reset();
+		m_textureMap["skybox_prefiltered"]->UploadBuffer.Reset();
+
+		LunarConstants::TextureInfo prefilteredTextureInfo = *m_environmentInfo;
+		prefilteredTextureInfo.name = "skybox_prefiltered";
+		WriteShaderResourceView(*m_environmentInfo, name, name, descriptorAllocator);
+		WriteShaderResourceView(prefilteredTextureInfo, prefilteredTextureInfo.name, prefilteredTextureInfo.name, descriptorAllocator,
+			m_textureMap["skybox_prefiltered"]->Resource->GetDesc().MipLevels);
+
+		IBLEnvironment completed = m_environmentTransition.TakeCompleted();
+		if (completed.baked && !completed.cachePath.empty())
+		{
+			IBLBakeSettings bakeSettings;
+			bakeSettings.prefilteredSampleCount = m_environmentTransition.GetSettings().prefilteredSampleCount;
+			shared_ptr<IBLEnvironment> environment = make_shared<IBLEnvironment>(move(completed));
+			ThreadPool::GetInstance().Submit([environment, bakeSettings]()
+			{
+				// a failed write only costs the next switch another bake
+				IBLCache::Write(environment->cachePath, environment->cacheKey, PackEnvironment(*environment, bakeSettings));
+			});
+		}
+		LOG_DEBUG("Environment switched");
+	}
+
+	bool changed = frame.completed || frame.blend != m_environmentBlend;
+	m_environmentBlend = frame.blend;
+	return changed;
+}
+
+void TextureManager::UploadIncomingEnvironment(const EnvironmentTransition::Frame& frame, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator)
+{
+	const IBLEnvironment& incoming = m_environmentTransition.GetIncoming();
+	if (frame.firstUpload == 0)
+	{
+		D3D12_RESOURCE_DESC textureDesc = {};
+		textureDesc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+		textureDesc.MipLevels = 1;
+		textureDesc.SampleDesc.Count = 1;
+		textureDesc.SampleDesc.Quality = 0;
+		textureDesc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+		textureDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+		textureDesc.Width = incoming.cubemap.size;
+		textureDesc.Height = incoming.cubemap.size;
+		textureDesc.DepthOrArraySize = 6;
+		textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		Texture texture = {};
+		texture.Resource = CreateCopyDestTexture(device, textureDesc, texture.UploadBuffer);
+		m_textureMap["skybox_next"] = make_unique<Texture>(texture);
+
+		D3D12_RESOURCE_DESC prefilteredDesc = textureDesc;
+		prefilteredDesc.Width = incoming.prefiltered.size;
+		prefilteredDesc.Height = incoming.prefiltered.size;
+		prefilteredDesc.MipLevels = static_cast<UINT16>(incoming.prefiltered.mipCount);
+
+		Texture prefilteredTexture = {};
+		prefilteredTexture.Resource = CreateCopyDestTexture(device, prefilteredDesc, prefilteredTexture.UploadBuffer);
+		m_textureMap["skybox_prefiltered_next"] = make_unique<Texture>(prefilteredTexture);
+	}
+
+	// cubemap faces first, then the prefiltered map, both in subresource order
+	for (uint32_t index = frame.firstUpload; index < frame.firstUpload + frame.uploadCount; ++index)
+	{
+		Texture* texture = m_textureMap[index < 6 ? "skybox_next" : "skybox_prefiltered_next"].get();
+		UINT subresource = index < 6 ? index : index - 6;
+		D3D12_RESOURCE_DESC textureDesc = texture->Resource->GetDesc();
+		UINT subresourceCount = textureDesc.DepthOrArraySize * textureDesc.MipLevels;
+		vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(subresourceCount);
+		vector<UINT> numRows(subresourceCount);
+		device->GetCopyableFootprints(&textureDesc, 0, subresourceCount, 0, layouts.data(), numRows.data(), nullptr, nullptr);
+
+		// earlier frames' copies read other regions of the upload buffer, so it can be written while they are in flight
+		int size;
+		const float* texels = m_environmentTransition.GetUploadTexels(index, size);
+		void* mappedData;
+		D3D12_RANGE readRange = { 0, 0 };
+		THROW_IF_FAILED(texture->UploadBuffer->Map(0, &readRange, &mappedData));
+		BYTE* destSliceStart = reinterpret_cast<BYTE*>(mappedData) + layouts[subresource].Offset;
+		for (UINT row = 0; row < numRows[subresource]; ++row)
+		{
+			PackedVector::XMConvertFloatToHalfStream(
+				reinterpret_cast<PackedVector::HALF*>(destSliceStart + layouts[subresource].Footprint.RowPitch * row), sizeof(PackedVector::HALF),
+				texels + static_cast<size_t>(row) * size * 4, sizeof(float), static_cast<size_t>(size) * 4);
+		}
+		texture->UploadBuffer->Unmap(0, nullptr);
+
+		D3D12_TEXTURE_COPY_LOCATION destLocation = {};
+		destLocation.pResource = texture->Resource.Get();
+		destLocation.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
+		destLocation.SubresourceIndex = subresource;
+
+		D3D12_TEXTURE_COPY_LOCATION srcLocation = {};
+		srcLocation.pResource = texture->UploadBuffer.Get();
+		srcLocation.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
+		srcLocation.PlacedFootprint = layouts[subresource];
+
+		commandList->CopyTextureRegion(&destLocation, 0, 0, 0, &srcLocation, nullptr);
+	}
+
+	if (frame.firstUpload + frame.uploadCount < m_environmentTransition.GetUploadCount()) return;
+
+	// everything is copied: make the incoming maps readable and point the _next slots at them
+	D3D12_RESOURCE_BARRIER barriers[2] = {};
+	const char* names[2] = { "skybox_next", "skybox_prefiltered_next" };
+	for (int i = 0; i < 2; ++i)
+	{
+		barriers[i].Type = D3D12_RESOURCE_BARRIER_TYPE_TRANSITION;
+		barriers[i].Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+		barriers[i].Transition.pResource = m_textureMap[names[i]]->Resource.Get();
+		barriers[i].Transition.StateBefore = D3D12_RESOURCE_STATE_COPY_DEST;
+		barriers[i].Transition.StateAfter = D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE;
+		barriers[i].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+	}
+	commandList->ResourceBarrier(2, barriers);
+
+	WriteShaderResourceView(*m_environmentInfo, "skybox_next", "skybox_next", descriptorAllocator);
+	WriteShaderResourceView(*m_environmentInfo, "skybox_prefiltered_next", "skybox_prefiltered_next", descriptorAllocator, incoming.prefiltered.mipCount);
 }
 
 } //namespace Lunar
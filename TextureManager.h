@@ -7,12 +7,14 @@
 #include <wrl/client.h>
 
 #include "LunarConstants.h"
+#include "Utils/EnvironmentTransition.h"
+#include "Utils/IBLCache.h"
+#include "Utils/SphericalHarmonics.h"
 
 namespace Lunar
 {
 
 class DescriptorAllocator;
-class PipelineStateManager;
 	
 struct Texture
 {
@@ -23,12 +25,29 @@ struct Texture
 class TextureManager
 {
 public:
-	void Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator, PipelineStateManager* pipelineStateManager);
+	void Initialize(ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator);
+	// Diffuse irradiance of the HDR environment, for the basic constants; crossfaded during a switch
+	SHCoefficients GetIrradianceSH() const { return m_environmentTransition.GetIrradianceSH(); }
+
+	// Switches the environment to another HDR file. It is loaded in the background, rebaked and uploaded
+	// a little every frame, then crossfaded in over the skybox_next and skybox_prefiltered_next slots.
+	void RequestEnvironment(const std::string& filePath);
+	// Advances a switch by one frame. Call after the previous frame has finished on the GPU, as it
+	// records uploads and may release the textures of the environment being replaced.
+	// Returns true when the irradiance or the blend changed.
+	bool UpdateEnvironment(float deltaTime, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator);
+	float GetEnvironmentBlend() const { return m_environmentBlend; }
+	EnvironmentTransitionSettings& GetEnvironmentTransitionSettings() { return m_environmentTransition.GetSettings(); }
 
 private:
 	std::unordered_map<std::string, std::unique_ptr<Texture>> m_textureMap;
+	const LunarConstants::TextureInfo* m_environmentInfo = nullptr;
+	EnvironmentTransition m_environmentTransition;
+	float m_environmentBlend = 0.0f;
 	
 	void CreateShaderResourceView(const LunarConstants::TextureInfo& textureInfo, DescriptorAllocator* descriptorAllocator, UINT mipLevels = 1);
+	// Writes the view of a texture into an allocated descriptor, which need not share its name
+	void WriteShaderResourceView(const LunarConstants::TextureInfo& textureInfo, const std::string& textureName, const std::string& descriptorName, DescriptorAllocator* descriptorAllocator, UINT mipLevels = 1);
 	
 	Microsoft::WRL::ComPtr<ID3D12Resource> LoadTexture(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, const std::string& filename, Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 	Microsoft::WRL::ComPtr<ID3D12Resource> CreateTextureResource(
@@ -38,19 +57,31 @@ private:
 		const uint8_t*                          srcData,
 		UINT64                                  rowSizeInBytes,
 		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
+	// Default heap texture in the copy destination state, with an upload buffer for all of its subresources
+	Microsoft::WRL::ComPtr<ID3D12Resource> CreateCopyDestTexture(
+		ID3D12Device*                           device,
+		const D3D12_RESOURCE_DESC&              textureDesc,
+		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 	Microsoft::WRL::ComPtr<ID3D12Resource> CreateCubemapResource(
 		ID3D12Device*                           device,
 		ID3D12GraphicsCommandList*              commandList,
 		const D3D12_RESOURCE_DESC&              textureDesc,
-		const std::vector<uint8_t*>&            faceData,
-		UINT64                                  rowSizeInBytes,
+		const std::vector<const uint8_t*>&      subresourceData,	// tightly packed rows, indexed mip + face * mipLevels
 		Microsoft::WRL::ComPtr<ID3D12Resource>& uploadBuffer);
 	
-	std::vector<std::vector<float>> EquirectangularToCubemap(float* imageData, UINT width, UINT height);
-
     Microsoft::WRL::ComPtr<ID3D12Resource> CreateEmptyMapResource(ID3D12Device* device, UINT mapSize, UINT depthOrArraySize, DXGI_FORMAT format, UINT mipLevels = 1);
 
-	void LoadHDRImage(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator, const PipelineStateManager* pipelineStateManager);
+	// Environment cubemap, prefiltered map and BRDF LUT, from the sibling .libl cache when it matches the HDR file
+	void LoadHDRImage(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator);
+	IBLCacheData BakeHDRImage(const MappedFile& source, const IBLBakeSettings& bakeSettings);
+	// Cubemap with its mip chain and the irradiance, leaving the prefiltered map to bake
+	static IBLEnvironment DecodeHDRImage(const MappedFile& source);
+	// Environment for a runtime switch, from the cache when it matches; runs on the thread pool
+	static IBLEnvironment LoadEnvironment(const std::string& filePath, const IBLBakeSettings& bakeSettings);
+	static IBLCacheData PackEnvironment(const IBLEnvironment& environment, const IBLBakeSettings& bakeSettings);
+	void CreateIBLTextures(const LunarConstants::TextureInfo& textureInfo, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator,
+		const IBLCacheHeader& layout, const uint16_t* cubemapData, const uint16_t* prefilteredData, const uint16_t* brdfLutData);
+	void UploadIncomingEnvironment(const EnvironmentTransition::Frame& frame, ID3D12Device* device, ID3D12GraphicsCommandList* commandList, DescriptorAllocator* descriptorAllocator);
 };
 	
 } // namespace Lunar
@@ -23,9 +23,9 @@ void LightViewModel::Initialize(LunarGui* gui, LightingSystem* lightingSystem, S
     m_lightingSystem = lightingSystem;
     m_sceneRenderer = sceneRenderer;
     
-    auto* dirLight = m_lightingSystem->GetLight("SunLight");
-    auto* pointLight = m_lightingSystem->GetLight("RoomLight");
-    auto* spotLight = m_lightingSystem->GetLight("FlashLight");
+    auto dirLight = m_lightingSystem->GetLight("SunLight");
+    auto pointLight = m_lightingSystem->GetLight("RoomLight");
+    auto spotLight = m_lightingSystem->GetLight("FlashLight");
     
     if (dirLight) 
     {
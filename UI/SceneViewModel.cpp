@@ -2,7 +2,10 @@
 #include "LunarGUI.h"
 #include "../Utils/Logger.h"
 #include "../SceneRenderer.h"
+#include "../Geometry/Geometry.h"
 #include <DirectXMath.h>
+#include <algorithm>
+#include <cstdio>
 
 using namespace std;
 using namespace DirectX;
@@ -10,6 +13,9 @@ using namespace DirectX;
 namespace Lunar
 {
 
+SceneViewModel::SceneViewModel() = default;
+SceneViewModel::~SceneViewModel() = default;
+
 void SceneViewModel::Initialize(LunarGui* gui, SceneRenderer* sceneRenderer)
 {
 	if (!gui || !sceneRenderer)
@@ -20,9 +26,45 @@ void SceneViewModel::Initialize(LunarGui* gui, SceneRenderer* sceneRenderer)
 	gui->BindCheckbox("Scene Settings Enabled", &m_showSceneWindow, nullptr, "main");
 
 	gui->BindCheckbox("Render Wire Frame", &sceneRenderer->m_wireFrameRender, nullptr, "scene");
+
+	m_vertexBufferTableData = make_unique<TableData>();
+	m_vertexBufferTableData->headers = {"Geometry", "Format", "Vertices", "VB (KB)", "Default (KB)"};
+	m_vertexBufferTableData->flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg;
+	m_vertexBufferTableData->updateCallback = [this, sceneRenderer]() {
+		m_vertexBufferTableData->rows.clear();
+
+		auto toKilobytes = [](size_t byteSize) {
+			char text[32];
+			snprintf(text, sizeof(text), "%.1f", byteSize / 1024.0);
+			return string(text);
+		};
+		size_t totalByteSize = 0;
+		size_t totalDefaultByteSize = 0;
+		for (const auto& [name, entry] : sceneRenderer->m_geometriesByName)
+		{
+			const Geometry* geometry = entry->GeometryData.get();
+			VertexFormat vertexFormat = geometry->GetVertexFormat();
+			size_t vertexCount = geometry->GetVertexBufferByteSize() / VertexFormatUtils::GetStride(vertexFormat);
+			size_t defaultByteSize = vertexCount * sizeof(Vertex);
+			totalByteSize += geometry->GetVertexBufferByteSize();
+			totalDefaultByteSize += defaultByteSize;
+
+			m_vertexBufferTableData->rows.push_back({
+				name,
+				VertexFormatUtils::GetInputLayoutName(vertexFormat),
+				to_string(vertexCount),
+				toKilobytes(geometry->GetVertexBufferByteSize()),
+				toKilobytes(defaultByteSize)
+			});
+		}
+		sort(m_vertexBufferTableData->rows.begin(), m_vertexBufferTableData->rows.end());
+		m_vertexBufferTableData->rows.push_back({"Total", "", "", toKilobytes(totalByteSize), toKilobytes(totalDefaultByteSize)});
+	};
+	gui->BindTable("Vertex Buffer Table", m_vertexBufferTableData.get());
 	
 	vector<string> elementIds = {
-		"Render Wire Frame"
+		"Render Wire Frame",
+		"Vertex Buffer Table"
 	};
 
 	gui->BindWindow("Scene Settings", "Scene Settings", &m_showSceneWindow, elementIds);
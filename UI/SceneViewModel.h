@@ -1,5 +1,6 @@
 #pragma once
 #include <DirectXMath.h>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -9,12 +10,13 @@ class LunarGui;
 class SceneRenderer;
 class MaterialManager;
 class LightingSystem;
+struct TableData;
 
 class SceneViewModel
 {
 public:
-    SceneViewModel() = default;
-    ~SceneViewModel() = default;
+    SceneViewModel();
+    ~SceneViewModel();
 
     void Initialize(LunarGui* gui, SceneRenderer* sceneRenderer);
 
@@ -28,5 +30,6 @@ private:
     int                      m_selectedLightIndex = 0;
     std::vector<int>         m_lights;
 	bool                     m_showSceneWindow = true;
+	std::unique_ptr<TableData> m_vertexBufferTableData;	// per-mesh vertex buffer sizes against the default layout
 };
 } // namespace Lunar
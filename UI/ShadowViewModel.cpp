@@ -6,10 +6,9 @@ namespace Lunar
 {
 void ShadowViewModel::Initialize(LunarGui* gui, ShadowManager* shadowManager)
 {
-	// gui->BindSlider("SceneRadius", &shadowManager->m_sceneRadius, 0.0f, 30.0f);
-	// gui->BindSlider("x", &shadowManager->m_posX, -1.0f, 1.0f);
-	// gui->BindSlider("y", &shadowManager->m_posY, -1.0f, 1.0f);
-	// gui->BindSlider("z", &shadowManager->m_posZ, -1.0f, 1.0f);
+	gui->BindSlider("Cascade Count", &shadowManager->m_cascadeCount, 1, static_cast<int>(LunarConstants::MAX_SHADOW_CASCADES));
+	gui->BindSlider("Cascade Split Lambda", &shadowManager->m_splitLambda, 0.0f, 1.0f);
+	gui->BindSlider("Shadow Distance", &shadowManager->m_shadowDistance, 10.0f, LunarConstants::FAR_PLANE);
 }
 } // namespace Lunar
  
\ No newline at end of file
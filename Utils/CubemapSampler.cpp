@@ -0,0 +1,224 @@
+#include "CubemapSampler.h"
+
+#include <cmath>
+
+#include "IBLUtils.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+XMVECTOR LoadTexel(const CubemapImage& image, int mip, int face, int x, int y)
+{
+	int size = image.GetMipSize(mip);
+	if (x < 0 || y < 0 || x >= size || y >= size)
+	{
+		// the texel center lies past the edge, look it up on the face the direction lands on
+		const CubemapFaceBasis& basis = IBLUtils::GetCubemapFaceBasis(face);
+		float u = (x + 0.5f) * 2.0f / size - 1.0f;
+		float v = (y + 0.5f) * 2.0f / size - 1.0f;
+		XMFLOAT3 direction(
+			basis.axis.x + u * basis.uAxis.x + v * basis.vAxis.x,
+			basis.axis.y + u * basis.uAxis.y + v * basis.vAxis.y,
+			basis.axis.z + u * basis.uAxis.z + v * basis.vAxis.z);
+		float neighbourU;
+		float neighbourV;
+		CubemapSampler::MapDirection(direction, face, neighbourU, neighbourV);
+		x = clamp(static_cast<int>(neighbourU * size), 0, size - 1);
+		y = clamp(static_cast<int>(neighbourV * size), 0, size - 1);
+	}
+	return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(image.GetFace(mip, face) + (static_cast<size_t>(y) * size + x) * 4));
+}
+
+XMVECTOR SampleLod(const CubemapImage& image, int face, float u, float v, float lod)
+{
+	lod = clamp(lod, 0.0f, static_cast<float>(image.mipCount - 1));
+	int mip = static_cast<int>(lod);
+	XMVECTOR color = CubemapSampler::SampleBilinear(image, mip, face, u, v);
+	float blend = lod - mip;
+	if (blend == 0.0f) return color;
+	return XMVectorLerp(color, CubemapSampler::SampleBilinear(image, mip + 1, face, u, v), blend);
+}
+} // namespace
+
+void CubemapImage::Allocate(int faceSize, int mips)
+{
+	size = faceSize;
+	mipCount = mips;
+	mipOffsets.resize(mips);
+	size_t floatCount = 0;
+	for (int mip = 0; mip < mips; ++mip)
+	{
+		mipOffsets[mip] = floatCount;
+		floatCount += static_cast<size_t>(6) * GetMipSize(mip) * GetMipSize(mip) * 4;
+	}
+	texels.assign(floatCount, 0.0f);
+}
+
+float* CubemapImage::GetFace(int mip, int face)
+{
+	return texels.data() + mipOffsets[mip] + static_cast<size_t>(face) * GetMipSize(mip) * GetMipSize(mip) * 4;
+}
+
+const float* CubemapImage::GetFace(int mip, int face) const
+{
+	return texels.data() + mipOffsets[mip] + static_cast<size_t>(face) * GetMipSize(mip) * GetMipSize(mip) * 4;
+}
+
+void CubemapSampler::MapDirection(const XMFLOAT3& direction, int& face, float& u, float& v)
+{
+	float absX = fabsf(direction.x);
+	float absY = fabsf(direction.y);
+	float absZ = fabsf(direction.z);
+	float uNumerator;
+	float vNumerator;
+	float major;
+	if (absX >= absY && absX >= absZ)
+	{
+		face = direction.x < 0.0f ? 1 : 0;
+		uNumerator = direction.x < 0.0f ? direction.z : -direction.z;
+		vNumerator = -direction.y;
+		major = absX;
+	}
+	else if (absY >= absZ)
+	{
+		face = direction.y < 0.0f ? 3 : 2;
+		uNumerator = direction.x;
+		vNumerator = direction.y < 0.0f ? -direction.z : direction.z;
+		major = absY;
+	}
+	else
+	{
+		face = direction.z < 0.0f ? 5 : 4;
+		uNumerator = direction.z < 0.0f ? -direction.x : direction.x;
+		vNumerator = -direction.y;
+		major = absZ;
+	}
+	float scale = 0.5f / major;
+	u = uNumerator * scale + 0.5f;
+	v = vNumerator * scale + 0.5f;
+}
+
+void CubemapSampler::MapDirections(const float* x, const float* y, const float* z, Coordinates& outCoordinates)
+{
+	// the scalar branches above as selects, four lanes at a time
+	const XMVECTOR half = XMVectorReplicate(0.5f);
+	for (int first = 0; first < BATCH_SIZE; first += 4)
+	{
+		XMVECTOR dx = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(x + first));
+		XMVECTOR dy = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(y + first));
+		XMVECTOR dz = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(z + first));
+		XMVECTOR absX = XMVectorAbs(dx);
+		XMVECTOR absY = XMVectorAbs(dy);
+		XMVECTOR absZ = XMVectorAbs(dz);
+
+		XMVECTOR isX = XMVectorAndInt(XMVectorGreaterOrEqual(absX, absY), XMVectorGreaterOrEqual(absX, absZ));
+		XMVECTOR isY = XMVectorAndCInt(XMVectorGreaterOrEqual(absY, absZ), isX);
+		XMVECTOR major = XMVectorSelect(XMVectorSelect(dz, dy, isY), dx, isX);
+		XMVECTOR negative = XMVectorLess(major, XMVectorZero());
+
+		XMVECTOR uX = XMVectorSelect(XMVectorNegate(dz), dz, negative);
+		XMVECTOR uZ = XMVectorSelect(dx, XMVectorNegate(dx), negative);
+		XMVECTOR uNumerator = XMVectorSelect(XMVectorSelect(uZ, dx, isY), uX, isX);
+		XMVECTOR vY = XMVectorSelect(dz, XMVectorNegate(dz), negative);
+		XMVECTOR vNumerator = XMVectorSelect(XMVectorNegate(dy), vY, isY);
+
+		XMVECTOR scale = XMVectorDivide(half, XMVectorAbs(major));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(outCoordinates.u + first), XMVectorMultiplyAdd(uNumerator, scale, half));
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(outCoordinates.v + first), XMVectorMultiplyAdd(vNumerator, scale, half));
+
+		XMVECTOR face = XMVectorSelect(XMVectorSelect(XMVectorReplicate(4.0f), XMVectorReplicate(2.0f), isY), XMVectorZero(), isX);
+		face = XMVectorAdd(face, XMVectorSelect(XMVectorZero(), XMVectorReplicate(1.0f), negative));
+		XMFLOAT4 faces;
+		XMStoreFloat4(&faces, face);
+		outCoordinates.face[first + 0] = static_cast<int>(faces.x);
+		outCoordinates.face[first + 1] = static_cast<int>(faces.y);
+		outCoordinates.face[first + 2] = static_cast<int>(faces.z);
+		outCoordinates.face[first + 3] = static_cast<int>(faces.w);
+	}
+}
+
+XMVECTOR CubemapSampler::SampleBilinear(const CubemapImage& image, int mip, int face, float u, float v)
+{
+	int size = image.GetMipSize(mip);
+	float x = u * size - 0.5f;
+	float y = v * size - 0.5f;
+	float x0 = floorf(x);
+	float y0 = floorf(y);
+	int left = static_cast<int>(x0);
+	int top = static_cast<int>(y0);
+
+	XMVECTOR upper = XMVectorLerp(LoadTexel(image, mip, face, left, top), LoadTexel(image, mip, face, left + 1, top), x - x0);
+	XMVECTOR lower = XMVectorLerp(LoadTexel(image, mip, face, left, top + 1), LoadTexel(image, mip, face, left + 1, top + 1), x - x0);
+	return XMVectorLerp(upper, lower, y - y0);
+}
+
+XMVECTOR CubemapSampler::Sample(const CubemapImage& image, FXMVECTOR direction, float lod)
+{
+	XMFLOAT3 d;
+	XMStoreFloat3(&d, direction);
+	int face;
+	float u;
+	float v;
+	MapDirection(d, face, u, v);
+	return SampleLod(image, face, u, v, lod);
+}
+
+void CubemapSampler::Sample(const CubemapImage& image, const float* x, const float* y, const float* z, const float* lod, XMVECTOR* outColors)
+{
+	Coordinates coordinates;
+	MapDirections(x, y, z, coordinates);
+	for (int lane = 0; lane < BATCH_SIZE; ++lane)
+	{
+		outColors[lane] = SampleLod(image, coordinates.face[lane], coordinates.u[lane], coordinates.v[lane], lod[lane]);
+	}
+}
+
+float CubemapSampler::ComputeLod(const CubemapImage& image, float solidAngle)
+{
+	float texelSolidAngle = 4.0f * XM_PI / (6.0f * image.size * image.size);
+	return clamp(0.5f * log2f(solidAngle / texelSolidAngle), 0.0f, static_cast<float>(image.mipCount - 1));
+}
+
+void CubemapSampler::GenerateMips(CubemapImage& image)
+{
+	int mipCount = 1;
+	while ((image.size >> mipCount) > 0) ++mipCount;
+
+	// mip 0 comes first, so growing the allocation keeps it in place
+	image.mipCount = mipCount;
+	image.mipOffsets.resize(mipCount);
+	size_t floatCount = 0;
+	for (int mip = 0; mip < mipCount; ++mip)
+	{
+		image.mipOffsets[mip] = floatCount;
+		floatCount += static_cast<size_t>(6) * image.GetMipSize(mip) * image.GetMipSize(mip) * 4;
+	}
+	image.texels.resize(floatCount);
+
+	for (int mip = 1; mip < mipCount; ++mip)
+	{
+		int mipSize = image.GetMipSize(mip);
+		int parentSize = image.GetMipSize(mip - 1);
+		for (int face = 0; face < 6; ++face)
+		{
+			const float* parent = image.GetFace(mip - 1, face);
+			float* texels = image.GetFace(mip, face);
+			for (int y = 0; y < mipSize; ++y)
+			{
+				for (int x = 0; x < mipSize; ++x)
+				{
+					const float* topLeft = parent + ((y * 2) * parentSize + x * 2) * 4;
+					XMVECTOR sum = XMVectorAdd(
+						XMVectorAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(topLeft)), XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(topLeft + 4))),
+						XMVectorAdd(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(topLeft + parentSize * 4)), XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(topLeft + parentSize * 4 + 4))));
+					XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(texels + (y * mipSize + x) * 4), XMVectorScale(sum, 0.25f));
+				}
+			}
+		}
+	}
+}
+} // namespace Lunar
@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <DirectXMath.h>
+#include <vector>
+
+namespace Lunar
+{
+// RGBA float cubemap and its mip chain in one allocation.
+// Mips go from largest to smallest, each holding the six faces back to back in +X, -X, +Y, -Y, +Z, -Z order.
+struct CubemapImage
+{
+	int size = 0;		// edge length of mip 0
+	int mipCount = 0;
+	std::vector<float>  texels;
+	std::vector<size_t> mipOffsets;	// in floats
+
+	void Allocate(int faceSize, int mips);
+	int GetMipSize(int mip) const { return std::max(size >> mip, 1); }
+	float* GetFace(int mip, int face);
+	const float* GetFace(int mip, int face) const;
+};
+
+// CPU cubemap sampling shared by the IBL bakers, with the face layout of IBLUtils::GetCubemapDirection.
+// Filtering is bilinear within a mip and linear between mips. Taps past a face edge are fetched from
+// the neighbouring face, so there are no seams at any mip.
+class CubemapSampler
+{
+public:
+	static constexpr int BATCH_SIZE = 8;
+
+	// Face and position on it, u and v in [0, 1] from the top left corner
+	struct Coordinates
+	{
+		int   face[BATCH_SIZE];
+		float u[BATCH_SIZE];
+		float v[BATCH_SIZE];
+	};
+
+	// Directions need not be normalized; ties between axes go to x, then y, as on the GPU
+	static void MapDirection(const DirectX::XMFLOAT3& direction, int& face, float& u, float& v);
+	static void MapDirections(const float* x, const float* y, const float* z, Coordinates& outCoordinates);
+
+	static DirectX::XMVECTOR SampleBilinear(const CubemapImage& image, int mip, int face, float u, float v);
+	static DirectX::XMVECTOR Sample(const CubemapImage& image, DirectX::FXMVECTOR direction, float lod);
+	// BATCH_SIZE directions and levels of detail at once
+	static void Sample(const CubemapImage& image, const float* x, const float* y, const float* z, const float* lod, DirectX::XMVECTOR* outColors);
+
+	// Level whose texels cover the given solid angle, clamped to the mip chain
+	static float ComputeLod(const CubemapImage& image, float solidAngle);
+
+	// Extends the image to a full box-filtered chain down to 1x1, keeping mip 0
+	static void GenerateMips(CubemapImage& image);
+};
+} // namespace Lunar
@@ -0,0 +1,208 @@
+#include "EnvironmentTransition.h"
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "Logger.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+struct EnvironmentTransition::PendingLoad
+{
+	std::mutex     mutex;
+	bool           done = false;
+	bool           failed = false;
+	IBLEnvironment result;
+};
+
+void EnvironmentTransition::Begin(function<IBLEnvironment()> load)
+{
+	if (m_state == State::Idle)
+	{
+		StartLoad(move(load));
+		return;
+	}
+	m_queuedLoad = move(load);
+}
+
+void EnvironmentTransition::StartLoad(function<IBLEnvironment()> load)
+{
+	shared_ptr<PendingLoad> pendingLoad = make_shared<PendingLoad>();
+	m_pendingLoad = pendingLoad;
+	m_state = State::Loading;
+	function<void()> task = [pendingLoad, load = move(load)]()
+	{
+		IBLEnvironment environment;
+		bool failed = false;
+		try
+		{
+			environment = load();
+		}
+		catch (const exception& e)
+		{
+			LOG_ERROR("Failed to load environment: ", e.what());
+			failed = true;
+		}
+
+		lock_guard<mutex> lock(pendingLoad->mutex);
+		pendingLoad->result = move(environment);
+		pendingLoad->failed = failed;
+		pendingLoad->done = true;
+	};
+
+	// Submit runs the task inline without workers, which would stall this frame for the whole load
+	if (ThreadPool::GetInstance().GetThreadCount() > 1)
+	{
+		ThreadPool::GetInstance().Submit(move(task));
+	}
+	else
+	{
+		thread(move(task)).detach();
+	}
+}
+
+EnvironmentTransition::Frame EnvironmentTransition::Update(float deltaTime)
+{
+	Frame frame;
+	switch (m_state)
+	{
+	case State::Idle:
+		if (m_queuedLoad)
+		{
+			StartLoad(move(m_queuedLoad));
+			m_queuedLoad = nullptr;
+		}
+		break;
+
+	case State::Loading:
+	{
+		{
+			lock_guard<mutex> lock(m_pendingLoad->mutex);
+			if (!m_pendingLoad->done) break;
+		}
+		shared_ptr<PendingLoad> pendingLoad = move(m_pendingLoad);
+		if (pendingLoad->failed)
+		{
+			m_state = State::Idle;
+			break;
+		}
+
+		m_incoming = move(pendingLoad->result);
+		m_nextUpload = 0;
+		m_state = State::Uploading;
+		if (m_incoming.prefiltered.mipCount == 0)
+		{
+			// the job reads the incoming cubemap in place, which stays put until the transition completes
+			int size = max(m_incoming.cubemap.size / 2, 1);
+			m_prefilterJob = make_unique<IBLPrefilterJob>(m_incoming.cubemap, size, IBLBaker::GetPrefilteredMipCount(size), m_settings.prefilteredSampleCount);
+			m_state = State::Prefiltering;
+		}
+		break;
+	}
+
+	case State::Prefiltering:
+	{
+		bool baked = m_prefilterJob->Run(m_settings.bakeSamplesPerFrame);
+		frame.bakeSampleCount = m_prefilterJob->GetLastRunSampleCount();
+		if (baked)
+		{
+			m_incoming.prefiltered = move(m_prefilterJob->GetResult());
+			m_incoming.baked = true;
+			m_prefilterJob.reset();
+			m_state = State::Uploading;
+		}
+		break;
+	}
+
+	case State::Uploading:
+	{
+		// whole subresources, at least one a frame
+		uint64_t uploadTexels = 0;
+		frame.firstUpload = m_nextUpload;
+		while (m_nextUpload < GetUploadCount())
+		{
+			int size;
+			GetUploadTexels(m_nextUpload, size);
+			uint64_t texels = static_cast<uint64_t>(size) * size;
+			if (uploadTexels > 0 && uploadTexels + texels > m_settings.uploadTexelsPerFrame) break;
+			uploadTexels += texels;
+			++m_nextUpload;
+		}
+		frame.uploadCount = m_nextUpload - frame.firstUpload;
+		if (m_nextUpload == GetUploadCount())
+		{
+			m_elapsed = 0.0f;
+			m_state = State::Crossfading;
+		}
+		break;
+	}
+
+	case State::Crossfading:
+	{
+		m_elapsed += deltaTime;
+		float t = m_settings.crossfadeDuration > 0.0f ? min(m_elapsed / m_settings.crossfadeDuration, 1.0f) : 1.0f;
+		m_blend = t * t * (3.0f - 2.0f * t);
+		if (t >= 1.0f)
+		{
+			m_currentSH = m_incoming.irradianceSH;
+			m_completed = move(m_incoming);
+			m_incoming = IBLEnvironment();
+			m_blend = 0.0f;
+			frame.completed = true;
+			m_state = State::Idle;
+		}
+		break;
+	}
+	}
+
+	frame.state = m_state;
+	frame.blend = m_blend;
+	return frame;
+}
+
+float EnvironmentTransition::GetBakeProgress() const
+{
+	if (m_prefilterJob) return m_prefilterJob->GetProgress();
+	return m_state == State::Uploading || m_state == State::Crossfading ? 1.0f : 0.0f;
+}
+
+SHCoefficients EnvironmentTransition::GetIrradianceSH() const
+{
+	if (m_blend == 0.0f) return m_currentSH;
+
+	// irradiance is linear in the coefficients, so this is the crossfade of the two irradiance fields
+	SHCoefficients irradianceSH;
+	for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+	{
+		XMStoreFloat3(&irradianceSH.coefficients[i], XMVectorLerp(
+			XMLoadFloat3(&m_currentSH.coefficients[i]), XMLoadFloat3(&m_incoming.irradianceSH.coefficients[i]), m_blend));
+	}
+	return irradianceSH;
+}
+
+uint32_t EnvironmentTransition::GetUploadCount() const
+{
+	return 6 + 6 * static_cast<uint32_t>(m_incoming.prefiltered.mipCount);
+}
+
+const float* EnvironmentTransition::GetUploadTexels(uint32_t index, int& outSize) const
+{
+	if (index < 6)
+	{
+		outSize = m_incoming.cubemap.size;
+		return m_incoming.cubemap.GetFace(0, static_cast<int>(index));
+	}
+
+	int mipCount = m_incoming.prefiltered.mipCount;
+	int face = static_cast<int>(index - 6) / mipCount;
+	int mip = static_cast<int>(index - 6) % mipCount;
+	outSize = m_incoming.prefiltered.GetMipSize(mip);
+	return m_incoming.prefiltered.GetFace(mip, face);
+}
+} // namespace Lunar
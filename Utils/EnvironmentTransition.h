@@ -0,0 +1,95 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "IBLBaker.h"
+#include "SphericalHarmonics.h"
+
+namespace Lunar
+{
+// Image-based lighting of one environment on the CPU, as the loader hands it over
+struct IBLEnvironment
+{
+	CubemapImage   cubemap;			// mip 0 is shown; the whole chain feeds the prefilter bake
+	CubemapImage   prefiltered;		// left empty by the loader to have it baked over the next frames
+	SHCoefficients irradianceSH = {};
+	std::string    cachePath;		// where the loader would like a freshly baked result cached, may be empty
+	uint64_t       cacheKey = 0;
+	bool           baked = false;	// prefiltered was baked by the transition rather than loaded
+};
+
+struct EnvironmentTransitionSettings
+{
+	uint64_t bakeSamplesPerFrame = 32768;	// environment samples of the prefilter rebake per frame, see IBLPrefilterJob::Run
+	uint64_t uploadTexelsPerFrame = 262144;	// texels converted into upload memory per frame, at least one face
+	float    crossfadeDuration = 2.0f;		// seconds
+	int      prefilteredSampleCount = IBLBakeSettings().prefilteredSampleCount;
+};
+
+// Switches the environment lighting at runtime without a frame hitch.
+// The new environment is loaded on the thread pool, its prefiltered map rebaked a budgeted number of samples
+// per frame, uploaded a budgeted number of texels per frame and then crossfaded in. Nothing here touches
+// D3D: Update says what the frame has to do and the renderer does it.
+class EnvironmentTransition
+{
+public:
+	enum class State
+	{
+		Idle,
+		Loading,
+		Prefiltering,
+		Uploading,
+		Crossfading
+	};
+
+	struct Frame
+	{
+		State    state = State::Idle;
+		uint32_t firstUpload = 0;	// incoming subresources to copy this frame, see GetUploadTexels
+		uint32_t uploadCount = 0;
+		uint64_t bakeSampleCount = 0;	// environment samples the prefilter rebake took this frame
+		bool     completed = false;	// the incoming environment replaces the current one this frame
+		float    blend = 0.0f;		// weight of the incoming environment, 0 from the frame it completes
+	};
+
+	EnvironmentTransitionSettings& GetSettings() { return m_settings; }
+	void SetCurrentIrradiance(const SHCoefficients& irradianceSH) { m_currentSH = irradianceSH; }
+
+	// load runs on the thread pool, or on a thread of its own when the pool has no workers, and may throw.
+	// A request made during a transition waits for it to complete, replacing any request already waiting.
+	void Begin(std::function<IBLEnvironment()> load);
+	Frame Update(float deltaTime);
+
+	State GetState() const { return m_state; }
+	float GetBakeProgress() const;
+	// Current irradiance crossfaded with the incoming one by the last blend
+	SHCoefficients GetIrradianceSH() const;
+
+	// The incoming environment, valid from Uploading until it completes
+	const IBLEnvironment& GetIncoming() const { return m_incoming; }
+	// Cubemap faces, then the prefiltered map in D3D12 subresource order (mip + face * mipCount), RGBA float
+	uint32_t GetUploadCount() const;
+	const float* GetUploadTexels(uint32_t index, int& outSize) const;
+	// Hands over the environment that completed in the last Update, for caching
+	IBLEnvironment TakeCompleted() { return std::move(m_completed); }
+
+private:
+	struct PendingLoad;
+
+	void StartLoad(std::function<IBLEnvironment()> load);
+
+	EnvironmentTransitionSettings    m_settings;
+	State                            m_state = State::Idle;
+	std::function<IBLEnvironment()>  m_queuedLoad;
+	std::shared_ptr<PendingLoad>     m_pendingLoad;
+	std::unique_ptr<IBLPrefilterJob> m_prefilterJob;
+	IBLEnvironment                   m_incoming;
+	IBLEnvironment                   m_completed;
+	SHCoefficients                   m_currentSH = {};
+	uint32_t                         m_nextUpload = 0;
+	float                            m_elapsed = 0.0f;
+	float                            m_blend = 0.0f;
+};
+} // namespace Lunar
@@ -0,0 +1,358 @@
+#include "IBLBaker.h"
+
+#include <cmath>
+
+#include "IBLUtils.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+// Tangent-space samples shared by every texel of a bake, y being the normal axis.
+// Kept as arrays padded to whole sampler batches, the padding having zero weight.
+struct LobeSamples
+{
+	vector<float> x;
+	vector<float> y;
+	vector<float> z;
+	vector<float> weight;
+	vector<float> lod;
+	float totalWeight = 0.0f;
+
+	void Add(const XMFLOAT3& direction, float sampleWeight, float sampleLod)
+	{
+		x.push_back(direction.x);
+		y.push_back(direction.y);
+		z.push_back(direction.z);
+		weight.push_back(sampleWeight);
+		lod.push_back(sampleLod);
+		totalWeight += sampleWeight;
+	}
+
+	void Pad()
+	{
+		while (weight.size() % CubemapSampler::BATCH_SIZE != 0)
+		{
+			Add(XMFLOAT3(0.0f, 1.0f, 0.0f), 0.0f, 0.0f);
+		}
+	}
+};
+
+namespace
+{
+float RadicalInverse(uint32_t bits)
+{
+	bits = (bits << 16u) | (bits >> 16u);
+	bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+	bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+	bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+	bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+	return static_cast<float>(bits) * 2.3283064365386963e-10f;
+}
+
+XMFLOAT3 ImportanceSampleGGX(const XMFLOAT2& xi, float alpha)
+{
+	float phi = 2.0f * XM_PI * xi.x;
+	float cosTheta = sqrtf((1.0f - xi.y) / (1.0f + (alpha * alpha - 1.0f) * xi.y));
+	float sinTheta = sqrtf(1.0f - cosTheta * cosTheta);
+	return XMFLOAT3(sinTheta * cosf(phi), cosTheta, sinTheta * sinf(phi));
+}
+
+float DistributionGGX(float NdotH, float alpha)
+{
+	float alpha2 = alpha * alpha;
+	float denominator = NdotH * NdotH * (alpha2 - 1.0f) + 1.0f;
+	return alpha2 / (XM_PI * denominator * denominator);
+}
+
+// Mip whose texel solid angle matches the sample's share of the sphere, biased one level up (GPU Gems 3, chapter 20)
+float ComputeSampleLod(const CubemapImage& environment, float pdf, int sampleCount)
+{
+	float sampleSolidAngle = 1.0f / (static_cast<float>(sampleCount) * pdf + 1e-6f);
+	return CubemapSampler::ComputeLod(environment, sampleSolidAngle * 4.0f);
+}
+
+// Frame the tangent-space lobe samples are rotated into; the up vector switches near the poles so the cross
+// product stays well conditioned
+void GetTangentSpace(FXMVECTOR normal, XMVECTOR& tangent, XMVECTOR& bitangent)
+{
+	XMVECTOR up = fabsf(XMVectorGetY(normal)) < 0.999f ? XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f) : XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f);
+	tangent = XMVector3Normalize(XMVector3Cross(up, normal));
+	bitangent = XMVector3Cross(normal, tangent);
+}
+
+int GetTilesPerRow(int size)
+{
+	return (size + IBLBaker::TILE_SIZE - 1) / IBLBaker::TILE_SIZE;
+}
+
+// Runs bakeTexel(direction) for tile rows [firstRow, firstRow + rowCount) of one mip, spread over the thread pool.
+// Tiles are numbered face by face, row by row, and each has TILE_SIZE rows, empty past the face edge.
+template <typename BakeTexel>
+void BakeTileRows(CubemapImage& output, int mip, int firstRow, int rowCount, const BakeTexel& bakeTexel)
+{
+	int size = output.GetMipSize(mip);
+	int tilesPerRow = GetTilesPerRow(size);
+	int tilesPerFace = tilesPerRow * tilesPerRow;
+	ThreadPool::GetInstance().ParallelFor(rowCount, 1, [&](size_t begin, size_t end)
+	{
+		for (int row = firstRow + static_cast<int>(begin); row < firstRow + static_cast<int>(end); ++row)
+		{
+			int tile = row / IBLBaker::TILE_SIZE;
+			int face = tile / tilesPerFace;
+			int tileX = tile % tilesPerFace % tilesPerRow * IBLBaker::TILE_SIZE;
+			int y = tile % tilesPerFace / tilesPerRow * IBLBaker::TILE_SIZE + row % IBLBaker::TILE_SIZE;
+			if (y >= size) continue;
+
+			float* texels = output.GetFace(mip, face);
+			for (int x = tileX; x < min(tileX + IBLBaker::TILE_SIZE, size); ++x)
+			{
+				float u = (x + 0.5f) * 2.0f / size - 1.0f;
+				float v = (y + 0.5f) * 2.0f / size - 1.0f;
+				XMVECTOR color = bakeTexel(IBLUtils::GetCubemapDirection(face, u, v));
+				XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(texels + (y * size + x) * 4), XMVectorSetW(color, 1.0f));
+			}
+		}
+	});
+}
+
+template <typename BakeTexel>
+void BakeFaces(CubemapImage& output, int mip, const BakeTexel& bakeTexel)
+{
+	int tilesPerRow = GetTilesPerRow(output.GetMipSize(mip));
+	BakeTileRows(output, mip, 0, 6 * tilesPerRow * tilesPerRow * IBLBaker::TILE_SIZE, bakeTexel);
+}
+
+// Weighted sum of the environment over a lobe rotated onto the normal, one sampler batch at a time
+XMVECTOR IntegrateLobe(const CubemapImage& environment, FXMVECTOR normal, const LobeSamples& samples)
+{
+	XMVECTOR tangentVector;
+	XMVECTOR bitangentVector;
+	GetTangentSpace(normal, tangentVector, bitangentVector);
+	XMFLOAT3 tangent;
+	XMFLOAT3 bitangent;
+	XMFLOAT3 up;
+	XMStoreFloat3(&tangent, tangentVector);
+	XMStoreFloat3(&bitangent, bitangentVector);
+	XMStoreFloat3(&up, normal);
+
+	float x[CubemapSampler::BATCH_SIZE];
+	float y[CubemapSampler::BATCH_SIZE];
+	float z[CubemapSampler::BATCH_SIZE];
+	XMVECTOR colors[CubemapSampler::BATCH_SIZE];
+	XMVECTOR color = XMVectorZero();
+	for (size_t first = 0; first < samples.weight.size(); first += CubemapSampler::BATCH_SIZE)
+	{
+		for (int lane = 0; lane < CubemapSampler::BATCH_SIZE; ++lane)
+		{
+			size_t i = first + lane;
+			x[lane] = tangent.x * samples.x[i] + up.x * samples.y[i] + bitangent.x * samples.z[i];
+			y[lane] = tangent.y * samples.x[i] + up.y * samples.y[i] + bitangent.y * samples.z[i];
+			z[lane] = tangent.z * samples.x[i] + up.z * samples.y[i] + bitangent.z * samples.z[i];
+		}
+		CubemapSampler::Sample(environment, x, y, z, &samples.lod[first], colors);
+		for (int lane = 0; lane < CubemapSampler::BATCH_SIZE; ++lane)
+		{
+			color = XMVectorMultiplyAdd(colors[lane], XMVectorReplicate(samples.weight[first + lane]), color);
+		}
+	}
+	return XMVectorScale(color, 1.0f / samples.totalWeight);
+}
+} // namespace
+
+XMFLOAT2 IBLBaker::Hammersley(uint32_t index, uint32_t count)
+{
+	return XMFLOAT2(static_cast<float>(index) / static_cast<float>(count), RadicalInverse(index));
+}
+
+CubemapImage IBLBaker::BakeIrradiance(const CubemapImage& environment, int size, int sampleCount)
+{
+	LOG_FUNCTION_ENTRY();
+
+	// cosine-weighted samples have pdf cos / pi, so the estimate is pi times their average
+	LobeSamples samples;
+	for (int i = 0; i < sampleCount; ++i)
+	{
+		XMFLOAT2 xi = Hammersley(i, sampleCount);
+		float cosTheta = sqrtf(xi.y);
+		float sinTheta = sqrtf(1.0f - xi.y);
+		float phi = 2.0f * XM_PI * xi.x;
+		samples.Add(XMFLOAT3(sinTheta * cosf(phi), cosTheta, sinTheta * sinf(phi)), 1.0f, ComputeSampleLod(environment, cosTheta / XM_PI, sampleCount));
+	}
+	samples.Pad();
+
+	CubemapImage irradiance;
+	irradiance.Allocate(size, 1);
+	BakeFaces(irradiance, 0, [&](FXMVECTOR normal)
+	{
+		return XMVectorScale(IntegrateLobe(environment, normal, samples), XM_PI);
+	});
+
+	LOG_FUNCTION_EXIT();
+	return irradiance;
+}
+
+CubemapImage IBLBaker::BakePrefiltered(const CubemapImage& environment, int size, int mipCount, int sampleCount)
+{
+	LOG_FUNCTION_ENTRY();
+
+	IBLPrefilterJob job(environment, size, mipCount, sampleCount);
+	job.Run(UINT64_MAX);
+
+	LOG_FUNCTION_EXIT();
+	return move(job.GetResult());
+}
+
+int IBLBaker::GetPrefilteredMipCount(int size)
+{
+	int mipCount = 1;
+	while ((size >> mipCount) > 0) ++mipCount;
+	return mipCount;
+}
+
+IBLPrefilterJob::IBLPrefilterJob(const CubemapImage& environment, int size, int mipCount, int sampleCount)
+	: m_environment(&environment), m_sampleCount(sampleCount), m_samples(make_unique<LobeSamples>())
+{
+	m_result.Allocate(size, mipCount);
+	for (int mip = 0; mip < mipCount; ++mip)
+	{
+		m_texelCount += static_cast<uint64_t>(6) * m_result.GetMipSize(mip) * m_result.GetMipSize(mip);
+	}
+	BeginMip();
+}
+
+IBLPrefilterJob::~IBLPrefilterJob() = default;
+
+void IBLPrefilterJob::BeginMip()
+{
+	*m_samples = LobeSamples();
+	float roughness = m_result.mipCount > 1 ? static_cast<float>(m_mip) / static_cast<float>(m_result.mipCount - 1) : 0.0f;
+	if (roughness == 0.0f)
+	{
+		// a perfect mirror only reflects the texel it looks at, read from the environment mip of the same size
+		m_mirrorLod = log2f(static_cast<float>(m_environment->size) / static_cast<float>(m_result.GetMipSize(m_mip)));
+		return;
+	}
+
+	// With N = V = R the reflected samples are the same in tangent space for every texel,
+	// and the pdf of L reduces to D / 4
+	float alpha = roughness * roughness;
+	for (int i = 0; i < m_sampleCount; ++i)
+	{
+		XMFLOAT3 halfVector = ImportanceSampleGGX(IBLBaker::Hammersley(i, m_sampleCount), alpha);
+		float NdotH = halfVector.y;
+		XMFLOAT3 lightVector(2.0f * NdotH * halfVector.x, 2.0f * NdotH * NdotH - 1.0f, 2.0f * NdotH * halfVector.z);
+		if (lightVector.y <= 0.0f) continue;
+
+		m_samples->Add(lightVector, lightVector.y, ComputeSampleLod(*m_environment, DistributionGGX(NdotH, alpha) * 0.25f, m_sampleCount));
+	}
+	m_samples->Pad();
+}
+
+bool IBLPrefilterJob::Run(uint64_t sampleBudget)
+{
+	uint64_t samplesTaken = 0;
+	while (!IsFinished() && (samplesTaken == 0 || samplesTaken < sampleBudget))
+	{
+		int size = m_result.GetMipSize(m_mip);
+		int tilesPerRow = GetTilesPerRow(size);
+		int rowCount = 6 * tilesPerRow * tilesPerRow * IBLBaker::TILE_SIZE;
+
+		// a mirror texel is a single trilinear sample, a rough one the whole lobe
+		uint64_t rowSamples = static_cast<uint64_t>(min(size, IBLBaker::TILE_SIZE)) * max<size_t>(m_samples->weight.size(), 1);
+		uint64_t budgetRows = (sampleBudget - samplesTaken) / rowSamples;
+		if (budgetRows == 0)
+		{
+			// the next row does not fit; bake it anyway if nothing else was, so every call makes progress
+			if (samplesTaken > 0) break;
+			budgetRows = 1;
+		}
+		int count = static_cast<int>(min<uint64_t>(budgetRows, static_cast<uint64_t>(rowCount - m_row)));
+
+		if (m_samples->weight.empty())
+		{
+			BakeTileRows(m_result, m_mip, m_row, count, [&](FXMVECTOR direction) { return CubemapSampler::Sample(*m_environment, direction, m_mirrorLod); });
+		}
+		else
+		{
+			BakeTileRows(m_result, m_mip, m_row, count, [&](FXMVECTOR direction) { return IntegrateLobe(*m_environment, direction, *m_samples); });
+		}
+		m_row += count;
+		samplesTaken += count * rowSamples;
+
+		if (m_row == rowCount)
+		{
+			m_bakedTexels += static_cast<uint64_t>(6) * size * size;
+			m_row = 0;
+			++m_mip;
+			if (!IsFinished()) BeginMip();
+		}
+	}
+	m_lastRunSampleCount = samplesTaken;
+	return IsFinished();
+}
+
+float IBLPrefilterJob::GetProgress() const
+{
+	if (IsFinished()) return 1.0f;
+	int tilesPerRow = GetTilesPerRow(m_result.GetMipSize(m_mip));
+	float mipTexels = 6.0f * m_result.GetMipSize(m_mip) * m_result.GetMipSize(m_mip);
+	return (m_bakedTexels + mipTexels * m_row / (6.0f * tilesPerRow * tilesPerRow * IBLBaker::TILE_SIZE)) / m_texelCount;
+}
+
+vector<XMFLOAT2> IBLBaker::BakeBRDFLut(int size, int sampleCount)
+{
+	LOG_FUNCTION_ENTRY();
+
+	vector<XMFLOAT2> lut(static_cast<size_t>(size) * size);
+	ThreadPool::GetInstance().ParallelFor(size, 4, [&](size_t begin, size_t end)
+	{
+		// the half vectors only depend on the roughness, so one table serves a whole row
+		vector<XMFLOAT3> halfVectors(sampleCount);
+		for (size_t y = begin; y < end; ++y)
+		{
+			float roughness = (y + 0.5f) / size;
+			float alpha = roughness * roughness;
+			// Smith G with the image based lighting remap k = alpha / 2
+			float k = alpha * 0.5f;
+			for (int i = 0; i < sampleCount; ++i)
+			{
+				halfVectors[i] = ImportanceSampleGGX(Hammersley(i, sampleCount), alpha);
+			}
+
+			for (int x = 0; x < size; ++x)
+			{
+				float NdotV = (x + 0.5f) / size;
+				XMFLOAT3 viewVector(sqrtf(1.0f - NdotV * NdotV), NdotV, 0.0f);
+				float GV = NdotV / (NdotV * (1.0f - k) + k);
+
+				float scale = 0.0f;
+				float bias = 0.0f;
+				for (const XMFLOAT3& halfVector : halfVectors)
+				{
+					float VdotH = viewVector.x * halfVector.x + viewVector.y * halfVector.y;
+					float NdotL = 2.0f * VdotH * halfVector.y - viewVector.y;
+					if (NdotL <= 0.0f) continue;
+
+					float NdotH = halfVector.y;
+					VdotH = max(VdotH, 0.0f);
+					float GL = NdotL / (NdotL * (1.0f - k) + k);
+					float GVis = GV * GL * VdotH / (NdotH * NdotV);
+					float Fc = 1.0f - VdotH;
+					float Fc2 = Fc * Fc;
+					Fc = Fc2 * Fc2 * Fc;
+					scale += (1.0f - Fc) * GVis;
+					bias += Fc * GVis;
+				}
+				lut[y * size + x] = XMFLOAT2(scale / sampleCount, bias / sampleCount);
+			}
+		}
+	});
+
+	LOG_FUNCTION_EXIT();
+	return lut;
+}
+} // namespace Lunar
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <DirectXMath.h>
+#include <memory>
+#include <vector>
+
+#include "CubemapSampler.h"
+
+namespace Lunar
+{
+struct IBLBakeSettings
+{
+	int prefilteredSampleCount = 256;	// per texel, every mip but the mirror-like first
+	int brdfLutSize = 256;
+	int brdfLutSampleCount = 512;
+};
+
+// CPU baker for image-based lighting.
+// Samples come from the Hammersley sequence and are importance sampled, with each sample reading the
+// environment mip whose texels match the solid angle it stands for, so few samples are needed without
+// fireflies. Faces are cut into tiles spread over the thread pool. Every texel only depends on its own
+// inputs, so the output is bit for bit the same for any thread count.
+class IBLBaker
+{
+public:
+	static constexpr int TILE_SIZE = 16;
+
+	static DirectX::XMFLOAT2 Hammersley(uint32_t index, uint32_t count);
+
+	// The environment needs its full mip chain, see CubemapSampler::GenerateMips
+	static CubemapImage BakeIrradiance(const CubemapImage& environment, int size, int sampleCount);
+	// GGX prefiltered radiance, roughness going linearly from 0 at mip 0 to 1 at the last mip
+	static CubemapImage BakePrefiltered(const CubemapImage& environment, int size, int mipCount, int sampleCount);
+	// Split-sum scale and bias of F0, NdotV along x and roughness along y
+	static std::vector<DirectX::XMFLOAT2> BakeBRDFLut(int size, int sampleCount);
+
+	// Full chain down to 1x1
+	static int GetPrefilteredMipCount(int size);
+};
+
+struct LobeSamples;
+
+// BakePrefiltered cut into tile rows that can be baked a few at a time, to rebake while frames keep rendering.
+// Rows run mip by mip in a fixed order, so the result is bit for bit BakePrefiltered's however the work is split.
+class IBLPrefilterJob
+{
+public:
+	// The environment needs its full mip chain and has to outlive the job
+	IBLPrefilterJob(const CubemapImage& environment, int size, int mipCount, int sampleCount);
+	~IBLPrefilterJob();
+
+	// Bakes the whole tile rows that fit in sampleBudget environment samples, or a single row when even that
+	// does not fit; a mirror texel takes one sample, a rough texel the whole lobe. Returns true once every mip
+	// is baked.
+	bool Run(uint64_t sampleBudget);
+	bool IsFinished() const { return m_mip >= m_result.mipCount; }
+	float GetProgress() const;
+	uint64_t GetLastRunSampleCount() const { return m_lastRunSampleCount; }
+
+	CubemapImage& GetResult() { return m_result; }
+
+private:
+	void BeginMip();
+
+	const CubemapImage*          m_environment;
+	CubemapImage                 m_result;
+	int                          m_sampleCount;
+	int                          m_mip = 0;
+	int                          m_row = 0;			// next tile row of m_mip
+	uint64_t                     m_texelCount = 0;
+	uint64_t                     m_bakedTexels = 0;	// in finished mips
+	std::unique_ptr<LobeSamples> m_samples;			// of m_mip, empty for the mirror mip
+	float                        m_mirrorLod = 0.0f;
+	uint64_t                     m_lastRunSampleCount = 0;
+};
+} // namespace Lunar
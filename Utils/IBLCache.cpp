@@ -0,0 +1,162 @@
+#include "IBLCache.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "Logger.h"
+
+using namespace std;
+
+namespace Lunar
+{
+namespace
+{
+uint64_t AlignOffset(uint64_t offset)
+{
+	return (offset + IBLCache::SECTION_ALIGNMENT - 1) & ~(IBLCache::SECTION_ALIGNMENT - 1);
+}
+
+uint64_t MixWord(uint64_t hash, uint64_t word)
+{
+	hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+	return hash ^ (hash >> 29);
+}
+}
+
+uint64_t IBLCache::ComputeKey(const uint8_t* sourceData, size_t sourceSize, const IBLBakeSettings& settings)
+{
+	// eight bytes at a time; the tail is zero padded and the size is mixed in so padding cannot collide
+	uint64_t hash = MixWord(0, sourceSize);
+	size_t wordCount = sourceSize / sizeof(uint64_t);
+	for (size_t i = 0; i < wordCount; ++i)
+	{
+		uint64_t word;
+		memcpy(&word, sourceData + i * sizeof(uint64_t), sizeof(uint64_t));
+		hash = MixWord(hash, word);
+	}
+	uint64_t tail = 0;
+	memcpy(&tail, sourceData + wordCount * sizeof(uint64_t), sourceSize - wordCount * sizeof(uint64_t));
+	hash = MixWord(hash, tail);
+
+	hash = MixWord(hash, VERSION);
+	hash = MixWord(hash, static_cast<uint64_t>(settings.prefilteredSampleCount));
+	hash = MixWord(hash, static_cast<uint64_t>(settings.brdfLutSize));
+	hash = MixWord(hash, static_cast<uint64_t>(settings.brdfLutSampleCount));
+	return hash;
+}
+
+uint64_t IBLCache::GetCubemapByteSize(uint32_t size, uint32_t mipCount)
+{
+	uint64_t texelCount = 0;
+	for (uint32_t mip = 0; mip < mipCount; ++mip)
+	{
+		uint64_t mipSize = max(size >> mip, 1u);
+		texelCount += 6 * mipSize * mipSize;
+	}
+	return texelCount * 4 * sizeof(uint16_t);
+}
+
+IBLCacheHeader IBLCache::CreateHeader(uint64_t key, const IBLCacheData& data)
+{
+	IBLCacheHeader header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.key = key;
+	header.cubemapSize = data.cubemapSize;
+	header.prefilteredSize = data.prefilteredSize;
+	header.prefilteredMipCount = data.prefilteredMipCount;
+	header.brdfLutSize = data.brdfLutSize;
+	header.irradianceSH = data.irradianceSH;
+
+	header.cubemapOffset = AlignOffset(sizeof(IBLCacheHeader));
+	header.prefilteredOffset = AlignOffset(header.cubemapOffset + GetCubemapByteSize(header.cubemapSize, 1));
+	header.brdfLutOffset = AlignOffset(header.prefilteredOffset + GetCubemapByteSize(header.prefilteredSize, header.prefilteredMipCount));
+	header.fileSize = header.brdfLutOffset + static_cast<uint64_t>(header.brdfLutSize) * header.brdfLutSize * 2 * sizeof(uint16_t);
+	return header;
+}
+
+bool IBLCache::Write(const string& filePath, uint64_t key, const IBLCacheData& data)
+{
+	IBLCacheHeader header = CreateHeader(key, data);
+	if (data.cubemap.size() * sizeof(uint16_t) != GetCubemapByteSize(header.cubemapSize, 1) ||
+		data.prefiltered.size() * sizeof(uint16_t) != GetCubemapByteSize(header.prefilteredSize, header.prefilteredMipCount) ||
+		data.brdfLut.size() * sizeof(uint16_t) != header.fileSize - header.brdfLutOffset)
+	{
+		LOG_ERROR("IBL cache data does not match its sizes: ", filePath);
+		return false;
+	}
+
+	vector<uint8_t> bytes(header.fileSize, 0);
+	memcpy(bytes.data(), &header, sizeof(header));
+	memcpy(bytes.data() + header.cubemapOffset, data.cubemap.data(), data.cubemap.size() * sizeof(uint16_t));
+	memcpy(bytes.data() + header.prefilteredOffset, data.prefiltered.data(), data.prefiltered.size() * sizeof(uint16_t));
+	memcpy(bytes.data() + header.brdfLutOffset, data.brdfLut.data(), data.brdfLut.size() * sizeof(uint16_t));
+
+	ofstream file(filePath, ios::binary | ios::trunc);
+	if (!file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size()))
+	{
+		LOG_ERROR("Failed to write IBL cache: ", filePath);
+		return false;
+	}
+	LOG_DEBUG("IBL cache written: ", filePath, " (", header.fileSize, " bytes)");
+	return true;
+}
+
+bool IBLCache::Open(const string& filePath, uint64_t expectedKey)
+{
+	Close();
+
+	// a missing cache is the normal cold start, not an error
+	error_code error;
+	if (!filesystem::exists(filePath, error)) return false;
+	if (!m_file.Open(filePath)) return false;
+
+	const uint64_t fileSize = m_file.GetSize();
+	const IBLCacheHeader* header = reinterpret_cast<const IBLCacheHeader*>(m_file.GetData());
+	if (fileSize < sizeof(IBLCacheHeader) || header->magic != MAGIC || header->version != VERSION)
+	{
+		LOG_WARNING("Invalid or outdated IBL cache: ", filePath);
+		Close();
+		return false;
+	}
+	if (header->key != expectedKey)
+	{
+		LOG_DEBUG("IBL cache is stale: ", filePath);
+		Close();
+		return false;
+	}
+
+	// the stored offsets must be the ones this version lays out, which also bounds every section by the file size
+	bool valid = header->cubemapSize > 0 && header->prefilteredSize > 0 && header->brdfLutSize > 0 &&
+		header->prefilteredMipCount > 0 && header->prefilteredMipCount <= 32;
+	IBLCacheData sizes;
+	sizes.cubemapSize = header->cubemapSize;
+	sizes.prefilteredSize = header->prefilteredSize;
+	sizes.prefilteredMipCount = valid ? header->prefilteredMipCount : 1;
+	sizes.brdfLutSize = header->brdfLutSize;
+	IBLCacheHeader layout = CreateHeader(header->key, sizes);
+	valid = valid &&
+		header->cubemapOffset == layout.cubemapOffset &&
+		header->prefilteredOffset == layout.prefilteredOffset &&
+		header->brdfLutOffset == layout.brdfLutOffset &&
+		header->fileSize == layout.fileSize &&
+		header->fileSize == fileSize;
+	if (!valid)
+	{
+		LOG_WARNING("Invalid or outdated IBL cache: ", filePath);
+		Close();
+		return false;
+	}
+
+	m_header = header;
+	return true;
+}
+
+void IBLCache::Close()
+{
+	m_file.Close();
+	m_header = nullptr;
+}
+} // namespace Lunar
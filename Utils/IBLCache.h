@@ -0,0 +1,77 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "IBLBaker.h"
+#include "MappedFile.h"
+#include "SphericalHarmonics.h"
+
+namespace Lunar
+{
+// .libl layout: header, then the environment cubemap, the prefiltered cubemap and the BRDF LUT at 64-byte
+// aligned offsets. Texels are half floats in D3D12 subresource order (mip + face * mipCount), so loading
+// is a mapping plus one copy per subresource into upload memory.
+struct IBLCacheHeader
+{
+	uint32_t       magic;
+	uint32_t       version;
+	uint64_t       key;					// IBLCache::ComputeKey of the source image and bake settings
+	uint32_t       cubemapSize;
+	uint32_t       prefilteredSize;
+	uint32_t       prefilteredMipCount;
+	uint32_t       brdfLutSize;
+	SHCoefficients irradianceSH;
+	uint32_t       reserved;
+	uint64_t       cubemapOffset;		// RGBA16F, 6 faces
+	uint64_t       prefilteredOffset;	// RGBA16F, 6 faces x prefilteredMipCount
+	uint64_t       brdfLutOffset;		// RG16F
+	uint64_t       fileSize;
+};
+
+// Baked image-based lighting in the cache layout, handed to IBLCache::Write
+struct IBLCacheData
+{
+	uint32_t              cubemapSize = 0;
+	uint32_t              prefilteredSize = 0;
+	uint32_t              prefilteredMipCount = 0;
+	uint32_t              brdfLutSize = 0;
+	SHCoefficients        irradianceSH = {};
+	std::vector<uint16_t> cubemap;
+	std::vector<uint16_t> prefiltered;
+	std::vector<uint16_t> brdfLut;
+};
+
+class IBLCache
+{
+public:
+	static constexpr uint32_t MAGIC = 0x4C42494C;	// "LIBL"
+	static constexpr uint32_t VERSION = 2;			// bump whenever the baker output changes
+	static constexpr uint64_t SECTION_ALIGNMENT = 64;
+
+	// Hash of the source file bytes, the bake settings and VERSION
+	static uint64_t ComputeKey(const uint8_t* sourceData, size_t sourceSize, const IBLBakeSettings& settings);
+
+	// Header with the section layout for the given sizes; the sections are not checked against data
+	static IBLCacheHeader CreateHeader(uint64_t key, const IBLCacheData& data);
+	static uint64_t GetCubemapByteSize(uint32_t size, uint32_t mipCount);
+
+	static bool Write(const std::string& filePath, uint64_t key, const IBLCacheData& data);
+
+	// Maps the file and validates the header, key and section ranges. Texel pages are only read when
+	// the sections are copied, so a warm start touches nothing but the header up front.
+	bool Open(const std::string& filePath, uint64_t expectedKey);
+	void Close();
+
+	const IBLCacheHeader& GetHeader() const { return *m_header; }
+	const uint16_t*       GetCubemapData() const { return GetSection(m_header->cubemapOffset); }
+	const uint16_t*       GetPrefilteredData() const { return GetSection(m_header->prefilteredOffset); }
+	const uint16_t*       GetBRDFLutData() const { return GetSection(m_header->brdfLutOffset); }
+
+private:
+	const uint16_t* GetSection(uint64_t offset) const { return reinterpret_cast<const uint16_t*>(m_file.GetData() + offset); }
+
+	MappedFile            m_file;
+	const IBLCacheHeader* m_header = nullptr;
+};
+} // namespace Lunar
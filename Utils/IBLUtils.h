@@ -1,16 +1,27 @@
 #pragma once 
 #include <DirectXMath.h>
-#include <intsafe.h>
+#include <cstdint>
 #include <vector>
 
+#include "CubemapSampler.h"
+
 namespace Lunar
 {
+// A face direction is axis + u * uAxis + v * vAxis for u, v in [-1, 1], the layout of GetCubemapDirection
+struct CubemapFaceBasis
+{
+	DirectX::XMFLOAT3 axis;
+	DirectX::XMFLOAT3 uAxis;
+	DirectX::XMFLOAT3 vAxis;
+};
+
 class IBLUtils
 {
 public:
-static std::vector<std::vector<float>> GenerateIrradianceMap(const std::vector<std::vector<float>>& cubemapData, int cubemapSize, int irradianceMapSize, int channels = 3);
 static DirectX::XMVECTOR GetCubemapDirection(int faceIndex, float u, float v);
-static DirectX::XMVECTOR SampleCubemap(const std::vector<std::vector<float>>& cubemapData, UINT size, const DirectX::XMVECTOR& direction, int channels = 3);
-static DirectX::XMVECTOR SampleEquirectangular(const float* imageData, UINT width, UINT height, const DirectX::XMVECTOR& direction, int channels = 3);
+static const CubemapFaceBasis& GetCubemapFaceBasis(int faceIndex);
+static DirectX::XMVECTOR SampleEquirectangular(const float* imageData, uint32_t width, uint32_t height, const DirectX::XMVECTOR& direction, int channels = 3);
+// Single-mip cubemap with faces of max(width / 4, height / 2), filled in parallel
+static CubemapImage EquirectangularToCubemap(const float* imageData, uint32_t width, uint32_t height, int channels = 3);
 };
 } // namespace Lunar
\ No newline at end of file
@@ -0,0 +1,249 @@
+#include "JsonValue.h"
+
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace std;
+
+namespace Lunar
+{
+namespace
+{
+const JsonValue NULL_VALUE;
+
+constexpr int MAX_DEPTH = 256;
+}
+
+class JsonParser
+{
+public:
+	JsonParser(string_view text) : m_current(text.data()), m_end(text.data() + text.size()) {}
+
+	bool ParseDocument(JsonValue& value)
+	{
+		if (!ParseValue(value, 0)) return false;
+		SkipWhitespace();
+		return m_current == m_end || Fail("trailing characters");
+	}
+
+	const string& GetError() const { return m_error; }
+
+private:
+	bool Fail(const char* message)
+	{
+		if (m_error.empty()) m_error = message;
+		return false;
+	}
+
+	void SkipWhitespace()
+	{
+		while (m_current < m_end && (*m_current == ' ' || *m_current == '\t' || *m_current == '\n' || *m_current == '\r')) ++m_current;
+	}
+
+	bool Consume(string_view literal)
+	{
+		if (static_cast<size_t>(m_end - m_current) < literal.size() || string_view(m_current, literal.size()) != literal) return false;
+		m_current += literal.size();
+		return true;
+	}
+
+	bool ParseValue(JsonValue& value, int depth)
+	{
+		if (depth > MAX_DEPTH) return Fail("nesting too deep");
+		SkipWhitespace();
+		if (m_current >= m_end) return Fail("unexpected end of input");
+
+		switch (*m_current)
+		{
+			case '{':
+				return ParseObject(value, depth);
+			case '[':
+				return ParseArray(value, depth);
+			case '"':
+				value.m_type = JsonValue::Type::String;
+				return ParseString(value.m_string);
+			case 't':
+				value.m_type = JsonValue::Type::Bool;
+				value.m_bool = true;
+				return Consume("true") || Fail("invalid literal");
+			case 'f':
+				value.m_type = JsonValue::Type::Bool;
+				value.m_bool = false;
+				return Consume("false") || Fail("invalid literal");
+			case 'n':
+				value.m_type = JsonValue::Type::Null;
+				return Consume("null") || Fail("invalid literal");
+			default:
+				return ParseNumber(value);
+		}
+	}
+
+	bool ParseNumber(JsonValue& value)
+	{
+		// strtod needs a terminated string, so copy the number's characters first
+		const char* start = m_current;
+		while (m_current < m_end && (isdigit(static_cast<unsigned char>(*m_current)) || *m_current == '-' || *m_current == '+' ||
+			*m_current == '.' || *m_current == 'e' || *m_current == 'E')) ++m_current;
+		if (m_current == start) return Fail("unexpected character");
+
+		string number(start, m_current);
+		char* parsedEnd = nullptr;
+		value.m_type = JsonValue::Type::Number;
+		value.m_number = strtod(number.c_str(), &parsedEnd);
+		return parsedEnd == number.c_str() + number.size() || Fail("invalid number");
+	}
+
+	static void AppendUtf8(string& out, uint32_t codePoint)
+	{
+		if (codePoint < 0x80)
+		{
+			out += static_cast<char>(codePoint);
+		}
+		else if (codePoint < 0x800)
+		{
+			out += static_cast<char>(0xC0 | (codePoint >> 6));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else if (codePoint < 0x10000)
+		{
+			out += static_cast<char>(0xE0 | (codePoint >> 12));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+		else
+		{
+			out += static_cast<char>(0xF0 | (codePoint >> 18));
+			out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (codePoint & 0x3F));
+		}
+	}
+
+	bool ParseHex4(uint32_t& value)
+	{
+		if (m_end - m_current < 4) return Fail("truncated escape");
+		auto result = from_chars(m_current, m_current + 4, value, 16);
+		if (result.ptr != m_current + 4) return Fail("invalid escape");
+		m_current += 4;
+		return true;
+	}
+
+	bool ParseString(string& out)
+	{
+		++m_current;	// opening quote
+		while (m_current < m_end && *m_current != '"')
+		{
+			char c = *m_current++;
+			if (c != '\\')
+			{
+				out += c;
+				continue;
+			}
+			if (m_current >= m_end) break;
+
+			char escape = *m_current++;
+			switch (escape)
+			{
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					uint32_t codePoint;
+					if (!ParseHex4(codePoint)) return false;
+					if (codePoint >= 0xD800 && codePoint < 0xDC00 && Consume("\\u"))
+					{
+						uint32_t low;
+						if (!ParseHex4(low)) return false;
+						codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+					}
+					AppendUtf8(out, codePoint);
+					break;
+				}
+				default: out += escape; break;
+			}
+		}
+		if (m_current >= m_end) return Fail("unterminated string");
+		++m_current;	// closing quote
+		return true;
+	}
+
+	bool ParseArray(JsonValue& value, int depth)
+	{
+		value.m_type = JsonValue::Type::Array;
+		++m_current;
+		SkipWhitespace();
+		if (Consume("]")) return true;
+
+		while (true)
+		{
+			value.m_elements.emplace_back();
+			if (!ParseValue(value.m_elements.back(), depth + 1)) return false;
+			SkipWhitespace();
+			if (Consume("]")) return true;
+			if (!Consume(",")) return Fail("expected ',' or ']'");
+		}
+	}
+
+	bool ParseObject(JsonValue& value, int depth)
+	{
+		value.m_type = JsonValue::Type::Object;
+		++m_current;
+		SkipWhitespace();
+		if (Consume("}")) return true;
+
+		while (true)
+		{
+			SkipWhitespace();
+			if (m_current >= m_end || *m_current != '"') return Fail("expected key");
+			value.m_members.emplace_back();
+			if (!ParseString(value.m_members.back().first)) return false;
+			SkipWhitespace();
+			if (!Consume(":")) return Fail("expected ':'");
+			if (!ParseValue(value.m_members.back().second, depth + 1)) return false;
+			SkipWhitespace();
+			if (Consume("}")) return true;
+			if (!Consume(",")) return Fail("expected ',' or '}'");
+		}
+	}
+
+	const char* m_current;
+	const char* m_end;
+	string      m_error;
+};
+
+bool JsonValue::Parse(string_view text, JsonValue& outValue, string* outError)
+{
+	outValue = JsonValue();
+	JsonParser parser(text);
+	if (parser.ParseDocument(outValue)) return true;
+
+	if (outError) *outError = parser.GetError();
+	outValue = JsonValue();
+	return false;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	return m_type == Type::Array && index < m_elements.size() ? m_elements[index] : NULL_VALUE;
+}
+
+const JsonValue& JsonValue::operator[](int index) const
+{
+	return index < 0 ? NULL_VALUE : (*this)[static_cast<size_t>(index)];
+}
+
+const JsonValue& JsonValue::operator[](string_view key) const
+{
+	if (m_type != Type::Object) return NULL_VALUE;
+	for (const auto& [memberKey, memberValue] : m_members)
+	{
+		if (memberKey == key) return memberValue;
+	}
+	return NULL_VALUE;
+}
+} // namespace Lunar
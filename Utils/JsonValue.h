@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Lunar
+{
+// Minimal read-only JSON document for asset headers such as glTF; lookups on missing keys or
+// out-of-range indices return a shared null value, so chained accessors never throw
+class JsonValue
+{
+public:
+	enum class Type : uint8_t
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	static bool Parse(std::string_view text, JsonValue& outValue, std::string* outError = nullptr);
+
+	Type GetType() const { return m_type; }
+	bool IsNull() const { return m_type == Type::Null; }
+	bool IsNumber() const { return m_type == Type::Number; }
+	bool IsString() const { return m_type == Type::String; }
+	bool IsArray() const { return m_type == Type::Array; }
+	bool IsObject() const { return m_type == Type::Object; }
+
+	bool               AsBool(bool defaultValue = false) const { return m_type == Type::Bool ? m_bool : defaultValue; }
+	double             AsNumber(double defaultValue = 0.0) const { return m_type == Type::Number ? m_number : defaultValue; }
+	float              AsFloat(float defaultValue = 0.0f) const { return static_cast<float>(AsNumber(defaultValue)); }
+	int                AsInt(int defaultValue = 0) const { return static_cast<int>(AsNumber(defaultValue)); }
+	const std::string& AsString() const { return m_string; }
+
+	// Element count for arrays and member count for objects
+	size_t Size() const { return m_type == Type::Array ? m_elements.size() : m_members.size(); }
+	bool   Has(std::string_view key) const { return !(*this)[key].IsNull(); }
+
+	const JsonValue& operator[](size_t index) const;
+	const JsonValue& operator[](int index) const;	// negative indices give null, like any other miss
+	const JsonValue& operator[](std::string_view key) const;
+	const JsonValue& operator[](const char* key) const { return (*this)[std::string_view(key)]; }
+
+	const std::vector<JsonValue>&                          GetElements() const { return m_elements; }
+	const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return m_members; }
+
+private:
+	friend class JsonParser;
+
+	Type                                           m_type = Type::Null;
+	bool                                           m_bool = false;
+	double                                         m_number = 0.0;
+	std::string                                    m_string;
+	std::vector<JsonValue>                         m_elements;
+	std::vector<std::pair<std::string, JsonValue>> m_members;
+};
+} // namespace Lunar
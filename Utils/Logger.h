@@ -4,6 +4,7 @@
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <ctime>
 #include <iomanip>
 #include <sstream>
 
@@ -110,14 +111,24 @@ private:
 		}
 	}
 
+	static std::tm ToLocalTime(std::time_t time)
+	{
+		std::tm tm_buf;
+		#ifdef _WIN32
+		localtime_s(&tm_buf, &time);
+		#else
+		localtime_r(&time, &tm_buf);
+		#endif
+		return tm_buf;
+	}
+
 	std::string GetCurrentTimeForFilename()
 	{
 		auto now = std::chrono::system_clock::now();
 		auto time = std::chrono::system_clock::to_time_t(now);
 
 		std::stringstream ss;
-		std::tm           tm_buf;
-		auto              e = localtime_s(&tm_buf, &time);
+		std::tm           tm_buf = ToLocalTime(time);
 
 		ss << std::put_time(&tm_buf, "%Y%m%d_%H%M%S");
 		return ss.str();
@@ -133,8 +144,7 @@ private:
 		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
 
 		std::stringstream ss;
-		std::tm           tm_buf;
-		auto              e = localtime_s(&tm_buf, &time);
+		std::tm           tm_buf = ToLocalTime(time);
 
 		ss << std::put_time(&tm_buf, "%Y-%m-%d %H:%M:%S") << "."
 			<< std::setfill('0') << std::setw(3) << ms.count();
@@ -0,0 +1,101 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Logger.h"
+
+using namespace std;
+
+namespace Lunar
+{
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+bool MappedFile::Open(const string& filePath)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		LOG_ERROR("Failed to open file: ", filePath);
+		return false;
+	}
+	m_fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		LOG_ERROR("Empty or unreadable file: ", filePath);
+		Close();
+		return false;
+	}
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+
+	m_mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mappingHandle)
+	{
+		m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	}
+#else
+	m_fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (m_fileDescriptor < 0)
+	{
+		LOG_ERROR("Failed to open file: ", filePath);
+		return false;
+	}
+
+	struct stat fileStat;
+	if (fstat(m_fileDescriptor, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		LOG_ERROR("Empty or unreadable file: ", filePath);
+		Close();
+		return false;
+	}
+	m_size = static_cast<size_t>(fileStat.st_size);
+
+	void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	if (mapping != MAP_FAILED)
+	{
+		madvise(mapping, m_size, MADV_SEQUENTIAL);
+		m_data = static_cast<const uint8_t*>(mapping);
+	}
+#endif
+
+	if (!m_data)
+	{
+		LOG_ERROR("Failed to map file: ", filePath);
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::Close()
+{
+#ifdef _WIN32
+	if (m_data) UnmapViewOfFile(m_data);
+	if (m_mappingHandle) CloseHandle(m_mappingHandle);
+	if (m_fileHandle) CloseHandle(m_fileHandle);
+	m_mappingHandle = nullptr;
+	m_fileHandle = nullptr;
+#else
+	if (m_data) munmap(const_cast<uint8_t*>(m_data), m_size);
+	if (m_fileDescriptor >= 0) close(m_fileDescriptor);
+	m_fileDescriptor = -1;
+#endif
+	m_data = nullptr;
+	m_size = 0;
+}
+} // namespace Lunar
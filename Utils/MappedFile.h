@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Lunar
+{
+// Read-only memory mapping of a whole file; the view stays valid until Close or destruction
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	bool           IsOpen() const { return m_data != nullptr; }
+	const uint8_t* GetData() const { return m_data; }
+	size_t         GetSize() const { return m_size; }
+
+private:
+	const uint8_t* m_data = nullptr;
+	size_t         m_size = 0;
+#ifdef _WIN32
+	void* m_fileHandle = nullptr;
+	void* m_mappingHandle = nullptr;
+#else
+	int   m_fileDescriptor = -1;
+#endif
+};
+} // namespace Lunar
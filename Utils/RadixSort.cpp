@@ -0,0 +1,102 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "ThreadPool.h"
+
+using namespace std;
+
+namespace Lunar
+{
+uint32_t RadixSorter::FloatToKey(float value)
+{
+	uint32_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	// negatives reverse their order by flipping every bit; positives move above them by setting the sign bit
+	return bits ^ ((bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u);
+}
+
+void RadixSorter::Sort(vector<uint32_t>& keys, vector<uint32_t>& values)
+{
+	size_t count = keys.size();
+	if (count < 2) return;
+
+	m_scratchKeys.resize(count);
+	m_scratchValues.resize(count);
+	size_t chunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	m_chunkOffsets.resize(chunkCount * DIGIT_COUNT);
+
+	ThreadPool& threadPool = ThreadPool::GetInstance();
+	uint32_t* sourceKeys = keys.data();
+	uint32_t* sourceValues = values.data();
+	uint32_t* targetKeys = m_scratchKeys.data();
+	uint32_t* targetValues = m_scratchValues.data();
+	for (uint32_t shift = 0; shift < 32; shift += DIGIT_BITS)
+	{
+		threadPool.ParallelFor(chunkCount, 1, [&](size_t beginChunk, size_t endChunk)
+		{
+			const uint32_t* keysIn = sourceKeys;
+			for (size_t chunk = beginChunk; chunk < endChunk; ++chunk)
+			{
+				size_t counts[DIGIT_COUNT] = {};
+				size_t end = min((chunk + 1) * CHUNK_SIZE, count);
+				for (size_t i = chunk * CHUNK_SIZE; i < end; ++i)
+				{
+					++counts[(keysIn[i] >> shift) & (DIGIT_COUNT - 1)];
+				}
+				copy(counts, counts + DIGIT_COUNT, m_chunkOffsets.data() + chunk * DIGIT_COUNT);
+			}
+		});
+
+		// digit-major exclusive scan, so each chunk scatters after the same digit of the chunks before it
+		size_t offset = 0;
+		bool skip = false;
+		for (uint32_t digit = 0; digit < DIGIT_COUNT && !skip; ++digit)
+		{
+			size_t digitBegin = offset;
+			for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+			{
+				size_t& entry = m_chunkOffsets[chunk * DIGIT_COUNT + digit];
+				size_t chunkCountOfDigit = entry;
+				entry = offset;
+				offset += chunkCountOfDigit;
+			}
+			skip = offset - digitBegin == count;
+		}
+		if (skip) continue;
+
+		threadPool.ParallelFor(chunkCount, 1, [&](size_t beginChunk, size_t endChunk)
+		{
+			// locals, so the stores below cannot alias the offsets or the buffer pointers
+			const uint32_t* keysIn = sourceKeys;
+			const uint32_t* valuesIn = sourceValues;
+			uint32_t* keysOut = targetKeys;
+			uint32_t* valuesOut = targetValues;
+			for (size_t chunk = beginChunk; chunk < endChunk; ++chunk)
+			{
+				size_t offsets[DIGIT_COUNT];
+				copy(m_chunkOffsets.data() + chunk * DIGIT_COUNT, m_chunkOffsets.data() + (chunk + 1) * DIGIT_COUNT, offsets);
+				size_t end = min((chunk + 1) * CHUNK_SIZE, count);
+				for (size_t i = chunk * CHUNK_SIZE; i < end; ++i)
+				{
+					uint32_t key = keysIn[i];
+					size_t target = offsets[(key >> shift) & (DIGIT_COUNT - 1)]++;
+					keysOut[target] = key;
+					valuesOut[target] = valuesIn[i];
+				}
+			}
+		});
+		swap(sourceKeys, targetKeys);
+		swap(sourceValues, targetValues);
+	}
+
+	// an odd number of scatters leaves the result in the scratch buffers
+	if (sourceKeys != keys.data())
+	{
+		keys.swap(m_scratchKeys);
+		values.swap(m_scratchValues);
+	}
+}
+} // namespace Lunar
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Lunar
+{
+// Stable least-significant-digit radix sort of 32-bit keys carrying 32-bit values, eight bits per pass.
+// Each pass histograms and scatters fixed chunks on the thread pool, so the result does not depend on the
+// thread count. The scratch buffers are kept between calls.
+class RadixSorter
+{
+public:
+	// Sorts keys ascending and moves values with them. Passes whose digit is the same in every key are skipped.
+	void Sort(std::vector<uint32_t>& keys, std::vector<uint32_t>& values);
+
+	// Order-preserving map of a float to an unsigned key; negative zero sorts just before zero
+	static uint32_t FloatToKey(float value);
+
+private:
+	static constexpr size_t   CHUNK_SIZE = 16384;
+	static constexpr uint32_t DIGIT_BITS = 8;
+	static constexpr uint32_t DIGIT_COUNT = 1 << DIGIT_BITS;
+
+	std::vector<uint32_t> m_scratchKeys;
+	std::vector<uint32_t> m_scratchValues;
+	std::vector<size_t>   m_chunkOffsets;	// DIGIT_COUNT per chunk: counts, then scatter positions
+};
+} // namespace Lunar
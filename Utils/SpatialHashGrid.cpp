@@ -0,0 +1,237 @@
+#include "SpatialHashGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+void SpatialHashGrid::Build(const float* x, const float* y, const float* z, const uint32_t* indices, size_t count, float cellSize)
+{
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+	// about one hash per point keeps the runs short without the table outgrowing the points
+	size_t tableSize = MIN_TABLE_SIZE;
+	while (tableSize < count) tableSize <<= 1;
+	m_tableMask = static_cast<uint32_t>(tableSize - 1);
+
+	ThreadPool& threadPool = ThreadPool::GetInstance();
+	m_keys.resize(count);
+	m_pointIndices.resize(count);
+	threadPool.ParallelFor(count, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		const XMVECTOR inverseCellSize = XMVectorReplicate(m_inverseCellSize);
+		for (size_t i = begin; i < end; i += 4)
+		{
+			// lanes past the end repeat the last point and are not written
+			uint32_t lanes[4];
+			for (size_t lane = 0; lane < 4; ++lane)
+			{
+				size_t point = min(i + lane, end - 1);
+				lanes[lane] = indices ? indices[point] : static_cast<uint32_t>(point);
+			}
+			XMFLOAT4 cellX, cellY, cellZ;
+			XMStoreFloat4(&cellX, XMVectorFloor(XMVectorMultiply(XMVectorSet(x[lanes[0]], x[lanes[1]], x[lanes[2]], x[lanes[3]]), inverseCellSize)));
+			XMStoreFloat4(&cellY, XMVectorFloor(XMVectorMultiply(XMVectorSet(y[lanes[0]], y[lanes[1]], y[lanes[2]], y[lanes[3]]), inverseCellSize)));
+			XMStoreFloat4(&cellZ, XMVectorFloor(XMVectorMultiply(XMVectorSet(z[lanes[0]], z[lanes[1]], z[lanes[2]], z[lanes[3]]), inverseCellSize)));
+			const float* cellXLanes = &cellX.x;
+			const float* cellYLanes = &cellY.x;
+			const float* cellZLanes = &cellZ.x;
+			for (size_t lane = 0; lane < 4 && i + lane < end; ++lane)
+			{
+				m_keys[i + lane] = GetCellHash(static_cast<int32_t>(cellXLanes[lane]), static_cast<int32_t>(cellYLanes[lane]), static_cast<int32_t>(cellZLanes[lane]));
+				m_pointIndices[i + lane] = lanes[lane];
+			}
+		}
+	});
+
+	// stable, so the points of a cell keep their input order
+	m_sorter.Sort(m_keys, m_pointIndices);
+
+	// the counting sort's offsets: each hash starts after the points of every smaller hash
+	m_cellStart.resize(tableSize + 1);
+	threadPool.ParallelFor(tableSize + 1, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		size_t i = lower_bound(m_keys.begin(), m_keys.end(), static_cast<uint32_t>(begin)) - m_keys.begin();
+		for (size_t hash = begin; hash < end; ++hash)
+		{
+			while (i < count && m_keys[i] < hash) ++i;
+			m_cellStart[hash] = static_cast<uint32_t>(i);
+		}
+	});
+
+	m_x.resize(count + 3);
+	m_y.resize(count + 3);
+	m_z.resize(count + 3);
+	threadPool.ParallelFor(count, CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			uint32_t point = m_pointIndices[i];
+			m_x[i] = x[point];
+			m_y[i] = y[point];
+			m_z[i] = z[point];
+		}
+	});
+	// the padding's squared distance to anything overflows, so no query counts it
+	const float farAway = numeric_limits<float>::max();
+	fill(m_x.begin() + count, m_x.end(), farAway);
+	fill(m_y.begin() + count, m_y.end(), farAway);
+	fill(m_z.begin() + count, m_z.end(), farAway);
+}
+
+void SpatialHashGrid::GetCell(const XMFLOAT3& position, int32_t cell[3]) const
+{
+	cell[0] = static_cast<int32_t>(floorf(position.x * m_inverseCellSize));
+	cell[1] = static_cast<int32_t>(floorf(position.y * m_inverseCellSize));
+	cell[2] = static_cast<int32_t>(floorf(position.z * m_inverseCellSize));
+}
+
+uint32_t SpatialHashGrid::GetCellHash(int32_t x, int32_t y, int32_t z) const
+{
+	// the primes of Teschner et al., "Optimized Spatial Hashing for Collision Detection of Deformable Objects",
+	// added rather than xored so that neighbours along x get consecutive hashes
+	uint32_t hash = static_cast<uint32_t>(x) + static_cast<uint32_t>(y) * 19349663u + static_cast<uint32_t>(z) * 83492791u;
+	return hash & m_tableMask;
+}
+
+uint32_t SpatialHashGrid::GetNeighborRanges(const int32_t cell[3], uint32_t outRanges[MAX_NEIGHBOR_RANGES][2]) const
+{
+	if (m_pointIndices.empty()) return 0;
+
+	// hash intervals of the nine rows as first << 32 | last, split where they wrap past the end of the table
+	uint64_t intervals[MAX_NEIGHBOR_RANGES];
+	uint32_t intervalCount = 0;
+	for (int32_t dz = -1; dz <= 1; ++dz)
+	{
+		for (int32_t dy = -1; dy <= 1; ++dy)
+		{
+			uint64_t first = GetCellHash(cell[0] - 1, cell[1] + dy, cell[2] + dz);
+			uint64_t last = (first + 2) & m_tableMask;
+			if (last < first)
+			{
+				intervals[intervalCount++] = (first << 32) | m_tableMask;
+				first = 0;
+			}
+			intervals[intervalCount++] = (first << 32) | last;
+		}
+	}
+
+	// merged, so rows whose hashes collide are not visited twice
+	sort(intervals, intervals + intervalCount);
+	uint32_t mergedCount = 0;
+	for (uint32_t i = 0; i < intervalCount; ++i)
+	{
+		uint32_t first = static_cast<uint32_t>(intervals[i] >> 32);
+		uint32_t last = static_cast<uint32_t>(intervals[i]);
+		uint32_t mergedLast = mergedCount > 0 ? static_cast<uint32_t>(intervals[mergedCount - 1]) : 0;
+		if (mergedCount > 0 && first <= mergedLast + 1)
+		{
+			intervals[mergedCount - 1] = (intervals[mergedCount - 1] & 0xFFFFFFFF00000000ull) | max(mergedLast, last);
+		}
+		else
+		{
+			intervals[mergedCount++] = intervals[i];
+		}
+	}
+
+	uint32_t rangeCount = 0;
+	for (uint32_t i = 0; i < mergedCount; ++i)
+	{
+		uint32_t begin = m_cellStart[intervals[i] >> 32];
+		uint32_t end = m_cellStart[static_cast<uint32_t>(intervals[i]) + 1];
+		if (begin == end) continue;
+		outRanges[rangeCount][0] = begin;
+		outRanges[rangeCount++][1] = end;
+	}
+	return rangeCount;
+}
+
+template<typename T, typename Query>
+void SpatialHashGrid::ForEachPoint(T* outValues, const Query& query) const
+{
+	ThreadPool::GetInstance().ParallelFor(m_pointIndices.size(), CHUNK_SIZE, [&](size_t begin, size_t end)
+	{
+		// sorted neighbours mostly share a cell, and so the ranges around it
+		int32_t lastCell[3] = {};
+		uint32_t ranges[MAX_NEIGHBOR_RANGES][2];
+		uint32_t rangeCount = 0;
+		for (size_t i = begin; i < end; ++i)
+		{
+			XMFLOAT3 position(m_x[i], m_y[i], m_z[i]);
+			int32_t cell[3];
+			GetCell(position, cell);
+			if (i == begin || cell[0] != lastCell[0] || cell[1] != lastCell[1] || cell[2] != lastCell[2])
+			{
+				rangeCount = GetNeighborRanges(cell, ranges);
+				copy(cell, cell + 3, lastCell);
+			}
+			outValues[m_pointIndices[i]] = query(position, ranges, rangeCount);
+		}
+	});
+}
+
+template<typename Kernel>
+float SpatialHashGrid::SumNeighbors(const XMFLOAT3& position, float radius, const uint32_t ranges[][2], uint32_t rangeCount, const Kernel& kernel) const
+{
+	const XMVECTOR laneOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+	const XMVECTOR px = XMVectorReplicate(position.x);
+	const XMVECTOR py = XMVectorReplicate(position.y);
+	const XMVECTOR pz = XMVectorReplicate(position.z);
+	const XMVECTOR radiusSquared = XMVectorReplicate(radius * radius);
+	XMVECTOR sum = XMVectorZero();
+	for (uint32_t range = 0; range < rangeCount; ++range)
+	{
+		uint32_t begin = ranges[range][0];
+		uint32_t end = ranges[range][1];
+		for (uint32_t i = begin; i < end; i += 4)
+		{
+			// the last group reads into the next run or the padding; its lanes past the end are masked off
+			XMVECTOR dx = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_x.data() + i)), px);
+			XMVECTOR dy = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_y.data() + i)), py);
+			XMVECTOR dz = XMVectorSubtract(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(m_z.data() + i)), pz);
+			XMVECTOR distanceSquared = XMVectorMultiplyAdd(dz, dz, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dx, dx)));
+			XMVECTOR inside = XMVectorAndInt(
+				XMVectorLessOrEqual(distanceSquared, radiusSquared),
+				XMVectorLess(laneOffsets, XMVectorReplicate(static_cast<float>(end - i))));
+			sum = XMVectorAdd(sum, XMVectorSelect(XMVectorZero(), kernel(distanceSquared), inside));
+		}
+	}
+	XMFLOAT4 lanes;
+	XMStoreFloat4(&lanes, sum);
+	return (lanes.x + lanes.y) + (lanes.z + lanes.w);
+}
+
+void SpatialHashGrid::CountNeighbors(float radius, uint32_t* outCounts) const
+{
+	ForEachPoint(outCounts, [&](const XMFLOAT3& position, const uint32_t ranges[][2], uint32_t rangeCount)
+	{
+		// whole numbers well below 2^24, so the float sum is exact
+		return static_cast<uint32_t>(SumNeighbors(position, radius, ranges, rangeCount, [](FXMVECTOR)
+		{
+			return XMVectorSplatOne();
+		}));
+	});
+}
+
+void SpatialHashGrid::ComputeDensities(float radius, float mass, float* outDensities) const
+{
+	// poly6: 315 / (64 pi h^9) (h^2 - r^2)^3
+	const float radius3 = radius * radius * radius;
+	const float scale = mass * 315.0f / (64.0f * XM_PI * radius3 * radius3 * radius3);
+	ForEachPoint(outDensities, [&](const XMFLOAT3& position, const uint32_t ranges[][2], uint32_t rangeCount)
+	{
+		const XMVECTOR radiusSquared = XMVectorReplicate(radius * radius);
+		return scale * SumNeighbors(position, radius, ranges, rangeCount, [&](FXMVECTOR distanceSquared)
+		{
+			XMVECTOR difference = XMVectorSubtract(radiusSquared, distanceSquared);
+			return XMVectorMultiply(XMVectorMultiply(difference, difference), difference);
+		});
+	});
+}
+} // namespace Lunar
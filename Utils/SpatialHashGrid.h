@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <DirectXMath.h>
+
+#include "RadixSort.h"
+
+namespace Lunar
+{
+// Uniform grid for fixed-radius neighbour queries over a point set, hashed into a power-of-two table so it
+// needs no bounds. Build sorts (cell hash, point) pairs with the radix sorter, one counting sort per byte of
+// the hash, and keeps where each hash's points start in that order, so a cell's points are contiguous. The
+// hash is linear in x, which also makes the three cells of a row contiguous: a query tests 9 runs of sorted
+// positions four at a time rather than 27. Cells whose hashes collide share a run; the distance test keeps
+// their points apart. Like the sorter, the result does not depend on the thread count.
+class SpatialHashGrid
+{
+public:
+	// Grids points indices[0..count) of the x, y and z streams, or points 0 to count - 1 when indices is null.
+	// Queries look at the 27 cells around a position, so the cell size should be at least the query radius.
+	void Build(const float* x, const float* y, const float* z, const uint32_t* indices, size_t count, float cellSize);
+
+	size_t GetCount() const { return m_pointIndices.size(); }
+	float  GetCellSize() const { return m_cellSize; }
+
+	// Calls func(pointIndex, distanceSquared) for every point within radius of position, itself included
+	template<typename Func>
+	void ForEachNeighbor(const DirectX::XMFLOAT3& position, float radius, Func&& func) const
+	{
+		int32_t cell[3];
+		GetCell(position, cell);
+		uint32_t ranges[MAX_NEIGHBOR_RANGES][2];
+		uint32_t rangeCount = GetNeighborRanges(cell, ranges);
+		float radiusSquared = radius * radius;
+		for (uint32_t range = 0; range < rangeCount; ++range)
+		{
+			for (uint32_t i = ranges[range][0]; i < ranges[range][1]; ++i)
+			{
+				float dx = m_x[i] - position.x;
+				float dy = m_y[i] - position.y;
+				float dz = m_z[i] - position.z;
+				float distanceSquared = dx * dx + dy * dy + dz * dz;
+				if (distanceSquared <= radiusSquared) func(m_pointIndices[i], distanceSquared);
+			}
+		}
+	}
+
+	// Points within radius of each point, itself included. Written at the point's index, so outCounts must
+	// hold the largest index plus one.
+	void CountNeighbors(float radius, uint32_t* outCounts) const;
+	// SPH density of each point: mass times the poly6 kernel of support radius summed over its neighbours.
+	// Written at the point's index like CountNeighbors.
+	void ComputeDensities(float radius, float mass, float* outDensities) const;
+
+private:
+	static constexpr size_t   CHUNK_SIZE = 4096;	// points per thread pool chunk
+	static constexpr size_t   MIN_TABLE_SIZE = 1024;
+	static constexpr uint32_t MAX_NEIGHBOR_RANGES = 18;	// 9 rows, each split in two where its hashes wrap
+
+	void     GetCell(const DirectX::XMFLOAT3& position, int32_t cell[3]) const;
+	uint32_t GetCellHash(int32_t x, int32_t y, int32_t z) const;
+	// Sorted point ranges of the 3x3x3 cells around cell, without overlaps or empty ranges; returns how many
+	uint32_t GetNeighborRanges(const int32_t cell[3], uint32_t outRanges[MAX_NEIGHBOR_RANGES][2]) const;
+	// Writes query(position, ranges, rangeCount) at the index of every point, visiting them in sorted order on
+	// the thread pool
+	template<typename T, typename Query>
+	void ForEachPoint(T* outValues, const Query& query) const;
+	// Sums kernel(distanceSquared) over the points of ranges within radius of position, four lanes at a time
+	template<typename Kernel>
+	float SumNeighbors(const DirectX::XMFLOAT3& position, float radius, const uint32_t ranges[][2], uint32_t rangeCount, const Kernel& kernel) const;
+
+	float                 m_cellSize = 1.0f;
+	float                 m_inverseCellSize = 1.0f;
+	uint32_t              m_tableMask = 0;
+	std::vector<uint32_t> m_cellStart;		// per hash and one past the last, sorted points with a smaller hash
+	std::vector<uint32_t> m_keys;			// cell hash of each sorted point
+	std::vector<uint32_t> m_pointIndices;	// point index of each sorted point
+	std::vector<float>    m_x;				// sorted positions, padded with three far away points
+	std::vector<float>    m_y;
+	std::vector<float>    m_z;
+	RadixSorter           m_sorter;
+};
+} // namespace Lunar
@@ -0,0 +1,181 @@
+#include "SphericalHarmonics.h"
+
+#include <array>
+
+#include "IBLUtils.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+
+using namespace std;
+using namespace DirectX;
+
+namespace Lunar
+{
+namespace
+{
+// per row: nine coefficients for each of r, g, b, then the summed solid angle
+constexpr int ROW_SUM_COUNT = SphericalHarmonics::COEFFICIENT_COUNT * 3 + 1;
+
+// Four texels per XMVECTOR lane set; the basis functions and weights are computed for all four at once
+void ProjectRow(const float* rowData, int face, int y, int size, array<double, ROW_SUM_COUNT>& rowSums)
+{
+	const CubemapFaceBasis& basis = IBLUtils::GetCubemapFaceBasis(face);
+	float v = (y + 0.5f) * 2.0f / size - 1.0f;
+	float texelArea = 4.0f / (static_cast<float>(size) * size);
+
+	XMVECTOR sums[ROW_SUM_COUNT];
+	for (XMVECTOR& sum : sums) sum = XMVectorZero();
+
+	const XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	const XMVECTOR uScale = XMVectorReplicate(2.0f / size);
+	const XMVECTOR one = XMVectorReplicate(1.0f);
+	const XMVECTOR vv = XMVectorReplicate(v);
+	for (int x = 0; x < size; x += 4)
+	{
+		// u for the four texels, and the unnormalized direction axis + u * uAxis + v * vAxis
+		XMVECTOR u = XMVectorSubtract(XMVectorMultiply(XMVectorAdd(XMVectorReplicate(static_cast<float>(x)), laneOffsets), uScale), one);
+		XMVECTOR dx = XMVectorAdd(XMVectorReplicate(basis.axis.x + v * basis.vAxis.x), XMVectorScale(u, basis.uAxis.x));
+		XMVECTOR dy = XMVectorAdd(XMVectorReplicate(basis.axis.y + v * basis.vAxis.y), XMVectorScale(u, basis.uAxis.y));
+		XMVECTOR dz = XMVectorAdd(XMVectorReplicate(basis.axis.z + v * basis.vAxis.z), XMVectorScale(u, basis.uAxis.z));
+
+		// |d|^2 = 1 + u^2 + v^2, and a texel covers texelArea / |d|^3 steradians
+		XMVECTOR invLength = XMVectorReciprocalSqrt(XMVectorAdd(XMVectorMultiplyAdd(u, u, one), XMVectorMultiply(vv, vv)));
+		XMVECTOR weight = XMVectorScale(XMVectorMultiply(XMVectorMultiply(invLength, invLength), invLength), texelArea);
+		dx = XMVectorMultiply(dx, invLength);
+		dy = XMVectorMultiply(dy, invLength);
+		dz = XMVectorMultiply(dz, invLength);
+
+		// lanes past the end of the row keep a zero weight
+		int laneCount = min(4, size - x);
+		if (laneCount < 4)
+		{
+			XMVECTOR laneMask = XMVectorLess(XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f), XMVectorReplicate(static_cast<float>(laneCount)));
+			weight = XMVectorSelect(XMVectorZero(), weight, laneMask);
+		}
+
+		XMFLOAT4 colors[3] = {};
+		for (int lane = 0; lane < laneCount; ++lane)
+		{
+			const float* texel = rowData + (x + lane) * 4;
+			(&colors[0].x)[lane] = texel[0];
+			(&colors[1].x)[lane] = texel[1];
+			(&colors[2].x)[lane] = texel[2];
+		}
+
+		XMVECTOR shBasis[SphericalHarmonics::COEFFICIENT_COUNT] = {
+			XMVectorReplicate(0.282095f),
+			XMVectorScale(dy, 0.488603f),
+			XMVectorScale(dz, 0.488603f),
+			XMVectorScale(dx, 0.488603f),
+			XMVectorScale(XMVectorMultiply(dx, dy), 1.092548f),
+			XMVectorScale(XMVectorMultiply(dy, dz), 1.092548f),
+			XMVectorScale(XMVectorSubtract(XMVectorScale(XMVectorMultiply(dz, dz), 3.0f), one), 0.315392f),
+			XMVectorScale(XMVectorMultiply(dx, dz), 1.092548f),
+			XMVectorScale(XMVectorSubtract(XMVectorMultiply(dx, dx), XMVectorMultiply(dy, dy)), 0.546274f),
+		};
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			XMVECTOR weightedColor = XMVectorMultiply(XMLoadFloat4(&colors[channel]), weight);
+			for (int i = 0; i < SphericalHarmonics::COEFFICIENT_COUNT; ++i)
+			{
+				XMVECTOR& sum = sums[channel * SphericalHarmonics::COEFFICIENT_COUNT + i];
+				sum = XMVectorMultiplyAdd(shBasis[i], weightedColor, sum);
+			}
+		}
+		sums[ROW_SUM_COUNT - 1] = XMVectorAdd(sums[ROW_SUM_COUNT - 1], weight);
+	}
+
+	for (int i = 0; i < ROW_SUM_COUNT; ++i)
+	{
+		XMFLOAT4 lanes;
+		XMStoreFloat4(&lanes, sums[i]);
+		rowSums[i] = static_cast<double>(lanes.x) + lanes.y + lanes.z + lanes.w;
+	}
+}
+} // namespace
+
+void SphericalHarmonics::EvaluateBasis(const XMFLOAT3& direction, float outBasis[COEFFICIENT_COUNT])
+{
+	float x = direction.x;
+	float y = direction.y;
+	float z = direction.z;
+	outBasis[0] = 0.282095f;
+	outBasis[1] = 0.488603f * y;
+	outBasis[2] = 0.488603f * z;
+	outBasis[3] = 0.488603f * x;
+	outBasis[4] = 1.092548f * x * y;
+	outBasis[5] = 1.092548f * y * z;
+	outBasis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+	outBasis[7] = 1.092548f * x * z;
+	outBasis[8] = 0.546274f * (x * x - y * y);
+}
+
+SHCoefficients SphericalHarmonics::ProjectCubemap(const CubemapImage& cubemap)
+{
+	LOG_FUNCTION_ENTRY();
+
+	int cubemapSize = cubemap.size;
+	int rowCount = 6 * cubemapSize;
+	vector<array<double, ROW_SUM_COUNT>> rowSums(rowCount);
+	ThreadPool::GetInstance().ParallelFor(rowCount, 16, [&](size_t begin, size_t end)
+	{
+		for (size_t row = begin; row < end; ++row)
+		{
+			int face = static_cast<int>(row) / cubemapSize;
+			int y = static_cast<int>(row) % cubemapSize;
+			ProjectRow(cubemap.GetFace(0, face) + static_cast<size_t>(y) * cubemapSize * 4, face, y, cubemapSize, rowSums[row]);
+		}
+	});
+
+	array<double, ROW_SUM_COUNT> totals = {};
+	for (const auto& sums : rowSums)
+	{
+		for (int i = 0; i < ROW_SUM_COUNT; ++i) totals[i] += sums[i];
+	}
+
+	// the texel solid angles add up to slightly less than 4pi, rescale so a constant environment projects exactly
+	double normalization = 4.0 * XM_PI / totals[ROW_SUM_COUNT - 1];
+	SHCoefficients result;
+	for (int i = 0; i < COEFFICIENT_COUNT; ++i)
+	{
+		result.coefficients[i] = XMFLOAT3(
+			static_cast<float>(totals[i] * normalization),
+			static_cast<float>(totals[COEFFICIENT_COUNT + i] * normalization),
+			static_cast<float>(totals[2 * COEFFICIENT_COUNT + i] * normalization));
+	}
+
+	LOG_FUNCTION_EXIT();
+	return result;
+}
+
+SHCoefficients SphericalHarmonics::ConvolveCosineLobe(const SHCoefficients& radiance)
+{
+	static constexpr float bandScales[COEFFICIENT_COUNT] = {
+		XM_PI,
+		2.0f * XM_PI / 3.0f, 2.0f * XM_PI / 3.0f, 2.0f * XM_PI / 3.0f,
+		XM_PI / 4.0f, XM_PI / 4.0f, XM_PI / 4.0f, XM_PI / 4.0f, XM_PI / 4.0f,
+	};
+
+	SHCoefficients irradiance;
+	for (int i = 0; i < COEFFICIENT_COUNT; ++i)
+	{
+		XMStoreFloat3(&irradiance.coefficients[i], XMVectorScale(XMLoadFloat3(&radiance.coefficients[i]), bandScales[i]));
+	}
+	return irradiance;
+}
+
+XMFLOAT3 SphericalHarmonics::Evaluate(const SHCoefficients& coefficients, const XMFLOAT3& direction)
+{
+	float basis[COEFFICIENT_COUNT];
+	EvaluateBasis(direction, basis);
+
+	XMVECTOR result = XMVectorZero();
+	for (int i = 0; i < COEFFICIENT_COUNT; ++i)
+	{
+		result = XMVectorMultiplyAdd(XMLoadFloat3(&coefficients.coefficients[i]), XMVectorReplicate(basis[i]), result);
+	}
+	XMFLOAT3 value;
+	XMStoreFloat3(&value, result);
+	return value;
+}
+} // namespace Lunar
@@ -0,0 +1,35 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include "CubemapSampler.h"
+
+namespace Lunar
+{
+// Nine RGB coefficients of an order-2 (L0..L2) real spherical harmonics expansion, 108 bytes
+struct SHCoefficients
+{
+	DirectX::XMFLOAT3 coefficients[9];
+};
+
+// L2 spherical harmonics for diffuse image-based lighting.
+// Projecting the environment once and convolving with the clamped cosine lobe gives irradiance for any
+// normal from nine coefficients, which replaces the irradiance cubemap and its per-texel Monte Carlo.
+class SphericalHarmonics
+{
+public:
+	static constexpr int COEFFICIENT_COUNT = 9;
+
+	// Basis in the order Y00, Y1-1, Y10, Y11, Y2-2, Y2-1, Y20, Y21, Y22; direction must be normalized
+	static void EvaluateBasis(const DirectX::XMFLOAT3& direction, float outBasis[COEFFICIENT_COUNT]);
+
+	// Solid-angle weighted projection of mip 0 of a cubemap.
+	// Rows are split across the thread pool and summed in a fixed order, so the result does not
+	// depend on the thread count.
+	static SHCoefficients ProjectCubemap(const CubemapImage& cubemap);
+
+	// Radiance to irradiance by the clamped cosine lobe (pi, 2pi/3, pi/4 per band)
+	static SHCoefficients ConvolveCosineLobe(const SHCoefficients& radiance);
+
+	static DirectX::XMFLOAT3 Evaluate(const SHCoefficients& coefficients, const DirectX::XMFLOAT3& direction);
+};
+} // namespace Lunar
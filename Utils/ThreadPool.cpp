@@ -0,0 +1,164 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+namespace Lunar
+{
+namespace
+{
+thread_local bool t_serial = false;
+
+// LUNAR_WORKER_THREADS overrides the worker count, e.g. to run the pool paths on a single core machine
+bool GetWorkerCountOverride(size_t& outWorkerCount)
+{
+	string value;
+#ifdef _MSC_VER
+	char* buffer = nullptr;
+	size_t length = 0;
+	if (_dupenv_s(&buffer, &length, "LUNAR_WORKER_THREADS") == 0 && buffer)
+	{
+		value = buffer;
+		free(buffer);
+	}
+#else
+	if (const char* buffer = getenv("LUNAR_WORKER_THREADS")) value = buffer;
+#endif
+	if (value.empty() || value.find_first_not_of("0123456789") != string::npos || value.size() > 4) return false;
+	outWorkerCount = stoul(value);
+	return true;
+}
+
+struct ParallelForState
+{
+	const function<void(size_t, size_t)>* func = nullptr;
+	size_t             count = 0;
+	size_t             chunkSize = 0;
+	size_t             chunkCount = 0;
+	atomic<size_t>     nextChunk { 0 };
+	size_t             finishedChunks = 0;
+	mutex              doneMutex;
+	condition_variable done;
+
+	// Runs chunks until none are left; a helper that arrives late never touches func
+	void RunChunks()
+	{
+		size_t chunk;
+		while ((chunk = nextChunk.fetch_add(1)) < chunkCount)
+		{
+			size_t begin = chunk * chunkSize;
+			size_t end = min(begin + chunkSize, count);
+			(*func)(begin, end);
+
+			lock_guard<mutex> lock(doneMutex);
+			if (++finishedChunks == chunkCount) done.notify_all();
+		}
+	}
+};
+}
+
+ThreadPool::ThreadPool()
+{
+	unsigned hardwareThreads = thread::hardware_concurrency();
+	size_t workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	GetWorkerCountOverride(workerCount);
+	m_workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; ++i)
+	{
+		m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_stopping = true;
+	}
+	m_taskAvailable.notify_all();
+	for (thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		function<void()> task;
+		{
+			unique_lock<mutex> lock(m_mutex);
+			m_taskAvailable.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+			if (m_stopping && m_tasks.empty()) return;
+			task = move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+void ThreadPool::Submit(function<void()> task)
+{
+	if (m_workers.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		m_tasks.emplace_back(move(task));
+	}
+	m_taskAvailable.notify_one();
+}
+
+ThreadPool::SerialScope::SerialScope() : m_wasSerial(t_serial)
+{
+	t_serial = true;
+}
+
+ThreadPool::SerialScope::~SerialScope()
+{
+	t_serial = m_wasSerial;
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t minChunkSize, const function<void(size_t, size_t)>& func)
+{
+	if (count == 0) return;
+
+	minChunkSize = max<size_t>(minChunkSize, 1);
+	size_t chunkCount = min(GetThreadCount(), (count + minChunkSize - 1) / minChunkSize);
+	if (chunkCount <= 1 || t_serial)
+	{
+		func(0, count);
+		return;
+	}
+
+	auto state = make_shared<ParallelForState>();
+	state->func = &func;
+	state->count = count;
+	state->chunkSize = (count + chunkCount - 1) / chunkCount;
+	state->chunkCount = (count + state->chunkSize - 1) / state->chunkSize;
+
+	{
+		lock_guard<mutex> lock(m_mutex);
+		for (size_t i = 1; i < state->chunkCount; ++i)
+		{
+			m_tasks.emplace_back([state] { state->RunChunks(); });
+		}
+	}
+	m_taskAvailable.notify_all();
+
+	// the caller also works, so nested ParallelFor calls from inside a worker cannot deadlock
+	state->RunChunks();
+
+	unique_lock<mutex> lock(state->doneMutex);
+	state->done.wait(lock, [&state] { return state->finishedChunks == state->chunkCount; });
+}
+} // namespace Lunar
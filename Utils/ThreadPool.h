@@ -0,0 +1,61 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Lunar
+{
+// Persistent worker threads for CPU-side data-parallel work (geometry, baking, simulation)
+class ThreadPool
+{
+public:
+	static ThreadPool& GetInstance()
+	{
+		static ThreadPool instance;
+		return instance;
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Number of threads taking part in ParallelFor, including the calling thread
+	size_t GetThreadCount() const { return m_workers.size() + 1; }
+
+	// Splits [0, count) into contiguous ranges of at least minChunkSize and runs func(begin, end) on each.
+	// The calling thread works on chunks too and returns once every chunk has finished.
+	void ParallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& func);
+
+	// Queues fire-and-forget background work; runs it inline when there are no worker threads
+	void Submit(std::function<void()> task);
+
+	// While one is alive, ParallelFor calls made on its thread run func(0, count) inline. Lets a result be
+	// checked against the same code run serially.
+	class SerialScope
+	{
+	public:
+		SerialScope();
+		~SerialScope();
+		SerialScope(const SerialScope&) = delete;
+		SerialScope& operator=(const SerialScope&) = delete;
+
+	private:
+		bool m_wasSerial;
+	};
+
+private:
+	ThreadPool();
+	~ThreadPool();
+
+	void WorkerLoop();
+
+	std::vector<std::thread>          m_workers;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex                        m_mutex;
+	std::condition_variable           m_taskAvailable;
+	bool                              m_stopping = false;
+};
+} // namespace Lunar